@@ -0,0 +1,366 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+/**
+ * This program measures the performance of OpenMM on a set of representative
+ * systems and reports the results in machine readable form: one JSON object
+ * per benchmark, written to stdout.  Each object records the platform, the
+ * number of particles, the cost of an integration step, the corresponding
+ * simulation rate in ns/day, and the time spent evaluating each force.
+ *
+ * Usage: Benchmark [platform name] [benchmark name]
+ *
+ * If no platform is specified it uses the fastest available one.  If no
+ * benchmark is specified it runs all of them.
+ */
+
+#include "openmm/Context.h"
+#include "openmm/CustomNonbondedForce.h"
+#include "openmm/GBSAOBCForce.h"
+#include "openmm/NonbondedForce.h"
+#include "openmm/Platform.h"
+#include "openmm/State.h"
+#include "openmm/System.h"
+#include "openmm/VerletIntegrator.h"
+#ifdef OPENMM_BENCHMARK_AMOEBA
+#include "openmm/AmoebaMultipoleForce.h"
+#include "openmm/AmoebaVdwForce.h"
+#endif
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace OpenMM;
+using namespace std;
+
+static Platform* platform = NULL;
+
+/**
+ * Get the current wall clock time in milliseconds.
+ */
+static double currentTimeMillis() {
+    return chrono::duration<double, milli>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Create a Context for a System, simulate it, and report the timings.  Each
+ * force is placed in its own force group so its cost can be measured
+ * separately by requesting the energy of one group at a time.
+ *
+ * @param name        the name of the benchmark, included in the output
+ * @param system      the System to simulate
+ * @param positions   the initial particle positions
+ * @param stepSize    the integration step size in ps
+ * @param forceLabels a label for each force in the System, in the same order
+ */
+static void runBenchmark(const string& name, System& system, const vector<Vec3>& positions, double stepSize, const vector<string>& forceLabels) {
+    for (int i = 0; i < system.getNumForces(); i++)
+        system.getForce(i).setForceGroup(i);
+    VerletIntegrator integrator(stepSize);
+    Context context(system, integrator, *platform);
+    context.setPositions(positions);
+    context.setVelocitiesToTemperature(300.0, 1);
+
+    // Run a few steps first so initialization and kernel compilation are not
+    // included in the timings.
+
+    integrator.step(10);
+    context.getState(State::Energy);
+
+    // Time the integration loop.
+
+    const int numSteps = 100;
+    double startTime = currentTimeMillis();
+    integrator.step(numSteps);
+    context.getState(State::Energy);
+    double msPerStep = (currentTimeMillis()-startTime)/numSteps;
+    double nsPerDay = 86400000.0*stepSize*1e-3/msPerStep;
+
+    // Time each force separately.  This requests forces rather than energy,
+    // since repeated energy-only evaluations of an unchanged state are
+    // satisfied from the energy cache.
+
+    vector<double> forceTime(system.getNumForces());
+    const int numEvaluations = 10;
+    for (int i = 0; i < system.getNumForces(); i++) {
+        context.getState(State::Forces, false, 1<<i);
+        double start = currentTimeMillis();
+        for (int j = 0; j < numEvaluations; j++)
+            context.getState(State::Forces, false, 1<<i);
+        forceTime[i] = (currentTimeMillis()-start)/numEvaluations;
+    }
+    stringstream out;
+    out.precision(5);
+    out<<"{\"benchmark\": \""<<name<<"\", \"platform\": \""<<platform->getName()<<"\", \"particles\": "<<system.getNumParticles();
+    out<<", \"ms_per_step\": "<<msPerStep<<", \"ns_per_day\": "<<nsPerDay<<", \"force_ms\": {";
+    for (int i = 0; i < system.getNumForces(); i++)
+        out<<(i == 0 ? "" : ", ")<<"\""<<forceLabels[i]<<"\": "<<forceTime[i];
+    out<<"}}";
+    cout<<out.str()<<endl;
+}
+
+/**
+ * Add the three particles of a water molecule to a System and append their
+ * positions, with the oxygen at the given location.
+ */
+static void addWaterPositions(vector<Vec3>& positions, const Vec3& center) {
+    const double angleHOH = 104.52*M_PI/180;
+    const double lengthOH = 0.09572;
+    positions.push_back(center);
+    positions.push_back(center+Vec3(lengthOH, 0, 0));
+    positions.push_back(center+Vec3(lengthOH*cos(angleHOH), lengthOH*sin(angleHOH), 0));
+}
+
+/**
+ * A box of rigid TIP3P water simulated with PME, standing in for an explicit
+ * solvent simulation with constraints.
+ */
+static void benchmarkPme() {
+    const int watersPerEdge = 14;
+    const double spacing = 0.3107;
+    const double boxEdge = watersPerEdge*spacing;
+    System system;
+    system.setDefaultPeriodicBoxVectors(Vec3(boxEdge, 0, 0), Vec3(0, boxEdge, 0), Vec3(0, 0, boxEdge));
+    NonbondedForce* nonbonded = new NonbondedForce();
+    nonbonded->setNonbondedMethod(NonbondedForce::PME);
+    nonbonded->setCutoffDistance(1.0);
+    system.addForce(nonbonded);
+    vector<Vec3> positions;
+    for (int x = 0; x < watersPerEdge; x++)
+        for (int y = 0; y < watersPerEdge; y++)
+            for (int z = 0; z < watersPerEdge; z++) {
+                int o = system.addParticle(15.999);
+                int h1 = system.addParticle(1.008);
+                int h2 = system.addParticle(1.008);
+                nonbonded->addParticle(-0.834, 0.3151, 0.6364);
+                nonbonded->addParticle(0.417, 1.0, 0.0);
+                nonbonded->addParticle(0.417, 1.0, 0.0);
+                nonbonded->addException(o, h1, 0.0, 1.0, 0.0);
+                nonbonded->addException(o, h2, 0.0, 1.0, 0.0);
+                nonbonded->addException(h1, h2, 0.0, 1.0, 0.0);
+                system.addConstraint(o, h1, 0.09572);
+                system.addConstraint(o, h2, 0.09572);
+                system.addConstraint(h1, h2, 0.15139);
+                addWaterPositions(positions, Vec3(x*spacing, y*spacing, z*spacing));
+            }
+    runBenchmark("pme", system, positions, 0.002, vector<string>(1, "NonbondedForce"));
+}
+
+/**
+ * Particles with alternating charges simulated with GB implicit solvent and
+ * no cutoff.
+ */
+static void benchmarkGB() {
+    const int particlesPerEdge = 13;
+    const double spacing = 0.5;
+    System system;
+    NonbondedForce* nonbonded = new NonbondedForce();
+    nonbonded->setNonbondedMethod(NonbondedForce::NoCutoff);
+    system.addForce(nonbonded);
+    GBSAOBCForce* gb = new GBSAOBCForce();
+    system.addForce(gb);
+    vector<Vec3> positions;
+    int index = 0;
+    for (int x = 0; x < particlesPerEdge; x++)
+        for (int y = 0; y < particlesPerEdge; y++)
+            for (int z = 0; z < particlesPerEdge; z++) {
+                system.addParticle(12.011);
+                double charge = (index++%2 == 0 ? 0.25 : -0.25);
+                nonbonded->addParticle(charge, 0.3, 0.5);
+                gb->addParticle(charge, 0.15, 0.8);
+                positions.push_back(Vec3(x*spacing, y*spacing, z*spacing));
+            }
+    vector<string> labels;
+    labels.push_back("NonbondedForce");
+    labels.push_back("GBSAOBCForce");
+    runBenchmark("gb", system, positions, 0.002, labels);
+}
+
+/**
+ * A Lennard-Jones fluid implemented with a CustomNonbondedForce, so the cost
+ * of evaluating a tabulated or symbolic interaction can be compared to the
+ * built in one.
+ */
+static void benchmarkCustomNonbonded() {
+    const int particlesPerEdge = 16;
+    const double spacing = 0.4;
+    const double boxEdge = particlesPerEdge*spacing;
+    System system;
+    system.setDefaultPeriodicBoxVectors(Vec3(boxEdge, 0, 0), Vec3(0, boxEdge, 0), Vec3(0, 0, boxEdge));
+    CustomNonbondedForce* custom = new CustomNonbondedForce("4*eps*((sig/r)^12-(sig/r)^6); sig=0.5*(sig1+sig2); eps=sqrt(eps1*eps2)");
+    custom->addPerParticleParameter("sig");
+    custom->addPerParticleParameter("eps");
+    custom->setNonbondedMethod(CustomNonbondedForce::CutoffPeriodic);
+    custom->setCutoffDistance(1.0);
+    system.addForce(custom);
+    vector<Vec3> positions;
+    vector<double> parameters(2);
+    parameters[0] = 0.34;
+    parameters[1] = 0.5;
+    for (int x = 0; x < particlesPerEdge; x++)
+        for (int y = 0; y < particlesPerEdge; y++)
+            for (int z = 0; z < particlesPerEdge; z++) {
+                system.addParticle(39.95);
+                custom->addParticle(parameters);
+                positions.push_back(Vec3(x*spacing, y*spacing, z*spacing));
+            }
+    runBenchmark("customnb", system, positions, 0.002, vector<string>(1, "CustomNonbondedForce"));
+}
+
+#ifdef OPENMM_BENCHMARK_AMOEBA
+/**
+ * A box of AMOEBA water: polarizable multipoles evaluated with PME plus the
+ * buffered 14-7 vdw term.  The parameters match the ones used by the AMOEBA
+ * plugin tests.
+ */
+static void benchmarkAmoeba() {
+    const int watersPerEdge = 6;
+    const double boxEdge = 1.8643;
+    const double spacing = boxEdge/watersPerEdge;
+    const int numParticles = 3*watersPerEdge*watersPerEdge*watersPerEdge;
+    System system;
+    system.setDefaultPeriodicBoxVectors(Vec3(boxEdge, 0, 0), Vec3(0, boxEdge, 0), Vec3(0, 0, boxEdge));
+    AmoebaMultipoleForce* multipole = new AmoebaMultipoleForce();
+    multipole->setNonbondedMethod(AmoebaMultipoleForce::PME);
+    multipole->setPolarizationType(AmoebaMultipoleForce::Mutual);
+    multipole->setCutoffDistance(0.7);
+    multipole->setMutualInducedTargetEpsilon(1.0e-05);
+    multipole->setMutualInducedMaxIterations(500);
+    multipole->setAEwald(5.4459052);
+    multipole->setEwaldErrorTolerance(1.0e-04);
+    multipole->setPmeGridDimensions(vector<int>(3, 20));
+    system.addForce(multipole);
+    AmoebaVdwForce* vdw = new AmoebaVdwForce();
+    vdw->setSigmaCombiningRule("CUBIC-MEAN");
+    vdw->setEpsilonCombiningRule("HHG");
+    vdw->setNonbondedMethod(AmoebaVdwForce::CutoffPeriodic);
+    vdw->setCutoff(0.7);
+    vdw->setUseDispersionCorrection(true);
+    system.addForce(vdw);
+
+    vector<double> oxygenDipole(3), oxygenQuadrupole(9);
+    oxygenDipole[2] = 7.5561214e-03;
+    oxygenQuadrupole[0] = 3.5403072e-04;
+    oxygenQuadrupole[4] = -3.9025708e-04;
+    oxygenQuadrupole[8] = 3.6226356e-05;
+    vector<double> hydrogenDipole(3), hydrogenQuadrupole(9);
+    hydrogenDipole[0] = -2.0420949e-03;
+    hydrogenDipole[2] = -3.0787530e-03;
+    hydrogenQuadrupole[0] = -3.4284825e-05;
+    hydrogenQuadrupole[2] = -1.8948597e-06;
+    hydrogenQuadrupole[4] = -1.0024088e-04;
+    hydrogenQuadrupole[6] = -1.8948597e-06;
+    hydrogenQuadrupole[8] = 1.3452570e-04;
+
+    for (int i = 0; i < numParticles; i += 3) {
+        system.addParticle(15.995);
+        system.addParticle(1.008);
+        system.addParticle(1.008);
+        multipole->addMultipole(-5.1966000e-01, oxygenDipole, oxygenQuadrupole, 1, i+1, i+2, -1,
+                                0.39, 3.0698765e-01, 8.3700000e-04);
+        multipole->addMultipole(2.5983000e-01, hydrogenDipole, hydrogenQuadrupole, 0, i, i+2, -1,
+                                0.39, 2.8135002e-01, 4.9600000e-04);
+        multipole->addMultipole(2.5983000e-01, hydrogenDipole, hydrogenQuadrupole, 0, i, i+1, -1,
+                                0.39, 2.8135002e-01, 4.9600000e-04);
+        vector<int> covalent12;
+        covalent12.push_back(i+1);
+        covalent12.push_back(i+2);
+        multipole->setCovalentMap(i, AmoebaMultipoleForce::Covalent12, covalent12);
+        vector<int> polarization;
+        polarization.push_back(i);
+        polarization.push_back(i+1);
+        polarization.push_back(i+2);
+        multipole->setCovalentMap(i, AmoebaMultipoleForce::PolarizationCovalent11, polarization);
+        multipole->setCovalentMap(i+1, AmoebaMultipoleForce::PolarizationCovalent11, polarization);
+        multipole->setCovalentMap(i+2, AmoebaMultipoleForce::PolarizationCovalent11, polarization);
+        multipole->setCovalentMap(i+1, AmoebaMultipoleForce::Covalent12, vector<int>(1, i));
+        multipole->setCovalentMap(i+2, AmoebaMultipoleForce::Covalent12, vector<int>(1, i));
+        multipole->setCovalentMap(i+1, AmoebaMultipoleForce::Covalent13, vector<int>(1, i+2));
+        multipole->setCovalentMap(i+2, AmoebaMultipoleForce::Covalent13, vector<int>(1, i+1));
+
+        vdw->addParticle(i, 1.7025000e-01, 4.6024000e-01, 0.0);
+        vdw->addParticle(i, 1.3275000e-01, 5.6484000e-02, 0.91);
+        vdw->addParticle(i, 1.3275000e-01, 5.6484000e-02, 0.91);
+        vector<int> exclusions;
+        exclusions.push_back(i);
+        exclusions.push_back(i+1);
+        exclusions.push_back(i+2);
+        vdw->setParticleExclusions(i, exclusions);
+        vdw->setParticleExclusions(i+1, exclusions);
+        vdw->setParticleExclusions(i+2, exclusions);
+
+        system.addConstraint(i, i+1, 0.09572);
+        system.addConstraint(i, i+2, 0.09572);
+        system.addConstraint(i+1, i+2, 0.15139);
+    }
+    vector<Vec3> positions;
+    for (int x = 0; x < watersPerEdge; x++)
+        for (int y = 0; y < watersPerEdge; y++)
+            for (int z = 0; z < watersPerEdge; z++)
+                addWaterPositions(positions, Vec3(x*spacing, y*spacing, z*spacing));
+    vector<string> labels;
+    labels.push_back("AmoebaMultipoleForce");
+    labels.push_back("AmoebaVdwForce");
+    runBenchmark("amoeba", system, positions, 0.001, labels);
+}
+#endif
+
+int main(int argc, char* argv[]) {
+    try {
+        Platform::loadPluginsFromDirectory(Platform::getDefaultPluginsDirectory());
+        if (argc > 1)
+            platform = &Platform::getPlatformByName(argv[1]);
+        else {
+            for (int i = 0; i < Platform::getNumPlatforms(); i++)
+                if (platform == NULL || Platform::getPlatform(i).getSpeed() > platform->getSpeed())
+                    platform = &Platform::getPlatform(i);
+        }
+        string benchmark = (argc > 2 ? argv[2] : "all");
+        if (benchmark == "all" || benchmark == "pme")
+            benchmarkPme();
+        if (benchmark == "all" || benchmark == "gb")
+            benchmarkGB();
+        if (benchmark == "all" || benchmark == "customnb")
+            benchmarkCustomNonbonded();
+#ifdef OPENMM_BENCHMARK_AMOEBA
+        if (benchmark == "all" || benchmark == "amoeba")
+            benchmarkAmoeba();
+#endif
+    }
+    catch(const exception& e) {
+        cout << "exception: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
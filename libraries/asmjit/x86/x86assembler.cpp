@@ -3913,6 +3913,8 @@ _EmitAvxR:
       EMIT_OP(vex_XvvvvLpp);
       EMIT_OP(opCode);
     }
+
+    opReg &= 0x07;
   }
 
   EMIT_BYTE(x86EncodeMod(3, opReg, static_cast<uint32_t>(rmReg)));
@@ -62,7 +62,22 @@ class ParsedExpression;
 class LEPTON_EXPORT CompiledExpression {
 public:
     CompiledExpression();
+    /**
+     * Create a copy of another CompiledExpression.  The copy shares no state with the original,
+     * so this is the recommended way to create a separate instance for each thread.  Copying
+     * reuses the compiled program rather than recompiling the expression; only the generated
+     * machine code is rebuilt, since it refers directly to the copy's own storage.
+     */
     CompiledExpression(const CompiledExpression& expression);
+    /**
+     * Create a CompiledExpression that evaluates several expressions together.  Subexpressions
+     * that appear in more than one of the expressions are identified during compilation and
+     * computed only once per call to evaluate(), which can be much faster than evaluating the
+     * expressions independently when they share a lot of work (for example, an expression and
+     * its derivatives).  Call getOutput() to retrieve the value of each expression after
+     * calling evaluate().
+     */
+    CompiledExpression(const std::vector<ParsedExpression>& expressions);
     ~CompiledExpression();
     CompiledExpression& operator=(const CompiledExpression& expression);
     /**
@@ -82,18 +97,35 @@ public:
     void setVariableLocations(std::map<std::string, double*>& variableLocations);
     /**
      * Evaluate the expression.  The values of all variables should have been set before calling this.
+     * If this object was compiled from several expressions, this evaluates all of them and returns the
+     * value of the first one; use getOutput() to retrieve the others.
      */
     double evaluate() const;
+    /**
+     * Get the number of expressions this object evaluates.
+     */
+    int getNumOutputs() const;
+    /**
+     * Get the value of one of the expressions, as computed by the most recent call to evaluate().
+     * This should only be used on objects that were compiled from several expressions.
+     */
+    double getOutput(int index) const;
 private:
     friend class ParsedExpression;
     CompiledExpression(const ParsedExpression& expression);
+    void compile(const std::vector<ParsedExpression>& expressions);
     void compileExpression(const ExpressionTreeNode& node, std::vector<std::pair<ExpressionTreeNode, int> >& temps);
     int findTempIndex(const ExpressionTreeNode& node, std::vector<std::pair<ExpressionTreeNode, int> >& temps);
+    void cacheOperationData();
     std::map<std::string, double*> variablePointers;
     std::vector<std::pair<double*, double*> > variablesToCopy;
     std::vector<std::vector<int> > arguments;
     std::vector<int> target;
     std::vector<Operation*> operation;
+    std::vector<int> operationId;
+    std::vector<double> operationConstant;
+    std::vector<int> outputIndex;
+    mutable std::vector<double> outputValues;
     std::map<std::string, int> variableIndices;
     std::set<std::string> variableNames;
     mutable std::vector<double> workspace;
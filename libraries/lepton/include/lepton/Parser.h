@@ -53,16 +53,23 @@ class LEPTON_EXPORT Parser {
 public:
     /**
      * Parse a mathematical expression and return a representation of it as an abstract syntax tree.
+     *
+     * Parsed expressions are cached, so parsing the same string many times only does the
+     * work once.  This method is thread safe.
      */
     static ParsedExpression parse(const std::string& expression);
     /**
      * Parse a mathematical expression and return a representation of it as an abstract syntax tree.
      *
+     * Expressions that do not involve custom functions are cached, so parsing the same string
+     * many times only does the work once.  This method is thread safe.
+     *
      * @param customFunctions   a map specifying user defined functions that may appear in the expression.
      *                          The key are function names, and the values are corresponding CustomFunction objects.
      */
     static ParsedExpression parse(const std::string& expression, const std::map<std::string, CustomFunction*>& customFunctions);
 private:
+    static ParsedExpression parseImpl(const std::string& expression, const std::map<std::string, CustomFunction*>& customFunctions);
     static std::string trim(const std::string& expression);
     static std::vector<ParseToken> tokenize(const std::string& expression);
     static ParseToken getNextToken(const std::string& expression, int start);
@@ -32,6 +32,8 @@
 #include "lepton/CompiledExpression.h"
 #include "lepton/Operation.h"
 #include "lepton/ParsedExpression.h"
+#include <algorithm>
+#include <cmath>
 #include <utility>
 
 using namespace Lepton;
@@ -44,14 +46,31 @@ CompiledExpression::CompiledExpression() : jitCode(NULL) {
 }
 
 CompiledExpression::CompiledExpression(const ParsedExpression& expression) : jitCode(NULL) {
-    ParsedExpression expr = expression.optimize(); // Just in case it wasn't already optimized.
+    compile(vector<ParsedExpression>(1, expression));
+}
+
+CompiledExpression::CompiledExpression(const vector<ParsedExpression>& expressions) : jitCode(NULL) {
+    compile(expressions);
+}
+
+void CompiledExpression::compile(const vector<ParsedExpression>& expressions) {
+    // Compile all the expressions into a single program.  Because they share one list of
+    // temporary values, a subexpression that appears in more than one expression is only
+    // computed once.
+
     vector<pair<ExpressionTreeNode, int> > temps;
-    compileExpression(expr.getRootNode(), temps);
+    for (int i = 0; i < (int) expressions.size(); i++) {
+        ParsedExpression expr = expressions[i].optimize(); // Just in case it wasn't already optimized.
+        compileExpression(expr.getRootNode(), temps);
+        outputIndex.push_back(findTempIndex(expr.getRootNode(), temps));
+    }
+    outputValues.resize(outputIndex.size());
     int maxArguments = 1;
     for (int i = 0; i < (int) operation.size(); i++)
         if (operation[i]->getNumArguments() > maxArguments)
             maxArguments = operation[i]->getNumArguments();
     argValues.resize(maxArguments);
+    cacheOperationData();
 #ifdef LEPTON_USE_JIT
     generateJitCode();
 #endif
@@ -70,6 +89,8 @@ CompiledExpression::CompiledExpression(const CompiledExpression& expression) : j
 CompiledExpression& CompiledExpression::operator=(const CompiledExpression& expression) {
     arguments = expression.arguments;
     target = expression.target;
+    outputIndex = expression.outputIndex;
+    outputValues.resize(expression.outputValues.size());
     variableIndices = expression.variableIndices;
     variableNames = expression.variableNames;
     workspace.resize(expression.workspace.size());
@@ -77,10 +98,29 @@ CompiledExpression& CompiledExpression::operator=(const CompiledExpression& expr
     operation.resize(expression.operation.size());
     for (int i = 0; i < (int) operation.size(); i++)
         operation[i] = expression.operation[i]->clone();
+    cacheOperationData();
     setVariableLocations(variablePointers);
     return *this;
 }
 
+void CompiledExpression::cacheOperationData() {
+    // Record the id of each operation, and the constant (if any) it uses, so that evaluate()
+    // can dispatch the common operations without a virtual function call for every step.
+
+    operationId.resize(operation.size());
+    operationConstant.resize(operation.size(), 0.0);
+    for (int step = 0; step < (int) operation.size(); step++) {
+        Operation& op = *operation[step];
+        operationId[step] = op.getId();
+        if (op.getId() == Operation::CONSTANT)
+            operationConstant[step] = dynamic_cast<Operation::Constant&>(op).getValue();
+        else if (op.getId() == Operation::ADD_CONSTANT)
+            operationConstant[step] = dynamic_cast<Operation::AddConstant&>(op).getValue();
+        else if (op.getId() == Operation::MULTIPLY_CONSTANT)
+            operationConstant[step] = dynamic_cast<Operation::MultiplyConstant&>(op).getValue();
+    }
+}
+
 void CompiledExpression::compileExpression(const ExpressionTreeNode& node, vector<pair<ExpressionTreeNode, int> >& temps) {
     if (findTempIndex(node, temps) != -1)
         return; // We have already processed a node identical to this one.
@@ -170,19 +210,116 @@ double CompiledExpression::evaluate() const {
     for (int i = 0; i < variablesToCopy.size(); i++)
         *variablesToCopy[i].first = *variablesToCopy[i].second;
 
-    // Loop over the operations and evaluate each one.
-    
+    // Loop over the operations and evaluate each one.  The common operations are dispatched
+    // through a switch on the cached operation id, which is much faster than making a virtual
+    // function call for every step.  Anything not handled by the switch falls through to the
+    // virtual evaluate() method.
+
     for (int step = 0; step < operation.size(); step++) {
         const vector<int>& args = arguments[step];
+        double* argPointer;
         if (args.size() == 1)
-            workspace[target[step]] = operation[step]->evaluate(&workspace[args[0]], dummyVariables);
+            argPointer = &workspace[args[0]];
         else {
             for (int i = 0; i < args.size(); i++)
                 argValues[i] = workspace[args[i]];
-            workspace[target[step]] = operation[step]->evaluate(&argValues[0], dummyVariables);
+            argPointer = &argValues[0];
+        }
+        double result;
+        switch (operationId[step]) {
+            case Operation::CONSTANT:
+                result = operationConstant[step];
+                break;
+            case Operation::ADD:
+                result = argPointer[0]+argPointer[1];
+                break;
+            case Operation::SUBTRACT:
+                result = argPointer[0]-argPointer[1];
+                break;
+            case Operation::MULTIPLY:
+                result = argPointer[0]*argPointer[1];
+                break;
+            case Operation::DIVIDE:
+                result = argPointer[0]/argPointer[1];
+                break;
+            case Operation::POWER:
+                result = pow(argPointer[0], argPointer[1]);
+                break;
+            case Operation::NEGATE:
+                result = -argPointer[0];
+                break;
+            case Operation::SQRT:
+                result = sqrt(argPointer[0]);
+                break;
+            case Operation::EXP:
+                result = exp(argPointer[0]);
+                break;
+            case Operation::LOG:
+                result = log(argPointer[0]);
+                break;
+            case Operation::SIN:
+                result = sin(argPointer[0]);
+                break;
+            case Operation::COS:
+                result = cos(argPointer[0]);
+                break;
+            case Operation::TAN:
+                result = tan(argPointer[0]);
+                break;
+            case Operation::STEP:
+                result = (argPointer[0] >= 0.0 ? 1.0 : 0.0);
+                break;
+            case Operation::DELTA:
+                result = (argPointer[0] == 0.0 ? 1.0 : 0.0);
+                break;
+            case Operation::SQUARE:
+                result = argPointer[0]*argPointer[0];
+                break;
+            case Operation::CUBE:
+                result = argPointer[0]*argPointer[0]*argPointer[0];
+                break;
+            case Operation::RECIPROCAL:
+                result = 1.0/argPointer[0];
+                break;
+            case Operation::ADD_CONSTANT:
+                result = argPointer[0]+operationConstant[step];
+                break;
+            case Operation::MULTIPLY_CONSTANT:
+                result = argPointer[0]*operationConstant[step];
+                break;
+            case Operation::MIN:
+                result = (min)(argPointer[0], argPointer[1]);
+                break;
+            case Operation::MAX:
+                result = (max)(argPointer[0], argPointer[1]);
+                break;
+            case Operation::ABS:
+                result = fabs(argPointer[0]);
+                break;
+            case Operation::FLOOR:
+                result = floor(argPointer[0]);
+                break;
+            case Operation::CEIL:
+                result = ceil(argPointer[0]);
+                break;
+            default:
+                result = operation[step]->evaluate(argPointer, dummyVariables);
         }
+        workspace[target[step]] = result;
     }
-    return workspace[workspace.size()-1];
+    return workspace[outputIndex[0]];
+#endif
+}
+
+int CompiledExpression::getNumOutputs() const {
+    return outputIndex.size();
+}
+
+double CompiledExpression::getOutput(int index) const {
+#ifdef LEPTON_USE_JIT
+    return outputValues[index];
+#else
+    return workspace[outputIndex[index]];
 #endif
 }
 
@@ -193,6 +330,13 @@ static double evaluateOperation(Operation* op, double* args) {
 }
 
 void CompiledExpression::generateJitCode() {
+    // Use the AVX and FMA instruction sets when the processor supports them.  The three
+    // operand forms save a register copy before most arithmetic operations, and a multiply
+    // whose result feeds directly into an add is fused into a single instruction.
+
+    const X86CpuInfo* cpu = X86CpuInfo::getHost();
+    bool useAVX = cpu->hasFeature(kX86CpuFeatureAVX);
+    bool useFMA = useAVX && cpu->hasFeature(kX86CpuFeatureFMA3);
     X86Compiler c(&runtime);
     c.addFunc(kFuncConvHost, FuncBuilder0<double>());
     vector<X86XmmVar> workspaceVar(workspace.size());
@@ -258,39 +402,89 @@ void CompiledExpression::generateJitCode() {
         }
     }
     
+    // Count how many times each workspace entry is used, so we can tell when a product
+    // is consumed only by the add that follows it.
+
+    vector<int> useCount(workspace.size(), 0);
+    for (int step = 0; step < (int) operation.size(); step++) {
+        vector<int> args = arguments[step];
+        if (args.size() == 1)
+            for (int i = 1; i < operation[step]->getNumArguments(); i++)
+                args.push_back(args[0]+i);
+        if (operation[step]->getNumArguments() > 0)
+            for (int i = 0; i < (int) args.size(); i++)
+                useCount[args[i]]++;
+    }
+    for (int i = 0; i < (int) outputIndex.size(); i++)
+        useCount[outputIndex[i]]++;
+
     // Evaluate the operations.
-    
+
     for (int step = 0; step < (int) operation.size(); step++) {
         Operation& op = *operation[step];
         vector<int> args = arguments[step];
         if (args.size() == 1) {
             // One or more sequential arguments.  Fill out the list.
-            
+
             for (int i = 1; i < op.getNumArguments(); i++)
                 args.push_back(args[0]+i);
         }
-        
+
+        // A multiply whose result is consumed only by the add that follows it can be fused
+        // into a single multiply-add instruction.
+
+        if (useFMA && op.getId() == Operation::MULTIPLY && step+1 < (int) operation.size() &&
+                operation[step+1]->getId() == Operation::ADD && useCount[target[step]] == 1) {
+            vector<int> addArgs = arguments[step+1];
+            if (addArgs.size() == 1)
+                addArgs.push_back(addArgs[0]+1);
+            if (addArgs[0] == target[step] || addArgs[1] == target[step]) {
+                int other = (addArgs[0] == target[step] ? addArgs[1] : addArgs[0]);
+                X86XmmVar& dest = workspaceVar[target[step+1]];
+                c.movsd(dest, workspaceVar[args[0]]);
+                c.emit(kX86InstIdVfmadd213sd, dest, workspaceVar[args[1]], workspaceVar[other]);
+                step++;
+                continue;
+            }
+        }
+
         // Generate instructions to execute this operation.
-        
+
         switch (op.getId()) {
             case Operation::CONSTANT:
                 c.movsd(workspaceVar[target[step]], constantVar[operationConstantIndex[step]]);
                 break;
             case Operation::ADD:
-                c.movsd(workspaceVar[target[step]], workspaceVar[args[0]]);
-                c.addsd(workspaceVar[target[step]], workspaceVar[args[1]]);
+                if (useAVX)
+                    c.emit(kX86InstIdVaddsd, workspaceVar[target[step]], workspaceVar[args[0]], workspaceVar[args[1]]);
+                else {
+                    c.movsd(workspaceVar[target[step]], workspaceVar[args[0]]);
+                    c.addsd(workspaceVar[target[step]], workspaceVar[args[1]]);
+                }
                 break;
             case Operation::SUBTRACT:
-                c.movsd(workspaceVar[target[step]], workspaceVar[args[0]]);
-                c.subsd(workspaceVar[target[step]], workspaceVar[args[1]]);
+                if (useAVX)
+                    c.emit(kX86InstIdVsubsd, workspaceVar[target[step]], workspaceVar[args[0]], workspaceVar[args[1]]);
+                else {
+                    c.movsd(workspaceVar[target[step]], workspaceVar[args[0]]);
+                    c.subsd(workspaceVar[target[step]], workspaceVar[args[1]]);
+                }
                 break;
             case Operation::MULTIPLY:
-                c.movsd(workspaceVar[target[step]], workspaceVar[args[0]]);
-                c.mulsd(workspaceVar[target[step]], workspaceVar[args[1]]);
+                if (useAVX)
+                    c.emit(kX86InstIdVmulsd, workspaceVar[target[step]], workspaceVar[args[0]], workspaceVar[args[1]]);
+                else {
+                    c.movsd(workspaceVar[target[step]], workspaceVar[args[0]]);
+                    c.mulsd(workspaceVar[target[step]], workspaceVar[args[1]]);
+                }
                 break;
             case Operation::DIVIDE:
-                c.movsd(workspaceVar[target[step]], workspaceVar[args[0]]);
-                c.divsd(workspaceVar[target[step]], workspaceVar[args[1]]);
+                if (useAVX)
+                    c.emit(kX86InstIdVdivsd, workspaceVar[target[step]], workspaceVar[args[0]], workspaceVar[args[1]]);
+                else {
+                    c.movsd(workspaceVar[target[step]], workspaceVar[args[0]]);
+                    c.divsd(workspaceVar[target[step]], workspaceVar[args[1]]);
+                }
                 break;
             case Operation::NEGATE:
                 c.xorps(workspaceVar[target[step]], workspaceVar[target[step]]);
@@ -343,25 +537,47 @@ void CompiledExpression::generateJitCode() {
                 c.andps(workspaceVar[target[step]], constantVar[operationConstantIndex[step]]);
                 break;
             case Operation::SQUARE:
-                c.movsd(workspaceVar[target[step]], workspaceVar[args[0]]);
-                c.mulsd(workspaceVar[target[step]], workspaceVar[args[0]]);
+                if (useAVX)
+                    c.emit(kX86InstIdVmulsd, workspaceVar[target[step]], workspaceVar[args[0]], workspaceVar[args[0]]);
+                else {
+                    c.movsd(workspaceVar[target[step]], workspaceVar[args[0]]);
+                    c.mulsd(workspaceVar[target[step]], workspaceVar[args[0]]);
+                }
                 break;
             case Operation::CUBE:
-                c.movsd(workspaceVar[target[step]], workspaceVar[args[0]]);
-                c.mulsd(workspaceVar[target[step]], workspaceVar[args[0]]);
-                c.mulsd(workspaceVar[target[step]], workspaceVar[args[0]]);
+                if (useAVX) {
+                    c.emit(kX86InstIdVmulsd, workspaceVar[target[step]], workspaceVar[args[0]], workspaceVar[args[0]]);
+                    c.emit(kX86InstIdVmulsd, workspaceVar[target[step]], workspaceVar[target[step]], workspaceVar[args[0]]);
+                }
+                else {
+                    c.movsd(workspaceVar[target[step]], workspaceVar[args[0]]);
+                    c.mulsd(workspaceVar[target[step]], workspaceVar[args[0]]);
+                    c.mulsd(workspaceVar[target[step]], workspaceVar[args[0]]);
+                }
                 break;
             case Operation::RECIPROCAL:
-                c.movsd(workspaceVar[target[step]], constantVar[operationConstantIndex[step]]);
-                c.divsd(workspaceVar[target[step]], workspaceVar[args[0]]);
+                if (useAVX)
+                    c.emit(kX86InstIdVdivsd, workspaceVar[target[step]], constantVar[operationConstantIndex[step]], workspaceVar[args[0]]);
+                else {
+                    c.movsd(workspaceVar[target[step]], constantVar[operationConstantIndex[step]]);
+                    c.divsd(workspaceVar[target[step]], workspaceVar[args[0]]);
+                }
                 break;
             case Operation::ADD_CONSTANT:
-                c.movsd(workspaceVar[target[step]], workspaceVar[args[0]]);
-                c.addsd(workspaceVar[target[step]], constantVar[operationConstantIndex[step]]);
+                if (useAVX)
+                    c.emit(kX86InstIdVaddsd, workspaceVar[target[step]], workspaceVar[args[0]], constantVar[operationConstantIndex[step]]);
+                else {
+                    c.movsd(workspaceVar[target[step]], workspaceVar[args[0]]);
+                    c.addsd(workspaceVar[target[step]], constantVar[operationConstantIndex[step]]);
+                }
                 break;
             case Operation::MULTIPLY_CONSTANT:
-                c.movsd(workspaceVar[target[step]], workspaceVar[args[0]]);
-                c.mulsd(workspaceVar[target[step]], constantVar[operationConstantIndex[step]]);
+                if (useAVX)
+                    c.emit(kX86InstIdVmulsd, workspaceVar[target[step]], workspaceVar[args[0]], constantVar[operationConstantIndex[step]]);
+                else {
+                    c.movsd(workspaceVar[target[step]], workspaceVar[args[0]]);
+                    c.mulsd(workspaceVar[target[step]], constantVar[operationConstantIndex[step]]);
+                }
                 break;
             case Operation::ABS:
                 generateSingleArgCall(c, workspaceVar[target[step]], workspaceVar[args[0]], fabs);
@@ -385,7 +601,15 @@ void CompiledExpression::generateJitCode() {
                 call->setRet(0, workspaceVar[target[step]]);
         }
     }
-    c.ret(workspaceVar[workspace.size()-1]);
+    if (outputIndex.size() > 1) {
+        // Store the value of every output so getOutput() can retrieve them.
+
+        X86GpVar outputPointer(c);
+        c.mov(outputPointer, imm_ptr(&outputValues[0]));
+        for (int i = 0; i < (int) outputIndex.size(); i++)
+            c.movsd(x86::ptr(outputPointer, 8*i, 0), workspaceVar[outputIndex[i]]);
+    }
+    c.ret(workspaceVar[outputIndex[0]]);
     c.endFunc();
     jitCode = c.make();
 }
@@ -37,6 +37,7 @@
 #include "lepton/ParsedExpression.h"
 #include <cctype>
 #include <iostream>
+#include <mutex>
 
 using namespace Lepton;
 using namespace std;
@@ -150,6 +151,25 @@ ParsedExpression Parser::parse(const string& expression) {
 }
 
 ParsedExpression Parser::parse(const string& expression, const map<string, CustomFunction*>& customFunctions) {
+    // Parsing is surprisingly expensive, and the same string is often parsed many times, for
+    // example when a Context contains many forces that share an energy function.  Cache the
+    // parsed form and return a copy on later calls.  Expressions that involve custom functions
+    // are not cached: the cache key would have to include the function objects themselves, and
+    // a later caller could pass a different function at a previously seen address.
+
+    if (customFunctions.empty()) {
+        static map<string, ParsedExpression> cache;
+        static mutex cacheMutex;
+        lock_guard<mutex> lock(cacheMutex);
+        map<string, ParsedExpression>::iterator cached = cache.find(expression);
+        if (cached == cache.end())
+            cached = cache.insert(make_pair(expression, parseImpl(expression, customFunctions))).first;
+        return cached->second;
+    }
+    return parseImpl(expression, customFunctions);
+}
+
+ParsedExpression Parser::parseImpl(const string& expression, const map<string, CustomFunction*>& customFunctions) {
     try {
         // First split the expression into subexpressions.
 
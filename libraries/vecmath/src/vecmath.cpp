@@ -1,4 +1,4 @@
-#if defined(__ANDROID__)
+#if defined(__ANDROID__) || defined(__ARM_NEON__) || defined(__ARM_NEON)
     #include "neon_mathfun.h"
 #else
     #if !defined(__PNACL__)
@@ -175,7 +175,9 @@ public:
      */
     static Platform& getPlatform(int index);
     /**
-     * Get any failures caused during the last call to loadPluginsFromDirectory
+     * Get any failures caused during the last call to loadPluginsFromDirectory.
+     * Because libraries queued by loadPluginsFromDirectory are not loaded until the
+     * first time a Platform is requested, calling this method forces them to be loaded.
      */
     static std::vector<std::string> getPluginLoadFailures();
     /**
@@ -206,12 +208,14 @@ public:
     static void loadPluginLibrary(const std::string& file);
     /**
      * Load multiple dynamic libraries (DLLs) which contain OpenMM plugins from a single directory.
-     * This method loops over every file contained in the specified directory and calls loadPluginLibrary()
-     * for each one.  If an error occurs while trying to load a particular file, that file is simply
+     * This method scans the directory, which is cheap, then defers actually loading the libraries
+     * until the first time a Platform is requested.  Programs which never create a Platform (for
+     * example, ones that only build or serialize Systems) therefore never pay the cost of loading
+     * them.  If an error occurs while trying to load a particular file, that file is simply
      * ignored. You can retrieve a list of all such errors by calling getPluginLoadFailures().
      *
      * @param directory    the path to the directory containing libraries to load
-     * @return the names of all files which were successfully loaded as libraries
+     * @return the names of all files which were found and queued for loading
      */
     static std::vector<std::string> loadPluginsFromDirectory(const std::string& directory);
     /**
@@ -242,6 +246,8 @@ private:
     std::map<std::string, KernelFactory*> kernelFactories;
     std::map<std::string, std::string> defaultProperties;
     static std::vector<Platform*>& getPlatforms();
+    static std::vector<std::string>& getPendingPluginFiles();
+    static void loadPendingPlugins();
     static std::vector<std::string> pluginLoadFailures;
 };
 
@@ -40,6 +40,7 @@
 #include "openmm/CustomBondForce.h"
 #include "openmm/CustomCentroidBondForce.h"
 #include "openmm/CustomCompoundBondForce.h"
+#include "openmm/CustomCVForce.h"
 #include "openmm/CustomExternalForce.h"
 #include "openmm/CustomGBForce.h"
 #include "openmm/CustomHbondForce.h"
@@ -53,6 +54,7 @@
 #include "openmm/HarmonicBondForce.h"
 #include "openmm/KernelImpl.h"
 #include "openmm/LangevinIntegrator.h"
+#include "openmm/LangevinMiddleIntegrator.h"
 #include "openmm/MonteCarloBarostat.h"
 #include "openmm/PeriodicTorsionForce.h"
 #include "openmm/RBTorsionForce.h"
@@ -61,6 +63,7 @@
 #include "openmm/VariableLangevinIntegrator.h"
 #include "openmm/VariableVerletIntegrator.h"
 #include "openmm/VerletIntegrator.h"
+#include <cmath>
 #include <iosfwd>
 #include <set>
 #include <string>
@@ -111,6 +114,16 @@ public:
      * energy directly, <i>or</i> add it to an internal buffer so that it will be included here.
      */
     virtual double finishComputation(ContextImpl& context, bool includeForce, bool includeEnergy, int groups, bool& valid) = 0;
+    /**
+     * Get whether the energies returned by the individual ForceImpls can be attributed to their
+     * force groups, so that the energy of every group can be computed in a single evaluation.
+     * Platforms that accumulate all of the energies in an internal buffer and only return the
+     * total from finishComputation() should override this to return false; the energies by
+     * force group are then computed by evaluating each group separately.
+     */
+    virtual bool supportsEnergyDecomposition() const {
+        return true;
+    }
 };
 
 /**
@@ -149,6 +162,74 @@ public:
      * @param positions  on exit, this contains the particle positions
      */
     virtual void getPositions(ContextImpl& context, std::vector<Vec3>& positions) = 0;
+    /**
+     * Get the positions of all particles, translating each molecule so its center lies inside
+     * the first periodic box.  The default implementation does nothing and returns false, in
+     * which case the caller is responsible for wrapping the positions itself.  Platforms that
+     * store positions on a device can override it to do the wrapping in a kernel before the
+     * download, which is much faster for large systems.
+     *
+     * @param positions  on exit, this contains the particle positions
+     * @return true if the positions were retrieved and wrapped, or false if the caller must do it
+     */
+    virtual bool getWrappedPositions(ContextImpl& context, std::vector<Vec3>& positions) {
+        return false;
+    }
+    /**
+     * Begin copying the positions of all particles to the host.  This may return before the
+     * copy has finished, allowing other work to be done while the data is in transit.  Call
+     * finishGetPositions() to wait for the copy and retrieve the result.  The default
+     * implementation simply performs the whole download in finishGetPositions().
+     *
+     * @param context    the context in which to execute this kernel
+     */
+    virtual void beginGetPositions(ContextImpl& context) {
+    }
+    /**
+     * Block until the copy started by beginGetPositions() has finished, and get the positions
+     * it recorded.
+     *
+     * @param positions  on exit, this contains the particle positions
+     */
+    virtual void finishGetPositions(ContextImpl& context, std::vector<Vec3>& positions) {
+        getPositions(context, positions);
+    }
+    /**
+     * Get the positions of a subset of the particles.  The default implementation retrieves
+     * every position and then selects the requested ones; platforms that store positions on a
+     * device can override it to transfer only the particles that were asked for.
+     *
+     * @param particles  the indices of the particles whose positions are requested
+     * @param positions  on exit, this contains the position of each requested particle
+     */
+    virtual void getSelectedPositions(ContextImpl& context, const std::vector<int>& particles, std::vector<Vec3>& positions) {
+        std::vector<Vec3> allPositions;
+        getPositions(context, allPositions);
+        positions.resize(particles.size());
+        for (int i = 0; i < (int) particles.size(); i++)
+            positions[i] = allPositions[particles[i]];
+    }
+    /**
+     * Get the positions of all particles in a quantized fixed point representation.  Each
+     * coordinate is rounded to the nearest multiple of the resolution and reported as a 32 bit
+     * integer.  This is useful when recording frames at high frequency, since the quantized
+     * values are smaller to transfer and store than floating point coordinates.  The default
+     * implementation downloads the full precision positions and quantizes them on the host;
+     * platforms that store positions on a device can override it to perform the conversion
+     * before the download and transfer only the smaller representation.
+     *
+     * @param resolution  the spacing between representable positions (in nm)
+     * @param positions   on exit, this contains three integers for each particle.  Multiplying
+     *                    them by the resolution gives the particle's position in nm.
+     */
+    virtual void getQuantizedPositions(ContextImpl& context, double resolution, std::vector<int>& positions) {
+        std::vector<Vec3> allPositions;
+        getPositions(context, allPositions);
+        positions.resize(3*allPositions.size());
+        for (int i = 0; i < (int) allPositions.size(); i++)
+            for (int j = 0; j < 3; j++)
+                positions[3*i+j] = (int) std::floor(allPositions[i][j]/resolution + 0.5);
+    }
     /**
      * Set the positions of all particles.
      *
@@ -167,6 +248,19 @@ public:
      * @param velocities  a vector containing the particle velocities
      */
     virtual void setVelocities(ContextImpl& context, const std::vector<Vec3>& velocities) = 0;
+    /**
+     * Set the positions and velocities of all particles in a single operation.  On platforms
+     * where uploading an array to the device involves a synchronization, combining the two
+     * arrays lets restoring a saved state pay that cost only once.  The default implementation
+     * simply calls setPositions() followed by setVelocities().
+     *
+     * @param positions   a vector containing the particle positions
+     * @param velocities  a vector containing the particle velocities
+     */
+    virtual void setPositionsAndVelocities(ContextImpl& context, const std::vector<Vec3>& positions, const std::vector<Vec3>& velocities) {
+        setPositions(context, positions);
+        setVelocities(context, velocities);
+    }
     /**
      * Get the current forces on all particles.
      *
@@ -584,10 +678,14 @@ public:
     /**
      * Copy changed parameters over to a context.
      *
-     * @param context    the context to copy parameters to
-     * @param force      the NonbondedForce to copy the parameters from
+     * @param context        the context to copy parameters to
+     * @param force          the NonbondedForce to copy the parameters from
+     * @param firstParticle  the index of the first particle whose parameters might have changed
+     * @param lastParticle   the index of the last particle whose parameters might have changed
+     * @param firstException the index of the first exception whose parameters might have changed
+     * @param lastException  the index of the last exception whose parameters might have changed
      */
-    virtual void copyParametersToContext(ContextImpl& context, const NonbondedForce& force) = 0;
+    virtual void copyParametersToContext(ContextImpl& context, const NonbondedForce& force, int firstParticle, int lastParticle, int firstException, int lastException) = 0;
     /**
      * Get the parameters being used for PME.
      *
@@ -756,6 +854,18 @@ public:
      * @param force      the CustomExternalForce to copy the parameters from
      */
     virtual void copyParametersToContext(ContextImpl& context, const CustomExternalForce& force) = 0;
+    /**
+     * Copy changed parameters for a subset of particles over to a context.  The default implementation
+     * simply copies the full parameter set.  Platforms can override this to transfer only the listed
+     * particle terms.
+     *
+     * @param context    the context to copy parameters to
+     * @param force      the CustomExternalForce to copy the parameters from
+     * @param particles  the indices within the force of the particle terms whose parameters have changed
+     */
+    virtual void copyParametersToContext(ContextImpl& context, const CustomExternalForce& force, const std::vector<int>& particles) {
+        copyParametersToContext(context, force);
+    }
 };
 
 /**
@@ -868,6 +978,43 @@ public:
     virtual void copyParametersToContext(ContextImpl& context, const CustomCompoundBondForce& force) = 0;
 };
 
+/**
+ * This kernel is invoked by CustomCVForce to calculate the forces acting on the system and the energy of the system.
+ */
+class CalcCustomCVForceKernel : public KernelImpl {
+public:
+    static std::string Name() {
+        return "CalcCustomCVForce";
+    }
+    CalcCustomCVForceKernel(std::string name, const Platform& platform) : KernelImpl(name, platform) {
+    }
+    /**
+     * Initialize the kernel.
+     *
+     * @param system        the System this kernel will be applied to
+     * @param force         the CustomCVForce this kernel will be used for
+     * @param innerContext  the context created by the CustomCVForce for computing collective variables
+     */
+    virtual void initialize(const System& system, const CustomCVForce& force, ContextImpl& innerContext) = 0;
+    /**
+     * Execute the kernel to calculate the forces and/or energy.
+     *
+     * @param context        the context in which to execute this kernel
+     * @param innerContext   the context created by the CustomCVForce for computing collective variables
+     * @param includeForces  true if forces should be calculated
+     * @param includeEnergy  true if the energy should be calculated
+     * @return the potential energy due to the force
+     */
+    virtual double execute(ContextImpl& context, ContextImpl& innerContext, bool includeForces, bool includeEnergy) = 0;
+    /**
+     * Copy state information to the inner context.
+     *
+     * @param context        the context in which to execute this kernel
+     * @param innerContext   the context created by the CustomCVForce for computing collective variables
+     */
+    virtual void copyState(ContextImpl& context, ContextImpl& innerContext) = 0;
+};
+
 /**
  * This kernel is invoked by CustomManyParticleForce to calculate the forces acting on the system and the energy of the system.
  */
@@ -1009,6 +1156,39 @@ public:
     virtual double computeKineticEnergy(ContextImpl& context, const LangevinIntegrator& integrator) = 0;
 };
 
+/**
+ * This kernel is invoked by LangevinMiddleIntegrator to take one time step.
+ */
+class IntegrateLangevinMiddleStepKernel : public KernelImpl {
+public:
+    static std::string Name() {
+        return "IntegrateLangevinMiddleStep";
+    }
+    IntegrateLangevinMiddleStepKernel(std::string name, const Platform& platform) : KernelImpl(name, platform) {
+    }
+    /**
+     * Initialize the kernel.
+     *
+     * @param system     the System this kernel will be applied to
+     * @param integrator the LangevinMiddleIntegrator this kernel will be used for
+     */
+    virtual void initialize(const System& system, const LangevinMiddleIntegrator& integrator) = 0;
+    /**
+     * Execute the kernel.
+     *
+     * @param context    the context in which to execute this kernel
+     * @param integrator the LangevinMiddleIntegrator this kernel is being used for
+     */
+    virtual void execute(ContextImpl& context, const LangevinMiddleIntegrator& integrator) = 0;
+    /**
+     * Compute the kinetic energy.
+     *
+     * @param context    the context in which to execute this kernel
+     * @param integrator the LangevinMiddleIntegrator this kernel is being used for
+     */
+    virtual double computeKineticEnergy(ContextImpl& context, const LangevinMiddleIntegrator& integrator) = 0;
+};
+
 /**
  * This kernel is invoked by BrownianIntegrator to take one time step.
  */
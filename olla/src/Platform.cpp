@@ -137,11 +137,17 @@ vector<Platform*>& Platform::getPlatforms() {
     return platforms;
 }
 
+vector<string>& Platform::getPendingPluginFiles() {
+    static vector<string> pendingPluginFiles;
+    return pendingPluginFiles;
+}
+
 void Platform::registerPlatform(Platform* platform) {
     getPlatforms().push_back(platform);
 }
 
 int Platform::getNumPlatforms() {
+    loadPendingPlugins();
     return getPlatforms().size();
 }
 
@@ -153,6 +159,7 @@ Platform& Platform::getPlatform(int index) {
 }
 
 std::vector<std::string> Platform::getPluginLoadFailures() {
+  loadPendingPlugins();
   return pluginLoadFailures;
 }
 
@@ -164,6 +171,7 @@ Platform& Platform::getPlatformByName(const string& name) {
 }
 
 Platform& Platform::findPlatform(const vector<string>& kernelNames) {
+    loadPendingPlugins();
     Platform* best = 0;
     vector<Platform*>& platforms = getPlatforms();
     double speed = 0.0;
@@ -237,6 +245,33 @@ static void initializePlugins(vector<void*>& plugins) {
 }
 #endif
 
+void Platform::loadPendingPlugins() {
+    // Libraries found by loadPluginsFromDirectory() are not loaded until the first time a
+    // Platform is requested.  The guard prevents recursion, since a plugin's initializer
+    // may itself query the registered Platforms.
+
+    static bool loading = false;
+    if (loading || getPendingPluginFiles().empty())
+        return;
+    loading = true;
+    vector<string> files;
+    files.swap(getPendingPluginFiles());
+#ifdef WIN32
+    vector<HMODULE> plugins;
+#else
+    vector<void*> plugins;
+#endif
+    for (unsigned int i = 0; i < files.size(); ++i) {
+        try {
+            plugins.push_back(loadOneLibrary(files[i]));
+        } catch (OpenMMException& ex) {
+            pluginLoadFailures.push_back(ex.what());
+        }
+    }
+    initializePlugins(plugins);
+    loading = false;
+}
+
 void Platform::loadPluginLibrary(const string& file) {
 #ifdef WIN32
     vector<HMODULE> plugins;
@@ -262,7 +297,6 @@ vector<string> Platform::loadPluginsFromDirectory(const string& directory) {
         } while (FindNextFile(findHandle, &fileInfo));
         FindClose(findHandle);
     }
-    vector<HMODULE> plugins;
 #else
     dirSeparator = '/';
     DIR* dir;
@@ -275,22 +309,17 @@ vector<string> Platform::loadPluginsFromDirectory(const string& directory) {
         }
         closedir(dir);
     }
-    vector<void*> plugins;
 #endif
-    vector<string> loadedLibraries;
     pluginLoadFailures.resize(0);
     std::sort (files.begin(), files.end(), stringLengthComparator);
 
-    for (unsigned int i = 0; i < files.size(); ++i) {
-        try {
-            plugins.push_back(loadOneLibrary(directory+dirSeparator+files[i]));
-            loadedLibraries.push_back(files[i]);
-        } catch (OpenMMException& ex) {
-	    pluginLoadFailures.push_back(ex.what());
-        }
-    }
-    initializePlugins(plugins);
-    return loadedLibraries;
+    // Just record the files for now.  They get loaded by loadPendingPlugins() the first
+    // time a Platform is requested, so programs that never create one avoid the cost of
+    // loading the libraries and everything they depend on.
+
+    for (unsigned int i = 0; i < files.size(); ++i)
+        getPendingPluginFiles().push_back(directory+dirSeparator+files[i]);
+    return files;
 }
 
 const string& Platform::getDefaultPluginsDirectory() {
@@ -33,6 +33,7 @@
  * -------------------------------------------------------------------------- */
 
 #include "openmm/AndersenThermostat.h"
+#include "openmm/BinaryTrajectoryWriter.h"
 #include "openmm/BrownianIntegrator.h"
 #include "openmm/CMAPTorsionForce.h"
 #include "openmm/CMMotionRemover.h"
@@ -40,6 +41,7 @@
 #include "openmm/CustomBondForce.h"
 #include "openmm/CustomCentroidBondForce.h"
 #include "openmm/CustomCompoundBondForce.h"
+#include "openmm/CustomCVForce.h"
 #include "openmm/CustomAngleForce.h"
 #include "openmm/CustomTorsionForce.h"
 #include "openmm/CustomExternalForce.h"
@@ -48,6 +50,7 @@
 #include "openmm/CustomIntegrator.h"
 #include "openmm/CustomManyParticleForce.h"
 #include "openmm/CustomNonbondedForce.h"
+#include "openmm/DCDTrajectoryWriter.h"
 #include "openmm/Force.h"
 #include "openmm/GayBerneForce.h"
 #include "openmm/GBSAOBCForce.h"
@@ -55,7 +58,9 @@
 #include "openmm/HarmonicBondForce.h"
 #include "openmm/Integrator.h"
 #include "openmm/LangevinIntegrator.h"
+#include "openmm/LangevinMiddleIntegrator.h"
 #include "openmm/LocalEnergyMinimizer.h"
+#include "openmm/MTSIntegrator.h"
 #include "openmm/MonteCarloAnisotropicBarostat.h"
 #include "openmm/MonteCarloBarostat.h"
 #include "openmm/MonteCarloMembraneBarostat.h"
@@ -66,7 +71,9 @@
 #include "openmm/RBTorsionForce.h"
 #include "openmm/State.h"
 #include "openmm/System.h"
+#include "openmm/SystemBatch.h"
 #include "openmm/TabulatedFunction.h"
+#include "openmm/TrajectoryWriter.h"
 #include "openmm/Units.h"
 #include "openmm/VariableLangevinIntegrator.h"
 #include "openmm/VariableVerletIntegrator.h"
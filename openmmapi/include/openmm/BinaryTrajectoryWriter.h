@@ -0,0 +1,69 @@
+#ifndef OPENMM_BINARYTRAJECTORYWRITER_H_
+#define OPENMM_BINARYTRAJECTORYWRITER_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "TrajectoryWriter.h"
+#include "internal/windowsExport.h"
+
+namespace OpenMM {
+
+/**
+ * A TrajectoryWriter that writes frames in a simple binary format.  It records more
+ * information than DCD (times and triclinic box vectors at full precision) and is trivial
+ * to parse, at the cost of not being readable by external tools.
+ *
+ * The file begins with a magic string identifying the format, followed by a 32 bit integer
+ * giving the format version and another giving the number of particles.  Each frame then
+ * consists of the time (a 64 bit float, in ps), the three periodic box vectors (nine 64 bit
+ * floats, in nm), and the position of each particle (three 32 bit floats per particle, in
+ * nm).  All values are stored in the native byte order of the machine that wrote them.
+ */
+
+class OPENMM_EXPORT BinaryTrajectoryWriter : public TrajectoryWriter {
+public:
+    /**
+     * Create a BinaryTrajectoryWriter.
+     *
+     * @param filename   the name of the file to write
+     */
+    BinaryTrajectoryWriter(const std::string& filename);
+protected:
+    void writeHeader(int numParticles);
+    void writeFrameData(double time, const Vec3 periodicBoxVectors[3], const std::vector<Vec3>& positions);
+private:
+    std::vector<float> coords;
+};
+
+} // namespace OpenMM
+
+#endif /*OPENMM_BINARYTRAJECTORYWRITER_H_*/
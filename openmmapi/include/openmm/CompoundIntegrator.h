@@ -113,8 +113,10 @@ public:
      */
     int getCurrentIntegrator() const;
     /**
-     * Set the current Integrator.
-     * 
+     * Set the current Integrator.  All of the Integrators remain bound to the Context at
+     * all times, so this is an inexpensive operation: it simply changes which one is used
+     * for subsequent calls to step().
+     *
      * @param index    the index of the Integrator to use
      */
     void setCurrentIntegrator(int index);
@@ -187,6 +189,12 @@ protected:
      * The implementation calls computeKineticEnergy() on whichever Integrator has been set as current.
      */
     double computeKineticEnergy();
+    /**
+     * Get whether computeKineticEnergy() expects forces to have been computed.
+     *
+     * The implementation calls kineticEnergyRequiresForce() on whichever Integrator has been set as current.
+     */
+    bool kineticEnergyRequiresForce() const;
 private:
     int currentIntegrator;
     std::vector<Integrator*> integrators;
@@ -125,6 +125,38 @@ public:
      * and energies.  Group i will be included if (groups&(1<<i)) != 0.  The default value includes all groups.
      */
     State getState(int types, bool enforcePeriodicBox=false, int groups=0xFFFFFFFF) const;
+    /**
+     * Get the current positions of a subset of the particles.  When only a few positions are
+     * needed, such as for monitoring a reaction coordinate during a simulation, this is much
+     * faster than calling getState(), since platforms can transfer just the requested particles
+     * instead of downloading and converting every position in the system.
+     *
+     * Unlike getState(), the positions are always exactly as stored in the Context: no attempt
+     * is made to translate molecules into the periodic box.
+     *
+     * @param particles  the indices of the particles whose positions are requested
+     * @return the position of each requested particle, in the same order as the indices
+     */
+    std::vector<Vec3> getSelectedPositions(const std::vector<int>& particles) const;
+    /**
+     * Get the current positions of all particles in a quantized fixed point representation.
+     * Each coordinate is rounded to the nearest multiple of the resolution and reported as a
+     * 32 bit integer.  When writing trajectory frames at high frequency, this reduces the
+     * amount of data that must be transferred and stored compared to floating point
+     * coordinates, at a precision loss that is usually negligible for analysis.  On platforms
+     * that store positions on a device, the conversion is performed before the download so
+     * only the smaller representation crosses the bus.
+     *
+     * As with getSelectedPositions(), the positions are exactly as stored in the Context: no
+     * attempt is made to translate molecules into the periodic box.
+     *
+     * @param resolution  the spacing between representable positions (in nm).  For example,
+     * 1e-4 corresponds to 0.001 Angstrom, which is far more precise than the output of most
+     * simulations is meaningful.
+     * @return three integers for each particle, in the order x, y, z.  Multiplying them by
+     * the resolution gives the particle's position in nm.
+     */
+    std::vector<int> getQuantizedPositions(double resolution) const;
     /**
      * Copy information from a State object into this Context.  This restores the Context to
      * approximately the same state it was in when the State was created.  If the State does not include
@@ -222,17 +254,35 @@ public:
      * modified, the Context might not see all of the changes.  Call reinitialize() to force
      * the Context to rebuild its internal representation of the System and pick up any changes
      * that have been made.
-     * 
+     *
      * This is an expensive operation, so you should try to avoid calling it too frequently.
+     *
+     * By default, reinitializing a Context causes all state information (positions, velocities,
+     * etc.) to be discarded.  You can optionally tell it to try to preserve state information.
+     * It does this by internally creating a checkpoint, then reinitializing the Context, then
+     * loading the checkpoint.  Be aware that if the System has changed in a way that would
+     * prevent the checkpoint from being loaded (such as changing the number of particles), this
+     * will cause an exception to be thrown.
+     *
+     * @param preserveState   if true, state information will be restored after reinitializing the
+     *                        Context; otherwise, it will be discarded
      */
-    void reinitialize();
+    void reinitialize(bool preserveState=false);
     /**
      * Create a checkpoint recording the current state of the Context.  This should be treated
      * as an opaque block of binary data.  See loadCheckpoint() for more details.
-     * 
+     *
+     * By default this method does not return until the data has been written to the stream.
+     * If blocking is false, it instead returns as soon as the state has been captured, and the
+     * data is written to the stream on a background thread so the simulation can continue in
+     * the meantime.  In that case the stream must remain valid until the write has finished.
+     * The write is guaranteed to have finished before any later call to createCheckpoint() or
+     * loadCheckpoint() returns, and before the Context is destroyed.
+     *
      * @param stream    an output stream the checkpoint data should be written to
+     * @param blocking  whether to wait for the data to be written before returning
      */
-    void createCheckpoint(std::ostream& stream);
+    void createCheckpoint(std::ostream& stream, bool blocking=true);
     /**
      * Load a checkpoint that was written by createCheckpoint().
      * 
@@ -263,8 +313,12 @@ public:
      */
     const std::vector<std::vector<int> >& getMolecules() const;
 private:
+    friend class CustomCVForceImpl;
     friend class Force;
+    friend class LocalEnergyMinimizer;
+    friend class PMETuner;
     friend class Platform;
+    friend class TrajectoryWriter;
     ContextImpl& getImpl();
     const ContextImpl& getImpl() const;
     ContextImpl* impl;
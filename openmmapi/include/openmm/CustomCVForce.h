@@ -0,0 +1,246 @@
+#ifndef OPENMM_CUSTOMCVFORCE_H_
+#define OPENMM_CUSTOMCVFORCE_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "Force.h"
+#include <string>
+#include <vector>
+#include "internal/windowsExport.h"
+
+namespace OpenMM {
+
+class Context;
+
+/**
+ * This class supports energy functions that depend on collective variables.  To use it,
+ * you define a set of collective variables (scalar valued functions that depend on the
+ * particle positions), and an algebraic expression for the energy as a function of the
+ * collective variables.  The expression also may involve global parameters.
+ *
+ * Each collective variable is defined by a Force object.  The collective variable's value
+ * equals the potential energy that would be computed by that Force.  For example, you might
+ * use a CustomBondForce to define a collective variable equal to the distance between two
+ * particles, or a CustomCentroidBondForce to define one based on the centers of groups of
+ * particles.  The Force objects are added with addCollectiveVariable(), and the
+ * CustomCVForce takes over ownership of them.  This is useful for biased sampling methods
+ * such as umbrella sampling or metadynamics, since the bias can be evaluated without ever
+ * transferring positions or energies back to the host.
+ *
+ * As an example, the following code creates a CustomCVForce that applies a harmonic
+ * restraint to the distance between particles 0 and 1:
+ *
+ * <tt><pre>
+ * CustomCVForce* cv = new CustomCVForce("k*(d-d0)^2");
+ * cv->addGlobalParameter("k", 100.0);
+ * cv->addGlobalParameter("d0", 0.3);
+ * CustomBondForce* distance = new CustomBondForce("r");
+ * distance->addBond(0, 1);
+ * cv->addCollectiveVariable("d", distance);
+ * </pre></tt>
+ *
+ * Expressions may involve the operators + (add), - (subtract), * (multiply), / (divide), and ^ (power), and the following
+ * functions: sqrt, exp, log, sin, cos, sec, csc, tan, cot, asin, acos, atan, sinh, cosh, tanh, erf, erfc, min, max, abs, floor, ceil, step, delta, select.  All trigonometric functions
+ * are defined in radians, and log is the natural logarithm.  step(x) = 0 if x is less than 0, 1 otherwise.  delta(x) = 1 if x is 0, 0 otherwise.
+ * select(x,y,z) = z if x = 0, y otherwise.
+ */
+
+class OPENMM_EXPORT CustomCVForce : public Force {
+public:
+    /**
+     * Create a CustomCVForce.
+     *
+     * @param energy    an algebraic expression giving the energy of the system as a function
+     *                  of the collective variables and global parameters
+     */
+    explicit CustomCVForce(const std::string& energy);
+    ~CustomCVForce();
+    /**
+     * Get the number of collective variables that the force depends on.
+     */
+    int getNumCollectiveVariables() const {
+        return variables.size();
+    }
+    /**
+     * Get the number of global parameters that the force depends on.
+     */
+    int getNumGlobalParameters() const {
+        return globalParameters.size();
+    }
+    /**
+     * Get the algebraic expression that gives the energy of the system
+     */
+    const std::string& getEnergyFunction() const;
+    /**
+     * Set the algebraic expression that gives the energy of the system
+     */
+    void setEnergyFunction(const std::string& energy);
+    /**
+     * Add a collective variable that the force may depend on.  The collective variable
+     * is represented by a Force object, which should have been created on the heap with
+     * the "new" operator.  The CustomCVForce takes over ownership of it, and deletes the
+     * Force when the CustomCVForce itself is deleted.
+     *
+     * @param name      the name of the collective variable, as it will appear in the
+     *                  energy expression
+     * @param variable  the collective variable, represented by a Force object.  The value
+     *                  of the variable is the energy computed by the Force.
+     * @return the index of the variable that was added
+     */
+    int addCollectiveVariable(const std::string& name, Force* variable);
+    /**
+     * Get the name of a collective variable.
+     *
+     * @param index     the index of the variable for which to get the name
+     * @return the variable name
+     */
+    const std::string& getCollectiveVariableName(int index) const;
+    /**
+     * Get a writable reference to the Force object that computes a collective variable.
+     *
+     * @param index     the index of the variable to get
+     */
+    Force& getCollectiveVariable(int index);
+    /**
+     * Get a const reference to the Force object that computes a collective variable.
+     *
+     * @param index     the index of the variable to get
+     */
+    const Force& getCollectiveVariable(int index) const;
+    /**
+     * Add a new global parameter that the force may depend on.
+     *
+     * @param name             the name of the parameter
+     * @param defaultValue     the default value of the parameter
+     * @return the index of the parameter that was added
+     */
+    int addGlobalParameter(const std::string& name, double defaultValue);
+    /**
+     * Get the name of a global parameter.
+     *
+     * @param index     the index of the parameter for which to get the name
+     * @return the parameter name
+     */
+    const std::string& getGlobalParameterName(int index) const;
+    /**
+     * Set the name of a global parameter.
+     *
+     * @param index          the index of the parameter for which to set the name
+     * @param name           the name of the parameter
+     */
+    void setGlobalParameterName(int index, const std::string& name);
+    /**
+     * Get the default value of a global parameter.
+     *
+     * @param index     the index of the parameter for which to get the default value
+     * @return the parameter default value
+     */
+    double getGlobalParameterDefaultValue(int index) const;
+    /**
+     * Set the default value of a global parameter.
+     *
+     * @param index          the index of the parameter for which to set the default value
+     * @param defaultValue   the default value of the parameter
+     */
+    void setGlobalParameterDefaultValue(int index, double defaultValue);
+    /**
+     * Get the current values of the collective variables in a Context.
+     *
+     * @param context        the Context for which to get the values
+     * @param[out] values    the values of the collective variables are computed and
+     *                       stored into this
+     */
+    void getCollectiveVariableValues(Context& context, std::vector<double>& values);
+    /**
+     * Get the inner Context used for evaluating the collective variables.
+     *
+     * When you create a Context for a System that contains a CustomCVForce, internally
+     * it creates a new System, adds the Forces that define the collective variables to
+     * it, creates a new Context for that System, and uses it to evaluate the variables.
+     * In most cases you can ignore all of this.  It is an implementation detail.  However,
+     * there are a few cases where you need to directly access that internal Context.  For
+     * example, if you want to modify one of the Forces that defines a collective variable
+     * and call updateParametersInContext() on it, you need to pass that inner Context to
+     * it.  This method gives you access to it.
+     *
+     * @param context    the Context containing the CustomCVForce
+     * @return the inner Context used to evaluate the collective variables
+     */
+    Context& getInnerContext(Context& context);
+    /**
+     * Returns whether or not this force makes use of periodic boundary
+     * conditions.
+     *
+     * @returns true if any Force defining a collective variable uses periodic boundaries
+     */
+    bool usesPeriodicBoundaryConditions() const;
+protected:
+    ForceImpl* createImpl() const;
+private:
+    class VariableInfo;
+    class GlobalParameterInfo;
+    std::string energyExpression;
+    std::vector<VariableInfo> variables;
+    std::vector<GlobalParameterInfo> globalParameters;
+};
+
+/**
+ * This is an internal class used to record information about a collective variable.
+ * @private
+ */
+class CustomCVForce::VariableInfo {
+public:
+    std::string name;
+    Force* variable;
+    VariableInfo() : variable(NULL) {
+    }
+    VariableInfo(const std::string& name, Force* variable) : name(name), variable(variable) {
+    }
+};
+
+/**
+ * This is an internal class used to record information about a global parameter.
+ * @private
+ */
+class CustomCVForce::GlobalParameterInfo {
+public:
+    std::string name;
+    double defaultValue;
+    GlobalParameterInfo() {
+    }
+    GlobalParameterInfo(const std::string& name, double defaultValue) : name(name), defaultValue(defaultValue) {
+    }
+};
+
+} // namespace OpenMM
+
+#endif /*OPENMM_CUSTOMCVFORCE_H_*/
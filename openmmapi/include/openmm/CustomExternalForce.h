@@ -208,6 +208,17 @@ public:
      * the Context.  Also, this method cannot be used to add new particles, only to change the parameters of existing ones.
      */
     void updateParametersInContext(Context& context);
+    /**
+     * Update the per-particle parameters for a subset of particles in a Context to match those stored
+     * in this Force object.  This works exactly like updateParametersInContext(), except that only the
+     * listed particle terms are copied over to the Context.  When a simulation protocol modifies a few
+     * parameters every step or every few steps, such as moving the anchor point of a restraint in
+     * steered molecular dynamics, this is much faster than re-uploading the full parameter set.
+     *
+     * @param context    the Context in which to update the parameters
+     * @param particles  the indices within this Force of the particle terms whose parameters have changed
+     */
+    void updateSelectedParametersInContext(Context& context, const std::vector<int>& particles);
     /**
      * Returns whether or not this force makes use of periodic boundary
      * conditions.
@@ -0,0 +1,72 @@
+#ifndef OPENMM_DCDTRAJECTORYWRITER_H_
+#define OPENMM_DCDTRAJECTORYWRITER_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "TrajectoryWriter.h"
+#include "internal/windowsExport.h"
+
+namespace OpenMM {
+
+/**
+ * A TrajectoryWriter that writes frames in DCD format, as used by CHARMM, NAMD, and X-PLOR
+ * and understood by most analysis and visualization tools.  Positions are recorded in
+ * angstroms and the periodic unit cell is stored with every frame.
+ */
+
+class OPENMM_EXPORT DCDTrajectoryWriter : public TrajectoryWriter {
+public:
+    /**
+     * Create a DCDTrajectoryWriter.
+     *
+     * @param filename   the name of the file to write
+     * @param timeStep   the time interval between frames, measured in ps.  This is only
+     *                   recorded in the file header; it does not affect what is written.
+     * @param firstStep  the step index of the first frame
+     * @param interval   the number of integration steps between frames
+     */
+    DCDTrajectoryWriter(const std::string& filename, double timeStep, int firstStep=0, int interval=1);
+protected:
+    void writeHeader(int numParticles);
+    void writeFrameData(double time, const Vec3 periodicBoxVectors[3], const std::vector<Vec3>& positions);
+private:
+    void writeInt(int value);
+    void writeFloat(float value);
+    void writeDouble(double value);
+    double timeStep;
+    int firstStep, interval, frameCount;
+    std::vector<float> coords;
+};
+
+} // namespace OpenMM
+
+#endif /*OPENMM_DCDTRAJECTORYWRITER_H_*/
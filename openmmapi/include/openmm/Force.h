@@ -86,6 +86,15 @@ public:
      * @return true if Force uses periodic boundaries or false if it does not
      */
     virtual bool usesPeriodicBoundaryConditions() const;
+    /**
+     * Create a deep copy of this Force.  The caller assumes ownership of the new object.
+     *
+     * The default implementation reconstructs the copy from the SerializationProxy registered
+     * for the class, so it works for any Force that can be serialized with XmlSerializer,
+     * including ones defined by plugins.  Subclasses whose data members can simply be copied
+     * override it to copy them directly, which is much faster for large systems.
+     */
+    virtual Force* copy() const;
 protected:
     friend class ContextImpl;
     /**
@@ -263,6 +263,12 @@ public:
     bool usesPeriodicBoundaryConditions() const {
         return nonbondedMethod == GayBerneForce::CutoffPeriodic;
     }
+    /**
+     * Create a deep copy of this force.  The caller assumes ownership of the new object.
+     */
+    Force* copy() const {
+        return new GayBerneForce(*this);
+    }
 protected:
     ForceImpl* createImpl() const;
 private:
@@ -113,7 +113,14 @@ public:
      *
      * @returns true if force uses PBC and false otherwise
      */
-    bool usesPeriodicBoundaryConditions() const;protected:
+    bool usesPeriodicBoundaryConditions() const;
+    /**
+     * Create a deep copy of this force.  The caller assumes ownership of the new object.
+     */
+    Force* copy() const {
+        return new HarmonicAngleForce(*this);
+    }
+protected:
     ForceImpl* createImpl() const;
 private:
     class AngleInfo;
@@ -69,6 +69,18 @@ public:
      * @return the index of the bond that was added
      */
     int addBond(int particle1, int particle2, double length, double k);
+    /**
+     * Add multiple bond terms to the force field at once.  This is equivalent to calling addBond()
+     * once for each element of the arrays, but is faster when building a large System.  All four
+     * arrays must have the same length.
+     *
+     * @param particle1 the indices of the first particle connected by each bond
+     * @param particle2 the indices of the second particle connected by each bond
+     * @param length    the equilibrium length of each bond, measured in nm
+     * @param k         the harmonic force constant for each bond, measured in kJ/mol/nm^2
+     * @return the index of the first bond that was added
+     */
+    int addBonds(const std::vector<int>& particle1, const std::vector<int>& particle2, const std::vector<double>& length, const std::vector<double>& k);
     /**
      * Get the force field parameters for a bond term.
      *
@@ -111,6 +123,12 @@ public:
      * @returns true if force uses PBC and false otherwise
      */
     bool usesPeriodicBoundaryConditions() const;
+    /**
+     * Create a deep copy of this force.  The caller assumes ownership of the new object.
+     */
+    Force* copy() const {
+        return new HarmonicBondForce(*this);
+    }
 protected:
     ForceImpl* createImpl() const;
 private:
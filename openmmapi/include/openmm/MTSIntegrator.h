@@ -0,0 +1,94 @@
+#ifndef OPENMM_MTSINTEGRATOR_H_
+#define OPENMM_MTSINTEGRATOR_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2017 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CustomIntegrator.h"
+#include "internal/windowsExport.h"
+#include <utility>
+#include <vector>
+
+namespace OpenMM {
+
+/**
+ * This is an Integrator that implements the rRESPA multiple time step algorithm.  It evaluates
+ * different force groups at different frequencies, allowing expensive, slowly varying forces
+ * (such as the reciprocal space part of PME) to be computed less often than cheap, quickly
+ * varying ones.
+ *
+ * To use it, assign each Force in your System to a force group, then specify how often each
+ * group should be evaluated.  The frequencies are given as a list of (force group, substeps)
+ * pairs, where "substeps" is the number of times that group should be evaluated in each time
+ * step.  For example,
+ *
+ * <tt><pre>
+ * vector<pair<int, int> > groups;
+ * groups.push_back(make_pair(0, 4));
+ * groups.push_back(make_pair(1, 1));
+ * MTSIntegrator integrator(0.004, groups);
+ * </pre></tt>
+ *
+ * evaluates the forces in group 0 four times per 4 fs time step (every 1 fs), and the forces
+ * in group 1 once per time step.  The number of substeps for each group must be a multiple of
+ * the number for the previous (less frequently evaluated) group.
+ *
+ * This Integrator supports constraints.  They are enforced at the innermost time step, so the
+ * fastest varying forces should be placed in the most frequently evaluated group.
+ */
+
+class OPENMM_EXPORT MTSIntegrator : public CustomIntegrator {
+public:
+    /**
+     * Create an MTSIntegrator.
+     *
+     * @param stepSize the largest (outermost) step size with which to integrate the system (in picoseconds)
+     * @param groups   a list of (force group, substeps) pairs specifying how often each force
+     *                 group should be evaluated
+     */
+    MTSIntegrator(double stepSize, const std::vector<std::pair<int, int> >& groups);
+    /**
+     * Get the list of (force group, substeps) pairs that was used to construct this integrator.
+     */
+    const std::vector<std::pair<int, int> >& getGroups() const {
+        return groups;
+    }
+private:
+    /**
+     * Recursively construct the computations for one level of the rRESPA hierarchy.
+     */
+    void createSubsteps(int parentSubsteps, const std::vector<std::pair<int, int> >& groups);
+    std::vector<std::pair<int, int> > groups;
+};
+
+} // namespace OpenMM
+
+#endif /*OPENMM_MTSINTEGRATOR_H_*/
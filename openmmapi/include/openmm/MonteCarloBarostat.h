@@ -149,6 +149,12 @@ public:
     bool usesPeriodicBoundaryConditions() const {
         return false;
     }
+    /**
+     * Create a deep copy of this force.  The caller assumes ownership of the new object.
+     */
+    Force* copy() const {
+        return new MonteCarloBarostat(*this);
+    }
 protected:
     ForceImpl* createImpl() const;
 private:
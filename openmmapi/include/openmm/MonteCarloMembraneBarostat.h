@@ -246,6 +246,12 @@ public:
     bool usesPeriodicBoundaryConditions() const {
         return false;
     }
+    /**
+     * Create a deep copy of this force.  The caller assumes ownership of the new object.
+     */
+    Force* copy() const {
+        return new MonteCarloMembraneBarostat(*this);
+    }
 protected:
     ForceImpl* createImpl() const;
 private:
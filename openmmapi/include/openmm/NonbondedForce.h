@@ -75,7 +75,9 @@ namespace OpenMM {
  * Another optional feature of this class (enabled by default) is to add a contribution to the energy which approximates
  * the effect of all Lennard-Jones interactions beyond the cutoff in a periodic system.  When running a simulation
  * at constant pressure, this can improve the quality of the result.  Call setUseDispersionCorrection() to set whether
- * this should be used.
+ * this should be used.  Because the correction assumes the system is homogeneous and isotropic, it is inaccurate for
+ * inhomogeneous systems such as interfaces and membranes.  In that case, consider using the LJPME method instead,
+ * which computes the long range dispersion interaction exactly in reciprocal space rather than approximating it.
  */
 
 class OPENMM_EXPORT NonbondedForce : public Force {
@@ -281,6 +283,17 @@ public:
      * @return the index of the particle that was added
      */
     int addParticle(double charge, double sigma, double epsilon);
+    /**
+     * Add the nonbonded force parameters for multiple particles at once.  This is equivalent to
+     * calling addParticle() once for each element of the arrays, but is faster when building a
+     * large System.  All three arrays must have the same length.
+     *
+     * @param charges    the charges of the particles, measured in units of the proton charge
+     * @param sigmas     the sigma parameters of the Lennard-Jones potential, measured in nm
+     * @param epsilons   the epsilon parameters of the Lennard-Jones potential, measured in kJ/mol
+     * @return the index of the first particle that was added
+     */
+    int addParticles(const std::vector<double>& charges, const std::vector<double>& sigmas, const std::vector<double>& epsilons);
     /**
      * Get the nonbonded force parameters for a particle.
      *
@@ -401,6 +414,10 @@ public:
      * changed by reinitializing the Context.  Furthermore, only the chargeProd, sigma, and epsilon values of an exception
      * can be changed; the pair of particles involved in the exception cannot change.  Finally, this method cannot be used
      * to add new particles or exceptions, only to change the parameters of existing ones.
+     *
+     * This object keeps track of which parameters have changed since the last time this method was called, and only the
+     * changed parameters are copied over.  That makes it much faster when only a small fraction of the particles have
+     * been modified.
      */
     void updateParametersInContext(Context& context);
     /**
@@ -415,15 +432,24 @@ public:
                nonbondedMethod == NonbondedForce::PME ||
                nonbondedMethod == NonbondedForce::LJPME;
     }
+    /**
+     * Create a deep copy of this force.  The caller assumes ownership of the new object.
+     */
+    Force* copy() const {
+        return new NonbondedForce(*this);
+    }
 protected:
     ForceImpl* createImpl() const;
 private:
+    friend class NonbondedForceImpl;
     class ParticleInfo;
     class ExceptionInfo;
     NonbondedMethod nonbondedMethod;
     double cutoffDistance, switchingDistance, rfDielectric, ewaldErrorTol, alpha, dalpha;
     bool useSwitchingFunction, useDispersionCorrection;
     int recipForceGroup, nx, ny, nz, dnx, dny, dnz;
+    int firstChangedParticle, lastChangedParticle, firstChangedException, lastChangedException;
+    mutable int numContexts;
     void addExclusionsToSet(const std::vector<std::set<int> >& bonded12, std::set<int>& exclusions, int baseParticle, int fromParticle, int currentLevel) const;
     std::vector<ParticleInfo> particles;
     std::vector<ExceptionInfo> exceptions;
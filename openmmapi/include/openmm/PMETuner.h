@@ -0,0 +1,73 @@
+#ifndef OPENMM_PMETUNER_H_
+#define OPENMM_PMETUNER_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2010-2018 Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "Context.h"
+#include "NonbondedForce.h"
+
+namespace OpenMM {
+
+/**
+ * Given a Context whose NonbondedForce uses PME, this class searches for the combination of
+ * cutoff distance, Ewald alpha, and grid size that evaluates forces fastest on the current
+ * hardware.  The standard parameters derived from the error tolerance balance accuracy, not
+ * the relative speed of the direct space kernel and the FFT, and the wall time optimum can
+ * differ substantially between devices.
+ *
+ * The search scans a range of cutoff distances at constant Coulomb accuracy: for each candidate
+ * the alpha and grid size are rederived from the Ewald error tolerance, a short series of force
+ * evaluations is timed, and the fastest combination is applied to the Context.  The cutoff is
+ * only ever increased from the value specified by the NonbondedForce, so Lennard-Jones
+ * interactions are computed to a larger distance than requested, never a smaller one.
+ */
+
+class OPENMM_EXPORT PMETuner {
+public:
+    /**
+     * Search for the PME parameters that evaluate forces fastest, and apply them to the Context.
+     *
+     * @param context     a Context whose System contains the NonbondedForce
+     * @param force       the NonbondedForce to tune.  It must use PME or LJPME, and must not
+     *                    specify explicit PME parameters.
+     * @param maxScale    the largest factor by which to increase the cutoff distance during the
+     *                    scan.  The default value is 1.5.
+     * @param iterations  the number of force evaluations to time for each candidate.  The
+     *                    default value is 20.
+     * @return the cutoff distance that was selected and applied
+     */
+    static double tune(Context& context, NonbondedForce& force, double maxScale = 1.5, int iterations = 20);
+};
+
+} // namespace OpenMM
+
+#endif /*OPENMM_PMETUNER_H_*/
@@ -120,6 +120,12 @@ public:
      * @returns true if force uses PBC and false otherwise
      */
     bool usesPeriodicBoundaryConditions() const;
+    /**
+     * Create a deep copy of this force.  The caller assumes ownership of the new object.
+     */
+    Force* copy() const {
+        return new PeriodicTorsionForce(*this);
+    }
 protected:
     ForceImpl* createImpl() const;
 private:
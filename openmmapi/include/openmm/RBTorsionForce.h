@@ -129,6 +129,12 @@ public:
      * @returns true if force uses PBC and false otherwise
      */
     bool usesPeriodicBoundaryConditions() const;
+    /**
+     * Create a deep copy of this force.  The caller assumes ownership of the new object.
+     */
+    Force* copy() const {
+        return new RBTorsionForce(*this);
+    }
 protected:
     ForceImpl* createImpl() const;
 private:
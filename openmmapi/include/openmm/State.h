@@ -58,7 +58,7 @@ public:
      * This is an enumeration of the types of data which may be stored in a State.  When you create
      * a State, use these values to specify which data types it should contain.
      */
-    enum DataType {Positions=1, Velocities=2, Forces=4, Energy=8, Parameters=16, ParameterDerivatives=32};
+    enum DataType {Positions=1, Velocities=2, Forces=4, Energy=8, Parameters=16, ParameterDerivatives=32, GroupEnergies=64};
     /**
      * Construct an empty State containing no data.  This exists so State objects can be used in STL containers.
      */
@@ -119,17 +119,27 @@ public:
      * If this State does not contain parameter derivatives, this will throw an exception.
      */
     const std::map<std::string, double>& getEnergyParameterDerivatives() const;
+    /**
+     * Get a map whose keys are the force groups defined in the System and whose values are the
+     * potential energy of each group (in kJ/mol).  On most platforms all of the energies are
+     * computed in a single evaluation, so requesting this is far cheaper than creating one
+     * State per force group.
+     *
+     * If this State does not contain energies by force group, this will throw an exception.
+     */
+    const std::map<int, double>& getEnergiesByForceGroup() const;
     /**
      * Get which data types are stored in this State.  The return value is a sum of DataType flags.
      */
     int getDataTypes() const;
 private:
     State(double time);
-    void setPositions(const std::vector<Vec3>& pos);
-    void setVelocities(const std::vector<Vec3>& vel);
-    void setForces(const std::vector<Vec3>& force);
-    void setParameters(const std::map<std::string, double>& params);
-    void setEnergyParameterDerivatives(const std::map<std::string, double>& derivs);
+    void setPositions(std::vector<Vec3>& pos);
+    void setVelocities(std::vector<Vec3>& vel);
+    void setForces(std::vector<Vec3>& force);
+    void setParameters(std::map<std::string, double>& params);
+    void setEnergyParameterDerivatives(std::map<std::string, double>& derivs);
+    void setEnergiesByForceGroup(std::map<int, double>& energies);
     void setEnergy(double ke, double pe);
     void setPeriodicBoxVectors(const Vec3& a, const Vec3& b, const Vec3& c);
     int types;
@@ -139,6 +149,7 @@ private:
     std::vector<Vec3> forces;
     Vec3 periodicBoxVectors[3];
     std::map<std::string, double> parameters, energyParameterDerivatives;
+    std::map<int, double> groupEnergies;
 };
 
 /**
@@ -149,12 +160,22 @@ private:
 class OPENMM_EXPORT State::StateBuilder {
 public:
     StateBuilder(double time);
+    /**
+     * Get the State that has been built.  To avoid copying the data, this transfers it
+     * out of the builder, so this may only be called once.
+     */
     State getState();
-    void setPositions(const std::vector<Vec3>& pos);
-    void setVelocities(const std::vector<Vec3>& vel);
-    void setForces(const std::vector<Vec3>& force);
-    void setParameters(const std::map<std::string, double>& params);
-    void setEnergyParameterDerivatives(const std::map<std::string, double>& params);
+    /**
+     * The following methods take over the contents of the vector or map that is passed
+     * to them, leaving it empty, so that building a State does not require copying the
+     * data a second time.
+     */
+    void setPositions(std::vector<Vec3>& pos);
+    void setVelocities(std::vector<Vec3>& vel);
+    void setForces(std::vector<Vec3>& force);
+    void setParameters(std::map<std::string, double>& params);
+    void setEnergyParameterDerivatives(std::map<std::string, double>& params);
+    void setEnergiesByForceGroup(std::map<int, double>& energies);
     void setEnergy(double ke, double pe);
     void setPeriodicBoxVectors(const Vec3& a, const Vec3& b, const Vec3& c);
 private:
@@ -69,7 +69,18 @@ public:
      * Create a new System.
      */
     System();
+    /**
+     * Create a deep copy of another System, including copies of all the Forces
+     * and virtual sites it contains.  This is much faster than serializing the
+     * System and deserializing it again.
+     */
+    System(const System& other);
     ~System();
+    /**
+     * Replace the contents of this System with a deep copy of another one, including
+     * copies of all the Forces and virtual sites it contains.
+     */
+    System& operator=(const System& other);
     /**
      * Get the number of particles in this System.
      */
@@ -89,6 +100,17 @@ public:
         masses.push_back(mass);
         return masses.size()-1;
     }
+    /**
+     * Add multiple particles to the System at once.  This is equivalent to calling addParticle()
+     * once for each element of the array, but is faster when building a large System.
+     *
+     * @param particleMasses   the masses of the particles (in atomic mass units)
+     * @return the index of the first particle that was added
+     */
+    int addParticles(const std::vector<double>& particleMasses) {
+        masses.insert(masses.end(), particleMasses.begin(), particleMasses.end());
+        return masses.size()-particleMasses.size();
+    }
     /**
      * Get the mass (in atomic mass units) of a particle.  If the mass is 0, Integrators will ignore
      * the particle and not modify its position or velocity.  This is most often
@@ -0,0 +1,187 @@
+#ifndef OPENMM_SYSTEMBATCH_H_
+#define OPENMM_SYSTEMBATCH_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "openmm/State.h"
+#include "openmm/System.h"
+#include "openmm/Vec3.h"
+#include <vector>
+#include "internal/windowsExport.h"
+
+namespace OpenMM {
+
+class Context;
+class GBSAOBCForce;
+class HarmonicAngleForce;
+class HarmonicBondForce;
+class NonbondedForce;
+class PeriodicTorsionForce;
+class RBTorsionForce;
+
+/**
+ * This class combines many small, independent Systems into a single larger System so they
+ * can all be simulated by one Context.  Creating a separate Context for every system wastes
+ * most of the capacity of a GPU when the systems are small, and serializes the work of
+ * launching kernels and retrieving States.  Running them together in one Context keeps the
+ * device fully occupied and amortizes all of the per-step overhead across the whole batch.
+ *
+ * Call addSystem() once for each System to include in the batch, then create a Context for
+ * the System returned by getCombinedSystem().  The systems are kept from interacting with
+ * each other by placing them on a cubic lattice: each one is translated by getOffset(), and
+ * as long as the lattice spacing exceeds the size of the largest system plus the nonbonded
+ * cutoff distance, no pair of particles in different systems ever comes within the cutoff
+ * of each other.  The neighbor list therefore never produces interactions between systems.
+ * setPositions() applies the offsets for you and verifies the spacing is large enough, and
+ * getPositions(), getVelocities(), and getForces() extract the values for a single system
+ * from a State of the combined Context.
+ *
+ * Because the systems must be isolated by distance, they cannot use periodic boundary
+ * conditions: every NonbondedForce and GBSAOBCForce must use CutoffNonPeriodic as its
+ * nonbonded method, and those settings must be identical in every system so they can be
+ * merged into a single Force.  HarmonicBondForce, HarmonicAngleForce, PeriodicTorsionForce,
+ * RBTorsionForce, and constraints are merged with their particle indices offset.  Any
+ * CMMotionRemover is skipped, since removing the center of mass motion of the whole batch
+ * would couple the systems together.  Adding a System that contains any other kind of Force
+ * or any virtual sites throws an exception.
+ *
+ * The potential and kinetic energies reported in a State are totals for the entire batch;
+ * to monitor the energy of one system, place its Forces in a dedicated force group before
+ * adding it.
+ */
+
+class OPENMM_EXPORT SystemBatch {
+public:
+    /**
+     * Create a SystemBatch.
+     *
+     * @param spacing  the distance between lattice points on which the systems are placed.
+     *                 This must be greater than the diameter of the largest system plus the
+     *                 nonbonded cutoff distance, or systems will interact with each other.
+     */
+    SystemBatch(double spacing);
+    /**
+     * Add a System to the batch.  Its particles, constraints, and Forces are copied into the
+     * combined System, so later changes to it have no effect on the batch.
+     *
+     * @param system  the System to add
+     * @return the index of the system within the batch
+     */
+    int addSystem(const System& system);
+    /**
+     * Get the number of systems that have been added to the batch.
+     */
+    int getNumSystems() const;
+    /**
+     * Get the combined System containing all of the systems in the batch.  Create the
+     * Context used to simulate the batch from this System.
+     */
+    System& getCombinedSystem();
+    /**
+     * Get the combined System containing all of the systems in the batch.
+     */
+    const System& getCombinedSystem() const;
+    /**
+     * Get the index within the combined System of the first particle of a system.
+     *
+     * @param index  the index of the system within the batch
+     */
+    int getFirstParticle(int index) const;
+    /**
+     * Get the number of particles in a system.
+     *
+     * @param index  the index of the system within the batch
+     */
+    int getNumParticles(int index) const;
+    /**
+     * Get the translation applied to the positions of a system to place it on the lattice.
+     * The offsets are defined by the number of systems in the batch, so do not rely on them
+     * until every system has been added.
+     *
+     * @param index  the index of the system within the batch
+     */
+    Vec3 getOffset(int index) const;
+    /**
+     * Set the positions of every particle in a Context created from the combined System.
+     * Each system's positions are translated by its offset.  This throws an exception if
+     * any system is too large for the lattice spacing to keep it isolated from its
+     * neighbors.
+     *
+     * @param context    the Context in which to set positions
+     * @param positions  the positions of the particles of each system, in the order the
+     *                   systems were added
+     */
+    void setPositions(Context& context, const std::vector<std::vector<Vec3> >& positions) const;
+    /**
+     * Get the positions of the particles of one system from a State of the combined
+     * Context, with the system's offset removed.  The State must have been created with
+     * the Positions data type.
+     *
+     * @param state           the State to extract positions from
+     * @param index           the index of the system within the batch
+     * @param[out] positions  the positions of the system's particles
+     */
+    void getPositions(const State& state, int index, std::vector<Vec3>& positions) const;
+    /**
+     * Get the velocities of the particles of one system from a State of the combined
+     * Context.  The State must have been created with the Velocities data type.
+     *
+     * @param state            the State to extract velocities from
+     * @param index            the index of the system within the batch
+     * @param[out] velocities  the velocities of the system's particles
+     */
+    void getVelocities(const State& state, int index, std::vector<Vec3>& velocities) const;
+    /**
+     * Get the forces on the particles of one system from a State of the combined Context.
+     * The State must have been created with the Forces data type.
+     *
+     * @param state        the State to extract forces from
+     * @param index        the index of the system within the batch
+     * @param[out] forces  the forces on the system's particles
+     */
+    void getForces(const State& state, int index, std::vector<Vec3>& forces) const;
+private:
+    void addForce(const Force& force, int offset);
+    double spacing;
+    std::vector<int> firstParticle;
+    System combinedSystem;
+    NonbondedForce* nonbonded;
+    GBSAOBCForce* obc;
+    HarmonicBondForce* bonds;
+    HarmonicAngleForce* angles;
+    PeriodicTorsionForce* periodicTorsions;
+    RBTorsionForce* rbTorsions;
+};
+
+} // namespace OpenMM
+
+#endif /*OPENMM_SYSTEMBATCH_H_*/
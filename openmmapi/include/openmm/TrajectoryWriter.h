@@ -0,0 +1,111 @@
+#ifndef OPENMM_TRAJECTORYWRITER_H_
+#define OPENMM_TRAJECTORYWRITER_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "Context.h"
+#include "Vec3.h"
+#include "internal/windowsExport.h"
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace OpenMM {
+
+/**
+ * A TrajectoryWriter records the positions of all particles to a file at intervals during a
+ * simulation.  It is an abstract class; subclasses define particular file formats.
+ *
+ * Writing a frame is designed to interfere with the simulation as little as possible.  The
+ * positions are retrieved through the asynchronous download path, so the transfer overlaps
+ * with other work, and the actual file output happens on a background thread.  Two frames
+ * alternate between a pair of buffers, so as long as a frame can be written to disk in less
+ * time than the simulation takes to reach the next one, calling writeFrame() costs little
+ * more than the position download itself.
+ */
+
+class OPENMM_EXPORT TrajectoryWriter {
+public:
+    /**
+     * Create a TrajectoryWriter.  The file is created immediately, replacing any existing
+     * file with the same name.
+     *
+     * @param filename   the name of the file to write
+     */
+    TrajectoryWriter(const std::string& filename);
+    virtual ~TrajectoryWriter();
+    /**
+     * Record the current positions of all particles in the Context as a new frame.  This
+     * queues the frame to be written on a background thread and returns.  If the previous
+     * frame has not yet been fully written, this blocks until it has.
+     *
+     * @param context    the Context whose positions should be recorded
+     */
+    void writeFrame(Context& context);
+    /**
+     * Block until every frame passed to writeFrame() has been written to the file.
+     */
+    void flush();
+protected:
+    /**
+     * Write the file header.  This is called once, on the first call to writeFrame().
+     *
+     * @param numParticles   the number of particles in the System
+     */
+    virtual void writeHeader(int numParticles) = 0;
+    /**
+     * Write a single frame.  This is called on the background thread, so it must not access
+     * the Context.
+     *
+     * @param time                the time the frame corresponds to, measured in ps
+     * @param periodicBoxVectors  the vectors defining the periodic box
+     * @param positions           the position of each particle
+     */
+    virtual void writeFrameData(double time, const Vec3 periodicBoxVectors[3], const std::vector<Vec3>& positions) = 0;
+    std::ofstream file;
+private:
+    void threadBody();
+    std::thread workerThread;
+    std::mutex lock;
+    std::condition_variable frameReady, frameWritten;
+    std::vector<Vec3> pendingPositions;
+    Vec3 pendingBoxVectors[3];
+    double pendingTime;
+    bool hasPendingFrame, hasWrittenHeader, isDeleted;
+};
+
+} // namespace OpenMM
+
+#endif /*OPENMM_TRAJECTORYWRITER_H_*/
@@ -35,6 +35,7 @@
 #include "openmm/Kernel.h"
 #include "openmm/Platform.h"
 #include "openmm/Vec3.h"
+#include <future>
 #include <iosfwd>
 #include <map>
 #include <vector>
@@ -95,6 +96,44 @@ public:
      * @param positions  on exit, this contains the particle positions
      */
     void getPositions(std::vector<Vec3>& positions);
+    /**
+     * Get the positions of all particles, translating each molecule so its center lies inside
+     * the first periodic box.  This returns false if the platform cannot do the wrapping
+     * itself, in which case the caller is responsible for it.
+     *
+     * @param positions  on exit, this contains the particle positions
+     * @return true if the positions were retrieved and wrapped, or false if the caller must do it
+     */
+    bool getWrappedPositions(std::vector<Vec3>& positions);
+    /**
+     * Begin copying the positions of all particles to the host.  This may return before the
+     * copy has finished, allowing integration to continue while the data is in transit.  Call
+     * finishGetPositions() to wait for the copy and retrieve the result.  Each call to this
+     * method must be matched by a call to finishGetPositions() before it is called again.
+     */
+    void beginGetPositions();
+    /**
+     * Block until the copy started by beginGetPositions() has finished, and get the positions
+     * it recorded.
+     *
+     * @param positions  on exit, this contains the particle positions
+     */
+    void finishGetPositions(std::vector<Vec3>& positions);
+    /**
+     * Get the positions of a subset of the particles.
+     *
+     * @param particles  the indices of the particles whose positions are requested
+     * @param positions  on exit, this contains the position of each requested particle
+     */
+    void getSelectedPositions(const std::vector<int>& particles, std::vector<Vec3>& positions);
+    /**
+     * Get the positions of all particles in a quantized fixed point representation.
+     *
+     * @param resolution  the spacing between representable positions (in nm)
+     * @param positions   on exit, this contains three integers for each particle.  Multiplying
+     *                    them by the resolution gives the particle's position in nm.
+     */
+    void getQuantizedPositions(double resolution, std::vector<int>& positions);
     /**
      * Set the positions of all particles.
      *
@@ -113,6 +152,15 @@ public:
      * @param velocities  a vector containg the particle velocities
      */
     void setVelocities(const std::vector<Vec3>& velocities);
+    /**
+     * Set the positions and velocities of all particles in a single operation.  On some
+     * platforms this requires fewer synchronizations than calling setPositions() and
+     * setVelocities() separately.
+     *
+     * @param positions   a vector containg the particle positions
+     * @param velocities  a vector containg the particle velocities
+     */
+    void setPositionsAndVelocities(const std::vector<Vec3>& positions, const std::vector<Vec3>& velocities);
     /**
      * Get the current forces on all particles.
      *
@@ -195,6 +243,26 @@ public:
      * @return the potential energy of the system, or 0 if includeEnergy is false
      */
     double calcForcesAndEnergy(bool includeForces, bool includeEnergy, int groups=0xFFFFFFFF);
+    /**
+     * Calculate the potential energy of each force group separately (in kJ/mol).  On platforms
+     * whose CalcForcesAndEnergyKernel supports it, all of the energies are computed in a single
+     * evaluation; otherwise each group is evaluated on its own.
+     *
+     * @param[out] energies  on exit, this contains one entry for each force group defined in the
+     *                       System, mapping the group index to its potential energy
+     * @param groups         a set of bit flags for which force groups to include.  Group i will be
+     *                       included if (groups&(1<<i)) != 0.  The default value includes all groups.
+     */
+    void calcEnergiesByForceGroup(std::map<int, double>& energies, int groups=0xFFFFFFFF);
+    /**
+     * Discard any cached force group energies, and mark the forces stored on the device as
+     * invalid.  This must be called whenever the positions, the periodic box, or anything else
+     * that can affect the potential energy changes, so that subsequent calls to
+     * calcForcesAndEnergy() will not return stale values.  Most changes are made through
+     * methods of this class that call it automatically; it only needs to be called directly
+     * by code that modifies positions at a lower level, such as integration kernels.
+     */
+    void invalidateEnergyCache();
     /**
      * Get the set of force group flags that were passed to the most recent call to calcForcesAndEnergy().
      */
@@ -235,10 +303,17 @@ public:
     const std::vector<std::vector<int> >& getMolecules() const;
     /**
      * Create a checkpoint recording the current state of the Context.
-     * 
+     *
      * @param stream    an output stream the checkpoint data should be written to
+     * @param blocking  if false, the data is written to the stream on a background thread
+     *                  and this method returns as soon as the state has been captured
+     */
+    void createCheckpoint(std::ostream& stream, bool blocking=true);
+    /**
+     * Block until any checkpoint write started by createCheckpoint() with blocking=false
+     * has finished.  If the write failed, this throws the resulting exception.
      */
-    void createCheckpoint(std::ostream& stream);
+    void waitForCheckpointWrite();
     /**
      * Load a checkpoint that was written by createCheckpoint().
      * 
@@ -263,16 +338,19 @@ public:
     static std::vector<std::vector<int> > findMolecules(int numParticles, std::vector<std::vector<int> >& particleBonds);
 private:
     friend class Context;
+    void writeCheckpoint(std::ostream& stream);
     Context& owner;
     const System& system;
     Integrator& integrator;
     std::vector<ForceImpl*> forceImpls;
     std::map<std::string, double> parameters;
     mutable std::vector<std::vector<int> > molecules;
-    bool hasInitializedForces, hasSetPositions, integratorIsDeleted;
+    bool hasInitializedForces, hasSetPositions, integratorIsDeleted, forcesAreValid;
     int lastForceGroups;
+    std::map<int, double> cachedEnergies;
     Platform* platform;
     Kernel initializeForcesKernel, updateStateDataKernel, applyConstraintsKernel, virtualSitesKernel;
+    std::future<void> checkpointWrite;
     void* platformData;
 };
 
@@ -60,6 +60,7 @@ public:
     std::map<std::string, double> getDefaultParameters();
     std::vector<std::string> getKernelNames();
     void updateParametersInContext(ContextImpl& context);
+    void updateParametersInContext(ContextImpl& context, const std::vector<int>& particles);
 private:
     const CustomExternalForce& owner;
     Kernel kernel;
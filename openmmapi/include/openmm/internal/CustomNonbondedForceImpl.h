@@ -39,6 +39,7 @@
 #include <utility>
 #include <map>
 #include <string>
+#include <vector>
 
 namespace OpenMM {
 
@@ -61,12 +62,30 @@ public:
     std::map<std::string, double> getDefaultParameters();
     std::vector<std::string> getKernelNames();
     void updateParametersInContext(ContextImpl& context);
+    /**
+     * This class stores previously computed values of the numerical integrals used in
+     * calculating the long range correction, so that when particle parameters change,
+     * only the integrals involving modified parameter values need to be recomputed
+     * instead of repeating every integration from scratch.
+     */
+    class LongRangeCorrectionData {
+    public:
+        LongRangeCorrectionData() {
+        }
+    private:
+        friend class CustomNonbondedForceImpl;
+        std::map<std::pair<std::vector<double>, std::vector<double> >, std::vector<double> > integrals;
+        std::map<std::string, double> globalParamValues;
+    };
     /**
      * Compute the coefficient which, when divided by the periodic box volume, gives the
      * long range correction to the energy.  If the Force computes parameter derivatives,
-     * also compute the corresponding derivatives of the correction.
+     * also compute the corresponding derivatives of the correction.  The integrals for
+     * different pairs of particle classes are computed in parallel, and any whose values
+     * are already recorded in the LongRangeCorrectionData are reused.  Pass the same data
+     * object on later calls to avoid repeating integrations whose inputs have not changed.
      */
-    static void calcLongRangeCorrection(const CustomNonbondedForce& force, const Context& context, double& coefficient, std::vector<double>& derivatives);
+    static void calcLongRangeCorrection(const CustomNonbondedForce& force, LongRangeCorrectionData& data, const Context& context, double& coefficient, std::vector<double>& derivatives);
 private:
     static double integrateInteraction(Lepton::CompiledExpression& expression, const std::vector<double>& params1, const std::vector<double>& params2,
             const CustomNonbondedForce& force, const Context& context);
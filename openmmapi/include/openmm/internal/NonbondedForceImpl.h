@@ -35,9 +35,11 @@
 #include "ForceImpl.h"
 #include "openmm/NonbondedForce.h"
 #include "openmm/Kernel.h"
+#include <map>
 #include <utility>
 #include <set>
 #include <string>
+#include <vector>
 
 namespace OpenMM {
 
@@ -63,7 +65,7 @@ public:
         return std::map<std::string, double>(); // This force field doesn't define any parameters.
     }
     std::vector<std::string> getKernelNames();
-    void updateParametersInContext(ContextImpl& context);
+    void updateParametersInContext(ContextImpl& context, int firstParticle, int lastParticle, int firstException, int lastException);
     void getPMEParameters(double& alpha, int& nx, int& ny, int& nz) const;
     void getLJPMEParameters(double& alpha, int& nx, int& ny, int& nz) const;
     /**
@@ -81,11 +83,44 @@ public:
      * long range dispersion correction to the energy.
      */
     static double calcDispersionCorrection(const System& system, const NonbondedForce& force);
+    /**
+     * This class stores the intermediate sums used in computing the long range dispersion
+     * correction, so that when particle parameters change the correction can be updated
+     * incrementally instead of being recomputed from scratch.
+     */
+    class LongRangeCorrectionData {
+    public:
+        LongRangeCorrectionData() : sum1(0.0), sum2(0.0), sum3(0.0) {
+        }
+    private:
+        friend class NonbondedForceImpl;
+        std::map<std::pair<double, double>, int> classCounts;
+        std::vector<std::pair<double, double> > particleClass;
+        double sum1, sum2, sum3;
+    };
+    /**
+     * Analyze the particle parameters and record the data needed to compute the long range
+     * dispersion correction.
+     */
+    static LongRangeCorrectionData prepareLongRangeCorrection(const NonbondedForce& force);
+    /**
+     * Update previously prepared data to reflect changes to the parameters of a range of
+     * particles.  The cost is proportional to the number of particle classes whose membership
+     * changed, so this is much faster than preparing the data from scratch when only a few
+     * particles were modified.
+     */
+    static void updateLongRangeCorrection(LongRangeCorrectionData& data, const NonbondedForce& force, int firstParticle, int lastParticle);
+    /**
+     * Compute the dispersion correction coefficient from previously prepared data.
+     */
+    static double calcLongRangeCorrection(const LongRangeCorrectionData& data, const NonbondedForce& force, const System& system);
 private:
     class ErrorFunction;
     class EwaldErrorFunction;
     static int findZero(const ErrorFunction& f, int initialGuess);
     static double evalIntegral(double r, double rs, double rc, double sigma);
+    static void addLongRangeCorrectionTerms(LongRangeCorrectionData& data, const std::pair<double, double>& class1,
+            const std::pair<double, double>& class2, double count, bool useSwitch, double cutoff, double switchDist);
     const NonbondedForce& owner;
     Kernel kernel;
 };
@@ -86,6 +86,40 @@ public:
      * @return the value of the spline's derivative  at the specified point
      */
     static double evaluateSplineDerivative(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& deriv, double t);
+    /**
+     * Evaluate the derivative of a 1D spline at every data point it interpolates.  This produces the same
+     * values as calling evaluateSplineDerivative() at each point, but in linear time with no searching.
+     *
+     * @param x          the values of the independent variable at the data points to interpolate
+     * @param y          the values of the dependent variable at the data points to interpolate
+     * @param deriv      the vector of second derivatives that was calculated by one of the other methods
+     * @param knotDerivs on exit, this contains the derivative of the spline at each of the data points
+     */
+    static void evaluateSplineDerivativesAtKnots(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& deriv, std::vector<double>& knotDerivs);
+    /**
+     * Evaluate a 1D spline when the interval containing the point is already known, for example because
+     * the data points are uniformly spaced.
+     *
+     * @param x     the values of the independent variable at the data points to interpolate
+     * @param y     the values of the dependent variable at the data points to interpolate
+     * @param deriv the vector of second derivatives that was calculated by one of the other methods
+     * @param lower the index of the data point at the lower end of the interval containing the point
+     * @param t     the value of the independent variable at which to evaluate the spline
+     * @return the value of the spline at the specified point
+     */
+    static double evaluateSpline(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& deriv, int lower, double t);
+    /**
+     * Evaluate the derivative of a 1D spline when the interval containing the point is already known,
+     * for example because the data points are uniformly spaced.
+     *
+     * @param x     the values of the independent variable at the data points to interpolate
+     * @param y     the values of the dependent variable at the data points to interpolate
+     * @param deriv the vector of second derivatives that was calculated by one of the other methods
+     * @param lower the index of the data point at the lower end of the interval containing the point
+     * @param t     the value of the independent variable at which to evaluate the spline
+     * @return the value of the spline's derivative  at the specified point
+     */
+    static double evaluateSplineDerivative(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& deriv, int lower, double t);
     /**
      * Fit a natural cubic spline surface f(x,y) to a 2D set of data points.  The resulting spline interpolates all the
      * data points, has a continuous second derivative everywhere, and has a second derivative of 0 at the boundary.
@@ -124,6 +158,37 @@ public:
      * @param dy     on exit, the y derivative of the spline at the specified point
      */
     static void evaluate2DSplineDerivatives(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& values, const std::vector<std::vector<double> >& c, double u, double v, double& dx, double& dy);
+    /**
+     * Evaluate a 2D spline when the patch containing the point is already known, for example because
+     * the data points are uniformly spaced.
+     *
+     * @param x      the values of the first independent variable at the data points to interpolate
+     * @param y      the values of the second independent variable at the data points to interpolate
+     * @param values the values of the dependent variable at the data points to interpolate
+     * @param c      the vector of spline coefficients that was calculated by one of the other methods
+     * @param lowerx the index of the data point at the lower end of the patch along the first axis
+     * @param lowery the index of the data point at the lower end of the patch along the second axis
+     * @param u      the value of the first independent variable at which to evaluate the spline
+     * @param v      the value of the second independent variable at which to evaluate the spline
+     * @return the value of the spline at the specified point
+     */
+    static double evaluate2DSpline(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& values, const std::vector<std::vector<double> >& c, int lowerx, int lowery, double u, double v);
+    /**
+     * Evaluate the derivatives of a 2D spline when the patch containing the point is already known,
+     * for example because the data points are uniformly spaced.
+     *
+     * @param x      the values of the first independent variable at the data points to interpolate
+     * @param y      the values of the second independent variable at the data points to interpolate
+     * @param values the values of the dependent variable at the data points to interpolate
+     * @param c      the vector of spline coefficients that was calculated by one of the other methods
+     * @param lowerx the index of the data point at the lower end of the patch along the first axis
+     * @param lowery the index of the data point at the lower end of the patch along the second axis
+     * @param u      the value of the first independent variable at which to evaluate the spline
+     * @param v      the value of the second independent variable at which to evaluate the spline
+     * @param dx     on exit, the x derivative of the spline at the specified point
+     * @param dy     on exit, the y derivative of the spline at the specified point
+     */
+    static void evaluate2DSplineDerivatives(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& values, const std::vector<std::vector<double> >& c, int lowerx, int lowery, double u, double v, double& dx, double& dy);
     /**
      * Fit a natural cubic spline surface f(x,y,z) to a 3D set of data points.  The resulting spline interpolates all the
      * data points, has a continuous second derivative everywhere, and has a second derivative of 0 at the boundary.
@@ -170,6 +235,44 @@ public:
      * @param dz     on exit, the z derivative of the spline at the specified point
      */
     static void evaluate3DSplineDerivatives(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& z, const std::vector<double>& values, const std::vector<std::vector<double> >& c, double u, double v, double w, double& dx, double& dy, double &dz);
+    /**
+     * Evaluate a 3D spline when the patch containing the point is already known, for example because
+     * the data points are uniformly spaced.
+     *
+     * @param x      the values of the first independent variable at the data points to interpolate
+     * @param y      the values of the second independent variable at the data points to interpolate
+     * @param z      the values of the third independent variable at the data points to interpolate
+     * @param values the values of the dependent variable at the data points to interpolate
+     * @param c      the vector of spline coefficients that was calculated by one of the other methods
+     * @param lowerx the index of the data point at the lower end of the patch along the first axis
+     * @param lowery the index of the data point at the lower end of the patch along the second axis
+     * @param lowerz the index of the data point at the lower end of the patch along the third axis
+     * @param u      the value of the first independent variable at which to evaluate the spline
+     * @param v      the value of the second independent variable at which to evaluate the spline
+     * @param w      the value of the third independent variable at which to evaluate the spline
+     * @return the value of the spline at the specified point
+     */
+    static double evaluate3DSpline(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& z, const std::vector<double>& values, const std::vector<std::vector<double> >& c, int lowerx, int lowery, int lowerz, double u, double v, double w);
+    /**
+     * Evaluate the derivatives of a 3D spline when the patch containing the point is already known,
+     * for example because the data points are uniformly spaced.
+     *
+     * @param x      the values of the first independent variable at the data points to interpolate
+     * @param y      the values of the second independent variable at the data points to interpolate
+     * @param z      the values of the third independent variable at the data points to interpolate
+     * @param values the values of the dependent variable at the data points to interpolate
+     * @param c      the vector of spline coefficients that was calculated by one of the other methods
+     * @param lowerx the index of the data point at the lower end of the patch along the first axis
+     * @param lowery the index of the data point at the lower end of the patch along the second axis
+     * @param lowerz the index of the data point at the lower end of the patch along the third axis
+     * @param u      the value of the first independent variable at which to evaluate the spline
+     * @param v      the value of the second independent variable at which to evaluate the spline
+     * @param w      the value of the third independent variable at which to evaluate the spline
+     * @param dx     on exit, the x derivative of the spline at the specified point
+     * @param dy     on exit, the y derivative of the spline at the specified point
+     * @param dz     on exit, the z derivative of the spline at the specified point
+     */
+    static void evaluate3DSplineDerivatives(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& z, const std::vector<double>& values, const std::vector<std::vector<double> >& c, int lowerx, int lowery, int lowerz, double u, double v, double w, double& dx, double& dy, double &dz);
 private:
     static void solveTridiagonalMatrix(const std::vector<double>& a, const std::vector<double>& b, const std::vector<double>& c, const std::vector<double>& rhs, std::vector<double>& sol);
 };
@@ -0,0 +1,115 @@
+#ifndef OPENMM_TASK_GRAPH_H_
+#define OPENMM_TASK_GRAPH_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2018 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "openmm/internal/ThreadPool.h"
+#include "windowsExport.h"
+#include <deque>
+#include <functional>
+#include <pthread.h>
+#include <vector>
+
+namespace OpenMM {
+
+/**
+ * A TaskGraph executes a set of interdependent tasks on the worker threads of a ThreadPool.
+ * Unlike calling execute() on the pool directly, which runs a single task on every thread and
+ * then waits at a barrier, a TaskGraph lets independent tasks run concurrently: each worker
+ * thread keeps its own queue of ready tasks and steals work from other threads when its own
+ * queue is empty.  A task becomes ready as soon as all the tasks it depends on have finished,
+ * so there is no global barrier between dependent stages.
+ *
+ * To use it, call addTask() to record each task along with the indices of the tasks it depends
+ * on, then call execute().  execute() blocks until every task has finished and clears the graph
+ * so it can be rebuilt for the next step.
+ */
+class OPENMM_EXPORT TaskGraph {
+public:
+    /**
+     * Create a TaskGraph that runs tasks on the worker threads of a ThreadPool.
+     */
+    TaskGraph(ThreadPool& threads);
+    ~TaskGraph();
+    /**
+     * Add a task with no dependencies to the graph.
+     *
+     * @param task  the function to execute
+     * @return the index of the task, which can be passed as a dependency of later tasks
+     */
+    int addTask(std::function<void ()> task);
+    /**
+     * Add a task to the graph.
+     *
+     * @param task          the function to execute
+     * @param dependencies  the indices of the tasks that must finish before this one can start
+     * @return the index of the task, which can be passed as a dependency of later tasks
+     */
+    int addTask(std::function<void ()> task, const std::vector<int>& dependencies);
+    /**
+     * Get the number of tasks that have been added to the graph.
+     */
+    int getNumTasks() const;
+    /**
+     * Execute all the tasks in the graph, blocking until every one has finished.  The graph is
+     * cleared before this returns.
+     */
+    void execute();
+    /**
+     * This routine contains the code executed by each worker thread.
+     */
+    void runThread(int threadIndex);
+private:
+    class TaskInfo;
+    ThreadPool& threads;
+    std::vector<TaskInfo> tasks;
+    std::vector<std::deque<int> > queues;
+    std::vector<pthread_mutex_t> queueLocks;
+    pthread_mutex_t graphLock;
+    volatile int numCompleted;
+};
+
+/**
+ * This records a single task in the graph.
+ */
+class TaskGraph::TaskInfo {
+public:
+    std::function<void ()> task;
+    std::vector<int> dependents;
+    int remainingDependencies;
+    TaskInfo(std::function<void ()> task) : task(task), remainingDependencies(0) {
+    }
+};
+
+} // namespace OpenMM
+
+#endif // OPENMM_TASK_GRAPH_H_
@@ -51,6 +51,8 @@
       #ifdef __ANDROID__
         #include <cpu-features.h>
       #else
+        #include <stdio.h>
+        #include <string.h>
         #include <unistd.h>
       #endif
    #endif
@@ -87,11 +89,51 @@ static int getNumProcessors() {
 #endif
 }
 
+/**
+ * Get the number of performance cores.  On hybrid CPUs that combine fast and slow
+ * cores, this returns the number of fast ones.  On other CPUs it is the same as
+ * getNumProcessors().  When every thread must synchronize at every time step, running
+ * threads on the slow cores just makes everything wait for them.
+ */
+static int getNumPerformanceCores() {
+#ifdef __APPLE__
+    int ncpu;
+    size_t len = 4;
+    if (sysctlbyname("hw.perflevel0.logicalcpu", &ncpu, &len, NULL, 0) == 0 && ncpu > 0)
+       return ncpu;
+#elif !defined(WIN32) && !defined(__ANDROID__)
+    // On hybrid Intel parts the kernel lists the logical processors of the
+    // performance cores, e.g. "0-7,16-23".
+
+    FILE* file = fopen("/sys/devices/cpu_core/cpus", "r");
+    if (file != NULL) {
+        char buffer[1024];
+        int ncpu = 0;
+        if (fgets(buffer, sizeof(buffer), file) != NULL) {
+            char* range = strtok(buffer, ",");
+            while (range != NULL) {
+                int first, last;
+                if (sscanf(range, "%d-%d", &first, &last) == 2)
+                    ncpu += last-first+1;
+                else if (sscanf(range, "%d", &first) == 1)
+                    ncpu++;
+                range = strtok(NULL, ",");
+            }
+        }
+        fclose(file);
+        if (ncpu > 0)
+            return ncpu;
+    }
+#endif
+    return getNumProcessors();
+}
+
 /**
  * Get a description of the CPU's capabilities.
  */
 #ifdef WIN32
 #define cpuid __cpuid
+#define cpuidex __cpuidex
 #else
 #if !defined(__ANDROID__) && !defined(__PNACL__)
     static void cpuid(int cpuInfo[4], int infoType){
@@ -118,6 +160,36 @@ static int getNumProcessors() {
         );
     #endif
     }
+
+    /**
+     * Query a cpuid leaf that requires a subleaf index in ECX, such as leaf 7.
+     */
+    static void cpuidex(int cpuInfo[4], int infoType, int subleaf){
+    #ifdef __LP64__
+        __asm__ __volatile__ (
+            "cpuid":
+            "=a" (cpuInfo[0]),
+            "=b" (cpuInfo[1]),
+            "=c" (cpuInfo[2]),
+            "=d" (cpuInfo[3]) :
+            "a" (infoType),
+            "c" (subleaf)
+        );
+    #else
+        __asm__ __volatile__ (
+            "pushl %%ebx\n"
+            "cpuid\n"
+            "movl %%ebx, %1\n"
+            "popl %%ebx\n" :
+            "=a" (cpuInfo[0]),
+            "=r" (cpuInfo[1]),
+            "=c" (cpuInfo[2]),
+            "=d" (cpuInfo[3]) :
+            "a" (infoType),
+            "c" (subleaf)
+        );
+    #endif
+    }
     #endif
 #endif
 
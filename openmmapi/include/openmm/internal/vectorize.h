@@ -32,7 +32,7 @@
  * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
  * -------------------------------------------------------------------------- */
         
-#if defined(__ANDROID__)
+#if defined(__ANDROID__) || defined(__ARM_NEON__) || defined(__ARM_NEON)
     #include "vectorize_neon.h"
 #else
     #if defined(__PNACL__)
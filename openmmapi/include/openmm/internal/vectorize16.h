@@ -0,0 +1,252 @@
+#ifndef OPENMM_VECTORIZE16_H_
+#define OPENMM_VECTORIZE16_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2013-2018 Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "vectorize8.h"
+#include <immintrin.h>
+
+// This file defines classes and functions to simplify vectorizing code with AVX-512.
+// Unlike the SSE and AVX types, comparisons produce a 16 bit opmask (__mmask16)
+// rather than another vector, since that is how AVX-512 represents predicates.
+
+class ivec16;
+
+/**
+ * A sixteen element vector of floats.
+ */
+class fvec16 {
+public:
+    __m512 val;
+
+    fvec16() {}
+    fvec16(float v) : val(_mm512_set1_ps(v)) {}
+    fvec16(float v1, float v2, float v3, float v4, float v5, float v6, float v7, float v8,
+           float v9, float v10, float v11, float v12, float v13, float v14, float v15, float v16) :
+        val(_mm512_set_ps(v16, v15, v14, v13, v12, v11, v10, v9, v8, v7, v6, v5, v4, v3, v2, v1)) {}
+    fvec16(__m512 v) : val(v) {}
+    fvec16(const float* v) : val(_mm512_loadu_ps(v)) {}
+    fvec16(const fvec8& lower, const fvec8& upper) :
+        val(_mm512_castpd_ps(_mm512_insertf64x4(_mm512_castps_pd(_mm512_castps256_ps512(lower.val)), _mm256_castps_pd(upper.val), 1))) {}
+    operator __m512() const {
+        return val;
+    }
+    fvec8 lowerVec() const {
+        return _mm512_castps512_ps256(val);
+    }
+    fvec8 upperVec() const {
+        return _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(val), 1));
+    }
+    void store(float* v) const {
+        _mm512_storeu_ps(v, val);
+    }
+    fvec16 operator+(const fvec16& other) const {
+        return _mm512_add_ps(val, other);
+    }
+    fvec16 operator-(const fvec16& other) const {
+        return _mm512_sub_ps(val, other);
+    }
+    fvec16 operator*(const fvec16& other) const {
+        return _mm512_mul_ps(val, other);
+    }
+    fvec16 operator/(const fvec16& other) const {
+        return _mm512_div_ps(val, other);
+    }
+    void operator+=(const fvec16& other) {
+        val = _mm512_add_ps(val, other);
+    }
+    void operator-=(const fvec16& other) {
+        val = _mm512_sub_ps(val, other);
+    }
+    void operator*=(const fvec16& other) {
+        val = _mm512_mul_ps(val, other);
+    }
+    void operator/=(const fvec16& other) {
+        val = _mm512_div_ps(val, other);
+    }
+    fvec16 operator-() const {
+        return _mm512_sub_ps(_mm512_set1_ps(0.0f), val);
+    }
+    __mmask16 operator==(const fvec16& other) const {
+        return _mm512_cmp_ps_mask(val, other, _CMP_EQ_OQ);
+    }
+    __mmask16 operator!=(const fvec16& other) const {
+        return _mm512_cmp_ps_mask(val, other, _CMP_NEQ_OQ);
+    }
+    __mmask16 operator>(const fvec16& other) const {
+        return _mm512_cmp_ps_mask(val, other, _CMP_GT_OQ);
+    }
+    __mmask16 operator<(const fvec16& other) const {
+        return _mm512_cmp_ps_mask(val, other, _CMP_LT_OQ);
+    }
+    __mmask16 operator>=(const fvec16& other) const {
+        return _mm512_cmp_ps_mask(val, other, _CMP_GE_OQ);
+    }
+    __mmask16 operator<=(const fvec16& other) const {
+        return _mm512_cmp_ps_mask(val, other, _CMP_LE_OQ);
+    }
+    operator ivec16() const;
+};
+
+/**
+ * A sixteen element vector of ints.
+ */
+class ivec16 {
+public:
+    __m512i val;
+
+    ivec16() {}
+    ivec16(int v) : val(_mm512_set1_epi32(v)) {}
+    ivec16(__m512i v) : val(v) {}
+    ivec16(const int* v) : val(_mm512_loadu_si512((const void*) v)) {}
+    operator __m512i() const {
+        return val;
+    }
+    void store(int* v) const {
+        _mm512_storeu_si512((void*) v, val);
+    }
+    ivec16 operator+(const ivec16& other) const {
+        return _mm512_add_epi32(val, other);
+    }
+    ivec16 operator&(const ivec16& other) const {
+        return _mm512_and_si512(val, other.val);
+    }
+    ivec16 operator|(const ivec16& other) const {
+        return _mm512_or_si512(val, other.val);
+    }
+    operator fvec16() const;
+};
+
+// Conversion operators.
+
+inline fvec16::operator ivec16() const {
+    return _mm512_cvttps_epi32(val);
+}
+
+inline ivec16::operator fvec16() const {
+    return _mm512_cvtepi32_ps(val);
+}
+
+// Functions that operate on fvec16s.
+
+static inline fvec16 floor(const fvec16& v) {
+    return fvec16(_mm512_roundscale_ps(v.val, 0x09));
+}
+
+static inline fvec16 ceil(const fvec16& v) {
+    return fvec16(_mm512_roundscale_ps(v.val, 0x0A));
+}
+
+static inline fvec16 round(const fvec16& v) {
+    return fvec16(_mm512_roundscale_ps(v.val, 0x08));
+}
+
+static inline fvec16 min(const fvec16& v1, const fvec16& v2) {
+    return fvec16(_mm512_min_ps(v1.val, v2.val));
+}
+
+static inline fvec16 max(const fvec16& v1, const fvec16& v2) {
+    return fvec16(_mm512_max_ps(v1.val, v2.val));
+}
+
+static inline fvec16 abs(const fvec16& v) {
+    return fvec16(_mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(v.val), _mm512_set1_epi32(0x7FFFFFFF))));
+}
+
+static inline fvec16 sqrt(const fvec16& v) {
+    return fvec16(_mm512_sqrt_ps(v.val));
+}
+
+static inline fvec16 rsqrt(const fvec16& v) {
+    // Initial estimate of rsqrt().
+
+    fvec16 y(_mm512_rsqrt14_ps(v.val));
+
+    // Perform an iteration of Newton refinement.
+
+    fvec16 x2 = v*0.5f;
+    y *= fvec16(1.5f)-x2*y*y;
+    return y;
+}
+
+static inline float reduceAdd(const fvec16& v) {
+    return _mm512_reduce_add_ps(v.val);
+}
+
+static inline float dot16(const fvec16& v1, const fvec16& v2) {
+    return _mm512_reduce_add_ps(_mm512_mul_ps(v1.val, v2.val));
+}
+
+static inline void transpose(const fvec4 in[16], fvec16& out1, fvec16& out2, fvec16& out3, fvec16& out4) {
+    fvec8 a1, a2, a3, a4, b1, b2, b3, b4;
+    transpose(in[0], in[1], in[2], in[3], in[4], in[5], in[6], in[7], a1, a2, a3, a4);
+    transpose(in[8], in[9], in[10], in[11], in[12], in[13], in[14], in[15], b1, b2, b3, b4);
+    out1 = fvec16(a1, b1);
+    out2 = fvec16(a2, b2);
+    out3 = fvec16(a3, b3);
+    out4 = fvec16(a4, b4);
+}
+
+static inline void transpose(const fvec16& in1, const fvec16& in2, const fvec16& in3, const fvec16& in4, fvec4 out[16]) {
+    transpose(in1.lowerVec(), in2.lowerVec(), in3.lowerVec(), in4.lowerVec(), out[0], out[1], out[2], out[3], out[4], out[5], out[6], out[7]);
+    transpose(in1.upperVec(), in2.upperVec(), in3.upperVec(), in4.upperVec(), out[8], out[9], out[10], out[11], out[12], out[13], out[14], out[15]);
+}
+
+// Mathematical operators involving a scalar and a vector.
+
+static inline fvec16 operator+(float v1, const fvec16& v2) {
+    return fvec16(v1)+v2;
+}
+
+static inline fvec16 operator-(float v1, const fvec16& v2) {
+    return fvec16(v1)-v2;
+}
+
+static inline fvec16 operator*(float v1, const fvec16& v2) {
+    return fvec16(v1)*v2;
+}
+
+static inline fvec16 operator/(float v1, const fvec16& v2) {
+    return fvec16(v1)/v2;
+}
+
+// Operations for blending fvec16s based on an opmask.
+
+static inline fvec16 blend(const fvec16& v1, const fvec16& v2, __mmask16 mask) {
+    return fvec16(_mm512_mask_blend_ps(mask, v1.val, v2.val));
+}
+
+static inline bool any(__mmask16 mask) {
+    return mask != 0;
+}
+
+#endif /*OPENMM_VECTORIZE16_H_*/
@@ -0,0 +1,263 @@
+#ifndef OPENMM_VECTORIZE8_NEON_H_
+#define OPENMM_VECTORIZE8_NEON_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2013-2018 Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "vectorize.h"
+#include <arm_neon.h>
+
+// This file emulates eight element vectors on NEON, which only has 128 bit
+// registers, by pairing two four element vectors.  That lets the 8-wide kernels
+// written for AVX run unchanged on ARM processors.  Unlike the fvec4 defined in
+// vectorize_neon.h, comparisons produce full bitmasks so they can be combined
+// with the bitwise operators the way the AVX kernels expect.
+
+class ivec8;
+
+/**
+ * An eight element vector of floats.
+ */
+class fvec8 {
+public:
+    fvec4 lo, hi;
+
+    fvec8() {}
+    fvec8(float v) : lo(v), hi(v) {}
+    fvec8(float v1, float v2, float v3, float v4, float v5, float v6, float v7, float v8) : lo(v1, v2, v3, v4), hi(v5, v6, v7, v8) {}
+    fvec8(const fvec4& lower, const fvec4& upper) : lo(lower), hi(upper) {}
+    fvec8(const float* v) : lo(v), hi(v+4) {}
+    fvec4 lowerVec() const {
+        return lo;
+    }
+    fvec4 upperVec() const {
+        return hi;
+    }
+    void store(float* v) const {
+        lo.store(v);
+        hi.store(v+4);
+    }
+    fvec8 operator+(const fvec8& other) const {
+        return fvec8(lo+other.lo, hi+other.hi);
+    }
+    fvec8 operator-(const fvec8& other) const {
+        return fvec8(lo-other.lo, hi-other.hi);
+    }
+    fvec8 operator*(const fvec8& other) const {
+        return fvec8(lo*other.lo, hi*other.hi);
+    }
+    fvec8 operator/(const fvec8& other) const {
+        return fvec8(lo/other.lo, hi/other.hi);
+    }
+    void operator+=(const fvec8& other) {
+        lo += other.lo;
+        hi += other.hi;
+    }
+    void operator-=(const fvec8& other) {
+        lo -= other.lo;
+        hi -= other.hi;
+    }
+    void operator*=(const fvec8& other) {
+        lo *= other.lo;
+        hi *= other.hi;
+    }
+    void operator/=(const fvec8& other) {
+        lo /= other.lo;
+        hi /= other.hi;
+    }
+    fvec8 operator-() const {
+        return fvec8(-lo, -hi);
+    }
+    fvec8 operator&(const fvec8& other) const {
+        return fvec8(lo&other.lo, hi&other.hi);
+    }
+    fvec8 operator|(const fvec8& other) const {
+        return fvec8(lo|other.lo, hi|other.hi);
+    }
+    fvec8 operator==(const fvec8& other) const {
+        return fvec8(vreinterpretq_f32_u32(vceqq_f32(lo.val, other.lo.val)), vreinterpretq_f32_u32(vceqq_f32(hi.val, other.hi.val)));
+    }
+    fvec8 operator!=(const fvec8& other) const {
+        return fvec8(vreinterpretq_f32_u32(vmvnq_u32(vceqq_f32(lo.val, other.lo.val))), vreinterpretq_f32_u32(vmvnq_u32(vceqq_f32(hi.val, other.hi.val))));
+    }
+    fvec8 operator>(const fvec8& other) const {
+        return fvec8(vreinterpretq_f32_u32(vcgtq_f32(lo.val, other.lo.val)), vreinterpretq_f32_u32(vcgtq_f32(hi.val, other.hi.val)));
+    }
+    fvec8 operator<(const fvec8& other) const {
+        return fvec8(vreinterpretq_f32_u32(vcltq_f32(lo.val, other.lo.val)), vreinterpretq_f32_u32(vcltq_f32(hi.val, other.hi.val)));
+    }
+    fvec8 operator>=(const fvec8& other) const {
+        return fvec8(vreinterpretq_f32_u32(vcgeq_f32(lo.val, other.lo.val)), vreinterpretq_f32_u32(vcgeq_f32(hi.val, other.hi.val)));
+    }
+    fvec8 operator<=(const fvec8& other) const {
+        return fvec8(vreinterpretq_f32_u32(vcleq_f32(lo.val, other.lo.val)), vreinterpretq_f32_u32(vcleq_f32(hi.val, other.hi.val)));
+    }
+    operator ivec8() const;
+};
+
+/**
+ * An eight element vector of ints.
+ */
+class ivec8 {
+public:
+    ivec4 lo, hi;
+
+    ivec8() {}
+    ivec8(int v) : lo(v), hi(v) {}
+    ivec8(int v1, int v2, int v3, int v4, int v5, int v6, int v7, int v8) : lo(v1, v2, v3, v4), hi(v5, v6, v7, v8) {}
+    ivec8(const ivec4& lower, const ivec4& upper) : lo(lower), hi(upper) {}
+    ivec8(const int* v) : lo(v), hi(v+4) {}
+    ivec4 lowerVec() const {
+        return lo;
+    }
+    ivec4 upperVec() const {
+        return hi;
+    }
+    void store(int* v) const {
+        lo.store(v);
+        hi.store(v+4);
+    }
+    ivec8 operator&(const ivec8& other) const {
+        return ivec8(lo&other.lo, hi&other.hi);
+    }
+    ivec8 operator|(const ivec8& other) const {
+        return ivec8(lo|other.lo, hi|other.hi);
+    }
+    ivec8 operator&(const fvec8& other) const {
+        // Combine an integer mask with the bitmask produced by an fvec8 comparison.
+        return ivec8(vandq_s32(lo.val, vreinterpretq_s32_f32(other.lo.val)), vandq_s32(hi.val, vreinterpretq_s32_f32(other.hi.val)));
+    }
+    operator fvec8() const;
+};
+
+// Conversion operators.
+
+inline fvec8::operator ivec8() const {
+    return ivec8(ivec4(lo), ivec4(hi));
+}
+
+inline ivec8::operator fvec8() const {
+    return fvec8(fvec4(lo), fvec4(hi));
+}
+
+// Functions that operate on fvec8s.
+
+static inline fvec8 floor(const fvec8& v) {
+    return fvec8(floor(v.lo), floor(v.hi));
+}
+
+static inline fvec8 ceil(const fvec8& v) {
+    return fvec8(ceil(v.lo), ceil(v.hi));
+}
+
+static inline fvec8 round(const fvec8& v) {
+    return fvec8(round(v.lo), round(v.hi));
+}
+
+static inline fvec8 min(const fvec8& v1, const fvec8& v2) {
+    return fvec8(min(v1.lo, v2.lo), min(v1.hi, v2.hi));
+}
+
+static inline fvec8 max(const fvec8& v1, const fvec8& v2) {
+    return fvec8(max(v1.lo, v2.lo), max(v1.hi, v2.hi));
+}
+
+static inline fvec8 abs(const fvec8& v) {
+    return fvec8(abs(v.lo), abs(v.hi));
+}
+
+static inline fvec8 sqrt(const fvec8& v) {
+    return fvec8(sqrt(v.lo), sqrt(v.hi));
+}
+
+static inline fvec8 rsqrt(const fvec8& v) {
+    return fvec8(rsqrt(v.lo), rsqrt(v.hi));
+}
+
+static inline float dot8(const fvec8& v1, const fvec8& v2) {
+    return dot4(v1.lo, v2.lo)+dot4(v1.hi, v2.hi);
+}
+
+static inline void transpose(const fvec4& in1, const fvec4& in2, const fvec4& in3, const fvec4& in4, const fvec4& in5, const fvec4& in6, const fvec4& in7, const fvec4& in8, fvec8& out1, fvec8& out2, fvec8& out3, fvec8& out4) {
+    fvec4 i1 = in1, i2 = in2, i3 = in3, i4 = in4;
+    fvec4 i5 = in5, i6 = in6, i7 = in7, i8 = in8;
+    transpose(i1, i2, i3, i4);
+    transpose(i5, i6, i7, i8);
+    out1 = fvec8(i1, i5);
+    out2 = fvec8(i2, i6);
+    out3 = fvec8(i3, i7);
+    out4 = fvec8(i4, i8);
+}
+
+static inline void transpose(const fvec8& in1, const fvec8& in2, const fvec8& in3, const fvec8& in4, fvec4& out1, fvec4& out2, fvec4& out3, fvec4& out4, fvec4& out5, fvec4& out6, fvec4& out7, fvec4& out8) {
+    out1 = in1.lo;
+    out2 = in2.lo;
+    out3 = in3.lo;
+    out4 = in4.lo;
+    transpose(out1, out2, out3, out4);
+    out5 = in1.hi;
+    out6 = in2.hi;
+    out7 = in3.hi;
+    out8 = in4.hi;
+    transpose(out5, out6, out7, out8);
+}
+
+// Functions that operate on ivec8s.
+
+static inline bool any(const ivec8& v) {
+    return (any(v.lo) || any(v.hi));
+}
+
+// Mathematical operators involving a scalar and a vector.
+
+static inline fvec8 operator+(float v1, const fvec8& v2) {
+    return fvec8(v1)+v2;
+}
+
+static inline fvec8 operator-(float v1, const fvec8& v2) {
+    return fvec8(v1)-v2;
+}
+
+static inline fvec8 operator*(float v1, const fvec8& v2) {
+    return fvec8(v1)*v2;
+}
+
+static inline fvec8 operator/(float v1, const fvec8& v2) {
+    return fvec8(v1)/v2;
+}
+
+// Operations for blending fvec8s based on an ivec8.
+
+static inline fvec8 blend(const fvec8& v1, const fvec8& v2, const ivec8& mask) {
+    return fvec8(blend(v1.lo, v2.lo, mask.lo), blend(v1.hi, v2.hi, mask.hi));
+}
+
+#endif /*OPENMM_VECTORIZE8_NEON_H_*/
@@ -32,11 +32,12 @@
  * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
  * -------------------------------------------------------------------------- */
 
+#ifdef __ANDROID__
 #include <cpu-features.h>
+#endif
 #include <arm_neon.h>
 #include <cmath>
-
-typedef int int32_t;
+#include <stdint.h>
 
 // This file defines classes and functions to simplify vectorizing code with NEON.
 
@@ -48,8 +49,13 @@ float32x4_t log_ps(float32x4_t);
  * Determine whether ivec4 and fvec4 are supported on this processor.
  */
 static bool isVec4Supported() {
+#ifdef __ANDROID__
     uint64_t features = android_getCpuFeatures();
     return (features & ANDROID_CPU_ARM_FEATURE_NEON) != 0;
+#else
+    // If this file was selected at compile time, NEON is part of the baseline architecture.
+    return true;
+#endif
 }
 
 class ivec4;
@@ -98,13 +104,17 @@ public:
         return vmulq_f32(val, other);
     }
     fvec4 operator/(const fvec4& other) const {
-        // NEON does not have a divide float-point operator, so we get the reciprocal and multiply.
+#ifdef __aarch64__
+        return vdivq_f32(val, other);
+#else
+        // 32 bit NEON does not have a divide float-point operator, so we get the reciprocal and multiply.
 
         float32x4_t reciprocal = vrecpeq_f32(other);
         reciprocal = vmulq_f32(vrecpsq_f32(other, reciprocal), reciprocal);
         reciprocal = vmulq_f32(vrecpsq_f32(other, reciprocal), reciprocal);
         fvec4 result = vmulq_f32(val,reciprocal);
         return result;
+#endif
     }
     void operator+=(const fvec4& other) {
         val = vaddq_f32(val, other);
@@ -263,7 +273,11 @@ static inline fvec4 rsqrt(const fvec4& v) {
 }
 
 static inline fvec4 sqrt(const fvec4& v) {
+#ifdef __aarch64__
+    return vsqrtq_f32(v);
+#else
     return rsqrt(v)*v;
+#endif
 }
 
 static inline fvec4 exp(const fvec4& v) {
@@ -0,0 +1,62 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "openmm/BinaryTrajectoryWriter.h"
+
+using namespace OpenMM;
+using namespace std;
+
+const static char TRAJECTORY_MAGIC_BYTES[] = "OpenMM Binary Trajectory\n";
+
+BinaryTrajectoryWriter::BinaryTrajectoryWriter(const string& filename) : TrajectoryWriter(filename) {
+}
+
+void BinaryTrajectoryWriter::writeHeader(int numParticles) {
+    file.write(TRAJECTORY_MAGIC_BYTES, sizeof(TRAJECTORY_MAGIC_BYTES));
+    int version = 1;
+    file.write(reinterpret_cast<const char*>(&version), sizeof(int));
+    file.write(reinterpret_cast<const char*>(&numParticles), sizeof(int));
+}
+
+void BinaryTrajectoryWriter::writeFrameData(double time, const Vec3 periodicBoxVectors[3], const vector<Vec3>& positions) {
+    file.write(reinterpret_cast<const char*>(&time), sizeof(double));
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++) {
+            double element = periodicBoxVectors[i][j];
+            file.write(reinterpret_cast<const char*>(&element), sizeof(double));
+        }
+    int numParticles = positions.size();
+    coords.resize(3*numParticles);
+    for (int i = 0; i < numParticles; i++)
+        for (int j = 0; j < 3; j++)
+            coords[3*i+j] = (float) positions[i][j];
+    file.write(reinterpret_cast<const char*>(coords.data()), 3*numParticles*sizeof(float));
+}
@@ -71,6 +71,10 @@ double BrownianIntegrator::computeKineticEnergy() {
     return kernel.getAs<IntegrateBrownianStepKernel>().computeKineticEnergy(*context, *this);
 }
 
+bool BrownianIntegrator::kineticEnergyRequiresForce() const {
+    return false;
+}
+
 void BrownianIntegrator::step(int steps) {
     if (context == NULL)
         throw OpenMMException("This Integrator is not bound to a context!");  
@@ -79,4 +83,5 @@ void BrownianIntegrator::step(int steps) {
         context->calcForcesAndEnergy(true, false);
         kernel.getAs<IntegrateBrownianStepKernel>().execute(*context, *this);
     }
+    context->invalidateEnergyCache();
 }
@@ -66,7 +66,7 @@ vector<string> CMAPTorsionForceImpl::getKernelNames() {
 
 void CMAPTorsionForceImpl::calcMapDerivatives(int size, const vector<double>& energy, vector<vector<double> >& c) {
     vector<double> d1(size*size), d2(size*size), d12(size*size);
-    vector<double> x(size+1), y(size+1), deriv(size+1);
+    vector<double> x(size+1), y(size+1), deriv(size+1), knotDeriv(size+1);
     for (int i = 0; i < size+1; i++)
         x[i] = i*2*M_PI/size;
 
@@ -77,9 +77,9 @@ void CMAPTorsionForceImpl::calcMapDerivatives(int size, const vector<double>& en
             y[j] = energy[j+size*i];
         y[size] = energy[size*i];
         SplineFitter::createPeriodicSpline(x, y, deriv);
-        for (int j = 0; j < size; j++) {
-            d1[j+size*i] = SplineFitter::evaluateSplineDerivative(x, y, deriv, x[j]);
-        }
+        SplineFitter::evaluateSplineDerivativesAtKnots(x, y, deriv, knotDeriv);
+        for (int j = 0; j < size; j++)
+            d1[j+size*i] = knotDeriv[j];
     }
 
     // Compute derivatives with respect to the second angle.
@@ -89,8 +89,9 @@ void CMAPTorsionForceImpl::calcMapDerivatives(int size, const vector<double>& en
             y[j] = energy[i+size*j];
         y[size] = energy[i];
         SplineFitter::createPeriodicSpline(x, y, deriv);
+        SplineFitter::evaluateSplineDerivativesAtKnots(x, y, deriv, knotDeriv);
         for (int j = 0; j < size; j++)
-            d2[i+size*j] = SplineFitter::evaluateSplineDerivative(x, y, deriv, x[j]);
+            d2[i+size*j] = knotDeriv[j];
     }
 
     // Compute cross derivatives.
@@ -100,8 +101,9 @@ void CMAPTorsionForceImpl::calcMapDerivatives(int size, const vector<double>& en
             y[j] = d2[j+size*i];
         y[size] = d2[size*i];
         SplineFitter::createPeriodicSpline(x, y, deriv);
+        SplineFitter::evaluateSplineDerivativesAtKnots(x, y, deriv, knotDeriv);
         for (int j = 0; j < size; j++)
-            d12[j+size*i] = SplineFitter::evaluateSplineDerivative(x, y, deriv, x[j]);
+            d12[j+size*i] = knotDeriv[j];
     }
 
     // Now compute the coefficients.
@@ -128,3 +128,7 @@ void CompoundIntegrator::stateChanged(State::DataType changed) {
 double CompoundIntegrator::computeKineticEnergy() {
     return integrators[currentIntegrator]->computeKineticEnergy();
 }
+
+bool CompoundIntegrator::kineticEnergyRequiresForce() const {
+    return integrators[currentIntegrator]->kineticEnergyRequiresForce();
+}
@@ -36,6 +36,7 @@
 #include "SimTKOpenMMRealType.h"
 #include "sfmt/SFMT.h"
 #include <cmath>
+#include <sstream>
 
 using namespace OpenMM;
 using namespace std;
@@ -85,8 +86,21 @@ State Context::getState(int types, bool enforcePeriodicBox, int groups) const {
     bool includeForces = types&State::Forces;
     bool includeEnergy = types&State::Energy;
     bool includeParameterDerivs = types&State::ParameterDerivatives;
+    if (types&State::GroupEnergies) {
+        // Compute this first: it seeds the energy cache, so a request that also includes the
+        // total energy does not evaluate the forces a second time.
+
+        map<int, double> groupEnergies;
+        impl->calcEnergiesByForceGroup(groupEnergies, groups);
+        builder.setEnergiesByForceGroup(groupEnergies);
+    }
     if (includeForces || includeEnergy || includeParameterDerivs) {
-        double energy = impl->calcForcesAndEnergy(includeForces || includeEnergy || includeParameterDerivs, includeEnergy, groups);
+        // Forces are only computed when something actually needs them: the caller requested
+        // them, or the integrator's kinetic energy estimate time-shifts the velocities using
+        // the current forces.  Otherwise energy-only evaluations skip the force accumulation.
+
+        bool needForces = includeForces || includeParameterDerivs || (includeEnergy && impl->getIntegrator().kineticEnergyRequiresForce());
+        double energy = impl->calcForcesAndEnergy(needForces, includeEnergy, groups);
         if (includeEnergy)
             builder.setEnergy(impl->calcKineticEnergy(), energy);
         if (includeForces) {
@@ -108,8 +122,15 @@ State Context::getState(int types, bool enforcePeriodicBox, int groups) const {
     }
     if (types&State::Positions) {
         vector<Vec3> positions;
-        impl->getPositions(positions);
-        if (enforcePeriodicBox) {
+        // Platforms that store positions on a device can wrap the molecules in a kernel before
+        // downloading them.  If this platform cannot, retrieve them normally and wrap on the host.
+
+        bool wrapOnHost = enforcePeriodicBox;
+        if (wrapOnHost && impl->getWrappedPositions(positions))
+            wrapOnHost = false;
+        else
+            impl->getPositions(positions);
+        if (wrapOnHost) {
             const vector<vector<int> >& molecules = impl->getMolecules();
             for (auto& mol : molecules) {
                 // Find the molecule center.
@@ -140,14 +161,44 @@ State Context::getState(int types, bool enforcePeriodicBox, int groups) const {
     return builder.getState();
 }
 
+vector<Vec3> Context::getSelectedPositions(const vector<int>& particles) const {
+    int numParticles = impl->getSystem().getNumParticles();
+    for (int particle : particles)
+        if (particle < 0 || particle >= numParticles)
+            throw OpenMMException("Called getSelectedPositions() with an invalid particle index");
+    vector<Vec3> positions;
+    impl->getSelectedPositions(particles, positions);
+    return positions;
+}
+
+vector<int> Context::getQuantizedPositions(double resolution) const {
+    if (resolution <= 0.0)
+        throw OpenMMException("Called getQuantizedPositions() with a resolution that is not positive");
+    vector<int> positions;
+    impl->getQuantizedPositions(resolution, positions);
+    return positions;
+}
+
 void Context::setState(const State& state) {
     setTime(state.getTime());
     Vec3 a, b, c;
     state.getPeriodicBoxVectors(a, b, c);
     setPeriodicBoxVectors(a, b, c);
-    if ((state.getDataTypes()&State::Positions) != 0)
+    bool hasPositions = (state.getDataTypes()&State::Positions) != 0;
+    bool hasVelocities = (state.getDataTypes()&State::Velocities) != 0;
+    if (hasPositions && hasVelocities) {
+        // Restore both arrays with a single call so platforms can combine them into one
+        // upload and synchronization.
+
+        if ((int) state.getPositions().size() != impl->getSystem().getNumParticles())
+            throw OpenMMException("Called setState() on a Context with the wrong number of positions");
+        if ((int) state.getVelocities().size() != impl->getSystem().getNumParticles())
+            throw OpenMMException("Called setState() on a Context with the wrong number of velocities");
+        impl->setPositionsAndVelocities(state.getPositions(), state.getVelocities());
+    }
+    else if (hasPositions)
         setPositions(state.getPositions());
-    if ((state.getDataTypes()&State::Velocities) != 0)
+    else if (hasVelocities)
         setVelocities(state.getVelocities());
     if ((state.getDataTypes()&State::Parameters) != 0)
         for (auto& param : state.getParameters())
@@ -233,17 +284,22 @@ void Context::computeVirtualSites() {
     impl->computeVirtualSites();
 }
 
-void Context::reinitialize() {
+void Context::reinitialize(bool preserveState) {
     const System& system = impl->getSystem();
     Integrator& integrator = impl->getIntegrator();
     Platform& platform = impl->getPlatform();
+    stringstream checkpoint;
+    if (preserveState)
+        impl->createCheckpoint(checkpoint);
     integrator.cleanup();
     delete impl;
     impl = new ContextImpl(*this, system, integrator, &platform, properties);
+    if (preserveState)
+        impl->loadCheckpoint(checkpoint);
 }
 
-void Context::createCheckpoint(ostream& stream) {
-    impl->createCheckpoint(stream);
+void Context::createCheckpoint(ostream& stream, bool blocking) {
+    impl->createCheckpoint(stream, blocking);
 }
 
 void Context::loadCheckpoint(istream& stream) {
@@ -44,6 +44,7 @@
 #include <cstdlib>
 #include <iostream>
 #include <map>
+#include <sstream>
 #include <utility>
 #include <vector>
 #include <string.h>
@@ -55,7 +56,7 @@ const static char CHECKPOINT_MAGIC_BYTES[] = "OpenMM Binary Checkpoint\n";
 
 ContextImpl::ContextImpl(Context& owner, const System& system, Integrator& integrator, Platform* platform, const map<string, string>& properties) :
         owner(owner), system(system), integrator(integrator), hasInitializedForces(false), hasSetPositions(false), integratorIsDeleted(false),
-        lastForceGroups(-1), platform(platform), platformData(NULL) {
+        forcesAreValid(false), lastForceGroups(-1), platform(platform), platformData(NULL) {
     int numParticles = system.getNumParticles();
     if (numParticles == 0)
         throw OpenMMException("Cannot create a Context for a System with no particles");
@@ -91,23 +92,27 @@ ContextImpl::ContextImpl(Context& owner, const System& system, Integrator& integ
         constraintAtoms.insert(atoms);
     }
     
-    // Validate the list of properties.
+    // Validate the list of properties.  Specifying properties is only allowed when a
+    // Platform was specified as well, so when no Platform was given there is nothing
+    // to validate.
 
-    const vector<string>& platformProperties = platform->getPropertyNames();
     map<string, string> validatedProperties;
-    for (auto& prop : properties) {
-        string property = prop.first;
-        if (platform->deprecatedPropertyReplacements.find(property) != platform->deprecatedPropertyReplacements.end())
-            property = platform->deprecatedPropertyReplacements[property];
-        bool valid = false;
-        for (auto& p : platformProperties)
-            if (p == property) {
-                valid = true;
-                break;
-            }
-        if (!valid)
-            throw OpenMMException("Illegal property name: "+prop.first);
-        validatedProperties[property] = prop.second;
+    if (platform != NULL) {
+        const vector<string>& platformProperties = platform->getPropertyNames();
+        for (auto& prop : properties) {
+            string property = prop.first;
+            if (platform->deprecatedPropertyReplacements.find(property) != platform->deprecatedPropertyReplacements.end())
+                property = platform->deprecatedPropertyReplacements[property];
+            bool valid = false;
+            for (auto& p : platformProperties)
+                if (p == property) {
+                    valid = true;
+                    break;
+                }
+            if (!valid)
+                throw OpenMMException("Illegal property name: "+prop.first);
+            validatedProperties[property] = prop.second;
+        }
     }
     
     // Find the list of kernels required.
@@ -119,8 +124,6 @@ ContextImpl::ContextImpl(Context& owner, const System& system, Integrator& integ
     kernelNames.push_back(VirtualSitesKernel::Name());
     for (int i = 0; i < system.getNumForces(); ++i) {
         forceImpls.push_back(system.getForce(i).createImpl());
-        map<string, double> forceParameters = forceImpls[forceImpls.size()-1]->getDefaultParameters();
-        parameters.insert(forceParameters.begin(), forceParameters.end());
         vector<string> forceKernels = forceImpls[forceImpls.size()-1]->getKernelNames();
         kernelNames.insert(kernelNames.begin(), forceKernels.begin(), forceKernels.end());
     }
@@ -177,13 +180,22 @@ ContextImpl::ContextImpl(Context& owner, const System& system, Integrator& integ
     Vec3 periodicBoxVectors[3];
     system.getDefaultPeriodicBoxVectors(periodicBoxVectors[0], periodicBoxVectors[1], periodicBoxVectors[2]);
     updateStateDataKernel.getAs<UpdateStateDataKernel>().setPeriodicBoxVectors(*this, periodicBoxVectors[0], periodicBoxVectors[1], periodicBoxVectors[2]);
-    for (size_t i = 0; i < forceImpls.size(); ++i)
+    for (size_t i = 0; i < forceImpls.size(); ++i) {
         forceImpls[i]->initialize(*this);
+        map<string, double> forceParameters = forceImpls[i]->getDefaultParameters();
+        parameters.insert(forceParameters.begin(), forceParameters.end());
+    }
     integrator.initialize(*this);
     updateStateDataKernel.getAs<UpdateStateDataKernel>().setVelocities(*this, vector<Vec3>(numParticles));
 }
 
 ContextImpl::~ContextImpl() {
+    try {
+        waitForCheckpointWrite();
+    }
+    catch (...) {
+        // There is nothing useful we can do about a failed write at this point.
+    }
     for (auto force : forceImpls)
         delete force;
     
@@ -214,10 +226,31 @@ void ContextImpl::getPositions(std::vector<Vec3>& positions) {
     updateStateDataKernel.getAs<UpdateStateDataKernel>().getPositions(*this, positions);
 }
 
+bool ContextImpl::getWrappedPositions(std::vector<Vec3>& positions) {
+    return updateStateDataKernel.getAs<UpdateStateDataKernel>().getWrappedPositions(*this, positions);
+}
+
+void ContextImpl::beginGetPositions() {
+    updateStateDataKernel.getAs<UpdateStateDataKernel>().beginGetPositions(*this);
+}
+
+void ContextImpl::finishGetPositions(std::vector<Vec3>& positions) {
+    updateStateDataKernel.getAs<UpdateStateDataKernel>().finishGetPositions(*this, positions);
+}
+
+void ContextImpl::getSelectedPositions(const std::vector<int>& particles, std::vector<Vec3>& positions) {
+    updateStateDataKernel.getAs<UpdateStateDataKernel>().getSelectedPositions(*this, particles, positions);
+}
+
+void ContextImpl::getQuantizedPositions(double resolution, std::vector<int>& positions) {
+    updateStateDataKernel.getAs<UpdateStateDataKernel>().getQuantizedPositions(*this, resolution, positions);
+}
+
 void ContextImpl::setPositions(const std::vector<Vec3>& positions) {
     hasSetPositions = true;
     updateStateDataKernel.getAs<UpdateStateDataKernel>().setPositions(*this, positions);
     integrator.stateChanged(State::Positions);
+    invalidateEnergyCache();
 }
 
 void ContextImpl::getVelocities(std::vector<Vec3>& velocities) {
@@ -229,6 +262,14 @@ void ContextImpl::setVelocities(const std::vector<Vec3>& velocities) {
     integrator.stateChanged(State::Velocities);
 }
 
+void ContextImpl::setPositionsAndVelocities(const std::vector<Vec3>& positions, const std::vector<Vec3>& velocities) {
+    hasSetPositions = true;
+    updateStateDataKernel.getAs<UpdateStateDataKernel>().setPositionsAndVelocities(*this, positions, velocities);
+    integrator.stateChanged(State::Positions);
+    integrator.stateChanged(State::Velocities);
+    invalidateEnergyCache();
+}
+
 void ContextImpl::getForces(std::vector<Vec3>& forces) {
     updateStateDataKernel.getAs<UpdateStateDataKernel>().getForces(*this, forces);
 }
@@ -248,6 +289,7 @@ void ContextImpl::setParameter(std::string name, double value) {
         throw OpenMMException("Called setParameter() with invalid parameter name: "+name);
     parameters[name] = value;
     integrator.stateChanged(State::Parameters);
+    invalidateEnergyCache();
 }
 
 void ContextImpl::getEnergyParameterDerivatives(std::map<std::string, double>& derivs) {
@@ -266,12 +308,14 @@ void ContextImpl::setPeriodicBoxVectors(const Vec3& a, const Vec3& b, const Vec3
     if (a[0] <= 0.0 || b[1] <= 0.0 || c[2] <= 0.0 || a[0] < 2*fabs(b[0]) || a[0] < 2*fabs(c[0]) || b[1] < 2*fabs(c[1]))
         throw OpenMMException("Periodic box vectors must be in reduced form.");
     updateStateDataKernel.getAs<UpdateStateDataKernel>().setPeriodicBoxVectors(*this, a, b, c);
+    invalidateEnergyCache();
 }
 
 void ContextImpl::applyConstraints(double tol) {
     if (!hasSetPositions)
         throw OpenMMException("Particle positions have not been set");
     applyConstraintsKernel.getAs<ApplyConstraintsKernel>().apply(*this, tol);
+    invalidateEnergyCache();
 }
 
 void ContextImpl::applyVelocityConstraints(double tol) {
@@ -282,11 +326,25 @@ void ContextImpl::applyVelocityConstraints(double tol) {
 
 void ContextImpl::computeVirtualSites() {
     virtualSitesKernel.getAs<VirtualSitesKernel>().computePositions(*this);
+    invalidateEnergyCache();
 }
 
 double ContextImpl::calcForcesAndEnergy(bool includeForces, bool includeEnergy, int groups) {
     if (!hasSetPositions)
         throw OpenMMException("Particle positions have not been set");
+    // If nothing has changed since this set of groups was last evaluated, the cached
+    // results can be returned without repeating the computation.
+
+    bool forcesAreCurrent = (forcesAreValid && groups == lastForceGroups);
+    if (!includeForces || forcesAreCurrent) {
+        if (includeEnergy) {
+            map<int, double>::const_iterator cached = cachedEnergies.find(groups);
+            if (cached != cachedEnergies.end())
+                return cached->second;
+        }
+        else if (forcesAreCurrent)
+            return 0.0;
+    }
     lastForceGroups = groups;
     CalcForcesAndEnergyKernel& kernel = initializeForcesKernel.getAs<CalcForcesAndEnergyKernel>();
     while (true) {
@@ -296,11 +354,74 @@ double ContextImpl::calcForcesAndEnergy(bool includeForces, bool includeEnergy,
             energy += force->calcForcesAndEnergy(*this, includeForces, includeEnergy, groups);
         bool valid = true;
         energy += kernel.finishComputation(*this, includeForces, includeEnergy, groups, valid);
-        if (valid)
+        if (valid) {
+            if (includeEnergy)
+                cachedEnergies[groups] = energy;
+            // An energy-only evaluation may still overwrite the force buffers, so the
+            // forces are only known to be current when they were explicitly requested.
+
+            forcesAreValid = includeForces;
             return energy;
+        }
     }
 }
 
+void ContextImpl::calcEnergiesByForceGroup(map<int, double>& energies, int groups) {
+    if (!hasSetPositions)
+        throw OpenMMException("Particle positions have not been set");
+    energies.clear();
+    for (auto force : forceImpls) {
+        int group = force->getOwner().getForceGroup();
+        if ((groups&(1<<group)) != 0)
+            energies[group] = 0.0;
+    }
+    CalcForcesAndEnergyKernel& kernel = initializeForcesKernel.getAs<CalcForcesAndEnergyKernel>();
+    if (!kernel.supportsEnergyDecomposition()) {
+        // The platform accumulates all of the energies in a single buffer, so each group has
+        // to be evaluated separately.  Repeated queries at the same step hit the cache.
+
+        for (auto& group : energies)
+            group.second = calcForcesAndEnergy(false, true, 1<<group.first);
+        return;
+    }
+
+    // Every ForceImpl returns its own energy, so a single evaluation can accumulate the
+    // energy of every group.
+
+    while (true) {
+        for (auto& group : energies)
+            group.second = 0.0;
+        double energy = 0.0;
+        kernel.beginComputation(*this, false, true, groups);
+        for (auto force : forceImpls) {
+            int group = force->getOwner().getForceGroup();
+            double e = force->calcForcesAndEnergy(*this, false, true, groups);
+            if ((groups&(1<<group)) != 0) {
+                energies[group] += e;
+                energy += e;
+            }
+        }
+        bool valid = true;
+        energy += kernel.finishComputation(*this, false, true, groups, valid);
+        if (valid) {
+            // Record the results in the cache so that querying the total energy or the
+            // energy of a single group does not repeat the computation.
+
+            lastForceGroups = groups;
+            cachedEnergies[groups] = energy;
+            for (auto& group : energies)
+                cachedEnergies[1<<group.first] = group.second;
+            forcesAreValid = false;
+            return;
+        }
+    }
+}
+
+void ContextImpl::invalidateEnergyCache() {
+    cachedEnergies.clear();
+    forcesAreValid = false;
+}
+
 int ContextImpl::getLastForceGroups() const {
     return lastForceGroups;
 }
@@ -312,6 +433,7 @@ double ContextImpl::calcKineticEnergy() {
 void ContextImpl::updateContextState() {
     for (auto force : forceImpls)
         force->updateContextState(*this);
+    invalidateEnergyCache();
 }
 
 const vector<ForceImpl*>& ContextImpl::getForceImpls() const {
@@ -434,7 +556,32 @@ static string readString(istream& stream) {
     return str;
 }
 
-void ContextImpl::createCheckpoint(ostream& stream) {
+void ContextImpl::createCheckpoint(ostream& stream, bool blocking) {
+    waitForCheckpointWrite();
+    if (blocking) {
+        writeCheckpoint(stream);
+        return;
+    }
+
+    // Capture the checkpoint into a memory buffer, then write it to the stream on a
+    // background thread so the simulation can continue while the I/O completes.
+
+    stringstream buffer;
+    writeCheckpoint(buffer);
+    string data = buffer.str();
+    ostream* out = &stream;
+    checkpointWrite = async(launch::async, [data, out] () {
+        out->write(&data[0], data.size());
+        out->flush();
+    });
+}
+
+void ContextImpl::waitForCheckpointWrite() {
+    if (checkpointWrite.valid())
+        checkpointWrite.get();
+}
+
+void ContextImpl::writeCheckpoint(ostream& stream) {
     stream.write(CHECKPOINT_MAGIC_BYTES, sizeof(CHECKPOINT_MAGIC_BYTES)/sizeof(CHECKPOINT_MAGIC_BYTES[0]));
     writeString(stream, getPlatform().getName());
     int numParticles = getSystem().getNumParticles();
@@ -450,6 +597,7 @@ void ContextImpl::createCheckpoint(ostream& stream) {
 }
 
 void ContextImpl::loadCheckpoint(istream& stream) {
+    waitForCheckpointWrite();
     static const int magiclength = sizeof(CHECKPOINT_MAGIC_BYTES)/sizeof(CHECKPOINT_MAGIC_BYTES[0]);
     char magicbytes[magiclength];
     stream.read(magicbytes, magiclength);
@@ -473,8 +621,10 @@ void ContextImpl::loadCheckpoint(istream& stream) {
     }
     updateStateDataKernel.getAs<UpdateStateDataKernel>().loadCheckpoint(*this, stream);
     hasSetPositions = true;
+    invalidateEnergyCache();
 }
 
 void ContextImpl::systemChanged() {
     integrator.stateChanged(State::Energy);
+    invalidateEnergyCache();
 }
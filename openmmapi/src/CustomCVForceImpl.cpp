@@ -0,0 +1,112 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "openmm/internal/CustomCVForceImpl.h"
+#include "openmm/OpenMMException.h"
+#include "openmm/internal/ContextImpl.h"
+#include "openmm/kernels.h"
+#include "openmm/serialization/XmlSerializer.h"
+
+using namespace OpenMM;
+using namespace std;
+
+CustomCVForceImpl::CustomCVForceImpl(const CustomCVForce& owner) : owner(owner), innerIntegrator(1.0),
+        innerContext(NULL) {
+}
+
+CustomCVForceImpl::~CustomCVForceImpl() {
+    if (innerContext != NULL)
+        delete innerContext;
+}
+
+void CustomCVForceImpl::initialize(ContextImpl& context) {
+    // Construct the inner system used to evaluate the collective variables.  Each variable
+    // is placed in its own force group so it can be evaluated separately.
+
+    const System& system = context.getSystem();
+    Vec3 a, b, c;
+    system.getDefaultPeriodicBoxVectors(a, b, c);
+    innerSystem.setDefaultPeriodicBoxVectors(a, b, c);
+    for (int i = 0; i < system.getNumParticles(); i++)
+        innerSystem.addParticle(system.getParticleMass(i));
+    for (int i = 0; i < owner.getNumCollectiveVariables(); i++) {
+        Force* variable = XmlSerializer::clone<Force>(owner.getCollectiveVariable(i));
+        variable->setForceGroup(i);
+        innerSystem.addForce(variable);
+    }
+
+    // Create the inner context.
+
+    innerContext = new Context(innerSystem, innerIntegrator, context.getPlatform());
+
+    // Create the kernel.
+
+    kernel = context.getPlatform().createKernel(CalcCustomCVForceKernel::Name(), context);
+    kernel.getAs<CalcCustomCVForceKernel>().initialize(context.getSystem(), owner, innerContext->getImpl());
+}
+
+double CustomCVForceImpl::calcForcesAndEnergy(ContextImpl& context, bool includeForces, bool includeEnergy, int groups) {
+    if ((groups&(1<<owner.getForceGroup())) != 0) {
+        CalcCustomCVForceKernel& cvKernel = kernel.getAs<CalcCustomCVForceKernel>();
+        cvKernel.copyState(context, innerContext->getImpl());
+        return cvKernel.execute(context, innerContext->getImpl(), includeForces, includeEnergy);
+    }
+    return 0.0;
+}
+
+map<string, double> CustomCVForceImpl::getDefaultParameters() {
+    // Include the parameters defined by the collective variables, so they can be set
+    // through the main Context and copied to the inner one.
+
+    map<string, double> parameters;
+    parameters.insert(innerContext->getParameters().begin(), innerContext->getParameters().end());
+    for (int i = 0; i < owner.getNumGlobalParameters(); i++)
+        parameters[owner.getGlobalParameterName(i)] = owner.getGlobalParameterDefaultValue(i);
+    return parameters;
+}
+
+vector<string> CustomCVForceImpl::getKernelNames() {
+    vector<string> names;
+    names.push_back(CalcCustomCVForceKernel::Name());
+    return names;
+}
+
+void CustomCVForceImpl::getCollectiveVariableValues(ContextImpl& context, vector<double>& values) {
+    ContextImpl& innerContextImpl = innerContext->getImpl();
+    kernel.getAs<CalcCustomCVForceKernel>().copyState(context, innerContextImpl);
+    values.clear();
+    for (int i = 0; i < owner.getNumCollectiveVariables(); i++)
+        values.push_back(innerContextImpl.calcForcesAndEnergy(false, true, 1<<i));
+}
+
+Context& CustomCVForceImpl::getInnerContext() {
+    return *innerContext;
+}
@@ -120,6 +120,10 @@ void CustomExternalForce::updateParametersInContext(Context& context) {
     dynamic_cast<CustomExternalForceImpl&>(getImplInContext(context)).updateParametersInContext(getContextImpl(context));
 }
 
+void CustomExternalForce::updateSelectedParametersInContext(Context& context, const vector<int>& particles) {
+    dynamic_cast<CustomExternalForceImpl&>(getImplInContext(context)).updateParametersInContext(getContextImpl(context), particles);
+}
+
 bool CustomExternalForce::usesPeriodicBoundaryConditions() const {
     return (energyExpression.find("periodicdistance") != string::npos);
 }
@@ -99,3 +99,8 @@ void CustomExternalForceImpl::updateParametersInContext(ContextImpl& context) {
     kernel.getAs<CalcCustomExternalForceKernel>().copyParametersToContext(context, owner);
     context.systemChanged();
 }
+
+void CustomExternalForceImpl::updateParametersInContext(ContextImpl& context, const vector<int>& particles) {
+    kernel.getAs<CalcCustomExternalForceKernel>().copyParametersToContext(context, owner, particles);
+    context.systemChanged();
+}
@@ -36,6 +36,7 @@
 #include "openmm/internal/ContextImpl.h"
 #include "openmm/internal/CustomNonbondedForceImpl.h"
 #include "openmm/internal/SplineFitter.h"
+#include "openmm/internal/ThreadPool.h"
 #include "openmm/kernels.h"
 #include "ReferenceTabulatedFunction.h"
 #include "lepton/ParsedExpression.h"
@@ -158,7 +159,7 @@ void CustomNonbondedForceImpl::updateParametersInContext(ContextImpl& context) {
     context.systemChanged();
 }
 
-void CustomNonbondedForceImpl::calcLongRangeCorrection(const CustomNonbondedForce& force, const Context& context, double& coefficient, vector<double>& derivatives) {
+void CustomNonbondedForceImpl::calcLongRangeCorrection(const CustomNonbondedForce& force, LongRangeCorrectionData& data, const Context& context, double& coefficient, vector<double>& derivatives) {
     if (force.getNonbondedMethod() == CustomNonbondedForce::NoCutoff || force.getNonbondedMethod() == CustomNonbondedForce::CutoffNonPeriodic) {
         coefficient = 0.0;
         return;
@@ -220,34 +221,85 @@ void CustomNonbondedForceImpl::calcLongRangeCorrection(const CustomNonbondedForc
         }
     }
     
-    // Compute the coefficient.
-    
-    map<string, Lepton::CustomFunction*> functions;
-    for (int i = 0; i < force.getNumFunctions(); i++)
-        functions[force.getTabulatedFunctionName(i)] = createReferenceTabulatedFunction(force.getTabulatedFunction(i));
+    // The cached integrals were computed with the current global parameter values bound
+    // into the expressions, so if any global parameter has changed they must all be discarded.
+
+    map<string, double> globalParamValues;
+    for (int i = 0; i < force.getNumGlobalParameters(); i++) {
+        const string& name = force.getGlobalParameterName(i);
+        globalParamValues[name] = context.getParameter(name);
+    }
+    if (globalParamValues != data.globalParamValues) {
+        data.integrals.clear();
+        data.globalParamValues = globalParamValues;
+    }
+
+    // Make a list of the class pairs whose integrals have not already been computed.  The
+    // cache is keyed by parameter values rather than class indices, so unmodified pairs are
+    // still found if editing particle parameters has changed the class numbering.
+
+    int numDerivs = force.getNumEnergyParameterDerivatives();
+    vector<pair<int, int> > toCompute;
+    for (int i = 0; i < numClasses; i++)
+        for (int j = i; j < numClasses; j++)
+            if (data.integrals.find(make_pair(classes[i], classes[j])) == data.integrals.end())
+                toCompute.push_back(make_pair(i, j));
+    if (toCompute.size() > 0) {
+        // Compute the missing integrals, distributing the class pairs over the worker
+        // threads.  Each thread parses its own copy of the expressions, since evaluating
+        // a CompiledExpression modifies its variable values.
+
+        map<string, Lepton::CustomFunction*> functions;
+        for (int i = 0; i < force.getNumFunctions(); i++)
+            functions[force.getTabulatedFunctionName(i)] = createReferenceTabulatedFunction(force.getTabulatedFunction(i));
+        ThreadPool threads;
+        vector<vector<double> > results(toCompute.size());
+        vector<string> threadError(threads.getNumThreads());
+        threads.execute([&] (ThreadPool& pool, int threadIndex) {
+            try {
+                Lepton::ParsedExpression energyExpression = Lepton::Parser::parse(force.getEnergyFunction(), functions);
+                vector<Lepton::CompiledExpression> expressions;
+                expressions.push_back(energyExpression.createCompiledExpression());
+                for (int k = 0; k < numDerivs; k++)
+                    expressions.push_back(energyExpression.differentiate(force.getEnergyParameterDerivativeName(k)).createCompiledExpression());
+                for (int index = threadIndex; index < toCompute.size(); index += pool.getNumThreads()) {
+                    int i = toCompute[index].first;
+                    int j = toCompute[index].second;
+                    results[index].resize(expressions.size());
+                    for (int k = 0; k < expressions.size(); k++)
+                        results[index][k] = integrateInteraction(expressions[k], classes[i], classes[j], force, context);
+                }
+            }
+            catch (exception& ex) {
+                threadError[threadIndex] = ex.what();
+            }
+        });
+        threads.waitForThreads();
+        for (auto& function : functions)
+            delete function.second;
+        for (auto& error : threadError)
+            if (error.size() > 0)
+                throw OpenMMException(error);
+        for (int index = 0; index < toCompute.size(); index++)
+            data.integrals[make_pair(classes[toCompute[index].first], classes[toCompute[index].second])] = results[index];
+    }
+
+    // Sum the integrals over class pairs to compute the coefficient and its parameter derivatives.
+
     double nPart = (double) numParticles;
     double numInteractions = (nPart*(nPart+1))/2;
-    Lepton::CompiledExpression expression = Lepton::Parser::parse(force.getEnergyFunction(), functions).createCompiledExpression();
-    double sum = 0;
+    vector<double> sums(numDerivs+1, 0.0);
     for (int i = 0; i < numClasses; i++)
-        for (int j = i; j < numClasses; j++)
-            sum += interactionCount[make_pair(i, j)]*integrateInteraction(expression, classes[i], classes[j], force, context);
-    sum /= numInteractions;
-    coefficient = 2*M_PI*nPart*nPart*sum;
-    
-    // Now do the same for parameter derivatives.
-    
-    int numDerivs = force.getNumEnergyParameterDerivatives();
+        for (int j = i; j < numClasses; j++) {
+            const vector<double>& values = data.integrals[make_pair(classes[i], classes[j])];
+            double count = (double) interactionCount[make_pair(i, j)];
+            for (int k = 0; k < numDerivs+1; k++)
+                sums[k] += count*values[k];
+        }
+    coefficient = 2*M_PI*nPart*nPart*sums[0]/numInteractions;
     derivatives.resize(numDerivs);
-    for (int k = 0; k < numDerivs; k++) {
-        expression = Lepton::Parser::parse(force.getEnergyFunction(), functions).differentiate(force.getEnergyParameterDerivativeName(k)).createCompiledExpression();
-        sum = 0;
-        for (int i = 0; i < numClasses; i++)
-            for (int j = i; j < numClasses; j++)
-                sum += interactionCount[make_pair(i, j)]*integrateInteraction(expression, classes[i], classes[j], force, context);
-        sum /= numInteractions;
-        derivatives[k] = 2*M_PI*nPart*nPart*sum;
-    }
+    for (int k = 0; k < numDerivs; k++)
+        derivatives[k] = 2*M_PI*nPart*nPart*sums[k+1]/numInteractions;
 }
 
 double CustomNonbondedForceImpl::integrateInteraction(Lepton::CompiledExpression& expression, const vector<double>& params1, const vector<double>& params2,
@@ -0,0 +1,136 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#ifdef WIN32
+  #define _USE_MATH_DEFINES // Needed to get M_PI
+#endif
+#include "openmm/DCDTrajectoryWriter.h"
+#include <cmath>
+#include <cstring>
+
+using namespace OpenMM;
+using namespace std;
+
+// DCD records time in AKMA units.
+
+static const double TIME_UNIT = 0.04888821;
+
+DCDTrajectoryWriter::DCDTrajectoryWriter(const string& filename, double timeStep, int firstStep, int interval) :
+        TrajectoryWriter(filename), timeStep(timeStep), firstStep(firstStep), interval(interval), frameCount(0) {
+}
+
+void DCDTrajectoryWriter::writeInt(int value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(int));
+}
+
+void DCDTrajectoryWriter::writeFloat(float value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(float));
+}
+
+void DCDTrajectoryWriter::writeDouble(double value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(double));
+}
+
+void DCDTrajectoryWriter::writeHeader(int numParticles) {
+    // The first record holds the control information.  The frame count and final step
+    // number are filled in as frames are written.
+
+    writeInt(84);
+    file.write("CORD", 4);
+    writeInt(0);           // number of frames
+    writeInt(firstStep);   // first step
+    writeInt(interval);    // steps between frames
+    writeInt(0);           // last step
+    for (int i = 0; i < 5; i++)
+        writeInt(0);
+    writeFloat((float) (timeStep/TIME_UNIT));
+    writeInt(1);           // include unit cell information
+    for (int i = 0; i < 8; i++)
+        writeInt(0);
+    writeInt(24);          // file version
+    writeInt(84);
+
+    // The second record holds the title, and the third the number of atoms.
+
+    writeInt(84);
+    writeInt(1);
+    char title[80];
+    memset(title, ' ', sizeof(title));
+    memcpy(title, "Created by OpenMM", 17);
+    file.write(title, sizeof(title));
+    writeInt(84);
+    writeInt(4);
+    writeInt(numParticles);
+    writeInt(4);
+}
+
+void DCDTrajectoryWriter::writeFrameData(double time, const Vec3 periodicBoxVectors[3], const vector<Vec3>& positions) {
+    // Write the unit cell, with lengths in angstroms and angles in degrees.
+
+    const Vec3& a = periodicBoxVectors[0];
+    const Vec3& b = periodicBoxVectors[1];
+    const Vec3& c = periodicBoxVectors[2];
+    double aLength = sqrt(a.dot(a));
+    double bLength = sqrt(b.dot(b));
+    double cLength = sqrt(c.dot(c));
+    double alpha = acos(b.dot(c)/(bLength*cLength))*180.0/M_PI;
+    double beta = acos(a.dot(c)/(aLength*cLength))*180.0/M_PI;
+    double gamma = acos(a.dot(b)/(aLength*bLength))*180.0/M_PI;
+    writeInt(48);
+    writeDouble(10.0*aLength);
+    writeDouble(gamma);
+    writeDouble(10.0*bLength);
+    writeDouble(beta);
+    writeDouble(alpha);
+    writeDouble(10.0*cLength);
+    writeInt(48);
+
+    // Write the coordinates, one axis at a time, in angstroms.
+
+    int numParticles = positions.size();
+    coords.resize(numParticles);
+    for (int axis = 0; axis < 3; axis++) {
+        for (int i = 0; i < numParticles; i++)
+            coords[i] = (float) (10.0*positions[i][axis]);
+        writeInt(4*numParticles);
+        file.write(reinterpret_cast<const char*>(coords.data()), 4*numParticles);
+        writeInt(4*numParticles);
+    }
+
+    // Update the frame count and final step number in the header.
+
+    frameCount++;
+    file.seekp(8);
+    writeInt(frameCount);
+    file.seekp(20);
+    writeInt(firstStep+frameCount*interval);
+    file.seekp(0, ios::end);
+}
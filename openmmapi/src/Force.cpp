@@ -34,6 +34,9 @@
 #include "openmm/OpenMMException.h"
 #include "openmm/internal/ContextImpl.h"
 #include "openmm/internal/ForceImpl.h"
+#include "openmm/serialization/SerializationNode.h"
+#include "openmm/serialization/SerializationProxy.h"
+#include <typeinfo>
 #include <vector>
 
 using namespace OpenMM;
@@ -53,6 +56,13 @@ bool Force::usesPeriodicBoundaryConditions() const {
     throw OpenMMException("usesPeriodicBoundaryConditions is not implemented");
 }
 
+Force* Force::copy() const {
+    const SerializationProxy& proxy = SerializationProxy::getProxy(typeid(*this));
+    SerializationNode node;
+    proxy.serialize(this, node);
+    return reinterpret_cast<Force*>(proxy.deserialize(node));
+}
+
 ForceImpl& Force::getImplInContext(Context& context) {
     for (auto impl : context.getImpl().getForceImpls())
         if (&impl->getOwner() == this)
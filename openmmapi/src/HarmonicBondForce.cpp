@@ -36,6 +36,7 @@
 #include "openmm/internal/HarmonicBondForceImpl.h"
 
 using namespace OpenMM;
+using std::vector;
 
 HarmonicBondForce::HarmonicBondForce() : usePeriodic(false) {
 }
@@ -45,6 +46,16 @@ int HarmonicBondForce::addBond(int particle1, int particle2, double length, doub
     return bonds.size()-1;
 }
 
+int HarmonicBondForce::addBonds(const vector<int>& particle1, const vector<int>& particle2, const vector<double>& length, const vector<double>& k) {
+    if (particle2.size() != particle1.size() || length.size() != particle1.size() || k.size() != particle1.size())
+        throw OpenMMException("HarmonicBondForce: addBonds() was called with arrays of different lengths");
+    int first = bonds.size();
+    bonds.reserve(bonds.size()+particle1.size());
+    for (int i = 0; i < (int) particle1.size(); i++)
+        bonds.push_back(BondInfo(particle1[i], particle2[i], length[i], k[i]));
+    return first;
+}
+
 void HarmonicBondForce::getBondParameters(int index, int& particle1, int& particle2, double& length, double& k) const {
     ASSERT_VALID_INDEX(index, bonds);
     particle1 = bonds[index].particle1;
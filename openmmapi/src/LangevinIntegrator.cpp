@@ -79,4 +79,5 @@ void LangevinIntegrator::step(int steps) {
         context->calcForcesAndEnergy(true, false);
         kernel.getAs<IntegrateLangevinStepKernel>().execute(*context, *this);
     }
+    context->invalidateEnergyCache();
 }
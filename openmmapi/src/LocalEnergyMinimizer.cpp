@@ -31,6 +31,7 @@
 
 #include "openmm/LocalEnergyMinimizer.h"
 #include "openmm/OpenMMException.h"
+#include "openmm/internal/ContextImpl.h"
 #include "lbfgs.h"
 #include "openmm/Platform.h"
 #include <cmath>
@@ -42,29 +43,47 @@ using namespace OpenMM;
 using namespace std;
 
 struct MinimizerData {
-    Context& context;
+    ContextImpl& context;
     double k;
-    MinimizerData(Context& context, double k)
-        : context(context), k(k) {}
+    vector<Vec3> positions, forces;
+    vector<bool> isMassless;
+    vector<int> constraintParticle1, constraintParticle2;
+    vector<double> constraintDistance;
+    MinimizerData(ContextImpl& context, double k) : context(context), k(k) {
+        const System& system = context.getSystem();
+        int numParticles = system.getNumParticles();
+        positions.resize(numParticles);
+        isMassless.resize(numParticles);
+        for (int i = 0; i < numParticles; i++)
+            isMassless[i] = (system.getParticleMass(i) == 0);
+        int numConstraints = system.getNumConstraints();
+        constraintParticle1.resize(numConstraints);
+        constraintParticle2.resize(numConstraints);
+        constraintDistance.resize(numConstraints);
+        for (int i = 0; i < numConstraints; i++)
+            system.getConstraintParameters(i, constraintParticle1[i], constraintParticle2[i], constraintDistance[i]);
+    }
 };
 
 static lbfgsfloatval_t evaluate(void *instance, const lbfgsfloatval_t *x, lbfgsfloatval_t *g, const int n, const lbfgsfloatval_t step) {
     MinimizerData* data = reinterpret_cast<MinimizerData*>(instance);
-    Context& context = data->context;
-    const System& system = context.getSystem();
-    int numParticles = system.getNumParticles();
+    ContextImpl& context = data->context;
+    int numParticles = context.getSystem().getNumParticles();
 
-    // Compute the force and energy for this configuration.
+    // Compute the force and energy for this configuration.  This goes through the
+    // ContextImpl rather than the public API so that each iteration only copies the
+    // positions and forces, without constructing a full State.
 
-    vector<Vec3> positions(numParticles);
+    vector<Vec3>& positions = data->positions;
     for (int i = 0; i < numParticles; i++)
         positions[i] = Vec3(x[3*i], x[3*i+1], x[3*i+2]);
     context.setPositions(positions);
     context.computeVirtualSites();
-    State state = context.getState(State::Forces | State::Energy);
-    const vector<Vec3>& forces = state.getForces();
+    double energy = context.calcForcesAndEnergy(true, true);
+    vector<Vec3>& forces = data->forces;
+    context.getForces(forces);
     for (int i = 0; i < numParticles; i++) {
-        if (system.getParticleMass(i) == 0) {
+        if (data->isMassless[i]) {
             g[3*i] = 0.0;
             g[3*i+1] = 0.0;
             g[3*i+2] = 0.0;
@@ -75,16 +94,15 @@ static lbfgsfloatval_t evaluate(void *instance, const lbfgsfloatval_t *x, lbfgsf
             g[3*i+2] = -forces[i][2];
         }
     }
-    double energy = state.getPotentialEnergy();
 
     // Add harmonic forces for any constraints.
 
-    int numConstraints = system.getNumConstraints();
+    int numConstraints = data->constraintParticle1.size();
     double k = data->k;
     for (int i = 0; i < numConstraints; i++) {
-        int particle1, particle2;
-        double distance;
-        system.getConstraintParameters(i, particle1, particle2, distance);
+        int particle1 = data->constraintParticle1[i];
+        int particle2 = data->constraintParticle2[i];
+        double distance = data->constraintDistance[i];
         Vec3 delta = positions[particle2]-positions[particle1];
         double r2 = delta.dot(delta);
         double r = sqrt(r2);
@@ -143,22 +161,24 @@ void LocalEnergyMinimizer::minimize(Context& context, double tolerance, int maxI
         // Repeatedly minimize, steadily increasing the strength of the springs until all constraints are satisfied.
 
         double prevMaxError = 1e10;
+        MinimizerData data(context.getImpl(), k);
         while (true) {
             // Perform the minimization.
 
             lbfgsfloatval_t fx;
-            MinimizerData data(context, k);
+            data.k = k;
             lbfgs(numParticles*3, x, &fx, evaluate, NULL, &data, &param);
 
             // Check whether all constraints are satisfied.
 
-            vector<Vec3> positions = context.getState(State::Positions).getPositions();
+            vector<Vec3> positions;
+            context.getImpl().getPositions(positions);
             int numConstraints = system.getNumConstraints();
             double maxError = 0.0;
             for (int i = 0; i < numConstraints; i++) {
-                int particle1, particle2;
-                double distance;
-                system.getConstraintParameters(i, particle1, particle2, distance);
+                int particle1 = data.constraintParticle1[i];
+                int particle2 = data.constraintParticle2[i];
+                double distance = data.constraintDistance[i];
                 Vec3 delta = positions[particle2]-positions[particle1];
                 double r = sqrt(delta.dot(delta));
                 double error = fabs(r-distance);
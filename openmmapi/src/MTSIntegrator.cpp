@@ -0,0 +1,84 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2017 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "openmm/MTSIntegrator.h"
+#include "openmm/OpenMMException.h"
+#include <algorithm>
+#include <sstream>
+
+using namespace OpenMM;
+using std::pair;
+using std::string;
+using std::stringstream;
+using std::vector;
+
+static bool compareSubsteps(const pair<int, int>& group1, const pair<int, int>& group2) {
+    return (group1.second < group2.second);
+}
+
+MTSIntegrator::MTSIntegrator(double stepSize, const vector<pair<int, int> >& groups) : CustomIntegrator(stepSize), groups(groups) {
+    if (groups.size() == 0)
+        throw OpenMMException("MTSIntegrator: no force groups specified");
+    vector<pair<int, int> > sortedGroups = groups;
+    std::sort(sortedGroups.begin(), sortedGroups.end(), compareSubsteps);
+    addPerDofVariable("x1", 0);
+    addUpdateContextState();
+    createSubsteps(1, sortedGroups);
+    addConstrainVelocities();
+}
+
+void MTSIntegrator::createSubsteps(int parentSubsteps, const vector<pair<int, int> >& groups) {
+    int group = groups[0].first;
+    int substeps = groups[0].second;
+    if (group < 0 || group > 31)
+        throw OpenMMException("MTSIntegrator: force group must be between 0 and 31");
+    int stepsPerParentStep = substeps/parentSubsteps;
+    if (stepsPerParentStep < 1 || stepsPerParentStep*parentSubsteps != substeps)
+        throw OpenMMException("MTSIntegrator: the number of substeps for each group must be a multiple of the number for the previous group");
+    stringstream kick;
+    kick << "v+0.5*(dt/" << substeps << ")*f" << group << "/m";
+    for (int i = 0; i < stepsPerParentStep; i++) {
+        addComputePerDof("v", kick.str());
+        if (groups.size() == 1) {
+            stringstream drift, correction;
+            drift << "x+(dt/" << substeps << ")*v";
+            correction << "v+(x-x1)/(dt/" << substeps << ")";
+            addComputePerDof("x", drift.str());
+            addComputePerDof("x1", "x");
+            addConstrainPositions();
+            addComputePerDof("v", correction.str());
+            addConstrainVelocities();
+        }
+        else
+            createSubsteps(substeps, vector<pair<int, int> >(groups.begin()+1, groups.end()));
+        addComputePerDof("v", kick.str());
+    }
+}
@@ -76,74 +76,77 @@ void MonteCarloAnisotropicBarostatImpl::updateContextState(ContextImpl& context)
     if (!owner.getScaleX() && !owner.getScaleY() && !owner.getScaleZ())
         return;
     step = 0;
-    
-    // Compute the current potential energy.
-    
-    double initialEnergy = context.getOwner().getState(State::Energy).getPotentialEnergy();
-    double pressure;
-    
-    // Choose which axis to modify at random.
-    int axis;
-    while (true) {
-        double rnd = genrand_real2(random)*3.0;
-        if (rnd < 1.0) {
-            if (owner.getScaleX()) {
-                axis = 0;
-                pressure = context.getParameter(MonteCarloAnisotropicBarostat::PressureX())*(AVOGADRO*1e-25);
-                break;
-            }
-        } else if (rnd < 2.0) {
-            if (owner.getScaleY()) {
-                axis = 1;
-                pressure = context.getParameter(MonteCarloAnisotropicBarostat::PressureY())*(AVOGADRO*1e-25);
-                break;
-            }
-        } else if (owner.getScaleZ()) {
-            axis = 2;
+
+    // Find the axes to attempt, in random order.  Attempting every enabled axis in a single
+    // update lets all of the trials share one evaluation of the starting energy: each trial's
+    // final energy becomes the next trial's initial energy, so equilibrating all dimensions
+    // costs one evaluation per axis plus one, rather than two per axis.
+
+    vector<int> axes;
+    if (owner.getScaleX())
+        axes.push_back(0);
+    if (owner.getScaleY())
+        axes.push_back(1);
+    if (owner.getScaleZ())
+        axes.push_back(2);
+    for (int i = (int) axes.size()-1; i > 0; i--)
+        std::swap(axes[i], axes[(int) (genrand_real2(random)*(i+1))]);
+
+    // Compute the current potential energy.  Calling calcForcesAndEnergy() directly instead of
+    // getState() avoids computing the kinetic energy, which the acceptance test does not need.
+
+    double currentEnergy = context.calcForcesAndEnergy(false, true);
+    for (int axis : axes) {
+        double pressure;
+        if (axis == 0)
+            pressure = context.getParameter(MonteCarloAnisotropicBarostat::PressureX())*(AVOGADRO*1e-25);
+        else if (axis == 1)
+            pressure = context.getParameter(MonteCarloAnisotropicBarostat::PressureY())*(AVOGADRO*1e-25);
+        else
             pressure = context.getParameter(MonteCarloAnisotropicBarostat::PressureZ())*(AVOGADRO*1e-25);
-            break;
+
+        // Modify the periodic box size.
+
+        Vec3 box[3];
+        context.getPeriodicBoxVectors(box[0], box[1], box[2]);
+        double volume = box[0][0]*box[1][1]*box[2][2];
+        double deltaVolume = volumeScale[axis]*2*(genrand_real2(random)-0.5);
+        double newVolume = volume+deltaVolume;
+        Vec3 lengthScale(1.0, 1.0, 1.0);
+        lengthScale[axis] = newVolume/volume;
+        kernel.getAs<ApplyMonteCarloBarostatKernel>().scaleCoordinates(context, lengthScale[0], lengthScale[1], lengthScale[2]);
+        context.getOwner().setPeriodicBoxVectors(Vec3(box[0][0]*lengthScale[0], box[0][1]*lengthScale[1], box[0][2]*lengthScale[2]),
+                                                 Vec3(box[1][0]*lengthScale[0], box[1][1]*lengthScale[1], box[1][2]*lengthScale[2]),
+                                                 Vec3(box[2][0]*lengthScale[0], box[2][1]*lengthScale[1], box[2][2]*lengthScale[2]));
+
+        // Compute the energy of the modified system.
+
+        double finalEnergy = context.calcForcesAndEnergy(false, true);
+        double kT = BOLTZ*context.getParameter(MonteCarloAnisotropicBarostat::Temperature());
+        double w = finalEnergy-currentEnergy + pressure*deltaVolume - context.getMolecules().size()*kT*std::log(newVolume/volume);
+        if (w > 0 && genrand_real2(random) > std::exp(-w/kT)) {
+            // Reject the step.
+
+            kernel.getAs<ApplyMonteCarloBarostatKernel>().restoreCoordinates(context);
+            context.getOwner().setPeriodicBoxVectors(box[0], box[1], box[2]);
+            volume = newVolume;
         }
-    }
-    
-    // Modify the periodic box size.
-    
-    Vec3 box[3];
-    context.getPeriodicBoxVectors(box[0], box[1], box[2]);
-    double volume = box[0][0]*box[1][1]*box[2][2];
-    double deltaVolume = volumeScale[axis]*2*(genrand_real2(random)-0.5);
-    double newVolume = volume+deltaVolume;
-    Vec3 lengthScale(1.0, 1.0, 1.0);
-    lengthScale[axis] = newVolume/volume;
-    kernel.getAs<ApplyMonteCarloBarostatKernel>().scaleCoordinates(context, lengthScale[0], lengthScale[1], lengthScale[2]);
-    context.getOwner().setPeriodicBoxVectors(Vec3(box[0][0]*lengthScale[0], box[0][1]*lengthScale[1], box[0][2]*lengthScale[2]),
-                                             Vec3(box[1][0]*lengthScale[0], box[1][1]*lengthScale[1], box[1][2]*lengthScale[2]),
-                                             Vec3(box[2][0]*lengthScale[0], box[2][1]*lengthScale[1], box[2][2]*lengthScale[2]));
-    
-    // Compute the energy of the modified system.
-    
-    double finalEnergy = context.getOwner().getState(State::Energy).getPotentialEnergy();
-    double kT = BOLTZ*context.getParameter(MonteCarloAnisotropicBarostat::Temperature());
-    double w = finalEnergy-initialEnergy + pressure*deltaVolume - context.getMolecules().size()*kT*std::log(newVolume/volume);
-    if (w > 0 && genrand_real2(random) > std::exp(-w/kT)) {
-        // Reject the step.
-        
-        kernel.getAs<ApplyMonteCarloBarostatKernel>().restoreCoordinates(context);
-        context.getOwner().setPeriodicBoxVectors(box[0], box[1], box[2]);
-        volume = newVolume;
-    }
-    else
-        numAccepted[axis]++;
-    numAttempted[axis]++;
-    if (numAttempted[axis] >= 10) {
-        if (numAccepted[axis] < 0.25*numAttempted[axis]) {
-            volumeScale[axis] /= 1.1;
-            numAttempted[axis] = 0;
-            numAccepted[axis] = 0;
+        else {
+            currentEnergy = finalEnergy;
+            numAccepted[axis]++;
         }
-        else if (numAccepted[axis] > 0.75*numAttempted[axis]) {
-            volumeScale[axis] = std::min(volumeScale[axis]*1.1, volume*0.3);
-            numAttempted[axis] = 0;
-            numAccepted[axis] = 0;
+        numAttempted[axis]++;
+        if (numAttempted[axis] >= 10) {
+            if (numAccepted[axis] < 0.25*numAttempted[axis]) {
+                volumeScale[axis] /= 1.1;
+                numAttempted[axis] = 0;
+                numAccepted[axis] = 0;
+            }
+            else if (numAccepted[axis] > 0.75*numAttempted[axis]) {
+                volumeScale[axis] = std::min(volumeScale[axis]*1.1, volume*0.3);
+                numAttempted[axis] = 0;
+                numAccepted[axis] = 0;
+            }
         }
     }
 }
@@ -73,9 +73,10 @@ void MonteCarloBarostatImpl::updateContextState(ContextImpl& context) {
         return;
     step = 0;
 
-    // Compute the current potential energy.
+    // Compute the current potential energy.  Calling calcForcesAndEnergy() directly instead of
+    // getState() avoids computing the kinetic energy, which the acceptance test does not need.
 
-    double initialEnergy = context.getOwner().getState(State::Energy).getPotentialEnergy();
+    double initialEnergy = context.calcForcesAndEnergy(false, true);
 
     // Modify the periodic box size.
 
@@ -88,9 +89,11 @@ void MonteCarloBarostatImpl::updateContextState(ContextImpl& context) {
     kernel.getAs<ApplyMonteCarloBarostatKernel>().scaleCoordinates(context, lengthScale, lengthScale, lengthScale);
     context.getOwner().setPeriodicBoxVectors(box[0]*lengthScale, box[1]*lengthScale, box[2]*lengthScale);
 
-    // Compute the energy of the modified system.
-    
-    double finalEnergy = context.getOwner().getState(State::Energy).getPotentialEnergy();
+    // Compute the energy of the modified system.  A sub-percent trial scaling moves each atom
+    // by much less than the neighbor list padding, so the platforms' movement checks let this
+    // evaluation reuse the existing list instead of rebuilding it.
+
+    double finalEnergy = context.calcForcesAndEnergy(false, true);
     double pressure = context.getParameter(MonteCarloBarostat::Pressure())*(AVOGADRO*1e-25);
     double kT = BOLTZ*context.getParameter(MonteCarloBarostat::Temperature());
     double w = finalEnergy-initialEnergy + pressure*deltaVolume - context.getMolecules().size()*kT*std::log(newVolume/volume);
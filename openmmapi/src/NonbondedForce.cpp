@@ -34,6 +34,7 @@
 #include "openmm/NonbondedForce.h"
 #include "openmm/internal/AssertionUtilities.h"
 #include "openmm/internal/NonbondedForceImpl.h"
+#include <algorithm>
 #include <cmath>
 #include <map>
 #include <sstream>
@@ -49,7 +50,8 @@ using std::vector;
 
 NonbondedForce::NonbondedForce() : nonbondedMethod(NoCutoff), cutoffDistance(1.0), switchingDistance(-1.0), rfDielectric(78.3),
         ewaldErrorTol(5e-4), alpha(0.0), dalpha(0.0), useSwitchingFunction(false), useDispersionCorrection(true), recipForceGroup(-1),
-        nx(0), ny(0), nz(0), dnx(0), dny(0), dnz(0) {
+        nx(0), ny(0), nz(0), dnx(0), dny(0), dnz(0), firstChangedParticle(0), lastChangedParticle(-1), firstChangedException(0),
+        lastChangedException(-1), numContexts(0) {
 }
 
 NonbondedForce::NonbondedMethod NonbondedForce::getNonbondedMethod() const {
@@ -143,6 +145,16 @@ int NonbondedForce::addParticle(double charge, double sigma, double epsilon) {
     return particles.size()-1;
 }
 
+int NonbondedForce::addParticles(const vector<double>& charges, const vector<double>& sigmas, const vector<double>& epsilons) {
+    if (sigmas.size() != charges.size() || epsilons.size() != charges.size())
+        throw OpenMMException("NonbondedForce: addParticles() was called with arrays of different lengths");
+    int first = particles.size();
+    particles.reserve(particles.size()+charges.size());
+    for (int i = 0; i < (int) charges.size(); i++)
+        particles.push_back(ParticleInfo(charges[i], sigmas[i], epsilons[i]));
+    return first;
+}
+
 void NonbondedForce::getParticleParameters(int index, double& charge, double& sigma, double& epsilon) const {
     ASSERT_VALID_INDEX(index, particles);
     charge = particles[index].charge;
@@ -155,6 +167,12 @@ void NonbondedForce::setParticleParameters(int index, double charge, double sigm
     particles[index].charge = charge;
     particles[index].sigma = sigma;
     particles[index].epsilon = epsilon;
+    if (lastChangedParticle < firstChangedParticle)
+        firstChangedParticle = lastChangedParticle = index;
+    else {
+        firstChangedParticle = std::min(firstChangedParticle, index);
+        lastChangedParticle = std::max(lastChangedParticle, index);
+    }
 }
 
 int NonbondedForce::addException(int particle1, int particle2, double chargeProd, double sigma, double epsilon, bool replace) {
@@ -198,6 +216,12 @@ void NonbondedForce::setExceptionParameters(int index, int particle1, int partic
     exceptions[index].chargeProd = chargeProd;
     exceptions[index].sigma = sigma;
     exceptions[index].epsilon = epsilon;
+    if (lastChangedException < firstChangedException)
+        firstChangedException = lastChangedException = index;
+    else {
+        firstChangedException = std::min(firstChangedException, index);
+        lastChangedException = std::max(lastChangedException, index);
+    }
 }
 
 ForceImpl* NonbondedForce::createImpl() const {
@@ -267,5 +291,15 @@ void NonbondedForce::setReciprocalSpaceForceGroup(int group) {
 }
 
 void NonbondedForce::updateParametersInContext(Context& context) {
-    dynamic_cast<NonbondedForceImpl&>(getImplInContext(context)).updateParametersInContext(getContextImpl(context));
+    dynamic_cast<NonbondedForceImpl&>(getImplInContext(context)).updateParametersInContext(getContextImpl(context),
+            firstChangedParticle, lastChangedParticle, firstChangedException, lastChangedException);
+    if (numContexts == 1) {
+        // The changes have now been copied over to the only context that exists, so we can
+        // reset the tracking of changed parameters.
+
+        firstChangedParticle = particles.size();
+        lastChangedParticle = -1;
+        firstChangedException = exceptions.size();
+        lastChangedException = -1;
+    }
 }
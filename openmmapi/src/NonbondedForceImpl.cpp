@@ -45,9 +45,11 @@ using namespace OpenMM;
 using namespace std;
 
 NonbondedForceImpl::NonbondedForceImpl(const NonbondedForce& owner) : owner(owner) {
+    owner.numContexts++;
 }
 
 NonbondedForceImpl::~NonbondedForceImpl() {
+    owner.numContexts--;
 }
 
 void NonbondedForceImpl::initialize(ContextImpl& context) {
@@ -228,63 +230,124 @@ double NonbondedForceImpl::evalIntegral(double r, double rs, double rc, double s
 double NonbondedForceImpl::calcDispersionCorrection(const System& system, const NonbondedForce& force) {
     if (force.getNonbondedMethod() == NonbondedForce::NoCutoff || force.getNonbondedMethod() == NonbondedForce::CutoffNonPeriodic)
         return 0.0;
-    
+    LongRangeCorrectionData data = prepareLongRangeCorrection(force);
+    return calcLongRangeCorrection(data, force, system);
+}
+
+void NonbondedForceImpl::addLongRangeCorrectionTerms(LongRangeCorrectionData& data, const pair<double, double>& class1,
+        const pair<double, double>& class2, double count, bool useSwitch, double cutoff, double switchDist) {
+    double sigma = 0.5*(class1.first+class2.first);
+    double epsilon = sqrt(class1.second*class2.second);
+    double sigma2 = sigma*sigma;
+    double sigma6 = sigma2*sigma2*sigma2;
+    data.sum1 += count*epsilon*sigma6*sigma6;
+    data.sum2 += count*epsilon*sigma6;
+    if (useSwitch)
+        data.sum3 += count*epsilon*(evalIntegral(cutoff, switchDist, cutoff, sigma)-evalIntegral(switchDist, switchDist, cutoff, sigma));
+}
+
+NonbondedForceImpl::LongRangeCorrectionData NonbondedForceImpl::prepareLongRangeCorrection(const NonbondedForce& force) {
     // Identify all particle classes (defined by sigma and epsilon), and count the number of
     // particles in each class.
 
-    map<pair<double, double>, int> classCounts;
+    LongRangeCorrectionData data;
+    data.particleClass.resize(force.getNumParticles());
     for (int i = 0; i < force.getNumParticles(); i++) {
         double charge, sigma, epsilon;
         force.getParticleParameters(i, charge, sigma, epsilon);
         pair<double, double> key = make_pair(sigma, epsilon);
-        map<pair<double, double>, int>::iterator entry = classCounts.find(key);
-        if (entry == classCounts.end())
-            classCounts[key] = 1;
+        data.particleClass[i] = key;
+        map<pair<double, double>, int>::iterator entry = data.classCounts.find(key);
+        if (entry == data.classCounts.end())
+            data.classCounts[key] = 1;
         else
             entry->second++;
     }
 
-    // Loop over all pairs of classes to compute the coefficient.
+    // Loop over all pairs of classes to compute the sums.
 
-    double sum1 = 0, sum2 = 0, sum3 = 0;
     bool useSwitch = force.getUseSwitchingFunction();
     double cutoff = force.getCutoffDistance();
     double switchDist = force.getSwitchingDistance();
-    for (map<pair<double, double>, int>::const_iterator entry = classCounts.begin(); entry != classCounts.end(); ++entry) {
-        double sigma = entry->first.first;
-        double epsilon = entry->first.second;
+    for (map<pair<double, double>, int>::const_iterator entry = data.classCounts.begin(); entry != data.classCounts.end(); ++entry) {
         double count = (double) entry->second;
-        count *= (count + 1) / 2;
-        double sigma2 = sigma*sigma;
-        double sigma6 = sigma2*sigma2*sigma2;
-        sum1 += count*epsilon*sigma6*sigma6;
-        sum2 += count*epsilon*sigma6;
-        if (useSwitch)
-            sum3 += count*epsilon*(evalIntegral(cutoff, switchDist, cutoff, sigma)-evalIntegral(switchDist, switchDist, cutoff, sigma));
+        addLongRangeCorrectionTerms(data, entry->first, entry->first, count*(count+1)/2, useSwitch, cutoff, switchDist);
     }
-    for (map<pair<double, double>, int>::const_iterator class1 = classCounts.begin(); class1 != classCounts.end(); ++class1)
-        for (map<pair<double, double>, int>::const_iterator class2 = classCounts.begin(); class2 != class1; ++class2) {
-            double sigma = 0.5*(class1->first.first+class2->first.first);
-            double epsilon = sqrt(class1->first.second*class2->first.second);
+    for (map<pair<double, double>, int>::const_iterator class1 = data.classCounts.begin(); class1 != data.classCounts.end(); ++class1)
+        for (map<pair<double, double>, int>::const_iterator class2 = data.classCounts.begin(); class2 != class1; ++class2) {
             double count = (double) class1->second;
             count *= (double) class2->second;
-            double sigma2 = sigma*sigma;
-            double sigma6 = sigma2*sigma2*sigma2;
-            sum1 += count*epsilon*sigma6*sigma6;
-            sum2 += count*epsilon*sigma6;
-            if (useSwitch)
-                sum3 += count*epsilon*(evalIntegral(cutoff, switchDist, cutoff, sigma)-evalIntegral(switchDist, switchDist, cutoff, sigma));
+            addLongRangeCorrectionTerms(data, class1->first, class2->first, count, useSwitch, cutoff, switchDist);
+        }
+    return data;
+}
+
+void NonbondedForceImpl::updateLongRangeCorrection(LongRangeCorrectionData& data, const NonbondedForce& force, int firstParticle, int lastParticle) {
+    bool useSwitch = force.getUseSwitchingFunction();
+    double cutoff = force.getCutoffDistance();
+    double switchDist = force.getSwitchingDistance();
+
+    // Find the net change in the number of particles belonging to each class.
+
+    map<pair<double, double>, int> countChanges;
+    for (int i = firstParticle; i <= lastParticle; i++) {
+        double charge, sigma, epsilon;
+        force.getParticleParameters(i, charge, sigma, epsilon);
+        pair<double, double> key = make_pair(sigma, epsilon);
+        if (key != data.particleClass[i]) {
+            countChanges[data.particleClass[i]]--;
+            countChanges[key]++;
+            data.particleClass[i] = key;
         }
+    }
+
+    // Apply the changes one class at a time, adjusting the sums to match the new counts.
+    // This costs only O(changed classes * total classes), so an update that modifies a few
+    // particles is much faster than recomputing the correction from scratch.
+
+    for (map<pair<double, double>, int>::const_iterator change = countChanges.begin(); change != countChanges.end(); ++change) {
+        if (change->second == 0)
+            continue;
+        const pair<double, double>& key = change->first;
+        int oldCount = 0;
+        map<pair<double, double>, int>::iterator entry = data.classCounts.find(key);
+        if (entry != data.classCounts.end())
+            oldCount = entry->second;
+        int newCount = oldCount+change->second;
+
+        // Interactions of this class with itself.
+
+        double deltaPairs = 0.5*(((double) newCount)*(newCount+1) - ((double) oldCount)*(oldCount+1));
+        addLongRangeCorrectionTerms(data, key, key, deltaPairs, useSwitch, cutoff, switchDist);
+
+        // Interactions of this class with every other class.
+
+        for (map<pair<double, double>, int>::const_iterator other = data.classCounts.begin(); other != data.classCounts.end(); ++other) {
+            if (other->first == key)
+                continue;
+            addLongRangeCorrectionTerms(data, key, other->first, ((double) change->second)*other->second, useSwitch, cutoff, switchDist);
+        }
+        if (newCount == 0)
+            data.classCounts.erase(key);
+        else
+            data.classCounts[key] = newCount;
+    }
+}
+
+double NonbondedForceImpl::calcLongRangeCorrection(const LongRangeCorrectionData& data, const NonbondedForce& force, const System& system) {
+    if (force.getNonbondedMethod() == NonbondedForce::NoCutoff || force.getNonbondedMethod() == NonbondedForce::CutoffNonPeriodic)
+        return 0.0;
+    double cutoff = force.getCutoffDistance();
     double numParticles = (double) system.getNumParticles();
     double numInteractions = (numParticles*(numParticles+1))/2;
-    sum1 /= numInteractions;
-    sum2 /= numInteractions;
-    sum3 /= numInteractions;
+    double sum1 = data.sum1/numInteractions;
+    double sum2 = data.sum2/numInteractions;
+    double sum3 = data.sum3/numInteractions;
     return 8*numParticles*numParticles*M_PI*(sum1/(9*pow(cutoff, 9))-sum2/(3*pow(cutoff, 3))+sum3);
 }
 
-void NonbondedForceImpl::updateParametersInContext(ContextImpl& context) {
-    kernel.getAs<CalcNonbondedForceKernel>().copyParametersToContext(context, owner);
+void NonbondedForceImpl::updateParametersInContext(ContextImpl& context, int firstParticle, int lastParticle, int firstException, int lastException) {
+    kernel.getAs<CalcNonbondedForceKernel>().copyParametersToContext(context, owner, firstParticle, lastParticle, firstException, lastException);
     context.systemChanged();
 }
 
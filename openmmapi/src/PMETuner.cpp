@@ -0,0 +1,111 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2010-2018 Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "openmm/PMETuner.h"
+#include "openmm/OpenMMException.h"
+#include "openmm/State.h"
+#include "openmm/internal/ContextImpl.h"
+
+using namespace OpenMM;
+using namespace std;
+
+/**
+ * Get the current clock time, measured in microseconds.
+ */
+#ifdef _MSC_VER
+    #include <Windows.h>
+    static long long getTime() {
+        FILETIME ft;
+        GetSystemTimeAsFileTime(&ft); // 100-nanoseconds since 1-1-1601
+        ULARGE_INTEGER result;
+        result.LowPart = ft.dwLowDateTime;
+        result.HighPart = ft.dwHighDateTime;
+        return result.QuadPart/10;
+    }
+#else
+    #include <sys/time.h>
+    static long long getTime() {
+        struct timeval tod;
+        gettimeofday(&tod, 0);
+        return 1000000*tod.tv_sec+tod.tv_usec;
+    }
+#endif
+
+double PMETuner::tune(Context& context, NonbondedForce& force, double maxScale, int iterations) {
+    if (force.getNonbondedMethod() != NonbondedForce::PME && force.getNonbondedMethod() != NonbondedForce::LJPME)
+        throw OpenMMException("PMETuner: the NonbondedForce must use PME or LJPME");
+    double alpha;
+    int nx, ny, nz;
+    force.getPMEParameters(alpha, nx, ny, nz);
+    if (alpha != 0.0)
+        throw OpenMMException("PMETuner: the NonbondedForce specifies explicit PME parameters");
+    const System& system = context.getSystem();
+    bool foundForce = false;
+    for (int i = 0; i < system.getNumForces(); i++)
+        if (&system.getForce(i) == static_cast<const Force*>(&force))
+            foundForce = true;
+    if (!foundForce)
+        throw OpenMMException("PMETuner: the NonbondedForce is not part of the System");
+    if (maxScale < 1.0)
+        throw OpenMMException("PMETuner: maxScale must be at least 1.0");
+    if (iterations < 1)
+        throw OpenMMException("PMETuner: iterations must be at least 1");
+
+    // Record the state so it can be restored after each trial, then time a series of force
+    // evaluations for each candidate cutoff.  The alpha and grid size are rederived from the
+    // error tolerance each time the Context is reinitialized, so increasing the cutoff shifts
+    // work from the FFT to the direct space kernel at constant Coulomb accuracy.
+
+    State state = context.getState(State::Positions | State::Velocities | State::Parameters);
+    double originalCutoff = force.getCutoffDistance();
+    double bestCutoff = originalCutoff;
+    double bestTime = -1.0;
+    for (double scale = 1.0; scale < maxScale+1e-6; scale += 0.1) {
+        force.setCutoffDistance(originalCutoff*scale);
+        context.reinitialize();
+        context.setState(state);
+        ContextImpl& impl = context.getImpl();
+        for (int i = 0; i < 3; i++)
+            impl.calcForcesAndEnergy(true, true);
+        long long startTime = getTime();
+        for (int i = 0; i < iterations; i++)
+            impl.calcForcesAndEnergy(true, true); // Requesting the energy keeps the timing synchronous.
+        double time = (double) (getTime()-startTime);
+        if (bestTime < 0.0 || time < bestTime) {
+            bestTime = time;
+            bestCutoff = originalCutoff*scale;
+        }
+    }
+    force.setCutoffDistance(bestCutoff);
+    context.reinitialize();
+    context.setState(state);
+    return bestCutoff;
+}
@@ -136,9 +136,11 @@ double SplineFitter::evaluateSpline(const vector<double>& x, const vector<double
         else
             lower = middle;
     }
+    return evaluateSpline(x, y, deriv, lower, t);
+}
 
-    // Evaluate the spline.
-
+double SplineFitter::evaluateSpline(const vector<double>& x, const vector<double>& y, const vector<double>& deriv, int lower, double t) {
+    int upper = lower+1;
     double dx = x[upper]-x[lower];
     double a = (x[upper]-t)/dx;
     double b = 1.0-a;
@@ -161,9 +163,11 @@ double SplineFitter::evaluateSplineDerivative(const vector<double>& x, const vec
         else
             lower = middle;
     }
+    return evaluateSplineDerivative(x, y, deriv, lower, t);
+}
 
-    // Evaluate the spline.
-
+double SplineFitter::evaluateSplineDerivative(const vector<double>& x, const vector<double>& y, const vector<double>& deriv, int lower, double t) {
+    int upper = lower+1;
     double dx = x[upper]-x[lower];
     double a = (x[upper]-t)/dx;
     double b = 1.0-a;
@@ -171,6 +175,21 @@ double SplineFitter::evaluateSplineDerivative(const vector<double>& x, const vec
     return dadx*y[lower]-dadx*y[upper]+((1.0-3.0*a*a)*deriv[lower] + (3.0*b*b-1.0)*deriv[upper])*dx/6.0;
 }
 
+void SplineFitter::evaluateSplineDerivativesAtKnots(const vector<double>& x, const vector<double>& y, const vector<double>& deriv, vector<double>& knotDerivs) {
+    // Evaluating the derivative at a data point requires no searching, since the interval containing
+    // it is known, and the cubic terms vanish there.  This is much faster than calling
+    // evaluateSplineDerivative() once per point when fitting higher dimensional splines.
+
+    int n = x.size();
+    knotDerivs.resize(n);
+    for (int i = 0; i < n-1; i++) {
+        double dx = x[i+1]-x[i];
+        knotDerivs[i] = (y[i+1]-y[i])/dx - (2.0*deriv[i]+deriv[i+1])*dx/6.0;
+    }
+    double dx = x[n-1]-x[n-2];
+    knotDerivs[n-1] = (y[n-1]-y[n-2])/dx + (deriv[n-2]+2.0*deriv[n-1])*dx/6.0;
+}
+
 void SplineFitter::solveTridiagonalMatrix(const vector<double>& a, const vector<double>& b, const vector<double>& c, const vector<double>& rhs, vector<double>& sol) {
     int n = a.size();
     vector<double> gamma(n);
@@ -198,7 +217,7 @@ void SplineFitter::create2DNaturalSpline(const vector<double>& x, const vector<d
     if (values.size() != xsize*ysize)
         throw OpenMMException("create2DNaturalSpline: incorrect number of values");
     vector<double> d1(xsize*ysize), d2(xsize*ysize), d12(xsize*ysize);
-    vector<double> t(xsize), deriv(xsize);
+    vector<double> t(xsize), deriv(xsize), knotDeriv(xsize);
 
     // Compute derivatives with respect to x.
 
@@ -206,8 +225,9 @@ void SplineFitter::create2DNaturalSpline(const vector<double>& x, const vector<d
         for (int j = 0; j < xsize; j++)
             t[j] = values[j+xsize*i];
         SplineFitter::createNaturalSpline(x, t, deriv);
+        SplineFitter::evaluateSplineDerivativesAtKnots(x, t, deriv, knotDeriv);
         for (int j = 0; j < xsize; j++)
-            d1[j+xsize*i] = SplineFitter::evaluateSplineDerivative(x, t, deriv, x[j]);
+            d1[j+xsize*i] = knotDeriv[j];
     }
 
     // Compute derivatives with respect to y.
@@ -218,8 +238,9 @@ void SplineFitter::create2DNaturalSpline(const vector<double>& x, const vector<d
         for (int j = 0; j < ysize; j++)
             t[j] = values[i+xsize*j];
         SplineFitter::createNaturalSpline(y, t, deriv);
+        SplineFitter::evaluateSplineDerivativesAtKnots(y, t, deriv, knotDeriv);
         for (int j = 0; j < ysize; j++)
-            d2[i+xsize*j] = SplineFitter::evaluateSplineDerivative(y, t, deriv, y[j]);
+            d2[i+xsize*j] = knotDeriv[j];
     }
 
     // Compute cross derivatives.
@@ -230,8 +251,9 @@ void SplineFitter::create2DNaturalSpline(const vector<double>& x, const vector<d
         for (int j = 0; j < xsize; j++)
             t[j] = d2[j+xsize*i];
         SplineFitter::createNaturalSpline(x, t, deriv);
+        SplineFitter::evaluateSplineDerivativesAtKnots(x, t, deriv, knotDeriv);
         for (int j = 0; j < xsize; j++)
-            d12[j+xsize*i] = SplineFitter::evaluateSplineDerivative(x, t, deriv, x[j]);
+            d12[j+xsize*i] = knotDeriv[j];
     }
 
     // Now compute the coefficients.
@@ -313,8 +335,13 @@ double SplineFitter::evaluate2DSpline(const vector<double>& x, const vector<doub
         else
             lowery = middle;
     }
-    double deltax = x[upperx]-x[lowerx];
-    double deltay = y[uppery]-y[lowery];
+    return evaluate2DSpline(x, y, values, c, lowerx, lowery, u, v);
+}
+
+double SplineFitter::evaluate2DSpline(const vector<double>& x, const vector<double>& y, const vector<double>& values, const vector<vector<double> >& c, int lowerx, int lowery, double u, double v) {
+    int xsize = x.size();
+    double deltax = x[lowerx+1]-x[lowerx];
+    double deltay = y[lowery+1]-y[lowery];
     double da = (u-x[lowerx])/deltax;
     double db = (v-y[lowery])/deltay;
     const vector<double>& coeff = c[lowerx+(xsize-1)*lowery];
@@ -353,8 +380,13 @@ void SplineFitter::evaluate2DSplineDerivatives(const vector<double>& x, const ve
         else
             lowery = middle;
     }
-    double deltax = x[upperx]-x[lowerx];
-    double deltay = y[uppery]-y[lowery];
+    evaluate2DSplineDerivatives(x, y, values, c, lowerx, lowery, u, v, dx, dy);
+}
+
+void SplineFitter::evaluate2DSplineDerivatives(const vector<double>& x, const vector<double>& y, const vector<double>& values, const vector<vector<double> >& c, int lowerx, int lowery, double u, double v, double& dx, double &dy) {
+    int xsize = x.size();
+    double deltax = x[lowerx+1]-x[lowerx];
+    double deltay = y[lowery+1]-y[lowery];
     double da = (u-x[lowerx])/deltax;
     double db = (v-y[lowery])/deltay;
     const vector<double>& coeff = c[lowerx+(xsize-1)*lowery];
@@ -380,7 +412,7 @@ void SplineFitter::create3DNaturalSpline(const vector<double>& x, const vector<d
         throw OpenMMException("create2DNaturalSpline: incorrect number of values");
     vector<double> d1(xsize*ysize*zsize), d2(xsize*ysize*zsize), d3(xsize*ysize*zsize);
     vector<double> d12(xsize*ysize*zsize), d13(xsize*ysize*zsize), d23(xsize*ysize*zsize), d123(xsize*ysize*zsize);
-    vector<double> t(xsize), deriv(xsize);
+    vector<double> t(xsize), deriv(xsize), knotDeriv(xsize);
 
     // Compute derivatives with respect to x.
 
@@ -389,8 +421,9 @@ void SplineFitter::create3DNaturalSpline(const vector<double>& x, const vector<d
             for (int k = 0; k < xsize; k++)
                 t[k] = values[k+xsize*i+xysize*j];
             SplineFitter::createNaturalSpline(x, t, deriv);
+            SplineFitter::evaluateSplineDerivativesAtKnots(x, t, deriv, knotDeriv);
             for (int k = 0; k < xsize; k++)
-                d1[k+xsize*i+xysize*j] = SplineFitter::evaluateSplineDerivative(x, t, deriv, x[k]);
+                d1[k+xsize*i+xysize*j] = knotDeriv[k];
         }
     }
 
@@ -403,8 +436,9 @@ void SplineFitter::create3DNaturalSpline(const vector<double>& x, const vector<d
             for (int k = 0; k < ysize; k++)
                 t[k] = values[i+xsize*k+xysize*j];
             SplineFitter::createNaturalSpline(y, t, deriv);
+            SplineFitter::evaluateSplineDerivativesAtKnots(y, t, deriv, knotDeriv);
             for (int k = 0; k < ysize; k++)
-                d2[i+xsize*k+xysize*j] = SplineFitter::evaluateSplineDerivative(y, t, deriv, y[k]);
+                d2[i+xsize*k+xysize*j] = knotDeriv[k];
         }
     }
 
@@ -417,8 +451,9 @@ void SplineFitter::create3DNaturalSpline(const vector<double>& x, const vector<d
             for (int k = 0; k < zsize; k++)
                 t[k] = values[i+xsize*j+xysize*k];
             SplineFitter::createNaturalSpline(z, t, deriv);
+            SplineFitter::evaluateSplineDerivativesAtKnots(z, t, deriv, knotDeriv);
             for (int k = 0; k < zsize; k++)
-                d3[i+xsize*j+xysize*k] = SplineFitter::evaluateSplineDerivative(z, t, deriv, z[k]);
+                d3[i+xsize*j+xysize*k] = knotDeriv[k];
         }
     }
 
@@ -431,8 +466,9 @@ void SplineFitter::create3DNaturalSpline(const vector<double>& x, const vector<d
             for (int k = 0; k < xsize; k++)
                 t[k] = d2[k+xsize*i+xysize*j];
             SplineFitter::createNaturalSpline(x, t, deriv);
+            SplineFitter::evaluateSplineDerivativesAtKnots(x, t, deriv, knotDeriv);
             for (int k = 0; k < xsize; k++)
-                d12[k+xsize*i+xysize*j] = SplineFitter::evaluateSplineDerivative(x, t, deriv, x[k]);
+                d12[k+xsize*i+xysize*j] = knotDeriv[k];
         }
     }
 
@@ -445,8 +481,9 @@ void SplineFitter::create3DNaturalSpline(const vector<double>& x, const vector<d
             for (int k = 0; k < ysize; k++)
                 t[k] = d3[j+xsize*k+xysize*i];
             SplineFitter::createNaturalSpline(y, t, deriv);
+            SplineFitter::evaluateSplineDerivativesAtKnots(y, t, deriv, knotDeriv);
             for (int k = 0; k < ysize; k++)
-                d23[j+xsize*k+xysize*i] = SplineFitter::evaluateSplineDerivative(y, t, deriv, y[k]);
+                d23[j+xsize*k+xysize*i] = knotDeriv[k];
         }
     }
 
@@ -459,8 +496,9 @@ void SplineFitter::create3DNaturalSpline(const vector<double>& x, const vector<d
             for (int k = 0; k < zsize; k++)
                 t[k] = d1[i+xsize*j+xysize*k];
             SplineFitter::createNaturalSpline(z, t, deriv);
+            SplineFitter::evaluateSplineDerivativesAtKnots(z, t, deriv, knotDeriv);
             for (int k = 0; k < zsize; k++)
-                d13[i+xsize*j+xysize*k] = SplineFitter::evaluateSplineDerivative(z, t, deriv, z[k]);
+                d13[i+xsize*j+xysize*k] = knotDeriv[k];
         }
     }
 
@@ -473,8 +511,9 @@ void SplineFitter::create3DNaturalSpline(const vector<double>& x, const vector<d
             for (int k = 0; k < xsize; k++)
                 t[k] = d23[k+xsize*i+xysize*j];
             SplineFitter::createNaturalSpline(x, t, deriv);
+            SplineFitter::evaluateSplineDerivativesAtKnots(x, t, deriv, knotDeriv);
             for (int k = 0; k < xsize; k++)
-                d123[k+xsize*i+xysize*j] = SplineFitter::evaluateSplineDerivative(x, t, deriv, x[k]);
+                d123[k+xsize*i+xysize*j] = knotDeriv[k];
         }
     }
 
@@ -637,9 +676,15 @@ double SplineFitter::evaluate3DSpline(const vector<double>& x, const vector<doub
         else
             lowerz = middle;
     }
-    double deltax = x[upperx]-x[lowerx];
-    double deltay = y[uppery]-y[lowery];
-    double deltaz = z[upperz]-z[lowerz];
+    return evaluate3DSpline(x, y, z, values, c, lowerx, lowery, lowerz, u, v, w);
+}
+
+double SplineFitter::evaluate3DSpline(const vector<double>& x, const vector<double>& y, const vector<double>& z, const vector<double>& values, const vector<vector<double> >& c, int lowerx, int lowery, int lowerz, double u, double v, double w) {
+    int xsize = x.size();
+    int ysize = y.size();
+    double deltax = x[lowerx+1]-x[lowerx];
+    double deltay = y[lowery+1]-y[lowery];
+    double deltaz = z[lowerz+1]-z[lowerz];
     double da = (u-x[lowerx])/deltax;
     double db = (v-y[lowery])/deltay;
     double dc = (w-z[lowerz])/deltaz;
@@ -693,9 +738,15 @@ void SplineFitter::evaluate3DSplineDerivatives(const vector<double>& x, const ve
         else
             lowerz = middle;
     }
-    double deltax = x[upperx]-x[lowerx];
-    double deltay = y[uppery]-y[lowery];
-    double deltaz = z[upperz]-z[lowerz];
+    evaluate3DSplineDerivatives(x, y, z, values, c, lowerx, lowery, lowerz, u, v, w, dx, dy, dz);
+}
+
+void SplineFitter::evaluate3DSplineDerivatives(const vector<double>& x, const vector<double>& y, const vector<double>& z, const vector<double>& values, const vector<vector<double> >& c, int lowerx, int lowery, int lowerz, double u, double v, double w, double& dx, double& dy, double& dz) {
+    int xsize = x.size();
+    int ysize = y.size();
+    double deltax = x[lowerx+1]-x[lowerx];
+    double deltay = y[lowery+1]-y[lowery];
+    double deltaz = z[lowerz+1]-z[lowerz];
     double da = (u-x[lowerx])/deltax;
     double db = (v-y[lowery])/deltay;
     double dc = (w-z[lowerz])/deltaz;
@@ -31,6 +31,7 @@
 
 #include "openmm/OpenMMException.h"
 #include "openmm/State.h"
+#include <utility>
 
 using namespace OpenMM;
 using namespace std;
@@ -81,6 +82,11 @@ const map<string, double>& State::getEnergyParameterDerivatives() const {
         throw OpenMMException("Invoked getEnergyParameterDerivatives() on a State which does not contain parameter derivatives.");
     return energyParameterDerivatives;
 }
+const map<int, double>& State::getEnergiesByForceGroup() const {
+    if ((types&GroupEnergies) == 0)
+        throw OpenMMException("Invoked getEnergiesByForceGroup() on a State which does not contain energies by force group.");
+    return groupEnergies;
+}
 int State::getDataTypes() const {
     return types;
 }
@@ -88,31 +94,36 @@ State::State(double time) : types(0), time(time), ke(0), pe(0) {
 }
 State::State() : types(0), time(0.0), ke(0), pe(0) {
 }
-void State::setPositions(const std::vector<Vec3>& pos) {
-    positions = pos;
+void State::setPositions(std::vector<Vec3>& pos) {
+    positions.swap(pos);
     types |= Positions;
 }
 
-void State::setVelocities(const std::vector<Vec3>& vel) {
-    velocities = vel;
+void State::setVelocities(std::vector<Vec3>& vel) {
+    velocities.swap(vel);
     types |= Velocities;
 }
 
-void State::setForces(const std::vector<Vec3>& force) {
-    forces = force;
+void State::setForces(std::vector<Vec3>& force) {
+    forces.swap(force);
     types |= Forces;
 }
 
-void State::setParameters(const std::map<std::string, double>& params) {
-    parameters = params;
+void State::setParameters(std::map<std::string, double>& params) {
+    parameters.swap(params);
     types |= Parameters;
 }
 
-void State::setEnergyParameterDerivatives(const std::map<std::string, double>& derivs) {
-    energyParameterDerivatives = derivs;
+void State::setEnergyParameterDerivatives(std::map<std::string, double>& derivs) {
+    energyParameterDerivatives.swap(derivs);
     types |= ParameterDerivatives;
 }
 
+void State::setEnergiesByForceGroup(std::map<int, double>& energies) {
+    groupEnergies.swap(energies);
+    types |= GroupEnergies;
+}
+
 void State::setEnergy(double kinetic, double potential) {
     ke = kinetic;
     pe = potential;
@@ -129,29 +140,33 @@ State::StateBuilder::StateBuilder(double time) : state(time) {
 }
 
 State State::StateBuilder::getState() {
-    return state;
+    return std::move(state);
 }
 
-void State::StateBuilder::setPositions(const std::vector<Vec3>& pos) {
+void State::StateBuilder::setPositions(std::vector<Vec3>& pos) {
     state.setPositions(pos);
 }
 
-void State::StateBuilder::setVelocities(const std::vector<Vec3>& vel) {
+void State::StateBuilder::setVelocities(std::vector<Vec3>& vel) {
     state.setVelocities(vel);
 }
 
-void State::StateBuilder::setForces(const std::vector<Vec3>& force) {
+void State::StateBuilder::setForces(std::vector<Vec3>& force) {
     state.setForces(force);
 }
 
-void State::StateBuilder::setParameters(const std::map<std::string, double>& params) {
+void State::StateBuilder::setParameters(std::map<std::string, double>& params) {
     state.setParameters(params);
 }
 
-void State::StateBuilder::setEnergyParameterDerivatives(const std::map<std::string, double>& derivs) {
+void State::StateBuilder::setEnergyParameterDerivatives(std::map<std::string, double>& derivs) {
     state.setEnergyParameterDerivatives(derivs);
 }
 
+void State::StateBuilder::setEnergiesByForceGroup(std::map<int, double>& energies) {
+    state.setEnergiesByForceGroup(energies);
+}
+
 void State::StateBuilder::setEnergy(double ke, double pe) {
     state.setEnergy(ke, pe);
 }
@@ -31,10 +31,12 @@
 
 #include "openmm/Force.h"
 #include "openmm/OpenMMException.h"
+#include "openmm/Force.h"
 #include "openmm/System.h"
 #include "openmm/VirtualSite.h"
 #include "openmm/internal/AssertionUtilities.h"
 #include <cmath>
+#include <typeinfo>
 
 using namespace OpenMM;
 
@@ -44,6 +46,10 @@ System::System() {
     periodicBoxVectors[2] = Vec3(0, 0, 2);
 }
 
+System::System(const System& other) {
+    *this = other;
+}
+
 System::~System() {
     for (auto force : forces)
         delete force;
@@ -51,6 +57,40 @@ System::~System() {
         delete site;
 }
 
+static VirtualSite* copyVirtualSite(const VirtualSite& site) {
+    if (typeid(site) == typeid(TwoParticleAverageSite))
+        return new TwoParticleAverageSite(dynamic_cast<const TwoParticleAverageSite&>(site));
+    if (typeid(site) == typeid(ThreeParticleAverageSite))
+        return new ThreeParticleAverageSite(dynamic_cast<const ThreeParticleAverageSite&>(site));
+    if (typeid(site) == typeid(OutOfPlaneSite))
+        return new OutOfPlaneSite(dynamic_cast<const OutOfPlaneSite&>(site));
+    if (typeid(site) == typeid(LocalCoordinatesSite))
+        return new LocalCoordinatesSite(dynamic_cast<const LocalCoordinatesSite&>(site));
+    throw OpenMMException("Unknown virtual site type");
+}
+
+System& System::operator=(const System& other) {
+    if (this == &other)
+        return *this;
+    for (auto force : forces)
+        delete force;
+    for (auto site : virtualSites)
+        delete site;
+    forces.clear();
+    virtualSites.clear();
+    for (int i = 0; i < 3; i++)
+        periodicBoxVectors[i] = other.periodicBoxVectors[i];
+    masses = other.masses;
+    constraints = other.constraints;
+    for (auto force : other.forces)
+        forces.push_back(force->copy());
+    virtualSites.resize(other.virtualSites.size(), NULL);
+    for (int i = 0; i < (int) other.virtualSites.size(); i++)
+        if (other.virtualSites[i] != NULL)
+            virtualSites[i] = copyVirtualSite(*other.virtualSites[i]);
+    return *this;
+}
+
 double System::getParticleMass(int index) const {
     ASSERT_VALID_INDEX(index, masses);
     return masses[index];
@@ -0,0 +1,292 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "openmm/SystemBatch.h"
+#include "openmm/CMMotionRemover.h"
+#include "openmm/Context.h"
+#include "openmm/GBSAOBCForce.h"
+#include "openmm/HarmonicAngleForce.h"
+#include "openmm/HarmonicBondForce.h"
+#include "openmm/NonbondedForce.h"
+#include "openmm/OpenMMException.h"
+#include "openmm/PeriodicTorsionForce.h"
+#include "openmm/RBTorsionForce.h"
+#include <cmath>
+
+using namespace OpenMM;
+using namespace std;
+
+SystemBatch::SystemBatch(double spacing) : spacing(spacing), nonbonded(NULL), obc(NULL),
+        bonds(NULL), angles(NULL), periodicTorsions(NULL), rbTorsions(NULL) {
+    if (spacing <= 0.0)
+        throw OpenMMException("SystemBatch: spacing must be positive");
+}
+
+int SystemBatch::addSystem(const System& system) {
+    int offset = combinedSystem.getNumParticles();
+    for (int i = 0; i < system.getNumParticles(); i++) {
+        if (system.isVirtualSite(i))
+            throw OpenMMException("SystemBatch: systems with virtual sites are not supported");
+        combinedSystem.addParticle(system.getParticleMass(i));
+    }
+    for (int i = 0; i < system.getNumConstraints(); i++) {
+        int particle1, particle2;
+        double distance;
+        system.getConstraintParameters(i, particle1, particle2, distance);
+        combinedSystem.addConstraint(particle1+offset, particle2+offset, distance);
+    }
+    for (int i = 0; i < system.getNumForces(); i++)
+        addForce(system.getForce(i), offset);
+    // A NonbondedForce must cover every particle in the System, so pad it with particles
+    // that have no charge and no Lennard-Jones interaction for any system that did not
+    // contain one.  A GBSAOBCForce cannot be padded that way, since even an uncharged
+    // particle contributes to the surface area energy.
+
+    if (nonbonded != NULL)
+        while (nonbonded->getNumParticles() < combinedSystem.getNumParticles())
+            nonbonded->addParticle(0.0, 1.0, 0.0);
+    if (obc != NULL && obc->getNumParticles() != combinedSystem.getNumParticles())
+        throw OpenMMException("SystemBatch: if any system contains a GBSAOBCForce, every system must contain one");
+    firstParticle.push_back(offset);
+    return (int) firstParticle.size()-1;
+}
+
+void SystemBatch::addForce(const Force& force, int offset) {
+    if (dynamic_cast<const NonbondedForce*>(&force) != NULL) {
+        const NonbondedForce& nb = dynamic_cast<const NonbondedForce&>(force);
+        if (nb.getNonbondedMethod() != NonbondedForce::CutoffNonPeriodic)
+            throw OpenMMException("SystemBatch: every NonbondedForce must use CutoffNonPeriodic as its nonbonded method");
+        if (nonbonded == NULL) {
+            nonbonded = new NonbondedForce();
+            nonbonded->setForceGroup(nb.getForceGroup());
+            nonbonded->setNonbondedMethod(NonbondedForce::CutoffNonPeriodic);
+            nonbonded->setCutoffDistance(nb.getCutoffDistance());
+            nonbonded->setReactionFieldDielectric(nb.getReactionFieldDielectric());
+            nonbonded->setUseSwitchingFunction(nb.getUseSwitchingFunction());
+            nonbonded->setSwitchingDistance(nb.getSwitchingDistance());
+            combinedSystem.addForce(nonbonded);
+        }
+        else if (nb.getCutoffDistance() != nonbonded->getCutoffDistance() ||
+                 nb.getReactionFieldDielectric() != nonbonded->getReactionFieldDielectric() ||
+                 nb.getUseSwitchingFunction() != nonbonded->getUseSwitchingFunction() ||
+                 (nb.getUseSwitchingFunction() && nb.getSwitchingDistance() != nonbonded->getSwitchingDistance()))
+            throw OpenMMException("SystemBatch: every NonbondedForce must have identical settings so they can be merged");
+        while (nonbonded->getNumParticles() < offset)
+            nonbonded->addParticle(0.0, 1.0, 0.0);
+        for (int i = 0; i < nb.getNumParticles(); i++) {
+            double charge, sigma, epsilon;
+            nb.getParticleParameters(i, charge, sigma, epsilon);
+            nonbonded->addParticle(charge, sigma, epsilon);
+        }
+        for (int i = 0; i < nb.getNumExceptions(); i++) {
+            int particle1, particle2;
+            double chargeProd, sigma, epsilon;
+            nb.getExceptionParameters(i, particle1, particle2, chargeProd, sigma, epsilon);
+            nonbonded->addException(particle1+offset, particle2+offset, chargeProd, sigma, epsilon);
+        }
+    }
+    else if (dynamic_cast<const GBSAOBCForce*>(&force) != NULL) {
+        const GBSAOBCForce& gb = dynamic_cast<const GBSAOBCForce&>(force);
+        if (gb.getNonbondedMethod() != GBSAOBCForce::CutoffNonPeriodic)
+            throw OpenMMException("SystemBatch: every GBSAOBCForce must use CutoffNonPeriodic as its nonbonded method");
+        if (obc == NULL) {
+            obc = new GBSAOBCForce();
+            obc->setForceGroup(gb.getForceGroup());
+            obc->setNonbondedMethod(GBSAOBCForce::CutoffNonPeriodic);
+            obc->setCutoffDistance(gb.getCutoffDistance());
+            obc->setSoluteDielectric(gb.getSoluteDielectric());
+            obc->setSolventDielectric(gb.getSolventDielectric());
+            obc->setSurfaceAreaEnergy(gb.getSurfaceAreaEnergy());
+            combinedSystem.addForce(obc);
+        }
+        else if (gb.getCutoffDistance() != obc->getCutoffDistance() ||
+                 gb.getSoluteDielectric() != obc->getSoluteDielectric() ||
+                 gb.getSolventDielectric() != obc->getSolventDielectric() ||
+                 gb.getSurfaceAreaEnergy() != obc->getSurfaceAreaEnergy())
+            throw OpenMMException("SystemBatch: every GBSAOBCForce must have identical settings so they can be merged");
+        for (int i = 0; i < gb.getNumParticles(); i++) {
+            double charge, radius, scalingFactor;
+            gb.getParticleParameters(i, charge, radius, scalingFactor);
+            obc->addParticle(charge, radius, scalingFactor);
+        }
+    }
+    else if (dynamic_cast<const HarmonicBondForce*>(&force) != NULL) {
+        const HarmonicBondForce& hb = dynamic_cast<const HarmonicBondForce&>(force);
+        if (bonds == NULL) {
+            bonds = new HarmonicBondForce();
+            bonds->setForceGroup(hb.getForceGroup());
+            combinedSystem.addForce(bonds);
+        }
+        for (int i = 0; i < hb.getNumBonds(); i++) {
+            int particle1, particle2;
+            double length, k;
+            hb.getBondParameters(i, particle1, particle2, length, k);
+            bonds->addBond(particle1+offset, particle2+offset, length, k);
+        }
+    }
+    else if (dynamic_cast<const HarmonicAngleForce*>(&force) != NULL) {
+        const HarmonicAngleForce& ha = dynamic_cast<const HarmonicAngleForce&>(force);
+        if (angles == NULL) {
+            angles = new HarmonicAngleForce();
+            angles->setForceGroup(ha.getForceGroup());
+            combinedSystem.addForce(angles);
+        }
+        for (int i = 0; i < ha.getNumAngles(); i++) {
+            int particle1, particle2, particle3;
+            double angle, k;
+            ha.getAngleParameters(i, particle1, particle2, particle3, angle, k);
+            angles->addAngle(particle1+offset, particle2+offset, particle3+offset, angle, k);
+        }
+    }
+    else if (dynamic_cast<const PeriodicTorsionForce*>(&force) != NULL) {
+        const PeriodicTorsionForce& pt = dynamic_cast<const PeriodicTorsionForce&>(force);
+        if (periodicTorsions == NULL) {
+            periodicTorsions = new PeriodicTorsionForce();
+            periodicTorsions->setForceGroup(pt.getForceGroup());
+            combinedSystem.addForce(periodicTorsions);
+        }
+        for (int i = 0; i < pt.getNumTorsions(); i++) {
+            int particle1, particle2, particle3, particle4, periodicity;
+            double phase, k;
+            pt.getTorsionParameters(i, particle1, particle2, particle3, particle4, periodicity, phase, k);
+            periodicTorsions->addTorsion(particle1+offset, particle2+offset, particle3+offset, particle4+offset, periodicity, phase, k);
+        }
+    }
+    else if (dynamic_cast<const RBTorsionForce*>(&force) != NULL) {
+        const RBTorsionForce& rb = dynamic_cast<const RBTorsionForce&>(force);
+        if (rbTorsions == NULL) {
+            rbTorsions = new RBTorsionForce();
+            rbTorsions->setForceGroup(rb.getForceGroup());
+            combinedSystem.addForce(rbTorsions);
+        }
+        for (int i = 0; i < rb.getNumTorsions(); i++) {
+            int particle1, particle2, particle3, particle4;
+            double c0, c1, c2, c3, c4, c5;
+            rb.getTorsionParameters(i, particle1, particle2, particle3, particle4, c0, c1, c2, c3, c4, c5);
+            rbTorsions->addTorsion(particle1+offset, particle2+offset, particle3+offset, particle4+offset, c0, c1, c2, c3, c4, c5);
+        }
+    }
+    else if (dynamic_cast<const CMMotionRemover*>(&force) != NULL) {
+        // Removing the center of mass motion of the combined System would couple the
+        // systems together, so just skip it.
+    }
+    else
+        throw OpenMMException("SystemBatch: unsupported Force type");
+}
+
+int SystemBatch::getNumSystems() const {
+    return (int) firstParticle.size();
+}
+
+System& SystemBatch::getCombinedSystem() {
+    return combinedSystem;
+}
+
+const System& SystemBatch::getCombinedSystem() const {
+    return combinedSystem;
+}
+
+int SystemBatch::getFirstParticle(int index) const {
+    if (index < 0 || index >= (int) firstParticle.size())
+        throw OpenMMException("SystemBatch: system index out of range");
+    return firstParticle[index];
+}
+
+int SystemBatch::getNumParticles(int index) const {
+    if (index < 0 || index >= (int) firstParticle.size())
+        throw OpenMMException("SystemBatch: system index out of range");
+    int next = (index == (int) firstParticle.size()-1 ? combinedSystem.getNumParticles() : firstParticle[index+1]);
+    return next-firstParticle[index];
+}
+
+Vec3 SystemBatch::getOffset(int index) const {
+    if (index < 0 || index >= (int) firstParticle.size())
+        throw OpenMMException("SystemBatch: system index out of range");
+    int gridSize = (int) ceil(pow((double) firstParticle.size(), 1.0/3.0));
+    return Vec3(index%gridSize, (index/gridSize)%gridSize, index/(gridSize*gridSize))*spacing;
+}
+
+void SystemBatch::setPositions(Context& context, const vector<vector<Vec3> >& positions) const {
+    if (positions.size() != firstParticle.size())
+        throw OpenMMException("SystemBatch: wrong number of systems in positions");
+    double cutoff = (nonbonded == NULL ? 0.0 : nonbonded->getCutoffDistance());
+    if (obc != NULL)
+        cutoff = max(cutoff, obc->getCutoffDistance());
+    vector<Vec3> combined(combinedSystem.getNumParticles());
+    for (int i = 0; i < (int) positions.size(); i++) {
+        if ((int) positions[i].size() != getNumParticles(i))
+            throw OpenMMException("SystemBatch: wrong number of positions for system");
+        Vec3 offset = getOffset(i);
+        Vec3 minPos, maxPos;
+        for (int j = 0; j < (int) positions[i].size(); j++) {
+            const Vec3& pos = positions[i][j];
+            if (j == 0)
+                minPos = maxPos = pos;
+            for (int k = 0; k < 3; k++) {
+                minPos[k] = min(minPos[k], pos[k]);
+                maxPos[k] = max(maxPos[k], pos[k]);
+            }
+            combined[firstParticle[i]+j] = pos+offset;
+        }
+        for (int k = 0; k < 3; k++)
+            if (maxPos[k]-minPos[k] > spacing-cutoff)
+                throw OpenMMException("SystemBatch: a system is too large for the lattice spacing to keep it isolated from its neighbors");
+    }
+    context.setPositions(combined);
+}
+
+void SystemBatch::getPositions(const State& state, int index, vector<Vec3>& positions) const {
+    int first = getFirstParticle(index);
+    int numParticles = getNumParticles(index);
+    Vec3 offset = getOffset(index);
+    const vector<Vec3>& all = state.getPositions();
+    positions.resize(numParticles);
+    for (int i = 0; i < numParticles; i++)
+        positions[i] = all[first+i]-offset;
+}
+
+void SystemBatch::getVelocities(const State& state, int index, vector<Vec3>& velocities) const {
+    int first = getFirstParticle(index);
+    int numParticles = getNumParticles(index);
+    const vector<Vec3>& all = state.getVelocities();
+    velocities.resize(numParticles);
+    for (int i = 0; i < numParticles; i++)
+        velocities[i] = all[first+i];
+}
+
+void SystemBatch::getForces(const State& state, int index, vector<Vec3>& forces) const {
+    int first = getFirstParticle(index);
+    int numParticles = getNumParticles(index);
+    const vector<Vec3>& all = state.getForces();
+    forces.resize(numParticles);
+    for (int i = 0; i < numParticles; i++)
+        forces[i] = all[first+i];
+}
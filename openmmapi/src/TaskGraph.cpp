@@ -0,0 +1,137 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2018 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "openmm/internal/TaskGraph.h"
+#include "openmm/OpenMMException.h"
+#include <sched.h>
+
+using namespace std;
+
+namespace OpenMM {
+
+TaskGraph::TaskGraph(ThreadPool& threads) : threads(threads), numCompleted(0) {
+    queues.resize(threads.getNumThreads());
+    queueLocks.resize(threads.getNumThreads());
+    for (auto& queueLock : queueLocks)
+        pthread_mutex_init(&queueLock, NULL);
+    pthread_mutex_init(&graphLock, NULL);
+}
+
+TaskGraph::~TaskGraph() {
+    for (auto& queueLock : queueLocks)
+        pthread_mutex_destroy(&queueLock);
+    pthread_mutex_destroy(&graphLock);
+}
+
+int TaskGraph::addTask(function<void ()> task) {
+    return addTask(task, vector<int>());
+}
+
+int TaskGraph::addTask(function<void ()> task, const vector<int>& dependencies) {
+    int index = tasks.size();
+    tasks.push_back(TaskInfo(task));
+    for (int dependency : dependencies) {
+        if (dependency < 0 || dependency >= index)
+            throw OpenMMException("TaskGraph: a task may only depend on tasks that were added before it");
+        tasks[dependency].dependents.push_back(index);
+        tasks[index].remainingDependencies++;
+    }
+    return index;
+}
+
+int TaskGraph::getNumTasks() const {
+    return tasks.size();
+}
+
+void TaskGraph::execute() {
+    if (tasks.size() == 0)
+        return;
+    numCompleted = 0;
+    int numThreads = threads.getNumThreads();
+    for (int i = 0, nextQueue = 0; i < (int) tasks.size(); i++)
+        if (tasks[i].remainingDependencies == 0)
+            queues[nextQueue++%numThreads].push_back(i);
+    threads.execute([&] (ThreadPool& pool, int threadIndex) {
+        runThread(threadIndex);
+    });
+    threads.waitForThreads();
+    tasks.clear();
+}
+
+void TaskGraph::runThread(int threadIndex) {
+    int numTasks = tasks.size();
+    int numThreads = threads.getNumThreads();
+    while (numCompleted < numTasks) {
+        // Look for a task to run, first in this thread's own queue and then by stealing
+        // from the other threads' queues.
+
+        int taskIndex = -1;
+        for (int i = 0; i < numThreads && taskIndex == -1; i++) {
+            int queueIndex = (threadIndex+i)%numThreads;
+            pthread_mutex_lock(&queueLocks[queueIndex]);
+            if (!queues[queueIndex].empty()) {
+                if (queueIndex == threadIndex) {
+                    taskIndex = queues[queueIndex].back();
+                    queues[queueIndex].pop_back();
+                }
+                else {
+                    taskIndex = queues[queueIndex].front();
+                    queues[queueIndex].pop_front();
+                }
+            }
+            pthread_mutex_unlock(&queueLocks[queueIndex]);
+        }
+        if (taskIndex == -1) {
+            // Nothing is ready to run right now.  Give other threads a chance to finish
+            // the tasks we are waiting on.
+
+            sched_yield();
+            continue;
+        }
+        tasks[taskIndex].task();
+
+        // Mark the task as finished, and add any tasks that just became ready to this
+        // thread's queue.
+
+        pthread_mutex_lock(&graphLock);
+        for (int dependent : tasks[taskIndex].dependents) {
+            if (--tasks[dependent].remainingDependencies == 0) {
+                pthread_mutex_lock(&queueLocks[threadIndex]);
+                queues[threadIndex].push_back(dependent);
+                pthread_mutex_unlock(&queueLocks[threadIndex]);
+            }
+        }
+        numCompleted++;
+        pthread_mutex_unlock(&graphLock);
+    }
+}
+
+} // namespace OpenMM
@@ -0,0 +1,106 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "openmm/TrajectoryWriter.h"
+#include "openmm/OpenMMException.h"
+#include "openmm/internal/ContextImpl.h"
+
+using namespace OpenMM;
+using namespace std;
+
+TrajectoryWriter::TrajectoryWriter(const string& filename) : pendingTime(0.0), hasPendingFrame(false), hasWrittenHeader(false), isDeleted(false) {
+    file.open(filename.c_str(), ios::out|ios::binary|ios::trunc);
+    if (!file.is_open())
+        throw OpenMMException("TrajectoryWriter: unable to open file "+filename);
+    workerThread = thread(&TrajectoryWriter::threadBody, this);
+}
+
+TrajectoryWriter::~TrajectoryWriter() {
+    {
+        unique_lock<mutex> ul(lock);
+        while (hasPendingFrame)
+            frameWritten.wait(ul);
+        isDeleted = true;
+    }
+    frameReady.notify_one();
+    workerThread.join();
+    file.close();
+}
+
+void TrajectoryWriter::writeFrame(Context& context) {
+    ContextImpl& impl = context.getImpl();
+    impl.beginGetPositions();
+    double time = impl.getTime();
+    Vec3 box[3];
+    impl.getPeriodicBoxVectors(box[0], box[1], box[2]);
+
+    // Wait until the previous frame has been written so its buffer can be reused.  The
+    // download begun above continues while we wait.
+
+    unique_lock<mutex> ul(lock);
+    while (hasPendingFrame)
+        frameWritten.wait(ul);
+    if (!file.good())
+        throw OpenMMException("TrajectoryWriter: error writing to file");
+    if (!hasWrittenHeader) {
+        writeHeader(context.getSystem().getNumParticles());
+        hasWrittenHeader = true;
+    }
+    impl.finishGetPositions(pendingPositions);
+    pendingTime = time;
+    for (int i = 0; i < 3; i++)
+        pendingBoxVectors[i] = box[i];
+    hasPendingFrame = true;
+    ul.unlock();
+    frameReady.notify_one();
+}
+
+void TrajectoryWriter::flush() {
+    unique_lock<mutex> ul(lock);
+    while (hasPendingFrame)
+        frameWritten.wait(ul);
+    file.flush();
+    if (!file.good())
+        throw OpenMMException("TrajectoryWriter: error writing to file");
+}
+
+void TrajectoryWriter::threadBody() {
+    unique_lock<mutex> ul(lock);
+    while (true) {
+        while (!hasPendingFrame && !isDeleted)
+            frameReady.wait(ul);
+        if (!hasPendingFrame)
+            break;
+        writeFrameData(pendingTime, pendingBoxVectors, pendingPositions);
+        hasPendingFrame = false;
+        frameWritten.notify_all();
+    }
+}
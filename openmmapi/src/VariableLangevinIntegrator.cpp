@@ -82,6 +82,7 @@ void VariableLangevinIntegrator::step(int steps) {
         context->calcForcesAndEnergy(true, false);
         setStepSize(kernel.getAs<IntegrateVariableLangevinStepKernel>().execute(*context, *this, std::numeric_limits<double>::infinity()));
     }
+    context->invalidateEnergyCache();
 }
 
 void VariableLangevinIntegrator::stepTo(double time) {
@@ -92,4 +93,5 @@ void VariableLangevinIntegrator::stepTo(double time) {
         context->calcForcesAndEnergy(true, false);
         setStepSize(kernel.getAs<IntegrateVariableLangevinStepKernel>().execute(*context, *this, time));
     }
+    context->invalidateEnergyCache();
 }
@@ -77,6 +77,7 @@ void VariableVerletIntegrator::step(int steps) {
         context->calcForcesAndEnergy(true, false);
         setStepSize(kernel.getAs<IntegrateVariableVerletStepKernel>().execute(*context, *this, std::numeric_limits<double>::infinity()));
     }
+    context->invalidateEnergyCache();
 }
 
 void VariableVerletIntegrator::stepTo(double time) {
@@ -87,4 +88,5 @@ void VariableVerletIntegrator::stepTo(double time) {
         context->calcForcesAndEnergy(true, false);
         setStepSize(kernel.getAs<IntegrateVariableVerletStepKernel>().execute(*context, *this, time));
     }
+    context->invalidateEnergyCache();
 }
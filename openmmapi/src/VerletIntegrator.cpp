@@ -76,4 +76,5 @@ void VerletIntegrator::step(int steps) {
         context->calcForcesAndEnergy(true, false);
         kernel.getAs<IntegrateVerletStepKernel>().execute(*context, *this);
     }
+    context->invalidateEnergyCache();
 }
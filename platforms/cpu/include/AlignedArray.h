@@ -32,6 +32,11 @@
  * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
  * -------------------------------------------------------------------------- */
 
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+#include <cstddef>
+
 namespace OpenMM {
 
 /**
@@ -45,7 +50,7 @@ public:
     /**
      * Default constructor, to allow AlignedArrays to be used inside collections.
      */
-    AlignedArray() : dataSize(0), baseData(0), data(0) {
+    AlignedArray() : dataSize(0), baseData(0), data(0), mappedSize(0) {
     }
     /**
      * Create an Aligned array that contains a specified number of elements.
@@ -54,8 +59,7 @@ public:
         allocate(size);
     }
     ~AlignedArray() {
-        if (baseData != 0)
-            delete[] baseData;
+        deallocate();
     }
     /**
      * Get the number of elements in the array.
@@ -69,8 +73,7 @@ public:
     void resize(int size) {
         if (dataSize == size)
             return;
-        if (baseData != 0)
-            delete[] baseData;
+        deallocate();
         allocate(size);
     }
     /**
@@ -88,14 +91,53 @@ public:
 private:
     void allocate(int size) {
         dataSize = size;
-        baseData = new char[size*sizeof(T)+16];
+        baseData = 0;
+        mappedSize = 0;
+        size_t bytes = size*sizeof(T)+16;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        // Back large allocations with an anonymous mapping aligned to a 2MB boundary
+        // and ask the kernel to use transparent huge pages for it.  That reduces TLB
+        // misses in loops that stream through the whole array.  If anything fails we
+        // silently fall back to an ordinary allocation.
+
+        const size_t hugePageSize = 2*1024*1024;
+        if (bytes >= hugePageSize) {
+            size_t rounded = (bytes+hugePageSize-1)/hugePageSize*hugePageSize;
+            char* mapped = (char*) mmap(0, rounded+hugePageSize, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+            if (mapped != MAP_FAILED) {
+                char* aligned = (char*) (((size_t) mapped+hugePageSize-1)&~(hugePageSize-1));
+                if (aligned != mapped)
+                    munmap(mapped, aligned-mapped);
+                munmap(aligned+rounded, mapped+rounded+hugePageSize-(aligned+rounded));
+                madvise(aligned, rounded, MADV_HUGEPAGE);
+                baseData = aligned;
+                mappedSize = rounded;
+            }
+        }
+#endif
+        if (baseData == 0)
+            baseData = new char[bytes];
         char* offsetData = baseData+15;
         offsetData -= (long long)offsetData&0xF;
         data = (T*) offsetData;
     }
+    void deallocate() {
+        if (baseData != 0) {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+            if (mappedSize > 0) {
+                munmap(baseData, mappedSize);
+                baseData = 0;
+                return;
+            }
+#endif
+            delete[] baseData;
+            baseData = 0;
+        }
+    }
     int dataSize;
     char* baseData;
     T* data;
+    size_t mappedSize;
 };
 
 } // namespace OpenMM
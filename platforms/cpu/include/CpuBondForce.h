@@ -54,8 +54,15 @@ public:
     /**
      * Compute the forces from all bonds.
      */
-    void calculateForce(std::vector<OpenMM::Vec3>& atomCoordinates, double** parameters, std::vector<OpenMM::Vec3>& forces, 
+    void calculateForce(std::vector<OpenMM::Vec3>& atomCoordinates, double** parameters, std::vector<OpenMM::Vec3>& forces,
             double* totalEnergy, ReferenceBondIxn& referenceBondIxn);
+    /**
+     * Compute the forces from all bonds, using a separate ReferenceBondIxn for each thread.
+     * This is required when the ReferenceBondIxn stores state that is modified while
+     * computing a bond, so a single object cannot safely be shared between threads.
+     */
+    void calculateForce(std::vector<OpenMM::Vec3>& atomCoordinates, double** parameters, std::vector<OpenMM::Vec3>& forces,
+            double* totalEnergy, std::vector<ReferenceBondIxn*>& referenceBondIxn);
     /**
      * This routine contains the code executed by each thread.
      */
@@ -68,7 +75,7 @@ private:
     int** bondAtoms;
     ThreadPool* threads;
     std::vector<std::vector<int> > threadBonds;
-    std::vector<int> extraBonds;
+    std::vector<std::vector<int> > extraBondColors;
 };
 
 } // namespace OpenMM
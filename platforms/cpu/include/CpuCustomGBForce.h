@@ -26,7 +26,9 @@
 #define OPENMM_CPU_CUSTOM_GB_FORCE_H__
 
 #include "CpuNeighborList.h"
+#include "CpuVectorExpression.h"
 #include "lepton/CompiledExpression.h"
+#include "lepton/ParsedExpression.h"
 #include "openmm/CustomGBForce.h"
 #include "openmm/internal/CompiledExpressionSet.h"
 #include "openmm/internal/ThreadPool.h"
@@ -43,6 +45,7 @@ private:
 
     bool cutoff;
     bool periodic;
+    bool useVectorizedExpressions;
     const CpuNeighborList* neighborList;
     float periodicBoxSize[3];
     float cutoffDistance, cutoffDistance2;
@@ -98,6 +101,16 @@ private:
     void calculateOnePairValue(int index, int atom1, int atom2, ThreadData& data, float* posq, double** atomParameters,
                                std::vector<float>& valueArray, const fvec4& boxSize, const fvec4& invBoxSize);
 
+    /**
+     * Evaluate the batch of pairs waiting in a thread's workspace with the vectorized
+     * expression for the first computed value, and accumulate the results.
+     *
+     * @param data             workspace for the current thread
+     * @param valueArray       the computed values are added to this
+     */
+
+    void flushValueBatch(ThreadData& data, std::vector<float>& valueArray);
+
     /**
      * Calculate an energy term of type SingleParticle
      * 
@@ -185,16 +198,14 @@ public:
      */
 
      CpuCustomGBForce(int numAtoms, const std::vector<std::set<int> >& exclusions,
+                        const Lepton::ParsedExpression& value0Expression,
                         const std::vector<Lepton::CompiledExpression>& valueExpressions,
                         const std::vector<std::vector<Lepton::CompiledExpression> >& valueDerivExpressions,
                         const std::vector<std::vector<Lepton::CompiledExpression> >& valueGradientExpressions,
                         const std::vector<std::vector<Lepton::CompiledExpression> >& valueParamDerivExpressions,
                         const std::vector<std::string>& valueNames,
                         const std::vector<CustomGBForce::ComputationType>& valueTypes,
-                        const std::vector<Lepton::CompiledExpression>& energyExpressions,
-                        const std::vector<std::vector<Lepton::CompiledExpression> >& energyDerivExpressions,
-                        const std::vector<std::vector<Lepton::CompiledExpression> >& energyGradientExpressions,
-                        const std::vector<std::vector<Lepton::CompiledExpression> >& energyParamDerivExpressions,
+                        const std::vector<std::vector<Lepton::ParsedExpression> >& energyExpressions,
                         const std::vector<CustomGBForce::ComputationType>& energyTypes,
                         const std::vector<std::string>& parameterNames, ThreadPool& threads);
 
@@ -238,15 +249,13 @@ public:
 class CpuCustomGBForce::ThreadData {
 public:
     ThreadData(int numAtoms, int numThreads, int threadIndex,
+               const Lepton::ParsedExpression& value0Expression,
                const std::vector<Lepton::CompiledExpression>& valueExpressions,
                const std::vector<std::vector<Lepton::CompiledExpression> >& valueDerivExpressions,
                const std::vector<std::vector<Lepton::CompiledExpression> >& valueGradientExpressions,
                const std::vector<std::vector<Lepton::CompiledExpression> >& valueParamDerivExpressions,
                const std::vector<std::string>& valueNames,
-               const std::vector<Lepton::CompiledExpression>& energyExpressions,
-               const std::vector<std::vector<Lepton::CompiledExpression> >& energyDerivExpressions,
-               const std::vector<std::vector<Lepton::CompiledExpression> >& energyGradientExpressions,
-               const std::vector<std::vector<Lepton::CompiledExpression> >& energyParamDerivExpressions,
+               const std::vector<std::vector<Lepton::ParsedExpression> >& energyExpressions,
                const std::vector<std::string>& parameterNames);
     CompiledExpressionSet expressionSet;
     std::vector<Lepton::CompiledExpression> valueExpressions;
@@ -254,15 +263,25 @@ public:
     std::vector<std::vector<Lepton::CompiledExpression> > valueGradientExpressions;
     std::vector<std::vector<Lepton::CompiledExpression> > valueParamDerivExpressions;
     std::vector<double> value;
+    // Each energy term and all of its derivatives are compiled together so that
+    // subexpressions they share are only computed once per evaluation point.  Output 0
+    // is always the energy.  For a SingleParticle term the derivatives with respect to
+    // the computed values come next, then the x, y, and z gradients, then the
+    // derivatives with respect to global parameters.  For a pair term the derivative
+    // with respect to r comes next, then the derivatives with respect to each computed
+    // value for the two atoms, then the derivatives with respect to global parameters.
     std::vector<Lepton::CompiledExpression> energyExpressions;
-    std::vector<std::vector<Lepton::CompiledExpression> > energyDerivExpressions;
-    std::vector<std::vector<Lepton::CompiledExpression> > energyGradientExpressions;
-    std::vector<std::vector<Lepton::CompiledExpression> > energyParamDerivExpressions;
     std::vector<double> param;
     std::vector<double> particleParam;
     std::vector<double> particleValue;
     double x, y, z, r;
     int firstAtom, lastAtom;
+    // Workspace for evaluating the first computed value with the vectorized expression.
+    CpuVectorExpression value0ExpressionVec;
+    std::map<std::string, int> globalIndex;
+    std::vector<float> rVec, particleParamVec, globalVec;
+    int batchSize;
+    int batchAtom1[4];
     // Workspace vectors
     std::vector<float> value0, dVdR1, dVdR2, dVdX, dVdY, dVdZ;
     std::vector<std::vector<float> > dEdV;
@@ -51,7 +51,7 @@ private:
     class ThreadData;
     int numParticles, numParticlesPerSet, numPerParticleParameters, numTypes;
     bool useCutoff, usePeriodic, triclinic, centralParticleMode;
-    double cutoffDistance;
+    double cutoffDistance, cutoffDistance2;
     float recipBoxSize[3];
     Vec3 periodicBoxVectors[3];
     AlignedArray<fvec4> periodicBoxVec4;
@@ -27,6 +27,7 @@
 
 #include "AlignedArray.h"
 #include "CpuNeighborList.h"
+#include "CpuVectorExpression.h"
 #include "openmm/internal/CompiledExpressionSet.h"
 #include "openmm/internal/ThreadPool.h"
 #include "openmm/internal/vectorize.h"
@@ -46,9 +47,9 @@ class CpuCustomNonbondedForce {
 
          --------------------------------------------------------------------------------------- */
 
-       CpuCustomNonbondedForce(const Lepton::CompiledExpression& energyExpression, const Lepton::CompiledExpression& forceExpression,
+       CpuCustomNonbondedForce(const Lepton::ParsedExpression& energyExpression, const Lepton::ParsedExpression& forceExpression,
                                const std::vector<std::string>& parameterNames, const std::vector<std::set<int> >& exclusions,
-                               const std::vector<Lepton::CompiledExpression> energyParamDerivExpressions, ThreadPool& threads);
+                               const std::vector<Lepton::ParsedExpression>& energyParamDerivExpressions, ThreadPool& threads);
 
       /**---------------------------------------------------------------------------------------
 
@@ -129,6 +130,7 @@ private:
     bool periodic;
     bool triclinic;
     bool useInteractionGroups;
+    bool useVectorizedExpressions;
     const CpuNeighborList* neighborList;
     float recipBoxSize[3];
     Vec3 periodicBoxVectors[3];
@@ -168,6 +170,16 @@ private:
      */
     void calculateOneIxn(int atom1, int atom2, ThreadData& data, float* forces, double& totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize);
 
+    /**
+     * Evaluate the expressions for the batch of interactions a thread has buffered and
+     * apply the resulting forces.
+     *
+     * @param data             workspace for the current thread
+     * @param forces           force array (forces added)
+     * @param totalEnergy      total energy
+     */
+    void flushBatch(ThreadData& data, float* forces, double& totalEnergy);
+
     /**
      * Compute the displacement and squared distance between two points, optionally using
      * periodic boundary conditions.
@@ -177,15 +189,26 @@ private:
 
 class CpuCustomNonbondedForce::ThreadData {
 public:
-    ThreadData(const Lepton::CompiledExpression& energyExpression, const Lepton::CompiledExpression& forceExpression, const std::vector<std::string>& parameterNames,
-            const std::vector<Lepton::CompiledExpression> energyParamDerivExpressions);
-    Lepton::CompiledExpression energyExpression;
-    Lepton::CompiledExpression forceExpression;
-    std::vector<Lepton::CompiledExpression> energyParamDerivExpressions;
+    ThreadData(const Lepton::ParsedExpression& energyExpression, const Lepton::ParsedExpression& forceExpression, const std::vector<std::string>& parameterNames,
+            const std::vector<Lepton::ParsedExpression>& energyParamDerivExpressions);
+    // The energy, force, and global parameter derivatives are compiled together so that
+    // subexpressions they share are only computed once per interaction.  Output 0 is the
+    // energy, output 1 is the force, and outputs 2 and up are the parameter derivatives.
+    Lepton::CompiledExpression pairExpression;
     CompiledExpressionSet expressionSet;
     std::vector<double> particleParam;
     double r;
-    std::vector<double> energyParamDerivs; 
+    std::vector<double> energyParamDerivs;
+    // The following variables are used for evaluating the expressions for four
+    // interactions at once.
+    CpuVectorExpression energyExpressionVec;
+    CpuVectorExpression forceExpressionVec;
+    std::vector<float> rVec, particleParamVec, globalVec;
+    std::map<std::string, int> globalIndex;
+    AlignedArray<float> batchDeltaR;
+    float batchR[4];
+    int batchAtom1[4], batchAtom2[4];
+    int batchSize;
 };
 
 } // namespace OpenMM
@@ -38,6 +38,9 @@ class CpuGBSAOBCForce {
 public:
     CpuGBSAOBCForce();
 
+    virtual ~CpuGBSAOBCForce() {
+    }
+
     /**
      * Set the force to use a cutoff.
      * 
@@ -94,9 +97,9 @@ public:
     /**
      * This routine contains the code executed by each thread.
      */
-    void threadComputeForce(ThreadPool& threads, int threadIndex);
+    virtual void threadComputeForce(ThreadPool& threads, int threadIndex);
 
-private:
+protected:
     bool cutoff;
     bool periodic;
     float periodicBoxSize[3];
@@ -108,6 +111,8 @@ private:
     std::vector<double> threadEnergy;
     std::vector<float> logTable;
     float logDX, logDXInv;
+    std::vector<float> expTable;
+    float expDX, expDXInv;
     // The following variables are used to make information accessible to the individual threads.
     float const* posq;
     std::vector<AlignedArray<float> >* threadForce;
@@ -117,6 +122,7 @@ private:
     static const int NUM_TABLE_POINTS;
     static const float TABLE_MIN;
     static const float TABLE_MAX;
+    static const float EXP_TABLE_MAX;
 
     /**
      * Compute the displacement and squared distance between a collection of points, optionally using
@@ -128,6 +134,11 @@ private:
      * Evaluate log(x) using a lookup table for speed.
      */
     fvec4 fastLog(const fvec4& x);
+
+    /**
+     * Evaluate exp(x) for x <= 0 using a lookup table for speed.
+     */
+    fvec4 fastExp(const fvec4& x);
 };
 
 } // namespace OpenMM
@@ -0,0 +1,75 @@
+
+/* Portions copyright (c) 2006-2017 Stanford University and Simbios.
+ * Contributors: Pande Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef OPENMM_CPU_GBSAOBC_FORCE_VEC8_H__
+#define OPENMM_CPU_GBSAOBC_FORCE_VEC8_H__
+
+#include "CpuGBSAOBCForce.h"
+
+#if defined(__AVX__) || defined(__ARM_NEON__) || defined(__ARM_NEON)
+
+#ifdef __AVX__
+#include "openmm/internal/vectorize8.h"
+#else
+#include "openmm/internal/vectorize8_neon.h"
+#endif
+
+namespace OpenMM {
+
+/**
+ * This is a version of CpuGBSAOBCForce that processes the atoms in blocks of eight,
+ * using 8 component vectors.
+ */
+class CpuGBSAOBCForceVec8 : public CpuGBSAOBCForce {
+public:
+    CpuGBSAOBCForceVec8();
+
+    /**
+     * This routine contains the code executed by each thread.
+     */
+    void threadComputeForce(ThreadPool& threads, int threadIndex);
+
+protected:
+    /**
+     * Compute the displacement and squared distance between a collection of points, optionally using
+     * periodic boundary conditions.
+     */
+    void getDeltaR(const fvec4& posI, const fvec8& x, const fvec8& y, const fvec8& z, fvec8& dx, fvec8& dy, fvec8& dz, fvec8& r2, bool periodic, const fvec4& boxSize, const fvec4& invBoxSize) const;
+
+    /**
+     * Evaluate log(x) using a lookup table for speed.
+     */
+    fvec8 fastLog(const fvec8& x);
+
+    /**
+     * Evaluate exp(x) for x <= 0 using a lookup table for speed.
+     */
+    fvec8 fastExp(const fvec8& x);
+};
+
+} // namespace OpenMM
+
+#endif // __AVX__ || __ARM_NEON__
+
+#endif // OPENMM_CPU_GBSAOBC_FORCE_VEC8_H__
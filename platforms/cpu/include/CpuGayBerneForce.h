@@ -93,7 +93,7 @@ private:
     Vec3* boxVectors;
     void* atomicCounter;
 
-    void computeEllipsoidFrames(const std::vector<Vec3>& positions);
+    void computeEllipsoidFrames(int start, int end);
     
     void applyTorques(const std::vector<Vec3>& positions, std::vector<Vec3>& forces);
 
@@ -134,11 +134,23 @@ struct CpuGayBerneForce::Matrix {
     }
     
     Matrix inverse() {
-        double invDet = 1/determinant();
+        double det;
+        return inverse(det);
+    }
+
+    Matrix inverse(double& det) {
+        // Computing the inverse from the cofactors lets the determinant be computed at the
+        // same time, so the caller doesn't need a separate call to determinant().
+
+        double c00 = v[1][1]*v[2][2] - v[1][2]*v[2][1];
+        double c10 = -(v[1][0]*v[2][2] - v[1][2]*v[2][0]);
+        double c20 = v[1][0]*v[2][1] - v[1][1]*v[2][0];
+        det = v[0][0]*c00 + v[0][1]*c10 + v[0][2]*c20;
+        double invDet = 1/det;
         Matrix result;
-        result.v[0][0] = invDet*(v[1][1]*v[2][2] - v[1][2]*v[2][1]);
-        result.v[1][0] = -invDet*(v[1][0]*v[2][2] - v[1][2]*v[2][0]);
-        result.v[2][0] = invDet*(v[1][0]*v[2][1] - v[1][1]*v[2][0]);
+        result.v[0][0] = invDet*c00;
+        result.v[1][0] = invDet*c10;
+        result.v[2][0] = invDet*c20;
         result.v[0][1] = -invDet*(v[0][1]*v[2][2] - v[0][2]*v[2][1]);
         result.v[1][1] = invDet*(v[0][0]*v[2][2] - v[0][2]*v[2][0]);
         result.v[2][1] = -invDet*(v[0][0]*v[2][1] - v[0][1]*v[2][0]);
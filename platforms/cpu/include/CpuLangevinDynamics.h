@@ -28,6 +28,7 @@
 
 #include "ReferenceStochasticDynamics.h"
 #include "CpuRandom.h"
+#include "CpuSETTLE.h"
 #include "openmm/internal/ThreadPool.h"
 #include "sfmt/SFMT.h"
 
@@ -52,6 +53,23 @@ public:
      */
     ~CpuLangevinDynamics();
 
+    /**
+     * Perform a step of dynamics.  When the only constraints are SETTLE clusters, the
+     * velocity update, position update, and constraint projection are fused into a single
+     * pass that processes one block of clusters at a time, so each atom's data only needs
+     * to be brought into cache once per step.  Otherwise this falls back to the standard
+     * multi-pass update.
+     *
+     * @param system              the System to be integrated
+     * @param atomCoordinates     atom coordinates
+     * @param velocities          velocities
+     * @param forces              forces
+     * @param masses              atom masses
+     * @param tolerance           the constraint tolerance
+     */
+    void update(const OpenMM::System& system, std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<OpenMM::Vec3>& velocities,
+                std::vector<OpenMM::Vec3>& forces, std::vector<double>& masses, double tolerance);
+
     /**
      * First update step.
      * 
@@ -93,9 +111,22 @@ private:
     void threadUpdate1(int threadIndex);
     void threadUpdate2(int threadIndex);
     void threadUpdate3(int threadIndex);
+    void threadUpdateFused(int threadIndex);
+    void initializeFusedUpdate();
+    OpenMM::Vec3 nextNoise(int atom, const float*& gaussian);
     OpenMM::ThreadPool& threads;
     OpenMM::CpuRandom& random;
     std::vector<OpenMM_SFMT::SFMT> threadRandom;
+    // The following variables are used for the fused update path.
+    bool hasCheckedConstraints, useFusedUpdate;
+    CpuSETTLE* settle;
+    std::vector<std::vector<int> > threadBlocks;
+    std::vector<std::vector<int> > blockAtoms;
+    std::vector<int> unconstrainedAtoms;
+    std::vector<OpenMM::Vec3>* fusedCoordinates;
+    std::vector<OpenMM::Vec3>* fusedXPrime;
+    std::vector<double>* fusedInverseMasses;
+    double constraintTolerance;
     // The following variables are used to make information accessible to the individual threads.
     int numberOfAtoms;
     OpenMM::Vec3* atomCoordinates;
@@ -47,27 +47,59 @@ class OPENMM_EXPORT_CPU CpuNeighborList {
 public:
     class Voxels;
     CpuNeighborList(int blockSize);
+    /**
+     * Compute the neighbor list.  If skin is greater than zero, the list is built to include all
+     * pairs within maxDistance+skin of each other, and subsequent calls skip the rebuild entirely
+     * until some atom has moved more than half the skin distance since the last build.
+     */
     void computeNeighborList(int numAtoms, const AlignedArray<float>& atomLocations, const std::vector<std::set<int> >& exclusions,
-            const Vec3* periodicBoxVectors, bool usePeriodic, float maxDistance, ThreadPool& threads);
+            const Vec3* periodicBoxVectors, bool usePeriodic, float maxDistance, ThreadPool& threads, float skin = 0.0f);
     int getNumBlocks() const;
     int getBlockSize() const;
     const std::vector<int>& getSortedAtoms() const;
     const std::vector<int>& getBlockNeighbors(int blockIndex) const;
-    const std::vector<char>& getBlockExclusions(int blockIndex) const;
+    const std::vector<int>& getBlockExclusions(int blockIndex) const;
+    /**
+     * Copy the current positions and charges of every block's neighbors into packed per-block
+     * buffers, so that inner loops can read them from contiguous memory instead of gathering
+     * them through the neighbor indices.  Call this whenever positions change, then call
+     * getNeighborPositions() to access the copies.
+     */
+    void updateNeighborPositions(const float* posq, ThreadPool& threads);
+    /**
+     * Get the packed positions and charges of the atoms neighboring a block, four floats per
+     * neighbor in the same order as getBlockNeighbors().  The contents are only valid after a
+     * call to updateNeighborPositions().
+     */
+    const std::vector<float>& getNeighborPositions(int blockIndex) const;
     /**
      * This routine contains the code executed by each thread.
      */
     void threadComputeNeighborList(ThreadPool& threads, int threadIndex);
+    /**
+     * This routine contains the code executed by each thread when updating neighbor positions.
+     */
+    void threadUpdateNeighborPositions(ThreadPool& threads, int threadIndex);
     void runThread(int index);
 private:
     int blockSize;
+    // The following variables record what the list was most recently built for, so that
+    // rebuilds can be skipped while the skin distance has not been consumed.
+    std::vector<float> lastPositions;
+    Vec3 lastBoxVectors[3];
+    float lastMaxDistance;
+    int lastNumAtoms;
+    bool lastUsePeriodic;
     std::vector<int> sortedAtoms;
     std::vector<float> sortedPositions;
     std::vector<std::vector<int> > blockNeighbors;
-    std::vector<std::vector<char> > blockExclusions;
+    std::vector<std::vector<int> > blockExclusions;
+    std::vector<std::vector<float> > blockNeighborPositions;
+    const float* packedPosq;
     // The following variables are used to make information accessible to the individual threads.
     float minx, maxx, miny, maxy, minz, maxz;
     std::vector<std::pair<int, int> > atomBins;
+    std::vector<std::vector<std::vector<std::pair<float, int> > > > threadBins;
     Voxels* voxels;
     const std::vector<std::set<int> >* exclusions;
     const float* atomLocations;
@@ -64,7 +64,7 @@ class CpuNonbondedForce {
       
          --------------------------------------------------------------------------------------- */
       
-      void setUseCutoff(float distance, const CpuNeighborList& neighbors, float solventDielectric);
+      void setUseCutoff(float distance, CpuNeighborList& neighbors, float solventDielectric);
 
       /**---------------------------------------------------------------------------------------
       
@@ -169,6 +169,22 @@ class CpuNonbondedForce {
     void threadComputeDirect(ThreadPool& threads, int threadIndex);
 
 protected:
+      /**---------------------------------------------------------------------------------------
+
+         Translate a position to the periodic copy nearest to a given point.  This works
+         correctly for triclinic boxes.
+
+         @param pos     the position to translate
+         @param center  the point to translate it close to
+
+         --------------------------------------------------------------------------------------- */
+
+      void applyPeriodicToPos(fvec4& pos, const fvec4& center) const {
+          pos -= periodicBoxVec4[2]*floorf((pos[2]-center[2])*recipBoxSize[2]+0.5f);
+          pos -= periodicBoxVec4[1]*floorf((pos[1]-center[1])*recipBoxSize[1]+0.5f);
+          pos -= periodicBoxVec4[0]*floorf((pos[0]-center[0])*recipBoxSize[0]+0.5f);
+      }
+
         bool cutoff;
         bool useSwitch;
         bool periodic;
@@ -176,7 +192,7 @@ protected:
         bool ewald;
         bool ljpme, pme;
         bool tableIsValid, expTableIsValid;
-        const CpuNeighborList* neighborList;
+        CpuNeighborList* neighborList;
         float recipBoxSize[3];
         Vec3 periodicBoxVectors[3];
         AlignedArray<fvec4> periodicBoxVec4;
@@ -27,9 +27,13 @@
 
 #include "CpuNonbondedForce.h"
 
-#ifdef __AVX__
+#if defined(__AVX__) || defined(__ARM_NEON__) || defined(__ARM_NEON)
 
+#ifdef __AVX__
 #include "openmm/internal/vectorize8.h"
+#else
+#include "openmm/internal/vectorize8_neon.h"
+#endif
 
 // ---------------------------------------------------------------------------------------
 
@@ -113,6 +117,6 @@ protected:
 
 // ---------------------------------------------------------------------------------------
 
-#endif // __AVX__
+#endif // __AVX__ || __ARM_NEON__
 
 #endif // OPENMM_CPU_NONBONDED_FORCE_VEC8_H__
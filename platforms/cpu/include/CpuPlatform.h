@@ -45,6 +45,12 @@ namespace OpenMM {
     
 /**
  * This Platform subclass uses CPU implementations of the OpenMM kernels.
+ *
+ * All forces are computed in single precision, using SIMD approximations of the
+ * transcendental functions where they help (the vecmath library and the tabulated
+ * erfc() used for Ewald).  The platform therefore does not support double precision;
+ * simulations that need fully double precision results should use the Reference
+ * platform, or a GPU platform with the Precision property set to "double".
  */
 
 class OPENMM_EXPORT_CPU CpuPlatform : public ReferencePlatform {
@@ -71,12 +77,64 @@ public:
     /**
      * This is the name of the parameter for requesting that force computations be deterministic.  Setting
      * this to "true" DOES NOT GUARANTEE that the forces will actually be fully deterministic, but it does
-     * try to reduce the variation in them at the cost of a small loss in performance.
+     * try to reduce the variation in them at the cost of a small loss in performance.  In particular, the
+     * per-thread force buffers are combined in 64 bit fixed point, so that step of the computation is
+     * exact and independent of the number of threads.
      */
     static const std::string& CpuDeterministicForces() {
         static const std::string key = "DeterministicForces";
         return key;
     }
+    /**
+     * This is the name of the parameter that reports the width of the SIMD vectors the
+     * nonbonded kernels are using: "4", "8", or "16".  It is determined by the capabilities
+     * of the CPU and cannot be changed.
+     */
+    static const std::string& CpuVectorWidth() {
+        static const std::string key = "VectorWidth";
+        return key;
+    }
+    /**
+     * This is the name of the parameter for selecting how threads are placed on processors.
+     * The allowed values are "none" (the default), which leaves placement to the operating
+     * system, and "pin", which binds each worker thread to a single processor and makes it
+     * touch the arrays it works on so they are allocated in its local memory.  Pinning can
+     * help significantly on multi-socket machines, where a migrating thread otherwise ends
+     * up far from its data.
+     */
+    static const std::string& CpuThreadAffinity() {
+        static const std::string key = "ThreadAffinity";
+        return key;
+    }
+    /**
+     * This is the name of the parameter for selecting the counter based (Philox) random
+     * number generator in the stochastic integration kernels.  The generator is keyed by
+     * (seed, step, particle), so for a fixed seed the random stream does not depend on
+     * the number of threads and runs are reproducible across machine configurations.
+     */
+    static const std::string& CpuCounterBasedRandoms() {
+        static const std::string key = "CounterBasedRandoms";
+        return key;
+    }
+    /**
+     * This is the name of the parameter that reports the padding distance currently added to
+     * the cutoff when building the neighbor list.  The padding is tuned at run time based on
+     * how often the list has to be rebuilt, so the value changes as the simulation runs.  It
+     * cannot be set.
+     */
+    static const std::string& CpuNeighborListPadding() {
+        static const std::string key = "NeighborListPadding";
+        return key;
+    }
+    /**
+     * This is the name of the parameter that reports how many times the neighbor list has
+     * been rebuilt since the Context was created.  Together with NeighborListPadding it can
+     * be used to audit the choices the padding tuner makes.  It cannot be set.
+     */
+    static const std::string& CpuNeighborListRebuilds() {
+        static const std::string key = "NeighborListRebuilds";
+        return key;
+    }
     /**
      * We cannot use the standard mechanism for platform data, because that is already used by the superclass.
      * Instead, we maintain a table of ContextImpls to PlatformDatas.
@@ -89,9 +147,10 @@ private:
 
 class CpuPlatform::PlatformData {
 public:
-    PlatformData(int numParticles, int numThreads, bool deterministicForces);
+    PlatformData(int numParticles, int numThreads, bool deterministicForces, bool pinThreads);
     ~PlatformData();
     void requestNeighborList(double cutoffDistance, double padding, bool useExclusions, const std::vector<std::set<int> >& exclusionList);
+    void tuneNeighborListPadding();
     AlignedArray<float> posq;
     std::vector<AlignedArray<float> > threadForce;
     ThreadPool threads;
@@ -100,6 +159,10 @@ public:
     std::map<std::string, std::string> propertyValues;
     CpuNeighborList* neighborList;
     double cutoff, paddedCutoff;
+    // The padding added to the cutoff is tuned at run time within these bounds based on
+    // how often the neighbor list has to be rebuilt.
+    double minPaddedCutoff, maxPaddedCutoff;
+    int stepsSinceNeighborListRebuild, neighborListRebuildCount;
     bool anyExclusions, deterministicForces;
     std::vector<std::set<int> > exclusions;
 };
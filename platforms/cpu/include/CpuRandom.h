@@ -34,12 +34,15 @@
 
 #include "sfmt/SFMT.h"
 #include "windowsExportCpu.h"
+#include <pthread.h>
 #include <vector>
 
 namespace OpenMM {
 
 /**
- * This class provides a multithreaded random number generator.
+ * This class provides a multithreaded random number generator.  In addition to generating
+ * random numbers on demand, it can maintain a pool of Gaussian random numbers that is
+ * refilled by a background thread, so the cost of generating them overlaps with other work.
  */
 class OPENMM_EXPORT_CPU CpuRandom {
 public:
@@ -48,12 +51,64 @@ public:
     void initialize(int seed, int numThreads);
     float getGaussianRandom(int threadIndex);
     float getUniformRandom(int threadIndex);
+    /**
+     * Set whether the integration kernels should use the counter based (Philox) generator
+     * instead of the per-thread SFMT streams.  The counter based values are keyed by
+     * (seed, step, particle), so they do not depend on how particles are divided among
+     * threads and runs are reproducible across machine configurations.
+     */
+    void setUseCounterBased(bool use);
+    /**
+     * Get whether the integration kernels should use the counter based generator.
+     */
+    bool getUseCounterBased() const;
+    /**
+     * Get three Gaussian random values for a particle, generated with the counter based
+     * (Philox) generator keyed by (seed, step, particle).
+     *
+     * @param step      the index of the current time step
+     * @param particle  the index of the particle the values are for
+     * @param values    the three Gaussian values are stored into this
+     */
+    void getCounterBasedGaussians(unsigned int step, unsigned int particle, float values[3]) const;
+    /**
+     * Create a pool of Gaussian random numbers that is filled by a background thread.
+     * This blocks until the initial fill has completed.  If a pool already exists, its
+     * size is increased if necessary.
+     *
+     * @param valuesPerThread  the number of values to store in the pool for each thread
+     */
+    void createGaussianPool(int valuesPerThread);
+    /**
+     * Get the pool values for a thread, waiting if necessary for the background thread
+     * to finish filling them.  The returned values remain valid until the next call to
+     * refillGaussianPool().
+     *
+     * @param threadIndex  the index of the thread the values are for
+     */
+    const float* acquireGaussianPool(int threadIndex);
+    /**
+     * Signal the background thread to replace the values in the pool.  Call this once
+     * the values returned by acquireGaussianPool() have been consumed.
+     */
+    void refillGaussianPool();
 private:
+    static void* poolFillerBody(void* args);
+    void fillGaussianPool();
     bool hasInitialized;
+    bool useCounterBased;
     int randomSeed;
+    unsigned int resolvedSeed;
     std::vector<OpenMM_SFMT::SFMT*> threadRandom;
     std::vector<float> nextGaussian;
     std::vector<int> nextGaussianIsValid;
+    // The following variables are used for the background-filled pool of Gaussian values.
+    bool hasPool, poolFilled, poolThreadShouldExit;
+    int poolSize;
+    std::vector<std::vector<float> > gaussianPool;
+    pthread_t poolThread;
+    pthread_mutex_t poolLock;
+    pthread_cond_t poolStartCondition, poolEndCondition;
 };
 
 } // namespace OpenMM
@@ -67,11 +67,44 @@ public:
      * @param tolerance        the constraint tolerance
      */
     void applyToVelocities(std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<OpenMM::Vec3>& velocities, std::vector<double>& inverseMasses, double tolerance);
+
+    /**
+     * Get the number of blocks the clusters have been divided into.
+     */
+    int getNumBlocks() const;
+
+    /**
+     * Get the algorithm that processes the clusters in one block.  This allows an integrator
+     * to interleave applying constraints with other per-atom work, one block at a time.
+     *
+     * @param index  the index of the block
+     */
+    ReferenceSETTLEAlgorithm& getBlockAlgorithm(int index);
 private:
+    class VectorizedBlock;
     std::vector<ReferenceSETTLEAlgorithm*> threadSettle;
     ThreadPool& threads;
 };
 
+/**
+ * This applies the algorithm to one block of clusters, processing four clusters at a time
+ * with fvec4 arithmetic.  The cluster parameters are packed into SoA form when it is
+ * created.  Any leftover clusters beyond a multiple of four are handled by a scalar
+ * algorithm.
+ */
+class CpuSETTLE::VectorizedBlock : public ReferenceSETTLEAlgorithm {
+public:
+    VectorizedBlock(const std::vector<int>& atom1, const std::vector<int>& atom2, const std::vector<int>& atom3,
+            const std::vector<double>& distance1, const std::vector<double>& distance2, std::vector<double>& masses);
+    ~VectorizedBlock();
+    void apply(std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<OpenMM::Vec3>& atomCoordinatesP, std::vector<double>& inverseMasses, double tolerance);
+private:
+    int numVectorClusters;
+    std::vector<int> atom1, atom2, atom3;
+    std::vector<float> m0, m1, m2, invTotalMass, ra, rb, rc, distance2Squared;
+    ReferenceSETTLEAlgorithm* tail;
+};
+
 } // namespace OpenMM
 
 #endif /*OPENMM_CPUSETTLE_H_*/
@@ -0,0 +1,76 @@
+#ifndef OPENMM_CPUVECTOREXPRESSION_H_
+#define OPENMM_CPUVECTOREXPRESSION_H_
+
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2018 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "windowsExportCpu.h"
+#include "openmm/internal/vectorize.h"
+#include "lepton/ExpressionProgram.h"
+#include "lepton/ParsedExpression.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace OpenMM {
+
+/**
+ * This class evaluates a Lepton expression for four sets of variable values at once using
+ * fvec4 arithmetic.  Each variable is bound to a block of four floats, one value per lane.
+ * Common operations are evaluated with vector instructions; anything else falls back to
+ * evaluating the scalar operation once per lane, so arbitrary expressions still work.
+ */
+class OPENMM_EXPORT_CPU CpuVectorExpression {
+public:
+    CpuVectorExpression();
+    /**
+     * Create a vectorized version of an expression.
+     *
+     * @param expression         the expression to evaluate
+     * @param variableLocations  for each variable in the expression, a pointer to the block of
+     *                           four floats holding its values
+     */
+    CpuVectorExpression(const Lepton::ParsedExpression& expression, const std::map<std::string, float*>& variableLocations);
+    /**
+     * Evaluate the expression for all four lanes at once.
+     */
+    fvec4 evaluate() const;
+private:
+    Lepton::ExpressionProgram program;
+    std::vector<float*> variablePointers;
+    std::map<std::string, double> dummyVariables;
+    mutable std::vector<float> stack;
+    mutable std::vector<double> argValues;
+};
+
+} // namespace OpenMM
+
+#endif /*OPENMM_CPUVECTOREXPRESSION_H_*/
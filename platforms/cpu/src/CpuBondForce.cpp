@@ -99,8 +99,9 @@ void CpuBondForce::initialize(int numAtoms, int numBonds, int numAtomsPerBond, i
     }
     
     // Look through the remaining bonds and see whether any of them can be assigned.
-    
+
     candidateBonds.clear();
+    vector<int> extraBonds;
     for (int bond = 0; bond < numBonds; bond++) {
         if (bondThread[bond] == -1) {
             // See whether this bond can be assigned to a thread.
@@ -132,6 +133,28 @@ void CpuBondForce::initialize(int numAtoms, int numBonds, int numAtomsPerBond, i
             }
         }
     }
+
+    // Color the extra bonds so that no two bonds with the same color share an atom.  All the
+    // bonds with a single color can then be computed in parallel with no write conflicts.
+
+    vector<set<int> > colorAtoms;
+    for (int bond : extraBonds) {
+        int color;
+        for (color = 0; color < (int) extraBondColors.size(); color++) {
+            bool conflict = false;
+            for (int i = 0; i < numAtomsPerBond && !conflict; i++)
+                conflict = (colorAtoms[color].find(bondAtoms[bond][i]) != colorAtoms[color].end());
+            if (!conflict)
+                break;
+        }
+        if (color == extraBondColors.size()) {
+            extraBondColors.push_back(vector<int>());
+            colorAtoms.push_back(set<int>());
+        }
+        extraBondColors[color].push_back(bond);
+        for (int i = 0; i < numAtomsPerBond; i++)
+            colorAtoms[color].insert(bondAtoms[bond][i]);
+    }
 }
 
 bool CpuBondForce::canAssignBond(int bond, int thread, vector<int>& atomThread) {
@@ -164,26 +187,48 @@ void CpuBondForce::assignBond(int bond, int thread, vector<int>& atomThread, vec
     }
 }
 
-void CpuBondForce::calculateForce(vector<Vec3>& atomCoordinates, double** parameters, vector<Vec3>& forces, 
+void CpuBondForce::calculateForce(vector<Vec3>& atomCoordinates, double** parameters, vector<Vec3>& forces,
         double* totalEnergy, ReferenceBondIxn& referenceBondIxn) {
+    vector<ReferenceBondIxn*> ixn(threads->getNumThreads(), &referenceBondIxn);
+    calculateForce(atomCoordinates, parameters, forces, totalEnergy, ixn);
+}
+
+void CpuBondForce::calculateForce(vector<Vec3>& atomCoordinates, double** parameters, vector<Vec3>& forces,
+        double* totalEnergy, vector<ReferenceBondIxn*>& referenceBondIxn) {
     // Have the worker threads compute their forces.
-    
+
     vector<double> threadEnergy(threads->getNumThreads(), 0);
     threads->execute([&] (ThreadPool& threads, int threadIndex) {
         double* energy = (totalEnergy == NULL ? NULL : &threadEnergy[threadIndex]);
-        threadComputeForce(threads, threadIndex, atomCoordinates, parameters, forces, energy, referenceBondIxn);
+        threadComputeForce(threads, threadIndex, atomCoordinates, parameters, forces, energy, *referenceBondIxn[threadIndex]);
     });
     threads->waitForThreads();
-    
-    // Compute any "extra" bonds.
-    
-    for (int i = 0; i < extraBonds.size(); i++) {
-        int bond = extraBonds[i];
-        referenceBondIxn.calculateBondIxn(bondAtoms[bond], atomCoordinates, parameters[bond], forces, totalEnergy, NULL);
+
+    // Compute any "extra" bonds that could not be assigned to a single thread.  The bonds
+    // within one color share no atoms, so each color can be computed in parallel.
+
+    for (auto& colorBonds : extraBondColors) {
+        if ((int) colorBonds.size() < 2*threads->getNumThreads()) {
+            // There are too few bonds in this color for parallelism to pay off.
+
+            for (int bond : colorBonds)
+                referenceBondIxn[0]->calculateBondIxn(bondAtoms[bond], atomCoordinates, parameters[bond], forces, totalEnergy, NULL);
+        }
+        else {
+            threads->execute([&] (ThreadPool& threads, int threadIndex) {
+                double* energy = (totalEnergy == NULL ? NULL : &threadEnergy[threadIndex]);
+                int numThreads = threads.getNumThreads();
+                for (int i = threadIndex; i < (int) colorBonds.size(); i += numThreads) {
+                    int bond = colorBonds[i];
+                    referenceBondIxn[threadIndex]->calculateBondIxn(bondAtoms[bond], atomCoordinates, parameters[bond], forces, energy, NULL);
+                }
+            });
+            threads->waitForThreads();
+        }
     }
 
     // Compute the total energy.
-    
+
     if (totalEnergy != NULL)
         for (int i = 0; i < threads->getNumThreads(); i++)
             *totalEnergy += threadEnergy[i];
@@ -34,19 +34,21 @@ using namespace OpenMM;
 using namespace std;
 
 CpuCustomGBForce::ThreadData::ThreadData(int numAtoms, int numThreads, int threadIndex,
+                      const Lepton::ParsedExpression& value0Expression,
                       const vector<Lepton::CompiledExpression>& valueExpressions,
                       const vector<vector<Lepton::CompiledExpression> >& valueDerivExpressions,
                       const vector<vector<Lepton::CompiledExpression> >& valueGradientExpressions,
                       const vector<vector<Lepton::CompiledExpression> >& valueParamDerivExpressions,
                       const vector<string>& valueNames,
-                      const vector<Lepton::CompiledExpression>& energyExpressions,
-                      const vector<vector<Lepton::CompiledExpression> >& energyDerivExpressions,
-                      const vector<vector<Lepton::CompiledExpression> >& energyGradientExpressions,
-                      const vector<vector<Lepton::CompiledExpression> >& energyParamDerivExpressions,
+                      const vector<vector<Lepton::ParsedExpression> >& energyExpressions,
                       const vector<string>& parameterNames) :
             valueExpressions(valueExpressions), valueDerivExpressions(valueDerivExpressions), valueGradientExpressions(valueGradientExpressions),
-            valueParamDerivExpressions(valueParamDerivExpressions), energyExpressions(energyExpressions), energyDerivExpressions(energyDerivExpressions),
-            energyGradientExpressions(energyGradientExpressions), energyParamDerivExpressions(energyParamDerivExpressions) {
+            valueParamDerivExpressions(valueParamDerivExpressions) {
+    // Compile each energy term together with all of its derivatives, so that subexpressions
+    // they share are only computed once per evaluation point.
+
+    for (auto& expressions : energyExpressions)
+        this->energyExpressions.push_back(Lepton::CompiledExpression(expressions));
     firstAtom = (threadIndex*(long long) numAtoms)/numThreads;
     lastAtom = ((threadIndex+1)*(long long) numAtoms)/numThreads;
     map<string, double*> variableLocations;
@@ -97,21 +99,30 @@ CpuCustomGBForce::ThreadData::ThreadData(int numAtoms, int numThreads, int threa
         expression.setVariableLocations(variableLocations);
         expressionSet.registerExpression(expression);
     }
-    for (auto& expressions : this->energyDerivExpressions)
-        for (auto& expression : expressions) {
-            expression.setVariableLocations(variableLocations);
-            expressionSet.registerExpression(expression);
-        }
-    for (auto& expressions : this->energyGradientExpressions)
-        for (auto& expression : expressions) {
-            expression.setVariableLocations(variableLocations);
-            expressionSet.registerExpression(expression);
-        }
-    for (auto& expressions : this->energyParamDerivExpressions)
-        for (auto& expression : expressions) {
-            expression.setVariableLocations(variableLocations);
-            expressionSet.registerExpression(expression);
+    // Create a vectorized version of the first computed value's expression.  Each variable
+    // is bound to a block of four floats, one for each pair in a batch.  Any variable that
+    // is not r or a suffixed per-particle parameter must be a global parameter.
+
+    rVec.resize(4);
+    particleParamVec.resize(8*parameterNames.size());
+    map<string, float*> vectorLocations;
+    vectorLocations["r"] = &rVec[0];
+    for (int i = 0; i < (int) parameterNames.size(); i++) {
+        for (int j = 0; j < 2; j++) {
+            stringstream name;
+            name << parameterNames[i] << (j+1);
+            vectorLocations[name.str()] = &particleParamVec[4*(2*i+j)];
         }
+    }
+    int numGlobals = 0;
+    for (auto& name : this->valueExpressions[0].getVariables())
+        if (vectorLocations.find(name) == vectorLocations.end())
+            globalIndex[name] = numGlobals++;
+    globalVec.resize(4*numGlobals);
+    for (auto& global : globalIndex)
+        vectorLocations[global.first] = &globalVec[4*global.second];
+    value0ExpressionVec = CpuVectorExpression(value0Expression, vectorLocations);
+    batchSize = 0;
     value0.resize(numAtoms);
     dEdV.resize(valueNames.size());
     for (auto& v : dEdV)
@@ -126,23 +137,25 @@ CpuCustomGBForce::ThreadData::ThreadData(int numAtoms, int numThreads, int threa
 }
 
 CpuCustomGBForce::CpuCustomGBForce(int numAtoms, const std::vector<std::set<int> >& exclusions,
+                     const Lepton::ParsedExpression& value0Expression,
                      const vector<Lepton::CompiledExpression>& valueExpressions,
                      const vector<vector<Lepton::CompiledExpression> >& valueDerivExpressions,
                      const vector<vector<Lepton::CompiledExpression> >& valueGradientExpressions,
                      const vector<vector<Lepton::CompiledExpression> >& valueParamDerivExpressions,
                      const vector<string>& valueNames,
                      const vector<CustomGBForce::ComputationType>& valueTypes,
-                     const vector<Lepton::CompiledExpression>& energyExpressions,
-                     const vector<vector<Lepton::CompiledExpression> >& energyDerivExpressions,
-                     const vector<vector<Lepton::CompiledExpression> >& energyGradientExpressions,
-                     const vector<vector<Lepton::CompiledExpression> >& energyParamDerivExpressions,
+                     const vector<vector<Lepton::ParsedExpression> >& energyExpressions,
                      const vector<CustomGBForce::ComputationType>& energyTypes,
                      const vector<string>& parameterNames, ThreadPool& threads) :
             exclusions(exclusions), cutoff(false), periodic(false), valueTypes(valueTypes), energyTypes(energyTypes), numValues(valueNames.size()),
             numParams(parameterNames.size()), threads(threads) {
+    // The vectorized expression cannot accumulate parameter derivatives, so fall back to
+    // the scalar expressions when any are requested.
+
+    useVectorizedExpressions = (valueParamDerivExpressions[0].size() == 0);
     for (int i = 0; i < threads.getNumThreads(); i++)
-        threadData.push_back(new ThreadData(numAtoms, threads.getNumThreads(), i, valueExpressions, valueDerivExpressions, valueGradientExpressions,
-                valueParamDerivExpressions, valueNames, energyExpressions, energyDerivExpressions, energyGradientExpressions, energyParamDerivExpressions, parameterNames));
+        threadData.push_back(new ThreadData(numAtoms, threads.getNumThreads(), i, value0Expression, valueExpressions, valueDerivExpressions, valueGradientExpressions,
+                valueParamDerivExpressions, valueNames, energyExpressions, parameterNames));
     values.resize(numValues);
     dEdV.resize(numValues);
     for (int i = 0; i < (int) values.size(); i++) {
@@ -258,6 +271,12 @@ void CpuCustomGBForce::threadComputeForce(ThreadPool& threads, int threadIndex)
     fvec4 invBoxSize((1/periodicBoxSize[0]), (1/periodicBoxSize[1]), (1/periodicBoxSize[2]), 0);
     for (auto& param : *globalParameters)
         data.expressionSet.setVariable(data.expressionSet.getVariableIndex(param.first), param.second);
+    for (auto& global : data.globalIndex) {
+        float value = (float) globalParameters->at(global.first);
+        for (int j = 0; j < 4; j++)
+            data.globalVec[4*global.second+j] = value;
+    }
+    data.batchSize = 0;
 
     // Calculate the first computed value.
 
@@ -367,14 +386,15 @@ void CpuCustomGBForce::calculateParticlePairValue(int index, ThreadData& data, i
             const int blockSize = neighborList->getBlockSize();
             const int* blockAtom = &neighborList->getSortedAtoms()[blockSize*blockIndex];
             const vector<int>& neighbors = neighborList->getBlockNeighbors(blockIndex);
-            const vector<char>& blockExclusions = neighborList->getBlockExclusions(blockIndex);
+            const vector<int>& blockExclusions = neighborList->getBlockExclusions(blockIndex);
             for (int i = 0; i < (int) neighbors.size(); i++) {
                 int first = neighbors[i];
                 for (int k = 0; k < blockSize; k++) {
+                    // The exclusions were folded into the block masks when the neighbor list was
+                    // built, so any pair that passes the mask is not excluded.
+
                     if ((blockExclusions[i] & (1<<k)) == 0) {
                         int second = blockAtom[k];
-                        if (useExclusions && exclusions[first].find(second) != exclusions[first].end())
-                            continue;
                         calculateOnePairValue(index, first, second, data, posq, atomParameters, valueArray, boxSize, invBoxSize);
                         calculateOnePairValue(index, second, first, data, posq, atomParameters, valueArray, boxSize, invBoxSize);
                     }
@@ -397,6 +417,11 @@ void CpuCustomGBForce::calculateParticlePairValue(int index, ThreadData& data, i
            }
         }
     }
+
+    // Process any pairs still waiting in the batch.
+
+    if (index == 0 && useVectorizedExpressions)
+        flushValueBatch(data, valueArray);
 }
 
 void CpuCustomGBForce::calculateOnePairValue(int index, int atom1, int atom2, ThreadData& data, float* posq, double** atomParameters,
@@ -408,6 +433,20 @@ void CpuCustomGBForce::calculateOnePairValue(int index, int atom1, int atom2, Th
     getDeltaR(pos2, pos1, deltaR, r2, periodic, boxSize, invBoxSize);
     if (cutoff && r2 >= cutoffDistance2)
         return;
+    if (index == 0 && useVectorizedExpressions) {
+        // Add this pair to the batch, and evaluate the batch once it is full.
+
+        int lane = data.batchSize++;
+        data.batchAtom1[lane] = atom1;
+        data.rVec[lane] = sqrtf(r2);
+        for (int i = 0; i < numParams; i++) {
+            data.particleParamVec[4*(2*i)+lane] = (float) atomParameters[atom1][i];
+            data.particleParamVec[4*(2*i+1)+lane] = (float) atomParameters[atom2][i];
+        }
+        if (data.batchSize == 4)
+            flushValueBatch(data, valueArray);
+        return;
+    }
     data.r = sqrtf(r2);
     for (int i = 0; i < numParams; i++) {
         data.particleParam[i*2] = atomParameters[atom1][i];
@@ -425,6 +464,31 @@ void CpuCustomGBForce::calculateOnePairValue(int index, int atom1, int atom2, Th
         data.dValue0dParam[i][atom1] += data.valueParamDerivExpressions[index][i].evaluate();
 }
 
+void CpuCustomGBForce::flushValueBatch(ThreadData& data, vector<float>& valueArray) {
+    int batchSize = data.batchSize;
+    data.batchSize = 0;
+    if (batchSize == 0)
+        return;
+    if (batchSize == 4) {
+        // The batch is full, so evaluate the expression for all four pairs at once.
+
+        float results[4];
+        data.value0ExpressionVec.evaluate().store(results);
+        for (int i = 0; i < 4; i++)
+            valueArray[data.batchAtom1[i]] += results[i];
+    }
+    else {
+        // A partial batch at the end of a thread's work is evaluated with the scalar expression.
+
+        for (int i = 0; i < batchSize; i++) {
+            data.r = data.rVec[i];
+            for (int j = 0; j < 2*numParams; j++)
+                data.particleParam[j] = data.particleParamVec[4*j+i];
+            valueArray[data.batchAtom1[i]] += (float) data.valueExpressions[0].evaluate();
+        }
+    }
+}
+
 void CpuCustomGBForce::calculateSingleParticleEnergyTerm(int index, ThreadData& data, int numAtoms, float* posq,
         double** atomParameters, float* forces, double& totalEnergy) {
     for (int i = data.firstAtom; i < data.lastAtom; i++) {
@@ -435,18 +499,19 @@ void CpuCustomGBForce::calculateSingleParticleEnergyTerm(int index, ThreadData&
             data.param[j] = atomParameters[i][j];
         for (int j = 0; j < (int) values.size(); j++)
             data.value[j] = values[j][i];
+        data.energyExpressions[index].evaluate();
         if (includeEnergy)
-            totalEnergy += (float) data.energyExpressions[index].evaluate();
-        for (int j = 0; j < (int) values.size(); j++)
-            data.dEdV[j][i] += (float) data.energyDerivExpressions[index][j].evaluate();
-        forces[4*i+0] -= (float) data.energyGradientExpressions[index][0].evaluate();
-        forces[4*i+1] -= (float) data.energyGradientExpressions[index][1].evaluate();
-        forces[4*i+2] -= (float) data.energyGradientExpressions[index][2].evaluate();
-        
+            totalEnergy += (float) data.energyExpressions[index].getOutput(0);
+        for (int j = 0; j < numValues; j++)
+            data.dEdV[j][i] += (float) data.energyExpressions[index].getOutput(1+j);
+        forces[4*i+0] -= (float) data.energyExpressions[index].getOutput(1+numValues);
+        forces[4*i+1] -= (float) data.energyExpressions[index].getOutput(2+numValues);
+        forces[4*i+2] -= (float) data.energyExpressions[index].getOutput(3+numValues);
+
         // Compute derivatives with respect to parameters.
-        
-        for (int k = 0; k < data.energyParamDerivExpressions[index].size(); k++)
-            data.energyParamDerivs[k] += data.energyParamDerivExpressions[index][k].evaluate();
+
+        for (int k = 0; k < data.energyParamDerivs.size(); k++)
+            data.energyParamDerivs[k] += data.energyExpressions[index].getOutput(4+numValues+k);
     }
 }
 
@@ -462,14 +527,12 @@ void CpuCustomGBForce::calculateParticlePairEnergyTerm(int index, ThreadData& da
             const int blockSize = neighborList->getBlockSize();
             const int* blockAtom = &neighborList->getSortedAtoms()[blockSize*blockIndex];
             const vector<int>& neighbors = neighborList->getBlockNeighbors(blockIndex);
-            const vector<char>& blockExclusions = neighborList->getBlockExclusions(blockIndex);
+            const vector<int>& blockExclusions = neighborList->getBlockExclusions(blockIndex);
             for (int i = 0; i < (int) neighbors.size(); i++) {
                 int first = neighbors[i];
                 for (int k = 0; k < blockSize; k++) {
                     if ((blockExclusions[i] & (1<<k)) == 0) {
                         int second = blockAtom[k];
-                        if (useExclusions && exclusions[first].find(second) != exclusions[first].end())
-                            continue;
                         calculateOnePairEnergyTerm(index, first, second, data, posq, atomParameters, forces, totalEnergy, boxSize, invBoxSize);
                     }
                 }
@@ -519,22 +582,23 @@ void CpuCustomGBForce::calculateOnePairEnergyTerm(int index, int atom1, int atom
 
     // Evaluate the energy and its derivatives.
 
+    data.energyExpressions[index].evaluate();
     if (includeEnergy)
-        totalEnergy += (float) data.energyExpressions[index].evaluate();
-    float dEdR = (float) data.energyDerivExpressions[index][0].evaluate();
+        totalEnergy += (float) data.energyExpressions[index].getOutput(0);
+    float dEdR = (float) data.energyExpressions[index].getOutput(1);
     dEdR *= 1/r;
     fvec4 result = deltaR*dEdR;
     (fvec4(forces+4*atom1)-result).store(forces+4*atom1);
     (fvec4(forces+4*atom2)+result).store(forces+4*atom2);
-    for (int i = 0; i < (int) values.size(); i++) {
-        data.dEdV[i][atom1] += (float) data.energyDerivExpressions[index][2*i+1].evaluate();
-        data.dEdV[i][atom2] += (float) data.energyDerivExpressions[index][2*i+2].evaluate();
+    for (int i = 0; i < numValues; i++) {
+        data.dEdV[i][atom1] += (float) data.energyExpressions[index].getOutput(2+2*i);
+        data.dEdV[i][atom2] += (float) data.energyExpressions[index].getOutput(3+2*i);
     }
-        
+
     // Compute derivatives with respect to parameters.
 
-    for (int i = 0; i < data.energyParamDerivExpressions[index].size(); i++)
-        data.energyParamDerivs[i] += data.energyParamDerivExpressions[index][i].evaluate();
+    for (int i = 0; i < data.energyParamDerivs.size(); i++)
+        data.energyParamDerivs[i] += data.energyExpressions[index].getOutput(2+2*numValues+i);
 }
 
 void CpuCustomGBForce::calculateChainRuleForces(ThreadData& data, int numAtoms, float* posq, double** atomParameters,
@@ -549,15 +613,14 @@ void CpuCustomGBForce::calculateChainRuleForces(ThreadData& data, int numAtoms,
             const int blockSize = neighborList->getBlockSize();
             const int* blockAtom = &neighborList->getSortedAtoms()[blockSize*blockIndex];
             const vector<int>& neighbors = neighborList->getBlockNeighbors(blockIndex);
-            const vector<char>& blockExclusions = neighborList->getBlockExclusions(blockIndex);
+            const vector<int>& blockExclusions = neighborList->getBlockExclusions(blockIndex);
             for (int i = 0; i < (int) neighbors.size(); i++) {
                 int first = neighbors[i];
                 for (int k = 0; k < blockSize; k++) {
                     if ((blockExclusions[i] & (1<<k)) == 0) {
                         int second = blockAtom[k];
-                        bool isExcluded = (exclusions[first].find(second) != exclusions[first].end());
-                        calculateOnePairChainRule(first, second, data, posq, atomParameters, forces, isExcluded, boxSize, invBoxSize);
-                        calculateOnePairChainRule(second, first, data, posq, atomParameters, forces, isExcluded, boxSize, invBoxSize);
+                        calculateOnePairChainRule(first, second, data, posq, atomParameters, forces, false, boxSize, invBoxSize);
+                        calculateOnePairChainRule(second, first, data, posq, atomParameters, forces, false, boxSize, invBoxSize);
                     }
                 }
             }
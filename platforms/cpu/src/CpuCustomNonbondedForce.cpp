@@ -33,9 +33,17 @@
 using namespace OpenMM;
 using namespace std;
 
-CpuCustomNonbondedForce::ThreadData::ThreadData(const Lepton::CompiledExpression& energyExpression, const Lepton::CompiledExpression& forceExpression,
-            const vector<string>& parameterNames, const std::vector<Lepton::CompiledExpression> energyParamDerivExpressions) :
-            energyExpression(energyExpression), forceExpression(forceExpression), energyParamDerivExpressions(energyParamDerivExpressions) {
+CpuCustomNonbondedForce::ThreadData::ThreadData(const Lepton::ParsedExpression& energyExpression, const Lepton::ParsedExpression& forceExpression,
+            const vector<string>& parameterNames, const std::vector<Lepton::ParsedExpression>& energyParamDerivExpressions) :
+            batchSize(0) {
+    // Compile the energy, the force, and the parameter derivatives as a single expression
+    // so that subexpressions they share are only computed once.
+
+    vector<Lepton::ParsedExpression> expressions;
+    expressions.push_back(energyExpression);
+    expressions.push_back(forceExpression);
+    expressions.insert(expressions.end(), energyParamDerivExpressions.begin(), energyParamDerivExpressions.end());
+    pairExpression = Lepton::CompiledExpression(expressions);
     map<string, double*> variableLocations;
     variableLocations["r"] = &r;
     particleParam.resize(2*parameterNames.size());
@@ -47,20 +55,42 @@ CpuCustomNonbondedForce::ThreadData::ThreadData(const Lepton::CompiledExpression
         }
     }
     energyParamDerivs.resize(energyParamDerivExpressions.size());
-    this->energyExpression.setVariableLocations(variableLocations);
-    this->forceExpression.setVariableLocations(variableLocations);
-    expressionSet.registerExpression(this->energyExpression);
-    expressionSet.registerExpression(this->forceExpression);
-    for (auto& expression : this->energyParamDerivExpressions) {
-        expression.setVariableLocations(variableLocations);
-        expressionSet.registerExpression(expression);
+    pairExpression.setVariableLocations(variableLocations);
+    expressionSet.registerExpression(pairExpression);
+
+    // Create vectorized versions of the energy and force expressions.  Each variable is
+    // bound to a block of four floats, one for each interaction in a batch.  Any variable
+    // that is not r or a per-particle parameter must be a global parameter.
+
+    rVec.resize(4);
+    particleParamVec.resize(8*parameterNames.size());
+    batchDeltaR.resize(16);
+    map<string, float*> vectorLocations;
+    vectorLocations["r"] = &rVec[0];
+    set<string> variables = pairExpression.getVariables();
+    int numGlobals = 0;
+    for (auto& name : variables)
+        if (variableLocations.find(name) == variableLocations.end())
+            globalIndex[name] = numGlobals++;
+    globalVec.resize(4*numGlobals);
+    for (auto& global : globalIndex)
+        vectorLocations[global.first] = &globalVec[4*global.second];
+    for (int i = 0; i < (int) parameterNames.size(); i++) {
+        for (int j = 0; j < 2; j++) {
+            stringstream name;
+            name << parameterNames[i] << (j+1);
+            vectorLocations[name.str()] = &particleParamVec[4*(i*2+j)];
+        }
     }
+    energyExpressionVec = CpuVectorExpression(energyExpression, vectorLocations);
+    forceExpressionVec = CpuVectorExpression(forceExpression, vectorLocations);
 }
 
-CpuCustomNonbondedForce::CpuCustomNonbondedForce(const Lepton::CompiledExpression& energyExpression,
-            const Lepton::CompiledExpression& forceExpression, const vector<string>& parameterNames, const vector<set<int> >& exclusions,
-            const std::vector<Lepton::CompiledExpression> energyParamDerivExpressions, ThreadPool& threads) :
+CpuCustomNonbondedForce::CpuCustomNonbondedForce(const Lepton::ParsedExpression& energyExpression,
+            const Lepton::ParsedExpression& forceExpression, const vector<string>& parameterNames, const vector<set<int> >& exclusions,
+            const std::vector<Lepton::ParsedExpression>& energyParamDerivExpressions, ThreadPool& threads) :
             cutoff(false), useSwitch(false), periodic(false), useInteractionGroups(false), paramNames(parameterNames), exclusions(exclusions), threads(threads) {
+    useVectorizedExpressions = (energyParamDerivExpressions.size() == 0);
     for (int i = 0; i < threads.getNumThreads(); i++)
         threadData.push_back(new ThreadData(energyExpression, forceExpression, parameterNames, energyParamDerivExpressions));
 }
@@ -169,24 +199,35 @@ void CpuCustomNonbondedForce::threadComputeForce(ThreadPool& threads, int thread
     ThreadData& data = *threadData[threadIndex];
     for (auto& param : *globalParameters)
         data.expressionSet.setVariable(data.expressionSet.getVariableIndex(param.first), param.second);
+    for (auto& global : data.globalIndex) {
+        float value = (float) globalParameters->at(global.first);
+        for (int j = 0; j < 4; j++)
+            data.globalVec[4*global.second+j] = value;
+    }
+    data.batchSize = 0;
     for (auto& deriv : data.energyParamDerivs)
         deriv = 0.0;
     fvec4 boxSize(periodicBoxVectors[0][0], periodicBoxVectors[1][1], periodicBoxVectors[2][2], 0);
     fvec4 invBoxSize(recipBoxSize[0], recipBoxSize[1], recipBoxSize[2], 0);
     if (useInteractionGroups) {
         // The user has specified interaction groups, so compute only the requested interactions.
-        
+        // Claim the precomputed pairs in blocks to reduce contention on the shared counter.
+
+        const int blockSize = 64;
         while (true) {
-            int i = gmx_atomic_fetch_add(reinterpret_cast<gmx_atomic_t*>(atomicCounter), 1);
-            if (i >= groupInteractions.size())
+            int start = gmx_atomic_fetch_add(reinterpret_cast<gmx_atomic_t*>(atomicCounter), blockSize);
+            if (start >= (int) groupInteractions.size())
                 break;
-            int atom1 = groupInteractions[i].first;
-            int atom2 = groupInteractions[i].second;
-            for (int j = 0; j < (int) paramNames.size(); j++) {
-                data.particleParam[j*2] = atomParameters[atom1][j];
-                data.particleParam[j*2+1] = atomParameters[atom2][j];
+            int end = min(start+blockSize, (int) groupInteractions.size());
+            for (int i = start; i < end; i++) {
+                int atom1 = groupInteractions[i].first;
+                int atom2 = groupInteractions[i].second;
+                for (int j = 0; j < (int) paramNames.size(); j++) {
+                    data.particleParam[j*2] = atomParameters[atom1][j];
+                    data.particleParam[j*2+1] = atomParameters[atom2][j];
+                }
+                calculateOneIxn(atom1, atom2, data, forces, energy, boxSize, invBoxSize);
             }
-            calculateOneIxn(atom1, atom2, data, forces, energy, boxSize, invBoxSize);
         }
     }
     else if (cutoff) {
@@ -199,7 +240,7 @@ void CpuCustomNonbondedForce::threadComputeForce(ThreadPool& threads, int thread
             const int blockSize = neighborList->getBlockSize();
             const int* blockAtom = &neighborList->getSortedAtoms()[blockSize*blockIndex];
             const vector<int>& neighbors = neighborList->getBlockNeighbors(blockIndex);
-            const vector<char>& exclusions = neighborList->getBlockExclusions(blockIndex);
+            const vector<int>& exclusions = neighborList->getBlockExclusions(blockIndex);
             for (int i = 0; i < (int) neighbors.size(); i++) {
                 int first = neighbors[i];
                 for (int j = 0; j < (int) paramNames.size(); j++)
@@ -233,6 +274,10 @@ void CpuCustomNonbondedForce::threadComputeForce(ThreadPool& threads, int thread
             }
         }
     }
+
+    // Process any interactions still waiting in the batch.
+
+    flushBatch(data, forces, energy);
 }
 
 void CpuCustomNonbondedForce::calculateOneIxn(int ii, int jj, ThreadData& data, 
@@ -247,12 +292,29 @@ void CpuCustomNonbondedForce::calculateOneIxn(int ii, int jj, ThreadData& data,
     if (cutoff && r2 >= cutoffDistance*cutoffDistance)
         return;
     float r = sqrtf(r2);
+    if (useVectorizedExpressions) {
+        // Add this interaction to the batch, and evaluate the batch once it is full.
+
+        int lane = data.batchSize++;
+        data.batchAtom1[lane] = ii;
+        data.batchAtom2[lane] = jj;
+        data.batchR[lane] = r;
+        deltaR.store(&data.batchDeltaR[4*lane]);
+        for (int j = 0; j < (int) paramNames.size(); j++) {
+            data.particleParamVec[4*(2*j)+lane] = (float) data.particleParam[2*j];
+            data.particleParamVec[4*(2*j+1)+lane] = (float) data.particleParam[2*j+1];
+        }
+        if (data.batchSize == 4)
+            flushBatch(data, forces, totalEnergy);
+        return;
+    }
     data.r = r;
 
     // accumulate forces
 
-    double dEdR = (includeForce ? data.forceExpression.evaluate()/r : 0.0);
-    double energy = (includeEnergy ? data.energyExpression.evaluate() : 0.0);
+    data.pairExpression.evaluate();
+    double dEdR = (includeForce ? data.pairExpression.getOutput(1)/r : 0.0);
+    double energy = (includeEnergy ? data.pairExpression.getOutput(0) : 0.0);
     double switchValue = 1.0;
     if (useSwitch) {
         if (r > switchingDistance) {
@@ -270,11 +332,59 @@ void CpuCustomNonbondedForce::calculateOneIxn(int ii, int jj, ThreadData& data,
     // accumulate energies
 
     totalEnergy += energy;
-    
+
     // Accumulate energy derivatives.
 
-    for (int i = 0; i < data.energyParamDerivExpressions.size(); i++)
-        data.energyParamDerivs[i] += switchValue*data.energyParamDerivExpressions[i].evaluate();
+    for (int i = 0; i < data.energyParamDerivs.size(); i++)
+        data.energyParamDerivs[i] += switchValue*data.pairExpression.getOutput(2+i);
+}
+
+void CpuCustomNonbondedForce::flushBatch(ThreadData& data, float* forces, double& totalEnergy) {
+    int batchSize = data.batchSize;
+    data.batchSize = 0;
+    if (batchSize == 0)
+        return;
+    float dEdRValues[4], energyValues[4];
+    if (batchSize == 4) {
+        // The batch is full, so evaluate the expressions for all four interactions at once.
+
+        for (int i = 0; i < 4; i++)
+            data.rVec[i] = data.batchR[i];
+        if (includeForce)
+            (data.forceExpressionVec.evaluate()/fvec4(&data.rVec[0])).store(dEdRValues);
+        if (includeEnergy)
+            data.energyExpressionVec.evaluate().store(energyValues);
+    }
+    else {
+        // A partial batch at the end of a thread's work is evaluated with the scalar expressions.
+
+        for (int i = 0; i < batchSize; i++) {
+            for (int j = 0; j < 2*(int) paramNames.size(); j++)
+                data.particleParam[j] = data.particleParamVec[4*j+i];
+            data.r = data.batchR[i];
+            data.pairExpression.evaluate();
+            dEdRValues[i] = (float) (includeForce ? data.pairExpression.getOutput(1)/data.r : 0.0);
+            energyValues[i] = (float) (includeEnergy ? data.pairExpression.getOutput(0) : 0.0);
+        }
+    }
+    for (int i = 0; i < batchSize; i++) {
+        double dEdR = (includeForce ? dEdRValues[i] : 0.0);
+        double energy = (includeEnergy ? energyValues[i] : 0.0);
+        double r = data.batchR[i];
+        if (useSwitch && r > switchingDistance) {
+            double t = (r-switchingDistance)/(cutoffDistance-switchingDistance);
+            double switchValue = 1+t*t*t*(-10+t*(15-t*6));
+            double switchDeriv = t*t*(-30+t*(60-t*30))/(cutoffDistance-switchingDistance);
+            dEdR = switchValue*dEdR + energy*switchDeriv/r;
+            energy *= switchValue;
+        }
+        int atom1 = data.batchAtom1[i];
+        int atom2 = data.batchAtom2[i];
+        fvec4 result = fvec4(&data.batchDeltaR[4*i])*dEdR;
+        (fvec4(forces+4*atom1)+result).store(forces+4*atom1);
+        (fvec4(forces+4*atom2)-result).store(forces+4*atom2);
+        totalEnergy += energy;
+    }
 }
 
 void CpuCustomNonbondedForce::getDeltaR(const fvec4& posI, const fvec4& posJ, fvec4& deltaR, float& r2, const fvec4& boxSize, const fvec4& invBoxSize) const {
@@ -35,6 +35,7 @@ using namespace OpenMM;
 const int CpuGBSAOBCForce::NUM_TABLE_POINTS = 4096;
 const float CpuGBSAOBCForce::TABLE_MIN = 0.25f;
 const float CpuGBSAOBCForce::TABLE_MAX = 1.5f;
+const float CpuGBSAOBCForce::EXP_TABLE_MAX = 16.0f;
 
 CpuGBSAOBCForce::CpuGBSAOBCForce() : cutoff(false), periodic(false) {
     logDX = (TABLE_MAX-TABLE_MIN)/NUM_TABLE_POINTS;
@@ -44,6 +45,11 @@ CpuGBSAOBCForce::CpuGBSAOBCForce() : cutoff(false), periodic(false) {
         double x = TABLE_MIN+i*logDX;
         logTable[i] = log(x);
     }
+    expDX = EXP_TABLE_MAX/NUM_TABLE_POINTS;
+    expDXInv = 1.0f/expDX;
+    expTable.resize(NUM_TABLE_POINTS+4);
+    for (int i = 0; i < NUM_TABLE_POINTS+4; i++)
+        expTable[i] = exp(-i*(double)expDX);
 }
 
 void CpuGBSAOBCForce::setUseCutoff(float distance) {
@@ -76,9 +82,9 @@ const std::vector<std::pair<float, float> >& CpuGBSAOBCForce::getParticleParamet
 
 void CpuGBSAOBCForce::setParticleParameters(const std::vector<std::pair<float, float> >& params) {
     particleParams = params;
-    bornRadii.resize(params.size()+3);
-    obcChain.resize(params.size()+3);
-    for (int i = bornRadii.size()-3; i < bornRadii.size(); i++) {
+    bornRadii.resize(params.size()+7);
+    obcChain.resize(params.size()+7);
+    for (int i = bornRadii.size()-7; i < bornRadii.size(); i++) {
         bornRadii[i] = 0;
         obcChain[i] = 0;
     }
@@ -94,7 +100,7 @@ void CpuGBSAOBCForce::computeForce(const AlignedArray<float>& posq, vector<Align
     threadEnergy.resize(numThreads);
     threadBornForces.resize(numThreads);
     for (int i = 0; i < numThreads; i++)
-        threadBornForces[i].resize(particleParams.size()+3);
+        threadBornForces[i].resize(particleParams.size()+7);
     gmx_atomic_t counter;
     this->atomicCounter = &counter;
     
@@ -102,10 +108,7 @@ void CpuGBSAOBCForce::computeForce(const AlignedArray<float>& posq, vector<Align
     
     gmx_atomic_set(&counter, 0);
     threads.execute([&] (ThreadPool& threads, int threadIndex) { threadComputeForce(threads, threadIndex); });
-    threads.waitForThreads(); // Compute Born radii
-    gmx_atomic_set(&counter, 0);
-    threads.resumeThreads();
-    threads.waitForThreads(); // Compute surface area term
+    threads.waitForThreads(); // Compute Born radii and the surface area term
     gmx_atomic_set(&counter, 0);
     threads.resumeThreads();
     threads.waitForThreads(); // First loop
@@ -135,8 +138,13 @@ void CpuGBSAOBCForce::threadComputeForce(ThreadPool& threads, int threadIndex) {
     int start = (threadIndex*numParticles)/numThreads;
     int end = ((threadIndex+1)*numParticles)/numThreads;
 
-    // Calculate Born radii
+    // Calculate Born radii, along with the ACE surface area term that depends only on them.
 
+    const float probeRadius = 0.14f;
+    double energy = 0.0;
+    AlignedArray<float>& bornForces = threadBornForces[threadIndex];
+    for (int i = 0; i < numParticles; i++)
+        bornForces[i] = 0.0f;
     while (true) {
         int blockStart = gmx_atomic_fetch_add(reinterpret_cast<gmx_atomic_t*>(atomicCounter), 4);
         if (blockStart >= numParticles)
@@ -200,34 +208,17 @@ void CpuGBSAOBCForce::threadComputeForce(ThreadPool& threads, int threadIndex) {
             bornRadii[atomIndex] = 1.0f/(1.0f/atomRadius[i] - tanhSum/radiusI);
             obcChain[atomIndex] = atomRadius[i]*(alphaObc - 2.0f*betaObc*sum[i] + 3.0f*gammaObc*sum2);
             obcChain[atomIndex] = (1.0f - tanhSum*tanhSum)*obcChain[atomIndex]/radiusI;
+            if (bornRadii[atomIndex] > 0) {
+                float rsa = radiusI + probeRadius;
+                float ratio6 = powf(radiusI/bornRadii[atomIndex], 6.0f);
+                float saTerm = surfaceAreaFactor*rsa*rsa*ratio6;
+                energy += saTerm;
+                bornForces[atomIndex] = -6.0f*saTerm/bornRadii[atomIndex];
+            }
         }
     }
     threads.syncThreads();
 
-    // Calculate ACE surface area term.
-
-    const float probeRadius = 0.14f;
-    double energy = 0.0;
-    AlignedArray<float>& bornForces = threadBornForces[threadIndex];
-    for (int i = 0; i < numParticles; i++)
-        bornForces[i] = 0.0f;
-    while (true) {
-        int atomI = gmx_atomic_fetch_add(reinterpret_cast<gmx_atomic_t*>(atomicCounter), 1);
-        if (atomI >= numParticles)
-            break;
-        if (bornRadii[atomI] > 0) {
-            float radiusI = particleParams[atomI].first + dielectricOffset;
-            float r = radiusI + probeRadius;
-            float ratio6 = powf(radiusI/bornRadii[atomI], 6.0f);
-            float saTerm = surfaceAreaFactor*r*r*ratio6;
-            energy += saTerm;
-            bornForces[atomI] = -6.0f*saTerm/bornRadii[atomI]; 
-        }
-        else
-            bornForces[atomI] = 0.0f;
-    }
-    threads.syncThreads();
- 
     // First loop of Born energy computation.
 
     float* forces = &(*threadForce)[threadIndex][0];
@@ -271,7 +262,7 @@ void CpuGBSAOBCForce::threadComputeForce(ThreadPool& threads, int threadIndex) {
             fvec4 r = sqrt(r2);
             fvec4 alpha2_ij = radii*bornRadii[atomJ];
             fvec4 D_ij = r2/(4.0f*alpha2_ij);
-            fvec4 expTerm = exp(-D_ij);
+            fvec4 expTerm = fastExp(-D_ij);
             fvec4 denominator2 = r2 + alpha2_ij*expTerm;
             fvec4 denominator = sqrt(denominator2);
             fvec4 Gpol = (partialChargeI*posJ[3])/denominator; 
@@ -417,3 +408,19 @@ fvec4 CpuGBSAOBCForce::fastLog(const fvec4& x) {
     transpose(t1, t2, t3, t4);
     return coeff1*t1 + coeff2*t2;
 }
+
+fvec4 CpuGBSAOBCForce::fastExp(const fvec4& x) {
+    // Evaluate exp(x) for x <= 0 using a lookup table for speed.  Beyond the end of
+    // the table the result is indistinguishable from zero, so just clamp the index.
+
+    fvec4 x1 = min(-x*expDXInv, fvec4((float) NUM_TABLE_POINTS));
+    ivec4 index = floor(x1);
+    fvec4 coeff2 = x1-index;
+    fvec4 coeff1 = 1.0f-coeff2;
+    fvec4 t1(&expTable[index[0]]);
+    fvec4 t2(&expTable[index[1]]);
+    fvec4 t3(&expTable[index[2]]);
+    fvec4 t4(&expTable[index[3]]);
+    transpose(t1, t2, t3, t4);
+    return coeff1*t1 + coeff2*t2;
+}
@@ -0,0 +1,387 @@
+/* Portions copyright (c) 2006-2017 Stanford University and Simbios.
+ * Contributors: Pande Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "CpuGBSAOBCForceVec8.h"
+#include "SimTKOpenMMRealType.h"
+#include "openmm/OpenMMException.h"
+#include "openmm/internal/gmx_atomic.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace OpenMM;
+
+#ifdef _MSC_VER
+    // Workaround for a compiler bug in Visual Studio 10. Hopefully we can remove this
+    // once we move to a later version.
+    #undef __AVX__
+#endif
+
+#if !defined(__AVX__) && !defined(__ARM_NEON__) && !defined(__ARM_NEON)
+CpuGBSAOBCForce* createCpuGBSAOBCForceVec8() {
+    throw OpenMMException("Internal error: OpenMM was compiled without AVX support");
+}
+#else
+/**
+ * Factory method to create a CpuGBSAOBCForceVec8.
+ */
+CpuGBSAOBCForce* createCpuGBSAOBCForceVec8() {
+    return new CpuGBSAOBCForceVec8();
+}
+
+CpuGBSAOBCForceVec8::CpuGBSAOBCForceVec8() {
+}
+
+void CpuGBSAOBCForceVec8::threadComputeForce(ThreadPool& threads, int threadIndex) {
+    int numParticles = particleParams.size();
+    int numThreads = threads.getNumThreads();
+    const float dielectricOffset = 0.009;
+    const float alphaObc = 1.0f;
+    const float betaObc = 0.8f;
+    const float gammaObc = 4.85f;
+    fvec4 boxSize(periodicBoxSize[0], periodicBoxSize[1], periodicBoxSize[2], 0);
+    fvec4 invBoxSize((1/periodicBoxSize[0]), (1/periodicBoxSize[1]), (1/periodicBoxSize[2]), 0);
+
+    // Calculate Born radii, along with the ACE surface area term that depends only on them.
+
+    const float probeRadius = 0.14f;
+    double energy = 0.0;
+    AlignedArray<float>& bornForces = threadBornForces[threadIndex];
+    for (int i = 0; i < (int) bornForces.size(); i++)
+        bornForces[i] = 0.0f;
+    while (true) {
+        int blockStart = gmx_atomic_fetch_add(reinterpret_cast<gmx_atomic_t*>(atomicCounter), 8);
+        if (blockStart >= numParticles)
+            break;
+        int numInBlock = min(8, numParticles-blockStart);
+        fvec8 blockAtomIndex((float) blockStart, (float) (blockStart+1), (float) (blockStart+2), (float) (blockStart+3),
+                             (float) (blockStart+4), (float) (blockStart+5), (float) (blockStart+6), (float) (blockStart+7));
+        float atomRadius[8], atomx[8], atomy[8], atomz[8];
+        int blockMask[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+        for (int i = 0; i < numInBlock; i++) {
+            int atomIndex = blockStart+i;
+            atomRadius[i] = particleParams[atomIndex].first;
+            atomx[i] = posq[4*atomIndex];
+            atomy[i] = posq[4*atomIndex+1];
+            atomz[i] = posq[4*atomIndex+2];
+            blockMask[i] = 0xFFFFFFFF;
+        }
+        for (int i = numInBlock; i < 8; i++) {
+            // Put the unused lanes far away from everything so the computed terms stay finite.
+
+            atomRadius[i] = 1.0f;
+            atomx[i] = 1e6f*(i+1);
+            atomy[i] = 0.0f;
+            atomz[i] = 0.0f;
+        }
+        fvec8 offsetRadiusI(atomRadius);
+        fvec8 radiusIInverse = 1.0f/offsetRadiusI;
+        fvec8 x(atomx);
+        fvec8 y(atomy);
+        fvec8 z(atomz);
+        ivec8 mask(blockMask);
+        fvec8 sum(0.0f);
+        for (int atomJ = 0; atomJ < numParticles; atomJ++) {
+            fvec4 posJ(posq+4*atomJ);
+            fvec8 dx, dy, dz, r2;
+            getDeltaR(posJ, x, y, z, dx, dy, dz, r2, periodic, boxSize, invBoxSize);
+            ivec8 include = mask & (blockAtomIndex != fvec8((float) atomJ));
+            if (cutoff)
+                include = include & (r2 < cutoffDistance*cutoffDistance);
+            if (!any(include))
+                continue;
+            fvec8 r = sqrt(r2);
+            float scaledRadiusJ = particleParams[atomJ].second;
+            float scaledRadiusJ2 = scaledRadiusJ*scaledRadiusJ;
+            fvec8 rScaledRadiusJ = r + scaledRadiusJ;
+            include = include & (offsetRadiusI < rScaledRadiusJ);
+            fvec8 l_ij = 1.0f/max(offsetRadiusI, abs(r-scaledRadiusJ));
+            fvec8 u_ij = 1.0f/rScaledRadiusJ;
+            fvec8 l_ij2 = l_ij*l_ij;
+            fvec8 u_ij2 = u_ij*u_ij;
+            fvec8 rInverse = 1.0f/r;
+            fvec8 r2Inverse = rInverse*rInverse;
+            fvec8 logRatio = fastLog(u_ij/l_ij);
+            fvec8 term = l_ij - u_ij + 0.25f*r*(u_ij2 - l_ij2) + (0.5f*rInverse*logRatio) + (0.25f*scaledRadiusJ*scaledRadiusJ*rInverse)*(l_ij2 - u_ij2);
+            ivec8 includeSmall = include & (offsetRadiusI < scaledRadiusJ-r);
+            term += blend(0.0f, 2.0f*(radiusIInverse-l_ij), includeSmall);
+            sum += blend(0.0f, term, include);
+        }
+        float sums[8];
+        sum.store(sums);
+        for (int i = 0; i < numInBlock; i++) {
+            int atomIndex = blockStart+i;
+            sums[i] *= 0.5f*atomRadius[i];
+            float sum2 = sums[i]*sums[i];
+            float sum3 = sums[i]*sum2;
+            float tanhSum = tanh(alphaObc*sums[i] - betaObc*sum2 + gammaObc*sum3);
+            float radiusI = atomRadius[i] + dielectricOffset;
+            bornRadii[atomIndex] = 1.0f/(1.0f/atomRadius[i] - tanhSum/radiusI);
+            obcChain[atomIndex] = atomRadius[i]*(alphaObc - 2.0f*betaObc*sums[i] + 3.0f*gammaObc*sum2);
+            obcChain[atomIndex] = (1.0f - tanhSum*tanhSum)*obcChain[atomIndex]/radiusI;
+            if (bornRadii[atomIndex] > 0) {
+                float rsa = radiusI + probeRadius;
+                float ratio6 = powf(radiusI/bornRadii[atomIndex], 6.0f);
+                float saTerm = surfaceAreaFactor*rsa*rsa*ratio6;
+                energy += saTerm;
+                bornForces[atomIndex] = -6.0f*saTerm/bornRadii[atomIndex];
+            }
+        }
+    }
+    threads.syncThreads();
+
+    // First loop of Born energy computation.
+
+    float* forces = &(*threadForce)[threadIndex][0];
+    float preFactor;
+    if (soluteDielectric != 0.0f && solventDielectric != 0.0f)
+        preFactor = ONE_4PI_EPS0*((1.0f/solventDielectric) - (1.0f/soluteDielectric));
+    else
+        preFactor = 0.0f;
+    while (true) {
+        int blockStart = gmx_atomic_fetch_add(reinterpret_cast<gmx_atomic_t*>(atomicCounter), 8);
+        if (blockStart >= numParticles)
+            break;
+        int numInBlock = min(8, numParticles-blockStart);
+        fvec8 blockAtomIndex((float) blockStart, (float) (blockStart+1), (float) (blockStart+2), (float) (blockStart+3),
+                             (float) (blockStart+4), (float) (blockStart+5), (float) (blockStart+6), (float) (blockStart+7));
+        float atomCharge[8], atomx[8], atomy[8], atomz[8];
+        int blockMask[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+        fvec8 blockAtomForceX(0.0f), blockAtomForceY(0.0f), blockAtomForceZ(0.0f), blockAtomBornForce(0.0f);
+        for (int i = 0; i < numInBlock; i++) {
+            int atomIndex = blockStart+i;
+            atomx[i] = posq[4*atomIndex];
+            atomy[i] = posq[4*atomIndex+1];
+            atomz[i] = posq[4*atomIndex+2];
+            atomCharge[i] = preFactor*posq[4*atomIndex+3];
+            blockMask[i] = 0xFFFFFFFF;
+        }
+        for (int i = numInBlock; i < 8; i++) {
+            atomCharge[i] = 0.0f;
+            atomx[i] = 1e6f*(i+1);
+            atomy[i] = 0.0f;
+            atomz[i] = 0.0f;
+        }
+        fvec8 radii(&bornRadii[blockStart]);
+        fvec8 x(atomx);
+        fvec8 y(atomy);
+        fvec8 z(atomz);
+        fvec8 partialChargeI(atomCharge);
+        ivec8 mask(blockMask);
+        for (int atomJ = blockStart; atomJ < numParticles; atomJ++) {
+            fvec4 posJ(posq+4*atomJ);
+            fvec8 dx, dy, dz, r2;
+            getDeltaR(posJ, x, y, z, dx, dy, dz, r2, periodic, boxSize, invBoxSize);
+            ivec8 include = mask & (blockAtomIndex <= fvec8((float) atomJ));
+            if (cutoff)
+                include = include & (r2 < cutoffDistance*cutoffDistance);
+            if (!any(include))
+                continue;
+            fvec8 r = sqrt(r2);
+            fvec8 alpha2_ij = radii*bornRadii[atomJ];
+            fvec8 D_ij = r2/(4.0f*alpha2_ij);
+            fvec8 expTerm = fastExp(-D_ij);
+            fvec8 denominator2 = r2 + alpha2_ij*expTerm;
+            fvec8 denominator = sqrt(denominator2);
+            fvec8 Gpol = (partialChargeI*posJ[3])/denominator;
+            fvec8 dGpol_dr = -Gpol*(1.0f - 0.25f*expTerm)/denominator2;
+            fvec8 dGpol_dalpha2_ij = -0.5f*Gpol*expTerm*(1.0f + D_ij)/denominator2;
+            dGpol_dr = blend(0.0f, dGpol_dr, include);
+            dGpol_dalpha2_ij = blend(0.0f, dGpol_dalpha2_ij, include);
+            fvec8 fx = dx*dGpol_dr;
+            fvec8 fy = dy*dGpol_dr;
+            fvec8 fz = dz*dGpol_dr;
+            blockAtomForceX -= fx;
+            blockAtomForceY -= fy;
+            blockAtomForceZ -= fz;
+            blockAtomBornForce += dGpol_dalpha2_ij*bornRadii[atomJ];
+            float* atomForce = forces+4*atomJ;
+            fvec8 one(1.0f);
+            atomForce[0] += dot8(fx, one);
+            atomForce[1] += dot8(fy, one);
+            atomForce[2] += dot8(fz, one);
+            ivec8 atomJMask = include & (blockAtomIndex != fvec8((float) atomJ));
+            fvec8 termEnergy = blend(0.0f, Gpol, include);
+            if (cutoff)
+                termEnergy -= blend(0.0f, partialChargeI*posJ[3]/cutoffDistance, atomJMask);
+            termEnergy *= blend(0.5f, 1.0f, atomJMask);
+            energy += dot8(termEnergy, one);
+            bornForces[atomJ] += dot8(blend(0.0f, dGpol_dalpha2_ij, atomJMask), radii);
+        }
+        fvec4 f[8];
+        transpose(blockAtomForceX, blockAtomForceY, blockAtomForceZ, fvec8(0.0f), f[0], f[1], f[2], f[3], f[4], f[5], f[6], f[7]);
+        float blockBornForce[8];
+        blockAtomBornForce.store(blockBornForce);
+        for (int i = 0; i < numInBlock; i++) {
+            int atomIndex = blockStart+i;
+            (fvec4(forces+4*atomIndex)+f[i]).store(forces+4*atomIndex);
+            bornForces[atomIndex] += blockBornForce[i];
+        }
+    }
+    threads.syncThreads();
+
+    // Second loop of Born energy computation.
+
+    while (true) {
+        int blockStart = gmx_atomic_fetch_add(reinterpret_cast<gmx_atomic_t*>(atomicCounter), 8);
+        if (blockStart >= numParticles)
+            break;
+        fvec8 bornForce(0.0f);
+        for (int i = 0; i < numThreads; i++)
+            bornForce += fvec8(&threadBornForces[i][blockStart]);
+        fvec8 radii(&bornRadii[blockStart]);
+        bornForce *= radii*radii*fvec8(&obcChain[blockStart]);
+        int numInBlock = min(8, numParticles-blockStart);
+        fvec8 blockAtomIndex((float) blockStart, (float) (blockStart+1), (float) (blockStart+2), (float) (blockStart+3),
+                             (float) (blockStart+4), (float) (blockStart+5), (float) (blockStart+6), (float) (blockStart+7));
+        float atomRadius[8], atomx[8], atomy[8], atomz[8];
+        int blockMask[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+        fvec8 blockAtomForceX(0.0f), blockAtomForceY(0.0f), blockAtomForceZ(0.0f);
+        for (int i = 0; i < numInBlock; i++) {
+            int atomIndex = blockStart+i;
+            atomRadius[i] = particleParams[atomIndex].first;
+            atomx[i] = posq[4*atomIndex];
+            atomy[i] = posq[4*atomIndex+1];
+            atomz[i] = posq[4*atomIndex+2];
+            blockMask[i] = 0xFFFFFFFF;
+        }
+        for (int i = numInBlock; i < 8; i++) {
+            atomRadius[i] = 1.0f;
+            atomx[i] = 1e6f*(i+1);
+            atomy[i] = 0.0f;
+            atomz[i] = 0.0f;
+        }
+        fvec8 offsetRadiusI(atomRadius);
+        fvec8 x(atomx);
+        fvec8 y(atomy);
+        fvec8 z(atomz);
+        ivec8 mask(blockMask);
+        for (int atomJ = 0; atomJ < numParticles; atomJ++) {
+            fvec4 posJ(posq+4*atomJ);
+            fvec8 dx, dy, dz, r2;
+            getDeltaR(posJ, x, y, z, dx, dy, dz, r2, periodic, boxSize, invBoxSize);
+            ivec8 include = mask & (blockAtomIndex != fvec8((float) atomJ));
+            if (cutoff)
+                include = include & (r2 < cutoffDistance*cutoffDistance);
+            if (!any(include))
+                continue;
+            fvec8 r = sqrt(r2);
+            float scaledRadiusJ = particleParams[atomJ].second;
+            float scaledRadiusJ2 = scaledRadiusJ*scaledRadiusJ;
+            fvec8 rScaledRadiusJ = r + scaledRadiusJ;
+            include = include & (offsetRadiusI < rScaledRadiusJ);
+            fvec8 l_ij = 1.0f/max(offsetRadiusI, abs(r-scaledRadiusJ));
+            fvec8 u_ij = 1.0f/rScaledRadiusJ;
+            fvec8 l_ij2 = l_ij*l_ij;
+            fvec8 u_ij2 = u_ij*u_ij;
+            fvec8 rInverse = 1.0f/r;
+            fvec8 r2Inverse = rInverse*rInverse;
+            fvec8 logRatio = fastLog(u_ij/l_ij);
+            fvec8 t3 = 0.125f*(1.0f + scaledRadiusJ2*r2Inverse)*(l_ij2 - u_ij2) + 0.25f*logRatio*r2Inverse;
+            fvec8 de = bornForce*t3*rInverse;
+            de = blend(0.0f, de, include);
+            fvec8 fx = dx*de;
+            fvec8 fy = dy*de;
+            fvec8 fz = dz*de;
+            blockAtomForceX += fx;
+            blockAtomForceY += fy;
+            blockAtomForceZ += fz;
+            float* atomForce = forces+4*atomJ;
+            fvec8 one(1.0f);
+            atomForce[0] -= dot8(fx, one);
+            atomForce[1] -= dot8(fy, one);
+            atomForce[2] -= dot8(fz, one);
+        }
+        fvec4 f[8];
+        transpose(blockAtomForceX, blockAtomForceY, blockAtomForceZ, fvec8(0.0f), f[0], f[1], f[2], f[3], f[4], f[5], f[6], f[7]);
+        for (int i = 0; i < numInBlock; i++) {
+            int atomIndex = blockStart+i;
+            (fvec4(forces+4*atomIndex)+f[i]).store(forces+4*atomIndex);
+        }
+    }
+    threadEnergy[threadIndex] = energy;
+}
+
+void CpuGBSAOBCForceVec8::getDeltaR(const fvec4& posI, const fvec8& x, const fvec8& y, const fvec8& z, fvec8& dx, fvec8& dy, fvec8& dz, fvec8& r2, bool periodic, const fvec4& boxSize, const fvec4& invBoxSize) const {
+    dx = x-posI[0];
+    dy = y-posI[1];
+    dz = z-posI[2];
+    if (periodic) {
+        dx -= round(dx*invBoxSize[0])*boxSize[0];
+        dy -= round(dy*invBoxSize[1])*boxSize[1];
+        dz -= round(dz*invBoxSize[2])*boxSize[2];
+    }
+    r2 = dx*dx + dy*dy + dz*dz;
+}
+
+fvec8 CpuGBSAOBCForceVec8::fastLog(const fvec8& x) {
+    // Evaluate log(x) using a lookup table for speed.
+
+    fvec8 x1 = (x-TABLE_MIN)*logDXInv;
+    ivec8 index = floor(x1);
+    ivec4 indexLower = index.lowerVec();
+    ivec4 indexUpper = index.upperVec();
+    if (any((indexLower < 0) | (indexLower >= NUM_TABLE_POINTS)) || any((indexUpper < 0) | (indexUpper >= NUM_TABLE_POINTS))) {
+        float vals[8];
+        x.store(vals);
+        return fvec8(logf(vals[0]), logf(vals[1]), logf(vals[2]), logf(vals[3]), logf(vals[4]), logf(vals[5]), logf(vals[6]), logf(vals[7]));
+    }
+    fvec8 coeff2 = x1-index;
+    fvec8 coeff1 = 1.0f-coeff2;
+    fvec4 t1(&logTable[indexLower[0]]);
+    fvec4 t2(&logTable[indexLower[1]]);
+    fvec4 t3(&logTable[indexLower[2]]);
+    fvec4 t4(&logTable[indexLower[3]]);
+    fvec4 t5(&logTable[indexUpper[0]]);
+    fvec4 t6(&logTable[indexUpper[1]]);
+    fvec4 t7(&logTable[indexUpper[2]]);
+    fvec4 t8(&logTable[indexUpper[3]]);
+    fvec8 s1, s2, s3, s4;
+    transpose(t1, t2, t3, t4, t5, t6, t7, t8, s1, s2, s3, s4);
+    return coeff1*s1 + coeff2*s2;
+}
+
+fvec8 CpuGBSAOBCForceVec8::fastExp(const fvec8& x) {
+    // Evaluate exp(x) for x <= 0 using a lookup table for speed.  Beyond the end of
+    // the table the result is indistinguishable from zero, so just clamp the index.
+
+    fvec8 x1 = min(-x*expDXInv, fvec8((float) NUM_TABLE_POINTS));
+    ivec8 index = floor(x1);
+    fvec8 coeff2 = x1-index;
+    fvec8 coeff1 = 1.0f-coeff2;
+    ivec4 indexLower = index.lowerVec();
+    ivec4 indexUpper = index.upperVec();
+    fvec4 t1(&expTable[indexLower[0]]);
+    fvec4 t2(&expTable[indexLower[1]]);
+    fvec4 t3(&expTable[indexLower[2]]);
+    fvec4 t4(&expTable[indexLower[3]]);
+    fvec4 t5(&expTable[indexUpper[0]]);
+    fvec4 t6(&expTable[indexUpper[1]]);
+    fvec4 t7(&expTable[indexUpper[2]]);
+    fvec4 t8(&expTable[indexUpper[3]]);
+    fvec8 s1, s2, s3, s4;
+    transpose(t1, t2, t3, t4, t5, t6, t7, t8, s1, s2, s3, s4);
+    return coeff1*s1 + coeff2*s2;
+}
+
+#endif
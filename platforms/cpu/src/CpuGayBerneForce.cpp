@@ -107,12 +107,8 @@ double CpuGayBerneForce::calculateForce(const vector<Vec3>& positions, std::vect
             throw OpenMMException("The periodic box size has decreased to less than twice the nonbonded cutoff.");
     }
 
-    // First find the orientations of the particles and compute the matrices we'll be needing.
-
-    computeEllipsoidFrames(positions);
-
     // Record the parameters for the threads.
-    
+
     ThreadPool& threads = data.threads;
     int numThreads = threads.getNumThreads();
     this->positions = &positions[0];
@@ -123,20 +119,31 @@ double CpuGayBerneForce::calculateForce(const vector<Vec3>& positions, std::vect
     gmx_atomic_t counter;
     gmx_atomic_set(&counter, 0);
     this->atomicCounter = &counter;
-    
-    // Signal the threads to compute the pairwise interactions.
-    
+
+    // Signal the threads to find the orientations of the particles and compute the
+    // matrices we'll be needing.
+
     threads.execute([&] (ThreadPool& threads, int threadIndex) { threadComputeForce(threads, threadIndex, data.neighborList); });
     threads.waitForThreads();
-    
+
+    // Signal the threads to compute the pairwise interactions.
+
+    threads.resumeThreads();
+    threads.waitForThreads();
+
     // Signal the threads to compute exceptions.
     
     gmx_atomic_set(&counter, 0);
     threads.resumeThreads();
     threads.waitForThreads();
-    
+
+    // Signal the threads to sum the torques.
+
+    threads.resumeThreads();
+    threads.waitForThreads();
+
     // Combine the energies from all the threads.
-    
+
     double energy = 0;
     for (int i = 0; i < numThreads; i++)
         energy += threadEnergy[i];
@@ -158,6 +165,15 @@ void CpuGayBerneForce::threadComputeForce(ThreadPool& threads, int threadIndex,
         torques[i] = Vec3();
     double energy = 0.0;
 
+    // Find the orientations of this thread's subset of the particles and compute the
+    // matrices we'll be needing.  The pair loop needs the matrices for every particle,
+    // so all the threads synchronize before continuing.
+
+    int start = (threadIndex*numParticles)/numThreads;
+    int end = ((threadIndex+1)*numParticles)/numThreads;
+    computeEllipsoidFrames(start, end);
+    threads.syncThreads();
+
     // Compute this thread's subset of interactions.
     
     if (neighborList == NULL) {
@@ -186,7 +202,7 @@ void CpuGayBerneForce::threadComputeForce(ThreadPool& threads, int threadIndex,
             const int blockSize = neighborList->getBlockSize();
             const int* blockAtom = &neighborList->getSortedAtoms()[blockSize*blockIndex];
             const vector<int>& neighbors = neighborList->getBlockNeighbors(blockIndex);
-            const vector<char>& exclusions = neighborList->getBlockExclusions(blockIndex);
+            const vector<int>& exclusions = neighborList->getBlockExclusions(blockIndex);
             for (int i = 0; i < (int) neighbors.size(); i++) {
                 int first = neighbors[i];
                 if (particles[first].sqrtEpsilon == 0.0f)
@@ -221,11 +237,18 @@ void CpuGayBerneForce::threadComputeForce(ThreadPool& threads, int threadIndex,
         }
     }
     threadEnergy[threadIndex] = energy;
+    threads.syncThreads();
+
+    // Sum the torques from all the threads.  Each thread handles a block of the particles,
+    // so the time this takes doesn't grow with the number of threads.
+
+    for (int i = start; i < end; i++)
+        for (int j = 1; j < numThreads; j++)
+            threadTorque[0][i] += threadTorque[j][i];
 }
 
-void CpuGayBerneForce::computeEllipsoidFrames(const vector<Vec3>& positions) {
-    int numParticles = particles.size();
-    for (int particle = 0; particle < numParticles; particle++) {
+void CpuGayBerneForce::computeEllipsoidFrames(int start, int end) {
+    for (int particle = start; particle < end; particle++) {
         ParticleInfo& p = particles[particle];
 
         // Compute the local coordinate system of the ellipsoid;
@@ -281,17 +304,15 @@ void CpuGayBerneForce::computeEllipsoidFrames(const vector<Vec3>& positions) {
 
 void CpuGayBerneForce::applyTorques(const vector<Vec3>& positions, vector<Vec3>& forces) {
     int numParticles = particles.size();
-    int numThreads = threadTorque.size();
     for (int particle = 0; particle < numParticles; particle++) {
         ParticleInfo& p = particles[particle];
         Vec3 pos = positions[particle];
         if (p.xparticle != -1) {
-            // Add up the torques from the individual threads.
-            
-            Vec3 torque;
-            for (int i = 0; i < numThreads; i++)
-                torque += threadTorque[i][particle];
-            
+            // The torques from the individual threads have already been summed into the
+            // first thread's buffer.
+
+            Vec3 torque = threadTorque[0][particle];
+
             // Apply a force to the x particle.
             
             Vec3 dx = positions[p.xparticle]-pos;
@@ -361,8 +382,8 @@ double CpuGayBerneForce::computeOneInteraction(int particle1, int particle2, dou
     Matrix B12 = B[particle1]+B[particle2];
     Matrix G12 = G[particle1]+G[particle2];
     Matrix B12inv = B12.inverse();
-    Matrix G12inv = G12.inverse();
-    double detG12 = G12.determinant();
+    double detG12;
+    Matrix G12inv = G12.inverse(detG12);
 
     // Estimate the distance between the ellipsoids and compute the first terms needed for the energy.
 
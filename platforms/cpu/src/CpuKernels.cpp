@@ -32,6 +32,7 @@
 #include "CpuKernels.h"
 #include "ReferenceAngleBondIxn.h"
 #include "ReferenceBondForce.h"
+#include "ReferenceCMAPTorsionIxn.h"
 #include "ReferenceConstraints.h"
 #include "ReferenceKernelFactory.h"
 #include "ReferenceKernels.h"
@@ -39,10 +40,13 @@
 #include "ReferenceProperDihedralBond.h"
 #include "ReferenceRbDihedralBond.h"
 #include "ReferenceTabulatedFunction.h"
+#include "ReferenceVirtualSites.h"
 #include "openmm/Context.h"
 #include "openmm/OpenMMException.h"
 #include "openmm/Vec3.h"
 #include "openmm/internal/ContextImpl.h"
+#include "openmm/internal/CMAPTorsionForceImpl.h"
+#include "openmm/internal/CustomCompoundBondForceImpl.h"
 #include "openmm/internal/CustomNonbondedForceImpl.h"
 #include "openmm/internal/NonbondedForceImpl.h"
 #include "openmm/internal/vectorize.h"
@@ -86,6 +90,11 @@ static ReferenceConstraints& extractConstraints(ContextImpl& context) {
     return *(ReferenceConstraints*) data->constraints;
 }
 
+static const ReferenceVirtualSites& extractVirtualSites(ContextImpl& context) {
+    ReferencePlatform::PlatformData* data = reinterpret_cast<ReferencePlatform::PlatformData*>(context.getPlatformData());
+    return *(ReferenceVirtualSites*) data->virtualSites;
+}
+
 static map<string, double>& extractEnergyParameterDerivatives(ContextImpl& context) {
     ReferencePlatform::PlatformData* data = reinterpret_cast<ReferencePlatform::PlatformData*>(context.getPlatformData());
     return *((map<string, double>*) data->energyParameterDerivatives);
@@ -139,7 +148,7 @@ static double computeShiftedKineticEnergy(ContextImpl& context, vector<double>&
 }
 
 CpuCalcForcesAndEnergyKernel::CpuCalcForcesAndEnergyKernel(std::string name, const Platform& platform, CpuPlatform::PlatformData& data, ContextImpl& context) :
-        CalcForcesAndEnergyKernel(name, platform), data(data) {
+        CalcForcesAndEnergyKernel(name, platform), data(data), taskGraph(data.threads) {
     // Create a Reference platform version of this kernel.
     
     ReferenceKernelFactory referenceFactory;
@@ -153,139 +162,178 @@ void CpuCalcForcesAndEnergyKernel::initialize(const System& system) {
 
 void CpuCalcForcesAndEnergyKernel::beginComputation(ContextImpl& context, bool includeForce, bool includeEnergy, int groups) {
     referenceKernel.getAs<ReferenceCalcForcesAndEnergyKernel>().beginComputation(context, includeForce, includeEnergy, groups);
-    
-    // Convert positions to single precision and clear the forces.
+
+    // Build a task graph that converts the positions to single precision, clears the force
+    // buffers, and decides whether the neighbor list needs to be recomputed.  None of these
+    // depend on each other, so they can all run concurrently.
 
     int numParticles = context.getSystem().getNumParticles();
+    int numThreads = data.threads.getNumThreads();
     bool positionsValid = true;
-    data.threads.execute([&] (ThreadPool& threads, int threadIndex) {
-        // Convert the positions to single precision and apply periodic boundary conditions
-
-        AlignedArray<float>& posq = data.posq;
-        vector<Vec3>& posData = extractPositions(context);
-        Vec3* boxVectors = extractBoxVectors(context);
-        double boxSize[3] = {boxVectors[0][0], boxVectors[1][1], boxVectors[2][2]};
-        double invBoxSize[3] = {1/boxVectors[0][0], 1/boxVectors[1][1], 1/boxVectors[2][2]};
-        bool triclinic = (boxVectors[0][1] != 0 || boxVectors[0][2] != 0 || boxVectors[1][0] != 0 || boxVectors[1][2] != 0 || boxVectors[2][0] != 0 || boxVectors[2][1] != 0);
-        int numParticles = context.getSystem().getNumParticles();
-        int numThreads = threads.getNumThreads();
-        int start = threadIndex*numParticles/numThreads;
-        int end = (threadIndex+1)*numParticles/numThreads;
-        if (data.isPeriodic) {
-            if (triclinic) {
-                for (int i = start; i < end; i++) {
-                    Vec3 pos = posData[i];
-                    pos -= boxVectors[2]*floor(pos[2]*invBoxSize[2]);
-                    pos -= boxVectors[1]*floor(pos[1]*invBoxSize[1]);
-                    pos -= boxVectors[0]*floor(pos[0]*invBoxSize[0]);
-                    posq[4*i] = (float) pos[0];
-                    posq[4*i+1] = (float) pos[1];
-                    posq[4*i+2] = (float) pos[2];
+    for (int thread = 0; thread < numThreads; thread++) {
+        taskGraph.addTask([&, thread] () {
+            // Convert the positions to single precision and apply periodic boundary conditions
+
+            AlignedArray<float>& posq = data.posq;
+            vector<Vec3>& posData = extractPositions(context);
+            Vec3* boxVectors = extractBoxVectors(context);
+            double boxSize[3] = {boxVectors[0][0], boxVectors[1][1], boxVectors[2][2]};
+            double invBoxSize[3] = {1/boxVectors[0][0], 1/boxVectors[1][1], 1/boxVectors[2][2]};
+            bool triclinic = (boxVectors[0][1] != 0 || boxVectors[0][2] != 0 || boxVectors[1][0] != 0 || boxVectors[1][2] != 0 || boxVectors[2][0] != 0 || boxVectors[2][1] != 0);
+            int start = thread*numParticles/numThreads;
+            int end = (thread+1)*numParticles/numThreads;
+            if (data.isPeriodic) {
+                if (triclinic) {
+                    for (int i = start; i < end; i++) {
+                        Vec3 pos = posData[i];
+                        pos -= boxVectors[2]*floor(pos[2]*invBoxSize[2]);
+                        pos -= boxVectors[1]*floor(pos[1]*invBoxSize[1]);
+                        pos -= boxVectors[0]*floor(pos[0]*invBoxSize[0]);
+                        posq[4*i] = (float) pos[0];
+                        posq[4*i+1] = (float) pos[1];
+                        posq[4*i+2] = (float) pos[2];
+                    }
                 }
-            }
-            else {
-                for (int i = start; i < end; i++) {
-                    for (int j = 0; j < 3; j++) {
-                        double x = posData[i][j];
-                        double base = floor(x*invBoxSize[j])*boxSize[j];
-                        posq[4*i+j] = (float) (x-base);
+                else {
+                    for (int i = start; i < end; i++) {
+                        for (int j = 0; j < 3; j++) {
+                            double x = posData[i][j];
+                            double base = floor(x*invBoxSize[j])*boxSize[j];
+                            posq[4*i+j] = (float) (x-base);
+                        }
                     }
                 }
             }
-        }
-        else
-            for (int i = start; i < end; i++) {
-                posq[4*i] = (float) posData[i][0];
-                posq[4*i+1] = (float) posData[i][1];
-                posq[4*i+2] = (float) posData[i][2];
-            }
-        
-        // Check for invalid positions.
-        
-        for (int i = 4*start; i < 4*end; i += 4)
-            if (posq[i] != posq[i] || posq[i+1] != posq[i+1] || posq[i+2] != posq[i+2])
-                positionsValid = false;
+            else
+                for (int i = start; i < end; i++) {
+                    posq[4*i] = (float) posData[i][0];
+                    posq[4*i+1] = (float) posData[i][1];
+                    posq[4*i+2] = (float) posData[i][2];
+                }
 
-        // Clear the forces.
+            // Check for invalid positions.
 
-        fvec4 zero(0.0f);
-        for (int j = 0; j < numParticles; j++)
-            zero.store(&data.threadForce[threadIndex][j*4]);
-    });
-    data.threads.waitForThreads();
-    if (!positionsValid)
-        throw OpenMMException("Particle coordinate is nan");
+            for (int i = 4*start; i < 4*end; i += 4)
+                if (posq[i] != posq[i] || posq[i+1] != posq[i+1] || posq[i+2] != posq[i+2])
+                    positionsValid = false;
+        });
+    }
+    for (int thread = 0; thread < numThreads; thread++) {
+        taskGraph.addTask([&, thread] () {
+            // Clear the forces.
 
-    // Determine whether we need to recompute the neighbor list.
-        
+            fvec4 zero(0.0f);
+            for (int j = 0; j < numParticles; j++)
+                zero.store(&data.threadForce[thread][j*4]);
+        });
+    }
+    bool needRecompute = false;
     if (data.neighborList != NULL) {
-        double padding = data.paddedCutoff-data.cutoff;;
-        bool needRecompute = false;
-        double closeCutoff2 = 0.25*padding*padding;
-        double farCutoff2 = 0.5*padding*padding;
-        int maxNumMoved = numParticles/10;
-        vector<int> moved;
-        vector<Vec3>& posData = extractPositions(context);
-        for (int i = 0; i < numParticles; i++) {
-            Vec3 delta = posData[i]-lastPositions[i];
-            double dist2 = delta.dot(delta);
-            if (dist2 > closeCutoff2) {
-                moved.push_back(i);
-                if (dist2 > farCutoff2 || moved.size() > maxNumMoved) {
-                    needRecompute = true;
-                    break;
+        taskGraph.addTask([&] () {
+            // Determine whether we need to recompute the neighbor list.  This is based on the
+            // double precision positions, so it can run while they are being converted.
+
+            double padding = data.paddedCutoff-data.cutoff;
+            double closeCutoff2 = 0.25*padding*padding;
+            double farCutoff2 = 0.5*padding*padding;
+            int maxNumMoved = numParticles/10;
+            vector<int> moved;
+            vector<Vec3>& posData = extractPositions(context);
+            for (int i = 0; i < numParticles; i++) {
+                Vec3 delta = posData[i]-lastPositions[i];
+                double dist2 = delta.dot(delta);
+                if (dist2 > closeCutoff2) {
+                    moved.push_back(i);
+                    if (dist2 > farCutoff2 || moved.size() > maxNumMoved) {
+                        needRecompute = true;
+                        break;
+                    }
                 }
             }
-        }
-        if (!needRecompute && moved.size() > 0) {
-            // Some particles have moved further than half the padding distance.  Look for pairs
-            // that are missing from the neighbor list.
-
-            int numMoved = moved.size();
-            double cutoff2 = data.cutoff*data.cutoff;
-            double paddedCutoff2 = data.paddedCutoff*data.paddedCutoff;
-            for (int i = 1; i < numMoved && !needRecompute; i++)
-                for (int j = 0; j < i; j++) {
-                    Vec3 delta = posData[moved[i]]-posData[moved[j]];
-                    if (delta.dot(delta) < cutoff2) {
-                        // These particles should interact.  See if they are in the neighbor list.
-                        
-                        Vec3 oldDelta = lastPositions[moved[i]]-lastPositions[moved[j]];
-                        if (oldDelta.dot(oldDelta) > paddedCutoff2) {
-                            needRecompute = true;
-                            break;
+            if (!needRecompute && moved.size() > 0) {
+                // Some particles have moved further than half the padding distance.  Look for pairs
+                // that are missing from the neighbor list.
+
+                int numMoved = moved.size();
+                double cutoff2 = data.cutoff*data.cutoff;
+                double paddedCutoff2 = data.paddedCutoff*data.paddedCutoff;
+                for (int i = 1; i < numMoved && !needRecompute; i++)
+                    for (int j = 0; j < i; j++) {
+                        Vec3 delta = posData[moved[i]]-posData[moved[j]];
+                        if (delta.dot(delta) < cutoff2) {
+                            // These particles should interact.  See if they are in the neighbor list.
+
+                            Vec3 oldDelta = lastPositions[moved[i]]-lastPositions[moved[j]];
+                            if (oldDelta.dot(oldDelta) > paddedCutoff2) {
+                                needRecompute = true;
+                                break;
+                            }
                         }
                     }
-                }
-        }
-        if (needRecompute) {
-            data.neighborList->computeNeighborList(numParticles, data.posq, data.exclusions, extractBoxVectors(context), data.isPeriodic, data.paddedCutoff, data.threads);
-            lastPositions = posData;
-        }
+            }
+        });
+    }
+    taskGraph.execute();
+    if (!positionsValid)
+        throw OpenMMException("Particle coordinate is nan");
+    if (needRecompute) {
+        // The neighbor list rebuild uses the whole thread pool itself, so it runs after the graph.
+
+        data.tuneNeighborListPadding();
+        data.neighborList->computeNeighborList(numParticles, data.posq, data.exclusions, extractBoxVectors(context), data.isPeriodic, data.paddedCutoff, data.threads);
+        lastPositions = extractPositions(context);
     }
+    else if (data.neighborList != NULL)
+        data.stepsSinceNeighborListRebuild++;
 }
 
 double CpuCalcForcesAndEnergyKernel::finishComputation(ContextImpl& context, bool includeForce, bool includeEnergy, int groups, bool& valid) {
-    // Sum the forces from all the threads.
-    
-    data.threads.execute([&] (ThreadPool& threads, int threadIndex) {
-        // Sum the contributions to forces that have been calculated by different threads.
-        
-        int numParticles = context.getSystem().getNumParticles();
-        int numThreads = threads.getNumThreads();
-        int start = threadIndex*numParticles/numThreads;
-        int end = (threadIndex+1)*numParticles/numThreads;
-        vector<Vec3>& forceData = extractForces(context);
-        for (int i = start; i < end; i++) {
-            fvec4 f(0.0f);
-            for (int j = 0; j < numThreads; j++)
-                f += fvec4(&data.threadForce[j][4*i]);
-            forceData[i][0] += f[0];
-            forceData[i][1] += f[1];
-            forceData[i][2] += f[2];
-        }
-    });
-    data.threads.waitForThreads();
+    // Sum the forces from all the threads.  This can be skipped when only the energy was
+    // requested.
+
+    if (includeForce) {
+        data.threads.execute([&] (ThreadPool& threads, int threadIndex) {
+            // Sum the contributions to forces that have been calculated by different threads.
+
+            int numParticles = context.getSystem().getNumParticles();
+            int numThreads = threads.getNumThreads();
+            int start = threadIndex*numParticles/numThreads;
+            int end = (threadIndex+1)*numParticles/numThreads;
+            vector<Vec3>& forceData = extractForces(context);
+            if (data.deterministicForces) {
+                // Accumulate in 64 bit fixed point, the same representation the GPU
+                // platforms use.  Integer addition is exact, so the combined force does
+                // not depend on how many per-thread buffers the contributions were
+                // spread across.
+
+                const double scale = (double) 0x100000000LL;
+                const double invScale = 1.0/scale;
+                for (int i = start; i < end; i++) {
+                    long long fx = 0, fy = 0, fz = 0;
+                    for (int j = 0; j < numThreads; j++) {
+                        float* f = &data.threadForce[j][4*i];
+                        fx += (long long) ((double) f[0]*scale);
+                        fy += (long long) ((double) f[1]*scale);
+                        fz += (long long) ((double) f[2]*scale);
+                    }
+                    forceData[i][0] += fx*invScale;
+                    forceData[i][1] += fy*invScale;
+                    forceData[i][2] += fz*invScale;
+                }
+            }
+            else {
+                for (int i = start; i < end; i++) {
+                    fvec4 f(0.0f);
+                    for (int j = 0; j < numThreads; j++)
+                        f += fvec4(&data.threadForce[j][4*i]);
+                    forceData[i][0] += f[0];
+                    forceData[i][1] += f[1];
+                    forceData[i][2] += f[2];
+                }
+            }
+        });
+        data.threads.waitForThreads();
+    }
     return referenceKernel.getAs<ReferenceCalcForcesAndEnergyKernel>().finishComputation(context, includeForce, includeEnergy, groups, valid);
 }
 
@@ -484,6 +532,97 @@ void CpuCalcRBTorsionForceKernel::copyParametersToContext(ContextImpl& context,
     }
 }
 
+CpuCalcCMAPTorsionForceKernel::~CpuCalcCMAPTorsionForceKernel() {
+    if (torsionIndexArray != NULL) {
+        for (int i = 0; i < numTorsions; i++) {
+            delete[] torsionIndexArray[i];
+            delete[] torsionParamArray[i];
+        }
+        delete[] torsionIndexArray;
+        delete[] torsionParamArray;
+    }
+}
+
+void CpuCalcCMAPTorsionForceKernel::initialize(const System& system, const CMAPTorsionForce& force) {
+    int numMaps = force.getNumMaps();
+    numTorsions = force.getNumTorsions();
+    coeff.resize(numMaps);
+    vector<double> energy;
+    vector<vector<double> > c;
+    for (int i = 0; i < numMaps; i++) {
+        int size;
+        force.getMapParameters(i, size, energy);
+        CMAPTorsionForceImpl::calcMapDerivatives(size, energy, c);
+        coeff[i].resize(size*size);
+        for (int j = 0; j < size*size; j++) {
+            coeff[i][j].resize(16);
+            for (int k = 0; k < 16; k++)
+                coeff[i][j][k] = c[j][k];
+        }
+    }
+    torsionMaps.resize(numTorsions);
+    torsionIndices.resize(numTorsions);
+    torsionIndexArray = new int*[numTorsions];
+    torsionParamArray = new double*[numTorsions];
+    for (int i = 0; i < numTorsions; i++) {
+        torsionIndices[i].resize(8);
+        force.getTorsionParameters(i, torsionMaps[i], torsionIndices[i][0], torsionIndices[i][1], torsionIndices[i][2],
+            torsionIndices[i][3], torsionIndices[i][4], torsionIndices[i][5], torsionIndices[i][6], torsionIndices[i][7]);
+        torsionIndexArray[i] = new int[8];
+        for (int j = 0; j < 8; j++)
+            torsionIndexArray[i][j] = torsionIndices[i][j];
+        torsionParamArray[i] = new double[1];
+        torsionParamArray[i][0] = torsionMaps[i];
+    }
+    bondForce.initialize(system.getNumParticles(), numTorsions, 8, torsionIndexArray, data.threads);
+    usePeriodic = force.usesPeriodicBoundaryConditions();
+}
+
+double CpuCalcCMAPTorsionForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
+    vector<Vec3>& posData = extractPositions(context);
+    vector<Vec3>& forceData = extractForces(context);
+    double energy = 0;
+    ReferenceCMAPTorsionIxn torsion(coeff, torsionMaps, torsionIndices);
+    if (usePeriodic)
+        torsion.setPeriodic(extractBoxVectors(context));
+    bondForce.calculateForce(posData, torsionParamArray, forceData, includeEnergy ? &energy : NULL, torsion);
+    return energy;
+}
+
+void CpuCalcCMAPTorsionForceKernel::copyParametersToContext(ContextImpl& context, const CMAPTorsionForce& force) {
+    int numMaps = force.getNumMaps();
+    if (coeff.size() != numMaps)
+        throw OpenMMException("updateParametersInContext: The number of maps has changed");
+    if (numTorsions != force.getNumTorsions())
+        throw OpenMMException("updateParametersInContext: The number of CMAP torsions has changed");
+
+    // Update the maps.
+
+    vector<double> energy;
+    vector<vector<double> > c;
+    for (int i = 0; i < numMaps; i++) {
+        int size;
+        force.getMapParameters(i, size, energy);
+        if (coeff[i].size() != size*size)
+            throw OpenMMException("updateParametersInContext: The size of a map has changed");
+        CMAPTorsionForceImpl::calcMapDerivatives(size, energy, c);
+        for (int j = 0; j < size*size; j++)
+            for (int k = 0; k < 16; k++)
+                coeff[i][j][k] = c[j][k];
+    }
+
+    // Update the indices.
+
+    for (int i = 0; i < numTorsions; i++) {
+        int index[8];
+        force.getTorsionParameters(i, torsionMaps[i], index[0], index[1], index[2], index[3], index[4], index[5], index[6], index[7]);
+        for (int j = 0; j < 8; j++)
+            if (index[j] != torsionIndices[i][j])
+                throw OpenMMException("updateParametersInContext: The set of particles in a CMAP torsion has changed");
+        torsionParamArray[i][0] = torsionMaps[i];
+    }
+}
+
 class CpuCalcNonbondedForceKernel::PmeIO : public CalcPmeReciprocalForceKernel::IO {
 public:
     PmeIO(float* posq, float* force, int numParticles) : posq(posq), force(force), numParticles(numParticles) {
@@ -505,12 +644,16 @@ private:
 };
 
 bool isVec8Supported();
+bool isVec16Supported();
 CpuNonbondedForce* createCpuNonbondedForceVec4();
 CpuNonbondedForce* createCpuNonbondedForceVec8();
+CpuNonbondedForce* createCpuNonbondedForceVec16();
 
 CpuCalcNonbondedForceKernel::CpuCalcNonbondedForceKernel(string name, const Platform& platform, CpuPlatform::PlatformData& data) : CalcNonbondedForceKernel(name, platform),
         data(data), bonded14IndexArray(NULL), bonded14ParamArray(NULL), hasInitializedPme(false), hasInitializedDispersionPme(false), nonbonded(NULL) {
-    if (isVec8Supported())
+    if (isVec16Supported())
+        nonbonded = createCpuNonbondedForceVec16();
+    else if (isVec8Supported())
         nonbonded = createCpuNonbondedForceVec8();
     else
         nonbonded = createCpuNonbondedForceVec4();
@@ -623,8 +766,10 @@ void CpuCalcNonbondedForceKernel::initialize(const System& system, const Nonbond
         ewaldSelfEnergy = 0.0;
     }
     rfDielectric = force.getReactionFieldDielectric();
-    if (force.getUseDispersionCorrection())
-        dispersionCoefficient = NonbondedForceImpl::calcDispersionCorrection(system, force);
+    if (force.getUseDispersionCorrection()) {
+        longRangeCorrectionData = NonbondedForceImpl::prepareLongRangeCorrection(force);
+        dispersionCoefficient = NonbondedForceImpl::calcLongRangeCorrection(longRangeCorrectionData, force, system);
+    }
     else
         dispersionCoefficient = 0.0;
     data.isPeriodic = (nonbondedMethod == CutoffPeriodic || nonbondedMethod == Ewald || nonbondedMethod == PME || nonbondedMethod == LJPME);
@@ -710,9 +855,11 @@ double CpuCalcNonbondedForceKernel::execute(ContextImpl& context, bool includeFo
     return energy;
 }
 
-void CpuCalcNonbondedForceKernel::copyParametersToContext(ContextImpl& context, const NonbondedForce& force) {
+void CpuCalcNonbondedForceKernel::copyParametersToContext(ContextImpl& context, const NonbondedForce& force, int firstParticle, int lastParticle, int firstException, int lastException) {
     if (force.getNumParticles() != numParticles)
         throw OpenMMException("updateParametersInContext: The number of particles has changed");
+    if (firstParticle > lastParticle && firstException > lastException)
+        return;
     vector<int> nb14s;
     for (int i = 0; i < force.getNumExceptions(); i++) {
         int particle1, particle2;
@@ -726,19 +873,25 @@ void CpuCalcNonbondedForceKernel::copyParametersToContext(ContextImpl& context,
 
     // Record the values.
 
-    double sumSquaredCharges = 0.0;
-    for (int i = 0; i < numParticles; ++i) {
-        double charge, radius, depth;
-        force.getParticleParameters(i, charge, radius, depth);
-        data.posq[4*i+3] = (float) charge;
-        particleParams[i] = make_pair((float) (0.5*radius), (float) (2.0*sqrt(depth)));
-        sumSquaredCharges += charge*charge;
+    if (firstParticle <= lastParticle) {
+        double sumSquaredCharges = 0.0;
+        for (int i = 0; i < numParticles; ++i) {
+            double charge, radius, depth;
+            force.getParticleParameters(i, charge, radius, depth);
+            if (i >= firstParticle && i <= lastParticle) {
+                data.posq[4*i+3] = (float) charge;
+                particleParams[i] = make_pair((float) (0.5*radius), (float) (2.0*sqrt(depth)));
+            }
+            sumSquaredCharges += charge*charge;
+        }
+        if (nonbondedMethod == Ewald || nonbondedMethod == PME)
+            ewaldSelfEnergy = -ONE_4PI_EPS0*ewaldAlpha*sumSquaredCharges/sqrt(M_PI);
+        else
+            ewaldSelfEnergy = 0.0;
     }
-    if (nonbondedMethod == Ewald || nonbondedMethod == PME)
-        ewaldSelfEnergy = -ONE_4PI_EPS0*ewaldAlpha*sumSquaredCharges/sqrt(M_PI);
-    else
-        ewaldSelfEnergy = 0.0;
     for (int i = 0; i < num14; ++i) {
+        if (nb14s[i] < firstException || nb14s[i] > lastException)
+            continue;
         int particle1, particle2;
         double charge, radius, depth;
         force.getExceptionParameters(nb14s[i], particle1, particle2, charge, radius, depth);
@@ -748,12 +901,14 @@ void CpuCalcNonbondedForceKernel::copyParametersToContext(ContextImpl& context,
         bonded14ParamArray[i][1] = 4.0*depth;
         bonded14ParamArray[i][2] = charge;
     }
-    
+
     // Recompute the coefficient for the dispersion correction.
 
     NonbondedForce::NonbondedMethod method = force.getNonbondedMethod();
-    if (force.getUseDispersionCorrection() && (method == NonbondedForce::CutoffPeriodic || method == NonbondedForce::Ewald || method == NonbondedForce::PME))
-        dispersionCoefficient = NonbondedForceImpl::calcDispersionCorrection(context.getSystem(), force);
+    if (force.getUseDispersionCorrection() && firstParticle <= lastParticle && (method == NonbondedForce::CutoffPeriodic || method == NonbondedForce::Ewald || method == NonbondedForce::PME)) {
+        NonbondedForceImpl::updateLongRangeCorrection(longRangeCorrectionData, force, firstParticle, lastParticle);
+        dispersionCoefficient = NonbondedForceImpl::calcLongRangeCorrection(longRangeCorrectionData, force, context.getSystem());
+    }
 }
 
 void CpuCalcNonbondedForceKernel::getPMEParameters(double& alpha, int& nx, int& ny, int& nz) const {
@@ -842,19 +997,18 @@ void CpuCalcCustomNonbondedForceKernel::initialize(const System& system, const C
     // Parse the various expressions used to calculate the force.
 
     Lepton::ParsedExpression expression = Lepton::Parser::parse(force.getEnergyFunction(), functions).optimize();
-    Lepton::CompiledExpression energyExpression = expression.createCompiledExpression();
-    Lepton::CompiledExpression forceExpression = expression.differentiate("r").createCompiledExpression();
+    Lepton::ParsedExpression forceExpression = expression.differentiate("r").optimize();
     for (int i = 0; i < numParameters; i++)
         parameterNames.push_back(force.getPerParticleParameterName(i));
     for (int i = 0; i < force.getNumGlobalParameters(); i++) {
         globalParameterNames.push_back(force.getGlobalParameterName(i));
         globalParamValues[force.getGlobalParameterName(i)] = force.getGlobalParameterDefaultValue(i);
     }
-    std::vector<Lepton::CompiledExpression> energyParamDerivExpressions;
+    std::vector<Lepton::ParsedExpression> energyParamDerivExpressions;
     for (int i = 0; i < force.getNumEnergyParameterDerivatives(); i++) {
         string param = force.getEnergyParameterDerivativeName(i);
         energyParamDerivNames.push_back(param);
-        energyParamDerivExpressions.push_back(expression.differentiate(param).createCompiledExpression());
+        energyParamDerivExpressions.push_back(expression.differentiate(param));
     }
     set<string> variables;
     variables.insert("r");
@@ -889,7 +1043,7 @@ void CpuCalcCustomNonbondedForceKernel::initialize(const System& system, const C
         interactionGroups.push_back(make_pair(set1, set2));
     }
     data.isPeriodic = (nonbondedMethod == CutoffPeriodic);
-    nonbonded = new CpuCustomNonbondedForce(energyExpression, forceExpression, parameterNames, exclusions, energyParamDerivExpressions, data.threads);
+    nonbonded = new CpuCustomNonbondedForce(expression, forceExpression, parameterNames, exclusions, energyParamDerivExpressions, data.threads);
     if (interactionGroups.size() > 0)
         nonbonded->setInteractionGroups(interactionGroups);
 }
@@ -926,7 +1080,7 @@ double CpuCalcCustomNonbondedForceKernel::execute(ContextImpl& context, bool inc
     // Add in the long range correction.
     
     if (!hasInitializedLongRangeCorrection || (globalParamsChanged && forceCopy != NULL)) {
-        CustomNonbondedForceImpl::calcLongRangeCorrection(*forceCopy, context.getOwner(), longRangeCoefficient, longRangeCoefficientDerivs);
+        CustomNonbondedForceImpl::calcLongRangeCorrection(*forceCopy, longRangeCorrectionData, context.getOwner(), longRangeCoefficient, longRangeCoefficientDerivs);
         hasInitializedLongRangeCorrection = true;
     }
     double volume = boxVectors[0][0]*boxVectors[1][1]*boxVectors[2][2];
@@ -954,16 +1108,134 @@ void CpuCalcCustomNonbondedForceKernel::copyParametersToContext(ContextImpl& con
     // If necessary, recompute the long range correction.
     
     if (forceCopy != NULL) {
-        CustomNonbondedForceImpl::calcLongRangeCorrection(force, context.getOwner(), longRangeCoefficient, longRangeCoefficientDerivs);
+        CustomNonbondedForceImpl::calcLongRangeCorrection(force, longRangeCorrectionData, context.getOwner(), longRangeCoefficient, longRangeCoefficientDerivs);
         hasInitializedLongRangeCorrection = true;
         *forceCopy = force;
     }
 }
 
+CpuCalcCustomCompoundBondForceKernel::~CpuCalcCustomCompoundBondForceKernel() {
+    if (bondAtomArray != NULL) {
+        for (int i = 0; i < numBonds; i++) {
+            delete[] bondAtomArray[i];
+            delete[] bondParamArray[i];
+        }
+        delete[] bondAtomArray;
+        delete[] bondParamArray;
+    }
+    for (auto ixn : ixns)
+        delete ixn;
+}
+
+void CpuCalcCustomCompoundBondForceKernel::initialize(const System& system, const CustomCompoundBondForce& force) {
+    usePeriodic = force.usesPeriodicBoundaryConditions();
+
+    // Build the arrays.
+
+    numBonds = force.getNumBonds();
+    int numParticlesPerBond = force.getNumParticlesPerBond();
+    int numBondParameters = force.getNumPerBondParameters();
+    vector<vector<int> > bondParticles(numBonds);
+    bondAtomArray = new int*[numBonds];
+    bondParamArray = new double*[numBonds];
+    for (int i = 0; i < numBonds; ++i) {
+        vector<double> parameters;
+        force.getBondParameters(i, bondParticles[i], parameters);
+        bondAtomArray[i] = new int[numParticlesPerBond];
+        for (int j = 0; j < numParticlesPerBond; j++)
+            bondAtomArray[i][j] = bondParticles[i][j];
+        bondParamArray[i] = new double[numBondParameters];
+        for (int j = 0; j < numBondParameters; j++)
+            bondParamArray[i][j] = parameters[j];
+    }
+
+    // Create custom functions for the tabulated functions.
+
+    map<string, Lepton::CustomFunction*> functions;
+    for (int i = 0; i < force.getNumFunctions(); i++)
+        functions[force.getTabulatedFunctionName(i)] = createReferenceTabulatedFunction(force.getTabulatedFunction(i));
+
+    // Parse the expression and create the objects used to calculate the interaction.  Each
+    // thread needs its own copy, since evaluating the expressions modifies their variables.
+
+    map<string, vector<int> > distances;
+    map<string, vector<int> > angles;
+    map<string, vector<int> > dihedrals;
+    Lepton::ParsedExpression energyExpression = CustomCompoundBondForceImpl::prepareExpression(force, functions, distances, angles, dihedrals);
+    vector<string> bondParameterNames;
+    for (int i = 0; i < numBondParameters; i++)
+        bondParameterNames.push_back(force.getPerBondParameterName(i));
+    for (int i = 0; i < force.getNumGlobalParameters(); i++)
+        globalParameterNames.push_back(force.getGlobalParameterName(i));
+    for (int i = 0; i < force.getNumEnergyParameterDerivatives(); i++)
+        energyParamDerivNames.push_back(force.getEnergyParameterDerivativeName(i));
+    for (int i = 0; i < data.threads.getNumThreads(); i++) {
+        vector<Lepton::CompiledExpression> energyParamDerivExpressions;
+        for (auto& param : energyParamDerivNames)
+            energyParamDerivExpressions.push_back(energyExpression.differentiate(param).createCompiledExpression());
+        ixns.push_back(new ReferenceCustomCompoundBondIxn(numParticlesPerBond, bondParticles, energyExpression, bondParameterNames,
+                distances, angles, dihedrals, energyParamDerivExpressions));
+        baseIxns.push_back(ixns.back());
+    }
+    bondForce.initialize(system.getNumParticles(), numBonds, numParticlesPerBond, bondAtomArray, data.threads);
+
+    // Delete the custom functions.
+
+    for (auto& function : functions)
+        delete function.second;
+}
+
+double CpuCalcCustomCompoundBondForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy) {
+    vector<Vec3>& posData = extractPositions(context);
+    vector<Vec3>& forceData = extractForces(context);
+    map<string, double> globalParameters;
+    for (auto& name : globalParameterNames)
+        globalParameters[name] = context.getParameter(name);
+    for (auto ixn : ixns) {
+        ixn->setGlobalParameters(globalParameters);
+        if (usePeriodic)
+            ixn->setPeriodic(extractBoxVectors(context));
+    }
+    double energy = 0;
+    bondForce.calculateForce(posData, bondParamArray, forceData, includeEnergy ? &energy : NULL, baseIxns);
+    map<string, double>& energyParamDerivs = extractEnergyParameterDerivatives(context);
+    for (auto ixn : ixns)
+        for (int i = 0; i < energyParamDerivNames.size(); i++)
+            energyParamDerivs[energyParamDerivNames[i]] += ixn->getEnergyParamDerivs()[i];
+    return energy;
+}
+
+void CpuCalcCustomCompoundBondForceKernel::copyParametersToContext(ContextImpl& context, const CustomCompoundBondForce& force) {
+    if (numBonds != force.getNumBonds())
+        throw OpenMMException("updateParametersInContext: The number of bonds has changed");
+
+    // Record the values.
+
+    int numParameters = force.getNumPerBondParameters();
+    vector<int> particles;
+    vector<double> params;
+    for (int i = 0; i < numBonds; ++i) {
+        force.getBondParameters(i, particles, params);
+        for (int j = 0; j < particles.size(); j++)
+            if (particles[j] != bondAtomArray[i][j])
+                throw OpenMMException("updateParametersInContext: The set of particles in a bond has changed");
+        for (int j = 0; j < numParameters; j++)
+            bondParamArray[i][j] = params[j];
+    }
+}
+
+CpuGBSAOBCForce* createCpuGBSAOBCForceVec8();
+
 CpuCalcGBSAOBCForceKernel::~CpuCalcGBSAOBCForceKernel() {
+    if (obc != NULL)
+        delete obc;
 }
 
 void CpuCalcGBSAOBCForceKernel::initialize(const System& system, const GBSAOBCForce& force) {
+    if (isVec8Supported())
+        obc = createCpuGBSAOBCForceVec8();
+    else
+        obc = new CpuGBSAOBCForce();
     int numParticles = system.getNumParticles();
     particleParams.resize(numParticles);
     for (int i = 0; i < numParticles; ++i) {
@@ -973,12 +1245,12 @@ void CpuCalcGBSAOBCForceKernel::initialize(const System& system, const GBSAOBCFo
         radius -= 0.009;
         particleParams[i] = make_pair((float) radius, (float) (scalingFactor*radius));
     }
-    obc.setParticleParameters(particleParams);
-    obc.setSolventDielectric((float) force.getSolventDielectric());
-    obc.setSoluteDielectric((float) force.getSoluteDielectric());
-    obc.setSurfaceAreaEnergy((float) force.getSurfaceAreaEnergy());
+    obc->setParticleParameters(particleParams);
+    obc->setSolventDielectric((float) force.getSolventDielectric());
+    obc->setSoluteDielectric((float) force.getSoluteDielectric());
+    obc->setSurfaceAreaEnergy((float) force.getSurfaceAreaEnergy());
     if (force.getNonbondedMethod() != GBSAOBCForce::NoCutoff)
-        obc.setUseCutoff((float) force.getCutoffDistance());
+        obc->setUseCutoff((float) force.getCutoffDistance());
     data.isPeriodic = (force.getNonbondedMethod() == GBSAOBCForce::CutoffPeriodic);
 }
 
@@ -986,16 +1258,16 @@ double CpuCalcGBSAOBCForceKernel::execute(ContextImpl& context, bool includeForc
     if (data.isPeriodic) {
         Vec3& boxSize = extractBoxSize(context);
         float floatBoxSize[3] = {(float) boxSize[0], (float) boxSize[1], (float) boxSize[2]};
-        obc.setPeriodic(floatBoxSize);
+        obc->setPeriodic(floatBoxSize);
     }
     double energy = 0.0;
-    obc.computeForce(data.posq, data.threadForce, includeEnergy ? &energy : NULL, data.threads);
+    obc->computeForce(data.posq, data.threadForce, includeEnergy ? &energy : NULL, data.threads);
     return energy;
 }
 
 void CpuCalcGBSAOBCForceKernel::copyParametersToContext(ContextImpl& context, const GBSAOBCForce& force) {
     int numParticles = force.getNumParticles();
-    if (numParticles != obc.getParticleParameters().size())
+    if (numParticles != obc->getParticleParameters().size())
         throw OpenMMException("updateParametersInContext: The number of particles has changed");
 
     // Record the values.
@@ -1007,7 +1279,7 @@ void CpuCalcGBSAOBCForceKernel::copyParametersToContext(ContextImpl& context, co
         radius -= 0.009;
         particleParams[i] = make_pair((float) radius, (float) (scalingFactor*radius));
     }
-    obc.setParticleParameters(particleParams);
+    obc->setParticleParameters(particleParams);
 }
 
 CpuCalcCustomGBForceKernel::~CpuCalcCustomGBForceKernel() {
@@ -1078,7 +1350,6 @@ void CpuCalcCustomGBForceKernel::initialize(const System& system, const CustomGB
     vector<vector<Lepton::CompiledExpression> > valueGradientExpressions(force.getNumComputedValues());
     vector<vector<Lepton::CompiledExpression> > valueParamDerivExpressions(force.getNumComputedValues());
     vector<Lepton::CompiledExpression> valueExpressions;
-    vector<Lepton::CompiledExpression> energyExpressions;
     set<string> particleVariables, pairVariables;
     pairVariables.insert("r");
     particleVariables.insert("x");
@@ -1091,6 +1362,7 @@ void CpuCalcCustomGBForceKernel::initialize(const System& system, const CustomGB
     }
     particleVariables.insert(globalParameterNames.begin(), globalParameterNames.end());
     pairVariables.insert(globalParameterNames.begin(), globalParameterNames.end());
+    Lepton::ParsedExpression value0Expression;
     for (int i = 0; i < force.getNumComputedValues(); i++) {
         string name, expression;
         CustomGBForce::ComputationType type;
@@ -1100,6 +1372,7 @@ void CpuCalcCustomGBForceKernel::initialize(const System& system, const CustomGB
         valueTypes.push_back(type);
         valueNames.push_back(name);
         if (i == 0) {
+            value0Expression = ex;
             valueDerivExpressions[i].push_back(ex.differentiate("r").createCompiledExpression());
             validateVariables(ex.getRootNode(), pairVariables);
         }
@@ -1121,45 +1394,45 @@ void CpuCalcCustomGBForceKernel::initialize(const System& system, const CustomGB
         pairVariables.insert(name+"2");
     }
 
-    // Parse the expressions for energy terms.
+    // Parse the expressions for energy terms.  Each term and all of its derivatives are
+    // collected into one list so they can be compiled together, sharing common subexpressions.
 
-    vector<vector<Lepton::CompiledExpression> > energyDerivExpressions(force.getNumEnergyTerms());
-    vector<vector<Lepton::CompiledExpression> > energyGradientExpressions(force.getNumEnergyTerms());
-    vector<vector<Lepton::CompiledExpression> > energyParamDerivExpressions(force.getNumEnergyTerms());
+    vector<vector<Lepton::ParsedExpression> > energyExpressions(force.getNumEnergyTerms());
     for (int i = 0; i < force.getNumEnergyTerms(); i++) {
         string expression;
         CustomGBForce::ComputationType type;
         force.getEnergyTermParameters(i, expression, type);
         Lepton::ParsedExpression ex = Lepton::Parser::parse(expression, functions).optimize();
-        energyExpressions.push_back(ex.createCompiledExpression());
+        energyExpressions[i].push_back(ex);
         energyTypes.push_back(type);
         if (type != CustomGBForce::SingleParticle)
-            energyDerivExpressions[i].push_back(ex.differentiate("r").createCompiledExpression());
+            energyExpressions[i].push_back(ex.differentiate("r"));
         for (int j = 0; j < force.getNumComputedValues(); j++) {
             if (type == CustomGBForce::SingleParticle) {
-                energyDerivExpressions[i].push_back(ex.differentiate(valueNames[j]).createCompiledExpression());
-                energyGradientExpressions[i].push_back(ex.differentiate("x").createCompiledExpression());
-                energyGradientExpressions[i].push_back(ex.differentiate("y").createCompiledExpression());
-                energyGradientExpressions[i].push_back(ex.differentiate("z").createCompiledExpression());
+                energyExpressions[i].push_back(ex.differentiate(valueNames[j]));
                 validateVariables(ex.getRootNode(), particleVariables);
             }
             else {
-                energyDerivExpressions[i].push_back(ex.differentiate(valueNames[j]+"1").createCompiledExpression());
-                energyDerivExpressions[i].push_back(ex.differentiate(valueNames[j]+"2").createCompiledExpression());
+                energyExpressions[i].push_back(ex.differentiate(valueNames[j]+"1"));
+                energyExpressions[i].push_back(ex.differentiate(valueNames[j]+"2"));
                 validateVariables(ex.getRootNode(), pairVariables);
             }
         }
+        if (type == CustomGBForce::SingleParticle) {
+            energyExpressions[i].push_back(ex.differentiate("x"));
+            energyExpressions[i].push_back(ex.differentiate("y"));
+            energyExpressions[i].push_back(ex.differentiate("z"));
+        }
         for (int j = 0; j < force.getNumEnergyParameterDerivatives(); j++)
-            energyParamDerivExpressions[i].push_back(ex.differentiate(force.getEnergyParameterDerivativeName(j)).createCompiledExpression());
+            energyExpressions[i].push_back(ex.differentiate(force.getEnergyParameterDerivativeName(j)));
     }
 
     // Delete the custom functions.
 
     for (auto& function : functions)
         delete function.second;
-    ixn = new CpuCustomGBForce(numParticles, exclusions, valueExpressions, valueDerivExpressions, valueGradientExpressions, valueParamDerivExpressions,
-        valueNames, valueTypes, energyExpressions, energyDerivExpressions, energyGradientExpressions, energyParamDerivExpressions, energyTypes,
-        particleParameterNames, data.threads);
+    ixn = new CpuCustomGBForce(numParticles, exclusions, value0Expression, valueExpressions, valueDerivExpressions, valueGradientExpressions, valueParamDerivExpressions,
+        valueNames, valueTypes, energyExpressions, energyTypes, particleParameterNames, data.threads);
     data.isPeriodic = (force.getNonbondedMethod() == CustomGBForce::CutoffPeriodic);
 }
 
@@ -1318,6 +1591,7 @@ void CpuIntegrateLangevinStepKernel::execute(ContextImpl& context, const Langevi
             delete dynamics;
         dynamics = new CpuLangevinDynamics(context.getSystem().getNumParticles(), stepSize, friction, temperature, data.threads, data.random);
         dynamics->setReferenceConstraintAlgorithm(&extractConstraints(context));
+        dynamics->setVirtualSites(&extractVirtualSites(context));
         prevTemp = temperature;
         prevFriction = friction;
         prevStepSize = stepSize;
@@ -1331,3 +1605,45 @@ void CpuIntegrateLangevinStepKernel::execute(ContextImpl& context, const Langevi
 double CpuIntegrateLangevinStepKernel::computeKineticEnergy(ContextImpl& context, const LangevinIntegrator& integrator) {
     return computeShiftedKineticEnergy(context, masses, 0.5*integrator.getStepSize());
 }
+
+CpuIntegrateLangevinMiddleStepKernel::~CpuIntegrateLangevinMiddleStepKernel() {
+    if (dynamics)
+        delete dynamics;
+}
+
+void CpuIntegrateLangevinMiddleStepKernel::initialize(const System& system, const LangevinMiddleIntegrator& integrator) {
+    int numParticles = system.getNumParticles();
+    masses.resize(numParticles);
+    for (int i = 0; i < numParticles; ++i)
+        masses[i] = static_cast<double>(system.getParticleMass(i));
+    data.random.initialize(integrator.getRandomNumberSeed(), data.threads.getNumThreads());
+}
+
+void CpuIntegrateLangevinMiddleStepKernel::execute(ContextImpl& context, const LangevinMiddleIntegrator& integrator) {
+    double temperature = integrator.getTemperature();
+    double friction = integrator.getFriction();
+    double stepSize = integrator.getStepSize();
+    vector<Vec3>& posData = extractPositions(context);
+    vector<Vec3>& velData = extractVelocities(context);
+    vector<Vec3>& forceData = extractForces(context);
+    if (dynamics == 0 || temperature != prevTemp || friction != prevFriction || stepSize != prevStepSize) {
+        // Recreate the computation objects with the new parameters.
+
+        if (dynamics)
+            delete dynamics;
+        dynamics = new CpuLangevinMiddleDynamics(context.getSystem().getNumParticles(), stepSize, friction, temperature, data.threads, data.random);
+        dynamics->setReferenceConstraintAlgorithm(&extractConstraints(context));
+        dynamics->setVirtualSites(&extractVirtualSites(context));
+        prevTemp = temperature;
+        prevFriction = friction;
+        prevStepSize = stepSize;
+    }
+    dynamics->update(context.getSystem(), posData, velData, forceData, masses, integrator.getConstraintTolerance());
+    ReferencePlatform::PlatformData* refData = reinterpret_cast<ReferencePlatform::PlatformData*>(context.getPlatformData());
+    refData->time += stepSize;
+    refData->stepCount++;
+}
+
+double CpuIntegrateLangevinMiddleStepKernel::computeKineticEnergy(ContextImpl& context, const LangevinMiddleIntegrator& integrator) {
+    return computeShiftedKineticEnergy(context, masses, 0);
+}
@@ -25,17 +25,180 @@
 
 #include "SimTKOpenMMUtilities.h"
 #include "CpuLangevinDynamics.h"
+#include "ReferenceConstraints.h"
+#include "ReferenceVirtualSites.h"
+#include <algorithm>
 
 using namespace OpenMM;
 using namespace std;
 
-CpuLangevinDynamics::CpuLangevinDynamics(int numberOfAtoms, double deltaT, double friction, double temperature, ThreadPool& threads, CpuRandom& random) : 
-           ReferenceStochasticDynamics(numberOfAtoms, deltaT, friction, temperature), threads(threads), random(random) {
+CpuLangevinDynamics::CpuLangevinDynamics(int numberOfAtoms, double deltaT, double friction, double temperature, ThreadPool& threads, CpuRandom& random) :
+           ReferenceStochasticDynamics(numberOfAtoms, deltaT, friction, temperature), threads(threads), random(random),
+           hasCheckedConstraints(false), useFusedUpdate(false), settle(NULL) {
+    // Each thread consumes three Gaussian values per atom in its slice.  Have the
+    // generator fill a pool of them in the background so each step can just read them.
+    // The counter based generator computes values on the fly instead, so they do not
+    // depend on how atoms are divided among threads.
+
+    if (!random.getUseCounterBased()) {
+        int maxAtomsPerThread = (numberOfAtoms+threads.getNumThreads()-1)/threads.getNumThreads();
+        random.createGaussianPool(3*maxAtomsPerThread);
+    }
 }
 
 CpuLangevinDynamics::~CpuLangevinDynamics() {
 }
 
+void CpuLangevinDynamics::update(const System& system, vector<Vec3>& atomCoordinates, vector<Vec3>& velocities,
+                                 vector<Vec3>& forces, vector<double>& masses, double tolerance) {
+    if (!hasCheckedConstraints)
+        initializeFusedUpdate();
+    if (!useFusedUpdate) {
+        ReferenceStochasticDynamics::update(system, atomCoordinates, velocities, forces, masses, tolerance);
+        return;
+    }
+
+    // first-time-through initialization
+
+    int numberOfAtoms = system.getNumParticles();
+    vector<double>& inverseMasses = ReferenceStochasticDynamics::inverseMasses;
+    vector<Vec3>& xPrime = ReferenceStochasticDynamics::xPrime;
+    if (getTimeStep() == 0) {
+        // invert masses
+
+        for (int i = 0; i < numberOfAtoms; i++) {
+            if (masses[i] == 0.0)
+                inverseMasses[i] = 0.0;
+            else
+                inverseMasses[i] = 1.0/masses[i];
+        }
+    }
+
+    // Record the parameters for the threads.
+
+    this->numberOfAtoms = numberOfAtoms;
+    this->atomCoordinates = &atomCoordinates[0];
+    this->velocities = &velocities[0];
+    this->forces = &forces[0];
+    this->inverseMasses = &inverseMasses[0];
+    this->xPrime = &xPrime[0];
+    fusedCoordinates = &atomCoordinates;
+    fusedXPrime = &xPrime;
+    fusedInverseMasses = &inverseMasses;
+    constraintTolerance = tolerance;
+
+    // Signal the threads to start running and wait for them to finish.
+
+    threads.execute([&] (ThreadPool& threads, int threadIndex) { threadUpdateFused(threadIndex); });
+    threads.waitForThreads();
+
+    // Have the background thread start generating the values for the next step, so the
+    // cost overlaps with the force evaluation.
+
+    random.refillGaussianPool();
+
+    if (getVirtualSites() != NULL)
+        getVirtualSites()->computePositions(atomCoordinates);
+    incrementTimeStep();
+}
+
+void CpuLangevinDynamics::initializeFusedUpdate() {
+    hasCheckedConstraints = true;
+    ReferenceConstraints* constraints = dynamic_cast<ReferenceConstraints*>(getReferenceConstraintAlgorithm());
+    if (constraints == NULL || constraints->ccma != NULL)
+        return; // CCMA constraints require the standard multi-pass update.
+    settle = dynamic_cast<CpuSETTLE*>(constraints->settle);
+    if (constraints->settle != NULL && settle == NULL)
+        return;
+    useFusedUpdate = true;
+
+    // Record the atoms in each block of SETTLE clusters, and assign the blocks to threads.
+
+    int numThreads = threads.getNumThreads();
+    int numBlocks = (settle == NULL ? 0 : settle->getNumBlocks());
+    blockAtoms.resize(numBlocks);
+    threadBlocks.resize(numThreads);
+    vector<bool> isConstrained(getNumberOfAtoms(), false);
+    for (int i = 0; i < numBlocks; i++) {
+        ReferenceSETTLEAlgorithm& block = settle->getBlockAlgorithm(i);
+        for (int j = 0; j < block.getNumClusters(); j++) {
+            int atom1, atom2, atom3;
+            double distance1, distance2;
+            block.getClusterParameters(j, atom1, atom2, atom3, distance1, distance2);
+            blockAtoms[i].push_back(atom1);
+            blockAtoms[i].push_back(atom2);
+            blockAtoms[i].push_back(atom3);
+            isConstrained[atom1] = isConstrained[atom2] = isConstrained[atom3] = true;
+        }
+        threadBlocks[i%numThreads].push_back(i);
+    }
+    for (int i = 0; i < getNumberOfAtoms(); i++)
+        if (!isConstrained[i])
+            unconstrainedAtoms.push_back(i);
+
+    // Make sure the pool of random values is large enough for the atoms each thread handles.
+
+    if (!random.getUseCounterBased()) {
+        int maxAtomsPerThread = 0;
+        for (int i = 0; i < numThreads; i++) {
+            int numAtoms = (i+1)*unconstrainedAtoms.size()/numThreads - i*unconstrainedAtoms.size()/numThreads;
+            for (int block : threadBlocks[i])
+                numAtoms += blockAtoms[block].size();
+            maxAtomsPerThread = max(maxAtomsPerThread, numAtoms);
+        }
+        random.createGaussianPool(3*maxAtomsPerThread);
+    }
+}
+
+void CpuLangevinDynamics::threadUpdateFused(int threadIndex) {
+    double dt = getDeltaT();
+    double friction = getFriction();
+    const double vscale = exp(-dt*friction);
+    const double fscale = (friction == 0 ? dt : (1-vscale)/friction);
+    const double kT = BOLTZ*getTemperature();
+    const double noisescale = sqrt(kT*(1-vscale*vscale));
+    const double invStepSize = 1.0/dt;
+    const float* gaussian = (random.getUseCounterBased() ? NULL : random.acquireGaussianPool(threadIndex));
+
+    // Atoms that are not involved in any constraint can be fully updated in a single pass.
+
+    int numUnconstrained = unconstrainedAtoms.size();
+    int start = threadIndex*numUnconstrained/threads.getNumThreads();
+    int end = (threadIndex+1)*numUnconstrained/threads.getNumThreads();
+    for (int i = start; i < end; i++) {
+        int atom = unconstrainedAtoms[i];
+        if (inverseMasses[atom] != 0.0) {
+            double sqrtInvMass = sqrt(inverseMasses[atom]);
+            Vec3 noise = nextNoise(atom, gaussian);
+            velocities[atom] = velocities[atom]*vscale + forces[atom]*(fscale*inverseMasses[atom]) + noise*(noisescale*sqrtInvMass);
+            Vec3 xNew = atomCoordinates[atom]+velocities[atom]*dt;
+            velocities[atom] = (xNew-atomCoordinates[atom])*invStepSize;
+            atomCoordinates[atom] = xNew;
+        }
+    }
+
+    // Update each block of SETTLE clusters and apply the constraints to it while its
+    // data is still in cache.
+
+    for (int block : threadBlocks[threadIndex]) {
+        for (int atom : blockAtoms[block]) {
+            if (inverseMasses[atom] != 0.0) {
+                double sqrtInvMass = sqrt(inverseMasses[atom]);
+                Vec3 noise = nextNoise(atom, gaussian);
+                velocities[atom] = velocities[atom]*vscale + forces[atom]*(fscale*inverseMasses[atom]) + noise*(noisescale*sqrtInvMass);
+                xPrime[atom] = atomCoordinates[atom]+velocities[atom]*dt;
+            }
+        }
+        settle->getBlockAlgorithm(block).apply(*fusedCoordinates, *fusedXPrime, *fusedInverseMasses, constraintTolerance);
+        for (int atom : blockAtoms[block]) {
+            if (inverseMasses[atom] != 0.0) {
+                velocities[atom] = (xPrime[atom]-atomCoordinates[atom])*invStepSize;
+                atomCoordinates[atom] = xPrime[atom];
+            }
+        }
+    }
+}
+
 void CpuLangevinDynamics::updatePart1(int numberOfAtoms, vector<Vec3>& atomCoordinates, vector<Vec3>& velocities,
                                       vector<Vec3>& forces, vector<double>& inverseMasses, vector<Vec3>& xPrime) {
     // Record the parameters for the threads.
@@ -51,6 +214,11 @@ void CpuLangevinDynamics::updatePart1(int numberOfAtoms, vector<Vec3>& atomCoord
     
     threads.execute([&] (ThreadPool& threads, int threadIndex) { threadUpdate1(threadIndex); });
     threads.waitForThreads();
+
+    // Have the background thread start generating the values for the next step, so the
+    // cost overlaps with the force evaluation.
+
+    random.refillGaussianPool();
 }
 
 void CpuLangevinDynamics::updatePart2(int numberOfAtoms, vector<Vec3>& atomCoordinates, vector<Vec3>& velocities,
@@ -86,6 +254,20 @@ void CpuLangevinDynamics::updatePart3(int numberOfAtoms, vector<Vec3>& atomCoord
     threads.waitForThreads();
 }
 
+Vec3 CpuLangevinDynamics::nextNoise(int atom, const float*& gaussian) {
+    // A NULL pointer means the counter based generator is selected, so compute the values
+    // for this atom directly instead of reading them from the pool.
+
+    if (gaussian == NULL) {
+        float values[3];
+        random.getCounterBasedGaussians(getTimeStep(), atom, values);
+        return Vec3(values[0], values[1], values[2]);
+    }
+    Vec3 noise(gaussian[0], gaussian[1], gaussian[2]);
+    gaussian += 3;
+    return noise;
+}
+
 void CpuLangevinDynamics::threadUpdate1(int threadIndex) {
     double dt = getDeltaT();
     double friction = getFriction();
@@ -95,11 +277,12 @@ void CpuLangevinDynamics::threadUpdate1(int threadIndex) {
     const double noisescale = sqrt(kT*(1-vscale*vscale));
     int start = threadIndex*numberOfAtoms/threads.getNumThreads();
     int end = (threadIndex+1)*numberOfAtoms/threads.getNumThreads();
+    const float* gaussian = (random.getUseCounterBased() ? NULL : random.acquireGaussianPool(threadIndex));
 
     for (int i = start; i < end; i++) {
         if (inverseMasses[i] != 0.0) {
             double sqrtInvMass = sqrt(inverseMasses[i]);
-            Vec3 noise(random.getGaussianRandom(threadIndex), random.getGaussianRandom(threadIndex), random.getGaussianRandom(threadIndex));
+            Vec3 noise = nextNoise(i, gaussian);
             velocities[i]  = velocities[i]*vscale + forces[i]*(fscale*inverseMasses[i]) + noise*(noisescale*sqrtInvMass);
         }
    }
@@ -0,0 +1,155 @@
+
+/* Portions copyright (c) 2017 Stanford University and Simbios.
+ * Authors: Peter Eastman
+ * Contributors:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "SimTKOpenMMUtilities.h"
+#include "CpuLangevinMiddleDynamics.h"
+
+using namespace OpenMM;
+using namespace std;
+
+CpuLangevinMiddleDynamics::CpuLangevinMiddleDynamics(int numberOfAtoms, double deltaT, double friction, double temperature, ThreadPool& threads, CpuRandom& random) :
+           ReferenceLangevinMiddleDynamics(numberOfAtoms, deltaT, friction, temperature), threads(threads), random(random) {
+    // Each thread consumes three Gaussian values per atom in its slice.  Have the
+    // generator fill a pool of them in the background so each step can just read them.
+    // The counter based generator computes values on the fly instead, so they do not
+    // depend on how atoms are divided among threads.
+
+    if (!random.getUseCounterBased()) {
+        int maxAtomsPerThread = (numberOfAtoms+threads.getNumThreads()-1)/threads.getNumThreads();
+        random.createGaussianPool(3*maxAtomsPerThread);
+    }
+}
+
+CpuLangevinMiddleDynamics::~CpuLangevinMiddleDynamics() {
+}
+
+void CpuLangevinMiddleDynamics::updatePart1(int numberOfAtoms, vector<Vec3>& velocities,
+                                            vector<Vec3>& forces, vector<double>& inverseMasses) {
+    // Record the parameters for the threads.
+
+    this->numberOfAtoms = numberOfAtoms;
+    this->velocities = &velocities[0];
+    this->forces = &forces[0];
+    this->inverseMasses = &inverseMasses[0];
+
+    // Signal the threads to start running and wait for them to finish.
+
+    threads.execute([&] (ThreadPool& threads, int threadIndex) { threadUpdate1(threadIndex); });
+    threads.waitForThreads();
+}
+
+void CpuLangevinMiddleDynamics::updatePart2(int numberOfAtoms, vector<Vec3>& atomCoordinates, vector<Vec3>& velocities,
+                                            vector<double>& inverseMasses, vector<Vec3>& xPrime) {
+    // Record the parameters for the threads.
+
+    this->numberOfAtoms = numberOfAtoms;
+    this->atomCoordinates = &atomCoordinates[0];
+    this->velocities = &velocities[0];
+    this->inverseMasses = &inverseMasses[0];
+    this->xPrime = &xPrime[0];
+
+    // Signal the threads to start running and wait for them to finish.
+
+    threads.execute([&] (ThreadPool& threads, int threadIndex) { threadUpdate2(threadIndex); });
+    threads.waitForThreads();
+
+    // Have the background thread start generating the values for the next step, so the
+    // cost overlaps with the force evaluation.
+
+    random.refillGaussianPool();
+}
+
+void CpuLangevinMiddleDynamics::updatePart3(int numberOfAtoms, vector<Vec3>& atomCoordinates, vector<Vec3>& velocities,
+                                            vector<double>& inverseMasses, vector<Vec3>& xPrime) {
+    // Record the parameters for the threads.
+
+    this->numberOfAtoms = numberOfAtoms;
+    this->atomCoordinates = &atomCoordinates[0];
+    this->velocities = &velocities[0];
+    this->inverseMasses = &inverseMasses[0];
+    this->xPrime = &xPrime[0];
+
+    // Signal the threads to start running and wait for them to finish.
+
+    threads.execute([&] (ThreadPool& threads, int threadIndex) { threadUpdate3(threadIndex); });
+    threads.waitForThreads();
+}
+
+void CpuLangevinMiddleDynamics::threadUpdate1(int threadIndex) {
+    const double dt = getDeltaT();
+    int start = threadIndex*numberOfAtoms/threads.getNumThreads();
+    int end = (threadIndex+1)*numberOfAtoms/threads.getNumThreads();
+
+    for (int i = start; i < end; i++)
+        if (inverseMasses[i] != 0.0)
+            velocities[i] += forces[i]*(dt*inverseMasses[i]);
+}
+
+void CpuLangevinMiddleDynamics::threadUpdate2(int threadIndex) {
+    const double halfdt = 0.5*getDeltaT();
+    const double kT = BOLTZ*getTemperature();
+    const double vscale = exp(-getDeltaT()*getFriction());
+    const double noisescale = sqrt(1-vscale*vscale);
+    int start = threadIndex*numberOfAtoms/threads.getNumThreads();
+    int end = (threadIndex+1)*numberOfAtoms/threads.getNumThreads();
+    const float* gaussian = (random.getUseCounterBased() ? NULL : random.acquireGaussianPool(threadIndex));
+
+    for (int i = start; i < end; i++) {
+        if (inverseMasses[i] != 0.0) {
+            xPrime[i] = atomCoordinates[i]+velocities[i]*halfdt;
+            double sigma = noisescale*sqrt(kT*inverseMasses[i]);
+            Vec3 noise = nextNoise(i, gaussian);
+            velocities[i] = velocities[i]*vscale + noise*sigma;
+            xPrime[i] += velocities[i]*halfdt;
+            oldx[i] = xPrime[i];
+        }
+    }
+}
+
+Vec3 CpuLangevinMiddleDynamics::nextNoise(int atom, const float*& gaussian) {
+    // A NULL pointer means the counter based generator is selected, so compute the values
+    // for this atom directly instead of reading them from the pool.
+
+    if (gaussian == NULL) {
+        float values[3];
+        random.getCounterBasedGaussians(getTimeStep(), atom, values);
+        return Vec3(values[0], values[1], values[2]);
+    }
+    Vec3 noise(gaussian[0], gaussian[1], gaussian[2]);
+    gaussian += 3;
+    return noise;
+}
+
+void CpuLangevinMiddleDynamics::threadUpdate3(int threadIndex) {
+    const double invStepSize = 1.0/getDeltaT();
+    int start = threadIndex*numberOfAtoms/threads.getNumThreads();
+    int end = (threadIndex+1)*numberOfAtoms/threads.getNumThreads();
+
+    for (int i = start; i < end; ++i)
+        if (inverseMasses[i] != 0.0) {
+            velocities[i] += (xPrime[i]-oldx[i])*invStepSize;
+            atomCoordinates[i] = xPrime[i];
+        }
+}
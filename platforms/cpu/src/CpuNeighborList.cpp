@@ -32,7 +32,6 @@
 #include "CpuNeighborList.h"
 #include "openmm/internal/hardware.h"
 #include "openmm/internal/vectorize.h"
-#include "hilbert.h"
 #include <algorithm>
 #include <set>
 #include <map>
@@ -96,22 +95,35 @@ public:
     }
 
     /**
-     * Insert a particle into the voxel data structure.
+     * Get the total number of voxels.  Voxel (y,z) has the flattened index y*nz+z.
      */
-    void insert(const int& atom, const float* location) {
+    int getNumBins() const {
+        return ny*nz;
+    }
+
+    /**
+     * Get the flattened index of the voxel containing a particular location.
+     */
+    int getBinIndex(const float* location) const {
         VoxelIndex voxelIndex = getVoxelIndex(location);
-        bins[voxelIndex.y][voxelIndex.z].push_back(make_pair(location[0], atom));
+        return voxelIndex.y*nz+voxelIndex.z;
     }
-    
+
     /**
-     * Sort the particles in each voxel by x coordinate.
+     * Append a set of particles to the end of a voxel.
      */
-    void sortItems() {
-        for (int i = 0; i < ny; i++)
-            for (int j = 0; j < nz; j++)
-                sort(bins[i][j].begin(), bins[i][j].end());
+    void appendItems(int bin, const vector<pair<float, int> >& items) {
+        vector<pair<float, int> >& binContents = bins[bin/nz][bin%nz];
+        binContents.insert(binContents.end(), items.begin(), items.end());
     }
-    
+
+    /**
+     * Sort the particles in a voxel by x coordinate.
+     */
+    void sortBin(int bin) {
+        sort(bins[bin/nz][bin%nz].begin(), bins[bin/nz][bin%nz].end());
+    }
+
     /**
      * Find the index of the first particle in voxel (y,z) whose x coordinate is >= the specified value.
      */
@@ -164,7 +176,7 @@ public:
         return VoxelIndex(y, z);
     }
         
-    void getNeighbors(vector<int>& neighbors, int blockIndex, const fvec4& blockCenter, const fvec4& blockWidth, const vector<int>& sortedAtoms, vector<char>& exclusions, float maxDistance, const vector<int>& blockAtoms, const vector<float>& blockAtomX, const vector<float>& blockAtomY, const vector<float>& blockAtomZ, const vector<float>& sortedPositions, const vector<VoxelIndex>& atomVoxelIndex) const {
+    void getNeighbors(vector<int>& neighbors, int blockIndex, const fvec4& blockCenter, const fvec4& blockWidth, const vector<int>& sortedAtoms, vector<int>& exclusions, float maxDistance, const vector<int>& blockAtoms, const vector<float>& blockAtomX, const vector<float>& blockAtomY, const vector<float>& blockAtomZ, const vector<float>& sortedPositions, const vector<VoxelIndex>& atomVoxelIndex) const {
         neighbors.resize(0);
         exclusions.resize(0);
         fvec4 boxSize(periodicBoxSize[0], periodicBoxSize[1], periodicBoxSize[2], 0);
@@ -409,14 +421,42 @@ private:
     vector<vector<vector<pair<float, int> > > > bins;
 };
 
-CpuNeighborList::CpuNeighborList(int blockSize) : blockSize(blockSize) {
+CpuNeighborList::CpuNeighborList(int blockSize) : blockSize(blockSize), lastMaxDistance(0.0f), lastNumAtoms(0), lastUsePeriodic(false) {
 }
 
 void CpuNeighborList::computeNeighborList(int numAtoms, const AlignedArray<float>& atomLocations, const vector<set<int> >& exclusions,
-            const Vec3* periodicBoxVectors, bool usePeriodic, float maxDistance, ThreadPool& threads) {
+            const Vec3* periodicBoxVectors, bool usePeriodic, float maxDistance, ThreadPool& threads, float skin) {
+    if (skin > 0 && numAtoms == lastNumAtoms && maxDistance == lastMaxDistance && usePeriodic == lastUsePeriodic &&
+            periodicBoxVectors[0] == lastBoxVectors[0] && periodicBoxVectors[1] == lastBoxVectors[1] && periodicBoxVectors[2] == lastBoxVectors[2]) {
+        // The list was built to include everything within maxDistance+skin, so it is still valid
+        // as long as no atom has moved more than half the skin distance since it was built.
+
+        float limit2 = 0.25f*skin*skin;
+        bool valid = true;
+        for (int i = 0; i < numAtoms && valid; i++) {
+            fvec4 delta = fvec4(&atomLocations[4*i])-fvec4(&lastPositions[4*i]);
+            if (dot3(delta, delta) > limit2)
+                valid = false;
+        }
+        if (valid)
+            return;
+    }
+
+    // Record the positions and parameters the list is being built for.
+
+    lastNumAtoms = numAtoms;
+    lastMaxDistance = maxDistance;
+    lastUsePeriodic = usePeriodic;
+    for (int i = 0; i < 3; i++)
+        lastBoxVectors[i] = periodicBoxVectors[i];
+    lastPositions.resize(4*numAtoms);
+    for (int i = 0; i < 4*numAtoms; i++)
+        lastPositions[i] = atomLocations[i];
+    maxDistance += skin;
     int numBlocks = (numAtoms+blockSize-1)/blockSize;
     blockNeighbors.resize(numBlocks);
     blockExclusions.resize(numBlocks);
+    blockNeighborPositions.resize(numBlocks);
     sortedAtoms.resize(numAtoms);
     sortedPositions.resize(4*numAtoms);
     
@@ -448,13 +488,14 @@ void CpuNeighborList::computeNeighborList(int numAtoms, const AlignedArray<float
     maxz = maxPos[2];
     
     // Sort the atoms based on a Hilbert curve.
-    
+
     atomBins.resize(numAtoms);
     threads.execute([&] (ThreadPool& threads, int threadIndex) { threadComputeNeighborList(threads, threadIndex); });
     threads.waitForThreads();
     sort(atomBins.begin(), atomBins.end());
 
-    // Build the voxel hash.
+    // Build the voxel hash.  Each thread bins its own subset of the atoms, then the
+    // per-thread bins are merged and sorted with each thread handling a subset of voxels.
 
     float edgeSizeY, edgeSizeZ;
     if (!usePeriodic)
@@ -464,30 +505,27 @@ void CpuNeighborList::computeNeighborList(int numAtoms, const AlignedArray<float
         edgeSizeZ = 0.6f*periodicBoxVectors[2][2]/floorf(periodicBoxVectors[2][2]/maxDistance);
     }
     Voxels voxels(blockSize, edgeSizeY, edgeSizeZ, miny, maxy, minz, maxz, periodicBoxVectors, usePeriodic);
-    for (int i = 0; i < numAtoms; i++) {
-        int atomIndex = atomBins[i].second;
-        sortedAtoms[i] = atomIndex;
-        fvec4 atomPos(&atomLocations[4*atomIndex]);
-        atomPos.store(&sortedPositions[4*i]);
-        voxels.insert(i, &atomLocations[4*atomIndex]);
-    }
-    voxels.sortItems();
     this->voxels = &voxels;
+    threadBins.resize(threads.getNumThreads());
+    threads.resumeThreads();
+    threads.waitForThreads();
+    threads.resumeThreads();
+    threads.waitForThreads();
+
+    // Signal the threads to start computing the block neighbor lists and wait for them to finish.
 
-    // Signal the threads to start running and wait for them to finish.
-    
     gmx_atomic_set(&atomicCounter, 0);
     threads.resumeThreads();
     threads.waitForThreads();
-    
+
     // Add padding atoms to fill up the last block.
     
     int numPadding = numBlocks*blockSize-numAtoms;
     if (numPadding > 0) {
-        char mask = ((0xFFFF-(1<<blockSize)+1) >> numPadding);
+        int mask = (((1<<blockSize)-1) & ~(((1<<blockSize)-1) >> numPadding));
         for (int i = 0; i < numPadding; i++)
             sortedAtoms.push_back(0);
-        vector<char>& exc = blockExclusions[blockExclusions.size()-1];
+        vector<int>& exc = blockExclusions[blockExclusions.size()-1];
         for (int i = 0; i < (int) exc.size(); i++)
             exc[i] |= mask;
     }
@@ -509,28 +547,95 @@ const std::vector<int>& CpuNeighborList::getBlockNeighbors(int blockIndex) const
     return blockNeighbors[blockIndex];
 }
 
-const std::vector<char>& CpuNeighborList::getBlockExclusions(int blockIndex) const {
+const std::vector<int>& CpuNeighborList::getBlockExclusions(int blockIndex) const {
     return blockExclusions[blockIndex];
-    
+
+}
+
+void CpuNeighborList::updateNeighborPositions(const float* posq, ThreadPool& threads) {
+    packedPosq = posq;
+    threads.execute([&] (ThreadPool& threads, int threadIndex) { threadUpdateNeighborPositions(threads, threadIndex); });
+    threads.waitForThreads();
+}
+
+const std::vector<float>& CpuNeighborList::getNeighborPositions(int blockIndex) const {
+    return blockNeighborPositions[blockIndex];
+}
+
+void CpuNeighborList::threadUpdateNeighborPositions(ThreadPool& threads, int threadIndex) {
+    // Gather the positions of every block's neighbors into a packed buffer.  The scattered
+    // reads all happen here, in a loop with no other work to block them, and the inner loops
+    // over neighbors can then read positions sequentially.
+
+    int numBlocks = blockNeighbors.size();
+    int numThreads = threads.getNumThreads();
+    int start = threadIndex*numBlocks/numThreads;
+    int end = (threadIndex+1)*numBlocks/numThreads;
+    for (int i = start; i < end; i++) {
+        const vector<int>& neighbors = blockNeighbors[i];
+        vector<float>& positions = blockNeighborPositions[i];
+        positions.resize(4*neighbors.size());
+        for (int j = 0; j < (int) neighbors.size(); j++)
+            fvec4(packedPosq+4*neighbors[j]).store(&positions[4*j]);
+    }
+}
+
+// Spread out the low eight bits of a value so the coordinates along the three axes can be
+// interleaved into a Morton index.  Sorting by Morton index gives nearly the same locality
+// as a Hilbert curve at a small fraction of the cost of computing the indices.
+
+static int spreadBits(int x) {
+    x = (x | (x<<16)) & 0x030000FF;
+    x = (x | (x<<8)) & 0x0300F00F;
+    x = (x | (x<<4)) & 0x030C30C3;
+    x = (x | (x<<2)) & 0x09249249;
+    return x;
 }
 
 void CpuNeighborList::threadComputeNeighborList(ThreadPool& threads, int threadIndex) {
-    // Compute the positions of atoms along the Hilbert curve.
+    // Compute the positions of atoms along a Morton curve.
 
     float binWidth = max(max(maxx-minx, maxy-miny), maxz-minz)/255.0f;
     float invBinWidth = 1.0f/binWidth;
-    bitmask_t coords[3];
     int numThreads = threads.getNumThreads();
     for (int i = threadIndex; i < numAtoms; i += numThreads) {
         const float* pos = &atomLocations[4*i];
-        coords[0] = (bitmask_t) ((pos[0]-minx)*invBinWidth);
-        coords[1] = (bitmask_t) ((pos[1]-miny)*invBinWidth);
-        coords[2] = (bitmask_t) ((pos[2]-minz)*invBinWidth);
-        int bin = (int) hilbert_c2i(3, 8, coords);
+        int x = (int) ((pos[0]-minx)*invBinWidth);
+        int y = (int) ((pos[1]-miny)*invBinWidth);
+        int z = (int) ((pos[2]-minz)*invBinWidth);
+        int bin = (spreadBits(z)<<2) | (spreadBits(y)<<1) | spreadBits(x);
         atomBins[i] = pair<int, int>(bin, i);
     }
     threads.syncThreads();
 
+    // Record the sorted positions and insert this thread's subset of atoms into its own bins.
+
+    int numBins = voxels->getNumBins();
+    vector<vector<pair<float, int> > >& myBins = threadBins[threadIndex];
+    myBins.resize(numBins);
+    for (int i = 0; i < numBins; i++)
+        myBins[i].resize(0);
+    int start = threadIndex*numAtoms/numThreads;
+    int end = (threadIndex+1)*numAtoms/numThreads;
+    for (int i = start; i < end; i++) {
+        int atomIndex = atomBins[i].second;
+        sortedAtoms[i] = atomIndex;
+        fvec4 atomPos(&atomLocations[4*atomIndex]);
+        atomPos.store(&sortedPositions[4*i]);
+        myBins[voxels->getBinIndex(&atomLocations[4*atomIndex])].push_back(make_pair(atomLocations[4*atomIndex], i));
+    }
+    threads.syncThreads();
+
+    // Merge the per-thread bins into the voxel hash and sort each voxel by x coordinate.
+    // Sorting makes the result independent of which thread binned each atom.
+
+    for (int bin = threadIndex; bin < numBins; bin += numThreads) {
+        for (int i = 0; i < numThreads; i++)
+            voxels->appendItems(bin, threadBins[i][bin]);
+        voxels->sortBin(bin);
+    }
+    threads.syncThreads();
+
     // Compute this thread's subset of neighbors.
 
     int numBlocks = blockNeighbors.size();
@@ -573,12 +678,12 @@ void CpuNeighborList::threadComputeNeighborList(ThreadPool& threads, int threadI
 
         // Record the exclusions for this block.
 
-        map<int, char> atomFlags;
+        map<int, int> atomFlags;
         for (int j = 0; j < atomsInBlock; j++) {
             const set<int>& atomExclusions = (*exclusions)[sortedAtoms[firstIndex+j]];
-            char mask = 1<<j;
+            int mask = 1<<j;
             for (int exclusion : atomExclusions) {
-                map<int, char>::iterator thisAtomFlags = atomFlags.find(exclusion);
+                map<int, int>::iterator thisAtomFlags = atomFlags.find(exclusion);
                 if (thisAtomFlags == atomFlags.end())
                     atomFlags[exclusion] = mask;
                 else
@@ -588,7 +693,7 @@ void CpuNeighborList::threadComputeNeighborList(ThreadPool& threads, int threadI
         int numNeighbors = blockNeighbors[i].size();
         for (int k = 0; k < numNeighbors; k++) {
             int atomIndex = blockNeighbors[i][k];
-            map<int, char>::iterator thisAtomFlags = atomFlags.find(atomIndex);
+            map<int, int>::iterator thisAtomFlags = atomFlags.find(atomIndex);
             if (thisAtomFlags != atomFlags.end())
                 blockExclusions[i][k] |= thisAtomFlags->second;
         }
@@ -40,6 +40,10 @@ using namespace std;
 using namespace OpenMM;
 
 const float CpuNonbondedForce::TWO_OVER_SQRT_PI = (float) (2/sqrt(PI_M));
+
+// The number of points in the tabulated functions spanning the cutoff distance.  With 2048
+// points, the error from linearly interpolating erfc() is orders of magnitude smaller than
+// the error tolerance used to select the Ewald parameters.
 const int CpuNonbondedForce::NUM_TABLE_POINTS = 2048;
 
 /**---------------------------------------------------------------------------------------
@@ -65,7 +69,7 @@ CpuNonbondedForce::~CpuNonbondedForce() {
 
      --------------------------------------------------------------------------------------- */
 
-void CpuNonbondedForce::setUseCutoff(float distance, const CpuNeighborList& neighbors, float solventDielectric) {
+void CpuNonbondedForce::setUseCutoff(float distance, CpuNeighborList& neighbors, float solventDielectric) {
     if (distance != cutoffDistance)
         tableIsValid = false;
     cutoff = true;
@@ -392,9 +396,15 @@ void CpuNonbondedForce::calculateDirectIxn(int numberOfAtoms, float* posq, const
     gmx_atomic_t counter;
     gmx_atomic_set(&counter, 0);
     this->atomicCounter = &counter;
-    
+
+    // Pack the neighbor positions into contiguous per-block buffers for the block
+    // interaction loops to read.
+
+    if (cutoff)
+        neighborList->updateNeighborPositions(posq, threads);
+
     // Signal the threads to start running and wait for them to finish.
-    
+
     threads.execute([&] (ThreadPool& threads, int threadIndex) { threadComputeDirect(threads, threadIndex); });
     threads.waitForThreads();
     
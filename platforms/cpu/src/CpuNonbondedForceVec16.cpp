@@ -0,0 +1,511 @@
+
+/* Portions copyright (c) 2006-2018 Stanford University and Simbios.
+ * Contributors: Pande Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "SimTKOpenMMUtilities.h"
+#include "CpuNonbondedForceVec16.h"
+#include "openmm/OpenMMException.h"
+#include "openmm/internal/hardware.h"
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+using namespace OpenMM;
+
+#ifndef __AVX512F__
+bool isVec16Supported() {
+    return false;
+}
+
+CpuNonbondedForce* createCpuNonbondedForceVec16() {
+    throw OpenMMException("Internal error: OpenMM was compiled without AVX-512 support");
+}
+#else
+/**
+ * Query the extended control register to find which register states the OS saves on context switches.
+ */
+static unsigned long long getEnabledXSaveFeatures() {
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ __volatile__ (".byte 0x0f, 0x01, 0xd0" : "=a" (eax), "=d" (edx) : "c" (0));
+    return eax | ((unsigned long long) edx << 32);
+#endif
+}
+
+/**
+ * Check whether 16 component vectors are supported with the current CPU.
+ */
+bool isVec16Supported() {
+    // Make sure the CPU supports AVX-512F and the OS preserves the ZMM and opmask registers.
+
+    int cpuInfo[4];
+    cpuid(cpuInfo, 0);
+    if (cpuInfo[0] >= 7) {
+        cpuid(cpuInfo, 1);
+        bool osUsesXSave = ((cpuInfo[2] & ((int) 1 << 27)) != 0);
+        if (!osUsesXSave || (getEnabledXSaveFeatures() & 0xE6) != 0xE6)
+            return false;
+        cpuidex(cpuInfo, 7, 0);
+        return ((cpuInfo[1] & ((int) 1 << 16)) != 0);
+    }
+    return false;
+}
+
+/**
+ * Factory method to create a CpuNonbondedForceVec16.
+ */
+CpuNonbondedForce* createCpuNonbondedForceVec16() {
+    return new CpuNonbondedForceVec16();
+}
+
+/**---------------------------------------------------------------------------------------
+
+   CpuNonbondedForceVec16 constructor
+
+   --------------------------------------------------------------------------------------- */
+
+CpuNonbondedForceVec16::CpuNonbondedForceVec16() {
+}
+
+enum PeriodicType {NoPeriodic, PeriodicPerAtom, PeriodicPerInteraction, PeriodicTriclinic, PeriodicTriclinicPerAtom};
+
+void CpuNonbondedForceVec16::calculateBlockIxn(int blockIndex, float* forces, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize) {
+    // Determine whether we need to apply periodic boundary conditions.
+
+    PeriodicType periodicType;
+    fvec4 blockCenter;
+    if (!periodic) {
+        periodicType = NoPeriodic;
+        blockCenter = 0.0f;
+    }
+    else {
+        const int* blockAtom = &neighborList->getSortedAtoms()[16*blockIndex];
+        float minx, maxx, miny, maxy, minz, maxz;
+        minx = maxx = posq[4*blockAtom[0]];
+        miny = maxy = posq[4*blockAtom[0]+1];
+        minz = maxz = posq[4*blockAtom[0]+2];
+        for (int i = 1; i < 16; i++) {
+            minx = min(minx, posq[4*blockAtom[i]]);
+            maxx = max(maxx, posq[4*blockAtom[i]]);
+            miny = min(miny, posq[4*blockAtom[i]+1]);
+            maxy = max(maxy, posq[4*blockAtom[i]+1]);
+            minz = min(minz, posq[4*blockAtom[i]+2]);
+            maxz = max(maxz, posq[4*blockAtom[i]+2]);
+        }
+        blockCenter = fvec4(0.5f*(minx+maxx), 0.5f*(miny+maxy), 0.5f*(minz+maxz), 0.0f);
+        if (!(minx < cutoffDistance || miny < cutoffDistance || minz < cutoffDistance ||
+                maxx > boxSize[0]-cutoffDistance || maxy > boxSize[1]-cutoffDistance || maxz > boxSize[2]-cutoffDistance))
+            periodicType = NoPeriodic;
+        else if (0.5f*(boxSize[0]-(maxx-minx)) >= cutoffDistance &&
+                 0.5f*(boxSize[1]-(maxy-miny)) >= cutoffDistance &&
+                 0.5f*(boxSize[2]-(maxz-minz)) >= cutoffDistance)
+            periodicType = (triclinic ? PeriodicTriclinicPerAtom : PeriodicPerAtom);
+        else
+            periodicType = (triclinic ? PeriodicTriclinic : PeriodicPerInteraction);
+    }
+
+    // Call the appropriate version depending on what calculation is required for periodic boundary conditions.
+
+    if (periodicType == NoPeriodic)
+        calculateBlockIxnImpl<NoPeriodic>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
+    else if (periodicType == PeriodicPerAtom)
+        calculateBlockIxnImpl<PeriodicPerAtom>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
+    else if (periodicType == PeriodicPerInteraction)
+        calculateBlockIxnImpl<PeriodicPerInteraction>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
+    else if (periodicType == PeriodicTriclinic)
+        calculateBlockIxnImpl<PeriodicTriclinic>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
+    else if (periodicType == PeriodicTriclinicPerAtom)
+        calculateBlockIxnImpl<PeriodicTriclinicPerAtom>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
+}
+
+template <int PERIODIC_TYPE>
+void CpuNonbondedForceVec16::calculateBlockIxnImpl(int blockIndex, float* forces, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize, const fvec4& blockCenter) {
+    // Load the positions and parameters of the atoms in the block.
+
+    const int* blockAtom = &neighborList->getSortedAtoms()[16*blockIndex];
+    fvec4 blockAtomPosq[16];
+    fvec16 blockAtomForceX(0.0f), blockAtomForceY(0.0f), blockAtomForceZ(0.0f);
+    fvec16 blockAtomX, blockAtomY, blockAtomZ, blockAtomCharge;
+    for (int i = 0; i < 16; i++) {
+        blockAtomPosq[i] = fvec4(posq+4*blockAtom[i]);
+        if (PERIODIC_TYPE == PeriodicPerAtom)
+            blockAtomPosq[i] -= floor((blockAtomPosq[i]-blockCenter)*invBoxSize+0.5f)*boxSize;
+        else if (PERIODIC_TYPE == PeriodicTriclinicPerAtom)
+            applyPeriodicToPos(blockAtomPosq[i], blockCenter);
+    }
+    transpose(blockAtomPosq, blockAtomX, blockAtomY, blockAtomZ, blockAtomCharge);
+    blockAtomCharge *= ONE_4PI_EPS0;
+    fvec16 blockAtomSigma, blockAtomEpsilon;
+    loadBlockParameters(blockAtom, blockAtomSigma, blockAtomEpsilon);
+    const bool needPeriodic = (PERIODIC_TYPE == PeriodicPerInteraction || PERIODIC_TYPE == PeriodicTriclinic);
+    const float invSwitchingInterval = 1/(cutoffDistance-switchingDistance);
+
+    // Loop over neighbors for this block.
+
+    const vector<int>& neighbors = neighborList->getBlockNeighbors(blockIndex);
+    const vector<int>& exclusions = neighborList->getBlockExclusions(blockIndex);
+    const vector<float>& neighborPos = neighborList->getNeighborPositions(blockIndex);
+    for (int i = 0; i < (int) neighbors.size(); i++) {
+        // Load the next neighbor.
+
+        int atom = neighbors[i];
+
+        // Compute the distances to the block atoms.
+
+        fvec16 dx, dy, dz, r2;
+        fvec4 atomPos(&neighborPos[4*i]);
+        if (PERIODIC_TYPE == PeriodicPerAtom)
+            atomPos -= floor((atomPos-blockCenter)*invBoxSize+0.5f)*boxSize;
+        else if (PERIODIC_TYPE == PeriodicTriclinicPerAtom)
+            applyPeriodicToPos(atomPos, blockCenter);
+        getDeltaR<PERIODIC_TYPE>(atomPos, blockAtomX, blockAtomY, blockAtomZ, dx, dy, dz, r2, needPeriodic, boxSize, invBoxSize);
+        __mmask16 include = (__mmask16) ~exclusions[i];
+        include &= (r2 < cutoffDistance*cutoffDistance);
+        if (!any(include))
+            continue; // No interactions to compute.
+
+        // Compute the interactions.
+
+        fvec16 inverseR = rsqrt(r2);
+        fvec16 energy, dEdR;
+        float atomEpsilon = atomParameters[atom].second;
+        if (atomEpsilon != 0.0f) {
+            fvec16 sig = blockAtomSigma+atomParameters[atom].first;
+            fvec16 sig2 = inverseR*sig;
+            sig2 *= sig2;
+            fvec16 sig6 = sig2*sig2*sig2;
+            fvec16 epsSig6 = blockAtomEpsilon*atomEpsilon*sig6;
+            dEdR = epsSig6*(12.0f*sig6 - 6.0f);
+            energy = epsSig6*(sig6-1.0f);
+            if (useSwitch) {
+                fvec16 r = r2*inverseR;
+                fvec16 t = blend(0.0f, (r-switchingDistance)*invSwitchingInterval, r>switchingDistance);
+                fvec16 switchValue = 1+t*t*t*(-10.0f+t*(15.0f-t*6.0f));
+                fvec16 switchDeriv = t*t*(-30.0f+t*(60.0f-t*30.0f))*invSwitchingInterval;
+                dEdR = switchValue*dEdR - energy*switchDeriv*r;
+                energy *= switchValue;
+            }
+        }
+        else {
+            energy = 0.0f;
+            dEdR = 0.0f;
+        }
+        fvec16 chargeProd = blockAtomCharge*neighborPos[4*i+3];
+        if (cutoff)
+            dEdR += chargeProd*(inverseR-2.0f*krf*r2);
+        else
+            dEdR += chargeProd*inverseR;
+        dEdR *= inverseR*inverseR;
+
+        // Accumulate energies.
+
+        fvec16 one(1.0f);
+        if (totalEnergy) {
+            if (cutoff)
+                energy += chargeProd*(inverseR+krf*r2-crf);
+            else
+                energy += chargeProd*inverseR;
+            energy = blend(0.0f, energy, include);
+            *totalEnergy += dot16(energy, one);
+        }
+
+        // Accumulate forces.
+
+        dEdR = blend(0.0f, dEdR, include);
+        fvec16 fx = dx*dEdR;
+        fvec16 fy = dy*dEdR;
+        fvec16 fz = dz*dEdR;
+        blockAtomForceX += fx;
+        blockAtomForceY += fy;
+        blockAtomForceZ += fz;
+        float* atomForce = forces+4*atom;
+        atomForce[0] -= dot16(fx, one);
+        atomForce[1] -= dot16(fy, one);
+        atomForce[2] -= dot16(fz, one);
+    }
+
+    // Record the forces on the block atoms.
+
+    fvec4 f[16];
+    transpose(blockAtomForceX, blockAtomForceY, blockAtomForceZ, fvec16(0.0f), f);
+    for (int j = 0; j < 16; j++)
+        (fvec4(forces+4*blockAtom[j])+f[j]).store(forces+4*blockAtom[j]);
+}
+
+void CpuNonbondedForceVec16::calculateBlockEwaldIxn(int blockIndex, float* forces, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize) {
+    // Determine whether we need to apply periodic boundary conditions.
+
+    PeriodicType periodicType;
+    fvec4 blockCenter;
+    if (!periodic) {
+        periodicType = NoPeriodic;
+        blockCenter = 0.0f;
+    }
+    else {
+        const int* blockAtom = &neighborList->getSortedAtoms()[16*blockIndex];
+        float minx, maxx, miny, maxy, minz, maxz;
+        minx = maxx = posq[4*blockAtom[0]];
+        miny = maxy = posq[4*blockAtom[0]+1];
+        minz = maxz = posq[4*blockAtom[0]+2];
+        for (int i = 1; i < 16; i++) {
+            minx = min(minx, posq[4*blockAtom[i]]);
+            maxx = max(maxx, posq[4*blockAtom[i]]);
+            miny = min(miny, posq[4*blockAtom[i]+1]);
+            maxy = max(maxy, posq[4*blockAtom[i]+1]);
+            minz = min(minz, posq[4*blockAtom[i]+2]);
+            maxz = max(maxz, posq[4*blockAtom[i]+2]);
+        }
+        blockCenter = fvec4(0.5f*(minx+maxx), 0.5f*(miny+maxy), 0.5f*(minz+maxz), 0.0f);
+        if (!(minx < cutoffDistance || miny < cutoffDistance || minz < cutoffDistance ||
+                maxx > boxSize[0]-cutoffDistance || maxy > boxSize[1]-cutoffDistance || maxz > boxSize[2]-cutoffDistance))
+            periodicType = NoPeriodic;
+        else if (0.5f*(boxSize[0]-(maxx-minx)) >= cutoffDistance &&
+                 0.5f*(boxSize[1]-(maxy-miny)) >= cutoffDistance &&
+                 0.5f*(boxSize[2]-(maxz-minz)) >= cutoffDistance)
+            periodicType = (triclinic ? PeriodicTriclinicPerAtom : PeriodicPerAtom);
+        else
+            periodicType = (triclinic ? PeriodicTriclinic : PeriodicPerInteraction);
+    }
+
+    // Call the appropriate version depending on what calculation is required for periodic boundary conditions.
+
+    if (periodicType == NoPeriodic)
+        calculateBlockEwaldIxnImpl<NoPeriodic>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
+    else if (periodicType == PeriodicPerAtom)
+        calculateBlockEwaldIxnImpl<PeriodicPerAtom>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
+    else if (periodicType == PeriodicPerInteraction)
+        calculateBlockEwaldIxnImpl<PeriodicPerInteraction>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
+    else if (periodicType == PeriodicTriclinic)
+        calculateBlockEwaldIxnImpl<PeriodicTriclinic>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
+    else if (periodicType == PeriodicTriclinicPerAtom)
+        calculateBlockEwaldIxnImpl<PeriodicTriclinicPerAtom>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
+}
+
+template <int PERIODIC_TYPE>
+void CpuNonbondedForceVec16::calculateBlockEwaldIxnImpl(int blockIndex, float* forces, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize, const fvec4& blockCenter) {
+    // Load the positions and parameters of the atoms in the block.
+
+    const int* blockAtom = &neighborList->getSortedAtoms()[16*blockIndex];
+    fvec4 blockAtomPosq[16];
+    fvec16 blockAtomForceX(0.0f), blockAtomForceY(0.0f), blockAtomForceZ(0.0f);
+    fvec16 blockAtomX, blockAtomY, blockAtomZ, blockAtomCharge;
+    for (int i = 0; i < 16; i++) {
+        blockAtomPosq[i] = fvec4(posq+4*blockAtom[i]);
+        if (PERIODIC_TYPE == PeriodicPerAtom)
+            blockAtomPosq[i] -= floor((blockAtomPosq[i]-blockCenter)*invBoxSize+0.5f)*boxSize;
+        else if (PERIODIC_TYPE == PeriodicTriclinicPerAtom)
+            applyPeriodicToPos(blockAtomPosq[i], blockCenter);
+    }
+    transpose(blockAtomPosq, blockAtomX, blockAtomY, blockAtomZ, blockAtomCharge);
+    blockAtomCharge *= ONE_4PI_EPS0;
+    fvec16 blockAtomSigma, blockAtomEpsilon;
+    loadBlockParameters(blockAtom, blockAtomSigma, blockAtomEpsilon);
+    fvec16 C6s(C6params[blockAtom[0]], C6params[blockAtom[1]], C6params[blockAtom[2]], C6params[blockAtom[3]],
+               C6params[blockAtom[4]], C6params[blockAtom[5]], C6params[blockAtom[6]], C6params[blockAtom[7]],
+               C6params[blockAtom[8]], C6params[blockAtom[9]], C6params[blockAtom[10]], C6params[blockAtom[11]],
+               C6params[blockAtom[12]], C6params[blockAtom[13]], C6params[blockAtom[14]], C6params[blockAtom[15]]);
+    const bool needPeriodic = (PERIODIC_TYPE == PeriodicPerInteraction || PERIODIC_TYPE == PeriodicTriclinic);
+    const float invSwitchingInterval = 1/(cutoffDistance-switchingDistance);
+
+    // Loop over neighbors for this block.
+
+    const vector<int>& neighbors = neighborList->getBlockNeighbors(blockIndex);
+    const vector<int>& exclusions = neighborList->getBlockExclusions(blockIndex);
+    const vector<float>& neighborPos = neighborList->getNeighborPositions(blockIndex);
+    for (int i = 0; i < (int) neighbors.size(); i++) {
+        // Load the next neighbor.
+
+        int atom = neighbors[i];
+
+        // Compute the distances to the block atoms.
+
+        fvec16 dx, dy, dz, r2;
+        fvec4 atomPos(&neighborPos[4*i]);
+        if (PERIODIC_TYPE == PeriodicPerAtom)
+            atomPos -= floor((atomPos-blockCenter)*invBoxSize+0.5f)*boxSize;
+        else if (PERIODIC_TYPE == PeriodicTriclinicPerAtom)
+            applyPeriodicToPos(atomPos, blockCenter);
+        getDeltaR<PERIODIC_TYPE>(atomPos, blockAtomX, blockAtomY, blockAtomZ, dx, dy, dz, r2, needPeriodic, boxSize, invBoxSize);
+        __mmask16 include = (__mmask16) ~exclusions[i];
+        include &= (r2 < cutoffDistance*cutoffDistance);
+        if (!any(include))
+            continue; // No interactions to compute.
+
+        // Compute the interactions.
+
+        fvec16 inverseR = rsqrt(r2);
+        fvec16 r = r2*inverseR;
+        fvec16 energy, dEdR;
+        float atomEpsilon = atomParameters[atom].second;
+        if (atomEpsilon != 0.0f) {
+            fvec16 sig = blockAtomSigma+atomParameters[atom].first;
+            fvec16 sig2 = inverseR*sig;
+            sig2 *= sig2;
+            fvec16 sig6 = sig2*sig2*sig2;
+            fvec16 eps = blockAtomEpsilon*atomEpsilon;
+            fvec16 epsSig6 = eps*sig6;
+            dEdR = epsSig6*(12.0f*sig6 - 6.0f);
+            energy = epsSig6*(sig6-1.0f);
+            if (useSwitch) {
+                fvec16 t = blend(0.0f, (r-switchingDistance)*invSwitchingInterval, r>switchingDistance);
+                fvec16 switchValue = 1+t*t*t*(-10.0f+t*(15.0f-t*6.0f));
+                fvec16 switchDeriv = t*t*(-30.0f+t*(60.0f-t*30.0f))*invSwitchingInterval;
+                dEdR = switchValue*dEdR - energy*switchDeriv*r;
+                energy *= switchValue;
+            }
+            if (ljpme) {
+                fvec16 C6ij = C6s*C6params[atom];
+                fvec16 inverseR2 = inverseR*inverseR;
+                fvec16 mysig2 = sig*sig;
+                fvec16 mysig6 = mysig2*mysig2*mysig2;
+                fvec16 emult = C6ij*inverseR2*inverseR2*inverseR2*exptermsApprox(r);
+                fvec16 potentialShift = eps*(1.0f-mysig6*inverseRcut6)*mysig6*inverseRcut6 - C6ij*inverseRcut6Expterm;
+                dEdR += 6.0f*C6ij*inverseR2*inverseR2*inverseR2*dExptermsApprox(r);
+                energy += emult + potentialShift;
+            }
+
+        }
+        else {
+            energy = 0.0f;
+            dEdR = 0.0f;
+        }
+        fvec16 chargeProd = blockAtomCharge*neighborPos[4*i+3];
+        dEdR += chargeProd*inverseR*ewaldScaleFunction(r);
+        dEdR *= inverseR*inverseR;
+
+        // Accumulate energies.
+
+        fvec16 one(1.0f);
+        if (totalEnergy) {
+            energy += chargeProd*inverseR*erfcApprox(alphaEwald*r);
+            energy = blend(0.0f, energy, include);
+            *totalEnergy += dot16(energy, one);
+        }
+
+        // Accumulate forces.
+
+        dEdR = blend(0.0f, dEdR, include);
+        fvec16 fx = dx*dEdR;
+        fvec16 fy = dy*dEdR;
+        fvec16 fz = dz*dEdR;
+        blockAtomForceX += fx;
+        blockAtomForceY += fy;
+        blockAtomForceZ += fz;
+        float* atomForce = forces+4*atom;
+        atomForce[0] -= dot16(fx, one);
+        atomForce[1] -= dot16(fy, one);
+        atomForce[2] -= dot16(fz, one);
+    }
+
+    // Record the forces on the block atoms.
+
+    fvec4 f[16];
+    transpose(blockAtomForceX, blockAtomForceY, blockAtomForceZ, fvec16(0.0f), f);
+    for (int j = 0; j < 16; j++)
+        (fvec4(forces+4*blockAtom[j])+f[j]).store(forces+4*blockAtom[j]);
+}
+
+template <int PERIODIC_TYPE>
+void CpuNonbondedForceVec16::getDeltaR(const fvec4& posI, const fvec16& x, const fvec16& y, const fvec16& z, fvec16& dx, fvec16& dy, fvec16& dz, fvec16& r2, bool periodic, const fvec4& boxSize, const fvec4& invBoxSize) const {
+    dx = x-posI[0];
+    dy = y-posI[1];
+    dz = z-posI[2];
+    if (PERIODIC_TYPE == PeriodicTriclinic) {
+        fvec16 scale3 = floor(dz*recipBoxSize[2]+0.5f);
+        dx -= scale3*periodicBoxVectors[2][0];
+        dy -= scale3*periodicBoxVectors[2][1];
+        dz -= scale3*periodicBoxVectors[2][2];
+        fvec16 scale2 = floor(dy*recipBoxSize[1]+0.5f);
+        dx -= scale2*periodicBoxVectors[1][0];
+        dy -= scale2*periodicBoxVectors[1][1];
+        fvec16 scale1 = floor(dx*recipBoxSize[0]+0.5f);
+        dx -= scale1*periodicBoxVectors[0][0];
+    }
+    else if (PERIODIC_TYPE == PeriodicPerInteraction) {
+        dx -= round(dx*invBoxSize[0])*boxSize[0];
+        dy -= round(dy*invBoxSize[1])*boxSize[1];
+        dz -= round(dz*invBoxSize[2])*boxSize[2];
+    }
+    r2 = dx*dx + dy*dy + dz*dz;
+}
+
+void CpuNonbondedForceVec16::loadBlockParameters(const int* blockAtom, fvec16& blockAtomSigma, fvec16& blockAtomEpsilon) const {
+    blockAtomSigma = fvec16(atomParameters[blockAtom[0]].first, atomParameters[blockAtom[1]].first, atomParameters[blockAtom[2]].first, atomParameters[blockAtom[3]].first,
+                            atomParameters[blockAtom[4]].first, atomParameters[blockAtom[5]].first, atomParameters[blockAtom[6]].first, atomParameters[blockAtom[7]].first,
+                            atomParameters[blockAtom[8]].first, atomParameters[blockAtom[9]].first, atomParameters[blockAtom[10]].first, atomParameters[blockAtom[11]].first,
+                            atomParameters[blockAtom[12]].first, atomParameters[blockAtom[13]].first, atomParameters[blockAtom[14]].first, atomParameters[blockAtom[15]].first);
+    blockAtomEpsilon = fvec16(atomParameters[blockAtom[0]].second, atomParameters[blockAtom[1]].second, atomParameters[blockAtom[2]].second, atomParameters[blockAtom[3]].second,
+                              atomParameters[blockAtom[4]].second, atomParameters[blockAtom[5]].second, atomParameters[blockAtom[6]].second, atomParameters[blockAtom[7]].second,
+                              atomParameters[blockAtom[8]].second, atomParameters[blockAtom[9]].second, atomParameters[blockAtom[10]].second, atomParameters[blockAtom[11]].second,
+                              atomParameters[blockAtom[12]].second, atomParameters[blockAtom[13]].second, atomParameters[blockAtom[14]].second, atomParameters[blockAtom[15]].second);
+}
+
+fvec16 CpuNonbondedForceVec16::erfcApprox(const fvec16& x) {
+    fvec16 x1 = x*erfcDXInv;
+    fvec16 floored = min(floor(x1), NUM_TABLE_POINTS);
+    ivec16 index = floored;
+    fvec16 coeff2 = x1-floored;
+    fvec16 coeff1 = 1.0f-coeff2;
+    fvec16 s1(_mm512_i32gather_ps(index, &erfcTable[0], 4));
+    fvec16 s2(_mm512_i32gather_ps(index+ivec16(1), &erfcTable[0], 4));
+    return coeff1*s1 + coeff2*s2;
+}
+
+fvec16 CpuNonbondedForceVec16::ewaldScaleFunction(const fvec16& x) {
+    // Compute the tabulated Ewald scale factor: erfc(alpha*r) + 2*alpha*r*exp(-alpha*alpha*r*r)/sqrt(PI)
+
+    fvec16 x1 = x*ewaldDXInv;
+    fvec16 floored = min(floor(x1), NUM_TABLE_POINTS);
+    ivec16 index = floored;
+    fvec16 coeff2 = x1-floored;
+    fvec16 coeff1 = 1.0f-coeff2;
+    fvec16 s1(_mm512_i32gather_ps(index, &ewaldScaleTable[0], 4));
+    fvec16 s2(_mm512_i32gather_ps(index+ivec16(1), &ewaldScaleTable[0], 4));
+    return coeff1*s1 + coeff2*s2;
+}
+
+fvec16 CpuNonbondedForceVec16::exptermsApprox(const fvec16& r) {
+    fvec16 r1 = r*exptermsDXInv;
+    fvec16 floored = min(floor(r1), NUM_TABLE_POINTS);
+    ivec16 index = floored;
+    fvec16 coeff2 = r1-floored;
+    fvec16 coeff1 = 1.0f-coeff2;
+    fvec16 s1(_mm512_i32gather_ps(index, &exptermsTable[0], 4));
+    fvec16 s2(_mm512_i32gather_ps(index+ivec16(1), &exptermsTable[0], 4));
+    return coeff1*s1 + coeff2*s2;
+}
+
+fvec16 CpuNonbondedForceVec16::dExptermsApprox(const fvec16& r) {
+    fvec16 r1 = r*exptermsDXInv;
+    fvec16 floored = min(floor(r1), NUM_TABLE_POINTS);
+    ivec16 index = floored;
+    fvec16 coeff2 = r1-floored;
+    fvec16 coeff1 = 1.0f-coeff2;
+    fvec16 s1(_mm512_i32gather_ps(index, &dExptermsTable[0], 4));
+    fvec16 s2(_mm512_i32gather_ps(index+ivec16(1), &dExptermsTable[0], 4));
+    return coeff1*s1 + coeff2*s2;
+}
+
+#endif
@@ -46,7 +46,7 @@ CpuNonbondedForce* createCpuNonbondedForceVec4() {
 CpuNonbondedForceVec4::CpuNonbondedForceVec4() {
 }
 
-enum PeriodicType {NoPeriodic, PeriodicPerAtom, PeriodicPerInteraction, PeriodicTriclinic};
+enum PeriodicType {NoPeriodic, PeriodicPerAtom, PeriodicPerInteraction, PeriodicTriclinic, PeriodicTriclinicPerAtom};
 
 void CpuNonbondedForceVec4::calculateBlockIxn(int blockIndex, float* forces, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize) {
     // Determine whether we need to apply periodic boundary conditions.
@@ -75,14 +75,12 @@ void CpuNonbondedForceVec4::calculateBlockIxn(int blockIndex, float* forces, dou
         if (!(minx < cutoffDistance || miny < cutoffDistance || minz < cutoffDistance ||
                 maxx > boxSize[0]-cutoffDistance || maxy > boxSize[1]-cutoffDistance || maxz > boxSize[2]-cutoffDistance))
             periodicType = NoPeriodic;
-        else if (triclinic)
-            periodicType = PeriodicTriclinic;
         else if (0.5f*(boxSize[0]-(maxx-minx)) >= cutoffDistance &&
                  0.5f*(boxSize[1]-(maxy-miny)) >= cutoffDistance &&
                  0.5f*(boxSize[2]-(maxz-minz)) >= cutoffDistance)
-            periodicType = PeriodicPerAtom;
+            periodicType = (triclinic ? PeriodicTriclinicPerAtom : PeriodicPerAtom);
         else
-            periodicType = PeriodicPerInteraction;
+            periodicType = (triclinic ? PeriodicTriclinic : PeriodicPerInteraction);
     }
     
     // Call the appropriate version depending on what calculation is required for periodic boundary conditions.
@@ -95,6 +93,8 @@ void CpuNonbondedForceVec4::calculateBlockIxn(int blockIndex, float* forces, dou
         calculateBlockIxnImpl<PeriodicPerInteraction>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
     else if (periodicType == PeriodicTriclinic)
         calculateBlockIxnImpl<PeriodicTriclinic>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
+    else if (periodicType == PeriodicTriclinicPerAtom)
+        calculateBlockIxnImpl<PeriodicTriclinicPerAtom>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
 }
 
 template <int PERIODIC_TYPE>
@@ -108,6 +108,8 @@ void CpuNonbondedForceVec4::calculateBlockIxnImpl(int blockIndex, float* forces,
         blockAtomPosq[i] = fvec4(posq+4*blockAtom[i]);
         if (PERIODIC_TYPE == PeriodicPerAtom)
             blockAtomPosq[i] -= floor((blockAtomPosq[i]-blockCenter)*invBoxSize+0.5f)*boxSize;
+        else if (PERIODIC_TYPE == PeriodicTriclinicPerAtom)
+            applyPeriodicToPos(blockAtomPosq[i], blockCenter);
     }
     fvec4 blockAtomX = fvec4(blockAtomPosq[0][0], blockAtomPosq[1][0], blockAtomPosq[2][0], blockAtomPosq[3][0]);
     fvec4 blockAtomY = fvec4(blockAtomPosq[0][1], blockAtomPosq[1][1], blockAtomPosq[2][1], blockAtomPosq[3][1]);
@@ -121,21 +123,24 @@ void CpuNonbondedForceVec4::calculateBlockIxnImpl(int blockIndex, float* forces,
     // Loop over neighbors for this block.
     
     const vector<int>& neighbors = neighborList->getBlockNeighbors(blockIndex);
-    const vector<char>& exclusions = neighborList->getBlockExclusions(blockIndex);
+    const vector<int>& exclusions = neighborList->getBlockExclusions(blockIndex);
+    const vector<float>& neighborPos = neighborList->getNeighborPositions(blockIndex);
     for (int i = 0; i < (int) neighbors.size(); i++) {
         // Load the next neighbor.
-        
+
         int atom = neighbors[i];
-        
+
         // Compute the distances to the block atoms.
-        
+
         fvec4 dx, dy, dz, r2;
-        fvec4 atomPos(posq+4*atom);
+        fvec4 atomPos(&neighborPos[4*i]);
         if (PERIODIC_TYPE == PeriodicPerAtom)
             atomPos -= floor((atomPos-blockCenter)*invBoxSize+0.5f)*boxSize;
+        else if (PERIODIC_TYPE == PeriodicTriclinicPerAtom)
+            applyPeriodicToPos(atomPos, blockCenter);
         getDeltaR<PERIODIC_TYPE>(atomPos, blockAtomX, blockAtomY, blockAtomZ, dx, dy, dz, r2, needPeriodic, boxSize, invBoxSize);
         ivec4 include;
-        char excl = exclusions[i];
+        int excl = exclusions[i];
         if (excl == 0)
             include = -1;
         else
@@ -170,7 +175,7 @@ void CpuNonbondedForceVec4::calculateBlockIxnImpl(int blockIndex, float* forces,
             energy = 0.0f;
             dEdR = 0.0f;
         }
-        fvec4 chargeProd = blockAtomCharge*posq[4*atom+3];
+        fvec4 chargeProd = blockAtomCharge*neighborPos[4*i+3];
         if (cutoff)
             dEdR += chargeProd*(inverseR-2.0f*krf*r2);
         else
@@ -238,14 +243,12 @@ void CpuNonbondedForceVec4::calculateBlockEwaldIxn(int blockIndex, float* forces
         if (!(minx < cutoffDistance || miny < cutoffDistance || minz < cutoffDistance ||
                 maxx > boxSize[0]-cutoffDistance || maxy > boxSize[1]-cutoffDistance || maxz > boxSize[2]-cutoffDistance))
             periodicType = NoPeriodic;
-        else if (triclinic)
-            periodicType = PeriodicTriclinic;
         else if (0.5f*(boxSize[0]-(maxx-minx)) >= cutoffDistance &&
                  0.5f*(boxSize[1]-(maxy-miny)) >= cutoffDistance &&
                  0.5f*(boxSize[2]-(maxz-minz)) >= cutoffDistance)
-            periodicType = PeriodicPerAtom;
+            periodicType = (triclinic ? PeriodicTriclinicPerAtom : PeriodicPerAtom);
         else
-            periodicType = PeriodicPerInteraction;
+            periodicType = (triclinic ? PeriodicTriclinic : PeriodicPerInteraction);
     }
     
     // Call the appropriate version depending on what calculation is required for periodic boundary conditions.
@@ -258,6 +261,8 @@ void CpuNonbondedForceVec4::calculateBlockEwaldIxn(int blockIndex, float* forces
         calculateBlockEwaldIxnImpl<PeriodicPerInteraction>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
     else if (periodicType == PeriodicTriclinic)
         calculateBlockEwaldIxnImpl<PeriodicTriclinic>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
+    else if (periodicType == PeriodicTriclinicPerAtom)
+        calculateBlockEwaldIxnImpl<PeriodicTriclinicPerAtom>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
 }
 
 template <int PERIODIC_TYPE>
@@ -270,6 +275,8 @@ void CpuNonbondedForceVec4::calculateBlockEwaldIxnImpl(int blockIndex, float* fo
         blockAtomPosq[i] = fvec4(posq+4*blockAtom[i]);
         if (PERIODIC_TYPE == PeriodicPerAtom)
             blockAtomPosq[i] -= floor((blockAtomPosq[i]-blockCenter)*invBoxSize+0.5f)*boxSize;
+        else if (PERIODIC_TYPE == PeriodicTriclinicPerAtom)
+            applyPeriodicToPos(blockAtomPosq[i], blockCenter);
     }
     fvec4 blockAtomX = fvec4(blockAtomPosq[0][0], blockAtomPosq[1][0], blockAtomPosq[2][0], blockAtomPosq[3][0]);
     fvec4 blockAtomY = fvec4(blockAtomPosq[0][1], blockAtomPosq[1][1], blockAtomPosq[2][1], blockAtomPosq[3][1]);
@@ -284,21 +291,24 @@ void CpuNonbondedForceVec4::calculateBlockEwaldIxnImpl(int blockIndex, float* fo
     // Loop over neighbors for this block.
     
     const vector<int>& neighbors = neighborList->getBlockNeighbors(blockIndex);
-    const vector<char>& exclusions = neighborList->getBlockExclusions(blockIndex);
+    const vector<int>& exclusions = neighborList->getBlockExclusions(blockIndex);
+    const vector<float>& neighborPos = neighborList->getNeighborPositions(blockIndex);
     for (int i = 0; i < (int) neighbors.size(); i++) {
         // Load the next neighbor.
-        
+
         int atom = neighbors[i];
-        
+
         // Compute the distances to the block atoms.
-        
+
         fvec4 dx, dy, dz, r2;
-        fvec4 atomPos(posq+4*atom);
+        fvec4 atomPos(&neighborPos[4*i]);
         if (PERIODIC_TYPE == PeriodicPerAtom)
             atomPos -= floor((atomPos-blockCenter)*invBoxSize+0.5f)*boxSize;
+        else if (PERIODIC_TYPE == PeriodicTriclinicPerAtom)
+            applyPeriodicToPos(atomPos, blockCenter);
         getDeltaR<PERIODIC_TYPE>(atomPos, blockAtomX, blockAtomY, blockAtomZ, dx, dy, dz, r2, needPeriodic, boxSize, invBoxSize);
         ivec4 include;
-        char excl = exclusions[i];
+        int excl = exclusions[i];
         if (excl == 0)
             include = -1;
         else
@@ -345,7 +355,7 @@ void CpuNonbondedForceVec4::calculateBlockEwaldIxnImpl(int blockIndex, float* fo
             energy = 0.0f;
             dEdR = 0.0f;
         }
-        fvec4 chargeProd = blockAtomCharge*posq[4*atom+3];
+        fvec4 chargeProd = blockAtomCharge*neighborPos[4*i+3];
         dEdR += chargeProd*inverseR*ewaldScaleFunction(r);
         dEdR *= inverseR*inverseR;        
 
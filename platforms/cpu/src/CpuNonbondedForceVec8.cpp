@@ -38,7 +38,7 @@ using namespace OpenMM;
     #undef __AVX__
 #endif
 
-#ifndef __AVX__
+#if !defined(__AVX__) && !defined(__ARM_NEON__) && !defined(__ARM_NEON)
 bool isVec8Supported() {
     return false;
 }
@@ -51,6 +51,11 @@ CpuNonbondedForce* createCpuNonbondedForceVec8() {
  * Check whether 8 component vectors are supported with the current CPU.
  */
 bool isVec8Supported() {
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+    // The eight element vectors are emulated with pairs of NEON registers.
+
+    return isVec4Supported();
+#else
     // Make sure the CPU supports AVX.
 
     int cpuInfo[4];
@@ -60,6 +65,7 @@ bool isVec8Supported() {
         return ((cpuInfo[2] & ((int) 1 << 28)) != 0);
     }
     return false;
+#endif
 }
 
 /**
@@ -78,7 +84,7 @@ CpuNonbondedForce* createCpuNonbondedForceVec8() {
 CpuNonbondedForceVec8::CpuNonbondedForceVec8() {
 }
 
-enum PeriodicType {NoPeriodic, PeriodicPerAtom, PeriodicPerInteraction, PeriodicTriclinic};
+enum PeriodicType {NoPeriodic, PeriodicPerAtom, PeriodicPerInteraction, PeriodicTriclinic, PeriodicTriclinicPerAtom};
 
 void CpuNonbondedForceVec8::calculateBlockIxn(int blockIndex, float* forces, double* totalEnergy, const fvec4& boxSize, const fvec4& invBoxSize) {
     // Determine whether we need to apply periodic boundary conditions.    
@@ -106,14 +112,12 @@ void CpuNonbondedForceVec8::calculateBlockIxn(int blockIndex, float* forces, dou
         if (!(minx < cutoffDistance || miny < cutoffDistance || minz < cutoffDistance ||
                 maxx > boxSize[0]-cutoffDistance || maxy > boxSize[1]-cutoffDistance || maxz > boxSize[2]-cutoffDistance))
             periodicType = NoPeriodic;
-        else if (triclinic)
-            periodicType = PeriodicTriclinic;
         else if (0.5f*(boxSize[0]-(maxx-minx)) >= cutoffDistance &&
                  0.5f*(boxSize[1]-(maxy-miny)) >= cutoffDistance &&
                  0.5f*(boxSize[2]-(maxz-minz)) >= cutoffDistance)
-            periodicType = PeriodicPerAtom;
+            periodicType = (triclinic ? PeriodicTriclinicPerAtom : PeriodicPerAtom);
         else
-            periodicType = PeriodicPerInteraction;
+            periodicType = (triclinic ? PeriodicTriclinic : PeriodicPerInteraction);
     }
     
     // Call the appropriate version depending on what calculation is required for periodic boundary conditions.
@@ -126,6 +130,8 @@ void CpuNonbondedForceVec8::calculateBlockIxn(int blockIndex, float* forces, dou
         calculateBlockIxnImpl<PeriodicPerInteraction>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
     else if (periodicType == PeriodicTriclinic)
         calculateBlockIxnImpl<PeriodicTriclinic>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
+    else if (periodicType == PeriodicTriclinicPerAtom)
+        calculateBlockIxnImpl<PeriodicTriclinicPerAtom>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
 }
 
 template <int PERIODIC_TYPE>
@@ -140,6 +146,8 @@ void CpuNonbondedForceVec8::calculateBlockIxnImpl(int blockIndex, float* forces,
         blockAtomPosq[i] = fvec4(posq+4*blockAtom[i]);
         if (PERIODIC_TYPE == PeriodicPerAtom)
             blockAtomPosq[i] -= floor((blockAtomPosq[i]-blockCenter)*invBoxSize+0.5f)*boxSize;
+        else if (PERIODIC_TYPE == PeriodicTriclinicPerAtom)
+            applyPeriodicToPos(blockAtomPosq[i], blockCenter);
     }
     transpose(blockAtomPosq[0], blockAtomPosq[1], blockAtomPosq[2], blockAtomPosq[3], blockAtomPosq[4], blockAtomPosq[5], blockAtomPosq[6], blockAtomPosq[7], blockAtomX, blockAtomY, blockAtomZ, blockAtomCharge);
     blockAtomCharge *= ONE_4PI_EPS0;
@@ -151,7 +159,8 @@ void CpuNonbondedForceVec8::calculateBlockIxnImpl(int blockIndex, float* forces,
     // Loop over neighbors for this block.
     
     const vector<int>& neighbors = neighborList->getBlockNeighbors(blockIndex);
-    const vector<char>& exclusions = neighborList->getBlockExclusions(blockIndex);
+    const vector<int>& exclusions = neighborList->getBlockExclusions(blockIndex);
+    const vector<float>& neighborPos = neighborList->getNeighborPositions(blockIndex);
     for (int i = 0; i < (int) neighbors.size(); i++) {
         // Load the next neighbor.
         
@@ -160,12 +169,14 @@ void CpuNonbondedForceVec8::calculateBlockIxnImpl(int blockIndex, float* forces,
         // Compute the distances to the block atoms.
         
         fvec8 dx, dy, dz, r2;
-        fvec4 atomPos(posq+4*atom);
+        fvec4 atomPos(&neighborPos[4*i]);
         if (PERIODIC_TYPE == PeriodicPerAtom)
             atomPos -= floor((atomPos-blockCenter)*invBoxSize+0.5f)*boxSize;
+        else if (PERIODIC_TYPE == PeriodicTriclinicPerAtom)
+            applyPeriodicToPos(atomPos, blockCenter);
         getDeltaR<PERIODIC_TYPE>(atomPos, blockAtomX, blockAtomY, blockAtomZ, dx, dy, dz, r2, needPeriodic, boxSize, invBoxSize);
         ivec8 include;
-        char excl = exclusions[i];
+        int excl = exclusions[i];
         if (excl == 0)
             include = -1;
         else
@@ -200,7 +211,7 @@ void CpuNonbondedForceVec8::calculateBlockIxnImpl(int blockIndex, float* forces,
             energy = 0.0f;
             dEdR = 0.0f;
         }
-        fvec8 chargeProd = blockAtomCharge*posq[4*atom+3];
+        fvec8 chargeProd = blockAtomCharge*neighborPos[4*i+3];
         if (cutoff)
             dEdR += chargeProd*(inverseR-2.0f*krf*r2);
         else
@@ -269,14 +280,12 @@ void CpuNonbondedForceVec8::calculateBlockEwaldIxn(int blockIndex, float* forces
         if (!(minx < cutoffDistance || miny < cutoffDistance || minz < cutoffDistance ||
                 maxx > boxSize[0]-cutoffDistance || maxy > boxSize[1]-cutoffDistance || maxz > boxSize[2]-cutoffDistance))
             periodicType = NoPeriodic;
-        else if (triclinic)
-            periodicType = PeriodicTriclinic;
         else if (0.5f*(boxSize[0]-(maxx-minx)) >= cutoffDistance &&
                  0.5f*(boxSize[1]-(maxy-miny)) >= cutoffDistance &&
                  0.5f*(boxSize[2]-(maxz-minz)) >= cutoffDistance)
-            periodicType = PeriodicPerAtom;
+            periodicType = (triclinic ? PeriodicTriclinicPerAtom : PeriodicPerAtom);
         else
-            periodicType = PeriodicPerInteraction;
+            periodicType = (triclinic ? PeriodicTriclinic : PeriodicPerInteraction);
     }
     
     // Call the appropriate version depending on what calculation is required for periodic boundary conditions.
@@ -289,6 +298,8 @@ void CpuNonbondedForceVec8::calculateBlockEwaldIxn(int blockIndex, float* forces
         calculateBlockEwaldIxnImpl<PeriodicPerInteraction>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
     else if (periodicType == PeriodicTriclinic)
         calculateBlockEwaldIxnImpl<PeriodicTriclinic>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
+    else if (periodicType == PeriodicTriclinicPerAtom)
+        calculateBlockEwaldIxnImpl<PeriodicTriclinicPerAtom>(blockIndex, forces, totalEnergy, boxSize, invBoxSize, blockCenter);
 }
 
 template <int PERIODIC_TYPE>
@@ -303,6 +314,8 @@ void CpuNonbondedForceVec8::calculateBlockEwaldIxnImpl(int blockIndex, float* fo
         blockAtomPosq[i] = fvec4(posq+4*blockAtom[i]);
         if (PERIODIC_TYPE == PeriodicPerAtom)
             blockAtomPosq[i] -= floor((blockAtomPosq[i]-blockCenter)*invBoxSize+0.5f)*boxSize;
+        else if (PERIODIC_TYPE == PeriodicTriclinicPerAtom)
+            applyPeriodicToPos(blockAtomPosq[i], blockCenter);
     }
     transpose(blockAtomPosq[0], blockAtomPosq[1], blockAtomPosq[2], blockAtomPosq[3], blockAtomPosq[4], blockAtomPosq[5], blockAtomPosq[6], blockAtomPosq[7], blockAtomX, blockAtomY, blockAtomZ, blockAtomCharge);
     blockAtomCharge *= ONE_4PI_EPS0;
@@ -315,7 +328,8 @@ void CpuNonbondedForceVec8::calculateBlockEwaldIxnImpl(int blockIndex, float* fo
     // Loop over neighbors for this block.
     
     const vector<int>& neighbors = neighborList->getBlockNeighbors(blockIndex);
-    const vector<char>& exclusions = neighborList->getBlockExclusions(blockIndex);
+    const vector<int>& exclusions = neighborList->getBlockExclusions(blockIndex);
+    const vector<float>& neighborPos = neighborList->getNeighborPositions(blockIndex);
     for (int i = 0; i < (int) neighbors.size(); i++) {
         // Load the next neighbor.
         
@@ -324,12 +338,14 @@ void CpuNonbondedForceVec8::calculateBlockEwaldIxnImpl(int blockIndex, float* fo
         // Compute the distances to the block atoms.
         
         fvec8 dx, dy, dz, r2;
-        fvec4 atomPos(posq+4*atom);
+        fvec4 atomPos(&neighborPos[4*i]);
         if (PERIODIC_TYPE == PeriodicPerAtom)
             atomPos -= floor((atomPos-blockCenter)*invBoxSize+0.5f)*boxSize;
+        else if (PERIODIC_TYPE == PeriodicTriclinicPerAtom)
+            applyPeriodicToPos(atomPos, blockCenter);
         getDeltaR<PERIODIC_TYPE>(atomPos, blockAtomX, blockAtomY, blockAtomZ, dx, dy, dz, r2, needPeriodic, boxSize, invBoxSize);
         ivec8 include;
-        char excl = exclusions[i];
+        int excl = exclusions[i];
         if (excl == 0)
             include = -1;
         else
@@ -376,7 +392,7 @@ void CpuNonbondedForceVec8::calculateBlockEwaldIxnImpl(int blockIndex, float* fo
             energy = 0.0f;
             dEdR = 0.0f;
         }
-        fvec8 chargeProd = blockAtomCharge*posq[4*atom+3];
+        fvec8 chargeProd = blockAtomCharge*neighborPos[4*i+3];
         dEdR += chargeProd*inverseR*ewaldScaleFunction(r);
         dEdR *= inverseR*inverseR;
 
@@ -40,6 +40,10 @@
 #include <algorithm>
 #include <sstream>
 #include <stdlib.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 using namespace OpenMM;
 using namespace std;
@@ -60,6 +64,16 @@ extern "C" OPENMM_EXPORT_CPU void registerPlatforms() {
 
 map<const ContextImpl*, CpuPlatform::PlatformData*> CpuPlatform::contextData;
 
+bool isVec8Supported();
+bool isVec16Supported();
+
+/**
+ * Get the width of the SIMD vectors the nonbonded kernels will use, as a string.
+ */
+static string getVectorWidthString() {
+    return (isVec16Supported() ? "16" : (isVec8Supported() ? "8" : "4"));
+}
+
 CpuPlatform::CpuPlatform() {
     deprecatedPropertyReplacements["CpuThreads"] = CpuThreads();
     CpuKernelFactory* factory = new CpuKernelFactory();
@@ -67,6 +81,8 @@ CpuPlatform::CpuPlatform() {
     registerKernelFactory(CalcHarmonicAngleForceKernel::Name(), factory);
     registerKernelFactory(CalcPeriodicTorsionForceKernel::Name(), factory);
     registerKernelFactory(CalcRBTorsionForceKernel::Name(), factory);
+    registerKernelFactory(CalcCMAPTorsionForceKernel::Name(), factory);
+    registerKernelFactory(CalcCustomCompoundBondForceKernel::Name(), factory);
     registerKernelFactory(CalcNonbondedForceKernel::Name(), factory);
     registerKernelFactory(CalcCustomNonbondedForceKernel::Name(), factory);
     registerKernelFactory(CalcCustomManyParticleForceKernel::Name(), factory);
@@ -74,9 +90,19 @@ CpuPlatform::CpuPlatform() {
     registerKernelFactory(CalcCustomGBForceKernel::Name(), factory);
     registerKernelFactory(CalcGayBerneForceKernel::Name(), factory);
     registerKernelFactory(IntegrateLangevinStepKernel::Name(), factory);
-    platformProperties.push_back(CpuThreads());
+    registerKernelFactory(IntegrateLangevinMiddleStepKernel::Name(), factory);
+    // The superclass already registered the Threads property; we only override its default below.
     platformProperties.push_back(CpuDeterministicForces());
-    int threads = getNumProcessors();
+    platformProperties.push_back(CpuVectorWidth());
+    platformProperties.push_back(CpuThreadAffinity());
+    platformProperties.push_back(CpuCounterBasedRandoms());
+    platformProperties.push_back(CpuNeighborListPadding());
+    platformProperties.push_back(CpuNeighborListRebuilds());
+    // On hybrid CPUs, only use the performance cores by default.  Every thread has to
+    // synchronize many times per step, so threads on slower cores make all the others
+    // sit idle waiting for them.
+
+    int threads = getNumPerformanceCores();
     char* threadsEnv = getenv("OPENMM_CPU_THREADS");
     if (threadsEnv != NULL)
         stringstream(threadsEnv) >> threads;
@@ -84,6 +110,11 @@ CpuPlatform::CpuPlatform() {
     defaultThreads << threads;
     setPropertyDefaultValue(CpuThreads(), defaultThreads.str());
     setPropertyDefaultValue(CpuDeterministicForces(), "false");
+    setPropertyDefaultValue(CpuVectorWidth(), getVectorWidthString());
+    setPropertyDefaultValue(CpuThreadAffinity(), "none");
+    setPropertyDefaultValue(CpuCounterBasedRandoms(), "false");
+    setPropertyDefaultValue(CpuNeighborListPadding(), "0");
+    setPropertyDefaultValue(CpuNeighborListRebuilds(), "0");
 }
 
 const string& CpuPlatform::getPropertyValue(const Context& context, const string& property) const {
@@ -92,6 +123,17 @@ const string& CpuPlatform::getPropertyValue(const Context& context, const string
     string propertyName = property;
     if (deprecatedPropertyReplacements.find(property) != deprecatedPropertyReplacements.end())
         propertyName = deprecatedPropertyReplacements.find(property)->second;
+    if (propertyName == CpuNeighborListPadding() || propertyName == CpuNeighborListRebuilds()) {
+        // These report the current state of the neighbor list padding tuner, so they are
+        // computed at the time they are queried.
+
+        stringstream value;
+        if (propertyName == CpuNeighborListPadding())
+            value << max(0.0, data.paddedCutoff-data.cutoff);
+        else
+            value << data.neighborListRebuildCount;
+        const_cast<PlatformData&>(data).propertyValues[propertyName] = value.str();
+    }
     map<string, string>::const_iterator value = data.propertyValues.find(propertyName);
     if (value != data.propertyValues.end())
         return value->second;
@@ -116,11 +158,20 @@ void CpuPlatform::contextCreated(ContextImpl& context, const map<string, string>
             getPropertyDefaultValue(CpuThreads()) : properties.find(CpuThreads())->second);
     string deterministicForcesValue = (properties.find(CpuDeterministicForces()) == properties.end() ?
             getPropertyDefaultValue(CpuDeterministicForces()) : properties.find(CpuDeterministicForces())->second);
+    string affinityValue = (properties.find(CpuThreadAffinity()) == properties.end() ?
+            getPropertyDefaultValue(CpuThreadAffinity()) : properties.find(CpuThreadAffinity())->second);
+    string counterBasedValue = (properties.find(CpuCounterBasedRandoms()) == properties.end() ?
+            getPropertyDefaultValue(CpuCounterBasedRandoms()) : properties.find(CpuCounterBasedRandoms())->second);
     int numThreads;
     stringstream(threadsPropValue) >> numThreads;
     transform(deterministicForcesValue.begin(), deterministicForcesValue.end(), deterministicForcesValue.begin(), ::tolower);
+    transform(affinityValue.begin(), affinityValue.end(), affinityValue.begin(), ::tolower);
+    transform(counterBasedValue.begin(), counterBasedValue.end(), counterBasedValue.begin(), ::tolower);
     bool deterministicForces = (deterministicForcesValue == "true");
-    PlatformData* data = new PlatformData(context.getSystem().getNumParticles(), numThreads, deterministicForces);
+    bool pinThreads = (affinityValue == "pin");
+    PlatformData* data = new PlatformData(context.getSystem().getNumParticles(), numThreads, deterministicForces, pinThreads);
+    data->random.setUseCounterBased(counterBasedValue == "true");
+    data->propertyValues[CpuCounterBasedRandoms()] = (counterBasedValue == "true" ? "true" : "false");
     contextData[&context] = data;
     ReferenceConstraints& constraints = *(ReferenceConstraints*) reinterpret_cast<ReferencePlatform::PlatformData*>(context.getPlatformData())->constraints;
     if (constraints.settle != NULL) {
@@ -146,17 +197,44 @@ const CpuPlatform::PlatformData& CpuPlatform::getPlatformData(const ContextImpl&
     return *contextData[&context];
 }
 
-CpuPlatform::PlatformData::PlatformData(int numParticles, int numThreads, bool deterministicForces) : posq(4*numParticles), threads(numThreads),
-        deterministicForces(deterministicForces), neighborList(NULL), cutoff(0.0), paddedCutoff(0.0), anyExclusions(false) {
+CpuPlatform::PlatformData::PlatformData(int numParticles, int numThreads, bool deterministicForces, bool pinThreads) : posq(4*numParticles), threads(numThreads),
+        deterministicForces(deterministicForces), neighborList(NULL), cutoff(0.0), paddedCutoff(0.0), minPaddedCutoff(0.0), maxPaddedCutoff(0.0),
+        stepsSinceNeighborListRebuild(0), neighborListRebuildCount(0), anyExclusions(false) {
     numThreads = threads.getNumThreads();
     threadForce.resize(numThreads);
     for (int i = 0; i < numThreads; i++)
         threadForce[i].resize(4*numParticles);
+    if (pinThreads) {
+#ifdef __linux__
+        // Bind each worker thread to a single processor so it cannot migrate away from
+        // the memory it allocates, then have it touch the arrays it works on.  The pages
+        // get allocated on the memory node of the thread that will use them most, and a
+        // slice of the shared position array on each node.
+
+        int numProcessors = getNumProcessors();
+        int particlesPerThread = (numParticles+numThreads-1)/numThreads;
+        threads.execute([&] (ThreadPool& pool, int index) {
+            cpu_set_t processors;
+            CPU_ZERO(&processors);
+            CPU_SET(index%numProcessors, &processors);
+            pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &processors);
+            for (int i = 0; i < threadForce[index].size(); i++)
+                threadForce[index][i] = 0.0f;
+            int start = min(index*particlesPerThread, numParticles);
+            int end = min(start+particlesPerThread, numParticles);
+            for (int i = 4*start; i < 4*end; i++)
+                posq[i] = 0.0f;
+        });
+        threads.waitForThreads();
+#endif
+    }
     isPeriodic = false;
     stringstream threadsProperty;
     threadsProperty << numThreads;
     propertyValues[CpuThreads()] = threadsProperty.str();
     propertyValues[CpuDeterministicForces()] = deterministicForces ? "true" : "false";
+    propertyValues[CpuVectorWidth()] = getVectorWidthString();
+    propertyValues[CpuThreadAffinity()] = pinThreads ? "pin" : "none";
 }
 
 CpuPlatform::PlatformData::~PlatformData() {
@@ -164,15 +242,16 @@ CpuPlatform::PlatformData::~PlatformData() {
         delete neighborList;
 }
 
-bool isVec8Supported();
-
 void CpuPlatform::PlatformData::requestNeighborList(double cutoffDistance, double padding, bool useExclusions, const vector<set<int> >& exclusionList) {
     if (neighborList == NULL)
-        neighborList = new CpuNeighborList(isVec8Supported() ? 8 : 4);
+        neighborList = new CpuNeighborList(isVec16Supported() ? 16 : (isVec8Supported() ? 8 : 4));
     if (cutoffDistance > cutoff)
         cutoff = cutoffDistance;
-    if (cutoffDistance+padding > paddedCutoff)
+    if (cutoffDistance+padding > paddedCutoff) {
         paddedCutoff = cutoffDistance+padding;
+        minPaddedCutoff = cutoffDistance+0.5*padding;
+        maxPaddedCutoff = cutoffDistance+2.0*padding;
+    }
     if (useExclusions) {
         if (anyExclusions && exclusions != exclusionList)
             throw OpenMMException("All Forces must have identical exclusions");
@@ -184,3 +263,23 @@ void CpuPlatform::PlatformData::requestNeighborList(double cutoffDistance, doubl
     else if (!anyExclusions)
         exclusions = exclusionList;
 }
+
+void CpuPlatform::PlatformData::tuneNeighborListPadding() {
+    // Pick the padding for the neighbor list that is about to be built based on how long the
+    // previous one lasted.  A larger padding makes each list more expensive to iterate over
+    // but lets it survive more steps.  The best tradeoff depends on temperature, density, and
+    // step size, so it has to be found at run time.  Every padding in the allowed range is
+    // equally accurate: the checks in CpuCalcForcesAndEnergyKernel::beginComputation force a
+    // rebuild whenever a pair could be missing from the list, whatever padding it was built
+    // with.  The current padding and rebuild count are reported by the NeighborListPadding
+    // and NeighborListRebuilds properties.
+
+    if (neighborListRebuildCount > 0) {
+        if (stepsSinceNeighborListRebuild < 10)
+            paddedCutoff = min(cutoff+1.25*(paddedCutoff-cutoff), maxPaddedCutoff);
+        else if (stepsSinceNeighborListRebuild > 25)
+            paddedCutoff = max(cutoff+0.8*(paddedCutoff-cutoff), minPaddedCutoff);
+    }
+    neighborListRebuildCount++;
+    stepsSinceNeighborListRebuild = 0;
+}
@@ -22,6 +22,9 @@
  * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#ifdef WIN32
+#define _USE_MATH_DEFINES // Needed to get M_PI
+#endif
 #include "CpuRandom.h"
 #include "openmm/internal/OSRngSeed.h"
 #include "openmm/OpenMMException.h"
@@ -30,10 +33,20 @@
 using namespace std;
 using namespace OpenMM;
 
-CpuRandom::CpuRandom() : hasInitialized(false) {
+CpuRandom::CpuRandom() : hasInitialized(false), useCounterBased(false), hasPool(false) {
 }
 
 CpuRandom::~CpuRandom() {
+    if (hasPool) {
+        pthread_mutex_lock(&poolLock);
+        poolThreadShouldExit = true;
+        pthread_cond_signal(&poolStartCondition);
+        pthread_mutex_unlock(&poolLock);
+        pthread_join(poolThread, NULL);
+        pthread_mutex_destroy(&poolLock);
+        pthread_cond_destroy(&poolStartCondition);
+        pthread_cond_destroy(&poolEndCondition);
+    }
     for (auto random : threadRandom)
         delete random;
 }
@@ -57,6 +70,7 @@ void CpuRandom::initialize(int seed, int numThreads) {
     unsigned int r = (unsigned int) seed;
     if (r == 0)
         r = (unsigned int) osrngseed();
+    resolvedSeed = r;
     for (int i = 0; i < numThreads; i++) {
         r = (1664525*r + 1013904223) & 0xFFFFFFFF;
         threadRandom[i] = new OpenMM_SFMT::SFMT();
@@ -87,3 +101,136 @@ float CpuRandom::getGaussianRandom(int threadIndex) {
 float CpuRandom::getUniformRandom(int threadIndex) {
     return genrand_real2(*threadRandom[threadIndex]);
 }
+
+void CpuRandom::setUseCounterBased(bool use) {
+    useCounterBased = use;
+}
+
+bool CpuRandom::getUseCounterBased() const {
+    return useCounterBased;
+}
+
+/**
+ * Compute one block of the Philox-4x32-10 counter based generator.  The output depends
+ * only on the counter and key, so no mutable state is needed.
+ */
+static void philox4x32(const unsigned int counter[4], const unsigned int key[2], unsigned int result[4]) {
+    unsigned int c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    unsigned int k0 = key[0], k1 = key[1];
+    for (int round = 0; round < 10; round++) {
+        unsigned long long product0 = 0xD2511F53ULL*c0;
+        unsigned long long product1 = 0xCD9E8D57ULL*c2;
+        unsigned int hi0 = (unsigned int) (product0>>32), lo0 = (unsigned int) product0;
+        unsigned int hi1 = (unsigned int) (product1>>32), lo1 = (unsigned int) product1;
+        c0 = hi1^c1^k0;
+        c1 = lo1;
+        c2 = hi0^c3^k1;
+        c3 = lo0;
+        k0 += 0x9E3779B9;
+        k1 += 0xBB67AE85;
+    }
+    result[0] = c0;
+    result[1] = c1;
+    result[2] = c2;
+    result[3] = c3;
+}
+
+void CpuRandom::getCounterBasedGaussians(unsigned int step, unsigned int particle, float values[3]) const {
+    unsigned int counter[] = {step, particle, 0, 0};
+    unsigned int key[] = {resolvedSeed, 0xCAFEF00D};
+    unsigned int bits[4];
+    philox4x32(counter, key, bits);
+
+    // Convert the uniform bits to Gaussian values with the Box-Muller transformation.
+    // The offset keeps the uniform values strictly inside (0, 1).
+
+    const float scale = 1.0f/4294967296.0f;
+    float u1 = (bits[0]+0.5f)*scale;
+    float u2 = (bits[1]+0.5f)*scale;
+    float u3 = (bits[2]+0.5f)*scale;
+    float u4 = (bits[3]+0.5f)*scale;
+    float r1 = sqrtf(-2.0f*logf(u1));
+    float r2 = sqrtf(-2.0f*logf(u3));
+    values[0] = r1*cosf(2.0f*(float) M_PI*u2);
+    values[1] = r1*sinf(2.0f*(float) M_PI*u2);
+    values[2] = r2*cosf(2.0f*(float) M_PI*u4);
+}
+
+void CpuRandom::createGaussianPool(int valuesPerThread) {
+    if (!hasInitialized)
+        throw OpenMMException("createGaussianPool() called before the random number generator was initialized");
+    if (!hasPool) {
+        // Create the buffers and the thread that fills them.
+
+        poolSize = valuesPerThread;
+        gaussianPool.resize(threadRandom.size());
+        for (auto& pool : gaussianPool)
+            pool.resize(poolSize);
+        poolFilled = false;
+        poolThreadShouldExit = false;
+        pthread_mutex_init(&poolLock, NULL);
+        pthread_cond_init(&poolStartCondition, NULL);
+        pthread_cond_init(&poolEndCondition, NULL);
+        pthread_create(&poolThread, NULL, poolFillerBody, this);
+        hasPool = true;
+    }
+    else if (valuesPerThread > poolSize) {
+        // Enlarge the buffers, then have the background thread fill them again.
+
+        pthread_mutex_lock(&poolLock);
+        while (!poolFilled)
+            pthread_cond_wait(&poolEndCondition, &poolLock);
+        poolSize = valuesPerThread;
+        for (auto& pool : gaussianPool)
+            pool.resize(poolSize);
+        poolFilled = false;
+        pthread_cond_signal(&poolStartCondition);
+        pthread_mutex_unlock(&poolLock);
+    }
+
+    // Wait until the pool has been filled.
+
+    pthread_mutex_lock(&poolLock);
+    while (!poolFilled)
+        pthread_cond_wait(&poolEndCondition, &poolLock);
+    pthread_mutex_unlock(&poolLock);
+}
+
+const float* CpuRandom::acquireGaussianPool(int threadIndex) {
+    pthread_mutex_lock(&poolLock);
+    while (!poolFilled)
+        pthread_cond_wait(&poolEndCondition, &poolLock);
+    pthread_mutex_unlock(&poolLock);
+    return &gaussianPool[threadIndex][0];
+}
+
+void CpuRandom::refillGaussianPool() {
+    if (!hasPool)
+        return;
+    pthread_mutex_lock(&poolLock);
+    poolFilled = false;
+    pthread_cond_signal(&poolStartCondition);
+    pthread_mutex_unlock(&poolLock);
+}
+
+void* CpuRandom::poolFillerBody(void* args) {
+    CpuRandom& random = *reinterpret_cast<CpuRandom*>(args);
+    while (true) {
+        random.fillGaussianPool();
+        pthread_mutex_lock(&random.poolLock);
+        random.poolFilled = true;
+        pthread_cond_broadcast(&random.poolEndCondition);
+        while (random.poolFilled && !random.poolThreadShouldExit)
+            pthread_cond_wait(&random.poolStartCondition, &random.poolLock);
+        pthread_mutex_unlock(&random.poolLock);
+        if (random.poolThreadShouldExit)
+            break;
+    }
+    return 0;
+}
+
+void CpuRandom::fillGaussianPool() {
+    for (int thread = 0; thread < (int) gaussianPool.size(); thread++)
+        for (int i = 0; i < poolSize; i++)
+            gaussianPool[thread][i] = getGaussianRandom(thread);
+}
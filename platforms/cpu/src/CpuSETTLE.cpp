@@ -31,6 +31,8 @@
 
 #include "CpuSETTLE.h"
 #include "openmm/internal/gmx_atomic.h"
+#include "openmm/internal/vectorize.h"
+#include <cmath>
 
 using namespace OpenMM;
 using namespace std;
@@ -50,7 +52,7 @@ CpuSETTLE::CpuSETTLE(const System& system, const ReferenceSETTLEAlgorithm& settl
             vector<double> distance1(numThreadClusters), distance2(numThreadClusters);
             for (int j = 0; j < numThreadClusters; j++)
                 settle.getClusterParameters(start+j, atom1[j], atom2[j], atom3[j], distance1[j], distance2[j]);
-            threadSettle.push_back(new ReferenceSETTLEAlgorithm(atom1, atom2, atom3, distance1, distance2, mass));
+            threadSettle.push_back(new VectorizedBlock(atom1, atom2, atom3, distance1, distance2, mass));
         }
     }
 }
@@ -74,6 +76,14 @@ void CpuSETTLE::apply(vector<OpenMM::Vec3>& atomCoordinates, vector<OpenMM::Vec3
     threads.waitForThreads();
 }
 
+int CpuSETTLE::getNumBlocks() const {
+    return threadSettle.size();
+}
+
+ReferenceSETTLEAlgorithm& CpuSETTLE::getBlockAlgorithm(int index) {
+    return *threadSettle[index];
+}
+
 void CpuSETTLE::applyToVelocities(vector<OpenMM::Vec3>& atomCoordinates, vector<OpenMM::Vec3>& velocities, vector<double>& inverseMasses, double tolerance) {
     gmx_atomic_t atomicCounter;
     gmx_atomic_set(&atomicCounter, 0);
@@ -87,3 +97,211 @@ void CpuSETTLE::applyToVelocities(vector<OpenMM::Vec3>& atomCoordinates, vector<
     });
     threads.waitForThreads();
 }
+
+CpuSETTLE::VectorizedBlock::VectorizedBlock(const vector<int>& atom1, const vector<int>& atom2, const vector<int>& atom3,
+        const vector<double>& distance1, const vector<double>& distance2, vector<double>& masses) :
+        ReferenceSETTLEAlgorithm(atom1, atom2, atom3, distance1, distance2, masses), tail(NULL) {
+    int numClusters = atom1.size();
+    numVectorClusters = 4*(numClusters/4);
+    this->atom1.assign(atom1.begin(), atom1.begin()+numVectorClusters);
+    this->atom2.assign(atom2.begin(), atom2.begin()+numVectorClusters);
+    this->atom3.assign(atom3.begin(), atom3.begin()+numVectorClusters);
+
+    // Pack the cluster parameters into SoA form, precomputing the quantities that depend
+    // only on the masses and constraint distances.
+
+    for (int i = 0; i < numVectorClusters; i++) {
+        double mass0 = masses[atom1[i]];
+        double mass1 = masses[atom2[i]];
+        double mass2 = masses[atom3[i]];
+        double invMass = 1/(mass0+mass1+mass2);
+        double rcVal = 0.5*distance2[i];
+        double rbVal = sqrt(distance1[i]*distance1[i]-rcVal*rcVal);
+        double raVal = rbVal*(mass1+mass2)*invMass;
+        rbVal -= raVal;
+        m0.push_back((float) mass0);
+        m1.push_back((float) mass1);
+        m2.push_back((float) mass2);
+        invTotalMass.push_back((float) invMass);
+        ra.push_back((float) raVal);
+        rb.push_back((float) rbVal);
+        rc.push_back((float) rcVal);
+        distance2Squared.push_back((float) (distance2[i]*distance2[i]));
+    }
+
+    // Any leftover clusters are handled by a scalar algorithm.
+
+    if (numVectorClusters < numClusters) {
+        vector<int> tailAtom1(atom1.begin()+numVectorClusters, atom1.end());
+        vector<int> tailAtom2(atom2.begin()+numVectorClusters, atom2.end());
+        vector<int> tailAtom3(atom3.begin()+numVectorClusters, atom3.end());
+        vector<double> tailDistance1(distance1.begin()+numVectorClusters, distance1.end());
+        vector<double> tailDistance2(distance2.begin()+numVectorClusters, distance2.end());
+        tail = new ReferenceSETTLEAlgorithm(tailAtom1, tailAtom2, tailAtom3, tailDistance1, tailDistance2, masses);
+    }
+}
+
+CpuSETTLE::VectorizedBlock::~VectorizedBlock() {
+    if (tail != NULL)
+        delete tail;
+}
+
+void CpuSETTLE::VectorizedBlock::apply(vector<OpenMM::Vec3>& atomCoordinates, vector<OpenMM::Vec3>& atomCoordinatesP, vector<double>& inverseMasses, double tolerance) {
+    // This follows the scalar implementation in ReferenceSETTLEAlgorithm, but processes
+    // four clusters at once with one cluster in each vector lane.  The displacements and
+    // relative positions are computed in double precision during the gather, so only the
+    // small quantities the algorithm actually works with are rounded to single precision.
+
+    Vec3 apos0[4], apos1[4], apos2[4];
+    float dx0[4], dy0[4], dz0[4], dx1[4], dy1[4], dz1[4], dx2[4], dy2[4], dz2[4];
+    float bx[4], by[4], bz[4], cx[4], cy[4], cz[4];
+    float outAx[4], outAy[4], outAz[4], outBx[4], outBy[4], outBz[4], outCx[4], outCy[4], outCz[4];
+    for (int index = 0; index < numVectorClusters; index += 4) {
+        for (int j = 0; j < 4; j++) {
+            int a0 = atom1[index+j];
+            int a1 = atom2[index+j];
+            int a2 = atom3[index+j];
+            apos0[j] = atomCoordinates[a0];
+            apos1[j] = atomCoordinates[a1];
+            apos2[j] = atomCoordinates[a2];
+            Vec3 d0 = atomCoordinatesP[a0]-apos0[j];
+            Vec3 d1 = atomCoordinatesP[a1]-apos1[j];
+            Vec3 d2 = atomCoordinatesP[a2]-apos2[j];
+            dx0[j] = d0[0]; dy0[j] = d0[1]; dz0[j] = d0[2];
+            dx1[j] = d1[0]; dy1[j] = d1[1]; dz1[j] = d1[2];
+            dx2[j] = d2[0]; dy2[j] = d2[1]; dz2[j] = d2[2];
+            Vec3 b = apos1[j]-apos0[j];
+            Vec3 c = apos2[j]-apos0[j];
+            bx[j] = b[0]; by[j] = b[1]; bz[j] = b[2];
+            cx[j] = c[0]; cy[j] = c[1]; cz[j] = c[2];
+        }
+        fvec4 xp0x(dx0), xp0y(dy0), xp0z(dz0);
+        fvec4 xp1x(dx1), xp1y(dy1), xp1z(dz1);
+        fvec4 xp2x(dx2), xp2y(dy2), xp2z(dz2);
+        fvec4 xb0(bx), yb0(by), zb0(bz);
+        fvec4 xc0(cx), yc0(cy), zc0(cz);
+        fvec4 mass0(&m0[index]), mass1(&m1[index]), mass2(&m2[index]);
+        fvec4 invMass(&invTotalMass[index]);
+
+        // Apply the SETTLE algorithm.
+
+        fvec4 xcom = (xp0x*mass0 + (xb0+xp1x)*mass1 + (xc0+xp2x)*mass2)*invMass;
+        fvec4 ycom = (xp0y*mass0 + (yb0+xp1y)*mass1 + (yc0+xp2y)*mass2)*invMass;
+        fvec4 zcom = (xp0z*mass0 + (zb0+xp1z)*mass1 + (zc0+xp2z)*mass2)*invMass;
+
+        fvec4 xa1 = xp0x - xcom;
+        fvec4 ya1 = xp0y - ycom;
+        fvec4 za1 = xp0z - zcom;
+        fvec4 xb1 = xb0 + xp1x - xcom;
+        fvec4 yb1 = yb0 + xp1y - ycom;
+        fvec4 zb1 = zb0 + xp1z - zcom;
+        fvec4 xc1 = xc0 + xp2x - xcom;
+        fvec4 yc1 = yc0 + xp2y - ycom;
+        fvec4 zc1 = zc0 + xp2z - zcom;
+
+        fvec4 xaksZd = yb0*zc0 - zb0*yc0;
+        fvec4 yaksZd = zb0*xc0 - xb0*zc0;
+        fvec4 zaksZd = xb0*yc0 - yb0*xc0;
+        fvec4 xaksXd = ya1*zaksZd - za1*yaksZd;
+        fvec4 yaksXd = za1*xaksZd - xa1*zaksZd;
+        fvec4 zaksXd = xa1*yaksZd - ya1*xaksZd;
+        fvec4 xaksYd = yaksZd*zaksXd - zaksZd*yaksXd;
+        fvec4 yaksYd = zaksZd*xaksXd - xaksZd*zaksXd;
+        fvec4 zaksYd = xaksZd*yaksXd - yaksZd*xaksXd;
+
+        fvec4 axlng = sqrt(xaksXd*xaksXd + yaksXd*yaksXd + zaksXd*zaksXd);
+        fvec4 aylng = sqrt(xaksYd*xaksYd + yaksYd*yaksYd + zaksYd*zaksYd);
+        fvec4 azlng = sqrt(xaksZd*xaksZd + yaksZd*yaksZd + zaksZd*zaksZd);
+        fvec4 trns11 = xaksXd/axlng;
+        fvec4 trns21 = yaksXd/axlng;
+        fvec4 trns31 = zaksXd/axlng;
+        fvec4 trns12 = xaksYd/aylng;
+        fvec4 trns22 = yaksYd/aylng;
+        fvec4 trns32 = zaksYd/aylng;
+        fvec4 trns13 = xaksZd/azlng;
+        fvec4 trns23 = yaksZd/azlng;
+        fvec4 trns33 = zaksZd/azlng;
+
+        fvec4 xb0d = trns11*xb0 + trns21*yb0 + trns31*zb0;
+        fvec4 yb0d = trns12*xb0 + trns22*yb0 + trns32*zb0;
+        fvec4 xc0d = trns11*xc0 + trns21*yc0 + trns31*zc0;
+        fvec4 yc0d = trns12*xc0 + trns22*yc0 + trns32*zc0;
+        fvec4 za1d = trns13*xa1 + trns23*ya1 + trns33*za1;
+        fvec4 xb1d = trns11*xb1 + trns21*yb1 + trns31*zb1;
+        fvec4 yb1d = trns12*xb1 + trns22*yb1 + trns32*zb1;
+        fvec4 zb1d = trns13*xb1 + trns23*yb1 + trns33*zb1;
+        fvec4 xc1d = trns11*xc1 + trns21*yc1 + trns31*zc1;
+        fvec4 yc1d = trns12*xc1 + trns22*yc1 + trns32*zc1;
+        fvec4 zc1d = trns13*xc1 + trns23*yc1 + trns33*zc1;
+
+        //                                        --- Step2  A2' ---
+
+        fvec4 rcVal(&rc[index]), rbVal(&rb[index]), raVal(&ra[index]);
+        fvec4 sinphi = za1d/raVal;
+        fvec4 cosphi = sqrt(fvec4(1.0f) - sinphi*sinphi);
+        fvec4 sinpsi = (zb1d - zc1d)/(fvec4(2.0f)*rcVal*cosphi);
+        fvec4 cospsi = sqrt(fvec4(1.0f) - sinpsi*sinpsi);
+
+        fvec4 ya2d = raVal*cosphi;
+        fvec4 xb2d = -rcVal*cospsi;
+        fvec4 yb2d = -rbVal*cosphi - rcVal*sinpsi*sinphi;
+        fvec4 yc2d = -rbVal*cosphi + rcVal*sinpsi*sinphi;
+        fvec4 xb2d2 = xb2d*xb2d;
+        fvec4 hh2 = fvec4(4.0f)*xb2d2 + (yb2d-yc2d)*(yb2d-yc2d) + (zb1d-zc1d)*(zb1d-zc1d);
+        fvec4 deltx = fvec4(2.0f)*xb2d + sqrt(fvec4(4.0f)*xb2d2 - hh2 + fvec4(&distance2Squared[index]));
+        xb2d = xb2d - deltx*fvec4(0.5f);
+
+        //                                        --- Step3  al,be,ga ---
+
+        fvec4 alpha = xb2d*(xb0d-xc0d) + yb0d*yb2d + yc0d*yc2d;
+        fvec4 beta = xb2d*(yc0d-yb0d) + xb0d*yb2d + xc0d*yc2d;
+        fvec4 gamma = xb0d*yb1d - xb1d*yb0d + xc0d*yc1d - xc1d*yc0d;
+
+        fvec4 al2be2 = alpha*alpha + beta*beta;
+        fvec4 sintheta = (alpha*gamma - beta*sqrt(al2be2 - gamma*gamma))/al2be2;
+
+        //                                        --- Step4  A3' ---
+
+        fvec4 costheta = sqrt(fvec4(1.0f) - sintheta*sintheta);
+        fvec4 xa3d = -ya2d*sintheta;
+        fvec4 ya3d = ya2d*costheta;
+        fvec4 za3d = za1d;
+        fvec4 xb3d = xb2d*costheta - yb2d*sintheta;
+        fvec4 yb3d = xb2d*sintheta + yb2d*costheta;
+        fvec4 zb3d = zb1d;
+        fvec4 xc3d = -xb2d*costheta - yc2d*sintheta;
+        fvec4 yc3d = -xb2d*sintheta + yc2d*costheta;
+        fvec4 zc3d = zc1d;
+
+        //                                        --- Step5  A3 ---
+
+        fvec4 xa3 = trns11*xa3d + trns12*ya3d + trns13*za3d;
+        fvec4 ya3 = trns21*xa3d + trns22*ya3d + trns23*za3d;
+        fvec4 za3 = trns31*xa3d + trns32*ya3d + trns33*za3d;
+        fvec4 xb3 = trns11*xb3d + trns12*yb3d + trns13*zb3d;
+        fvec4 yb3 = trns21*xb3d + trns22*yb3d + trns23*zb3d;
+        fvec4 zb3 = trns31*xb3d + trns32*yb3d + trns33*zb3d;
+        fvec4 xc3 = trns11*xc3d + trns12*yc3d + trns13*zc3d;
+        fvec4 yc3 = trns21*xc3d + trns22*yc3d + trns23*zc3d;
+        fvec4 zc3 = trns31*xc3d + trns32*yc3d + trns33*zc3d;
+
+        // Record the new positions.
+
+        (xcom + xa3).store(outAx);
+        (ycom + ya3).store(outAy);
+        (zcom + za3).store(outAz);
+        (xcom + xb3 - xb0).store(outBx);
+        (ycom + yb3 - yb0).store(outBy);
+        (zcom + zb3 - zb0).store(outBz);
+        (xcom + xc3 - xc0).store(outCx);
+        (ycom + yc3 - yc0).store(outCy);
+        (zcom + zc3 - zc0).store(outCz);
+        for (int j = 0; j < 4; j++) {
+            atomCoordinatesP[atom1[index+j]] = apos0[j] + Vec3(outAx[j], outAy[j], outAz[j]);
+            atomCoordinatesP[atom2[index+j]] = apos1[j] + Vec3(outBx[j], outBy[j], outBz[j]);
+            atomCoordinatesP[atom3[index+j]] = apos2[j] + Vec3(outCx[j], outCy[j], outCz[j]);
+        }
+    }
+    if (tail != NULL)
+        tail->apply(atomCoordinates, atomCoordinatesP, inverseMasses, tolerance);
+}
@@ -0,0 +1,170 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2018 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "CpuVectorExpression.h"
+#include "openmm/OpenMMException.h"
+#include "lepton/Operation.h"
+#include <cmath>
+
+using namespace OpenMM;
+using namespace std;
+
+CpuVectorExpression::CpuVectorExpression() {
+}
+
+CpuVectorExpression::CpuVectorExpression(const Lepton::ParsedExpression& expression, const map<string, float*>& variableLocations) :
+        program(expression.createProgram()) {
+    variablePointers.resize(program.getNumOperations(), NULL);
+    for (int i = 0; i < program.getNumOperations(); i++) {
+        const Lepton::Operation& op = program.getOperation(i);
+        if (op.getId() == Lepton::Operation::VARIABLE) {
+            map<string, float*>::const_iterator pointer = variableLocations.find(op.getName());
+            if (pointer == variableLocations.end())
+                throw OpenMMException("CpuVectorExpression: no location specified for variable '"+op.getName()+"'");
+            variablePointers[i] = pointer->second;
+        }
+    }
+    stack.resize(4*(program.getStackSize()+1));
+    int maxArguments = 1;
+    for (int i = 0; i < program.getNumOperations(); i++)
+        if (program.getOperation(i).getNumArguments() > maxArguments)
+            maxArguments = program.getOperation(i).getNumArguments();
+    argValues.resize(maxArguments);
+}
+
+fvec4 CpuVectorExpression::evaluate() const {
+    // This mirrors ExpressionProgram::evaluate(), but with a block of four floats in each
+    // stack slot.  The stack grows downward, and the arguments to each operation are at
+    // the current stack pointer in order.
+
+    int stackPointer = program.getStackSize();
+    for (int i = 0; i < program.getNumOperations(); i++) {
+        const Lepton::Operation& op = program.getOperation(i);
+        float* args = &stack[4*stackPointer];
+        switch (op.getId()) {
+            case Lepton::Operation::CONSTANT:
+                stackPointer--;
+                fvec4((float) dynamic_cast<const Lepton::Operation::Constant&>(op).getValue()).store(&stack[4*stackPointer]);
+                break;
+            case Lepton::Operation::VARIABLE:
+                stackPointer--;
+                fvec4(variablePointers[i]).store(&stack[4*stackPointer]);
+                break;
+            case Lepton::Operation::ADD:
+                stackPointer++;
+                (fvec4(args)+fvec4(args+4)).store(&stack[4*stackPointer]);
+                break;
+            case Lepton::Operation::SUBTRACT:
+                stackPointer++;
+                (fvec4(args)-fvec4(args+4)).store(&stack[4*stackPointer]);
+                break;
+            case Lepton::Operation::MULTIPLY:
+                stackPointer++;
+                (fvec4(args)*fvec4(args+4)).store(&stack[4*stackPointer]);
+                break;
+            case Lepton::Operation::DIVIDE:
+                stackPointer++;
+                (fvec4(args)/fvec4(args+4)).store(&stack[4*stackPointer]);
+                break;
+            case Lepton::Operation::NEGATE:
+                (-fvec4(args)).store(args);
+                break;
+            case Lepton::Operation::SQRT:
+                sqrt(fvec4(args)).store(args);
+                break;
+            case Lepton::Operation::EXP:
+                exp(fvec4(args)).store(args);
+                break;
+            case Lepton::Operation::LOG:
+                log(fvec4(args)).store(args);
+                break;
+            case Lepton::Operation::SQUARE: {
+                fvec4 arg(args);
+                (arg*arg).store(args);
+                break;
+            }
+            case Lepton::Operation::CUBE: {
+                fvec4 arg(args);
+                (arg*arg*arg).store(args);
+                break;
+            }
+            case Lepton::Operation::RECIPROCAL:
+                (fvec4(1.0f)/fvec4(args)).store(args);
+                break;
+            case Lepton::Operation::ADD_CONSTANT:
+                (fvec4(args)+fvec4((float) dynamic_cast<const Lepton::Operation::AddConstant&>(op).getValue())).store(args);
+                break;
+            case Lepton::Operation::MULTIPLY_CONSTANT:
+                (fvec4(args)*fvec4((float) dynamic_cast<const Lepton::Operation::MultiplyConstant&>(op).getValue())).store(args);
+                break;
+            case Lepton::Operation::POWER_CONSTANT: {
+                double exponent = dynamic_cast<const Lepton::Operation::PowerConstant&>(op).getValue();
+                int intExponent = (int) exponent;
+                if (intExponent == exponent && intExponent >= -16 && intExponent <= 16) {
+                    // An integer power can be computed with repeated multiplication.
+
+                    fvec4 base(args);
+                    if (intExponent < 0) {
+                        base = fvec4(1.0f)/base;
+                        intExponent = -intExponent;
+                    }
+                    fvec4 result(1.0f);
+                    while (intExponent > 0) {
+                        if (intExponent%2 == 1)
+                            result = result*base;
+                        base = base*base;
+                        intExponent /= 2;
+                    }
+                    result.store(args);
+                }
+                else {
+                    for (int j = 0; j < 4; j++)
+                        args[j] = powf(args[j], (float) exponent);
+                }
+                break;
+            }
+            default: {
+                // Fall back to evaluating the scalar operation once per lane.
+
+                int numArgs = op.getNumArguments();
+                stackPointer += numArgs-1;
+                float result[4];
+                for (int j = 0; j < 4; j++) {
+                    for (int k = 0; k < numArgs; k++)
+                        argValues[k] = args[4*k+j];
+                    result[j] = (float) op.evaluate(&argValues[0], dummyVariables);
+                }
+                fvec4(result).store(&stack[4*stackPointer]);
+            }
+        }
+    }
+    return fvec4(&stack[4*(program.getStackSize()-1)]);
+}
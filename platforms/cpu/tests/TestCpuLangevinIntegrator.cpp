@@ -32,5 +32,40 @@
 #include "CpuTests.h"
 #include "TestLangevinIntegrator.h"
 
+void testCounterBasedReproducibility() {
+    // With the counter based random number generator, the trajectory should not depend
+    // on the number of threads.
+
+    const int numParticles = 50;
+    System system;
+    NonbondedForce* forceField = new NonbondedForce();
+    for (int i = 0; i < numParticles; ++i) {
+        system.addParticle(2.0);
+        forceField->addParticle(0.0, 0.3, 0.1);
+    }
+    system.addForce(forceField);
+    vector<Vec3> positions(numParticles);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    for (int i = 0; i < numParticles; ++i)
+        positions[i] = Vec3(5*genrand_real2(sfmt), 5*genrand_real2(sfmt), 5*genrand_real2(sfmt));
+    vector<Vec3> finalPositions[2];
+    const char* threads[] = {"1", "4"};
+    for (int i = 0; i < 2; i++) {
+        LangevinIntegrator integrator(300.0, 1.0, 0.002);
+        integrator.setRandomNumberSeed(10);
+        map<string, string> properties;
+        properties[CpuPlatform::CpuThreads()] = threads[i];
+        properties[CpuPlatform::CpuCounterBasedRandoms()] = "true";
+        Context context(system, integrator, platform, properties);
+        context.setPositions(positions);
+        integrator.step(50);
+        finalPositions[i] = context.getState(State::Positions).getPositions();
+    }
+    for (int i = 0; i < numParticles; i++)
+        ASSERT_EQUAL_VEC(finalPositions[0][i], finalPositions[1][i], 1e-10);
+}
+
 void runPlatformTests() {
+    testCounterBasedReproducibility();
 }
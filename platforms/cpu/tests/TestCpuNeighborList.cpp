@@ -88,7 +88,7 @@ void testNeighborList(bool periodic, bool triclinic) {
     for (int i = 0; i < (int) neighborList.getSortedAtoms().size(); i++) {
         int blockIndex = i/blockSize;
         int indexInBlock = i-blockIndex*blockSize;
-        char mask = 1<<indexInBlock;
+        int mask = 1<<indexInBlock;
         for (int j = 0; j < (int) neighborList.getBlockExclusions(blockIndex).size(); j++) {
             if ((neighborList.getBlockExclusions(blockIndex)[j] & mask) == 0) {
                 int atom1 = neighborList.getSortedAtoms()[i];
@@ -119,6 +119,57 @@ void testNeighborList(bool periodic, bool triclinic) {
         }
 }
 
+void testSkin(bool periodic) {
+    const int numParticles = 500;
+    const float cutoff = 2.0f;
+    const float skin = 0.5f;
+    Vec3 boxVectors[3] = {Vec3(10, 0, 0), Vec3(0, 9, 0), Vec3(0, 0, 11)};
+    const float boxSize[3] = {(float) boxVectors[0][0], (float) boxVectors[1][1], (float) boxVectors[2][2]};
+    const int blockSize = 4;
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    AlignedArray<float> positions(4*numParticles);
+    for (int i = 0; i < 4*numParticles; i++)
+        if (i%4 < 3)
+            positions[i] = boxSize[i%4]*genrand_real2(sfmt);
+    vector<set<int> > exclusions(numParticles);
+    ThreadPool threads;
+    CpuNeighborList neighborList(blockSize);
+    neighborList.computeNeighborList(numParticles, positions, exclusions, boxVectors, periodic, cutoff, threads, skin);
+
+    // Move each particle by less than half the skin distance, then recompute the neighbor list.
+    // The rebuild should be skipped, and the list should still include every pair within the cutoff.
+
+    for (int i = 0; i < 4*numParticles; i++)
+        if (i%4 < 3)
+            positions[i] += 0.4f*skin*(float) (genrand_real2(sfmt)-0.5);
+    neighborList.computeNeighborList(numParticles, positions, exclusions, boxVectors, periodic, cutoff, threads, skin);
+    set<pair<int, int> > neighbors;
+    for (int i = 0; i < (int) neighborList.getSortedAtoms().size(); i++) {
+        int blockIndex = i/blockSize;
+        int indexInBlock = i-blockIndex*blockSize;
+        int mask = 1<<indexInBlock;
+        for (int j = 0; j < (int) neighborList.getBlockExclusions(blockIndex).size(); j++) {
+            if ((neighborList.getBlockExclusions(blockIndex)[j] & mask) == 0) {
+                int atom1 = neighborList.getSortedAtoms()[i];
+                int atom2 = neighborList.getBlockNeighbors(blockIndex)[j];
+                neighbors.insert(make_pair(min(atom1, atom2), max(atom1, atom2)));
+            }
+        }
+    }
+    for (int i = 0; i < numParticles; i++)
+        for (int j = 0; j < i; j++) {
+            Vec3 diff(positions[4*i]-positions[4*j], positions[4*i+1]-positions[4*j+1], positions[4*i+2]-positions[4*j+2]);
+            if (periodic) {
+                diff -= boxVectors[2]*floor(diff[2]/boxSize[2]+0.5);
+                diff -= boxVectors[1]*floor(diff[1]/boxSize[1]+0.5);
+                diff -= boxVectors[0]*floor(diff[0]/boxSize[0]+0.5);
+            }
+            if (diff.dot(diff) < cutoff*cutoff)
+                ASSERT(neighbors.find(make_pair(min(i, j), max(i, j))) != neighbors.end());
+        }
+}
+
 int main() {
     try {
         if (!CpuPlatform::isProcessorSupported()) {
@@ -128,6 +179,8 @@ int main() {
         testNeighborList(false, false);
         testNeighborList(true, false);
         testNeighborList(true, true);
+        testSkin(false);
+        testSkin(true);
     }
     catch(const exception& e) {
         cout << "exception: " << e.what() << endl;
@@ -66,7 +66,38 @@ public:
      * @param name              the name of the array
      */
     CudaArray(CudaContext& context, int size, int elementSize, const std::string& name);
+    /**
+     * Create an uninitialized CudaArray object.  It does not point to any device memory,
+     * and cannot be used until initialize() is called on it.
+     */
+    CudaArray();
     ~CudaArray();
+    /**
+     * Initialize this object.
+     *
+     * @param context           the context for which to create the array
+     * @param size              the number of elements in the array
+     * @param elementSize       the size of each element in bytes
+     * @param name              the name of the array
+     */
+    void initialize(CudaContext& context, int size, int elementSize, const std::string& name);
+    /**
+     * Initialize this object.  The template argument is the data type of each array element.
+     *
+     * @param context           the context for which to create the array
+     * @param size              the number of elements in the array
+     * @param name              the name of the array
+     */
+    template <class T>
+    void initialize(CudaContext& context, int size, const std::string& name) {
+        initialize(context, size, sizeof(T), name);
+    }
+    /**
+     * Get whether this object has been initialized.
+     */
+    bool isInitialized() const {
+        return pointer != 0;
+    }
     /**
      * Get the number of elements in the array.
      */
@@ -119,6 +150,16 @@ public:
      *                 the source array  must be in page-locked memory.
      */
     void upload(const void* data, bool blocking = true);
+    /**
+     * Copy values from host memory to a subset of the array.
+     *
+     * @param data     the data to copy
+     * @param offset   the index of the element within the array at which the copy should begin
+     * @param elements the number of elements to copy
+     * @param blocking if true, this call will block until the transfer is complete.  If false,
+     *                 the source array must be in page-locked memory.
+     */
+    void uploadSubArray(const void* data, int offset, int elements, bool blocking = true);
     /**
      * Copy the values in the device memory to an array.
      * 
@@ -134,7 +175,7 @@ public:
      */
     void copyTo(CudaArray& dest) const;
 private:
-    CudaContext& context;
+    CudaContext* context;
     CUdeviceptr pointer;
     int size, elementSize;
     bool ownsMemory;
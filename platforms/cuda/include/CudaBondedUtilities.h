@@ -122,14 +122,18 @@ public:
     void initialize(const System& system);
     /**
      * Compute the bonded interactions.
-     * 
+     *
      * @param groups        a set of bit flags for which force groups to include
+     * @param includeForces true if forces should be computed
+     * @param includeEnergy true if the energy should be computed
      */
-    void computeInteractions(int groups);
+    void computeInteractions(int groups, bool includeForces, bool includeEnergy);
 private:
-    std::string createForceSource(int forceIndex, int numBonds, int numAtoms, int group, const std::string& computeForce);
+    std::string createForceSource(int forceIndex, int numBonds, int numAtoms, int group, const std::string& computeForce, bool includeForces);
     CudaContext& context;
     CUfunction kernel;
+    CUfunction energyKernel;
+    CUfunction gatherKernel;
     std::vector<std::vector<std::vector<int> > > forceAtoms;
     std::vector<std::vector<int> > indexWidth;
     std::vector<std::string> forceSource;
@@ -137,9 +141,15 @@ private:
     std::vector<CUdeviceptr> arguments;
     std::vector<std::string> argTypes;
     std::vector<std::vector<CudaArray*> > atomIndices;
+    std::vector<CudaArray*> termOrder;
+    CudaArray* scratchBuffer;
+    CudaArray* gatherStarts;
+    CudaArray* gatherSlots;
+    std::vector<int> scratchOffsets;
     std::vector<std::string> prefixCode;
     std::vector<std::string> energyParameterDerivatives;
     std::vector<void*> kernelArgs;
+    std::vector<void*> gatherArgs;
     int numForceBuffers, maxBonds, allGroups;
     bool hasInitializedKernels, hasInteractions;
 };
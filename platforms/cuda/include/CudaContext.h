@@ -29,6 +29,7 @@
 
 #include <map>
 #include <queue>
+#include <set>
 #include <string>
 #include <utility>
 #define __CL_ENABLE_EXCEPTIONS
@@ -77,7 +78,8 @@ public:
     static const int ThreadBlockSize;
     static const int TileSize;
     CudaContext(const System& system, int deviceIndex, bool useBlockingSync, const std::string& precision,
-            const std::string& compiler, const std::string& tempDir, const std::string& hostCompiler, CudaPlatform::PlatformData& platformData);
+            const std::string& compiler, const std::string& tempDir, const std::string& cacheDir, const std::string& hostCompiler,
+            const std::string& profilingFile, CudaPlatform::PlatformData& platformData);
     ~CudaContext();
     /**
      * This is called to initialize internal data structures after all Forces in the system
@@ -123,6 +125,18 @@ public:
     int getDeviceIndex() const {
         return deviceIndex;
     }
+    /**
+     * Get the directory in which compiled kernels are cached.
+     */
+    const std::string& getCacheDir() const {
+        return cacheDir;
+    }
+    /**
+     * Get the architecture string (e.g. "52") of the device associated with this object.
+     */
+    const std::string& getGpuArchitecture() const {
+        return gpuArchitecture;
+    }
     /**
      * Get the PlatformData object this context is part of.
      */
@@ -177,6 +191,14 @@ public:
     CudaArray& getEnergyBuffer() {
         return *energyBuffer;
     }
+    /**
+     * Get the array whose first element contains the total energy computed by the most
+     * recent call to reduceEnergy().  It stays resident on the device, so kernels can
+     * use the total without copying it back to the host.
+     */
+    CudaArray& getEnergySum() {
+        return *energySum;
+    }
     /**
      * Get the array which contains the buffer in which derivatives of the energy with respect to parameters are computed.
      */
@@ -190,6 +212,57 @@ public:
     void* getPinnedBuffer() {
         return pinnedBuffer;
     }
+    /**
+     * Get a pointer to a block of pinned memory of at least a particular size, reallocating the
+     * buffer if it is not already large enough.  Staging transfers through pinned memory lets
+     * the driver copy data to and from the device at full bus bandwidth.
+     *
+     * @param size   the minimum size of the buffer, in bytes
+     */
+    void* getPinnedBuffer(size_t size);
+    /**
+     * Get a block of device memory of a particular size.  If a block of exactly that size was
+     * previously released with releaseDeviceMemory() it is reused; otherwise new memory is
+     * allocated.  Pooling the memory this way reduces the number of allocations performed when
+     * creating or reinitializing a Context.
+     *
+     * @param size   the size of the block to get, in bytes
+     */
+    CUdeviceptr acquireDeviceMemory(size_t size);
+    /**
+     * Return a block of device memory acquired with acquireDeviceMemory() to the pool, so that
+     * a later request for a block of the same size can reuse it.
+     *
+     * @param pointer   the memory to return to the pool
+     * @param size      the size of the block, in bytes
+     */
+    void releaseDeviceMemory(CUdeviceptr pointer, size_t size);
+    /**
+     * Get the total number of bytes of device memory that have been allocated on behalf of this
+     * context through acquireDeviceMemory(), including blocks currently sitting in the pool.
+     * This is the context's contribution to the device memory footprint of the process.
+     */
+    size_t getAllocatedDeviceMemory() const {
+        return allocatedDeviceMemory;
+    }
+    /**
+     * Get the number of bytes of device memory held by each named array belonging to this
+     * context.  Arrays with the same name, such as parameter buffers created by different
+     * forces, are summed together.
+     *
+     * @param usage   on exit, a map from array names to the number of bytes each one occupies
+     */
+    void getDeviceMemoryUsage(std::map<std::string, size_t>& usage) const;
+    /**
+     * Register a newly created CudaArray with this context so it can be included in memory
+     * usage reports.  This is called automatically by the CudaArray constructor.
+     */
+    void registerArray(CudaArray* array);
+    /**
+     * Remove an array registered with registerArray().  This is called automatically by the
+     * CudaArray destructor.
+     */
+    void unregisterArray(CudaArray* array);
     /**
      * Get the host-side vector which contains the index of each atom.
      */
@@ -250,6 +323,62 @@ public:
      * @param sharedSize   the amount of dynamic shared memory to allocated for the kernel, in bytes
      */
     void executeKernel(CUfunction kernel, void** arguments, int workUnits, int blockSize = -1, unsigned int sharedSize = 0);
+    /**
+     * Wait until an event that was recorded on a stream has completed.  This polls the event for
+     * a short time before falling back to a blocking wait.  The polling budget adapts to how long
+     * recent waits have taken, so short waits complete without the latency of waking a sleeping
+     * thread while long waits quickly return the CPU to the operating system.
+     *
+     * @param event    the event to wait on
+     */
+    void synchronizeEvent(CUevent event);
+    /**
+     * Begin capturing a sequence of kernel launches so that it can later be replayed as a single
+     * CUDA graph, avoiding the overhead of launching each kernel individually.  Kernels executed
+     * between this call and the matching call to endCaptureSequence() are recorded instead of being
+     * executed.  Only kernel launches may be performed while capturing: operations that synchronize
+     * with the device, such as transferring data or waiting on an event, are not permitted.
+     *
+     * This requires CUDA 10.1 or later.  On older versions it always returns false, and kernels
+     * execute normally.
+     *
+     * @param sequence  an identifier for the sequence, typically a pointer to the object that owns it
+     * @return whether capturing has begun
+     */
+    bool beginCaptureSequence(const void* sequence);
+    /**
+     * Stop capturing kernel launches and instantiate the recorded sequence as a CUDA graph.  Note
+     * that the captured kernels have not actually been executed.  If this returns true, call
+     * executeCapturedSequence() to execute them.  If it returns false, the caller must launch them
+     * again itself.
+     *
+     * @return whether the sequence was successfully instantiated as a graph
+     */
+    bool endCaptureSequence();
+    /**
+     * Execute a previously captured sequence of kernels as a single CUDA graph.
+     *
+     * @param sequence  the identifier that was passed to beginCaptureSequence()
+     * @return whether the sequence had been captured and was executed
+     */
+    bool executeCapturedSequence(const void* sequence);
+    /**
+     * Discard all captured sequences, forcing them to be captured again before they can next be
+     * replayed.  Call this whenever the kernels making up a sequence, or argument values that were
+     * baked into it when it was captured, may have changed.
+     */
+    void invalidateCapturedSequences();
+    /**
+     * Exchange the positions and velocities of this context with those of another context that
+     * was created from an identical System.  The particle data is copied directly between the
+     * devices without staging it through host memory, so this is much faster than exchanging
+     * States.  This is useful for algorithms like replica exchange that periodically swap whole
+     * configurations between contexts.  The caller is responsible for exchanging any state the
+     * contexts do not hold themselves, such as the periodic box vectors.
+     *
+     * @param other  the context to exchange state with
+     */
+    void swapState(CudaContext& other);
     /**
      * Compute the largest thread block size that can be used for a kernel that requires a particular amount of
      * shared memory per thread.
@@ -284,6 +413,36 @@ public:
      * Clear all buffers that have been registered with addAutoclearBuffer().
      */
     void clearAutoclearBuffers();
+    /**
+     * Sum the energy buffer on the device with a two stage tree reduction and return the
+     * total.  The total is also left in the array returned by getEnergySum().
+     */
+    double reduceEnergy();
+    /**
+     * Register an array that other forces may reuse as scratch space for their PME charge grids.
+     * The contents of a PME grid never need to survive from one force evaluation to the next, so
+     * forces that do all their reciprocal space work on the default stream can share a single
+     * allocation.  A force that uses a separate stream for PME must not register its grids, since
+     * its use of the memory could overlap another force's.
+     */
+    void registerPmeGrid(CudaArray* grid);
+    /**
+     * Get a PME grid that was registered with registerPmeGrid() and contains at least numBytes
+     * bytes, or NULL if there is none.  Pass a nonzero index to skip grids returned by earlier
+     * calls, so a force that needs several grids gets distinct ones.  The calling force must do
+     * all its reciprocal space work on the default stream.
+     *
+     * @param numBytes  the minimum size of the grid in bytes
+     * @param index     the number of matching grids to skip over
+     */
+    CudaArray* findPmeGrid(long long numBytes, int index);
+    /**
+     * Get whether a grid is being shared between forces.  A force whose grid is shared cannot
+     * rely on an autoclear buffer still being zero when it runs, since another force may have
+     * used the memory earlier in the same evaluation, so it should clear the grid explicitly
+     * before spreading into it.
+     */
+    bool isPmeGridShared(CudaArray* grid);
     /**
      * Get the current simulation time.
      */
@@ -608,6 +767,12 @@ private:
      */
     template <class Real, class Real4, class Mixed, class Mixed4>
     void reorderAtomsImpl();
+    /**
+     * Compute the elapsed times for all kernel launches whose profiling events have not yet
+     * been processed, and append them to the trace that will be written when the context is
+     * destroyed.
+     */
+    void flushProfileEvents();
     static bool hasInitializedCuda;
     const System& system;
     double time, computeCapability;
@@ -616,12 +781,13 @@ private:
     int contextIndex;
     int stepCount;
     int computeForceCount;
-    int stepsSinceReorder;
+    int stepsSinceReorder, interactionsAfterReorder;
     int numAtoms;
     int paddedNumAtoms;
     int numAtomBlocks;
     int numThreadBlocks;
-    bool useBlockingSync, useDoublePrecision, useMixedPrecision, contextIsValid, atomsWereReordered, boxIsTriclinic, hasCompilerKernel, isNvccAvailable, forcesValid;
+    long long eventWaitEstimate;
+    bool useBlockingSync, useDoublePrecision, useMixedPrecision, contextIsValid, atomsWereReordered, boxIsTriclinic, hasCompilerKernel, useCompilerKernel, isNvccAvailable, forcesValid;
     std::string compiler, tempDir, cacheDir, gpuArchitecture;
     float4 periodicBoxVecXFloat, periodicBoxVecYFloat, periodicBoxVecZFloat, periodicBoxSizeFloat, invPeriodicBoxSizeFloat;
     double4 periodicBoxVecX, periodicBoxVecY, periodicBoxVecZ, periodicBoxSize, invPeriodicBoxSize;
@@ -630,6 +796,12 @@ private:
     CUcontext context;
     CUdevice device;
     CUstream currentStream;
+#if CUDA_VERSION >= 10010
+    bool capturingSequence;
+    const void* captureSequenceId;
+    CUstream captureStream;
+    std::map<const void*, CUgraphExec> capturedSequences;
+#endif
     CUfunction clearBufferKernel;
     CUfunction clearTwoBuffersKernel;
     CUfunction clearThreeBuffersKernel;
@@ -637,21 +809,42 @@ private:
     CUfunction clearFiveBuffersKernel;
     CUfunction clearSixBuffersKernel;
     CUfunction setChargesKernel;
+    CUfunction reduceEnergyKernel;
     std::vector<CudaForceInfo*> forces;
     std::vector<Molecule> molecules;
     std::vector<MoleculeGroup> moleculeGroups;
     std::vector<int4> posCellOffsets;
     void* pinnedBuffer;
+    size_t pinnedBufferSize;
     CudaArray* posq;
     CudaArray* posqCorrection;
     CudaArray* velm;
     CudaArray* force;
     CudaArray* energyBuffer;
+    CudaArray* energyPartialSums;
+    CudaArray* energySum;
     CudaArray* energyParamDerivBuffer;
     CudaArray* atomIndexDevice;
     CudaArray* chargeBuffer;
     std::vector<std::string> energyParamDerivNames;
     std::map<std::string, double> energyParamDerivWorkspace;
+    std::vector<CudaArray*> sharedPmeGrids;
+    std::vector<CudaArray*> borrowedPmeGrids;
+    std::map<size_t, std::vector<CUdeviceptr> > pooledDeviceMemory;
+    std::set<CudaArray*> registeredArrays;
+    size_t allocatedDeviceMemory;
+    struct ProfiledKernel {
+        CUevent start;
+        CUevent end;
+        CUfunction kernel;
+    };
+    bool profileKernels;
+    std::string profilingFile;
+    std::string profileTrace;
+    CUevent profileStartEvent;
+    std::map<CUfunction, std::string> kernelNames;
+    std::vector<ProfiledKernel> pendingProfiledKernels;
+    std::vector<std::pair<CUevent, CUevent> > profileEventPool;
     std::vector<int> atomIndex;
     std::vector<CUdeviceptr> autoclearBuffers;
     std::vector<int> autoclearBufferSizes;
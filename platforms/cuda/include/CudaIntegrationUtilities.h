@@ -70,6 +70,12 @@ public:
      * Get the size that was used for the last step.
      */
     double getLastStepSize();
+    /**
+     * Start an asynchronous download of the current step size.  Calling this as soon as the
+     * step size has been selected lets getLastStepSize() wait only for that early point in
+     * the stream instead of for all of the step's kernels to finish.
+     */
+    void downloadStepSizeAsync();
     /**
      * Apply constraints to the atom positions.
      *
@@ -82,6 +88,14 @@ public:
      * @param tol             the constraint tolerance
      */
     void applyVelocityConstraints(double tol);
+    /**
+     * Get whether applyConstraints() consists of a fixed sequence of kernel launches that can
+     * safely be captured with CudaContext::beginCaptureSequence().  This is false when CCMA is
+     * in use, since it iterates to convergence, synchronizing with the host along the way.
+     */
+    bool constraintsAreCapturable() const {
+        return (ccmaAtoms == NULL);
+    }
     /**
      * Initialize the random number generator.
      */
@@ -152,6 +166,7 @@ private:
     int* ccmaConvergedMemory;
     CUdeviceptr ccmaConvergedDeviceMemory;
     CUevent ccmaEvent;
+    int ccmaExpectedIterations[2];
     CudaArray* vsite2AvgAtoms;
     CudaArray* vsite2AvgWeights;
     CudaArray* vsite3AvgAtoms;
@@ -160,6 +175,9 @@ private:
     CudaArray* vsiteOutOfPlaneWeights;
     CudaArray* vsiteLocalCoordsAtoms;
     CudaArray* vsiteLocalCoordsParams;
+    double2* pinnedStepSizeMemory;
+    CUevent stepSizeEvent;
+    bool stepSizeDownloadPending;
     int randomPos;
     int lastSeed, numVsites;
     double2 lastStepSize;
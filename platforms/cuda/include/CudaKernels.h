@@ -34,10 +34,13 @@
 #include "CudaParameterSet.h"
 #include "CudaSort.h"
 #include "openmm/kernels.h"
+#include "openmm/internal/CustomNonbondedForceImpl.h"
+#include "openmm/internal/NonbondedForceImpl.h"
 #include "openmm/System.h"
 #include "openmm/internal/CompiledExpressionSet.h"
 #include "openmm/internal/CustomIntegratorUtilities.h"
 #include "lepton/CompiledExpression.h"
+#include "lepton/ExpressionProgram.h"
 #include <cufft.h>
 
 namespace OpenMM {
@@ -103,6 +106,13 @@ public:
      * energy directly, <i>or</i> add it to an internal buffer so that it will be included here.
      */
     double finishComputation(ContextImpl& context, bool includeForce, bool includeEnergy, int groups, bool& valid);
+    /**
+     * The kernels accumulate all of the energies in a single device buffer that is reduced by
+     * finishComputation(), so the energies by force group have to be computed one group at a time.
+     */
+    bool supportsEnergyDecomposition() const {
+        return false;
+    }
 private:
    CudaContext& cu;
 };
@@ -113,8 +123,10 @@ private:
  */
 class CudaUpdateStateDataKernel : public UpdateStateDataKernel {
 public:
-    CudaUpdateStateDataKernel(std::string name, const Platform& platform, CudaContext& cu) : UpdateStateDataKernel(name, platform), cu(cu) {
+    CudaUpdateStateDataKernel(std::string name, const Platform& platform, CudaContext& cu) : UpdateStateDataKernel(name, platform), cu(cu),
+            downloadStream(NULL), downloadEvent(NULL), downloadBuffer(NULL), quantizeKernel(NULL), wrapKernel(NULL) {
     }
+    ~CudaUpdateStateDataKernel();
     /**
      * Initialize the kernel.
      *
@@ -139,6 +151,48 @@ public:
      * @param positions  on exit, this contains the particle positions
      */
     void getPositions(ContextImpl& context, std::vector<Vec3>& positions);
+    /**
+     * Get the positions of all particles, translating each molecule so its center lies inside
+     * the first periodic box.  The wrapping is done in a kernel before the download, so this
+     * costs the same as getPositions().
+     *
+     * @param positions  on exit, this contains the particle positions
+     * @return true, since the wrapping is always done on the device
+     */
+    bool getWrappedPositions(ContextImpl& context, std::vector<Vec3>& positions);
+    /**
+     * Begin copying the positions of all particles to the host.  The copy is enqueued on a
+     * separate stream so it can proceed while integration continues.  Call finishGetPositions()
+     * to wait for it and retrieve the result.
+     *
+     * @param context    the context in which to execute this kernel
+     */
+    void beginGetPositions(ContextImpl& context);
+    /**
+     * Block until the copy started by beginGetPositions() has finished, and get the positions
+     * it recorded.
+     *
+     * @param positions  on exit, this contains the particle positions
+     */
+    void finishGetPositions(ContextImpl& context, std::vector<Vec3>& positions);
+    /**
+     * Get the positions of a subset of the particles, transferring only the requested
+     * elements instead of downloading the whole position array.
+     *
+     * @param particles  the indices of the particles whose positions are requested
+     * @param positions  on exit, this contains the position of each requested particle
+     */
+    void getSelectedPositions(ContextImpl& context, const std::vector<int>& particles, std::vector<Vec3>& positions);
+    /**
+     * Get the positions of all particles in a quantized fixed point representation.  The
+     * conversion is performed by a kernel on the device, so only the integer array needs to
+     * be transferred to the host.
+     *
+     * @param resolution  the spacing between representable positions (in nm)
+     * @param positions   on exit, this contains three integers for each particle.  Multiplying
+     *                    them by the resolution gives the particle's position in nm.
+     */
+    void getQuantizedPositions(ContextImpl& context, double resolution, std::vector<int>& positions);
     /**
      * Set the positions of all particles.
      *
@@ -157,6 +211,14 @@ public:
      * @param velocities  a vector containg the particle velocities
      */
     void setVelocities(ContextImpl& context, const std::vector<Vec3>& velocities);
+    /**
+     * Set the positions and velocities of all particles, staging both arrays through a single
+     * pinned buffer so each direction of transfer involves only one synchronization.
+     *
+     * @param positions   a vector containg the particle positions
+     * @param velocities  a vector containg the particle velocities
+     */
+    void setPositionsAndVelocities(ContextImpl& context, const std::vector<Vec3>& positions, const std::vector<Vec3>& velocities);
     /**
      * Get the current forces on all particles.
      *
@@ -199,6 +261,21 @@ public:
     void loadCheckpoint(ContextImpl& context, std::istream& stream);
 private:
     CudaContext& cu;
+    CUstream downloadStream;
+    CUevent downloadEvent;
+    void* downloadBuffer;
+    std::vector<int> downloadOrder;
+    std::vector<int4> downloadCellOffsets;
+    Vec3 downloadBoxVectors[3];
+    CUfunction quantizeKernel;
+    CudaArray quantizedPositions;
+    CudaArray quantizedCellOffsets;
+    std::vector<int4> lastCellOffsets;
+    CUfunction wrapKernel;
+    CudaArray wrappedPositions;
+    CudaArray wrapMoleculeAtoms;
+    CudaArray wrapMoleculeStartIndex;
+    std::vector<int> wrapAtomOrder;
 };
 
 /**
@@ -614,6 +691,7 @@ class CudaCalcNonbondedForceKernel : public CalcNonbondedForceKernel {
 public:
     CudaCalcNonbondedForceKernel(std::string name, const Platform& platform, CudaContext& cu, const System& system) : CalcNonbondedForceKernel(name, platform),
             cu(cu), hasInitializedFFT(false), sigmaEpsilon(NULL), exceptionParams(NULL), cosSinSums(NULL), directPmeGrid(NULL), reciprocalPmeGrid(NULL),
+            ownsDirectPmeGrid(true), ownsReciprocalPmeGrid(true),
             pmeBsplineModuliX(NULL), pmeBsplineModuliY(NULL), pmeBsplineModuliZ(NULL), pmeDispersionBsplineModuliX(NULL), pmeDispersionBsplineModuliY(NULL),
             pmeDispersionBsplineModuliZ(NULL), pmeAtomRange(NULL), pmeAtomGridIndex(NULL), pmeEnergyBuffer(NULL), sort(NULL), dispersionFft(NULL), fft(NULL), pmeio(NULL) {
     }
@@ -639,10 +717,14 @@ public:
     /**
      * Copy changed parameters over to a context.
      *
-     * @param context    the context to copy parameters to
-     * @param force      the NonbondedForce to copy the parameters from
+     * @param context        the context to copy parameters to
+     * @param force          the NonbondedForce to copy the parameters from
+     * @param firstParticle  the index of the first particle whose parameters might have changed
+     * @param lastParticle   the index of the last particle whose parameters might have changed
+     * @param firstException the index of the first exception whose parameters might have changed
+     * @param lastException  the index of the last exception whose parameters might have changed
      */
-    void copyParametersToContext(ContextImpl& context, const NonbondedForce& force);
+    void copyParametersToContext(ContextImpl& context, const NonbondedForce& force, int firstParticle, int lastParticle, int firstException, int lastException);
     /**
      * Get the parameters being used for PME.
      * 
@@ -686,6 +768,7 @@ private:
     CudaArray* cosSinSums;
     CudaArray* directPmeGrid;
     CudaArray* reciprocalPmeGrid;
+    bool ownsDirectPmeGrid, ownsReciprocalPmeGrid;
     CudaArray* pmeBsplineModuliX;
     CudaArray* pmeBsplineModuliY;
     CudaArray* pmeBsplineModuliZ;
@@ -722,6 +805,7 @@ private:
     CUfunction pmeInterpolateDispersionForceKernel;
     std::vector<std::pair<int, int> > exceptionAtoms;
     double ewaldSelfEnergy, dispersionCoefficient, alpha, dispersionAlpha;
+    NonbondedForceImpl::LongRangeCorrectionData longRangeCorrectionData;
     int interpolateForceThreads;
     int gridSizeX, gridSizeY, gridSizeZ;
     int dispersionGridSizeX, dispersionGridSizeY, dispersionGridSizeZ;
@@ -777,6 +861,7 @@ private:
     std::vector<CudaArray*> tabulatedFunctions;
     double longRangeCoefficient;
     std::vector<double> longRangeCoefficientDerivs;
+    CustomNonbondedForceImpl::LongRangeCorrectionData longRangeCorrectionData;
     bool hasInitializedLongRangeCorrection, hasInitializedKernel;
     int numGroupThreadBlocks;
     CustomNonbondedForce* forceCopy;
@@ -926,6 +1011,14 @@ public:
      * @param force      the CustomExternalForce to copy the parameters from
      */
     void copyParametersToContext(ContextImpl& context, const CustomExternalForce& force);
+    /**
+     * Copy changed parameters for a subset of particles over to a context.
+     *
+     * @param context           the context to copy parameters to
+     * @param force             the CustomExternalForce to copy the parameters from
+     * @param changedParticles  the indices within the force of the particle terms whose parameters have changed
+     */
+    void copyParametersToContext(ContextImpl& context, const CustomExternalForce& force, const std::vector<int>& changedParticles);
 private:
     class ForceInfo;
     int numParticles;
@@ -1094,6 +1187,48 @@ private:
     const System& system;
 };
 
+/**
+ * This kernel is invoked by CustomCVForce to calculate the forces acting on the system and the energy of the system.
+ */
+class CudaCalcCustomCVForceKernel : public CalcCustomCVForceKernel {
+public:
+    CudaCalcCustomCVForceKernel(std::string name, const Platform& platform, CudaContext& cu) : CalcCustomCVForceKernel(name, platform),
+            cu(cu), addForcesKernel(NULL) {
+    }
+    /**
+     * Initialize the kernel.
+     *
+     * @param system        the System this kernel will be applied to
+     * @param force         the CustomCVForce this kernel will be used for
+     * @param innerContext  the context created by the CustomCVForce for computing collective variables
+     */
+    void initialize(const System& system, const CustomCVForce& force, ContextImpl& innerContext);
+    /**
+     * Execute the kernel to calculate the forces and/or energy.
+     *
+     * @param context        the context in which to execute this kernel
+     * @param innerContext   the context created by the CustomCVForce for computing collective variables
+     * @param includeForces  true if forces should be calculated
+     * @param includeEnergy  true if the energy should be calculated
+     * @return the potential energy due to the force
+     */
+    double execute(ContextImpl& context, ContextImpl& innerContext, bool includeForces, bool includeEnergy);
+    /**
+     * Copy state information to the inner context.
+     *
+     * @param context        the context in which to execute this kernel
+     * @param innerContext   the context created by the CustomCVForce for computing collective variables
+     */
+    void copyState(ContextImpl& context, ContextImpl& innerContext);
+private:
+    CudaContext& cu;
+    Lepton::ExpressionProgram energyExpression;
+    std::vector<Lepton::ExpressionProgram> variableDerivExpressions;
+    std::vector<std::string> variableNames, globalParameterNames;
+    CudaArray cvForces;
+    CUfunction addForcesKernel;
+};
+
 /**
  * This kernel is invoked by CustomManyParticleForce to calculate the forces acting on the system.
  */
@@ -1259,8 +1394,10 @@ public:
      */
     double computeKineticEnergy(ContextImpl& context, const VerletIntegrator& integrator);
 private:
+    void executeStepKernels(const VerletIntegrator& integrator);
     CudaContext& cu;
     CUfunction kernel1, kernel2;
+    double prevTol;
 };
 
 /**
@@ -1293,10 +1430,52 @@ public:
      */
     double computeKineticEnergy(ContextImpl& context, const LangevinIntegrator& integrator);
 private:
+    void executeStepKernels(const LangevinIntegrator& integrator, int randomIndex);
     CudaContext& cu;
-    double prevTemp, prevFriction, prevStepSize;
+    double prevTemp, prevFriction, prevStepSize, prevTol;
     CudaArray* params;
     CUfunction kernel1, kernel2;
+    std::map<int, char> sequenceKeys;
+};
+
+/**
+ * This kernel is invoked by LangevinMiddleIntegrator to take one time step.
+ */
+class CudaIntegrateLangevinMiddleStepKernel : public IntegrateLangevinMiddleStepKernel {
+public:
+    CudaIntegrateLangevinMiddleStepKernel(std::string name, const Platform& platform, CudaContext& cu) : IntegrateLangevinMiddleStepKernel(name, platform), cu(cu),
+            params(NULL), oldDelta(NULL) {
+    }
+    ~CudaIntegrateLangevinMiddleStepKernel();
+    /**
+     * Initialize the kernel, setting up the particle masses.
+     *
+     * @param system     the System this kernel will be applied to
+     * @param integrator the LangevinMiddleIntegrator this kernel will be used for
+     */
+    void initialize(const System& system, const LangevinMiddleIntegrator& integrator);
+    /**
+     * Execute the kernel.
+     *
+     * @param context    the context in which to execute this kernel
+     * @param integrator the LangevinMiddleIntegrator this kernel is being used for
+     */
+    void execute(ContextImpl& context, const LangevinMiddleIntegrator& integrator);
+    /**
+     * Compute the kinetic energy.
+     *
+     * @param context    the context in which to execute this kernel
+     * @param integrator the LangevinMiddleIntegrator this kernel is being used for
+     */
+    double computeKineticEnergy(ContextImpl& context, const LangevinMiddleIntegrator& integrator);
+private:
+    void executeStepKernels(const LangevinMiddleIntegrator& integrator, int randomIndex);
+    CudaContext& cu;
+    double prevTemp, prevFriction, prevStepSize, prevTol;
+    CudaArray* params;
+    CudaArray* oldDelta;
+    CUfunction kernel1, kernel2, kernel3;
+    std::map<int, char> sequenceKeys;
 };
 
 /**
@@ -1418,7 +1597,7 @@ class CudaIntegrateCustomStepKernel : public IntegrateCustomStepKernel {
 public:
     enum GlobalTargetType {DT, VARIABLE, PARAMETER};
     CudaIntegrateCustomStepKernel(std::string name, const Platform& platform, CudaContext& cu) : IntegrateCustomStepKernel(name, platform), cu(cu),
-            hasInitializedKernels(false), localValuesAreCurrent(false), globalValues(NULL), sumBuffer(NULL), summedValue(NULL), uniformRandoms(NULL),
+            hasInitializedKernels(false), deviceGlobalsAreCurrent(false), localValuesAreCurrent(false), localGlobalsAreCurrent(true), globalValues(NULL), sumBuffer(NULL), summedValue(NULL), uniformRandoms(NULL),
             randomSeed(NULL), perDofEnergyParamDerivs(NULL), perDofValues(NULL), needsEnergyParamDerivs(false) {
     }
     ~CudaIntegrateCustomStepKernel();
@@ -1492,12 +1671,14 @@ private:
     void recordGlobalValue(double value, GlobalTarget target, CustomIntegrator& integrator);
     void recordChangedParameters(ContextImpl& context);
     bool evaluateCondition(int step);
+    void createDeviceGlobalsKernel(int step, const std::string& computation, std::map<std::string, std::string>& defines);
+    void downloadGlobalValues() const;
     CudaContext& cu;
     double energy;
     float energyFloat;
     int numGlobalVariables;
     bool hasInitializedKernels, deviceValuesAreCurrent, deviceGlobalsAreCurrent, modifiesParameters, keNeedsForce, hasAnyConstraints, needsEnergyParamDerivs;
-    mutable bool localValuesAreCurrent;
+    mutable bool localValuesAreCurrent, localGlobalsAreCurrent;
     CudaArray* globalValues;
     CudaArray* sumBuffer;
     CudaArray* summedValue;
@@ -1514,7 +1695,7 @@ private:
     std::vector<float> localPerDofEnergyParamDerivsFloat;
     std::vector<double> localPerDofEnergyParamDerivsDouble;
     std::vector<float> globalValuesFloat;
-    std::vector<double> globalValuesDouble;
+    mutable std::vector<double> globalValuesDouble;
     std::vector<double> initialGlobalVariables;
     std::vector<std::vector<CUfunction> > kernels;
     std::vector<std::vector<std::vector<void*> > > kernelArgs;
@@ -1523,13 +1704,15 @@ private:
     std::vector<CustomIntegrator::ComputationType> stepType;
     std::vector<CustomIntegratorUtilities::Comparison> comparisons;
     std::vector<std::vector<Lepton::CompiledExpression> > globalExpressions;
-    CompiledExpressionSet expressionSet;
+    mutable CompiledExpressionSet expressionSet;
     std::vector<bool> needsGlobals;
     std::vector<bool> needsForces;
     std::vector<bool> needsEnergy;
     std::vector<bool> computeBothForceAndEnergy;
     std::vector<bool> invalidatesForces;
     std::vector<bool> merged;
+    std::vector<bool> mergedSum;
+    std::vector<bool> computeGlobalOnDevice;
     std::vector<int> forceGroupFlags;
     std::vector<int> blockEnd;
     std::vector<int> requiredGaussian;
@@ -1633,7 +1816,7 @@ private:
  */
 class CudaRemoveCMMotionKernel : public RemoveCMMotionKernel {
 public:
-    CudaRemoveCMMotionKernel(std::string name, const Platform& platform, CudaContext& cu) : RemoveCMMotionKernel(name, platform), cu(cu), cmMomentum(NULL) {
+    CudaRemoveCMMotionKernel(std::string name, const Platform& platform, CudaContext& cu) : RemoveCMMotionKernel(name, platform), cu(cu), cmMomentum(NULL), cmVelocity(NULL) {
     }
     ~CudaRemoveCMMotionKernel();
     /**
@@ -1652,8 +1835,10 @@ public:
 private:
     CudaContext& cu;
     int frequency;
+    bool hasMeasuredMomentum;
     CudaArray* cmMomentum;
-    CUfunction kernel1, kernel2;
+    CudaArray* cmVelocity;
+    CUfunction kernel1, kernel2, kernel3;
 };
 
 } // namespace OpenMM
@@ -154,6 +154,12 @@ public:
      * @param includeEnergy  whether to compute the potential energy
      */
     void computeInteractions(int forceGroups, bool includeForces, bool includeEnergy);
+    /**
+     * Get the number of interacting tiles the most recent neighbor list contained, or 0 if no
+     * neighbor list has been built.  This is a useful measure of how much spatial locality the
+     * current atom order has.
+     */
+    int getLastInteractionCount();
     /**
      * Check to see if the neighbor list arrays are large enough, and make them bigger if necessary.
      *
@@ -261,11 +267,19 @@ public:
     CUfunction createInteractionKernel(const std::string& source, std::vector<ParameterInfo>& params, std::vector<ParameterInfo>& arguments, bool useExclusions, bool isSymmetric, int groups, bool includeForces, bool includeEnergy);
     /**
      * Create the set of kernels that will be needed for a particular combination of force groups.
-     * 
+     *
      * @param groups    the set of force groups
      */
     void createKernelsForGroups(int groups);
 private:
+    /**
+     * Time the force kernel with one candidate thread block size, and once every candidate
+     * has been measured enough times, lock in the fastest one.  This is called in place of
+     * launching the default kernel, so each measurement does the real work for that step.
+     *
+     * @param forceGroups   the flags specifying which force groups to include
+     */
+    void tuneBlockSize(int forceGroups);
     class KernelSet;
     class BlockSortTrait;
     CudaContext& context;
@@ -284,12 +298,23 @@ private:
     CudaArray* sortedBlocks;
     CudaArray* sortedBlockCenter;
     CudaArray* sortedBlockBoundingBox;
+    CudaArray* superBlockCenter;
+    CudaArray* superBlockBoundingBox;
     CudaArray* oldPositions;
+    CudaArray* blockDisplacement;
     CudaArray* rebuildNeighborList;
     CudaSort* blockSorter;
     CUevent downloadCountEvent;
+    CUevent rebuildFlagEvent;
+    CUevent tuneStartEvent, tuneEndEvent;
     int* pinnedCountBuffer;
-    std::vector<void*> forceArgs, findBlockBoundsArgs, sortBoxDataArgs, findInteractingBlocksArgs;
+    int* pinnedRebuildBuffer;
+    std::vector<int> tuneCandidates;
+    std::vector<float> tuneTimes;
+    std::map<int, CUfunction> tuneKernels;
+    int tuneIndex, tuneCycles;
+    bool tuningComplete, tuneEventsPending;
+    std::vector<void*> forceArgs, findBlockBoundsArgs, sortBoxDataArgs, findSuperBlockBoundsArgs, checkRebuildArgs, findInteractingBlocksArgs;
     std::vector<std::vector<int> > atomExclusions;
     std::vector<ParameterInfo> parameters;
     std::vector<ParameterInfo> arguments;
@@ -313,6 +338,8 @@ public:
     CUfunction forceKernel, energyKernel, forceEnergyKernel;
     CUfunction findBlockBoundsKernel;
     CUfunction sortBoxDataKernel;
+    CUfunction findSuperBlockBoundsKernel;
+    CUfunction checkRebuildKernel;
     CUfunction findInteractingBlocksKernel;
     CUfunction findInteractionsWithinBlocksKernel;
 };
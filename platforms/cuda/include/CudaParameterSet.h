@@ -81,6 +81,15 @@ public:
      */
     template <class T>
     void setParameterValues(const std::vector<std::vector<T> >& values);
+    /**
+     * Set the values of the parameters for a contiguous range of objects, leaving all other
+     * objects unchanged.
+     *
+     * @param first  the index of the first object to set parameters for
+     * @param values values[i][j] contains the value of parameter j for object first+i
+     */
+    template <class T>
+    void setParameterValuesSubset(int first, const std::vector<std::vector<T> >& values);
     /**
      * Get a set of CudaNonbondedUtilities::ParameterInfo objects which describe the Buffers
      * containing the data.
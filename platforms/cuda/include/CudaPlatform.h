@@ -54,6 +54,18 @@ public:
     void setPropertyValue(Context& context, const std::string& property, const std::string& value) const;
     void contextCreated(ContextImpl& context, const std::map<std::string, std::string>& properties) const;
     void contextDestroyed(ContextImpl& context) const;
+    /**
+     * Exchange the particle state (positions, velocities, and periodic box vectors) of two
+     * Contexts created with this Platform from identical Systems.  The particle data is copied
+     * directly between the devices, using peer to peer transfers when the hardware supports
+     * them, which is much faster than exchanging States through host memory.  This is useful
+     * for algorithms like replica exchange that periodically swap whole configurations
+     * between Contexts.
+     *
+     * @param context1  the first Context
+     * @param context2  the second Context
+     */
+    void swapState(Context& context1, Context& context2) const;
     /**
      * This is the name of the parameter for selecting which CUDA device or devices to use.
      */
@@ -70,6 +82,8 @@ public:
     }
     /**
      * This is the name of the parameter for selecting whether CUDA should sync or spin loop while waiting for results.
+     * When it is "true" (the default), waits poll for a short, adaptively chosen time before blocking.  Set it to
+     * "false" to spin for the full duration of every wait.
      */
     static const std::string& CudaUseBlockingSync() {
         static const std::string key = "UseBlockingSync";
@@ -77,6 +91,9 @@ public:
     }
     /**
      * This is the name of the parameter for selecting what numerical precision to use.
+     * The allowed values are "single" (all calculations in single precision), "mixed"
+     * (forces computed in single precision, but integration done in double precision),
+     * and "double" (all calculations in double precision).
      */
     static const std::string& CudaPrecision() {
         static const std::string key = "Precision";
@@ -110,8 +127,17 @@ public:
         static const std::string key = "TempDirectory";
         return key;
     }
+    /**
+     * This is the name of the parameter for specifying the path to the directory in which to cache compiled kernels.
+     */
+    static const std::string& CudaKernelCacheDirectory() {
+        static const std::string key = "KernelCacheDirectory";
+        return key;
+    }
     /**
      * This is the name of the parameter for selecting whether to disable use of a separate stream for PME.
+     * By default the reciprocal space calculation is executed on its own stream and synchronized with the
+     * main stream by events, allowing it to overlap with the direct space calculation.
      */
     static const std::string& CudaDisablePmeStream() {
         static const std::string key = "DisablePmeStream";
@@ -124,20 +150,40 @@ public:
         static const std::string key = "DeterministicForces";
         return key;
     }
+    /**
+     * This is the name of the parameter for specifying a file to write kernel profiling data to.
+     * If it is not empty, every kernel launch is timed with events, and when the Context is
+     * destroyed the accumulated timings are written to the file in the chrome://tracing JSON
+     * format so they can be viewed in a browser.  Profiling adds overhead, so it should be
+     * enabled only when the data is wanted.
+     */
+    static const std::string& CudaProfilingFile() {
+        static const std::string key = "ProfilingFile";
+        return key;
+    }
+    /**
+     * This is the name of the parameter for querying how many bytes of device memory the
+     * Context has allocated.  It is computed at the time it is queried and cannot be set.
+     */
+    static const std::string& CudaDeviceMemoryUsage() {
+        static const std::string key = "DeviceMemoryUsage";
+        return key;
+    }
 };
 
 class OPENMM_EXPORT_CUDA CudaPlatform::PlatformData {
 public:
     PlatformData(ContextImpl* context, const System& system, const std::string& deviceIndexProperty, const std::string& blockingProperty, const std::string& precisionProperty,
-            const std::string& cpuPmeProperty, const std::string& compilerProperty, const std::string& tempProperty, const std::string& hostCompilerProperty,
-            const std::string& pmeStreamProperty, const std::string& deterministicForcesProperty, int numThreads);
+            const std::string& cpuPmeProperty, const std::string& compilerProperty, const std::string& tempProperty, const std::string& cacheProperty,
+            const std::string& hostCompilerProperty, const std::string& pmeStreamProperty, const std::string& deterministicForcesProperty,
+            const std::string& profilingFileProperty, int numThreads);
     ~PlatformData();
     void initializeContexts(const System& system);
     void syncContexts();
     ContextImpl* context;
     std::vector<CudaContext*> contexts;
     std::vector<double> contextEnergy;
-    bool hasInitializedContexts, removeCM, peerAccessSupported, useCpuPme, disablePmeStream, deterministicForces;
+    bool hasInitializedContexts, removeCM, peerAccessSupported, useCpuPme, disablePmeStream, deterministicForces, dedicatedPmeDevice;
     int cmMotionFrequency;
     int stepCount, computeForceCount;
     double time;
@@ -52,9 +52,14 @@ namespace OpenMM {
  *     const char* getSortKey() const {return "value";}
  * };
  *
- * The algorithm used is a bucket sort, followed by a bitonic sort within each bucket
- * (in local memory when possible, in global memory otherwise).  This is similar to
- * the algorithm described in
+ * When the sorting key is a type whose ordering can be mapped onto unsigned integers
+ * (int, unsigned int, float, or double), long lists are sorted with a least significant
+ * digit radix sort, which requires a fixed number of passes over the data regardless of
+ * the key distribution and therefore scales well to very large arrays.
+ *
+ * For other key types the algorithm used is a bucket sort, followed by a bitonic sort
+ * within each bucket (in local memory when possible, in global memory otherwise).  This
+ * is similar to the algorithm described in
  *
  * Shifu Chen, Jing Qin, Yongming Xie, Junping Zhao, and Pheng-Ann Heng.  "An Efficient
  * Sorting Algorithm with CUDA"  Journal of the Chinese Institute of Engineers, 32(7),
@@ -92,9 +97,13 @@ private:
     CudaArray* offsetInBucket;
     CudaArray* bucketOffset;
     CudaArray* buckets;
+    CudaArray* radixHistogram;
+    CudaArray* radixBuffer;
     CUfunction shortListKernel, computeRangeKernel, assignElementsKernel, computeBucketPositionsKernel, copyToBucketsKernel, sortBucketsKernel;
+    CUfunction computeRadixHistogramKernel, computeRadixOffsetsKernel, radixScatterKernel;
     unsigned int dataLength, rangeKernelSize, positionsKernelSize, sortKernelSize;
-    bool isShortList;
+    unsigned int radixBits, numKeyBits, radixBlockSize, radixTiles;
+    bool isShortList, useRadixSort;
 };
 
 /**
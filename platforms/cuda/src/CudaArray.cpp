@@ -32,25 +32,36 @@
 
 using namespace OpenMM;
 
-CudaArray::CudaArray(CudaContext& context, int size, int elementSize, const std::string& name) :
-        context(context), size(size), elementSize(elementSize), name(name), ownsMemory(true) {
-    CUresult result = cuMemAlloc(&pointer, size*elementSize);
-    if (result != CUDA_SUCCESS) {
-        std::stringstream str;
-        str<<"Error creating array "<<name<<": "<<CudaContext::getErrorString(result)<<" ("<<result<<")";
-        throw OpenMMException(str.str());
-    }
+CudaArray::CudaArray(CudaContext& context, int size, int elementSize, const std::string& name) : context(NULL), pointer(0) {
+    initialize(context, size, elementSize, name);
+}
+
+CudaArray::CudaArray() : context(NULL), pointer(0), size(0), elementSize(0), ownsMemory(false) {
 }
 
 CudaArray::~CudaArray() {
-    if (ownsMemory && context.getContextIsValid()) {
-        CUresult result = cuMemFree(pointer);
-        if (result != CUDA_SUCCESS) {
-            std::stringstream str;
-            str<<"Error deleting array "<<name<<": "<<CudaContext::getErrorString(result)<<" ("<<result<<")";
-            throw OpenMMException(str.str());
-        }
+    if (context != NULL && context->getContextIsValid()) {
+        context->unregisterArray(this);
+        if (ownsMemory)
+            context->releaseDeviceMemory(pointer, size*(size_t) elementSize);
+    }
+}
+
+void CudaArray::initialize(CudaContext& context, int size, int elementSize, const std::string& name) {
+    if (this->pointer != 0)
+        throw OpenMMException("CudaArray has already been initialized");
+    this->context = &context;
+    this->size = size;
+    this->elementSize = elementSize;
+    this->name = name;
+    ownsMemory = true;
+    try {
+        pointer = context.acquireDeviceMemory(size*(size_t) elementSize);
+    }
+    catch (OpenMMException& ex) {
+        throw OpenMMException("Error creating array "+name+": "+ex.what());
     }
+    context.registerArray(this);
 }
 
 void CudaArray::upload(const void* data, bool blocking) {
@@ -58,7 +69,22 @@ void CudaArray::upload(const void* data, bool blocking) {
     if (blocking)
         result = cuMemcpyHtoD(pointer, data, size*elementSize);
     else
-        result = cuMemcpyHtoDAsync(pointer, data, size*elementSize, context.getCurrentStream());
+        result = cuMemcpyHtoDAsync(pointer, data, size*elementSize, context->getCurrentStream());
+    if (result != CUDA_SUCCESS) {
+        std::stringstream str;
+        str<<"Error uploading array "<<name<<": "<<CudaContext::getErrorString(result)<<" ("<<result<<")";
+        throw OpenMMException(str.str());
+    }
+}
+
+void CudaArray::uploadSubArray(const void* data, int offset, int elements, bool blocking) {
+    if (offset < 0 || offset+elements > size)
+        throw OpenMMException("uploadSubArray: data exceeds range of array "+name);
+    CUresult result;
+    if (blocking)
+        result = cuMemcpyHtoD(pointer+offset*elementSize, data, elements*elementSize);
+    else
+        result = cuMemcpyHtoDAsync(pointer+offset*elementSize, data, elements*elementSize, context->getCurrentStream());
     if (result != CUDA_SUCCESS) {
         std::stringstream str;
         str<<"Error uploading array "<<name<<": "<<CudaContext::getErrorString(result)<<" ("<<result<<")";
@@ -71,7 +97,7 @@ void CudaArray::download(void* data, bool blocking) const {
     if (blocking)
         result = cuMemcpyDtoH(data, pointer, size*elementSize);
     else
-        result = cuMemcpyDtoHAsync(data, pointer, size*elementSize, context.getCurrentStream());
+        result = cuMemcpyDtoHAsync(data, pointer, size*elementSize, context->getCurrentStream());
     if (result != CUDA_SUCCESS) {
         std::stringstream str;
         str<<"Error downloading array "<<name<<": "<<CudaContext::getErrorString(result)<<" ("<<result<<")";
@@ -82,7 +108,7 @@ void CudaArray::download(void* data, bool blocking) const {
 void CudaArray::copyTo(CudaArray& dest) const {
     if (dest.getSize() != size || dest.getElementSize() != elementSize)
         throw OpenMMException("Error copying array "+name+" to "+dest.getName()+": The destination array does not match the size of the array");
-    CUresult result = cuMemcpyDtoDAsync(dest.getDevicePointer(), pointer, size*elementSize, context.getCurrentStream());
+    CUresult result = cuMemcpyDtoDAsync(dest.getDevicePointer(), pointer, size*elementSize, context->getCurrentStream());
     if (result != CUDA_SUCCESS) {
         std::stringstream str;
         str<<"Error copying array "<<name<<" to "<<dest.getName()<<": "<<CudaContext::getErrorString(result)<<" ("<<result<<")";
@@ -29,18 +29,29 @@
 #include "CudaKernelSources.h"
 #include "openmm/OpenMMException.h"
 #include "CudaNonbondedUtilities.h"
+#include <algorithm>
 #include <iostream>
 
 using namespace OpenMM;
 using namespace std;
 
-CudaBondedUtilities::CudaBondedUtilities(CudaContext& context) : context(context), numForceBuffers(0), maxBonds(0), allGroups(0), hasInitializedKernels(false) {
+CudaBondedUtilities::CudaBondedUtilities(CudaContext& context) : context(context), scratchBuffer(NULL), gatherStarts(NULL), gatherSlots(NULL),
+        numForceBuffers(0), maxBonds(0), allGroups(0), hasInitializedKernels(false) {
 }
 
 CudaBondedUtilities::~CudaBondedUtilities() {
     for (int i = 0; i < (int) atomIndices.size(); i++)
         for (int j = 0; j < (int) atomIndices[i].size(); j++)
             delete atomIndices[i][j];
+    for (int i = 0; i < (int) termOrder.size(); i++)
+        if (termOrder[i] != NULL)
+            delete termOrder[i];
+    if (scratchBuffer != NULL)
+        delete scratchBuffer;
+    if (gatherStarts != NULL)
+        delete gatherStarts;
+    if (gatherSlots != NULL)
+        delete gatherSlots;
 }
 
 void CudaBondedUtilities::addInteraction(const vector<vector<int> >& atoms, const string& source, int group) {
@@ -83,9 +94,41 @@ void CudaBondedUtilities::initialize(const System& system) {
     hasInteractions = (numForces > 0);
     if (!hasInteractions)
         return;
-    
+
+    // Sort the bonds of each force by the lowest atom index they involve.  Systems built from
+    // residue templates often add bonds in an order that scatters nearby atoms through the list,
+    // and sorting them makes the kernel's position loads much more local.  The per-bond parameters
+    // provided by the forces stay in their original order, so for each force whose bonds were not
+    // already sorted, a permutation is uploaded and the kernel looks up parameters through it.
+
+    vector<vector<int> > order(numForces);
+    termOrder.resize(numForces, (CudaArray*) NULL);
+    for (int i = 0; i < numForces; i++) {
+        int numBonds = forceAtoms[i].size();
+        int numAtoms = forceAtoms[i][0].size();
+        vector<pair<int, int> > sortedBonds(numBonds);
+        for (int bond = 0; bond < numBonds; bond++) {
+            int minAtom = forceAtoms[i][bond][0];
+            for (int atom = 1; atom < numAtoms; atom++)
+                minAtom = min(minAtom, forceAtoms[i][bond][atom]);
+            sortedBonds[bond] = make_pair(minAtom, bond);
+        }
+        sort(sortedBonds.begin(), sortedBonds.end());
+        order[i].resize(numBonds);
+        bool alreadySorted = true;
+        for (int bond = 0; bond < numBonds; bond++) {
+            order[i][bond] = sortedBonds[bond].second;
+            if (order[i][bond] != bond)
+                alreadySorted = false;
+        }
+        if (!alreadySorted) {
+            termOrder[i] = CudaArray::create<int>(context, numBonds, "bondedTermOrder");
+            termOrder[i]->upload(order[i]);
+        }
+    }
+
     // Build the lists of atom indices.
-    
+
     atomIndices.resize(numForces);
     for (int i = 0; i < numForces; i++) {
         int numBonds = forceAtoms[i].size();
@@ -97,7 +140,7 @@ void CudaBondedUtilities::initialize(const System& system) {
             vector<unsigned int> indexVec(paddedWidth*numBonds);
             for (int bond = 0; bond < numBonds; bond++) {
                 for (int atom = 0; atom < width; atom++)
-                    indexVec[bond*paddedWidth+atom] = forceAtoms[i][bond][startAtom+atom];
+                    indexVec[bond*paddedWidth+atom] = forceAtoms[i][order[i][bond]][startAtom+atom];
             }
             CudaArray* indices = new CudaArray(context, numBonds, 4*paddedWidth, "bondedIndices");
             indices->upload(&indexVec[0]);
@@ -106,57 +149,126 @@ void CudaBondedUtilities::initialize(const System& system) {
         }
     }
 
-    // Create the kernel.
+    // Build the data structures used for accumulating forces.  Each bonded term writes the
+    // forces it computes to its own set of slots in a scratch buffer, and a second kernel then
+    // sums the slots belonging to each atom.  That avoids atomic operations, which serialize
+    // when many terms involve the same atom.
 
-    stringstream s;
-    s<<CudaKernelSources::vectorOps;
-    for (int i = 0; i < (int) prefixCode.size(); i++)
-        s<<prefixCode[i];
-    s<<"extern \"C\" __global__ void computeBondedForces(unsigned long long* __restrict__ forceBuffer, mixed* __restrict__ energyBuffer, const real4* __restrict__ posq, int groups, real4 periodicBoxSize, real4 invPeriodicBoxSize, real4 periodicBoxVecX, real4 periodicBoxVecY, real4 periodicBoxVecZ";
+    int numScratchSlots = 0;
+    scratchOffsets.resize(numForces);
+    for (int i = 0; i < numForces; i++) {
+        scratchOffsets[i] = numScratchSlots;
+        numScratchSlots += forceAtoms[i].size()*forceAtoms[i][0].size();
+    }
+    int numRealAtoms = system.getNumParticles();
+    vector<vector<int> > atomSlots(numRealAtoms);
+    for (int i = 0; i < numForces; i++) {
+        int atomsPerBond = forceAtoms[i][0].size();
+        for (int bond = 0; bond < (int) forceAtoms[i].size(); bond++)
+            for (int atom = 0; atom < atomsPerBond; atom++)
+                atomSlots[forceAtoms[i][order[i][bond]][atom]].push_back(scratchOffsets[i]+bond*atomsPerBond+atom);
+    }
+    vector<int> starts(numRealAtoms+1);
+    vector<int> slots;
+    for (int i = 0; i < numRealAtoms; i++) {
+        starts[i] = slots.size();
+        slots.insert(slots.end(), atomSlots[i].begin(), atomSlots[i].end());
+    }
+    starts[numRealAtoms] = slots.size();
+    int elementSize = (context.getUseDoublePrecision() ? sizeof(double) : sizeof(float));
+    scratchBuffer = new CudaArray(context, numScratchSlots, 4*elementSize, "bondedScratch");
+    gatherStarts = CudaArray::create<int>(context, numRealAtoms+1, "bondedGatherStarts");
+    gatherSlots = CudaArray::create<int>(context, max(1, (int) slots.size()), "bondedGatherSlots");
+    gatherStarts->upload(starts);
+    if (slots.size() > 0)
+        gatherSlots->upload(slots);
+
+    // Create the kernels.  In addition to the standard one, a second variant is created that
+    // computes only the energy, so the force accumulation can be skipped when the forces are
+    // not needed.
+
+    stringstream args;
+    args<<"unsigned long long* __restrict__ forceBuffer, real4* __restrict__ scratchBuffer, mixed* __restrict__ energyBuffer, const real4* __restrict__ posq, int groups, real4 periodicBoxSize, real4 invPeriodicBoxSize, real4 periodicBoxVecX, real4 periodicBoxVecY, real4 periodicBoxVecZ";
     for (int force = 0; force < numForces; force++) {
         for (int i = 0; i < (int) atomIndices[force].size(); i++) {
             int indexWidth = atomIndices[force][i]->getElementSize()/4;
             string indexType = "uint"+context.intToString(indexWidth);
-            s<<", const "<<indexType<<"* __restrict__ atomIndices"<<force<<"_"<<i;
+            args<<", const "<<indexType<<"* __restrict__ atomIndices"<<force<<"_"<<i;
         }
+        if (termOrder[force] != NULL)
+            args<<", const int* __restrict__ termOrder"<<force;
     }
     for (int i = 0; i < (int) arguments.size(); i++)
-        s<<", "<<argTypes[i]<<"* customArg"<<(i+1);
+        args<<", const "<<argTypes[i]<<"* __restrict__ customArg"<<(i+1);
     if (energyParameterDerivatives.size() > 0)
-        s<<", mixed* __restrict__ energyParamDerivs";
-    s<<") {\n";
-    s<<"mixed energy = 0;\n";
-    for (int i = 0; i < energyParameterDerivatives.size(); i++)
-        s<<"mixed energyParamDeriv"<<i<<" = 0;\n";
-    for (int force = 0; force < numForces; force++)
-        s<<createForceSource(force, forceAtoms[force].size(), forceAtoms[force][0].size(), forceGroup[force], forceSource[force]);
-    s<<"energyBuffer[blockIdx.x*blockDim.x+threadIdx.x] += energy;\n";
+        args<<", mixed* __restrict__ energyParamDerivs";
+    stringstream s;
+    s<<CudaKernelSources::vectorOps;
+    for (int i = 0; i < (int) prefixCode.size(); i++)
+        s<<prefixCode[i];
     const vector<string>& allParamDerivNames = context.getEnergyParamDerivNames();
     int numDerivs = allParamDerivNames.size();
-    for (int i = 0; i < energyParameterDerivatives.size(); i++)
-        for (int index = 0; index < numDerivs; index++)
-            if (allParamDerivNames[index] == energyParameterDerivatives[i])
-                s<<"energyParamDerivs[(blockIdx.x*blockDim.x+threadIdx.x)*"<<numDerivs<<"+"<<index<<"] += energyParamDeriv"<<i<<";\n";
+    for (int variant = 0; variant < 2; variant++) {
+        bool includeForces = (variant == 0);
+        s<<"extern \"C\" __global__ void "<<(includeForces ? "computeBondedForces" : "computeBondedEnergy")<<"("<<args.str();
+        s<<") {\n";
+        s<<"mixed energy = 0;\n";
+        for (int i = 0; i < energyParameterDerivatives.size(); i++)
+            s<<"mixed energyParamDeriv"<<i<<" = 0;\n";
+        for (int force = 0; force < numForces; force++)
+            s<<createForceSource(force, forceAtoms[force].size(), forceAtoms[force][0].size(), forceGroup[force], forceSource[force], includeForces);
+        s<<"energyBuffer[blockIdx.x*blockDim.x+threadIdx.x] += energy;\n";
+        for (int i = 0; i < energyParameterDerivatives.size(); i++)
+            for (int index = 0; index < numDerivs; index++)
+                if (allParamDerivNames[index] == energyParameterDerivatives[i])
+                    s<<"energyParamDerivs[(blockIdx.x*blockDim.x+threadIdx.x)*"<<numDerivs<<"+"<<index<<"] += energyParamDeriv"<<i<<";\n";
+        s<<"}\n";
+    }
+
+    // Create the kernel that sums each atom's slots of the scratch buffer into the force buffer.
+    // Every slot is written by exactly one thread of the main kernel and every atom is summed by
+    // exactly one thread of this one, so neither kernel needs atomic operations.
+
+    s<<"extern \"C\" __global__ void gatherBondedForces(unsigned long long* __restrict__ forceBuffer, const real4* __restrict__ scratchBuffer, const int* __restrict__ gatherStarts, const int* __restrict__ gatherSlots) {\n";
+    s<<"for (unsigned int atom = blockIdx.x*blockDim.x+threadIdx.x; atom < NUM_ATOMS; atom += blockDim.x*gridDim.x) {\n";
+    s<<"    int start = gatherStarts[atom];\n";
+    s<<"    int end = gatherStarts[atom+1];\n";
+    s<<"    if (start == end)\n";
+    s<<"        continue;\n";
+    s<<"    real3 sum = make_real3(0);\n";
+    s<<"    for (int i = start; i < end; i++) {\n";
+    s<<"        real4 f = scratchBuffer[gatherSlots[i]];\n";
+    s<<"        sum.x += f.x;\n";
+    s<<"        sum.y += f.y;\n";
+    s<<"        sum.z += f.z;\n";
+    s<<"    }\n";
+    s<<"    forceBuffer[atom] += static_cast<unsigned long long>((long long) (sum.x*0x100000000));\n";
+    s<<"    forceBuffer[atom+PADDED_NUM_ATOMS] += static_cast<unsigned long long>((long long) (sum.y*0x100000000));\n";
+    s<<"    forceBuffer[atom+PADDED_NUM_ATOMS*2] += static_cast<unsigned long long>((long long) (sum.z*0x100000000));\n";
+    s<<"}\n";
     s<<"}\n";
     map<string, string> defines;
     defines["PADDED_NUM_ATOMS"] = context.intToString(context.getPaddedNumAtoms());
+    defines["NUM_ATOMS"] = context.intToString(numRealAtoms);
     CUmodule module = context.createModule(s.str(), defines);
     kernel = context.getKernel(module, "computeBondedForces");
+    energyKernel = context.getKernel(module, "computeBondedEnergy");
+    gatherKernel = context.getKernel(module, "gatherBondedForces");
     forceAtoms.clear();
     forceSource.clear();
 }
 
-string CudaBondedUtilities::createForceSource(int forceIndex, int numBonds, int numAtoms, int group, const string& computeForce) {
+string CudaBondedUtilities::createForceSource(int forceIndex, int numBonds, int numAtoms, int group, const string& computeForce, bool includeForces) {
     maxBonds = max(maxBonds, numBonds);
     string suffix[] = {".x", ".y", ".z", ".w"};
     stringstream s;
     s<<"if ((groups&"<<(1<<group)<<") != 0)\n";
-    s<<"for (unsigned int index = blockIdx.x*blockDim.x+threadIdx.x; index < "<<numBonds<<"; index += blockDim.x*gridDim.x) {\n";
+    s<<"for (unsigned int bondIndex = blockIdx.x*blockDim.x+threadIdx.x; bondIndex < "<<numBonds<<"; bondIndex += blockDim.x*gridDim.x) {\n";
     int startAtom = 0;
     for (int i = 0; i < (int) atomIndices[forceIndex].size(); i++) {
         int indexWidth = atomIndices[forceIndex][i]->getElementSize()/4;
         string indexType = "uint"+context.intToString(indexWidth);
-        s<<"    "<<indexType<<" atoms"<<i<<" = atomIndices"<<forceIndex<<"_"<<i<<"[index];\n";
+        s<<"    "<<indexType<<" atoms"<<i<<" = atomIndices"<<forceIndex<<"_"<<i<<"[bondIndex];\n";
         int atomsToLoad = min(indexWidth, numAtoms-startAtom);
         for (int j = 0; j < atomsToLoad; j++) {
             s<<"    unsigned int atom"<<(startAtom+j+1)<<" = atoms"<<i<<suffix[j]<<";\n";
@@ -164,23 +276,28 @@ string CudaBondedUtilities::createForceSource(int forceIndex, int numBonds, int
         }
         startAtom += indexWidth;
     }
+    if (termOrder[forceIndex] != NULL)
+        s<<"    unsigned int index = termOrder"<<forceIndex<<"[bondIndex];\n";
+    else
+        s<<"    unsigned int index = bondIndex;\n";
     s<<computeForce<<"\n";
-    for (int i = 0; i < numAtoms; i++) {
-        s<<"    atomicAdd(&forceBuffer[atom"<<(i+1)<<"], static_cast<unsigned long long>((long long) (force"<<(i+1)<<".x*0x100000000)));\n";
-        s<<"    atomicAdd(&forceBuffer[atom"<<(i+1)<<"+PADDED_NUM_ATOMS], static_cast<unsigned long long>((long long) (force"<<(i+1)<<".y*0x100000000)));\n";
-        s<<"    atomicAdd(&forceBuffer[atom"<<(i+1)<<"+PADDED_NUM_ATOMS*2], static_cast<unsigned long long>((long long) (force"<<(i+1)<<".z*0x100000000)));\n";
-        s<<"    __threadfence_block();\n";
+    if (includeForces) {
+        for (int i = 0; i < numAtoms; i++)
+            s<<"    scratchBuffer["<<scratchOffsets[forceIndex]<<"+bondIndex*"<<numAtoms<<"+"<<i<<"] = make_real4(force"<<(i+1)<<".x, force"<<(i+1)<<".y, force"<<(i+1)<<".z, 0);\n";
     }
     s<<"}\n";
     return s.str();
 }
 
-void CudaBondedUtilities::computeInteractions(int groups) {
+void CudaBondedUtilities::computeInteractions(int groups, bool includeForces, bool includeEnergy) {
     if ((groups&allGroups) == 0)
         return;
+    if (!includeForces && !includeEnergy)
+        return;
     if (!hasInitializedKernels) {
         hasInitializedKernels = true;
         kernelArgs.push_back(&context.getForce().getDevicePointer());
+        kernelArgs.push_back(&scratchBuffer->getDevicePointer());
         kernelArgs.push_back(&context.getEnergyBuffer().getDevicePointer());
         kernelArgs.push_back(&context.getPosq().getDevicePointer());
         kernelArgs.push_back(NULL);
@@ -189,16 +306,31 @@ void CudaBondedUtilities::computeInteractions(int groups) {
         kernelArgs.push_back(context.getPeriodicBoxVecXPointer());
         kernelArgs.push_back(context.getPeriodicBoxVecYPointer());
         kernelArgs.push_back(context.getPeriodicBoxVecZPointer());
-        for (int i = 0; i < (int) atomIndices.size(); i++)
+        for (int i = 0; i < (int) atomIndices.size(); i++) {
             for (int j = 0; j < (int) atomIndices[i].size(); j++)
                 kernelArgs.push_back(&atomIndices[i][j]->getDevicePointer());
+            if (termOrder[i] != NULL)
+                kernelArgs.push_back(&termOrder[i]->getDevicePointer());
+        }
         for (int i = 0; i < (int) arguments.size(); i++)
             kernelArgs.push_back(&arguments[i]);
         if (energyParameterDerivatives.size() > 0)
             kernelArgs.push_back(&context.getEnergyParamDerivBuffer().getDevicePointer());
+        gatherArgs.push_back(&context.getForce().getDevicePointer());
+        gatherArgs.push_back(&scratchBuffer->getDevicePointer());
+        gatherArgs.push_back(&gatherStarts->getDevicePointer());
+        gatherArgs.push_back(&gatherSlots->getDevicePointer());
     }
     if (!hasInteractions)
         return;
-    kernelArgs[3] = &groups;
-    context.executeKernel(kernel, &kernelArgs[0], maxBonds);
+    kernelArgs[4] = &groups;
+    if (includeForces && (groups&allGroups) != allGroups) {
+        // Some groups are excluded, so their slots of the scratch buffer will not be written.
+        // Clear it so the gather kernel does not pick up stale values.
+
+        context.clearBuffer(*scratchBuffer);
+    }
+    context.executeKernel(includeForces ? kernel : energyKernel, &kernelArgs[0], maxBonds);
+    if (includeForces)
+        context.executeKernel(gatherKernel, &gatherArgs[0], context.getNumAtoms());
 }
@@ -37,7 +37,6 @@
 #include "CudaKernelSources.h"
 #include "CudaNonbondedUtilities.h"
 #include "SHA1.h"
-#include "hilbert.h"
 #include "openmm/OpenMMException.h"
 #include "openmm/Platform.h"
 #include "openmm/System.h"
@@ -47,6 +46,7 @@
 #include <algorithm>
 #include <cstdlib>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <set>
@@ -105,10 +105,34 @@ static int executeInWindows(const string &command) {
 }
 #endif
 
+/**
+ * Get the current clock time, measured in microseconds.
+ */
+#ifdef _MSC_VER
+    #include <Windows.h>
+    static long long getTime() {
+        FILETIME ft;
+        GetSystemTimeAsFileTime(&ft); // 100-nanoseconds since 1-1-1601
+        ULARGE_INTEGER result;
+        result.LowPart = ft.dwLowDateTime;
+        result.HighPart = ft.dwHighDateTime;
+        return result.QuadPart/10;
+    }
+#else
+    #include <sys/time.h>
+    static long long getTime() {
+        struct timeval tod;
+        gettimeofday(&tod, 0);
+        return 1000000*tod.tv_sec+tod.tv_usec;
+    }
+#endif
+
 CudaContext::CudaContext(const System& system, int deviceIndex, bool useBlockingSync, const string& precision, const string& compiler,
-        const string& tempDir, const std::string& hostCompiler, CudaPlatform::PlatformData& platformData) : system(system), currentStream(0),
-        time(0.0), platformData(platformData), stepCount(0), computeForceCount(0), stepsSinceReorder(99999), contextIsValid(false), atomsWereReordered(false), hasCompilerKernel(false), isNvccAvailable(false),
-        pinnedBuffer(NULL), posq(NULL), posqCorrection(NULL), velm(NULL), force(NULL), energyBuffer(NULL), energyParamDerivBuffer(NULL), atomIndexDevice(NULL), chargeBuffer(NULL),
+        const string& tempDir, const string& cacheDir, const std::string& hostCompiler, const string& profilingFile,
+        CudaPlatform::PlatformData& platformData) : system(system), currentStream(0),
+        profileKernels(!profilingFile.empty()), profilingFile(profilingFile), profileStartEvent(NULL),
+        time(0.0), platformData(platformData), stepCount(0), computeForceCount(0), stepsSinceReorder(99999), interactionsAfterReorder(-1), eventWaitEstimate(0), useBlockingSync(useBlockingSync), contextIsValid(false), atomsWereReordered(false), hasCompilerKernel(false), useCompilerKernel(false), isNvccAvailable(false),
+        pinnedBuffer(NULL), pinnedBufferSize(0), allocatedDeviceMemory(0), posq(NULL), posqCorrection(NULL), velm(NULL), force(NULL), energyBuffer(NULL), energyPartialSums(NULL), energySum(NULL), energyParamDerivBuffer(NULL), atomIndexDevice(NULL), chargeBuffer(NULL),
         integration(NULL), expression(NULL), bonded(NULL), nonbonded(NULL), thread(NULL) {
     // Determine what compiler to use.
     
@@ -122,26 +146,31 @@ CudaContext::CudaContext(const System& system, int deviceIndex, bool useBlocking
             // The runtime compiler plugin isn't available.
         }
     }
+    int cudaDriverVersion;
+    cuDriverGetVersion(&cudaDriverVersion);
+    useCompilerKernel = (hasCompilerKernel && cudaDriverVersion >= 8000);
+    if (!useCompilerKernel) {
+        // Compiling in-process isn't possible, so check whether nvcc is available.
+
 #ifdef WIN32
-    string testCompilerCommand = this->compiler+" --version > nul 2> nul";
-    int res = executeInWindows(testCompilerCommand.c_str());
+        string testCompilerCommand = this->compiler+" --version > nul 2> nul";
+        int res = executeInWindows(testCompilerCommand.c_str());
 #else
-    string testCompilerCommand = this->compiler+" --version > /dev/null 2> /dev/null";
-    int res = std::system(testCompilerCommand.c_str());
+        string testCompilerCommand = this->compiler+" --version > /dev/null 2> /dev/null";
+        int res = std::system(testCompilerCommand.c_str());
 #endif
-    struct stat info;
-    isNvccAvailable = (res == 0 && stat(tempDir.c_str(), &info) == 0);
-    int cudaDriverVersion;
-    cuDriverGetVersion(&cudaDriverVersion);
-    static bool hasShownNvccWarning = false;
-    if (hasCompilerKernel && !isNvccAvailable && !hasShownNvccWarning && cudaDriverVersion < 8000) {
-        hasShownNvccWarning = true;
-        printf("Could not find nvcc.  Using runtime compiler, which may produce slower performance.  ");
+        struct stat info;
+        isNvccAvailable = (res == 0 && stat(tempDir.c_str(), &info) == 0);
+        static bool hasShownNvccWarning = false;
+        if (hasCompilerKernel && !isNvccAvailable && !hasShownNvccWarning) {
+            hasShownNvccWarning = true;
+            printf("Could not find nvcc.  Using runtime compiler, which may produce slower performance.  ");
 #ifdef WIN32
-        printf("Set CUDA_BIN_PATH to specify where nvcc is located.\n");
+            printf("Set CUDA_BIN_PATH to specify where nvcc is located.\n");
 #else
-        printf("Set OPENMM_CUDA_COMPILER to specify where nvcc is located.\n");
+            printf("Set OPENMM_CUDA_COMPILER to specify where nvcc is located.\n");
 #endif
+        }
     }
     if (hostCompiler.size() > 0)
         this->compiler = compiler+" --compiler-bindir "+hostCompiler;
@@ -163,14 +192,17 @@ CudaContext::CudaContext(const System& system, int deviceIndex, bool useBlocking
     }
     else
         throw OpenMMException("Illegal value for Precision: "+precision);
-    char* cacheVariable = getenv("OPENMM_CACHE_DIR");
-    cacheDir = (cacheVariable == NULL ? tempDir : string(cacheVariable));
+#if CUDA_VERSION >= 10010
+    capturingSequence = false;
+    captureSequenceId = NULL;
+    captureStream = NULL;
+#endif
 #ifdef WIN32
     this->tempDir = tempDir+"\\";
-    cacheDir = cacheDir+"\\";
+    this->cacheDir = cacheDir+"\\";
 #else
     this->tempDir = tempDir+"/";
-    cacheDir = cacheDir+"/";
+    this->cacheDir = cacheDir+"/";
 #endif
     contextIndex = platformData.contexts.size();
     int numDevices;
@@ -232,14 +264,17 @@ CudaContext::CudaContext(const System& system, int deviceIndex, bool useBlocking
 
     contextIsValid = true;
     CHECK_RESULT(cuCtxSetCacheConfig(CU_FUNC_CACHE_PREFER_SHARED));
-    if (contextIndex > 0) {
+    // Enable peer access between this context and all earlier ones, so forces can be copied
+    // directly between any pair of devices during the tree reduction.
+
+    for (int i = 0; i < contextIndex; i++) {
         int canAccess;
-        cuDeviceCanAccessPeer(&canAccess, getDevice(), platformData.contexts[0]->getDevice());
+        cuDeviceCanAccessPeer(&canAccess, getDevice(), platformData.contexts[i]->getDevice());
         if (canAccess) {
-            platformData.contexts[0]->setAsCurrent();
+            platformData.contexts[i]->setAsCurrent();
             CHECK_RESULT(cuCtxEnablePeerAccess(getContext(), 0));
             setAsCurrent();
-            CHECK_RESULT(cuCtxEnablePeerAccess(platformData.contexts[0]->getContext(), 0));
+            CHECK_RESULT(cuCtxEnablePeerAccess(platformData.contexts[i]->getContext(), 0));
         }
     }
     numAtoms = system.getNumParticles();
@@ -285,7 +320,9 @@ CudaContext::CudaContext(const System& system, int deviceIndex, bool useBlocking
 
     // Create utility kernels that are used in multiple places.
 
-    CUmodule utilities = createModule(CudaKernelSources::vectorOps+CudaKernelSources::utilities);
+    map<string, string> utilityDefines;
+    utilityDefines["WORK_GROUP_SIZE"] = intToString(ThreadBlockSize);
+    CUmodule utilities = createModule(CudaKernelSources::vectorOps+CudaKernelSources::utilities, utilityDefines);
     clearBufferKernel = getKernel(utilities, "clearBuffer");
     clearTwoBuffersKernel = getKernel(utilities, "clearTwoBuffers");
     clearThreeBuffersKernel = getKernel(utilities, "clearThreeBuffers");
@@ -293,6 +330,7 @@ CudaContext::CudaContext(const System& system, int deviceIndex, bool useBlocking
     clearFiveBuffersKernel = getKernel(utilities, "clearFiveBuffers");
     clearSixBuffersKernel = getKernel(utilities, "clearSixBuffers");
     setChargesKernel = getKernel(utilities, "setCharges");
+    reduceEnergyKernel = getKernel(utilities, "reduceEnergyBuffer");
 
     // Set defines based on the requested precision.
 
@@ -405,6 +443,10 @@ CudaContext::~CudaContext() {
         delete force;
     if (energyBuffer != NULL)
         delete energyBuffer;
+    if (energyPartialSums != NULL)
+        delete energyPartialSums;
+    if (energySum != NULL)
+        delete energySum;
     if (energyParamDerivBuffer != NULL)
         delete energyParamDerivBuffer;
     if (atomIndexDevice != NULL)
@@ -423,31 +465,109 @@ CudaContext::~CudaContext() {
         delete thread;
     string errorMessage = "Error deleting Context";
     if (contextIsValid) {
+        if (profileKernels) {
+            flushProfileEvents();
+            if (profileTrace.size() > 0)
+                profileTrace.erase(profileTrace.size()-1); // Remove the trailing comma.
+            ofstream out(profilingFile.c_str());
+            out<<"{\"traceEvents\":["<<profileTrace<<"]}"<<endl;
+            if (profileStartEvent != NULL)
+                cuEventDestroy(profileStartEvent);
+            for (auto& events : profileEventPool) {
+                cuEventDestroy(events.first);
+                cuEventDestroy(events.second);
+            }
+        }
+        for (auto& entry : pooledDeviceMemory)
+            for (CUdeviceptr pointer : entry.second)
+                cuMemFree(pointer);
+        invalidateCapturedSequences();
+#if CUDA_VERSION >= 10010
+        if (captureStream != NULL)
+            cuStreamDestroy(captureStream);
+#endif
         cuProfilerStop();
         CHECK_RESULT(cuCtxDestroy(context));
     }
     contextIsValid = false;
 }
 
+CUdeviceptr CudaContext::acquireDeviceMemory(size_t size) {
+    map<size_t, vector<CUdeviceptr> >::iterator pool = pooledDeviceMemory.find(size);
+    if (pool != pooledDeviceMemory.end() && pool->second.size() > 0) {
+        CUdeviceptr pointer = pool->second.back();
+        pool->second.pop_back();
+        return pointer;
+    }
+    CUdeviceptr pointer;
+    CUresult result = cuMemAlloc(&pointer, size);
+    if (result != CUDA_SUCCESS) {
+        std::stringstream str;
+        str<<"Error allocating device memory: "<<getErrorString(result)<<" ("<<result<<")";
+        throw OpenMMException(str.str());
+    }
+    allocatedDeviceMemory += size;
+    return pointer;
+}
+
+void CudaContext::releaseDeviceMemory(CUdeviceptr pointer, size_t size) {
+    pooledDeviceMemory[size].push_back(pointer);
+}
+
+void CudaContext::getDeviceMemoryUsage(map<string, size_t>& usage) const {
+    usage.clear();
+    for (CudaArray* array : registeredArrays)
+        usage[array->getName()] += array->getSize()*(size_t) array->getElementSize();
+}
+
+void CudaContext::registerArray(CudaArray* array) {
+    registeredArrays.insert(array);
+}
+
+void CudaContext::unregisterArray(CudaArray* array) {
+    registeredArrays.erase(array);
+}
+
+void* CudaContext::getPinnedBuffer(size_t size) {
+    if (size > pinnedBufferSize) {
+        string errorMessage = "Error allocating pinned buffer";
+        if (pinnedBuffer != NULL) {
+            // Make sure no transfer that uses the existing buffer is still in flight.
+
+            cuCtxSynchronize();
+            cuMemFreeHost(pinnedBuffer);
+        }
+        CHECK_RESULT(cuMemHostAlloc(&pinnedBuffer, size, 0));
+        pinnedBufferSize = size;
+    }
+    return pinnedBuffer;
+}
+
 void CudaContext::initialize() {
     cuCtxSetCurrent(context);
     string errorMessage = "Error initializing Context";
     int numEnergyBuffers = max(numThreadBlocks*ThreadBlockSize, nonbonded->getNumEnergyBuffers());
     if (useDoublePrecision) {
         energyBuffer = CudaArray::create<double>(*this, numEnergyBuffers, "energyBuffer");
-        int pinnedBufferSize = max(paddedNumAtoms*4, numEnergyBuffers);
-        CHECK_RESULT(cuMemHostAlloc(&pinnedBuffer, pinnedBufferSize*sizeof(double), 0));
+        pinnedBufferSize = max(paddedNumAtoms*4, numEnergyBuffers)*sizeof(double);
     }
     else if (useMixedPrecision) {
         energyBuffer = CudaArray::create<double>(*this, numEnergyBuffers, "energyBuffer");
-        int pinnedBufferSize = max(paddedNumAtoms*4, numEnergyBuffers);
-        CHECK_RESULT(cuMemHostAlloc(&pinnedBuffer, pinnedBufferSize*sizeof(double), 0));
+        pinnedBufferSize = max(paddedNumAtoms*4, numEnergyBuffers)*sizeof(double);
     }
     else {
         energyBuffer = CudaArray::create<float>(*this, numEnergyBuffers, "energyBuffer");
-        int pinnedBufferSize = max(paddedNumAtoms*6, numEnergyBuffers);
-        CHECK_RESULT(cuMemHostAlloc(&pinnedBuffer, pinnedBufferSize*sizeof(float), 0));
+        pinnedBufferSize = max(paddedNumAtoms*6, numEnergyBuffers)*sizeof(float);
+    }
+    if (useDoublePrecision || useMixedPrecision) {
+        energyPartialSums = CudaArray::create<double>(*this, numThreadBlocks, "energyPartialSums");
+        energySum = CudaArray::create<double>(*this, 1, "energySum");
+    }
+    else {
+        energyPartialSums = CudaArray::create<float>(*this, numThreadBlocks, "energyPartialSums");
+        energySum = CudaArray::create<float>(*this, 1, "energySum");
     }
+    CHECK_RESULT(cuMemHostAlloc(&pinnedBuffer, pinnedBufferSize, 0));
     for (int i = 0; i < numAtoms; i++) {
         double mass = system.getParticleMass(i);
         if (useDoublePrecision || useMixedPrecision)
@@ -588,6 +708,28 @@ CUmodule CudaContext::createModule(const string source, const map<string, string
     if (cuModuleLoad(&module, cacheFile.str().c_str()) == CUDA_SUCCESS)
         return module;
 
+    // If the runtime compiler plugin is available, compile in-process: no temporary
+    // files and no subprocesses.
+
+    if (useCompilerKernel || (hasCompilerKernel && !isNvccAvailable)) {
+        string ptx = compilerKernel.getAs<CudaCompilerKernel>().createModule(src.str(), "-arch=compute_"+gpuArchitecture+" "+options, *this);
+        CHECK_RESULT2(cuModuleLoadDataEx(&module, &ptx[0], 0, NULL, NULL), "Error loading CUDA module");
+
+        // If possible, write the PTX to the cache so later contexts can skip compiling it.
+
+        try {
+            ofstream out(cacheFile.str().c_str());
+            out << ptx;
+            out.close();
+            if (out.fail())
+                remove(cacheFile.str().c_str());
+        }
+        catch (...) {
+            // Ignore.  The cache is only an optimization.
+        }
+        return module;
+    }
+
     // Select names for the various temporary files.
 
     stringstream tempFileName;
@@ -600,51 +742,23 @@ CUmodule CudaContext::createModule(const string source, const map<string, string
     string inputFile = (tempDir+tempFileName.str()+".cu");
     string outputFile = (tempDir+tempFileName.str()+".ptx");
     string logFile = (tempDir+tempFileName.str()+".log");
-    int res = 0;
-
-    // If the runtime compiler plugin is available, use it.
-
-    if (hasCompilerKernel && !isNvccAvailable) {
-        string ptx = compilerKernel.getAs<CudaCompilerKernel>().createModule(src.str(), "-arch=compute_"+gpuArchitecture+" "+options, *this);
-
-        // If possible, write the PTX out to a temporary file so we can cache it for later use.
-
-        bool wroteCache = false;
-        try {
-            ofstream out(outputFile.c_str());
-            out << ptx;
-            out.close();
-            if (!out.fail())
-                wroteCache = true;
-        }
-        catch (...) {
-            // Ignore.
-        }
-        if (!wroteCache) {
-            // An error occurred.  Possibly we don't have permission to write to the temp directory.  Just try to load the module directly.
 
-            CHECK_RESULT2(cuModuleLoadDataEx(&module, &ptx[0], 0, NULL, NULL), "Error loading CUDA module");
-            return module;
-        }
-    }
-    else {
-        // Write out the source to a temporary file.
+    // Write out the source to a temporary file and compile it with nvcc.
 
-        ofstream out(inputFile.c_str());
-        out << src.str();
-        out.close();
+    ofstream out(inputFile.c_str());
+    out << src.str();
+    out.close();
 #ifdef WIN32
 #ifdef _DEBUG
-        string command = compiler+" --ptx -G -g --machine "+bits+" -arch=sm_"+gpuArchitecture+" -o "+outputFile+" "+options+" "+inputFile+" 2> "+logFile;
+    string command = compiler+" --ptx -G -g --machine "+bits+" -arch=sm_"+gpuArchitecture+" -o "+outputFile+" "+options+" "+inputFile+" 2> "+logFile;
 #else
-        string command = compiler+" --ptx -lineinfo --machine "+bits+" -arch=sm_"+gpuArchitecture+" -o "+outputFile+" "+options+" "+inputFile+" 2> "+logFile;
+    string command = compiler+" --ptx -lineinfo --machine "+bits+" -arch=sm_"+gpuArchitecture+" -o "+outputFile+" "+options+" "+inputFile+" 2> "+logFile;
 #endif
-        int res = executeInWindows(command);
+    int res = executeInWindows(command);
 #else
-        string command = compiler+" --ptx --machine "+bits+" -arch=sm_"+gpuArchitecture+" -o \""+outputFile+"\" "+options+" \""+inputFile+"\" 2> \""+logFile+"\"";
-        res = std::system(command.c_str());
+    string command = compiler+" --ptx --machine "+bits+" -arch=sm_"+gpuArchitecture+" -o \""+outputFile+"\" "+options+" \""+inputFile+"\" 2> \""+logFile+"\"";
+    int res = std::system(command.c_str());
 #endif
-    }
     try {
         if (res != 0) {
             // Load the error log.
@@ -690,6 +804,8 @@ CUfunction CudaContext::getKernel(CUmodule& module, const string& name) {
         m<<"Error creating kernel "<<name<<": "<<getErrorString(result)<<" ("<<result<<")";
         throw OpenMMException(m.str());
     }
+    if (profileKernels)
+        kernelNames[function] = name;
     return function;
 }
 
@@ -780,12 +896,205 @@ void CudaContext::executeKernel(CUfunction kernel, void** arguments, int threads
     if (blockSize == -1)
         blockSize = ThreadBlockSize;
     int gridSize = std::min((threads+blockSize-1)/blockSize, numThreadBlocks);
+    // Events cannot be processed while a graph is being captured, so suspend profiling during capture.
+    bool profileThisKernel = profileKernels && !capturingSequence;
+    ProfiledKernel profile;
+    if (profileThisKernel) {
+        string errorMessage = "Error profiling kernel";
+        if (profileStartEvent == NULL) {
+            // This is the first launch, so record the event that all timestamps are measured from.
+
+            CHECK_RESULT(cuEventCreate(&profileStartEvent, 0));
+            CHECK_RESULT(cuEventRecord(profileStartEvent, currentStream));
+        }
+        if (profileEventPool.size() > 0) {
+            profile.start = profileEventPool.back().first;
+            profile.end = profileEventPool.back().second;
+            profileEventPool.pop_back();
+        }
+        else {
+            CHECK_RESULT(cuEventCreate(&profile.start, 0));
+            CHECK_RESULT(cuEventCreate(&profile.end, 0));
+        }
+        profile.kernel = kernel;
+        CHECK_RESULT(cuEventRecord(profile.start, currentStream));
+    }
     CUresult result = cuLaunchKernel(kernel, gridSize, 1, 1, blockSize, 1, 1, sharedSize, currentStream, arguments, NULL);
     if (result != CUDA_SUCCESS) {
         stringstream str;
         str<<"Error invoking kernel: "<<getErrorString(result)<<" ("<<result<<")";
         throw OpenMMException(str.str());
     }
+    if (profileThisKernel) {
+        string errorMessage = "Error profiling kernel";
+        CHECK_RESULT(cuEventRecord(profile.end, currentStream));
+        pendingProfiledKernels.push_back(profile);
+        if (pendingProfiledKernels.size() >= 1000)
+            flushProfileEvents();
+    }
+}
+
+void CudaContext::synchronizeEvent(CUevent event) {
+    // When the context was created with CU_CTX_SCHED_SPIN, cuEventSynchronize() busy waits
+    // anyway, so there is nothing to be gained by polling first.
+
+    if (!useBlockingSync) {
+        CHECK_RESULT2(cuEventSynchronize(event), "Error synchronizing on event");
+        return;
+    }
+
+    // Poll the event for a short time before falling back to a blocking wait.  The polling
+    // budget adapts to how long recent waits have taken: on small systems the wait usually
+    // completes while polling, avoiding the latency of waking a sleeping thread, while on
+    // large systems the CPU is given back to the operating system almost immediately.
+
+    long long start = getTime();
+    long long limit = start+min(2*eventWaitEstimate, (long long) 250);
+    CUresult result;
+    while ((result = cuEventQuery(event)) == CUDA_ERROR_NOT_READY && getTime() < limit)
+        ;
+    if (result == CUDA_ERROR_NOT_READY)
+        CHECK_RESULT2(cuEventSynchronize(event), "Error synchronizing on event");
+    else
+        CHECK_RESULT2(result, "Error synchronizing on event");
+    long long elapsed = getTime()-start;
+    eventWaitEstimate = (eventWaitEstimate == 0 ? elapsed : (7*eventWaitEstimate+elapsed)/8);
+}
+
+void CudaContext::flushProfileEvents() {
+    string errorMessage = "Error profiling kernel";
+    for (auto& profile : pendingProfiledKernels) {
+        CHECK_RESULT(cuEventSynchronize(profile.end));
+        float startMs, durationMs;
+        CHECK_RESULT(cuEventElapsedTime(&startMs, profileStartEvent, profile.start));
+        CHECK_RESULT(cuEventElapsedTime(&durationMs, profile.start, profile.end));
+        stringstream event;
+        event.precision(3);
+        event<<fixed;
+        event<<"{\"name\":\""<<kernelNames[profile.kernel]<<"\",\"cat\":\"kernel\",\"ph\":\"X\",\"pid\":"<<contextIndex<<",\"tid\":0,";
+        event<<"\"ts\":"<<(1000.0*startMs)<<",\"dur\":"<<(1000.0*durationMs)<<"},";
+        profileTrace += event.str();
+        profileEventPool.push_back(make_pair(profile.start, profile.end));
+    }
+    pendingProfiledKernels.clear();
+}
+
+bool CudaContext::beginCaptureSequence(const void* sequence) {
+#if CUDA_VERSION >= 10010
+    if (capturingSequence)
+        return false;
+    int driverVersion;
+    cuDriverGetVersion(&driverVersion);
+    if (driverVersion < 10010)
+        return false;
+    if (captureStream == NULL && cuStreamCreate(&captureStream, CU_STREAM_NON_BLOCKING) != CUDA_SUCCESS) {
+        captureStream = NULL;
+        return false;
+    }
+    if (cuStreamBeginCapture(captureStream, CU_STREAM_CAPTURE_MODE_THREAD_LOCAL) != CUDA_SUCCESS)
+        return false;
+    capturingSequence = true;
+    captureSequenceId = sequence;
+    setCurrentStream(captureStream);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool CudaContext::endCaptureSequence() {
+#if CUDA_VERSION >= 10010
+    if (!capturingSequence)
+        return false;
+    capturingSequence = false;
+    restoreDefaultStream();
+    CUgraph graph;
+    if (cuStreamEndCapture(captureStream, &graph) != CUDA_SUCCESS)
+        return false;
+    CUgraphExec instance;
+    CUresult result = cuGraphInstantiate(&instance, graph, NULL, NULL, 0);
+    cuGraphDestroy(graph);
+    if (result != CUDA_SUCCESS)
+        return false;
+    map<const void*, CUgraphExec>::iterator old = capturedSequences.find(captureSequenceId);
+    if (old != capturedSequences.end())
+        cuGraphExecDestroy(old->second);
+    capturedSequences[captureSequenceId] = instance;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool CudaContext::executeCapturedSequence(const void* sequence) {
+#if CUDA_VERSION >= 10010
+    map<const void*, CUgraphExec>::iterator graph = capturedSequences.find(sequence);
+    if (graph == capturedSequences.end())
+        return false;
+    CHECK_RESULT2(cuGraphLaunch(graph->second, currentStream), "Error launching CUDA graph");
+    return true;
+#else
+    return false;
+#endif
+}
+
+void CudaContext::invalidateCapturedSequences() {
+#if CUDA_VERSION >= 10010
+    for (auto& sequence : capturedSequences)
+        cuGraphExecDestroy(sequence.second);
+    capturedSequences.clear();
+#endif
+}
+
+void CudaContext::swapState(CudaContext& other) {
+    if (numAtoms != other.numAtoms || paddedNumAtoms != other.paddedNumAtoms ||
+            useDoublePrecision != other.useDoublePrecision || useMixedPrecision != other.useMixedPrecision)
+        throw OpenMMException("swapState() requires two contexts created from identical Systems");
+    string errorMessage = "Error swapping state between contexts";
+
+    // Wait until all outstanding work in both contexts has finished, since the copies
+    // bypass their streams.
+
+    setAsCurrent();
+    CHECK_RESULT(cuCtxSynchronize());
+    other.setAsCurrent();
+    CHECK_RESULT(cuCtxSynchronize());
+    setAsCurrent();
+
+    // Exchange the particle data directly between the devices, staging it through a
+    // temporary buffer on this context's device.  cuMemcpyPeer() uses a direct peer to
+    // peer transfer when the devices are connected by NVLink or PCIe peer access, and
+    // handles the copy itself when they are not.
+
+    CudaArray* localArrays[] = {posq, posqCorrection, velm};
+    CudaArray* otherArrays[] = {other.posq, other.posqCorrection, other.velm};
+    for (int i = 0; i < 3; i++) {
+        if (localArrays[i] == NULL)
+            continue;
+        size_t bytes = localArrays[i]->getSize()*localArrays[i]->getElementSize();
+        CUdeviceptr temp = acquireDeviceMemory(bytes);
+        CHECK_RESULT(cuMemcpyPeer(temp, context, localArrays[i]->getDevicePointer(), context, bytes));
+        CHECK_RESULT(cuMemcpyPeer(localArrays[i]->getDevicePointer(), context, otherArrays[i]->getDevicePointer(), other.context, bytes));
+        CHECK_RESULT(cuMemcpyPeer(otherArrays[i]->getDevicePointer(), other.context, temp, context, bytes));
+        releaseDeviceMemory(temp, bytes);
+    }
+
+    // The two contexts may have sorted their atoms differently, so exchange the orderings
+    // along with the data and let every force resort its per-atom values to match.  The
+    // captured sequences are discarded, since the forces may replace buffers while resorting.
+
+    swap(atomIndex, other.atomIndex);
+    swap(posCellOffsets, other.posCellOffsets);
+    atomIndexDevice->upload(atomIndex);
+    for (auto listener : reorderListeners)
+        listener->execute();
+    invalidateCapturedSequences();
+    other.setAsCurrent();
+    other.atomIndexDevice->upload(other.atomIndex);
+    for (auto listener : other.reorderListeners)
+        listener->execute();
+    other.invalidateCapturedSequences();
+    setAsCurrent();
 }
 
 int CudaContext::computeThreadBlockSize(double memory, bool preferShared) const {
@@ -820,6 +1129,30 @@ void CudaContext::addAutoclearBuffer(CUdeviceptr memory, int size) {
     autoclearBufferSizes.push_back(size/4);
 }
 
+void CudaContext::registerPmeGrid(CudaArray* grid) {
+    sharedPmeGrids.push_back(grid);
+}
+
+CudaArray* CudaContext::findPmeGrid(long long numBytes, int index) {
+    for (int i = 0; i < (int) sharedPmeGrids.size(); i++) {
+        if ((long long) sharedPmeGrids[i]->getSize()*sharedPmeGrids[i]->getElementSize() >= numBytes) {
+            if (index == 0) {
+                borrowedPmeGrids.push_back(sharedPmeGrids[i]);
+                return sharedPmeGrids[i];
+            }
+            index--;
+        }
+    }
+    return NULL;
+}
+
+bool CudaContext::isPmeGridShared(CudaArray* grid) {
+    for (int i = 0; i < (int) borrowedPmeGrids.size(); i++)
+        if (borrowedPmeGrids[i] == grid)
+            return true;
+    return false;
+}
+
 void CudaContext::clearAutoclearBuffers() {
     int base = 0;
     int total = autoclearBufferSizes.size();
@@ -864,6 +1197,28 @@ void CudaContext::clearAutoclearBuffers() {
     }
 }
 
+double CudaContext::reduceEnergy() {
+    // The first pass computes one partial sum per thread block, then a second pass with a
+    // single block combines them into the total.
+
+    int bufferSize = energyBuffer->getSize();
+    int partialSumCount = energyPartialSums->getSize();
+    void* args1[] = {&energyBuffer->getDevicePointer(), &energyPartialSums->getDevicePointer(), &bufferSize};
+    executeKernel(reduceEnergyKernel, args1, partialSumCount*ThreadBlockSize, ThreadBlockSize);
+    void* args2[] = {&energyPartialSums->getDevicePointer(), &energySum->getDevicePointer(), &partialSumCount};
+    executeKernel(reduceEnergyKernel, args2, ThreadBlockSize, ThreadBlockSize);
+    if (useDoublePrecision || useMixedPrecision) {
+        double energy;
+        energySum->download(&energy);
+        return energy;
+    }
+    else {
+        float energy;
+        energySum->download(&energy);
+        return energy;
+    }
+}
+
 void CudaContext::setCharges(const vector<double>& charges) {
     if (chargeBuffer == NULL)
         chargeBuffer = new CudaArray(*this, numAtoms, useDoublePrecision ? sizeof(double) : sizeof(float), "chargeBuffer");
@@ -1013,13 +1368,35 @@ void CudaContext::findMoleculeGroups() {
     vector<Molecule> uniqueMolecules;
     vector<vector<int> > moleculeInstances;
     vector<vector<int> > moleculeOffsets;
+    map<size_t, vector<int> > uniqueMoleculesByHash;
     for (int molIndex = 0; molIndex < (int) molecules.size(); molIndex++) {
         Molecule& mol = molecules[molIndex];
 
-        // See if it is identical to another molecule.
+        // Compute a hash based on properties that identical molecules are guaranteed to share,
+        // so that only molecules with equal hashes ever need to be compared in detail.
+
+        size_t hash = mol.atoms.size();
+        for (int i = 0; i < (int) mol.atoms.size(); i++) {
+            hash = hash*31 + (size_t) (mol.atoms[i]-mol.atoms[0]);
+            hash = hash*31 + std::hash<double>()(system.getParticleMass(mol.atoms[i]));
+        }
+        for (int i = 0; i < (int) mol.constraints.size(); i++) {
+            int particle1, particle2;
+            double distance;
+            system.getConstraintParameters(mol.constraints[i], particle1, particle2, distance);
+            hash = hash*31 + (size_t) (particle1-mol.atoms[0]);
+            hash = hash*31 + (size_t) (particle2-mol.atoms[0]);
+            hash = hash*31 + std::hash<double>()(distance);
+        }
+        for (int i = 0; i < (int) mol.groups.size(); i++)
+            hash = hash*31 + mol.groups[i].size();
+
+        // See if it is identical to another molecule with the same hash.
 
         bool isNew = true;
-        for (int j = 0; j < (int) uniqueMolecules.size() && isNew; j++) {
+        vector<int>& candidates = uniqueMoleculesByHash[hash];
+        for (int candidateIndex = 0; candidateIndex < (int) candidates.size() && isNew; candidateIndex++) {
+            int j = candidates[candidateIndex];
             Molecule& mol2 = uniqueMolecules[j];
             bool identical = (mol.atoms.size() == mol2.atoms.size() && mol.constraints.size() == mol2.constraints.size());
 
@@ -1061,6 +1438,7 @@ void CudaContext::findMoleculeGroups() {
             }
         }
         if (isNew) {
+            candidates.push_back((int) uniqueMolecules.size());
             uniqueMolecules.push_back(mol);
             moleculeInstances.push_back(vector<int>());
             moleculeInstances[moleculeInstances.size()-1].push_back(molIndex);
@@ -1126,8 +1504,9 @@ bool CudaContext::invalidateMolecules(CudaForceInfo* force) {
 
     // The list of which molecules are identical is no longer valid.  We need to restore the
     // atoms to their original order, rebuild the list of identical molecules, and sort them
-    // again.
+    // again.  Any captured kernel sequences may also depend on values that have changed.
 
+    invalidateCapturedSequences();
     vector<int4> newCellOffsets(numAtoms);
     if (useDoublePrecision) {
         vector<double4> oldPosq(paddedNumAtoms);
@@ -1195,12 +1574,29 @@ bool CudaContext::invalidateMolecules(CudaForceInfo* force) {
 
 void CudaContext::reorderAtoms() {
     atomsWereReordered = false;
-    if (numAtoms == 0 || nonbonded == NULL || !nonbonded->getUseCutoff() || stepsSinceReorder < 250) {
+    if (numAtoms == 0 || nonbonded == NULL || !nonbonded->getUseCutoff()) {
+        stepsSinceReorder++;
+        return;
+    }
+
+    // Reordering is expensive, so only do it once spatial locality has actually decayed.
+    // The size of the neighbor list measures locality directly: as atoms that are adjacent
+    // in memory drift apart, the number of interacting tiles grows.  Compare it to the size
+    // recorded just after the last reordering, and also enforce an upper bound on how long
+    // to wait in case the tile count fails to capture the decay.
+
+    int interactionCount = nonbonded->getLastInteractionCount();
+    if (interactionsAfterReorder < 0)
+        interactionsAfterReorder = interactionCount;
+    bool localityDecayed = (interactionCount > 1.05*interactionsAfterReorder);
+    if (stepsSinceReorder < 100 || (!localityDecayed && stepsSinceReorder < 1000)) {
         stepsSinceReorder++;
         return;
     }
     atomsWereReordered = true;
     stepsSinceReorder = 0;
+    interactionsAfterReorder = -1;
+    invalidateCapturedSequences();
     if (useDoublePrecision)
         reorderAtomsImpl<double, double4, double, double4>();
     else if (useMixedPrecision)
@@ -1209,6 +1605,18 @@ void CudaContext::reorderAtoms() {
         reorderAtomsImpl<float, float4, float, float4>();
 }
 
+// Spread out the low eight bits of a value so the coordinates along the three axes can be
+// interleaved into a Morton index.  Sorting by Morton index gives nearly the same locality
+// as a Hilbert curve at a small fraction of the cost of computing the indices.
+
+static int spreadBits(int x) {
+    x = (x | (x<<16)) & 0x030000FF;
+    x = (x | (x<<8)) & 0x0300F00F;
+    x = (x | (x<<4)) & 0x030C30C3;
+    x = (x | (x<<2)) & 0x09249249;
+    return x;
+}
+
 template <class Real, class Real4, class Mixed, class Mixed4>
 void CudaContext::reorderAtomsImpl() {
     // Find the range of positions and the number of bins along each axis.
@@ -1310,9 +1718,9 @@ void CudaContext::reorderAtomsImpl() {
 
         // Select a bin for each molecule, then sort them by bin.
 
-        bool useHilbert = (numMolecules > 5000 || atoms.size() > 8); // For small systems, a simple zigzag curve works better than a Hilbert curve.
+        bool useMorton = (numMolecules > 5000 || atoms.size() > 8); // For small systems, a simple zigzag curve works better than a space filling curve.
         Real binWidth;
-        if (useHilbert)
+        if (useMorton)
             binWidth = (Real) (max(max(maxx-minx, maxy-miny), maxz-minz)/255.0);
         else
             binWidth = (Real) (0.2*nonbonded->getMaxCutoffDistance());
@@ -1320,18 +1728,13 @@ void CudaContext::reorderAtomsImpl() {
         int xbins = 1 + (int) ((maxx-minx)*invBinWidth);
         int ybins = 1 + (int) ((maxy-miny)*invBinWidth);
         vector<pair<int, int> > molBins(numMolecules);
-        bitmask_t coords[3];
         for (int i = 0; i < numMolecules; i++) {
             int x = (int) ((molPos[i].x-minx)*invBinWidth);
             int y = (int) ((molPos[i].y-miny)*invBinWidth);
             int z = (int) ((molPos[i].z-minz)*invBinWidth);
             int bin;
-            if (useHilbert) {
-                coords[0] = x;
-                coords[1] = y;
-                coords[2] = z;
-                bin = (int) hilbert_c2i(3, 8, coords);
-            }
+            if (useMorton)
+                bin = (spreadBits(z)<<2) | (spreadBits(y)<<1) | spreadBits(x);
             else {
                 int yodd = y&1;
                 int zodd = z&1;
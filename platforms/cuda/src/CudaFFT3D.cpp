@@ -135,6 +135,8 @@ int CudaFFT3D::findLegalDimension(int minimum) {
             while (unfactored > 1 && unfactored%factor == 0)
                 unfactored /= factor;
         }
+        while (unfactored > 1 && unfactored%11 == 0)
+            unfactored /= 11;
         if (unfactored == 1)
             return minimum;
         minimum++;
@@ -145,6 +147,10 @@ int CudaFFT3D::findLegalDimension(int minimum) {
 static int getSmallestRadix(int size) {
     int minRadix = 1;
     int unfactored = size;
+    while (unfactored%11 == 0) {
+        minRadix = 11;
+        unfactored /= 11;
+    }
     while (unfactored%7 == 0) {
         minRadix = 7;
         unfactored /= 7;
@@ -185,7 +191,9 @@ CUfunction CudaFFT3D::createKernel(int xsize, int ysize, int zsize, int& threads
         int input = stage%2;
         int output = 1-input;
         int radix;
-        if (L%7 == 0)
+        if (L%11 == 0)
+            radix = 11;
+        else if (L%7 == 0)
             radix = 7;
         else if (L%5 == 0)
             radix = 5;
@@ -208,7 +216,35 @@ CUfunction CudaFFT3D::createKernel(int xsize, int ysize, int zsize, int& threads
         source<<"int i = threadIdx.x-block*"<<(L*m)<<";\n";
         source<<"int base = i+block*"<<zsize<<";\n";
         source<<"int j = i/"<<m<<";\n";
-        if (radix == 7) {
+        if (radix == 11) {
+            // An 11 point transform is computed directly from the definition, pairing terms
+            // whose twiddle factors are complex conjugates of each other.
+
+            source<<"real2 c0 = data"<<input<<"[base];\n";
+            for (int i = 1; i < 11; i++)
+                source<<"real2 c"<<i<<" = data"<<input<<"[base+"<<(i*L*m)<<"];\n";
+            for (int t = 1; t <= 5; t++) {
+                source<<"real2 d"<<(2*t-2)<<" = c"<<t<<"+c"<<(11-t)<<";\n";
+                source<<"real2 d"<<(2*t-1)<<" = c"<<t<<"-c"<<(11-t)<<";\n";
+            }
+            source<<"data"<<output<<"[base+10*j*"<<m<<"] = c0+d0+d2+d4+d6+d8;\n";
+            for (int k = 1; k <= 5; k++) {
+                source<<"real2 a"<<k<<" = c0";
+                for (int t = 1; t <= 5; t++)
+                    source<<"+"<<context.doubleToString(cos(2*M_PI*t*k/11))<<"*d"<<(2*t-2);
+                source<<";\n";
+                source<<"real2 b"<<k<<" = (SIGN)*make_real2(";
+                for (int t = 1; t <= 5; t++)
+                    source<<(t > 1 ? "+" : "")<<context.doubleToString(sin(2*M_PI*t*k/11))<<"*d"<<(2*t-1)<<".y";
+                source<<", -(";
+                for (int t = 1; t <= 5; t++)
+                    source<<(t > 1 ? "+" : "")<<context.doubleToString(sin(2*M_PI*t*k/11))<<"*d"<<(2*t-1)<<".x";
+                source<<"));\n";
+                source<<"data"<<output<<"[base+(10*j+"<<k<<")*"<<m<<"] = multiplyComplex(w[j*"<<(k*zsize)<<"/"<<(11*L)<<"], a"<<k<<"+b"<<k<<");\n";
+                source<<"data"<<output<<"[base+(10*j+"<<(11-k)<<")*"<<m<<"] = multiplyComplex(w[j*"<<((11-k)*zsize)<<"/"<<(11*L)<<"], a"<<k<<"-b"<<k<<");\n";
+            }
+        }
+        else if (radix == 7) {
             source<<"real2 c0 = data"<<input<<"[base];\n";
             source<<"real2 c1 = data"<<input<<"[base+"<<(L*m)<<"];\n";
             source<<"real2 c2 = data"<<input<<"[base+"<<(2*L*m)<<"];\n";
@@ -103,7 +103,8 @@ CudaIntegrationUtilities::CudaIntegrationUtilities(CudaContext& context, const S
         ccmaReducedMass(NULL), ccmaAtomConstraints(NULL), ccmaNumAtomConstraints(NULL), ccmaConstraintMatrixColumn(NULL),
         ccmaConstraintMatrixValue(NULL), ccmaDelta1(NULL), ccmaDelta2(NULL), ccmaConverged(NULL), ccmaConvergedMemory(NULL),
         vsite2AvgAtoms(NULL), vsite2AvgWeights(NULL), vsite3AvgAtoms(NULL), vsite3AvgWeights(NULL),
-        vsiteOutOfPlaneAtoms(NULL), vsiteOutOfPlaneWeights(NULL), vsiteLocalCoordsAtoms(NULL), vsiteLocalCoordsParams(NULL) {
+        vsiteOutOfPlaneAtoms(NULL), vsiteOutOfPlaneWeights(NULL), vsiteLocalCoordsAtoms(NULL), vsiteLocalCoordsParams(NULL),
+        pinnedStepSizeMemory(NULL), stepSizeDownloadPending(false) {
     // Create workspace arrays.
 
     lastStepSize = make_double2(0.0, 0.0);
@@ -122,6 +123,8 @@ CudaIntegrationUtilities::CudaIntegrationUtilities(CudaContext& context, const S
         float2 lastStepSizeFloat = make_float2(0.0f, 0.0f);
         stepSize->upload(&lastStepSizeFloat);
     }
+    CHECK_RESULT2(cuMemHostAlloc((void**) &pinnedStepSizeMemory, sizeof(double2), 0), "Error allocating pinned memory");
+    CHECK_RESULT2(cuEventCreate(&stepSizeEvent, CU_EVENT_DISABLE_TIMING), "Error creating event for step size download");
 
     // Record the set of constraints and how many constraints each atom is involved in.
 
@@ -377,6 +380,7 @@ CudaIntegrationUtilities::CudaIntegrationUtilities(CudaContext& context, const S
         ccmaConverged = CudaArray::create<int>(context, 2, "ccmaConverged");
         CHECK_RESULT2(cuMemHostAlloc((void**) &ccmaConvergedMemory, sizeof(int), CU_MEMHOSTALLOC_DEVICEMAP), "Error allocating pinned memory");
         CHECK_RESULT2(cuMemHostGetDevicePointer(&ccmaConvergedDeviceMemory, ccmaConvergedMemory, 0), "Error getting device address for pinned memory");
+        ccmaExpectedIterations[0] = ccmaExpectedIterations[1] = 0;
         vector<int2> atomsVec(ccmaAtoms->getSize());
         vector<int> atomConstraintsVec(ccmaAtomConstraints->getSize());
         vector<int> numAtomConstraintsVec(ccmaNumAtomConstraints->getSize());
@@ -632,6 +636,8 @@ CudaIntegrationUtilities::~CudaIntegrationUtilities() {
         delete ccmaConverged;
     if (ccmaConvergedMemory != NULL)
         cuMemFreeHost(ccmaConvergedMemory);
+    if (pinnedStepSizeMemory != NULL)
+        cuMemFreeHost(pinnedStepSizeMemory);
     if (vsite2AvgAtoms != NULL)
         delete vsite2AvgAtoms;
     if (vsite2AvgWeights != NULL)
@@ -663,7 +669,21 @@ void CudaIntegrationUtilities::setNextStepSize(double size) {
 }
 
 double CudaIntegrationUtilities::getLastStepSize() {
-    if (context.getUseDoublePrecision() || context.getUseMixedPrecision())
+    if (stepSizeDownloadPending) {
+        // The download was started as soon as the step size was selected, so only wait for
+        // that early point in the stream.  The kernels for the rest of the step can still
+        // be executing.
+
+        context.synchronizeEvent(stepSizeEvent);
+        stepSizeDownloadPending = false;
+        if (context.getUseDoublePrecision() || context.getUseMixedPrecision())
+            lastStepSize = pinnedStepSizeMemory[0];
+        else {
+            float2 lastStepSizeFloat = ((float2*) pinnedStepSizeMemory)[0];
+            lastStepSize = make_double2(lastStepSizeFloat.x, lastStepSizeFloat.y);
+        }
+    }
+    else if (context.getUseDoublePrecision() || context.getUseMixedPrecision())
         stepSize->download(&lastStepSize);
     else {
         float2 lastStepSizeFloat;
@@ -673,6 +693,12 @@ double CudaIntegrationUtilities::getLastStepSize() {
     return lastStepSize.y;
 }
 
+void CudaIntegrationUtilities::downloadStepSizeAsync() {
+    stepSize->download(pinnedStepSizeMemory, false);
+    CHECK_RESULT2(cuEventRecord(stepSizeEvent, 0), "Error recording event for step size download");
+    stepSizeDownloadPending = true;
+}
+
 void CudaIntegrationUtilities::applyConstraints(double tol) {
     applyConstraints(false, tol);
 }
@@ -724,20 +750,33 @@ void CudaIntegrationUtilities::applyConstraints(bool constrainVelocities, double
                 constrainVelocities ? &context.getVelm().getDevicePointer() : &posDelta->getDevicePointer(),
                 &context.getVelm().getDevicePointer(), &ccmaDelta1->getDevicePointer(), &ccmaDelta2->getDevicePointer(),
                 &ccmaConverged->getDevicePointer(), &i};
+        // The iteration usually converges after nearly the same number of iterations on every
+        // step, and each convergence check requires synchronizing with the device.  Skip the
+        // checks during the iterations that recent steps have needed: launching a few extra
+        // iterations is cheap, since the kernels return immediately once the constraints have
+        // converged.
+
         const int checkInterval = 4;
+        int& expectedIterations = ccmaExpectedIterations[constrainVelocities ? 1 : 0];
         ccmaConvergedMemory[0] = 0;
         for (i = 0; i < 150; i++) {
             context.executeKernel(ccmaForceKernel, forceArgs, ccmaAtoms->getSize());
-            if ((i+1)%checkInterval == 0)
+            bool checkConvergence = ((i+1)%checkInterval == 0 && i+1 >= expectedIterations);
+            if (checkConvergence)
                 CHECK_RESULT2(cuEventRecord(ccmaEvent, 0), "Error recording event for CCMA");
             context.executeKernel(ccmaMultiplyKernel, multiplyArgs, ccmaAtoms->getSize());
             context.executeKernel(ccmaUpdateKernel, updateArgs, context.getNumAtoms());
-            if ((i+1)%checkInterval == 0) {
-                CHECK_RESULT2(cuEventSynchronize(ccmaEvent), "Error synchronizing on event for CCMA");
+            if (checkConvergence) {
+                context.synchronizeEvent(ccmaEvent);
                 if (ccmaConvergedMemory[0])
                     break;
             }
         }
+
+        // Let the estimate drift down slowly so it can adapt if the iteration starts
+        // converging sooner.
+
+        expectedIterations = max(0, max(i-1, expectedIterations-1));
     }
 }
 
@@ -771,10 +810,12 @@ void CudaIntegrationUtilities::initRandomNumberGenerator(unsigned int randomNumb
         return;
     }
 
-    // Create the random number arrays.
+    // Create the random number arrays.  The buffer holds enough values for many steps
+    // so the generation kernel runs infrequently.  For small systems each refill is
+    // dominated by launch latency, so never make the buffer smaller than a fixed floor.
 
     lastSeed = randomNumberSeed;
-    random = CudaArray::create<float4>(context, 4*context.getPaddedNumAtoms(), "random");
+    random = CudaArray::create<float4>(context, max(4*context.getPaddedNumAtoms(), 32768), "random");
     randomSeed = CudaArray::create<int4>(context, context.getNumThreadBlocks()*CudaContext::ThreadBlockSize, "randomSeed");
     randomPos = random->getSize();
 
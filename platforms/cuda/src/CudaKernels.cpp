@@ -86,6 +86,18 @@ static bool usesVariable(const Lepton::ParsedExpression& expression, const strin
     return usesVariable(expression.getRootNode(), variable);
 }
 
+static bool usesOnlyVariables(const Lepton::ExpressionTreeNode& node, const set<string>& variables) {
+    const Lepton::Operation& op = node.getOperation();
+    if (op.getId() == Lepton::Operation::VARIABLE && variables.find(op.getName()) == variables.end())
+        return false;
+    if (op.getId() == Lepton::Operation::CUSTOM)
+        return false; // deriv() can only be evaluated on the host.
+    for (auto& child : node.getChildren())
+        if (!usesOnlyVariables(child, variables))
+            return false;
+    return true;
+}
+
 static pair<ExpressionTreeNode, string> makeVariable(const string& name, const string& value) {
     return make_pair(ExpressionTreeNode(new Operation::Variable(name)), value);
 }
@@ -108,27 +120,15 @@ void CudaCalcForcesAndEnergyKernel::beginComputation(ContextImpl& context, bool
 }
 
 double CudaCalcForcesAndEnergyKernel::finishComputation(ContextImpl& context, bool includeForces, bool includeEnergy, int groups, bool& valid) {
-    cu.getBondedUtilities().computeInteractions(groups);
+    cu.getBondedUtilities().computeInteractions(groups, includeForces, includeEnergy);
     cu.getNonbondedUtilities().computeInteractions(groups, includeForces, includeEnergy);
     double sum = 0.0;
     for (auto computation : cu.getPostComputations())
         sum += computation->computeForceAndEnergy(includeForces, includeEnergy, groups);
-    cu.getIntegrationUtilities().distributeForcesFromVirtualSites();
-    if (includeEnergy) {
-        CudaArray& energyArray = cu.getEnergyBuffer();
-        if (cu.getUseDoublePrecision() || cu.getUseMixedPrecision()) {
-            double* energy = (double*) cu.getPinnedBuffer();
-            energyArray.download(energy);
-            for (int i = 0; i < energyArray.getSize(); i++)
-                sum += energy[i];
-        }
-        else {
-            float* energy = (float*) cu.getPinnedBuffer();
-            energyArray.download(energy);
-            for (int i = 0; i < energyArray.getSize(); i++)
-                sum += energy[i];
-        }
-    }
+    if (includeForces)
+        cu.getIntegrationUtilities().distributeForcesFromVirtualSites();
+    if (includeEnergy)
+        sum += cu.reduceEnergy();
     if (!cu.getForcesValid())
         valid = false;
     return sum;
@@ -208,48 +208,353 @@ void CudaUpdateStateDataKernel::getPositions(ContextImpl& context, vector<Vec3>&
     cu.getPlatformData().threads.waitForThreads();
 }
 
-void CudaUpdateStateDataKernel::setPositions(ContextImpl& context, const vector<Vec3>& positions) {
+bool CudaUpdateStateDataKernel::getWrappedPositions(ContextImpl& context, vector<Vec3>& positions) {
     cu.setAsCurrent();
-    const vector<int>& order = cu.getAtomIndex();
     int numParticles = context.getSystem().getNumParticles();
+    positions.resize(numParticles);
+    if (wrapKernel == NULL) {
+        CUmodule module = cu.createModule(CudaKernelSources::wrapPositions);
+        wrapKernel = cu.getKernel(module, "wrapMolecules");
+        wrappedPositions.initialize(cu, cu.getPaddedNumAtoms(), cu.getUseDoublePrecision() ? sizeof(double4) : sizeof(float4), "wrappedPositions");
+        wrapMoleculeAtoms.initialize<int>(cu, cu.getNumAtoms(), "wrapMoleculeAtoms");
+        wrapMoleculeStartIndex.initialize<int>(cu, context.getMolecules().size()+1, "wrapMoleculeStartIndex");
+    }
+    if (wrapAtomOrder != cu.getAtomIndex()) {
+        // The atoms have been reordered since the molecule lists were uploaded, so rebuild
+        // them in terms of the current device ordering.
+
+        const vector<vector<int> >& molecules = context.getMolecules();
+        const vector<int>& order = cu.getAtomIndex();
+        vector<int> inverseOrder(cu.getNumAtoms());
+        for (int i = 0; i < cu.getNumAtoms(); i++)
+            inverseOrder[order[i]] = i;
+        vector<int> atoms(wrapMoleculeAtoms.getSize());
+        vector<int> startIndex(wrapMoleculeStartIndex.getSize());
+        int index = 0;
+        for (int i = 0; i < (int) molecules.size(); i++) {
+            startIndex[i] = index;
+            for (int atom : molecules[i])
+                atoms[index++] = inverseOrder[atom];
+        }
+        startIndex[molecules.size()] = index;
+        wrapMoleculeAtoms.upload(atoms);
+        wrapMoleculeStartIndex.upload(startIndex);
+        wrapAtomOrder = order;
+    }
+
+    // Wrap the positions on the device, writing them to a separate array so the simulation
+    // state is not modified.  The positions in posq were last translated as whole molecules,
+    // so the cell offsets recorded during reordering are uniform within each molecule and
+    // cancel out of the wrapped result.  That lets the conversion below skip them.
+
+    int numMolecules = wrapMoleculeStartIndex.getSize()-1;
+    void* args[] = {&numMolecules, cu.getPeriodicBoxSizePointer(), cu.getInvPeriodicBoxSizePointer(),
+            cu.getPeriodicBoxVecXPointer(), cu.getPeriodicBoxVecYPointer(), cu.getPeriodicBoxVecZPointer(),
+            &cu.getPosq().getDevicePointer(), &wrappedPositions.getDevicePointer(),
+            &wrapMoleculeAtoms.getDevicePointer(), &wrapMoleculeStartIndex.getDevicePointer()};
+    cu.executeKernel(wrapKernel, args, cu.getNumAtoms());
+    vector<float4> posCorrection;
     if (cu.getUseDoublePrecision()) {
         double4* posq = (double4*) cu.getPinnedBuffer();
-        cu.getPosq().download(posq);
-        for (int i = 0; i < numParticles; ++i) {
-            double4& pos = posq[i];
-            const Vec3& p = positions[order[i]];
-            pos.x = p[0];
-            pos.y = p[1];
-            pos.z = p[2];
+        wrappedPositions.download(posq, true);
+    }
+    else if (cu.getUseMixedPrecision()) {
+        float4* posq = (float4*) cu.getPinnedBuffer();
+        wrappedPositions.download(posq, true);
+        posCorrection.resize(numParticles);
+        cu.getPosqCorrection().download(posCorrection);
+    }
+    else {
+        float4* posq = (float4*) cu.getPinnedBuffer();
+        wrappedPositions.download(posq, true);
+    }
+
+    // Filling in the output array is done in parallel for speed.
+
+    cu.getPlatformData().threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        const vector<int>& order = cu.getAtomIndex();
+        int numParticles = cu.getNumAtoms();
+        int numThreads = threads.getNumThreads();
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        if (cu.getUseDoublePrecision()) {
+            double4* posq = (double4*) cu.getPinnedBuffer();
+            for (int i = start; i < end; ++i) {
+                double4 pos = posq[i];
+                positions[order[i]] = Vec3(pos.x, pos.y, pos.z);
+            }
         }
+        else if (cu.getUseMixedPrecision()) {
+            float4* posq = (float4*) cu.getPinnedBuffer();
+            for (int i = start; i < end; ++i) {
+                float4 pos1 = posq[i];
+                float4 pos2 = posCorrection[i];
+                positions[order[i]] = Vec3((double)pos1.x+(double)pos2.x, (double)pos1.y+(double)pos2.y, (double)pos1.z+(double)pos2.z);
+            }
+        }
+        else {
+            float4* posq = (float4*) cu.getPinnedBuffer();
+            for (int i = start; i < end; ++i) {
+                float4 pos = posq[i];
+                positions[order[i]] = Vec3(pos.x, pos.y, pos.z);
+            }
+        }
+    });
+    cu.getPlatformData().threads.waitForThreads();
+    return true;
+}
+
+CudaUpdateStateDataKernel::~CudaUpdateStateDataKernel() {
+    cu.setAsCurrent();
+    if (downloadStream != NULL)
+        cuStreamDestroy(downloadStream);
+    if (downloadEvent != NULL)
+        cuEventDestroy(downloadEvent);
+    if (downloadBuffer != NULL)
+        cuMemFreeHost(downloadBuffer);
+}
+
+void CudaUpdateStateDataKernel::beginGetPositions(ContextImpl& context) {
+    cu.setAsCurrent();
+    if (downloadStream == NULL) {
+        CHECK_RESULT(cuStreamCreate(&downloadStream, CU_STREAM_NON_BLOCKING), "Error creating stream for downloading positions");
+        CHECK_RESULT(cuEventCreate(&downloadEvent, CU_EVENT_DISABLE_TIMING), "Error creating event for downloading positions");
+        int bufferSize = cu.getPosq().getSize()*cu.getPosq().getElementSize();
+        if (cu.getUseMixedPrecision())
+            bufferSize += cu.getPosqCorrection().getSize()*cu.getPosqCorrection().getElementSize();
+        CHECK_RESULT(cuMemHostAlloc(&downloadBuffer, bufferSize, CU_MEMHOSTALLOC_PORTABLE), "Error allocating pinned buffer for downloading positions");
+    }
+
+    // Record the atom ordering the downloaded data corresponds to, since it may change
+    // before finishGetPositions() is called.
+
+    downloadOrder = cu.getAtomIndex();
+    downloadCellOffsets = cu.getPosCellOffsets();
+    cu.getPeriodicBoxVectors(downloadBoxVectors[0], downloadBoxVectors[1], downloadBoxVectors[2]);
+
+    // Enqueue the copy on a separate stream so the host can continue submitting work while
+    // it proceeds.
+
+    CHECK_RESULT(cuEventRecord(downloadEvent, cu.getCurrentStream()), "Error recording event for downloading positions");
+    CHECK_RESULT(cuStreamWaitEvent(downloadStream, downloadEvent, 0), "Error making stream wait for event");
+    int posqSize = cu.getPosq().getSize()*cu.getPosq().getElementSize();
+    CHECK_RESULT(cuMemcpyDtoHAsync(downloadBuffer, cu.getPosq().getDevicePointer(), posqSize, downloadStream), "Error downloading positions");
+    if (cu.getUseMixedPrecision())
+        CHECK_RESULT(cuMemcpyDtoHAsync((char*) downloadBuffer+posqSize, cu.getPosqCorrection().getDevicePointer(),
+                cu.getPosqCorrection().getSize()*cu.getPosqCorrection().getElementSize(), downloadStream), "Error downloading position corrections");
+    CHECK_RESULT(cuEventRecord(downloadEvent, downloadStream), "Error recording event for downloading positions");
+}
+
+void CudaUpdateStateDataKernel::finishGetPositions(ContextImpl& context, vector<Vec3>& positions) {
+    if (downloadStream == NULL)
+        throw OpenMMException("finishGetPositions called without a matching call to beginGetPositions");
+    cu.setAsCurrent();
+    int numParticles = context.getSystem().getNumParticles();
+    positions.resize(numParticles);
+    cu.synchronizeEvent(downloadEvent);
+
+    // Filling in the output array is done in parallel for speed.
+
+    cu.getPlatformData().threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        // Compute the position of each particle to return to the user.  This is done in parallel for speed.
+
+        int numParticles = cu.getNumAtoms();
+        int numThreads = threads.getNumThreads();
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        if (cu.getUseDoublePrecision()) {
+            double4* posq = (double4*) downloadBuffer;
+            for (int i = start; i < end; ++i) {
+                double4 pos = posq[i];
+                int4 offset = downloadCellOffsets[i];
+                positions[downloadOrder[i]] = Vec3(pos.x, pos.y, pos.z)-downloadBoxVectors[0]*offset.x-downloadBoxVectors[1]*offset.y-downloadBoxVectors[2]*offset.z;
+            }
+        }
+        else if (cu.getUseMixedPrecision()) {
+            float4* posq = (float4*) downloadBuffer;
+            float4* posCorrection = (float4*) ((char*) downloadBuffer+cu.getPosq().getSize()*cu.getPosq().getElementSize());
+            for (int i = start; i < end; ++i) {
+                float4 pos1 = posq[i];
+                float4 pos2 = posCorrection[i];
+                int4 offset = downloadCellOffsets[i];
+                positions[downloadOrder[i]] = Vec3((double)pos1.x+(double)pos2.x, (double)pos1.y+(double)pos2.y, (double)pos1.z+(double)pos2.z)-downloadBoxVectors[0]*offset.x-downloadBoxVectors[1]*offset.y-downloadBoxVectors[2]*offset.z;
+            }
+        }
+        else {
+            float4* posq = (float4*) downloadBuffer;
+            for (int i = start; i < end; ++i) {
+                float4 pos = posq[i];
+                int4 offset = downloadCellOffsets[i];
+                positions[downloadOrder[i]] = Vec3(pos.x, pos.y, pos.z)-downloadBoxVectors[0]*offset.x-downloadBoxVectors[1]*offset.y-downloadBoxVectors[2]*offset.z;
+            }
+        }
+    });
+    cu.getPlatformData().threads.waitForThreads();
+}
+
+void CudaUpdateStateDataKernel::getSelectedPositions(ContextImpl& context, const vector<int>& particles, vector<Vec3>& positions) {
+    cu.setAsCurrent();
+    const vector<int>& order = cu.getAtomIndex();
+    int numParticles = context.getSystem().getNumParticles();
+    int numSelected = particles.size();
+    positions.resize(numSelected);
+    if (numSelected == 0)
+        return;
+
+    // Find where each requested particle is stored on the device.
+
+    vector<int> inverseOrder(numParticles);
+    for (int i = 0; i < numParticles; i++)
+        inverseOrder[order[i]] = i;
+
+    // Enqueue a copy for each requested particle, then wait once for all of them.
+
+    int posqElementSize = cu.getPosq().getElementSize();
+    int correctionElementSize = (cu.getUseMixedPrecision() ? cu.getPosqCorrection().getElementSize() : 0);
+    char* pinnedBuffer = (char*) cu.getPinnedBuffer(numSelected*(posqElementSize+correctionElementSize));
+    char* correctionBuffer = pinnedBuffer+numSelected*posqElementSize;
+    for (int i = 0; i < numSelected; i++) {
+        int slot = inverseOrder[particles[i]];
+        CHECK_RESULT(cuMemcpyDtoHAsync(pinnedBuffer+i*posqElementSize, cu.getPosq().getDevicePointer()+slot*posqElementSize,
+                posqElementSize, cu.getCurrentStream()), "Error downloading selected positions");
+        if (cu.getUseMixedPrecision())
+            CHECK_RESULT(cuMemcpyDtoHAsync(correctionBuffer+i*correctionElementSize, cu.getPosqCorrection().getDevicePointer()+slot*correctionElementSize,
+                    correctionElementSize, cu.getCurrentStream()), "Error downloading selected positions");
+    }
+    CHECK_RESULT(cuStreamSynchronize(cu.getCurrentStream()), "Error downloading selected positions");
+
+    // Compute the position of each particle to return to the user.
+
+    Vec3 boxVectors[3];
+    cu.getPeriodicBoxVectors(boxVectors[0], boxVectors[1], boxVectors[2]);
+    if (cu.getUseDoublePrecision()) {
+        double4* posq = (double4*) pinnedBuffer;
+        for (int i = 0; i < numSelected; ++i) {
+            double4 pos = posq[i];
+            int4 offset = cu.getPosCellOffsets()[inverseOrder[particles[i]]];
+            positions[i] = Vec3(pos.x, pos.y, pos.z)-boxVectors[0]*offset.x-boxVectors[1]*offset.y-boxVectors[2]*offset.z;
+        }
+    }
+    else if (cu.getUseMixedPrecision()) {
+        float4* posq = (float4*) pinnedBuffer;
+        float4* posCorrection = (float4*) correctionBuffer;
+        for (int i = 0; i < numSelected; ++i) {
+            float4 pos1 = posq[i];
+            float4 pos2 = posCorrection[i];
+            int4 offset = cu.getPosCellOffsets()[inverseOrder[particles[i]]];
+            positions[i] = Vec3((double)pos1.x+(double)pos2.x, (double)pos1.y+(double)pos2.y, (double)pos1.z+(double)pos2.z)-boxVectors[0]*offset.x-boxVectors[1]*offset.y-boxVectors[2]*offset.z;
+        }
+    }
+    else {
+        float4* posq = (float4*) pinnedBuffer;
+        for (int i = 0; i < numSelected; ++i) {
+            float4 pos = posq[i];
+            int4 offset = cu.getPosCellOffsets()[inverseOrder[particles[i]]];
+            positions[i] = Vec3(pos.x, pos.y, pos.z)-boxVectors[0]*offset.x-boxVectors[1]*offset.y-boxVectors[2]*offset.z;
+        }
+    }
+}
+
+void CudaUpdateStateDataKernel::getQuantizedPositions(ContextImpl& context, double resolution, vector<int>& positions) {
+    cu.setAsCurrent();
+    int numParticles = context.getSystem().getNumParticles();
+    if (quantizeKernel == NULL) {
+        CUmodule module = cu.createModule(CudaKernelSources::quantizePositions);
+        quantizeKernel = cu.getKernel(module, "quantizePositions");
+        quantizedPositions.initialize<int>(cu, 3*cu.getPaddedNumAtoms(), "quantizedPositions");
+        quantizedCellOffsets.initialize<int4>(cu, cu.getPaddedNumAtoms(), "quantizedCellOffsets");
+    }
+
+    // The cell offsets only change when the atoms are reordered, so only upload them when
+    // they differ from what the kernel last used.
+
+    const vector<int4>& offsets = cu.getPosCellOffsets();
+    bool offsetsChanged = (lastCellOffsets.size() != offsets.size());
+    for (int i = 0; i < (int) offsets.size() && !offsetsChanged; i++)
+        offsetsChanged = (offsets[i].x != lastCellOffsets[i].x || offsets[i].y != lastCellOffsets[i].y || offsets[i].z != lastCellOffsets[i].z);
+    if (offsetsChanged) {
+        quantizedCellOffsets.upload(offsets);
+        lastCellOffsets = offsets;
+    }
+
+    // Quantize the positions on the device, then download the much smaller integer array.
+
+    int numAtoms = cu.getNumAtoms();
+    CUdeviceptr posCorrection = (cu.getUseMixedPrecision() ? cu.getPosqCorrection().getDevicePointer() : 0);
+    double invResolution = 1.0/resolution;
+    void* args[] = {&numAtoms, &cu.getPosq().getDevicePointer(), &posCorrection, &quantizedPositions.getDevicePointer(),
+            &cu.getAtomIndexArray().getDevicePointer(), &quantizedCellOffsets.getDevicePointer(),
+            cu.getPeriodicBoxVecXPointer(), cu.getPeriodicBoxVecYPointer(), cu.getPeriodicBoxVecZPointer(), &invResolution};
+    cu.executeKernel(quantizeKernel, args, numAtoms, 128);
+    int* buffer = (int*) cu.getPinnedBuffer(quantizedPositions.getSize()*sizeof(int));
+    quantizedPositions.download(buffer);
+    positions.resize(3*numParticles);
+    memcpy(positions.data(), buffer, 3*numParticles*sizeof(int));
+}
+
+void CudaUpdateStateDataKernel::setPositions(ContextImpl& context, const vector<Vec3>& positions) {
+    cu.setAsCurrent();
+    int numParticles = context.getSystem().getNumParticles();
+    cu.getPosq().download(cu.getPinnedBuffer());
+
+    // Filling in the buffer is done in parallel for speed.
+
+    cu.getPlatformData().threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        const vector<int>& order = cu.getAtomIndex();
+        int numThreads = threads.getNumThreads();
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        if (cu.getUseDoublePrecision()) {
+            double4* posq = (double4*) cu.getPinnedBuffer();
+            for (int i = start; i < end; ++i) {
+                double4& pos = posq[i];
+                const Vec3& p = positions[order[i]];
+                pos.x = p[0];
+                pos.y = p[1];
+                pos.z = p[2];
+            }
+        }
+        else {
+            float4* posq = (float4*) cu.getPinnedBuffer();
+            for (int i = start; i < end; ++i) {
+                float4& pos = posq[i];
+                const Vec3& p = positions[order[i]];
+                pos.x = (float) p[0];
+                pos.y = (float) p[1];
+                pos.z = (float) p[2];
+            }
+        }
+    });
+    cu.getPlatformData().threads.waitForThreads();
+    if (cu.getUseDoublePrecision()) {
+        double4* posq = (double4*) cu.getPinnedBuffer();
         for (int i = numParticles; i < cu.getPaddedNumAtoms(); i++)
             posq[i] = make_double4(0.0, 0.0, 0.0, 0.0);
         cu.getPosq().upload(posq);
     }
     else {
         float4* posq = (float4*) cu.getPinnedBuffer();
-        cu.getPosq().download(posq);
-        for (int i = 0; i < numParticles; ++i) {
-            float4& pos = posq[i];
-            const Vec3& p = positions[order[i]];
-            pos.x = (float) p[0];
-            pos.y = (float) p[1];
-            pos.z = (float) p[2];
-        }
         for (int i = numParticles; i < cu.getPaddedNumAtoms(); i++)
             posq[i] = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
         cu.getPosq().upload(posq);
     }
     if (cu.getUseMixedPrecision()) {
         float4* posCorrection = (float4*) cu.getPinnedBuffer();
-        for (int i = 0; i < numParticles; ++i) {
-            float4& c = posCorrection[i];
-            const Vec3& p = positions[order[i]];
-            c.x = (float) (p[0]-(float)p[0]);
-            c.y = (float) (p[1]-(float)p[1]);
-            c.z = (float) (p[2]-(float)p[2]);
-            c.w = 0;
-        }
+        cu.getPlatformData().threads.execute([&] (ThreadPool& threads, int threadIndex) {
+            const vector<int>& order = cu.getAtomIndex();
+            int numThreads = threads.getNumThreads();
+            int start = threadIndex*numParticles/numThreads;
+            int end = (threadIndex+1)*numParticles/numThreads;
+            for (int i = start; i < end; ++i) {
+                float4& c = posCorrection[i];
+                const Vec3& p = positions[order[i]];
+                c.x = (float) (p[0]-(float)p[0]);
+                c.y = (float) (p[1]-(float)p[1]);
+                c.z = (float) (p[2]-(float)p[2]);
+                c.w = 0;
+            }
+        });
+        cu.getPlatformData().threads.waitForThreads();
         for (int i = numParticles; i < cu.getPaddedNumAtoms(); i++)
             posCorrection[i] = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
         cu.getPosqCorrection().upload(posCorrection);
@@ -261,63 +566,195 @@ void CudaUpdateStateDataKernel::setPositions(ContextImpl& context, const vector<
 
 void CudaUpdateStateDataKernel::getVelocities(ContextImpl& context, vector<Vec3>& velocities) {
     cu.setAsCurrent();
-    const vector<int>& order = cu.getAtomIndex();
     int numParticles = context.getSystem().getNumParticles();
     velocities.resize(numParticles);
-    if (cu.getUseDoublePrecision() || cu.getUseMixedPrecision()) {
-        double4* velm = (double4*) cu.getPinnedBuffer();
-        cu.getVelm().download(velm);
-        for (int i = 0; i < numParticles; ++i) {
-            double4 vel = velm[i];
-            int4 offset = cu.getPosCellOffsets()[i];
-            velocities[order[i]] = Vec3(vel.x, vel.y, vel.z);
+    cu.getVelm().download(cu.getPinnedBuffer());
+
+    // Filling in the output array is done in parallel for speed.
+
+    cu.getPlatformData().threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        const vector<int>& order = cu.getAtomIndex();
+        int numThreads = threads.getNumThreads();
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        if (cu.getUseDoublePrecision() || cu.getUseMixedPrecision()) {
+            double4* velm = (double4*) cu.getPinnedBuffer();
+            for (int i = start; i < end; ++i) {
+                double4 vel = velm[i];
+                velocities[order[i]] = Vec3(vel.x, vel.y, vel.z);
+            }
         }
-    }
-    else {
-        float4* velm = (float4*) cu.getPinnedBuffer();
-        cu.getVelm().download(velm);
-        for (int i = 0; i < numParticles; ++i) {
-            float4 vel = velm[i];
-            int4 offset = cu.getPosCellOffsets()[i];
-            velocities[order[i]] = Vec3(vel.x, vel.y, vel.z);
+        else {
+            float4* velm = (float4*) cu.getPinnedBuffer();
+            for (int i = start; i < end; ++i) {
+                float4 vel = velm[i];
+                velocities[order[i]] = Vec3(vel.x, vel.y, vel.z);
+            }
         }
-    }
+    });
+    cu.getPlatformData().threads.waitForThreads();
 }
 
 void CudaUpdateStateDataKernel::setVelocities(ContextImpl& context, const vector<Vec3>& velocities) {
     cu.setAsCurrent();
-    const vector<int>& order = cu.getAtomIndex();
     int numParticles = context.getSystem().getNumParticles();
+    cu.getVelm().download(cu.getPinnedBuffer());
+
+    // Filling in the buffer is done in parallel for speed.
+
+    cu.getPlatformData().threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        const vector<int>& order = cu.getAtomIndex();
+        int numThreads = threads.getNumThreads();
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        if (cu.getUseDoublePrecision() || cu.getUseMixedPrecision()) {
+            double4* velm = (double4*) cu.getPinnedBuffer();
+            for (int i = start; i < end; ++i) {
+                double4& vel = velm[i];
+                const Vec3& p = velocities[order[i]];
+                vel.x = p[0];
+                vel.y = p[1];
+                vel.z = p[2];
+            }
+        }
+        else {
+            float4* velm = (float4*) cu.getPinnedBuffer();
+            for (int i = start; i < end; ++i) {
+                float4& vel = velm[i];
+                const Vec3& p = velocities[order[i]];
+                vel.x = p[0];
+                vel.y = p[1];
+                vel.z = p[2];
+            }
+        }
+    });
+    cu.getPlatformData().threads.waitForThreads();
     if (cu.getUseDoublePrecision() || cu.getUseMixedPrecision()) {
         double4* velm = (double4*) cu.getPinnedBuffer();
-        cu.getVelm().download(velm);
-        for (int i = 0; i < numParticles; ++i) {
-            double4& vel = velm[i];
-            const Vec3& p = velocities[order[i]];
-            vel.x = p[0];
-            vel.y = p[1];
-            vel.z = p[2];
-        }
         for (int i = numParticles; i < cu.getPaddedNumAtoms(); i++)
             velm[i] = make_double4(0.0, 0.0, 0.0, 0.0);
         cu.getVelm().upload(velm);
     }
     else {
         float4* velm = (float4*) cu.getPinnedBuffer();
-        cu.getVelm().download(velm);
-        for (int i = 0; i < numParticles; ++i) {
-            float4& vel = velm[i];
-            const Vec3& p = velocities[order[i]];
-            vel.x = p[0];
-            vel.y = p[1];
-            vel.z = p[2];
-        }
         for (int i = numParticles; i < cu.getPaddedNumAtoms(); i++)
             velm[i] = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
         cu.getVelm().upload(velm);
     }
 }
 
+void CudaUpdateStateDataKernel::setPositionsAndVelocities(ContextImpl& context, const vector<Vec3>& positions, const vector<Vec3>& velocities) {
+    cu.setAsCurrent();
+    const vector<int>& order = cu.getAtomIndex();
+    int numParticles = context.getSystem().getNumParticles();
+    int paddedNumAtoms = cu.getPaddedNumAtoms();
+
+    // Stage both arrays in a single pinned buffer.  All the transfers are enqueued on the
+    // same stream, so only the last one in each direction needs to block.
+
+    size_t posqSize = paddedNumAtoms*(cu.getUseDoublePrecision() ? sizeof(double4) : sizeof(float4));
+    size_t velmSize = paddedNumAtoms*(cu.getUseDoublePrecision() || cu.getUseMixedPrecision() ? sizeof(double4) : sizeof(float4));
+    size_t correctionSize = (cu.getUseMixedPrecision() ? paddedNumAtoms*sizeof(float4) : 0);
+    char* pinnedBuffer = (char*) cu.getPinnedBuffer(posqSize+velmSize+correctionSize);
+    void* posqBuffer = pinnedBuffer;
+    void* velmBuffer = pinnedBuffer+posqSize;
+    cu.getPosq().download(posqBuffer, false);
+    cu.getVelm().download(velmBuffer, true);
+
+    // Filling in the buffers is done in parallel for speed.  The three arrays occupy
+    // separate regions of the pinned buffer, so each thread can convert its slice of
+    // all of them.
+
+    cu.getPlatformData().threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        int numThreads = threads.getNumThreads();
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        if (cu.getUseDoublePrecision()) {
+            double4* posq = (double4*) posqBuffer;
+            for (int i = start; i < end; ++i) {
+                double4& pos = posq[i];
+                const Vec3& p = positions[order[i]];
+                pos.x = p[0];
+                pos.y = p[1];
+                pos.z = p[2];
+            }
+        }
+        else {
+            float4* posq = (float4*) posqBuffer;
+            for (int i = start; i < end; ++i) {
+                float4& pos = posq[i];
+                const Vec3& p = positions[order[i]];
+                pos.x = (float) p[0];
+                pos.y = (float) p[1];
+                pos.z = (float) p[2];
+            }
+        }
+        if (cu.getUseMixedPrecision()) {
+            float4* posCorrection = (float4*) (pinnedBuffer+posqSize+velmSize);
+            for (int i = start; i < end; ++i) {
+                float4& c = posCorrection[i];
+                const Vec3& p = positions[order[i]];
+                c.x = (float) (p[0]-(float)p[0]);
+                c.y = (float) (p[1]-(float)p[1]);
+                c.z = (float) (p[2]-(float)p[2]);
+                c.w = 0;
+            }
+        }
+        if (cu.getUseDoublePrecision() || cu.getUseMixedPrecision()) {
+            double4* velm = (double4*) velmBuffer;
+            for (int i = start; i < end; ++i) {
+                double4& vel = velm[i];
+                const Vec3& p = velocities[order[i]];
+                vel.x = p[0];
+                vel.y = p[1];
+                vel.z = p[2];
+            }
+        }
+        else {
+            float4* velm = (float4*) velmBuffer;
+            for (int i = start; i < end; ++i) {
+                float4& vel = velm[i];
+                const Vec3& p = velocities[order[i]];
+                vel.x = (float) p[0];
+                vel.y = (float) p[1];
+                vel.z = (float) p[2];
+            }
+        }
+    });
+    cu.getPlatformData().threads.waitForThreads();
+    if (cu.getUseDoublePrecision()) {
+        double4* posq = (double4*) posqBuffer;
+        for (int i = numParticles; i < paddedNumAtoms; i++)
+            posq[i] = make_double4(0.0, 0.0, 0.0, 0.0);
+    }
+    else {
+        float4* posq = (float4*) posqBuffer;
+        for (int i = numParticles; i < paddedNumAtoms; i++)
+            posq[i] = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+    }
+    if (cu.getUseDoublePrecision() || cu.getUseMixedPrecision()) {
+        double4* velm = (double4*) velmBuffer;
+        for (int i = numParticles; i < paddedNumAtoms; i++)
+            velm[i] = make_double4(0.0, 0.0, 0.0, 0.0);
+    }
+    else {
+        float4* velm = (float4*) velmBuffer;
+        for (int i = numParticles; i < paddedNumAtoms; i++)
+            velm[i] = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+    }
+    cu.getPosq().upload(posqBuffer, false);
+    if (cu.getUseMixedPrecision()) {
+        float4* posCorrection = (float4*) (pinnedBuffer+posqSize+velmSize);
+        for (int i = numParticles; i < paddedNumAtoms; i++)
+            posCorrection[i] = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+        cu.getPosqCorrection().upload(posCorrection, false);
+    }
+    cu.getVelm().upload(velmBuffer, true);
+    for (auto& offset : cu.getPosCellOffsets())
+        offset = make_int4(0, 0, 0, 0);
+    cu.reorderAtoms();
+}
+
 void CudaUpdateStateDataKernel::getForces(ContextImpl& context, vector<Vec3>& forces) {
     cu.setAsCurrent();
     long long* force = (long long*) cu.getPinnedBuffer();
@@ -327,8 +764,17 @@ void CudaUpdateStateDataKernel::getForces(ContextImpl& context, vector<Vec3>& fo
     int paddedNumParticles = cu.getPaddedNumAtoms();
     forces.resize(numParticles);
     double scale = 1.0/(double) 0x100000000LL;
-    for (int i = 0; i < numParticles; ++i)
-        forces[order[i]] = Vec3(scale*force[i], scale*force[i+paddedNumParticles], scale*force[i+paddedNumParticles*2]);
+
+    // Filling in the output array is done in parallel for speed.
+
+    cu.getPlatformData().threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        int numThreads = threads.getNumThreads();
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        for (int i = start; i < end; ++i)
+            forces[order[i]] = Vec3(scale*force[i], scale*force[i+paddedNumParticles], scale*force[i+paddedNumParticles*2]);
+    });
+    cu.getPlatformData().threads.waitForThreads();
 }
 
 void CudaUpdateStateDataKernel::getEnergyParameterDerivatives(ContextImpl& context, map<string, double>& derivs) {
@@ -1593,9 +2039,9 @@ CudaCalcNonbondedForceKernel::~CudaCalcNonbondedForceKernel() {
         delete exceptionParams;
     if (cosSinSums != NULL)
         delete cosSinSums;
-    if (directPmeGrid != NULL)
+    if (directPmeGrid != NULL && ownsDirectPmeGrid)
         delete directPmeGrid;
-    if (reciprocalPmeGrid != NULL)
+    if (reciprocalPmeGrid != NULL && ownsReciprocalPmeGrid)
         delete reciprocalPmeGrid;
     if (pmeBsplineModuliX != NULL)
         delete pmeBsplineModuliX;
@@ -1719,8 +2165,10 @@ void CudaCalcNonbondedForceKernel::initialize(const System& system, const Nonbon
             defines["LJ_SWITCH_C5"] = cu.doubleToString(6/pow(force.getSwitchingDistance()-force.getCutoffDistance(), 5.0));
         }
     }
-    if (force.getUseDispersionCorrection() && cu.getContextIndex() == 0 && !doLJPME)
-        dispersionCoefficient = NonbondedForceImpl::calcDispersionCorrection(system, force);
+    if (force.getUseDispersionCorrection() && cu.getContextIndex() == 0 && !doLJPME) {
+        longRangeCorrectionData = NonbondedForceImpl::prepareLongRangeCorrection(force);
+        dispersionCoefficient = NonbondedForceImpl::calcLongRangeCorrection(longRangeCorrectionData, force, system);
+    }
     else
         dispersionCoefficient = 0.0;
     alpha = 0;
@@ -1816,6 +2264,12 @@ void CudaCalcNonbondedForceKernel::initialize(const System& system, const Nonbon
                 }
             }
             if (pmeio == NULL) {
+                // With three or more devices, the reciprocal space sum is expensive enough that it
+                // is best to dedicate this device to it, letting the others divide the direct space
+                // work between them.
+
+                if (cu.getPlatformData().contexts.size() > 2)
+                    cu.getPlatformData().dedicatedPmeDevice = true;
                 pmeGridIndexKernel = cu.getKernel(module, "findAtomGridIndex");
                 pmeSpreadChargeKernel = cu.getKernel(module, "gridSpreadCharge");
                 pmeConvolutionKernel = cu.getKernel(module, "reciprocalConvolution");
@@ -1855,9 +2309,30 @@ void CudaCalcNonbondedForceKernel::initialize(const System& system, const Nonbon
                 int gridElements = gridSizeX*gridSizeY*gridSizeZ;
                 if (doLJPME)
                     gridElements = max(gridElements, dispersionGridSizeX*dispersionGridSizeY*dispersionGridSizeZ);
-                directPmeGrid = new CudaArray(cu, gridElements, cu.getComputeCapability() >= 2.0 ? 2*elementSize : 2*sizeof(long long), "originalPmeGrid");
-                reciprocalPmeGrid = new CudaArray(cu, gridElements, 2*elementSize, "reciprocalPmeGrid");
-                cu.addAutoclearBuffer(*directPmeGrid);
+                // A system can contain several forces that each evaluate PME, such as AMOEBA
+                // electrostatics alongside a standard NonbondedForce.  The grids only hold data
+                // within a single evaluation, so compatible allocations are shared through the
+                // context.  That is only safe when the reciprocal space work all happens on the
+                // default stream.
+
+                int directElementSize = (cu.getComputeCapability() >= 2.0 ? 2*elementSize : 2*(int) sizeof(long long));
+                if (!usePmeStream) {
+                    directPmeGrid = cu.findPmeGrid((long long) gridElements*directElementSize, 0);
+                    reciprocalPmeGrid = cu.findPmeGrid((long long) gridElements*2*elementSize, 1);
+                }
+                ownsDirectPmeGrid = (directPmeGrid == NULL);
+                ownsReciprocalPmeGrid = (reciprocalPmeGrid == NULL);
+                if (ownsDirectPmeGrid) {
+                    directPmeGrid = new CudaArray(cu, gridElements, directElementSize, "originalPmeGrid");
+                    cu.addAutoclearBuffer(*directPmeGrid);
+                    if (!usePmeStream)
+                        cu.registerPmeGrid(directPmeGrid);
+                }
+                if (ownsReciprocalPmeGrid) {
+                    reciprocalPmeGrid = new CudaArray(cu, gridElements, 2*elementSize, "reciprocalPmeGrid");
+                    if (!usePmeStream)
+                        cu.registerPmeGrid(reciprocalPmeGrid);
+                }
                 pmeBsplineModuliX = new CudaArray(cu, gridSizeX, elementSize, "pmeBsplineModuliX");
                 pmeBsplineModuliY = new CudaArray(cu, gridSizeY, elementSize, "pmeBsplineModuliY");
                 pmeBsplineModuliZ = new CudaArray(cu, gridSizeZ, elementSize, "pmeBsplineModuliZ");
@@ -2050,7 +2525,7 @@ void CudaCalcNonbondedForceKernel::initialize(const System& system, const Nonbon
 double CudaCalcNonbondedForceKernel::execute(ContextImpl& context, bool includeForces, bool includeEnergy, bool includeDirect, bool includeReciprocal) {
     if (cosSinSums != NULL && includeReciprocal) {
         void* sumsArgs[] = {&cu.getEnergyBuffer().getDevicePointer(), &cu.getPosq().getDevicePointer(), &cosSinSums->getDevicePointer(), cu.getPeriodicBoxSizePointer()};
-        cu.executeKernel(ewaldSumsKernel, sumsArgs, cosSinSums->getSize());
+        cu.executeKernel(ewaldSumsKernel, sumsArgs, cosSinSums->getSize()*CudaContext::ThreadBlockSize, CudaContext::ThreadBlockSize, CudaContext::ThreadBlockSize*cosSinSums->getElementSize());
         void* forcesArgs[] = {&cu.getForce().getDevicePointer(), &cu.getPosq().getDevicePointer(), &cosSinSums->getDevicePointer(), cu.getPeriodicBoxSizePointer()};
         cu.executeKernel(ewaldForcesKernel, forcesArgs, cu.getNumAtoms());
     }
@@ -2093,6 +2568,11 @@ double CudaCalcNonbondedForceKernel::execute(ContextImpl& context, bool includeF
 
         sort->sort(*pmeAtomGridIndex);
 
+        if (cu.isPmeGridShared(directPmeGrid)) {
+            // Another force may have used the grid since it was autocleared.
+
+            cu.clearBuffer(*directPmeGrid);
+        }
         void* spreadArgs[] = {&cu.getPosq().getDevicePointer(), &directPmeGrid->getDevicePointer(), cu.getPeriodicBoxSizePointer(),
                 cu.getInvPeriodicBoxSizePointer(), cu.getPeriodicBoxVecXPointer(), cu.getPeriodicBoxVecYPointer(), cu.getPeriodicBoxVecZPointer(),
                 recipBoxVectorPointer[0], recipBoxVectorPointer[1], recipBoxVectorPointer[2], &pmeAtomGridIndex->getDevicePointer()};
@@ -2117,7 +2597,8 @@ double CudaCalcNonbondedForceKernel::execute(ContextImpl& context, bool includeF
             void* computeEnergyArgs[] = {&reciprocalPmeGrid->getDevicePointer(), usePmeStream ? &pmeEnergyBuffer->getDevicePointer() : &cu.getEnergyBuffer().getDevicePointer(),
                     &pmeBsplineModuliX->getDevicePointer(), &pmeBsplineModuliY->getDevicePointer(), &pmeBsplineModuliZ->getDevicePointer(),
                     cu.getPeriodicBoxSizePointer(), recipBoxVectorPointer[0], recipBoxVectorPointer[1], recipBoxVectorPointer[2]};
-            cu.executeKernel(pmeEvalEnergyKernel, computeEnergyArgs, gridSizeX*gridSizeY*gridSizeZ);
+            int energyElementSize = (cu.getUseDoublePrecision() || cu.getUseMixedPrecision() ? sizeof(double) : sizeof(float));
+            cu.executeKernel(pmeEvalEnergyKernel, computeEnergyArgs, gridSizeX*gridSizeY*gridSizeZ, CudaContext::ThreadBlockSize, CudaContext::ThreadBlockSize*energyElementSize);
         }
 
         void* convolutionArgs[] = {&reciprocalPmeGrid->getDevicePointer(), &cu.getEnergyBuffer().getDevicePointer(),
@@ -2176,7 +2657,8 @@ double CudaCalcNonbondedForceKernel::execute(ContextImpl& context, bool includeF
                 void* computeEnergyArgs[] = {&reciprocalPmeGrid->getDevicePointer(), usePmeStream ? &pmeEnergyBuffer->getDevicePointer() : &cu.getEnergyBuffer().getDevicePointer(),
                         &pmeDispersionBsplineModuliX->getDevicePointer(), &pmeDispersionBsplineModuliY->getDevicePointer(), &pmeDispersionBsplineModuliZ->getDevicePointer(),
                         cu.getPeriodicBoxSizePointer(), recipBoxVectorPointer[0], recipBoxVectorPointer[1], recipBoxVectorPointer[2]};
-                cu.executeKernel(pmeEvalDispersionEnergyKernel, computeEnergyArgs, dispersionGridSizeX*dispersionGridSizeY*dispersionGridSizeZ);
+                int energyElementSize = (cu.getUseDoublePrecision() || cu.getUseMixedPrecision() ? sizeof(double) : sizeof(float));
+                cu.executeKernel(pmeEvalDispersionEnergyKernel, computeEnergyArgs, dispersionGridSizeX*dispersionGridSizeY*dispersionGridSizeZ, CudaContext::ThreadBlockSize, CudaContext::ThreadBlockSize*energyElementSize);
             }
 
             void* convolutionArgs[] = {&reciprocalPmeGrid->getDevicePointer(), &cu.getEnergyBuffer().getDevicePointer(),
@@ -2214,14 +2696,16 @@ double CudaCalcNonbondedForceKernel::execute(ContextImpl& context, bool includeF
     return energy;
 }
 
-void CudaCalcNonbondedForceKernel::copyParametersToContext(ContextImpl& context, const NonbondedForce& force) {
+void CudaCalcNonbondedForceKernel::copyParametersToContext(ContextImpl& context, const NonbondedForce& force, int firstParticle, int lastParticle, int firstException, int lastException) {
     // Make sure the new parameters are acceptable.
-    
+
     cu.setAsCurrent();
     if (force.getNumParticles() != cu.getNumAtoms())
         throw OpenMMException("updateParametersInContext: The number of particles has changed");
+    if (firstParticle > lastParticle && firstException > lastException)
+        return;
     if (!hasCoulomb || !hasLJ) {
-        for (int i = 0; i < force.getNumParticles(); i++) {
+        for (int i = firstParticle; i <= lastParticle; i++) {
             double charge, sigma, epsilon;
             force.getParticleParameters(i, charge, sigma, epsilon);
             if (!hasCoulomb && charge != 0.0)
@@ -2244,49 +2728,64 @@ void CudaCalcNonbondedForceKernel::copyParametersToContext(ContextImpl& context,
     int startIndex = cu.getContextIndex()*exceptions.size()/numContexts;
     int endIndex = (cu.getContextIndex()+1)*exceptions.size()/numContexts;
     int numExceptions = endIndex-startIndex;
-    
+
     // Record the per-particle parameters.
-    
-    vector<double> chargeVector(cu.getNumAtoms());
-    vector<float2> sigmaEpsilonVector(cu.getPaddedNumAtoms(), make_float2(0, 0));
-    double sumSquaredCharges = 0.0;
-    double sumSquaredC6 = 0.0;
-    const vector<int>& order = cu.getAtomIndex();
-    for (int i = 0; i < force.getNumParticles(); i++) {
-        double charge, sigma, epsilon;
-        force.getParticleParameters(i, charge, sigma, epsilon);
-        chargeVector[i] = charge;
-        double sig = (0.5*sigma);
-        double eps = (2.0*sqrt(epsilon));
-        sigmaEpsilonVector[i] = make_float2((float) sig, (float) eps);
-        double C6 = 8.0*sig*sig*sig*eps;
-        sumSquaredC6 += C6*C6;
-        sumSquaredCharges += charge*charge;
+
+    if (firstParticle <= lastParticle) {
+        vector<double> chargeVector(cu.getNumAtoms());
+        vector<float2> sigmaEpsilonVector(lastParticle-firstParticle+1);
+        double sumSquaredCharges = 0.0;
+        double sumSquaredC6 = 0.0;
+        for (int i = 0; i < force.getNumParticles(); i++) {
+            double charge, sigma, epsilon;
+            force.getParticleParameters(i, charge, sigma, epsilon);
+            chargeVector[i] = charge;
+            double sig = (0.5*sigma);
+            double eps = (2.0*sqrt(epsilon));
+            if (i >= firstParticle && i <= lastParticle)
+                sigmaEpsilonVector[i-firstParticle] = make_float2((float) sig, (float) eps);
+            double C6 = 8.0*sig*sig*sig*eps;
+            sumSquaredC6 += C6*C6;
+            sumSquaredCharges += charge*charge;
+        }
+        cu.setCharges(chargeVector);
+        sigmaEpsilon->uploadSubArray(&sigmaEpsilonVector[0], firstParticle, sigmaEpsilonVector.size());
+
+        // Compute other values that depend on the particle parameters.
+
+        if (nonbondedMethod == Ewald || nonbondedMethod == PME || nonbondedMethod == LJPME)
+            ewaldSelfEnergy = (cu.getContextIndex() == 0 ? -ONE_4PI_EPS0*alpha*sumSquaredCharges/sqrt(M_PI) : 0.0);
+        if (nonbondedMethod == LJPME)
+            ewaldSelfEnergy += (cu.getContextIndex() == 0 ? pow(dispersionAlpha, 6)*sumSquaredC6/12.0 : 0);
+        if (force.getUseDispersionCorrection() && cu.getContextIndex() == 0 && (nonbondedMethod == CutoffPeriodic || nonbondedMethod == Ewald || nonbondedMethod == PME)) {
+            NonbondedForceImpl::updateLongRangeCorrection(longRangeCorrectionData, force, firstParticle, lastParticle);
+            dispersionCoefficient = NonbondedForceImpl::calcLongRangeCorrection(longRangeCorrectionData, force, context.getSystem());
+        }
     }
-    cu.setCharges(chargeVector);
-    sigmaEpsilon->upload(sigmaEpsilonVector);
-    
+
     // Record the exceptions.
-    
-    if (numExceptions > 0) {
-        vector<vector<int> > atoms(numExceptions, vector<int>(2));
-        vector<float4> exceptionParamsVector(numExceptions);
+
+    if (numExceptions > 0 && firstException <= lastException) {
+        // Find the range of exceptions this context owns whose parameters changed.
+
+        int firstIndex = numExceptions, lastIndex = -1;
         for (int i = 0; i < numExceptions; i++) {
-            double chargeProd, sigma, epsilon;
-            force.getExceptionParameters(exceptions[startIndex+i], atoms[i][0], atoms[i][1], chargeProd, sigma, epsilon);
-            exceptionParamsVector[i] = make_float4((float) (ONE_4PI_EPS0*chargeProd), (float) sigma, (float) (4.0*epsilon), 0.0f);
+            if (exceptions[startIndex+i] >= firstException && exceptions[startIndex+i] <= lastException) {
+                firstIndex = min(firstIndex, i);
+                lastIndex = max(lastIndex, i);
+            }
+        }
+        if (firstIndex <= lastIndex) {
+            vector<float4> exceptionParamsVector(lastIndex-firstIndex+1);
+            for (int i = firstIndex; i <= lastIndex; i++) {
+                int atom1, atom2;
+                double chargeProd, sigma, epsilon;
+                force.getExceptionParameters(exceptions[startIndex+i], atom1, atom2, chargeProd, sigma, epsilon);
+                exceptionParamsVector[i-firstIndex] = make_float4((float) (ONE_4PI_EPS0*chargeProd), (float) sigma, (float) (4.0*epsilon), 0.0f);
+            }
+            exceptionParams->uploadSubArray(&exceptionParamsVector[0], firstIndex, exceptionParamsVector.size());
         }
-        exceptionParams->upload(exceptionParamsVector);
     }
-    
-    // Compute other values.
-    
-    if (nonbondedMethod == Ewald || nonbondedMethod == PME || nonbondedMethod == LJPME)
-        ewaldSelfEnergy = (cu.getContextIndex() == 0 ? -ONE_4PI_EPS0*alpha*sumSquaredCharges/sqrt(M_PI) : 0.0);
-    if (nonbondedMethod == LJPME)
-        ewaldSelfEnergy += (cu.getContextIndex() == 0 ? pow(dispersionAlpha, 6)*sumSquaredC6/12.0 : 0);
-    if (force.getUseDispersionCorrection() && cu.getContextIndex() == 0 && (nonbondedMethod == CutoffPeriodic || nonbondedMethod == Ewald || nonbondedMethod == PME))
-        dispersionCoefficient = NonbondedForceImpl::calcDispersionCorrection(context.getSystem(), force);
     cu.invalidateMolecules();
 }
 
@@ -2764,13 +3263,13 @@ double CudaCalcCustomNonbondedForceKernel::execute(ContextImpl& context, bool in
         if (changed) {
             globals->upload(globalParamValues);
             if (forceCopy != NULL) {
-                CustomNonbondedForceImpl::calcLongRangeCorrection(*forceCopy, context.getOwner(), longRangeCoefficient, longRangeCoefficientDerivs);
+                CustomNonbondedForceImpl::calcLongRangeCorrection(*forceCopy, longRangeCorrectionData, context.getOwner(), longRangeCoefficient, longRangeCoefficientDerivs);
                 hasInitializedLongRangeCorrection = true;
             }
         }
     }
     if (!hasInitializedLongRangeCorrection) {
-        CustomNonbondedForceImpl::calcLongRangeCorrection(*forceCopy, context.getOwner(), longRangeCoefficient, longRangeCoefficientDerivs);
+        CustomNonbondedForceImpl::calcLongRangeCorrection(*forceCopy, longRangeCorrectionData, context.getOwner(), longRangeCoefficient, longRangeCoefficientDerivs);
         hasInitializedLongRangeCorrection = true;
     }
     if (interactionGroupData != NULL) {
@@ -2824,7 +3323,7 @@ void CudaCalcCustomNonbondedForceKernel::copyParametersToContext(ContextImpl& co
     // If necessary, recompute the long range correction.
     
     if (forceCopy != NULL) {
-        CustomNonbondedForceImpl::calcLongRangeCorrection(force, context.getOwner(), longRangeCoefficient, longRangeCoefficientDerivs);
+        CustomNonbondedForceImpl::calcLongRangeCorrection(force, longRangeCorrectionData, context.getOwner(), longRangeCoefficient, longRangeCoefficientDerivs);
         hasInitializedLongRangeCorrection = true;
         *forceCopy = force;
     }
@@ -4205,6 +4704,47 @@ void CudaCalcCustomExternalForceKernel::copyParametersToContext(ContextImpl& con
     cu.invalidateMolecules();
 }
 
+void CudaCalcCustomExternalForceKernel::copyParametersToContext(ContextImpl& context, const CustomExternalForce& force, const vector<int>& changedParticles) {
+    cu.setAsCurrent();
+    int numContexts = cu.getPlatformData().contexts.size();
+    int startIndex = cu.getContextIndex()*force.getNumParticles()/numContexts;
+    int endIndex = (cu.getContextIndex()+1)*force.getNumParticles()/numContexts;
+    if (numParticles != endIndex-startIndex)
+        throw OpenMMException("updateSelectedParametersInContext: The number of particles has changed");
+
+    // Find the terms this context is responsible for, and group them into contiguous blocks
+    // so each block can be uploaded with a single transfer.
+
+    vector<int> local;
+    for (int index : changedParticles) {
+        if (index < 0 || index >= force.getNumParticles())
+            throw OpenMMException("updateSelectedParametersInContext: Illegal particle index");
+        if (index >= startIndex && index < endIndex)
+            local.push_back(index-startIndex);
+    }
+    sort(local.begin(), local.end());
+    int particle;
+    vector<double> parameters;
+    for (int start = 0; start < (int) local.size(); ) {
+        int end = start+1;
+        while (end < (int) local.size() && local[end] == local[end-1]+1)
+            end++;
+        vector<vector<float> > paramVector(end-start);
+        for (int i = start; i < end; i++) {
+            force.getParticleParameters(startIndex+local[i], particle, parameters);
+            paramVector[i-start].resize(parameters.size());
+            for (int j = 0; j < (int) parameters.size(); j++)
+                paramVector[i-start][j] = (float) parameters[j];
+        }
+        params->setParameterValuesSubset(local[start], paramVector);
+        start = end;
+    }
+
+    // Mark that the current reordering may be invalid.
+
+    cu.invalidateMolecules();
+}
+
 class CudaCalcCustomHbondForceKernel::ForceInfo : public CudaForceInfo {
 public:
     ForceInfo(const CustomHbondForce& force) : force(force) {
@@ -5505,10 +6045,92 @@ void CudaCalcCustomCompoundBondForceKernel::copyParametersToContext(ContextImpl&
     params->setParameterValues(paramVector);
     
     // Mark that the current reordering may be invalid.
-    
+
     cu.invalidateMolecules();
 }
 
+void CudaCalcCustomCVForceKernel::initialize(const System& system, const CustomCVForce& force, ContextImpl& innerContext) {
+    // Create the expressions.
+
+    Lepton::ParsedExpression expression = Lepton::Parser::parse(force.getEnergyFunction()).optimize();
+    energyExpression = expression.createProgram();
+    for (int i = 0; i < force.getNumCollectiveVariables(); i++) {
+        string name = force.getCollectiveVariableName(i);
+        variableNames.push_back(name);
+        variableDerivExpressions.push_back(expression.differentiate(name).optimize().createProgram());
+    }
+    for (int i = 0; i < force.getNumGlobalParameters(); i++)
+        globalParameterNames.push_back(force.getGlobalParameterName(i));
+
+    // Create the kernel that adds the combined forces to the main buffer.
+
+    cu.setAsCurrent();
+    CUmodule module = cu.createModule(CudaKernelSources::customCVForce);
+    addForcesKernel = cu.getKernel(module, "addForces");
+    cvForces.initialize<double>(cu, 3*cu.getNumAtoms(), "cvForces");
+}
+
+double CudaCalcCustomCVForceKernel::execute(ContextImpl& context, ContextImpl& innerContext, bool includeForces, bool includeEnergy) {
+    int numCVs = variableNames.size();
+    map<string, double> variables;
+    for (auto& name : globalParameterNames)
+        variables[name] = context.getParameter(name);
+
+    // Compute the value of each collective variable, along with the forces it generates.
+    // Each variable is in its own force group in the inner context, so they can be
+    // evaluated separately.
+
+    vector<vector<Vec3> > cvForceValues(numCVs);
+    for (int i = 0; i < numCVs; i++) {
+        variables[variableNames[i]] = innerContext.calcForcesAndEnergy(includeForces, true, 1<<i);
+        if (includeForces)
+            innerContext.getForces(cvForceValues[i]);
+    }
+
+    // Evaluate the energy expression, then apply the chain rule.  The weighted sum of the
+    // variables' forces is computed on the host and added to the force buffer on the device.
+
+    double energy = energyExpression.evaluate(variables);
+    if (includeForces) {
+        cu.setAsCurrent();
+        int numAtoms = cu.getNumAtoms();
+        int paddedNumAtoms = cu.getPaddedNumAtoms();
+        double* buffer = (double*) cu.getPinnedBuffer(3*numAtoms*sizeof(double));
+        for (int i = 0; i < 3*numAtoms; i++)
+            buffer[i] = 0.0;
+        for (int i = 0; i < numCVs; i++) {
+            double dEdV = variableDerivExpressions[i].evaluate(variables);
+            for (int j = 0; j < numAtoms; j++)
+                for (int k = 0; k < 3; k++)
+                    buffer[3*j+k] += dEdV*cvForceValues[i][j][k];
+        }
+        cvForces.upload(buffer);
+        void* args[] = {&cvForces.getDevicePointer(), &cu.getForce().getDevicePointer(), &cu.getAtomIndexArray().getDevicePointer(), &numAtoms, &paddedNumAtoms};
+        cu.executeKernel(addForcesKernel, args, numAtoms);
+    }
+    return energy;
+}
+
+void CudaCalcCustomCVForceKernel::copyState(ContextImpl& context, ContextImpl& innerContext) {
+    int numParticles = context.getSystem().getNumParticles();
+    vector<Vec3> positions(numParticles);
+    context.getPositions(positions);
+    innerContext.setPositions(positions);
+    Vec3 a, b, c;
+    context.getPeriodicBoxVectors(a, b, c);
+    innerContext.setPeriodicBoxVectors(a, b, c);
+
+    // Copy the values of any parameters the two contexts have in common, such as global
+    // parameters defined by the forces that compute the collective variables.
+
+    const map<string, double>& outerParameters = context.getParameters();
+    for (auto& param : innerContext.getParameters()) {
+        map<string, double>::const_iterator outer = outerParameters.find(param.first);
+        if (outer != outerParameters.end() && outer->second != param.second)
+            innerContext.setParameter(param.first, outer->second);
+    }
+}
+
 class CudaCalcCustomManyParticleForceKernel::ForceInfo : public CudaForceInfo {
 public:
     ForceInfo(const CustomManyParticleForce& force) : force(force) {
@@ -6134,7 +6756,7 @@ double CudaCalcCustomManyParticleForceKernel::execute(ContextImpl& context, bool
         if (nonbondedMethod != NoCutoff) {
             // Make sure there was enough memory for the neighbor list.
 
-            CHECK_RESULT(cuEventSynchronize(event), "Error synchronizing on event for CustomManyParticleForce");
+            cu.synchronizeEvent(event);
             if (*numPairs > maxNeighborPairs) {
                 // Resize the arrays and run the calculation again.
 
@@ -6485,7 +7107,7 @@ double CudaCalcGayBerneForceKernel::execute(ContextImpl& context, bool includeFo
             neighborBlockCount->download(count, false);
             CHECK_RESULT(cuEventRecord(event, 0), "Error recording event for GayBerneForce");
             cu.executeKernel(forceKernel, &forceArgs[0], cu.getNonbondedUtilities().getNumForceThreadBlocks()*cu.getNonbondedUtilities().getForceThreadBlockSize());
-            CHECK_RESULT(cuEventSynchronize(event), "Error synchronizing on event for GayBerneForce");
+            cu.synchronizeEvent(event);
             if (*count <= maxNeighborBlocks)
                 break;
             
@@ -6618,20 +7240,56 @@ void CudaIntegrateVerletStepKernel::initialize(const System& system, const Verle
     CUmodule module = cu.createModule(CudaKernelSources::verlet, defines, "");
     kernel1 = cu.getKernel(module, "integrateVerletPart1");
     kernel2 = cu.getKernel(module, "integrateVerletPart2");
+    prevTol = -1.0;
 }
 
 void CudaIntegrateVerletStepKernel::execute(ContextImpl& context, const VerletIntegrator& integrator) {
     cu.setAsCurrent();
+    CudaIntegrationUtilities& integration = cu.getIntegrationUtilities();
+    double dt = integrator.getStepSize();
+    integration.setNextStepSize(dt);
+    if (integrator.getConstraintTolerance() != prevTol) {
+        // The tolerance is passed to the constraint kernels by value, so any captured sequence
+        // would still contain the old one.
+
+        cu.invalidateCapturedSequences();
+        prevTol = integrator.getConstraintTolerance();
+    }
+
+    // The sequence of kernels making up a step never changes, so replay it as a CUDA graph if
+    // one has been captured.  Otherwise execute the kernels individually, capturing them so
+    // later steps can skip the individual launches.
+
+    if (!cu.executeCapturedSequence(this)) {
+        bool capturing = integration.constraintsAreCapturable() && cu.beginCaptureSequence(this);
+        executeStepKernels(integrator);
+        if (capturing) {
+            if (cu.endCaptureSequence())
+                cu.executeCapturedSequence(this);
+            else {
+                // The capture failed, which means the kernels were never actually executed.
+
+                executeStepKernels(integrator);
+            }
+        }
+    }
+
+    // Update the time and step count.
+
+    cu.setTime(cu.getTime()+dt);
+    cu.setStepCount(cu.getStepCount()+1);
+    cu.reorderAtoms();
+}
+
+void CudaIntegrateVerletStepKernel::executeStepKernels(const VerletIntegrator& integrator) {
     CudaIntegrationUtilities& integration = cu.getIntegrationUtilities();
     int numAtoms = cu.getNumAtoms();
     int paddedNumAtoms = cu.getPaddedNumAtoms();
-    double dt = integrator.getStepSize();
-    cu.getIntegrationUtilities().setNextStepSize(dt);
 
     // Call the first integration kernel.
 
     CUdeviceptr posCorrection = (cu.getUseMixedPrecision() ? cu.getPosqCorrection().getDevicePointer() : 0);
-    void* args1[] = {&numAtoms, &paddedNumAtoms, &cu.getIntegrationUtilities().getStepSize().getDevicePointer(), &cu.getPosq().getDevicePointer(), &posCorrection,
+    void* args1[] = {&numAtoms, &paddedNumAtoms, &integration.getStepSize().getDevicePointer(), &cu.getPosq().getDevicePointer(), &posCorrection,
             &cu.getVelm().getDevicePointer(), &cu.getForce().getDevicePointer(), &integration.getPosDelta().getDevicePointer()};
     cu.executeKernel(kernel1, args1, numAtoms, 128);
 
@@ -6641,16 +7299,10 @@ void CudaIntegrateVerletStepKernel::execute(ContextImpl& context, const VerletIn
 
     // Call the second integration kernel.
 
-    void* args2[] = {&numAtoms, &cu.getIntegrationUtilities().getStepSize().getDevicePointer(), &cu.getPosq().getDevicePointer(), &posCorrection,
+    void* args2[] = {&numAtoms, &integration.getStepSize().getDevicePointer(), &cu.getPosq().getDevicePointer(), &posCorrection,
             &cu.getVelm().getDevicePointer(), &integration.getPosDelta().getDevicePointer()};
     cu.executeKernel(kernel2, args2, numAtoms, 128);
     integration.computeVirtualSites();
-
-    // Update the time and step count.
-
-    cu.setTime(cu.getTime()+dt);
-    cu.setStepCount(cu.getStepCount()+1);
-    cu.reorderAtoms();
 }
 
 double CudaIntegrateVerletStepKernel::computeKineticEnergy(ContextImpl& context, const VerletIntegrator& integrator) {
@@ -6673,13 +7325,12 @@ void CudaIntegrateLangevinStepKernel::initialize(const System& system, const Lan
     kernel2 = cu.getKernel(module, "integrateLangevinPart2");
     params = new CudaArray(cu, 3, cu.getUseDoublePrecision() || cu.getUseMixedPrecision() ? sizeof(double) : sizeof(float), "langevinParams");
     prevStepSize = -1.0;
+    prevTol = -1.0;
 }
 
 void CudaIntegrateLangevinStepKernel::execute(ContextImpl& context, const LangevinIntegrator& integrator) {
     cu.setAsCurrent();
     CudaIntegrationUtilities& integration = cu.getIntegrationUtilities();
-    int numAtoms = cu.getNumAtoms();
-    int paddedNumAtoms = cu.getPaddedNumAtoms();
     double temperature = integrator.getTemperature();
     double friction = integrator.getFriction();
     double stepSize = integrator.getStepSize();
@@ -6709,10 +7360,49 @@ void CudaIntegrateLangevinStepKernel::execute(ContextImpl& context, const Langev
         prevFriction = friction;
         prevStepSize = stepSize;
     }
+    if (integrator.getConstraintTolerance() != prevTol) {
+        // The tolerance is passed to the constraint kernels by value, so any captured sequence
+        // would still contain the old one.
 
-    // Call the first integration kernel.
+        cu.invalidateCapturedSequences();
+        prevTol = integrator.getConstraintTolerance();
+    }
+
+    // The sequence of kernels making up a step is fixed for each offset into the buffer of
+    // random values, so replay the sequence for this offset as a CUDA graph if one has been
+    // captured.  prepareRandomNumbers() refills the buffer before the offset wraps around,
+    // so a replayed sequence always consumes fresh random values.
 
     int randomIndex = integration.prepareRandomNumbers(cu.getPaddedNumAtoms());
+    const void* sequenceId = &sequenceKeys[randomIndex];
+    if (!cu.executeCapturedSequence(sequenceId)) {
+        bool capturing = integration.constraintsAreCapturable() && cu.beginCaptureSequence(sequenceId);
+        executeStepKernels(integrator, randomIndex);
+        if (capturing) {
+            if (cu.endCaptureSequence())
+                cu.executeCapturedSequence(sequenceId);
+            else {
+                // The capture failed, which means the kernels were never actually executed.
+
+                executeStepKernels(integrator, randomIndex);
+            }
+        }
+    }
+
+    // Update the time and step count.
+
+    cu.setTime(cu.getTime()+stepSize);
+    cu.setStepCount(cu.getStepCount()+1);
+    cu.reorderAtoms();
+}
+
+void CudaIntegrateLangevinStepKernel::executeStepKernels(const LangevinIntegrator& integrator, int randomIndex) {
+    CudaIntegrationUtilities& integration = cu.getIntegrationUtilities();
+    int numAtoms = cu.getNumAtoms();
+    int paddedNumAtoms = cu.getPaddedNumAtoms();
+
+    // Call the first integration kernel.
+
     void* args1[] = {&numAtoms, &paddedNumAtoms, &cu.getVelm().getDevicePointer(), &cu.getForce().getDevicePointer(), &integration.getPosDelta().getDevicePointer(),
             &params->getDevicePointer(), &integration.getStepSize().getDevicePointer(), &integration.getRandom().getDevicePointer(), &randomIndex};
     cu.executeKernel(kernel1, args1, numAtoms, 128);
@@ -6728,6 +7418,93 @@ void CudaIntegrateLangevinStepKernel::execute(ContextImpl& context, const Langev
             &cu.getVelm().getDevicePointer(), &integration.getStepSize().getDevicePointer()};
     cu.executeKernel(kernel2, args2, numAtoms, 128);
     integration.computeVirtualSites();
+}
+
+double CudaIntegrateLangevinStepKernel::computeKineticEnergy(ContextImpl& context, const LangevinIntegrator& integrator) {
+    return cu.getIntegrationUtilities().computeKineticEnergy(0.5*integrator.getStepSize());
+}
+
+CudaIntegrateLangevinMiddleStepKernel::~CudaIntegrateLangevinMiddleStepKernel() {
+    cu.setAsCurrent();
+    if (params != NULL)
+        delete params;
+    if (oldDelta != NULL)
+        delete oldDelta;
+}
+
+void CudaIntegrateLangevinMiddleStepKernel::initialize(const System& system, const LangevinMiddleIntegrator& integrator) {
+    cu.getPlatformData().initializeContexts(system);
+    cu.setAsCurrent();
+    cu.getIntegrationUtilities().initRandomNumberGenerator(integrator.getRandomNumberSeed());
+    map<string, string> defines;
+    CUmodule module = cu.createModule(CudaKernelSources::langevinMiddle, defines, "");
+    kernel1 = cu.getKernel(module, "integrateLangevinMiddlePart1");
+    kernel2 = cu.getKernel(module, "integrateLangevinMiddlePart2");
+    kernel3 = cu.getKernel(module, "integrateLangevinMiddlePart3");
+    bool useDouble = cu.getUseDoublePrecision() || cu.getUseMixedPrecision();
+    params = new CudaArray(cu, 2, useDouble ? sizeof(double) : sizeof(float), "langevinMiddleParams");
+    oldDelta = new CudaArray(cu, cu.getPaddedNumAtoms(), useDouble ? sizeof(double4) : sizeof(float4), "oldDelta");
+    prevStepSize = -1.0;
+    prevTol = -1.0;
+}
+
+void CudaIntegrateLangevinMiddleStepKernel::execute(ContextImpl& context, const LangevinMiddleIntegrator& integrator) {
+    cu.setAsCurrent();
+    CudaIntegrationUtilities& integration = cu.getIntegrationUtilities();
+    double temperature = integrator.getTemperature();
+    double friction = integrator.getFriction();
+    double stepSize = integrator.getStepSize();
+    cu.getIntegrationUtilities().setNextStepSize(stepSize);
+    if (temperature != prevTemp || friction != prevFriction || stepSize != prevStepSize) {
+        // Calculate the integration parameters.
+
+        double kT = BOLTZ*temperature;
+        double vscale = exp(-stepSize*friction);
+        double noisescale = sqrt(kT*(1-vscale*vscale));
+        if (cu.getUseDoublePrecision() || cu.getUseMixedPrecision()) {
+            vector<double> p(params->getSize());
+            p[0] = vscale;
+            p[1] = noisescale;
+            params->upload(p);
+        }
+        else {
+            vector<float> p(params->getSize());
+            p[0] = (float) vscale;
+            p[1] = (float) noisescale;
+            params->upload(p);
+        }
+        prevTemp = temperature;
+        prevFriction = friction;
+        prevStepSize = stepSize;
+    }
+    if (integrator.getConstraintTolerance() != prevTol) {
+        // The tolerance is passed to the constraint kernels by value, so any captured sequence
+        // would still contain the old one.
+
+        cu.invalidateCapturedSequences();
+        prevTol = integrator.getConstraintTolerance();
+    }
+
+    // The sequence of kernels making up a step is fixed for each offset into the buffer of
+    // random values, so replay the sequence for this offset as a CUDA graph if one has been
+    // captured.  prepareRandomNumbers() refills the buffer before the offset wraps around,
+    // so a replayed sequence always consumes fresh random values.
+
+    int randomIndex = integration.prepareRandomNumbers(cu.getPaddedNumAtoms());
+    const void* sequenceId = &sequenceKeys[randomIndex];
+    if (!cu.executeCapturedSequence(sequenceId)) {
+        bool capturing = integration.constraintsAreCapturable() && cu.beginCaptureSequence(sequenceId);
+        executeStepKernels(integrator, randomIndex);
+        if (capturing) {
+            if (cu.endCaptureSequence())
+                cu.executeCapturedSequence(sequenceId);
+            else {
+                // The capture failed, which means the kernels were never actually executed.
+
+                executeStepKernels(integrator, randomIndex);
+            }
+        }
+    }
 
     // Update the time and step count.
 
@@ -6736,8 +7513,39 @@ void CudaIntegrateLangevinStepKernel::execute(ContextImpl& context, const Langev
     cu.reorderAtoms();
 }
 
-double CudaIntegrateLangevinStepKernel::computeKineticEnergy(ContextImpl& context, const LangevinIntegrator& integrator) {
-    return cu.getIntegrationUtilities().computeKineticEnergy(0.5*integrator.getStepSize());
+void CudaIntegrateLangevinMiddleStepKernel::executeStepKernels(const LangevinMiddleIntegrator& integrator, int randomIndex) {
+    CudaIntegrationUtilities& integration = cu.getIntegrationUtilities();
+    int numAtoms = cu.getNumAtoms();
+    int paddedNumAtoms = cu.getPaddedNumAtoms();
+
+    // Apply the velocity kick from the forces, then enforce the velocity constraints.
+
+    void* args1[] = {&numAtoms, &paddedNumAtoms, &cu.getVelm().getDevicePointer(), &cu.getForce().getDevicePointer(),
+            &integration.getStepSize().getDevicePointer()};
+    cu.executeKernel(kernel1, args1, numAtoms, 128);
+    integration.applyVelocityConstraints(integrator.getConstraintTolerance());
+
+    // Call the second integration kernel.
+
+    void* args2[] = {&numAtoms, &cu.getVelm().getDevicePointer(), &integration.getPosDelta().getDevicePointer(), &oldDelta->getDevicePointer(),
+            &params->getDevicePointer(), &integration.getStepSize().getDevicePointer(), &integration.getRandom().getDevicePointer(), &randomIndex};
+    cu.executeKernel(kernel2, args2, numAtoms, 128);
+
+    // Apply constraints.
+
+    integration.applyConstraints(integrator.getConstraintTolerance());
+
+    // Call the third integration kernel.
+
+    CUdeviceptr posCorrection = (cu.getUseMixedPrecision() ? cu.getPosqCorrection().getDevicePointer() : 0);
+    void* args3[] = {&numAtoms, &cu.getPosq().getDevicePointer(), &posCorrection, &cu.getVelm().getDevicePointer(),
+            &integration.getPosDelta().getDevicePointer(), &oldDelta->getDevicePointer(), &integration.getStepSize().getDevicePointer()};
+    cu.executeKernel(kernel3, args3, numAtoms, 128);
+    integration.computeVirtualSites();
+}
+
+double CudaIntegrateLangevinMiddleStepKernel::computeKineticEnergy(ContextImpl& context, const LangevinMiddleIntegrator& integrator) {
+    return cu.getIntegrationUtilities().computeKineticEnergy(0);
 }
 
 CudaIntegrateBrownianStepKernel::~CudaIntegrateBrownianStepKernel() {
@@ -6835,6 +7643,7 @@ double CudaIntegrateVariableVerletStepKernel::execute(ContextImpl& context, cons
             &cu.getVelm().getDevicePointer(), &cu.getForce().getDevicePointer()};
     int sharedSize = blockSize*(useDouble ? sizeof(double) : sizeof(float));
     cu.executeKernel(selectSizeKernel, argsSelect, blockSize, blockSize, sharedSize);
+    integration.downloadStepSizeAsync();
 
     // Call the first integration kernel.
 
@@ -6921,6 +7730,7 @@ double CudaIntegrateVariableLangevinStepKernel::execute(ContextImpl& context, co
             &cu.getVelm().getDevicePointer(), &cu.getForce().getDevicePointer(), &params->getDevicePointer()};
     int sharedSize = 2*blockSize*(useDouble ? sizeof(double) : sizeof(float));
     cu.executeKernel(selectSizeKernel, argsSelect, blockSize, blockSize, sharedSize);
+    integration.downloadStepSizeAsync();
 
     // Call the first integration kernel.
 
@@ -6966,12 +7776,19 @@ double CudaIntegrateVariableLangevinStepKernel::computeKineticEnergy(ContextImpl
 class CudaIntegrateCustomStepKernel::ReorderListener : public CudaContext::ReorderListener {
 public:
     ReorderListener(CudaContext& cu, CudaParameterSet& perDofValues, vector<vector<float> >& localPerDofValuesFloat, vector<vector<double> >& localPerDofValuesDouble, bool& deviceValuesAreCurrent) :
-            cu(cu), perDofValues(perDofValues), localPerDofValuesFloat(localPerDofValuesFloat), localPerDofValuesDouble(localPerDofValuesDouble), deviceValuesAreCurrent(deviceValuesAreCurrent) {
+            cu(cu), perDofValues(perDofValues), localPerDofValuesFloat(localPerDofValuesFloat), localPerDofValuesDouble(localPerDofValuesDouble), deviceValuesAreCurrent(deviceValuesAreCurrent),
+            reorderKernel(NULL), sourceIndices(NULL), scratch(NULL) {
         int numAtoms = cu.getNumAtoms();
         lastAtomOrder.resize(numAtoms);
         for (int i = 0; i < numAtoms; i++)
             lastAtomOrder[i] = cu.getAtomIndex()[i];
     }
+    ~ReorderListener() {
+        if (sourceIndices != NULL)
+            delete sourceIndices;
+        if (scratch != NULL)
+            delete scratch;
+    }
     void execute() {
         // Reorder the per-DOF variables to reflect the new atom order.
 
@@ -6979,9 +7796,36 @@ public:
             return;
         int numAtoms = cu.getNumAtoms();
         const vector<int>& order = cu.getAtomIndex();
-        if (cu.getUseDoublePrecision() || cu.getUseMixedPrecision()) {
-            if (deviceValuesAreCurrent)
-                perDofValues.getParameterValues(localPerDofValuesDouble);
+        if (deviceValuesAreCurrent) {
+            // The most recent values are on the device, so permute them there instead of
+            // copying them back and forth through host memory.
+
+            if (reorderKernel == NULL) {
+                CUmodule module = cu.createModule(CudaKernelSources::reorderParams);
+                reorderKernel = cu.getKernel(module, "reorderParameters");
+                sourceIndices = CudaArray::create<int>(cu, 3*numAtoms, "perDofSourceIndices");
+                int maxElementSize = 0;
+                for (auto& buffer : perDofValues.getBuffers())
+                    maxElementSize = max(maxElementSize, buffer.getSize());
+                scratch = CudaArray::create<int>(cu, 3*numAtoms*(maxElementSize/sizeof(int)), "perDofReorderScratch");
+            }
+            vector<int> inverseOrder(numAtoms);
+            for (int i = 0; i < numAtoms; i++)
+                inverseOrder[lastAtomOrder[i]] = i;
+            vector<int> sourceIndex(3*numAtoms);
+            for (int i = 0; i < numAtoms; i++)
+                for (int j = 0; j < 3; j++)
+                    sourceIndex[3*i+j] = 3*inverseOrder[order[i]]+j;
+            sourceIndices->upload(sourceIndex);
+            int numElements = 3*numAtoms;
+            for (auto& buffer : perDofValues.getBuffers()) {
+                int intsPerElement = buffer.getSize()/sizeof(int);
+                void* args[] = {&buffer.getMemory(), &scratch->getDevicePointer(), &sourceIndices->getDevicePointer(), &numElements, &intsPerElement};
+                cu.executeKernel(reorderKernel, args, numElements);
+                CHECK_RESULT(cuMemcpyDtoD(buffer.getMemory(), scratch->getDevicePointer(), numElements*(size_t) buffer.getSize()), "Error reordering per-DOF values");
+            }
+        }
+        else if (cu.getUseDoublePrecision() || cu.getUseMixedPrecision()) {
             vector<vector<double> > swap(3*numAtoms);
             for (int i = 0; i < numAtoms; i++) {
                 swap[3*lastAtomOrder[i]] = localPerDofValuesDouble[3*i];
@@ -6996,8 +7840,6 @@ public:
             perDofValues.setParameterValues(localPerDofValuesDouble);
         }
         else {
-            if (deviceValuesAreCurrent)
-                perDofValues.getParameterValues(localPerDofValuesFloat);
             vector<vector<float> > swap(3*numAtoms);
             for (int i = 0; i < numAtoms; i++) {
                 swap[3*lastAtomOrder[i]] = localPerDofValuesFloat[3*i];
@@ -7022,6 +7864,9 @@ private:
     vector<vector<double> >& localPerDofValuesDouble;
     bool& deviceValuesAreCurrent;
     vector<int> lastAtomOrder;
+    CUfunction reorderKernel;
+    CudaArray* sourceIndices;
+    CudaArray* scratch;
 };
 
 class CudaIntegrateCustomStepKernel::DerivFunction : public CustomFunction {
@@ -7120,6 +7965,50 @@ string CudaIntegrateCustomStepKernel::createPerDofComputation(const string& vari
     return cu.getExpressionUtilities().createExpressions(expressions, variableNodes, functions, functionNames, "temp"+cu.intToString(component)+"_", "double");
 }
 
+void CudaIntegrateCustomStepKernel::createDeviceGlobalsKernel(int step, const string& computation, map<string, string>& defines) {
+    map<string, string> replacements;
+    replacements["COMPUTE_STEP"] = computation;
+    CUmodule module = cu.createModule(cu.replaceStrings(CudaKernelSources::customIntegratorGlobals, replacements), defines);
+    CUfunction kernel = cu.getKernel(module, "computeGlobals");
+    kernels[step].push_back(kernel);
+    vector<void*> args;
+    args.push_back(&globalValues->getDevicePointer());
+    args.push_back(&cu.getIntegrationUtilities().getStepSize().getDevicePointer());
+    if (cu.getUseDoublePrecision() || cu.getUseMixedPrecision())
+        args.push_back(&energy);
+    else
+        args.push_back(&energyFloat);
+    args.push_back(&summedValue->getDevicePointer());
+    kernelArgs[step].push_back(args);
+}
+
+void CudaIntegrateCustomStepKernel::downloadGlobalValues() const {
+    // If any global variables have been computed on the device, copy their values back to the
+    // host before an expression is evaluated there.
+
+    if (localGlobalsAreCurrent)
+        return;
+    if (cu.getUseDoublePrecision() || cu.getUseMixedPrecision()) {
+        vector<double> values(globalValues->getSize());
+        globalValues->download(values);
+        for (int i = 0; i < numGlobalVariables; i++) {
+            int index = globalVariableIndex[i];
+            globalValuesDouble[index] = values[index];
+            expressionSet.setVariable(index, values[index]);
+        }
+    }
+    else {
+        vector<float> values(globalValues->getSize());
+        globalValues->download(values);
+        for (int i = 0; i < numGlobalVariables; i++) {
+            int index = globalVariableIndex[i];
+            globalValuesDouble[index] = values[index];
+            expressionSet.setVariable(index, values[index]);
+        }
+    }
+    localGlobalsAreCurrent = true;
+}
+
 void CudaIntegrateCustomStepKernel::prepareForComputation(ContextImpl& context, CustomIntegrator& integrator, bool& forcesAreValid) {
     cu.setAsCurrent();
     CudaIntegrationUtilities& integration = cu.getIntegrationUtilities();
@@ -7143,6 +8032,7 @@ void CudaIntegrateCustomStepKernel::prepareForComputation(ContextImpl& context,
         stepType.resize(numSteps);
         stepTarget.resize(numSteps);
         merged.resize(numSteps, false);
+        mergedSum.resize(numSteps, false);
         modifiesParameters = false;
         map<string, string> defines;
         defines["NUM_ATOMS"] = cu.intToString(cu.getNumAtoms());
@@ -7261,7 +8151,46 @@ void CudaIntegrateCustomStepKernel::prepareForComputation(ContextImpl& context,
                         needsGlobals[step] = true;
             }
         }
-        
+
+        // Identify global computations that can be performed on the device.  A computation whose
+        // target is a global variable and whose expression involves only values that are present
+        // in device memory is done by a tiny kernel instead of on the host, so the result never
+        // needs to be transferred back.  The host copies are refreshed lazily when something
+        // actually needs them.
+
+        computeGlobalOnDevice.resize(numSteps, false);
+        set<string> deviceVariables;
+        for (int i = 0; i < integrator.getNumGlobalVariables(); i++)
+            deviceVariables.insert(integrator.getGlobalVariableName(i));
+        for (auto& name : parameterNames)
+            deviceVariables.insert(name);
+        deviceVariables.insert("dt");
+        for (int step = 0; step < numSteps; step++) {
+            if (stepType[step] != CustomIntegrator::ComputeGlobal && stepType[step] != CustomIntegrator::ComputeSum)
+                continue;
+            if (stepTarget[step].type != VARIABLE)
+                continue;
+            if (stepType[step] == CustomIntegrator::ComputeSum)
+                computeGlobalOnDevice[step] = true;
+            else {
+                set<string> allowed = deviceVariables;
+                allowed.insert(energyName[step]);
+                computeGlobalOnDevice[step] = usesOnlyVariables(expression[step][0].getRootNode(), allowed);
+            }
+        }
+
+        // If the same variable is also set by a computation that must run on the host, keep every
+        // computation of it on the host so the two copies cannot get out of sync.
+
+        for (int step = 0; step < numSteps; step++)
+            if ((stepType[step] == CustomIntegrator::ComputeGlobal || stepType[step] == CustomIntegrator::ComputeSum) && !computeGlobalOnDevice[step] && stepTarget[step].type == VARIABLE)
+                for (int j = 0; j < numSteps; j++)
+                    if (computeGlobalOnDevice[j] && stepTarget[j].variableIndex == stepTarget[step].variableIndex)
+                        computeGlobalOnDevice[j] = false;
+        for (int step = 0; step < numSteps; step++)
+            if (computeGlobalOnDevice[step])
+                needsGlobals[step] = true;
+
         // Determine how each step will represent the position (as just a value, or a value plus a delta).
         
         hasAnyConstraints = (context.getSystem().getNumConstraints() > 0);
@@ -7287,12 +8216,14 @@ void CudaIntegrateCustomStepKernel::prepareForComputation(ContextImpl& context,
             }
         }
         
-        // Identify steps that can be merged into a single kernel.
-        
+        // Identify steps that can be merged into a single kernel.  A sequence of per-DOF
+        // computations is evaluated with one kernel launch, keeping intermediate values in
+        // registers, and the per-DOF part of a sum can be folded into the same kernel.
+
         for (int step = 1; step < numSteps; step++) {
             if (invalidatesForces[step-1] || forceGroupFlags[step] != forceGroupFlags[step-1])
                 continue;
-            if (stepType[step-1] == CustomIntegrator::ComputePerDof && stepType[step] == CustomIntegrator::ComputePerDof)
+            if (stepType[step-1] == CustomIntegrator::ComputePerDof && (stepType[step] == CustomIntegrator::ComputePerDof || stepType[step] == CustomIntegrator::ComputeSum))
                 merged[step] = true;
         }
         for (int step = numSteps-1; step > 0; step--) 
@@ -7318,6 +8249,8 @@ void CudaIntegrateCustomStepKernel::prepareForComputation(ContextImpl& context,
                 }
                 int numGaussian = 0, numUniform = 0;
                 for (int j = step; j < numSteps && (j == step || merged[j]); j++) {
+                    if (j > step && stepType[j] == CustomIntegrator::ComputeSum)
+                        mergedSum[step] = true;
                     numGaussian += numAtoms*usesVariable(expression[j][0], "gaussian");
                     numUniform += numAtoms*usesVariable(expression[j][0], "uniform");
                     compute << "{\n";
@@ -7398,8 +8331,41 @@ void CudaIntegrateCustomStepKernel::prepareForComputation(ContextImpl& context,
                     kernel = cu.getKernel(module, useDouble ? "computeDoubleSum" : "computeFloatSum");
                     kernels[step].push_back(kernel);
                     kernelArgs[step].push_back(args2);
+                    if (computeGlobalOnDevice[step])
+                        createDeviceGlobalsKernel(step, "globals["+cu.intToString(stepTarget[step].variableIndex)+"] = sum[0];\n", defines);
                 }
             }
+            else if (stepType[step] == CustomIntegrator::ComputeSum && merged[step]) {
+                // The per-DOF part of this sum was folded into the previous kernel, so only the
+                // kernel that sums the values is needed.
+
+                vector<void*> args2;
+                args2.push_back(&sumBuffer->getDevicePointer());
+                args2.push_back(&summedValue->getDevicePointer());
+                defines["SUM_BUFFER_SIZE"] = cu.intToString(3*numAtoms);
+                CUmodule module = cu.createModule(CudaKernelSources::customIntegrator, defines);
+                CUfunction kernel = cu.getKernel(module, useDouble ? "computeDoubleSum" : "computeFloatSum");
+                kernels[step].push_back(kernel);
+                kernelArgs[step].push_back(args2);
+                if (computeGlobalOnDevice[step])
+                    createDeviceGlobalsKernel(step, "globals["+cu.intToString(stepTarget[step].variableIndex)+"] = sum[0];\n", defines);
+            }
+            else if (stepType[step] == CustomIntegrator::ComputeGlobal && computeGlobalOnDevice[step]) {
+                // Compute a global value on the device so it never needs to be sent to the host.
+
+                map<string, Lepton::ParsedExpression> expressions;
+                expressions["globals["+cu.intToString(stepTarget[step].variableIndex)+"] = "] = expression[step][0];
+                map<string, string> variables;
+                variables["dt"] = "stepSize";
+                variables[energyName[step]] = "energy";
+                for (int i = 0; i < integrator.getNumGlobalVariables(); i++)
+                    variables[integrator.getGlobalVariableName(i)] = "globals["+cu.intToString(globalVariableIndex[i])+"]";
+                for (int i = 0; i < (int) parameterNames.size(); i++)
+                    variables[parameterNames[i]] = "globals["+cu.intToString(parameterVariableIndex[i])+"]";
+                vector<const TabulatedFunction*> functions;
+                vector<pair<string, string> > functionNames;
+                createDeviceGlobalsKernel(step, cu.getExpressionUtilities().createExpressions(expressions, variables, functions, functionNames, "temp_", "double"), defines);
+            }
             else if (stepType[step] == CustomIntegrator::ConstrainPositions) {
                 // Apply position constraints.
 
@@ -7610,8 +8576,10 @@ void CudaIntegrateCustomStepKernel::execute(ContextImpl& context, CustomIntegrat
             forcesAreValid = true;
         }
         if (needsGlobals[step] && !deviceGlobalsAreCurrent) {
-            // Upload the global values to the device.
-            
+            // Upload the global values to the device.  First merge in any values that were
+            // computed on the device, so the upload does not overwrite them.
+
+            downloadGlobalValues();
             if (cu.getUseDoublePrecision() || cu.getUseMixedPrecision())
                 globalValues->upload(globalValuesDouble);
             else {
@@ -7619,6 +8587,7 @@ void CudaIntegrateCustomStepKernel::execute(ContextImpl& context, CustomIntegrat
                     globalValuesFloat[j] = (float) globalValuesDouble[j];
                 globalValues->upload(globalValuesFloat);
             }
+            deviceGlobalsAreCurrent = true;
         }
         if (stepType[step] == CustomIntegrator::ComputePerDof && !merged[step]) {
             int randomIndex = integration.prepareRandomNumbers(requiredGaussian[step]);
@@ -7628,26 +8597,45 @@ void CudaIntegrateCustomStepKernel::execute(ContextImpl& context, CustomIntegrat
             kernelArgs[step][0][10] = &uniformRandoms->getDevicePointer();
             if (requiredUniform[step] > 0)
                 cu.executeKernel(randomKernel, &randomArgs[0], numAtoms);
+            if (mergedSum[step])
+                cu.clearBuffer(*sumBuffer);
             cu.executeKernel(kernels[step][0], &kernelArgs[step][0][0], numAtoms, 128);
         }
         else if (stepType[step] == CustomIntegrator::ComputeGlobal) {
-            expressionSet.setVariable(uniformVariableIndex, SimTKOpenMMUtilities::getUniformlyDistributedRandomNumber());
-            expressionSet.setVariable(gaussianVariableIndex, SimTKOpenMMUtilities::getNormallyDistributedRandomNumber());
-            expressionSet.setVariable(stepEnergyVariableIndex[step], energy);
-            recordGlobalValue(globalExpressions[step][0].evaluate(), stepTarget[step], integrator);
+            if (computeGlobalOnDevice[step]) {
+                cu.executeKernel(kernels[step][0], &kernelArgs[step][0][0], 32, 32);
+                localGlobalsAreCurrent = false;
+            }
+            else {
+                downloadGlobalValues();
+                expressionSet.setVariable(uniformVariableIndex, SimTKOpenMMUtilities::getUniformlyDistributedRandomNumber());
+                expressionSet.setVariable(gaussianVariableIndex, SimTKOpenMMUtilities::getNormallyDistributedRandomNumber());
+                expressionSet.setVariable(stepEnergyVariableIndex[step], energy);
+                recordGlobalValue(globalExpressions[step][0].evaluate(), stepTarget[step], integrator);
+            }
         }
         else if (stepType[step] == CustomIntegrator::ComputeSum) {
-            int randomIndex = integration.prepareRandomNumbers(requiredGaussian[step]);
-            kernelArgs[step][0][1] = &posCorrection;
-            kernelArgs[step][0][8] = &integration.getRandom().getDevicePointer();
-            kernelArgs[step][0][9] = &randomIndex;
-            kernelArgs[step][0][10] = &uniformRandoms->getDevicePointer();
-            if (requiredUniform[step] > 0)
-                cu.executeKernel(randomKernel, &randomArgs[0], numAtoms);
-            cu.clearBuffer(*sumBuffer);
-            cu.executeKernel(kernels[step][0], &kernelArgs[step][0][0], numAtoms, 128);
-            cu.executeKernel(kernels[step][1], &kernelArgs[step][1][0], CudaContext::ThreadBlockSize, CudaContext::ThreadBlockSize);
-            if (cu.getUseDoublePrecision() || cu.getUseMixedPrecision()) {
+            if (!merged[step]) {
+                int randomIndex = integration.prepareRandomNumbers(requiredGaussian[step]);
+                kernelArgs[step][0][1] = &posCorrection;
+                kernelArgs[step][0][8] = &integration.getRandom().getDevicePointer();
+                kernelArgs[step][0][9] = &randomIndex;
+                kernelArgs[step][0][10] = &uniformRandoms->getDevicePointer();
+                if (requiredUniform[step] > 0)
+                    cu.executeKernel(randomKernel, &randomArgs[0], numAtoms);
+                cu.clearBuffer(*sumBuffer);
+                cu.executeKernel(kernels[step][0], &kernelArgs[step][0][0], numAtoms, 128);
+            }
+            int sumKernel = (merged[step] ? 0 : 1);
+            cu.executeKernel(kernels[step][sumKernel], &kernelArgs[step][sumKernel][0], CudaContext::ThreadBlockSize, CudaContext::ThreadBlockSize);
+            if (computeGlobalOnDevice[step]) {
+                // Store the result directly into the global variable on the device instead of
+                // downloading it to the host.
+
+                cu.executeKernel(kernels[step][sumKernel+1], &kernelArgs[step][sumKernel+1][0], 32, 32);
+                localGlobalsAreCurrent = false;
+            }
+            else if (cu.getUseDoublePrecision() || cu.getUseMixedPrecision()) {
                 double value;
                 summedValue->download(&value);
                 recordGlobalValue(value, stepTarget[step], integrator);
@@ -7685,8 +8673,10 @@ void CudaIntegrateCustomStepKernel::execute(ContextImpl& context, CustomIntegrat
             if (blockEnd[step] != -1)
                 nextStep = blockEnd[step]; // Return to the start of a while block.
         }
-        if (invalidatesForces[step])
+        if (invalidatesForces[step]) {
             forcesAreValid = false;
+            context.invalidateEnergyCache();
+        }
         step = nextStep;
     }
     recordChangedParameters(context);
@@ -7703,6 +8693,7 @@ void CudaIntegrateCustomStepKernel::execute(ContextImpl& context, CustomIntegrat
 }
 
 bool CudaIntegrateCustomStepKernel::evaluateCondition(int step) {
+    downloadGlobalValues();
     expressionSet.setVariable(uniformVariableIndex, SimTKOpenMMUtilities::getUniformlyDistributedRandomNumber());
     expressionSet.setVariable(gaussianVariableIndex, SimTKOpenMMUtilities::getNormallyDistributedRandomNumber());
     expressionSet.setVariable(stepEnergyVariableIndex[step], energy);
@@ -7794,6 +8785,7 @@ void CudaIntegrateCustomStepKernel::getGlobalVariables(ContextImpl& context, vec
         
         values = initialGlobalVariables;
     }
+    downloadGlobalValues();
     values.resize(numGlobalVariables);
     for (int i = 0; i < numGlobalVariables; i++)
         values[i] = globalValuesDouble[globalVariableIndex[i]];
@@ -7812,6 +8804,7 @@ void CudaIntegrateCustomStepKernel::setGlobalVariables(ContextImpl& context, con
         globalValuesDouble[globalVariableIndex[i]] = values[i];
         expressionSet.setVariable(globalVariableIndex[i], values[i]);
     }
+    localGlobalsAreCurrent = true;
     deviceGlobalsAreCurrent = false;
 }
 
@@ -7975,13 +8968,19 @@ CudaRemoveCMMotionKernel::~CudaRemoveCMMotionKernel() {
     cu.setAsCurrent();
     if (cmMomentum != NULL)
         delete cmMomentum;
+    if (cmVelocity != NULL)
+        delete cmVelocity;
 }
 
 void CudaRemoveCMMotionKernel::initialize(const System& system, const CMMotionRemover& force) {
     cu.setAsCurrent();
     frequency = force.getFrequency();
+    hasMeasuredMomentum = false;
     int numAtoms = cu.getNumAtoms();
     cmMomentum = CudaArray::create<float4>(cu, (numAtoms+CudaContext::ThreadBlockSize-1)/CudaContext::ThreadBlockSize, "cmMomentum");
+    cmVelocity = CudaArray::create<float4>(cu, 1, "cmVelocity");
+    vector<float4> zero(1, make_float4(0, 0, 0, 0));
+    cmVelocity->upload(zero);
     double totalMass = 0.0;
     for (int i = 0; i < numAtoms; i++)
         totalMass += system.getParticleMass(i);
@@ -7989,13 +8988,29 @@ void CudaRemoveCMMotionKernel::initialize(const System& system, const CMMotionRe
     defines["INVERSE_TOTAL_MASS"] = cu.doubleToString(totalMass == 0 ? 0.0 : 1.0/totalMass);
     CUmodule module = cu.createModule(CudaKernelSources::removeCM, defines);
     kernel1 = cu.getKernel(module, "calcCenterOfMassMomentum");
-    kernel2 = cu.getKernel(module, "removeCenterOfMassMomentum");
+    kernel2 = cu.getKernel(module, "removeAndCalcCenterOfMassMomentum");
+    kernel3 = cu.getKernel(module, "calcCenterOfMassVelocity");
 }
 
 void CudaRemoveCMMotionKernel::execute(ContextImpl& context) {
     cu.setAsCurrent();
     int numAtoms = cu.getNumAtoms();
-    void* args[] = {&numAtoms, &cu.getVelm().getDevicePointer(), &cmMomentum->getDevicePointer()};
-    cu.executeKernel(kernel1, args, cu.getNumAtoms(), cu.ThreadBlockSize, cu.ThreadBlockSize*sizeof(float4));
-    cu.executeKernel(kernel2, args, cu.getNumAtoms(), cu.ThreadBlockSize, cu.ThreadBlockSize*sizeof(float4));
+    void* momentumArgs[] = {&numAtoms, &cu.getVelm().getDevicePointer(), &cmMomentum->getDevicePointer()};
+    void* velocityArgs[] = {&numAtoms, &cmMomentum->getDevicePointer(), &cmVelocity->getDevicePointer()};
+    if (!hasMeasuredMomentum) {
+        // The first time this fires there is no stored correction, so measure the center
+        // of mass momentum with a separate pass to make the first removal exact.
+
+        cu.executeKernel(kernel1, momentumArgs, cu.getNumAtoms(), cu.ThreadBlockSize, cu.ThreadBlockSize*sizeof(float4));
+        cu.executeKernel(kernel3, velocityArgs, cu.getNumAtoms(), cu.ThreadBlockSize, cu.ThreadBlockSize*sizeof(float4));
+        hasMeasuredMomentum = true;
+    }
+
+    // Remove the center of mass velocity measured at the previous firing, measuring the
+    // remaining momentum in the same pass so the next firing can remove it.  Only the
+    // per-block partial sums are reduced afterward, not the velocities.
+
+    void* removeArgs[] = {&numAtoms, &cu.getVelm().getDevicePointer(), &cmMomentum->getDevicePointer(), &cmVelocity->getDevicePointer()};
+    cu.executeKernel(kernel2, removeArgs, cu.getNumAtoms(), cu.ThreadBlockSize, cu.ThreadBlockSize*sizeof(float4));
+    cu.executeKernel(kernel3, velocityArgs, cu.getNumAtoms(), cu.ThreadBlockSize, cu.ThreadBlockSize*sizeof(float4));
 }
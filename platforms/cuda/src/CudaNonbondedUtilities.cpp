@@ -31,6 +31,8 @@
 #include "CudaExpressionUtilities.h"
 #include "CudaSort.h"
 #include <algorithm>
+#include <cmath>
+#include <fstream>
 #include <map>
 #include <set>
 #include <utility>
@@ -46,6 +48,22 @@ using namespace std;
     }
 
 
+/**
+ * Determine whether __ldg() is defined for a parameter's data type, so loads of it
+ * can go through the read-only cache.
+ */
+static bool supportsLdg(const CudaNonbondedUtilities::ParameterInfo& param) {
+    const string& type = param.getComponentType();
+    int components = param.getNumComponents();
+    if (type == "float" || type == "int" || type == "unsigned int")
+        return (components == 1 || components == 2 || components == 4);
+    if (type == "double")
+        return (components == 1 || components == 2);
+    if (type == "long long" || type == "unsigned long long")
+        return (components == 1);
+    return false;
+}
+
 class CudaNonbondedUtilities::BlockSortTrait : public CudaSort::SortTrait {
 public:
     BlockSortTrait(bool useDouble) : useDouble(useDouble) {
@@ -65,17 +83,49 @@ private:
 CudaNonbondedUtilities::CudaNonbondedUtilities(CudaContext& context) : context(context), useCutoff(false), usePeriodic(false), anyExclusions(false), usePadding(true),
         exclusionIndices(NULL), exclusionRowIndices(NULL), exclusionTiles(NULL), exclusions(NULL), interactingTiles(NULL), interactingAtoms(NULL),
         interactionCount(NULL), singlePairs(NULL), blockCenter(NULL), blockBoundingBox(NULL), sortedBlocks(NULL), sortedBlockCenter(NULL), sortedBlockBoundingBox(NULL),
-        oldPositions(NULL), rebuildNeighborList(NULL), blockSorter(NULL), pinnedCountBuffer(NULL), forceRebuildNeighborList(true), lastCutoff(0.0), groupFlags(0),
-        canUsePairList(true) {
+        superBlockCenter(NULL), superBlockBoundingBox(NULL),
+        oldPositions(NULL), blockDisplacement(NULL), rebuildNeighborList(NULL), blockSorter(NULL), pinnedCountBuffer(NULL), pinnedRebuildBuffer(NULL), forceRebuildNeighborList(true), lastCutoff(0.0), groupFlags(0),
+        canUsePairList(true), tuneIndex(0), tuneCycles(0), tuningComplete(false), tuneEventsPending(false) {
     // Decide how many thread blocks to use.
 
     string errorMessage = "Error initializing nonbonded utilities";
     int multiprocessors;
     CHECK_RESULT(cuDeviceGetAttribute(&multiprocessors, CU_DEVICE_ATTRIBUTE_MULTIPROCESSOR_COUNT, context.getDevice()));
     CHECK_RESULT(cuEventCreate(&downloadCountEvent, 0));
+    CHECK_RESULT(cuEventCreate(&rebuildFlagEvent, 0));
+    CHECK_RESULT(cuEventCreate(&tuneStartEvent, 0));
+    CHECK_RESULT(cuEventCreate(&tuneEndEvent, 0));
     CHECK_RESULT(cuMemHostAlloc((void**) &pinnedCountBuffer, 2*sizeof(int), CU_MEMHOSTALLOC_PORTABLE));
+    pinnedCountBuffer[0] = pinnedCountBuffer[1] = 0;
+    CHECK_RESULT(cuMemHostAlloc((void**) &pinnedRebuildBuffer, sizeof(int), CU_MEMHOSTALLOC_PORTABLE));
+    pinnedRebuildBuffer[0] = 1;
     numForceThreadBlocks = 4*multiprocessors;
     forceThreadBlockSize = (context.getComputeCapability() < 2.0 ? 128 : 256);
+
+    // The fastest block size for the force kernel varies between architectures, so it gets tuned
+    // during the first steps of a simulation.  If a previous run already tuned it for this
+    // device, reuse the result.  The candidates never exceed the default size, since the energy
+    // buffer is allocated based on it.
+
+    for (int size = 64; size <= forceThreadBlockSize; size += 64)
+        tuneCandidates.push_back(size);
+    tuneTimes.resize(tuneCandidates.size(), 0.0f);
+    if (context.getPlatformData().deterministicForces) {
+        // Timing noise could select different block sizes on otherwise identical runs, so always
+        // use the default.
+
+        tuningComplete = true;
+    }
+    else {
+        ifstream tuneFile((context.getCacheDir()+"nonbondedBlockSize_"+context.getGpuArchitecture()).c_str());
+        if (tuneFile) {
+            int size;
+            if (tuneFile >> size && size >= 32 && size <= forceThreadBlockSize && size%32 == 0) {
+                forceThreadBlockSize = size;
+                tuningComplete = true;
+            }
+        }
+    }
 }
 
 CudaNonbondedUtilities::~CudaNonbondedUtilities() {
@@ -105,15 +155,26 @@ CudaNonbondedUtilities::~CudaNonbondedUtilities() {
         delete sortedBlockCenter;
     if (sortedBlockBoundingBox != NULL)
         delete sortedBlockBoundingBox;
+    if (superBlockCenter != NULL)
+        delete superBlockCenter;
+    if (superBlockBoundingBox != NULL)
+        delete superBlockBoundingBox;
     if (oldPositions != NULL)
         delete oldPositions;
+    if (blockDisplacement != NULL)
+        delete blockDisplacement;
     if (rebuildNeighborList != NULL)
         delete rebuildNeighborList;
     if (blockSorter != NULL)
         delete blockSorter;
     if (pinnedCountBuffer != NULL)
         cuMemFreeHost(pinnedCountBuffer);
+    if (pinnedRebuildBuffer != NULL)
+        cuMemFreeHost(pinnedRebuildBuffer);
     cuEventDestroy(downloadCountEvent);
+    cuEventDestroy(rebuildFlagEvent);
+    cuEventDestroy(tuneStartEvent);
+    cuEventDestroy(tuneEndEvent);
 }
 
 void CudaNonbondedUtilities::addInteraction(bool usesCutoff, bool usesPeriodic, bool usesExclusions, double cutoffDistance, const vector<vector<int> >& exclusionList, const string& kernel, int forceGroup, bool supportsPairList) {
@@ -184,7 +245,7 @@ void CudaNonbondedUtilities::requestExclusions(const vector<vector<int> >& exclu
     }
 }
 
-static bool compareUshort2(ushort2 a, ushort2 b) {
+static bool compareInt2(int2 a, int2 b) {
     return ((a.y < b.y) || (a.y == b.y && a.x < b.x));
 }
 
@@ -216,15 +277,15 @@ void CudaNonbondedUtilities::initialize(const System& system) {
             tilesWithExclusions.insert(make_pair(max(x, y), min(x, y)));
         }
     }
-    vector<ushort2> exclusionTilesVec;
+    vector<int2> exclusionTilesVec;
     for (set<pair<int, int> >::const_iterator iter = tilesWithExclusions.begin(); iter != tilesWithExclusions.end(); ++iter)
-        exclusionTilesVec.push_back(make_ushort2((unsigned short) iter->first, (unsigned short) iter->second));
-    sort(exclusionTilesVec.begin(), exclusionTilesVec.end(), compareUshort2);
-    exclusionTiles = CudaArray::create<ushort2>(context, exclusionTilesVec.size(), "exclusionTiles");
+        exclusionTilesVec.push_back(make_int2(iter->first, iter->second));
+    sort(exclusionTilesVec.begin(), exclusionTilesVec.end(), compareInt2);
+    exclusionTiles = CudaArray::create<int2>(context, exclusionTilesVec.size(), "exclusionTiles");
     exclusionTiles->upload(exclusionTilesVec);
     map<pair<int, int>, int> exclusionTileMap;
     for (int i = 0; i < (int) exclusionTilesVec.size(); i++) {
-        ushort2 tile = exclusionTilesVec[i];
+        int2 tile = exclusionTilesVec[i];
         exclusionTileMap[make_pair(tile.x, tile.y)] = i;
     }
     vector<vector<int> > exclusionBlocksForBlock(numAtomBlocks);
@@ -275,10 +336,20 @@ void CudaNonbondedUtilities::initialize(const System& system) {
     // Create data structures for the neighbor list.
 
     if (useCutoff) {
-        // Select a size for the arrays that hold the neighbor list.  We have to make a fairly
-        // arbitrary guess, but if this turns out to be too small we'll increase it later.
+        // Select a size for the arrays that hold the neighbor list.  For periodic systems the
+        // density is known, so we can estimate how many atoms are within the cutoff of each
+        // block and avoid allocating worst case storage for dilute systems.  If the estimate
+        // turns out to be too small, updateNeighborListSize() will grow the arrays and rebuild
+        // the list.
 
         maxTiles = 20*numAtomBlocks;
+        if (usePeriodic) {
+            double4 box = context.getPeriodicBoxSize();
+            double paddedCutoff = (usePadding ? 1.1 : 1.0)*getMaxCutoffDistance();
+            double atomsInSphere = (4.0/3.0)*M_PI*paddedCutoff*paddedCutoff*paddedCutoff*numAtoms/(box.x*box.y*box.z);
+            int tilesPerBlock = (int) ceil(2.0*atomsInSphere/CudaContext::TileSize);
+            maxTiles = min(maxTiles, numAtomBlocks*tilesPerBlock);
+        }
         if (maxTiles > numTiles)
             maxTiles = numTiles;
         if (maxTiles < 1)
@@ -294,7 +365,11 @@ void CudaNonbondedUtilities::initialize(const System& system) {
         sortedBlocks = new CudaArray(context, numAtomBlocks, 2*elementSize, "sortedBlocks");
         sortedBlockCenter = new CudaArray(context, numAtomBlocks+1, 4*elementSize, "sortedBlockCenter");
         sortedBlockBoundingBox = new CudaArray(context, numAtomBlocks+1, 4*elementSize, "sortedBlockBoundingBox");
+        int numSuperBlocks = (numAtomBlocks+31)/32; // This must match SUPERBLOCK_SIZE in findInteractingBlocks.cu.
+        superBlockCenter = new CudaArray(context, numSuperBlocks, 4*elementSize, "superBlockCenter");
+        superBlockBoundingBox = new CudaArray(context, numSuperBlocks, 4*elementSize, "superBlockBoundingBox");
         oldPositions = new CudaArray(context, numAtoms, 4*elementSize, "oldPositions");
+        blockDisplacement = new CudaArray(context, numAtomBlocks, elementSize, "blockDisplacement");
         rebuildNeighborList = CudaArray::create<int>(context, 1, "rebuildNeighborList");
         blockSorter = new CudaSort(context, new BlockSortTrait(context.getUseDoublePrecision()), numAtomBlocks);
         vector<unsigned int> count(2, 0);
@@ -343,16 +418,22 @@ void CudaNonbondedUtilities::initialize(const System& system) {
         findBlockBoundsArgs.push_back(&blockBoundingBox->getDevicePointer());
         findBlockBoundsArgs.push_back(&rebuildNeighborList->getDevicePointer());
         findBlockBoundsArgs.push_back(&sortedBlocks->getDevicePointer());
+        findBlockBoundsArgs.push_back(&oldPositions->getDevicePointer());
+        findBlockBoundsArgs.push_back(&blockDisplacement->getDevicePointer());
         sortBoxDataArgs.push_back(&sortedBlocks->getDevicePointer());
         sortBoxDataArgs.push_back(&blockCenter->getDevicePointer());
         sortBoxDataArgs.push_back(&blockBoundingBox->getDevicePointer());
         sortBoxDataArgs.push_back(&sortedBlockCenter->getDevicePointer());
         sortBoxDataArgs.push_back(&sortedBlockBoundingBox->getDevicePointer());
-        sortBoxDataArgs.push_back(&context.getPosq().getDevicePointer());
-        sortBoxDataArgs.push_back(&oldPositions->getDevicePointer());
-        sortBoxDataArgs.push_back(&interactionCount->getDevicePointer());
-        sortBoxDataArgs.push_back(&rebuildNeighborList->getDevicePointer());
-        sortBoxDataArgs.push_back(&forceRebuildNeighborList);
+        findSuperBlockBoundsArgs.push_back(&blockCenter->getDevicePointer());
+        findSuperBlockBoundsArgs.push_back(&blockBoundingBox->getDevicePointer());
+        findSuperBlockBoundsArgs.push_back(&superBlockCenter->getDevicePointer());
+        findSuperBlockBoundsArgs.push_back(&superBlockBoundingBox->getDevicePointer());
+        findSuperBlockBoundsArgs.push_back(&rebuildNeighborList->getDevicePointer());
+        checkRebuildArgs.push_back(&blockDisplacement->getDevicePointer());
+        checkRebuildArgs.push_back(&interactionCount->getDevicePointer());
+        checkRebuildArgs.push_back(&rebuildNeighborList->getDevicePointer());
+        checkRebuildArgs.push_back(&forceRebuildNeighborList);
         findInteractingBlocksArgs.push_back(context.getPeriodicBoxSizePointer());
         findInteractingBlocksArgs.push_back(context.getInvPeriodicBoxSizePointer());
         findInteractingBlocksArgs.push_back(context.getPeriodicBoxVecXPointer());
@@ -374,6 +455,10 @@ void CudaNonbondedUtilities::initialize(const System& system) {
         findInteractingBlocksArgs.push_back(&exclusionRowIndices->getDevicePointer());
         findInteractingBlocksArgs.push_back(&oldPositions->getDevicePointer());
         findInteractingBlocksArgs.push_back(&rebuildNeighborList->getDevicePointer());
+        findInteractingBlocksArgs.push_back(&superBlockCenter->getDevicePointer());
+        findInteractingBlocksArgs.push_back(&superBlockBoundingBox->getDevicePointer());
+        findInteractingBlocksArgs.push_back(&blockCenter->getDevicePointer());
+        findInteractingBlocksArgs.push_back(&blockBoundingBox->getDevicePointer());
     }
 }
 
@@ -408,6 +493,13 @@ void CudaNonbondedUtilities::prepareInteractions(int forceGroups) {
     context.executeKernel(kernels.findBlockBoundsKernel, &findBlockBoundsArgs[0], context.getNumAtoms());
     blockSorter->sort(*sortedBlocks);
     context.executeKernel(kernels.sortBoxDataKernel, &sortBoxDataArgs[0], context.getNumAtoms());
+    context.executeKernel(kernels.checkRebuildKernel, &checkRebuildArgs[0], 256, 256);
+    // The rebuild flag is final as soon as checkNeighborListRebuild has run, so download it
+    // right away.  By the time computeInteractions() looks at it, this early part of the
+    // stream has usually finished and the host does not need to stall.
+    rebuildNeighborList->download(pinnedRebuildBuffer, false);
+    cuEventRecord(rebuildFlagEvent, context.getCurrentStream());
+    context.executeKernel(kernels.findSuperBlockBoundsKernel, &findSuperBlockBoundsArgs[0], superBlockCenter->getSize());
     context.executeKernel(kernels.findInteractingBlocksKernel, &findInteractingBlocksArgs[0], context.getNumAtoms(), 256);
     forceRebuildNeighborList = false;
     lastCutoff = kernels.cutoffDistance;
@@ -420,17 +512,95 @@ void CudaNonbondedUtilities::computeInteractions(int forceGroups, bool includeFo
         return;
     KernelSet& kernels = groupKernels[forceGroups];
     if (kernels.hasForces) {
-        CUfunction& kernel = (includeForces ? (includeEnergy ? kernels.forceEnergyKernel : kernels.forceKernel) : kernels.energyKernel);
-        if (kernel == NULL)
-            kernel = createInteractionKernel(kernels.source, parameters, arguments, true, true, forceGroups, includeForces, includeEnergy);
-        context.executeKernel(kernel, &forceArgs[0], numForceThreadBlocks*forceThreadBlockSize, forceThreadBlockSize);
+        if (!tuningComplete && includeForces && !includeEnergy && forceGroups == groupFlags)
+            tuneBlockSize(forceGroups);
+        else {
+            CUfunction& kernel = (includeForces ? (includeEnergy ? kernels.forceEnergyKernel : kernels.forceKernel) : kernels.energyKernel);
+            if (kernel == NULL)
+                kernel = createInteractionKernel(kernels.source, parameters, arguments, true, true, forceGroups, includeForces, includeEnergy);
+            context.executeKernel(kernel, &forceArgs[0], numForceThreadBlocks*forceThreadBlockSize, forceThreadBlockSize);
+        }
     }
     if (useCutoff && numTiles > 0) {
-        cuEventSynchronize(downloadCountEvent);
-        updateNeighborListSize();
+        // The interaction count can only change on steps where the neighbor list was rebuilt,
+        // so the overflow check is skipped on all the others.  The rebuild flag was recorded
+        // much earlier in the stream than the count, so waiting for it stalls the pipeline
+        // far less than waiting for the full neighbor list build.
+        context.synchronizeEvent(rebuildFlagEvent);
+        if (pinnedRebuildBuffer[0] != 0) {
+            context.synchronizeEvent(downloadCountEvent);
+            updateNeighborListSize();
+        }
     }
 }
 
+void CudaNonbondedUtilities::tuneBlockSize(int forceGroups) {
+    KernelSet& kernels = groupKernels[forceGroups];
+
+    // Collect the timing of the launch made on the previous call.
+
+    if (tuneEventsPending) {
+        cuEventSynchronize(tuneEndEvent);
+        float ms = 0.0f;
+        cuEventElapsedTime(&ms, tuneStartEvent, tuneEndEvent);
+        if (tuneCycles > 0)
+            tuneTimes[tuneIndex] += ms; // The first cycle just warms up each kernel.
+        tuneEventsPending = false;
+        tuneIndex++;
+        if (tuneIndex == (int) tuneCandidates.size()) {
+            tuneIndex = 0;
+            tuneCycles++;
+        }
+    }
+    if (tuneCycles > 10) {
+        // Every candidate has been measured enough times.  Lock in the fastest one and record
+        // it in the kernel cache so later contexts can skip the tuning.  Kernels compiled for
+        // other block sizes or flavors get recreated on demand.
+
+        int best = 0;
+        for (int i = 1; i < (int) tuneCandidates.size(); i++)
+            if (tuneTimes[i] < tuneTimes[best])
+                best = i;
+        forceThreadBlockSize = tuneCandidates[best];
+        for (auto& group : groupKernels)
+            group.second.forceKernel = group.second.energyKernel = group.second.forceEnergyKernel = NULL;
+        kernels.forceKernel = tuneKernels[forceThreadBlockSize];
+        tuningComplete = true;
+        try {
+            ofstream out((context.getCacheDir()+"nonbondedBlockSize_"+context.getGpuArchitecture()).c_str());
+            out << forceThreadBlockSize;
+        }
+        catch (...) {
+            // Ignore.  The cache is only an optimization.
+        }
+        context.executeKernel(kernels.forceKernel, &forceArgs[0], numForceThreadBlocks*forceThreadBlockSize, forceThreadBlockSize);
+        return;
+    }
+
+    // Launch the next candidate, timing it with events.  The launch does the real work for
+    // this step, so the measurement costs nothing beyond the event overhead.
+
+    int blockSize = tuneCandidates[tuneIndex];
+    CUfunction& kernel = tuneKernels[blockSize];
+    if (kernel == NULL) {
+        int defaultSize = forceThreadBlockSize;
+        forceThreadBlockSize = blockSize;
+        kernel = createInteractionKernel(kernels.source, parameters, arguments, true, true, forceGroups, true, false);
+        forceThreadBlockSize = defaultSize;
+    }
+    cuEventRecord(tuneStartEvent, context.getCurrentStream());
+    context.executeKernel(kernel, &forceArgs[0], numForceThreadBlocks*blockSize, blockSize);
+    cuEventRecord(tuneEndEvent, context.getCurrentStream());
+    tuneEventsPending = true;
+}
+
+int CudaNonbondedUtilities::getLastInteractionCount() {
+    if (!useCutoff || numTiles == 0)
+        return 0;
+    context.synchronizeEvent(downloadCountEvent);
+    return pinnedCountBuffer[0];
+}
+
 bool CudaNonbondedUtilities::updateNeighborListSize() {
     if (!useCutoff)
         return false;
@@ -487,14 +657,17 @@ void CudaNonbondedUtilities::setAtomBlockRange(double startFraction, double endF
 }
 
 void CudaNonbondedUtilities::createKernelsForGroups(int groups) {
+    // All force groups share a single neighbor list built at the largest cutoff any of them
+    // uses.  Forces with a shorter cutoff apply their own distance test in the interaction
+    // kernel, and sharing the list means that alternating between groups with different
+    // cutoffs does not force it to be rebuilt.
+
     KernelSet kernels;
-    double cutoff = 0.0;
+    double cutoff = getMaxCutoffDistance();
     string source;
     for (int i = 0; i < 32; i++) {
-        if ((groups&(1<<i)) != 0) {
-            cutoff = max(cutoff, groupCutoff[i]);
+        if ((groups&(1<<i)) != 0)
             source += groupKernelSource[i];
-        }
     }
     kernels.hasForces = (source.size() > 0);
     kernels.cutoffDistance = cutoff;
@@ -521,6 +694,8 @@ void CudaNonbondedUtilities::createKernelsForGroups(int groups) {
         CUmodule interactingBlocksProgram = context.createModule(CudaKernelSources::vectorOps+CudaKernelSources::findInteractingBlocks, defines);
         kernels.findBlockBoundsKernel = context.getKernel(interactingBlocksProgram, "findBlockBounds");
         kernels.sortBoxDataKernel = context.getKernel(interactingBlocksProgram, "sortBoxData");
+        kernels.findSuperBlockBoundsKernel = context.getKernel(interactingBlocksProgram, "findSuperBlockBounds");
+        kernels.checkRebuildKernel = context.getKernel(interactingBlocksProgram, "checkNeighborListRebuild");
         kernels.findInteractingBlocksKernel = context.getKernel(interactingBlocksProgram, "findBlocksWithInteractions");
     }
     groupKernels[groups] = kernels;
@@ -559,14 +734,18 @@ CUfunction CudaNonbondedUtilities::createInteractionKernel(const string& source,
         args << ", mixed* __restrict__ energyParamDerivs";
     replacements["PARAMETER_ARGUMENTS"] = args.str();
 
+    // On devices that support it, load parameters through the read-only cache.
+
+    bool useLdg = (context.getComputeCapability() >= 3.5);
     stringstream load1;
     for (int i = 0; i < (int) params.size(); i++) {
         load1 << params[i].getType();
         load1 << " ";
         load1 << params[i].getName();
-        load1 << "1 = global_";
-        load1 << params[i].getName();
-        load1 << "[atom1];\n";
+        if (useLdg && supportsLdg(params[i]))
+            load1 << "1 = __ldg(&global_" << params[i].getName() << "[atom1]);\n";
+        else
+            load1 << "1 = global_" << params[i].getName() << "[atom1];\n";
     }
     replacements["LOAD_ATOM1_PARAMETERS"] = load1.str();
 
@@ -628,15 +807,19 @@ CUfunction CudaNonbondedUtilities::createInteractionKernel(const string& source,
     stringstream loadLocal2;
     if(useShuffle) {
         for(int i=0; i< (int) params.size(); i++) {
-            loadLocal2<<"shfl"<<params[i].getName()<<" = global_"<<params[i].getName()<<"[j];\n";
+            if (useLdg && supportsLdg(params[i]))
+                loadLocal2<<"shfl"<<params[i].getName()<<" = __ldg(&global_"<<params[i].getName()<<"[j]);\n";
+            else
+                loadLocal2<<"shfl"<<params[i].getName()<<" = global_"<<params[i].getName()<<"[j];\n";
         }
     } else {
         for (int i = 0; i < (int) params.size(); i++) {
+            string load = (useLdg && supportsLdg(params[i]) ? "__ldg(&global_"+params[i].getName()+"[j])" : "global_"+params[i].getName()+"[j]");
             if (params[i].getNumComponents() == 1) {
-                loadLocal2<<"localData[threadIdx.x]."<<params[i].getName()<<" = global_"<<params[i].getName()<<"[j];\n";
+                loadLocal2<<"localData[threadIdx.x]."<<params[i].getName()<<" = "<<load<<";\n";
             }
             else {
-                loadLocal2<<params[i].getType()<<" temp_"<<params[i].getName()<<" = global_"<<params[i].getName()<<"[j];\n";
+                loadLocal2<<params[i].getType()<<" temp_"<<params[i].getName()<<" = "<<load<<";\n";
                 for (int j = 0; j < params[i].getNumComponents(); ++j)
                     loadLocal2<<"localData[threadIdx.x]."<<params[i].getName()<<"_"<<suffixes[j]<<" = temp_"<<params[i].getName()<<"."<<suffixes[j]<<";\n";
             }
@@ -60,6 +60,19 @@ if (result != CUDA_SUCCESS) { \
     }
 #endif
 
+/**
+ * The forces from multiple devices are reduced pairwise in a tree: in each round, half the
+ * remaining devices copy their forces directly to a peer, which adds them to its own.  This
+ * returns whether a device acts as a receiver in any round, and therefore needs a buffer to
+ * receive forces into.
+ */
+static bool isReductionReceiver(int index, int numContexts) {
+    for (int step = 1; step < numContexts; step *= 2)
+        if (index%(2*step) == 0 && index+step < numContexts)
+            return true;
+    return false;
+}
+
 class CudaParallelCalcForcesAndEnergyKernel::BeginComputationTask : public CudaContext::WorkTask {
 public:
     BeginComputationTask(ContextImpl& context, CudaContext& cu, CudaCalcForcesAndEnergyKernel& kernel,
@@ -93,9 +106,9 @@ private:
 class CudaParallelCalcForcesAndEnergyKernel::FinishComputationTask : public CudaContext::WorkTask {
 public:
     FinishComputationTask(ContextImpl& context, CudaContext& cu, CudaCalcForcesAndEnergyKernel& kernel,
-            bool includeForce, bool includeEnergy, int groups, double& energy, long long& completionTime, long long* pinnedMemory, CudaArray& contextForces, bool& valid, int2& interactionCount) :
+            bool includeForce, bool includeEnergy, int groups, double& energy, long long& completionTime, long long* pinnedMemory, CUdeviceptr peerDestination, bool& valid, int2& interactionCount) :
             context(context), cu(cu), kernel(kernel), includeForce(includeForce), includeEnergy(includeEnergy), groups(groups), energy(energy),
-            completionTime(completionTime), pinnedMemory(pinnedMemory), contextForces(contextForces), valid(valid), interactionCount(interactionCount) {
+            completionTime(completionTime), pinnedMemory(pinnedMemory), peerDestination(peerDestination), valid(valid), interactionCount(interactionCount) {
     }
     void execute() {
         // Execute the kernel, then download forces.
@@ -111,10 +124,11 @@ public:
             if (cu.getContextIndex() > 0) {
                 int numAtoms = cu.getPaddedNumAtoms();
                 if (cu.getPlatformData().peerAccessSupported) {
-                    int numBytes = numAtoms*3*sizeof(long long);
-                    int offset = (cu.getContextIndex()-1)*numBytes;
-                    CudaContext& context0 = *cu.getPlatformData().contexts[0];
-                    CHECK_RESULT(cuMemcpy(contextForces.getDevicePointer()+offset, cu.getForce().getDevicePointer(), numBytes), "Error copying forces");
+                    // If this context is a sender in the first round of the tree reduction, copy
+                    // the forces to its partner now, overlapping with devices that are still computing.
+
+                    if (peerDestination != 0)
+                        CHECK_RESULT(cuMemcpy(peerDestination, cu.getForce().getDevicePointer(), numAtoms*3*sizeof(long long)), "Error copying forces");
                 }
                 else
                     cu.getForce().download(&pinnedMemory[(cu.getContextIndex()-1)*numAtoms*3]);
@@ -135,11 +149,53 @@ private:
     double& energy;
     long long& completionTime;
     long long* pinnedMemory;
-    CudaArray& contextForces;
+    CUdeviceptr peerDestination;
     bool& valid;
     int2& interactionCount;
 };
 
+class CudaParallelCalcForcesAndEnergyKernel::CopyForcesTask : public CudaContext::WorkTask {
+public:
+    CopyForcesTask(CudaContext& cu, CUdeviceptr destination) : cu(cu), destination(destination) {
+    }
+    void execute() {
+        // Copy the reduced forces from this device directly to the device that will add them to its own.
+
+        cu.setAsCurrent();
+        int numBytes = cu.getForce().getSize()*cu.getForce().getElementSize();
+        CHECK_RESULT(cuMemcpy(destination, cu.getForce().getDevicePointer(), numBytes), "Error copying forces");
+    }
+private:
+    CudaContext& cu;
+    CUdeviceptr destination;
+};
+
+class CudaParallelCalcForcesAndEnergyKernel::AddForcesTask : public CudaContext::WorkTask {
+public:
+    AddForcesTask(CudaContext& cu, CUfunction kernel, CudaArray& buffer, int bufferSize, bool synchronize) :
+            cu(cu), kernel(kernel), buffer(buffer), bufferSize(bufferSize), synchronize(synchronize) {
+    }
+    void execute() {
+        // Add the forces received from another device to this device's forces.
+
+        cu.setAsCurrent();
+        int numBuffers = 1;
+        void* args[] = {&cu.getForce().getDevicePointer(), &buffer.getDevicePointer(), &bufferSize, &numBuffers};
+        cu.executeKernel(kernel, args, bufferSize);
+        if (synchronize) {
+            // Another round of the reduction will overwrite the buffer, so wait until the kernel has finished.
+
+            CHECK_RESULT(cuCtxSynchronize(), "Error synchronizing CUDA context");
+        }
+    }
+private:
+    CudaContext& cu;
+    CUfunction kernel;
+    CudaArray& buffer;
+    int bufferSize;
+    bool synchronize;
+};
+
 CudaParallelCalcForcesAndEnergyKernel::CudaParallelCalcForcesAndEnergyKernel(string name, const Platform& platform, CudaPlatform::PlatformData& data) :
         CalcForcesAndEnergyKernel(name, platform), data(data), completionTimes(data.contexts.size()), contextNonbondedFractions(data.contexts.size()),
         interactionCounts(NULL), contextForces(NULL), pinnedPositionBuffer(NULL), pinnedForceBuffer(NULL) {
@@ -148,6 +204,11 @@ CudaParallelCalcForcesAndEnergyKernel::CudaParallelCalcForcesAndEnergyKernel(str
 }
 
 CudaParallelCalcForcesAndEnergyKernel::~CudaParallelCalcForcesAndEnergyKernel() {
+    for (int i = 0; i < (int) peerForces.size(); i++)
+        if (peerForces[i] != NULL) {
+            data.contexts[i]->setAsCurrent();
+            delete peerForces[i];
+        }
     data.contexts[0]->setAsCurrent();
     if (contextForces != NULL)
         delete contextForces;
@@ -169,6 +230,19 @@ void CudaParallelCalcForcesAndEnergyKernel::initialize(const System& system) {
     int numContexts = data.contexts.size();
     for (int i = 0; i < numContexts; i++)
         getKernel(i).initialize(system);
+    if (data.peerAccessSupported) {
+        // Every context that receives forces during the tree reduction needs its own copy of the kernel.
+
+        sumKernels.resize(numContexts, NULL);
+        sumKernels[0] = sumKernel;
+        for (int i = 1; i < numContexts; i++)
+            if (isReductionReceiver(i, numContexts)) {
+                data.contexts[i]->setAsCurrent();
+                CUmodule contextModule = data.contexts[i]->createModule(CudaKernelSources::parallel);
+                sumKernels[i] = data.contexts[i]->getKernel(contextModule, "sumForces");
+            }
+        cu.setAsCurrent();
+    }
     for (int i = 0; i < numContexts; i++)
         contextNonbondedFractions[i] = 1/(double) numContexts;
     CHECK_RESULT(cuEventCreate(&event, 0), "Error creating event");
@@ -179,10 +253,39 @@ void CudaParallelCalcForcesAndEnergyKernel::initialize(const System& system) {
 void CudaParallelCalcForcesAndEnergyKernel::beginComputation(ContextImpl& context, bool includeForce, bool includeEnergy, int groups) {
     CudaContext& cu = *data.contexts[0];
     cu.setAsCurrent();
-    if (contextForces == NULL) {
-        contextForces = CudaArray::create<long long>(cu, 3*(data.contexts.size()-1)*cu.getPaddedNumAtoms(), "contextForces");
-        CHECK_RESULT(cuMemHostAlloc((void**) &pinnedForceBuffer, 3*(data.contexts.size()-1)*cu.getPaddedNumAtoms()*sizeof(long long), CU_MEMHOSTALLOC_PORTABLE), "Error allocating pinned memory");
-        CHECK_RESULT(cuMemHostAlloc(&pinnedPositionBuffer, cu.getPaddedNumAtoms()*(cu.getUseDoublePrecision() ? sizeof(double4) : sizeof(float4)), CU_MEMHOSTALLOC_PORTABLE), "Error allocating pinned memory");
+    if (contextForces == NULL && peerForces.size() == 0) {
+        if (cu.getPlatformData().peerAccessSupported) {
+            int numContexts = data.contexts.size();
+            peerForces.resize(numContexts, NULL);
+            for (int i = 0; i < numContexts; i++)
+                if (isReductionReceiver(i, numContexts)) {
+                    data.contexts[i]->setAsCurrent();
+                    peerForces[i] = CudaArray::create<long long>(*data.contexts[i], 3*cu.getPaddedNumAtoms(), "peerForces");
+                }
+            cu.setAsCurrent();
+        }
+        else {
+            contextForces = CudaArray::create<long long>(cu, 3*(data.contexts.size()-1)*cu.getPaddedNumAtoms(), "contextForces");
+            CHECK_RESULT(cuMemHostAlloc((void**) &pinnedForceBuffer, 3*(data.contexts.size()-1)*cu.getPaddedNumAtoms()*sizeof(long long), CU_MEMHOSTALLOC_PORTABLE), "Error allocating pinned memory");
+            CHECK_RESULT(cuMemHostAlloc(&pinnedPositionBuffer, cu.getPaddedNumAtoms()*(cu.getUseDoublePrecision() ? sizeof(double4) : sizeof(float4)), CU_MEMHOSTALLOC_PORTABLE), "Error allocating pinned memory");
+        }
+        if (data.dedicatedPmeDevice) {
+            // The first device computes the full PME reciprocal sum, so start it with no direct
+            // space work and divide that between the other devices.  The measured completion times
+            // will shift work back to it if it has capacity to spare.
+
+            contextNonbondedFractions[0] = 0.0;
+            for (int i = 1; i < (int) contextNonbondedFractions.size(); i++)
+                contextNonbondedFractions[i] = 1/(double) (data.contexts.size()-1);
+            double startFraction = 0.0;
+            for (int i = 0; i < (int) contextNonbondedFractions.size(); i++) {
+                double endFraction = startFraction+contextNonbondedFractions[i];
+                if (i == contextNonbondedFractions.size()-1)
+                    endFraction = 1.0; // Avoid roundoff error
+                data.contexts[i]->getNonbondedUtilities().setAtomBlockRange(startFraction, endFraction);
+                startFraction = endFraction;
+            }
+        }
     }
 
     // Copy coordinates over to each device and execute the kernel.
@@ -211,7 +314,10 @@ double CudaParallelCalcForcesAndEnergyKernel::finishComputation(ContextImpl& con
     for (int i = 0; i < (int) data.contexts.size(); i++) {
         CudaContext& cu = *data.contexts[i];
         CudaContext::WorkThread& thread = cu.getWorkThread();
-        thread.addTask(new FinishComputationTask(context, cu, getKernel(i), includeForce, includeEnergy, groups, data.contextEnergy[i], completionTimes[i], pinnedForceBuffer, *contextForces, valid, interactionCounts[i]));
+        CUdeviceptr peerDestination = 0;
+        if (data.peerAccessSupported && i%2 == 1)
+            peerDestination = peerForces[i-1]->getDevicePointer();
+        thread.addTask(new FinishComputationTask(context, cu, getKernel(i), includeForce, includeEnergy, groups, data.contextEnergy[i], completionTimes[i], pinnedForceBuffer, peerDestination, valid, interactionCounts[i]));
     }
     data.syncContexts();
     double energy = 0.0;
@@ -219,15 +325,33 @@ double CudaParallelCalcForcesAndEnergyKernel::finishComputation(ContextImpl& con
         energy += data.contextEnergy[i];
     if (includeForce && valid) {
         // Sum the forces from all devices.
-        
+
         CudaContext& cu = *data.contexts[0];
-        if (!cu.getPlatformData().peerAccessSupported)
-            contextForces->upload(pinnedForceBuffer, false);
         int bufferSize = 3*cu.getPaddedNumAtoms();
-        int numBuffers = data.contexts.size()-1;
-        void* args[] = {&cu.getForce().getDevicePointer(), &contextForces->getDevicePointer(), &bufferSize, &numBuffers};
-        cu.executeKernel(sumKernel, args, bufferSize);
-        
+        if (cu.getPlatformData().peerAccessSupported) {
+            // Reduce the forces pairwise in a tree, copying directly between devices so the links
+            // are used in parallel.  The copies for the first round were already performed as each
+            // context finished its computation.
+
+            int numContexts = data.contexts.size();
+            for (int step = 1; step < numContexts; step *= 2) {
+                if (step > 1) {
+                    for (int i = 0; i+step < numContexts; i += 2*step)
+                        data.contexts[i+step]->getWorkThread().addTask(new CopyForcesTask(*data.contexts[i+step], peerForces[i]->getDevicePointer()));
+                    data.syncContexts();
+                }
+                for (int i = 0; i+step < numContexts; i += 2*step)
+                    data.contexts[i]->getWorkThread().addTask(new AddForcesTask(*data.contexts[i], sumKernels[i], *peerForces[i], bufferSize, 2*step < numContexts));
+                data.syncContexts();
+            }
+        }
+        else {
+            contextForces->upload(pinnedForceBuffer, false);
+            int numBuffers = data.contexts.size()-1;
+            void* args[] = {&cu.getForce().getDevicePointer(), &contextForces->getDevicePointer(), &bufferSize, &numBuffers};
+            cu.executeKernel(sumKernel, args, bufferSize);
+        }
+
         // Balance work between the contexts by transferring a little nonbonded work from the context that
         // finished last to the one that finished first.
         
@@ -619,9 +743,9 @@ double CudaParallelCalcNonbondedForceKernel::execute(ContextImpl& context, bool
     return 0.0;
 }
 
-void CudaParallelCalcNonbondedForceKernel::copyParametersToContext(ContextImpl& context, const NonbondedForce& force) {
+void CudaParallelCalcNonbondedForceKernel::copyParametersToContext(ContextImpl& context, const NonbondedForce& force, int firstParticle, int lastParticle, int firstException, int lastException) {
     for (int i = 0; i < (int) kernels.size(); i++)
-        getKernel(i).copyParametersToContext(context, force);
+        getKernel(i).copyParametersToContext(context, force, firstParticle, lastParticle, firstException, lastException);
 }
 
 void CudaParallelCalcNonbondedForceKernel::getPMEParameters(double& alpha, int& nx, int& ny, int& nz) const {
@@ -714,6 +838,11 @@ void CudaParallelCalcCustomExternalForceKernel::copyParametersToContext(ContextI
         getKernel(i).copyParametersToContext(context, force);
 }
 
+void CudaParallelCalcCustomExternalForceKernel::copyParametersToContext(ContextImpl& context, const CustomExternalForce& force, const vector<int>& changedParticles) {
+    for (int i = 0; i < (int) kernels.size(); i++)
+        getKernel(i).copyParametersToContext(context, force, changedParticles);
+}
+
 class CudaParallelCalcCustomHbondForceKernel::Task : public CudaContext::WorkTask {
 public:
     Task(ContextImpl& context, CudaCalcCustomHbondForceKernel& kernel, bool includeForce,
@@ -90,9 +90,11 @@ void CudaParameterSet::getParameterValues(vector<vector<T> >& values) {
     int base = 0;
     string errorMessage = "Error downloading parameter set "+name;
     for (int i = 0; i < (int) buffers.size(); i++) {
+        // Stage the transfer through pinned memory so it runs at full bus bandwidth.
+
+        T* data = (T*) context.getPinnedBuffer(numObjects*(size_t) buffers[i].getSize());
+        CHECK_RESULT(cuMemcpyDtoH(data, buffers[i].getMemory(), numObjects*buffers[i].getSize()));
         if (buffers[i].getSize() == 4*elementSize) {
-            vector<T> data(4*numObjects);
-            CHECK_RESULT(cuMemcpyDtoH(&data[0], buffers[i].getMemory(), numObjects*buffers[i].getSize()));
             for (int j = 0; j < numObjects; j++) {
                 values[j][base] = data[4*j];
                 if (base+1 < numParameters)
@@ -105,8 +107,6 @@ void CudaParameterSet::getParameterValues(vector<vector<T> >& values) {
             base += 4;
         }
         else if (buffers[i].getSize() == 2*elementSize) {
-            vector<T> data(2*numObjects);
-            CHECK_RESULT(cuMemcpyDtoH(&data[0], buffers[i].getMemory(), numObjects*buffers[i].getSize()));
             for (int j = 0; j < numObjects; j++) {
                 values[j][base] = data[2*j];
                 if (base+1 < numParameters)
@@ -115,8 +115,6 @@ void CudaParameterSet::getParameterValues(vector<vector<T> >& values) {
             base += 2;
         }
         else if (buffers[i].getSize() == elementSize) {
-            vector<T> data(numObjects);
-            CHECK_RESULT(cuMemcpyDtoH(&data[0], buffers[i].getMemory(), numObjects*buffers[i].getSize()));
             for (int j = 0; j < numObjects; j++)
                 values[j][base] = data[j];
             base++;
@@ -133,8 +131,10 @@ void CudaParameterSet::setParameterValues(const vector<vector<T> >& values) {
     int base = 0;
     string errorMessage = "Error uploading parameter set "+name;
     for (int i = 0; i < (int) buffers.size(); i++) {
+        // Stage the transfer through pinned memory so it runs at full bus bandwidth.
+
+        T* data = (T*) context.getPinnedBuffer(numObjects*(size_t) buffers[i].getSize());
         if (buffers[i].getSize() == 4*elementSize) {
-            vector<T> data(4*numObjects);
             for (int j = 0; j < numObjects; j++) {
                 data[4*j] = values[j][base];
                 if (base+1 < numParameters)
@@ -144,28 +144,68 @@ void CudaParameterSet::setParameterValues(const vector<vector<T> >& values) {
                 if (base+3 < numParameters)
                     data[4*j+3] = values[j][base+3];
             }
-            CHECK_RESULT(cuMemcpyHtoD(buffers[i].getMemory(), &data[0], numObjects*buffers[i].getSize()));
             base += 4;
         }
         else if (buffers[i].getSize() == 2*elementSize) {
-            vector<T> data(2*numObjects);
             for (int j = 0; j < numObjects; j++) {
                 data[2*j] = values[j][base];
                 if (base+1 < numParameters)
                     data[2*j+1] = values[j][base+1];
             }
-            CHECK_RESULT(cuMemcpyHtoD(buffers[i].getMemory(), &data[0], numObjects*buffers[i].getSize()));
             base += 2;
         }
         else if (buffers[i].getSize() == elementSize) {
-            vector<T> data(numObjects);
             for (int j = 0; j < numObjects; j++)
                 data[j] = values[j][base];
-            CHECK_RESULT(cuMemcpyHtoD(buffers[i].getMemory(), &data[0], numObjects*buffers[i].getSize()));
             base++;
         }
         else
             throw OpenMMException("Internal error: Unknown buffer type in CudaParameterSet");
+        CHECK_RESULT(cuMemcpyHtoD(buffers[i].getMemory(), data, numObjects*buffers[i].getSize()));
+    }
+}
+
+template <class T>
+void CudaParameterSet::setParameterValuesSubset(int first, const vector<vector<T> >& values) {
+    if (sizeof(T) != elementSize)
+        throw OpenMMException("Called setParameterValuesSubset() with vector of wrong type");
+    int numToSet = values.size();
+    if (first < 0 || first+numToSet > numObjects)
+        throw OpenMMException("Called setParameterValuesSubset() with an illegal range");
+    int base = 0;
+    string errorMessage = "Error uploading parameter set "+name;
+    for (int i = 0; i < (int) buffers.size(); i++) {
+        // Stage the transfer through pinned memory so it runs at full bus bandwidth.
+
+        T* data = (T*) context.getPinnedBuffer(numToSet*(size_t) buffers[i].getSize());
+        if (buffers[i].getSize() == 4*elementSize) {
+            for (int j = 0; j < numToSet; j++) {
+                data[4*j] = values[j][base];
+                if (base+1 < numParameters)
+                    data[4*j+1] = values[j][base+1];
+                if (base+2 < numParameters)
+                    data[4*j+2] = values[j][base+2];
+                if (base+3 < numParameters)
+                    data[4*j+3] = values[j][base+3];
+            }
+            base += 4;
+        }
+        else if (buffers[i].getSize() == 2*elementSize) {
+            for (int j = 0; j < numToSet; j++) {
+                data[2*j] = values[j][base];
+                if (base+1 < numParameters)
+                    data[2*j+1] = values[j][base+1];
+            }
+            base += 2;
+        }
+        else if (buffers[i].getSize() == elementSize) {
+            for (int j = 0; j < numToSet; j++)
+                data[j] = values[j][base];
+            base++;
+        }
+        else
+            throw OpenMMException("Internal error: Unknown buffer type in CudaParameterSet");
+        CHECK_RESULT(cuMemcpyHtoD(buffers[i].getMemory()+first*(size_t) buffers[i].getSize(), data, numToSet*buffers[i].getSize()));
     }
 }
 
@@ -193,6 +233,8 @@ string CudaParameterSet::getParameterSuffix(int index, const std::string& extraS
 namespace OpenMM {
 template OPENMM_EXPORT_CUDA void CudaParameterSet::getParameterValues<float>(vector<vector<float> >& values);
 template OPENMM_EXPORT_CUDA void CudaParameterSet::setParameterValues<float>(const vector<vector<float> >& values);
+template OPENMM_EXPORT_CUDA void CudaParameterSet::setParameterValuesSubset<float>(int first, const vector<vector<float> >& values);
 template OPENMM_EXPORT_CUDA void CudaParameterSet::getParameterValues<double>(vector<vector<double> >& values);
 template OPENMM_EXPORT_CUDA void CudaParameterSet::setParameterValues<double>(const vector<vector<double> >& values);
+template OPENMM_EXPORT_CUDA void CudaParameterSet::setParameterValuesSubset<double>(int first, const vector<vector<double> >& values);
 }
\ No newline at end of file
@@ -91,6 +91,7 @@ CudaPlatform::CudaPlatform() {
     registerKernelFactory(CalcCustomHbondForceKernel::Name(), factory);
     registerKernelFactory(CalcCustomCentroidBondForceKernel::Name(), factory);
     registerKernelFactory(CalcCustomCompoundBondForceKernel::Name(), factory);
+    registerKernelFactory(CalcCustomCVForceKernel::Name(), factory);
     registerKernelFactory(CalcCustomManyParticleForceKernel::Name(), factory);
     registerKernelFactory(CalcGayBerneForceKernel::Name(), factory);
     registerKernelFactory(IntegrateVerletStepKernel::Name(), factory);
@@ -109,9 +110,12 @@ CudaPlatform::CudaPlatform() {
     platformProperties.push_back(CudaUseCpuPme());
     platformProperties.push_back(CudaCompiler());
     platformProperties.push_back(CudaTempDirectory());
+    platformProperties.push_back(CudaKernelCacheDirectory());
     platformProperties.push_back(CudaHostCompiler());
     platformProperties.push_back(CudaDisablePmeStream());
     platformProperties.push_back(CudaDeterministicForces());
+    platformProperties.push_back(CudaProfilingFile());
+    platformProperties.push_back(CudaDeviceMemoryUsage());
     setPropertyDefaultValue(CudaDeviceIndex(), "");
     setPropertyDefaultValue(CudaDeviceName(), "");
     setPropertyDefaultValue(CudaUseBlockingSync(), "true");
@@ -119,6 +123,8 @@ CudaPlatform::CudaPlatform() {
     setPropertyDefaultValue(CudaUseCpuPme(), "false");
     setPropertyDefaultValue(CudaDisablePmeStream(), "false");
     setPropertyDefaultValue(CudaDeterministicForces(), "false");
+    setPropertyDefaultValue(CudaProfilingFile(), "");
+    setPropertyDefaultValue(CudaDeviceMemoryUsage(), "0");
 #ifdef _MSC_VER
     char* bindir = getenv("CUDA_BIN_PATH");
     string nvcc = (bindir == NULL ? "nvcc.exe" : string(bindir)+"\\nvcc.exe");
@@ -129,7 +135,10 @@ CudaPlatform::CudaPlatform() {
         nvcc = string(&shortName[0]);
     }
     setPropertyDefaultValue(CudaCompiler(), nvcc);
-    setPropertyDefaultValue(CudaTempDirectory(), string(getenv("TEMP")));
+    string temp = string(getenv("TEMP"));
+    setPropertyDefaultValue(CudaTempDirectory(), temp);
+    char* cachedir = getenv("OPENMM_CACHE_DIR");
+    setPropertyDefaultValue(CudaKernelCacheDirectory(), (cachedir == NULL ? temp : string(cachedir)));
 #else
     char* compiler = getenv("OPENMM_CUDA_COMPILER");
     string nvcc = (compiler == NULL ? "/usr/local/cuda/bin/nvcc" : string(compiler));
@@ -137,6 +146,8 @@ CudaPlatform::CudaPlatform() {
     char* tmpdir = getenv("TMPDIR");
     string tmp = (tmpdir == NULL ? string(P_tmpdir) : string(tmpdir));
     setPropertyDefaultValue(CudaTempDirectory(), tmp);
+    char* cachedir = getenv("OPENMM_CACHE_DIR");
+    setPropertyDefaultValue(CudaKernelCacheDirectory(), (cachedir == NULL ? tmp : string(cachedir)));
 #endif
     char* hostCompiler = getenv("CUDA_HOST_COMPILER");
     setPropertyDefaultValue(CudaHostCompiler(), (hostCompiler == NULL ? "" : string(hostCompiler)));
@@ -156,6 +167,16 @@ const string& CudaPlatform::getPropertyValue(const Context& context, const strin
     string propertyName = property;
     if (deprecatedPropertyReplacements.find(property) != deprecatedPropertyReplacements.end())
         propertyName = deprecatedPropertyReplacements.find(property)->second;
+    if (propertyName == CudaDeviceMemoryUsage()) {
+        // This is computed on demand, since it changes over the life of the Context.
+
+        size_t usage = 0;
+        for (CudaContext* c : data->contexts)
+            usage += c->getAllocatedDeviceMemory();
+        stringstream usageString;
+        usageString << usage;
+        const_cast<PlatformData*>(data)->propertyValues[propertyName] = usageString.str();
+    }
     map<string, string>::const_iterator value = data->propertyValues.find(propertyName);
     if (value != data->propertyValues.end())
         return value->second;
@@ -178,12 +199,16 @@ void CudaPlatform::contextCreated(ContextImpl& context, const map<string, string
             getPropertyDefaultValue(CudaCompiler()) : properties.find(CudaCompiler())->second);
     const string& tempPropValue = (properties.find(CudaTempDirectory()) == properties.end() ?
             getPropertyDefaultValue(CudaTempDirectory()) : properties.find(CudaTempDirectory())->second);
+    const string& cachePropValue = (properties.find(CudaKernelCacheDirectory()) == properties.end() ?
+            getPropertyDefaultValue(CudaKernelCacheDirectory()) : properties.find(CudaKernelCacheDirectory())->second);
     const string& hostCompilerPropValue = (properties.find(CudaHostCompiler()) == properties.end() ?
             getPropertyDefaultValue(CudaHostCompiler()) : properties.find(CudaHostCompiler())->second);
     string pmeStreamPropValue = (properties.find(CudaDisablePmeStream()) == properties.end() ?
             getPropertyDefaultValue(CudaDisablePmeStream()) : properties.find(CudaDisablePmeStream())->second);
     string deterministicForcesValue = (properties.find(CudaDeterministicForces()) == properties.end() ?
             getPropertyDefaultValue(CudaDeterministicForces()) : properties.find(CudaDeterministicForces())->second);
+    const string& profilingFileValue = (properties.find(CudaProfilingFile()) == properties.end() ?
+            getPropertyDefaultValue(CudaProfilingFile()) : properties.find(CudaProfilingFile())->second);
     transform(blockingPropValue.begin(), blockingPropValue.end(), blockingPropValue.begin(), ::tolower);
     transform(precisionPropValue.begin(), precisionPropValue.end(), precisionPropValue.begin(), ::tolower);
     transform(cpuPmePropValue.begin(), cpuPmePropValue.end(), cpuPmePropValue.begin(), ::tolower);
@@ -198,7 +223,7 @@ void CudaPlatform::contextCreated(ContextImpl& context, const map<string, string
     if (threadsEnv != NULL)
         stringstream(threadsEnv) >> threads;
     context.setPlatformData(new PlatformData(&context, context.getSystem(), devicePropValue, blockingPropValue, precisionPropValue, cpuPmePropValue, compilerPropValue, tempPropValue,
-            hostCompilerPropValue, pmeStreamPropValue, deterministicForcesValue, threads));
+            cachePropValue, hostCompilerPropValue, pmeStreamPropValue, deterministicForcesValue, profilingFileValue, threads));
 }
 
 void CudaPlatform::contextDestroyed(ContextImpl& context) const {
@@ -206,9 +231,34 @@ void CudaPlatform::contextDestroyed(ContextImpl& context) const {
     delete data;
 }
 
+void CudaPlatform::swapState(Context& context1, Context& context2) const {
+    ContextImpl& impl1 = getContextImpl(context1);
+    ContextImpl& impl2 = getContextImpl(context2);
+    if (&impl1.getPlatform() != this || &impl2.getPlatform() != this)
+        throw OpenMMException("swapState() requires two Contexts created with this Platform");
+    PlatformData* data1 = reinterpret_cast<PlatformData*>(impl1.getPlatformData());
+    PlatformData* data2 = reinterpret_cast<PlatformData*>(impl2.getPlatformData());
+    if (data1->contexts.size() != 1 || data2->contexts.size() != 1)
+        throw OpenMMException("swapState() does not support Contexts that span multiple devices");
+    data1->contexts[0]->swapState(*data2->contexts[0]);
+
+    // Exchange the parts of the state the device contexts do not hold themselves, and discard
+    // any cached energies, since they correspond to the configurations before the swap.
+
+    Vec3 a1, b1, c1, a2, b2, c2;
+    impl1.getPeriodicBoxVectors(a1, b1, c1);
+    impl2.getPeriodicBoxVectors(a2, b2, c2);
+    if (a1 != a2 || b1 != b2 || c1 != c2) {
+        impl1.setPeriodicBoxVectors(a2, b2, c2);
+        impl2.setPeriodicBoxVectors(a1, b1, c1);
+    }
+    impl1.invalidateEnergyCache();
+    impl2.invalidateEnergyCache();
+}
+
 CudaPlatform::PlatformData::PlatformData(ContextImpl* context, const System& system, const string& deviceIndexProperty, const string& blockingProperty, const string& precisionProperty,
-            const string& cpuPmeProperty, const string& compilerProperty, const string& tempProperty, const string& hostCompilerProperty, const string& pmeStreamProperty,
-            const string& deterministicForcesProperty, int numThreads) :
+            const string& cpuPmeProperty, const string& compilerProperty, const string& tempProperty, const string& cacheProperty, const string& hostCompilerProperty,
+            const string& pmeStreamProperty, const string& deterministicForcesProperty, const string& profilingFileProperty, int numThreads) :
                 context(context), removeCM(false), stepCount(0), computeForceCount(0), time(0.0), hasInitializedContexts(false), threads(numThreads) {
     bool blocking = (blockingProperty == "true");
     vector<string> devices;
@@ -223,11 +273,11 @@ CudaPlatform::PlatformData::PlatformData(ContextImpl* context, const System& sys
             if (devices[i].length() > 0) {
                 int deviceIndex;
                 stringstream(devices[i]) >> deviceIndex;
-                contexts.push_back(new CudaContext(system, deviceIndex, blocking, precisionProperty, compilerProperty, tempProperty, hostCompilerProperty, *this));
+                contexts.push_back(new CudaContext(system, deviceIndex, blocking, precisionProperty, compilerProperty, tempProperty, cacheProperty, hostCompilerProperty, profilingFileProperty, *this));
             }
         }
         if (contexts.size() == 0)
-            contexts.push_back(new CudaContext(system, -1, blocking, precisionProperty, compilerProperty, tempProperty, hostCompilerProperty, *this));
+            contexts.push_back(new CudaContext(system, -1, blocking, precisionProperty, compilerProperty, tempProperty, cacheProperty, hostCompilerProperty, profilingFileProperty, *this));
     }
     catch (...) {
         // If an exception was thrown, do our best to clean up memory.
@@ -254,6 +304,7 @@ CudaPlatform::PlatformData::PlatformData(ContextImpl* context, const System& sys
     useCpuPme = (cpuPmeProperty == "true" && !contexts[0]->getUseDoublePrecision());
     disablePmeStream = (pmeStreamProperty == "true");
     deterministicForces = (deterministicForcesProperty == "true");
+    dedicatedPmeDevice = false;
     propertyValues[CudaPlatform::CudaDeviceIndex()] = deviceIndex.str();
     propertyValues[CudaPlatform::CudaDeviceName()] = deviceName.str();
     propertyValues[CudaPlatform::CudaUseBlockingSync()] = blocking ? "true" : "false";
@@ -261,22 +312,23 @@ CudaPlatform::PlatformData::PlatformData(ContextImpl* context, const System& sys
     propertyValues[CudaPlatform::CudaUseCpuPme()] = useCpuPme ? "true" : "false";
     propertyValues[CudaPlatform::CudaCompiler()] = compilerProperty;
     propertyValues[CudaPlatform::CudaTempDirectory()] = tempProperty;
+    propertyValues[CudaPlatform::CudaKernelCacheDirectory()] = cacheProperty;
     propertyValues[CudaPlatform::CudaHostCompiler()] = hostCompilerProperty;
     propertyValues[CudaPlatform::CudaDisablePmeStream()] = disablePmeStream ? "true" : "false";
     propertyValues[CudaPlatform::CudaDeterministicForces()] = deterministicForces ? "true" : "false";
+    propertyValues[CudaPlatform::CudaProfilingFile()] = profilingFileProperty;
     contextEnergy.resize(contexts.size());
     
     // Determine whether peer-to-peer copying is supported, and enable it if so.
     
     peerAccessSupported = true;
-    for (int i = 1; i < contexts.size(); i++) {
-        int canAccess;
-        cuDeviceCanAccessPeer(&canAccess, contexts[i]->getDevice(), contexts[0]->getDevice());
-        if (!canAccess) {
-            peerAccessSupported = false;
-            break;
+    for (int i = 1; i < contexts.size() && peerAccessSupported; i++)
+        for (int j = 0; j < i && peerAccessSupported; j++) {
+            int canAccess;
+            cuDeviceCanAccessPeer(&canAccess, contexts[i]->getDevice(), contexts[j]->getDevice());
+            if (!canAccess)
+                peerAccessSupported = false;
         }
-    }
 }
 
 CudaPlatform::PlatformData::~PlatformData() {
@@ -32,7 +32,34 @@ using namespace OpenMM;
 using namespace std;
 
 CudaSort::CudaSort(CudaContext& context, SortTrait* trait, unsigned int length) : context(context), trait(trait),
-        dataRange(NULL), bucketOfElement(NULL), offsetInBucket(NULL), bucketOffset(NULL), buckets(NULL), dataLength(length) {
+        dataRange(NULL), bucketOfElement(NULL), offsetInBucket(NULL), bucketOffset(NULL), buckets(NULL),
+        radixHistogram(NULL), radixBuffer(NULL), dataLength(length) {
+    // Decide whether the ordering of the keys can be mapped onto unsigned integers, in
+    // which case long lists can be sorted with a radix sort instead of the bucket sort.
+
+    string keyType = trait->getKeyType();
+    if (keyType == "real")
+        keyType = (context.getUseDoublePrecision() ? "double" : "float");
+    string uintKeyType = "unsigned int";
+    string keyToUint = "return 0;";
+    useRadixSort = true;
+    if (keyType == "unsigned int")
+        keyToUint = "return key;";
+    else if (keyType == "int")
+        keyToUint = "return ((unsigned int) key)^0x80000000u;";
+    else if (keyType == "float")
+        keyToUint = "unsigned int bits = (unsigned int) __float_as_int(key);\n"
+                    "return (bits&0x80000000u ? ~bits : bits^0x80000000u);";
+    else if (keyType == "double") {
+        uintKeyType = "unsigned long long";
+        keyToUint = "unsigned long long bits = (unsigned long long) __double_as_longlong(key);\n"
+                    "return (bits&0x8000000000000000ull ? ~bits : bits^0x8000000000000000ull);";
+    }
+    else
+        useRadixSort = false;
+    radixBits = 4;
+    numKeyBits = 8*trait->getKeySize();
+
     // Create kernels.
 
     map<string, string> replacements;
@@ -42,6 +69,9 @@ CudaSort::CudaSort(CudaContext& context, SortTrait* trait, unsigned int length)
     replacements["MIN_KEY"] = trait->getMinKey();
     replacements["MAX_KEY"] = trait->getMaxKey();
     replacements["MAX_VALUE"] = trait->getMaxValue();
+    replacements["UINT_KEY_TYPE"] = uintKeyType;
+    replacements["KEY_TO_UINT"] = keyToUint;
+    replacements["RADIX_SIZE"] = context.intToString(1<<radixBits);
     CUmodule module = context.createModule(context.replaceStrings(CudaKernelSources::sort, replacements));
     shortListKernel = context.getKernel(module, "sortShortList");
     computeRangeKernel = context.getKernel(module, "computeRange");
@@ -49,6 +79,9 @@ CudaSort::CudaSort(CudaContext& context, SortTrait* trait, unsigned int length)
     computeBucketPositionsKernel = context.getKernel(module, "computeBucketPositions");
     copyToBucketsKernel = context.getKernel(module, "copyDataToBuckets");
     sortBucketsKernel = context.getKernel(module, "sortBuckets");
+    computeRadixHistogramKernel = context.getKernel(module, "computeRadixHistogram");
+    computeRadixOffsetsKernel = context.getKernel(module, "computeRadixOffsets");
+    radixScatterKernel = context.getKernel(module, "radixScatter");
 
     // Work out the work group sizes for various kernels.
 
@@ -70,17 +103,25 @@ CudaSort::CudaSort(CudaContext& context, SortTrait* trait, unsigned int length)
     unsigned int numBuckets = length/targetBucketSize;
     if (numBuckets < 1)
         numBuckets = 1;
-    if (positionsKernelSize > numBuckets)
-        positionsKernelSize = numBuckets;
 
     // Create workspace arrays.
 
     if (!isShortList) {
-        dataRange = new CudaArray(context, 2, trait->getKeySize(), "sortDataRange");
-        bucketOffset = CudaArray::create<uint1>(context, numBuckets, "bucketOffset");
-        bucketOfElement = CudaArray::create<uint1>(context, length, "bucketOfElement");
-        offsetInBucket = CudaArray::create<uint1>(context, length, "offsetInBucket");
-        buckets = new CudaArray(context, length, trait->getDataSize(), "buckets");
+        if (useRadixSort) {
+            radixBlockSize = 256;
+            radixTiles = (length+radixBlockSize-1)/radixBlockSize;
+            radixHistogram = CudaArray::create<uint1>(context, (1<<radixBits)*radixTiles, "radixHistogram");
+            radixBuffer = new CudaArray(context, length, trait->getDataSize(), "radixBuffer");
+        }
+        else {
+            if (positionsKernelSize > numBuckets)
+                positionsKernelSize = numBuckets;
+            dataRange = new CudaArray(context, 2, trait->getKeySize(), "sortDataRange");
+            bucketOffset = CudaArray::create<uint1>(context, numBuckets, "bucketOffset");
+            bucketOfElement = CudaArray::create<uint1>(context, length, "bucketOfElement");
+            offsetInBucket = CudaArray::create<uint1>(context, length, "offsetInBucket");
+            buckets = new CudaArray(context, length, trait->getDataSize(), "buckets");
+        }
     }
 }
 
@@ -96,6 +137,10 @@ CudaSort::~CudaSort() {
         delete bucketOffset;
     if (buckets != NULL)
         delete buckets;
+    if (radixHistogram != NULL)
+        delete radixHistogram;
+    if (radixBuffer != NULL)
+        delete radixBuffer;
 }
 
 void CudaSort::sort(CudaArray& data) {
@@ -109,6 +154,34 @@ void CudaSort::sort(CudaArray& data) {
         void* sortArgs[] = {&data.getDevicePointer(), &dataLength};
         context.executeKernel(shortListKernel, sortArgs, sortKernelSize, sortKernelSize, dataLength*trait->getDataSize());
     }
+    else if (useRadixSort) {
+        // Perform a least significant digit radix sort, alternating the data between the two
+        // arrays on successive passes.  The number of key bits is always a multiple of
+        // 2*radixBits, so the sorted result ends up back in the original array.
+
+        unsigned int histogramSize = radixHistogram->getSize();
+        CUdeviceptr dataPointer = data.getDevicePointer();
+        CUdeviceptr bufferPointer = radixBuffer->getDevicePointer();
+        for (int bitOffset = 0; bitOffset < (int) numKeyBits; bitOffset += radixBits) {
+            CUdeviceptr in = ((bitOffset/radixBits)%2 == 0 ? dataPointer : bufferPointer);
+            CUdeviceptr out = (in == dataPointer ? bufferPointer : dataPointer);
+
+            // Count the number of elements with each value of the current digit.
+
+            void* histogramArgs[] = {&in, &radixHistogram->getDevicePointer(), &dataLength, &radixTiles, &bitOffset};
+            context.executeKernel(computeRadixHistogramKernel, histogramArgs, radixTiles*radixBlockSize, radixBlockSize);
+
+            // Compute the position where each group of elements starts.
+
+            void* offsetsArgs[] = {&radixHistogram->getDevicePointer(), &histogramSize};
+            context.executeKernel(computeRadixOffsetsKernel, offsetsArgs, positionsKernelSize, positionsKernelSize, positionsKernelSize*sizeof(int));
+
+            // Reorder the data based on the current digit.
+
+            void* scatterArgs[] = {&in, &out, &radixHistogram->getDevicePointer(), &dataLength, &radixTiles, &bitOffset};
+            context.executeKernel(radixScatterKernel, scatterArgs, radixTiles*radixBlockSize, radixBlockSize, radixBlockSize*sizeof(int));
+        }
+    }
     else {
         // Compute the range of data values.
 
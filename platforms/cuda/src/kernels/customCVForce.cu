@@ -0,0 +1,13 @@
+/**
+ * Add the forces from the collective variables, already combined on the host in particle
+ * order, into the main force buffer.  They are remapped through the atom index array.
+ */
+extern "C" __global__ void addForces(const double* __restrict__ forces, long long* __restrict__ forceBuffer,
+        const int* __restrict__ atomIndex, int numAtoms, int paddedNumAtoms) {
+    for (int i = blockIdx.x*blockDim.x+threadIdx.x; i < numAtoms; i += blockDim.x*gridDim.x) {
+        int index = atomIndex[i];
+        forceBuffer[i] += (long long) (forces[3*index]*0x100000000);
+        forceBuffer[i+paddedNumAtoms] += (long long) (forces[3*index+1]*0x100000000);
+        forceBuffer[i+paddedNumAtoms*2] += (long long) (forces[3*index+2]*0x100000000);
+    }
+}
@@ -1,16 +1,23 @@
 /**
- * Compute the center of each group.
+ * Compute the center of each group.  Each warp computes the center of one group, reducing
+ * within its own segment of shared memory.  Since most groups contain far fewer particles
+ * than a thread block, this keeps more threads busy than assigning a whole block to each
+ * group, and the warp-synchronous reduction needs no block-wide synchronization.
  */
 extern "C" __global__ void computeGroupCenters(const real4* __restrict__ posq, const int* __restrict__ groupParticles,
         const real* __restrict__ groupWeights, const int* __restrict__ groupOffsets, real4* __restrict__ centerPositions) {
     __shared__ volatile real3 temp[64];
-    for (int group = blockIdx.x; group < NUM_GROUPS; group += gridDim.x) {
-        // The threads in this block work together to compute the center one group.
-        
+    const int warpsPerBlock = blockDim.x/32;
+    const int warp = threadIdx.x/32;
+    const int lane = threadIdx.x-warp*32;
+    volatile real3* warpTemp = &temp[warp*32];
+    for (int group = blockIdx.x*warpsPerBlock+warp; group < NUM_GROUPS; group += gridDim.x*warpsPerBlock) {
+        // The threads in this warp work together to compute the center of one group.
+
         int firstIndex = groupOffsets[group];
         int lastIndex = groupOffsets[group+1];
         real3 center = make_real3(0, 0, 0);
-        for (int index = threadIdx.x; index < lastIndex-firstIndex; index += blockDim.x) {
+        for (int index = lane; index < lastIndex-firstIndex; index += 32) {
             int atom = groupParticles[firstIndex+index];
             real weight = groupWeights[firstIndex+index];
             real4 pos = posq[atom];
@@ -18,41 +25,34 @@ extern "C" __global__ void computeGroupCenters(const real4* __restrict__ posq, c
             center.y += weight*pos.y;
             center.z += weight*pos.z;
         }
-        
+
         // Sum the values.
-        
-        int thread = threadIdx.x;
-        temp[thread].x = center.x;
-        temp[thread].y = center.y;
-        temp[thread].z = center.z;
-        __syncthreads();
-        if (thread < 32) {
-            temp[thread].x += temp[thread+32].x;
-            temp[thread].y += temp[thread+32].y;
-            temp[thread].z += temp[thread+32].z;
-            if (thread < 16) {
-                temp[thread].x += temp[thread+16].x;
-                temp[thread].y += temp[thread+16].y;
-                temp[thread].z += temp[thread+16].z;
-            }
-            if (thread < 8) {
-                temp[thread].x += temp[thread+8].x;
-                temp[thread].y += temp[thread+8].y;
-                temp[thread].z += temp[thread+8].z;
-            }
-            if (thread < 4) {
-                temp[thread].x += temp[thread+4].x;
-                temp[thread].y += temp[thread+4].y;
-                temp[thread].z += temp[thread+4].z;
-            }
-            if (thread < 2) {
-                temp[thread].x += temp[thread+2].x;
-                temp[thread].y += temp[thread+2].y;
-                temp[thread].z += temp[thread+2].z;
-            }
+
+        warpTemp[lane].x = center.x;
+        warpTemp[lane].y = center.y;
+        warpTemp[lane].z = center.z;
+        if (lane < 16) {
+            warpTemp[lane].x += warpTemp[lane+16].x;
+            warpTemp[lane].y += warpTemp[lane+16].y;
+            warpTemp[lane].z += warpTemp[lane+16].z;
+        }
+        if (lane < 8) {
+            warpTemp[lane].x += warpTemp[lane+8].x;
+            warpTemp[lane].y += warpTemp[lane+8].y;
+            warpTemp[lane].z += warpTemp[lane+8].z;
+        }
+        if (lane < 4) {
+            warpTemp[lane].x += warpTemp[lane+4].x;
+            warpTemp[lane].y += warpTemp[lane+4].y;
+            warpTemp[lane].z += warpTemp[lane+4].z;
+        }
+        if (lane < 2) {
+            warpTemp[lane].x += warpTemp[lane+2].x;
+            warpTemp[lane].y += warpTemp[lane+2].y;
+            warpTemp[lane].z += warpTemp[lane+2].z;
         }
-        if (thread == 0)
-            centerPositions[group] = make_real4(temp[0].x+temp[1].x, temp[0].y+temp[1].y, temp[0].z+temp[1].z, 0);
+        if (lane == 0)
+            centerPositions[group] = make_real4(warpTemp[0].x+warpTemp[1].x, warpTemp[0].y+warpTemp[1].y, warpTemp[0].z+warpTemp[1].z, 0);
     }
 }
 
@@ -120,17 +120,21 @@ extern "C" __global__ void computeGroupForces(unsigned long long* __restrict__ g
 }
 
 /**
- * Apply the forces from the group centers to the individual atoms.
+ * Apply the forces from the group centers to the individual atoms.  As in computeGroupCenters,
+ * each warp processes one group.
  */
 extern "C" __global__ void applyForcesToAtoms(const int* __restrict__ groupParticles, const real* __restrict__ groupWeights, const int* __restrict__ groupOffsets,
         const long long* __restrict__ groupForce, unsigned long long* __restrict__ atomForce) {
-    for (int group = blockIdx.x; group < NUM_GROUPS; group += gridDim.x) {
+    const int warpsPerBlock = blockDim.x/32;
+    const int warp = threadIdx.x/32;
+    const int lane = threadIdx.x-warp*32;
+    for (int group = blockIdx.x*warpsPerBlock+warp; group < NUM_GROUPS; group += gridDim.x*warpsPerBlock) {
         long long fx = groupForce[group];
         long long fy = groupForce[group+NUM_GROUPS];
         long long fz = groupForce[group+NUM_GROUPS*2];
         int firstIndex = groupOffsets[group];
         int lastIndex = groupOffsets[group+1];
-        for (int index = threadIdx.x; index < lastIndex-firstIndex; index += blockDim.x) {
+        for (int index = lane; index < lastIndex-firstIndex; index += 32) {
             int atom = groupParticles[firstIndex+index];
             real weight = groupWeights[firstIndex+index];
             atomicAdd(&atomForce[atom], static_cast<unsigned long long>((long long) (fx*weight)));
@@ -0,0 +1,10 @@
+/**
+ * Update global variables whose values can be computed entirely on the device,
+ * so they never need to be transferred to the host.
+ */
+extern "C" __global__ void computeGlobals(mixed* __restrict__ globals, const mixed2* __restrict__ dt, mixed energy, const mixed* __restrict__ sum) {
+    if (blockIdx.x == 0 && threadIdx.x == 0) {
+        mixed stepSize = dt[0].y;
+        COMPUTE_STEP
+    }
+}
@@ -3,21 +3,24 @@ __device__ real2 multofReal2(real2 a, real2 b) {
 }
 
 /**
- * Precompute the cosine and sine sums which appear in each force term.
+ * Precompute the cosine and sine sums which appear in each force term.  Each thread block
+ * handles one wave vector at a time: the threads compute partial structure factors over
+ * disjoint subsets of the atoms, then combine them with a tree reduction.  This keeps the
+ * whole device busy even when the number of wave vectors is small compared to the number
+ * of atoms.
  */
 
 extern "C" __global__ void calculateEwaldCosSinSums(mixed* __restrict__ energyBuffer, const real4* __restrict__ posq, real2* __restrict__ cosSinSum, real4 periodicBoxSize) {
+    extern __shared__ real2 sumBuffer[];
     const unsigned int ksizex = 2*KMAX_X-1;
     const unsigned int ksizey = 2*KMAX_Y-1;
     const unsigned int ksizez = 2*KMAX_Z-1;
     const unsigned int totalK = ksizex*ksizey*ksizez;
+    const unsigned int lowestK = (KMAX_Y-1)*ksizez+KMAX_Z;
     real3 reciprocalBoxSize = make_real3(2*M_PI/periodicBoxSize.x, 2*M_PI/periodicBoxSize.y, 2*M_PI/periodicBoxSize.z);
     real reciprocalCoefficient = ONE_4PI_EPS0*4*M_PI/(periodicBoxSize.x*periodicBoxSize.y*periodicBoxSize.z);
-    unsigned int index = blockIdx.x*blockDim.x+threadIdx.x;
     mixed energy = 0;
-    while (index < (KMAX_Y-1)*ksizez+KMAX_Z)
-        index += blockDim.x*gridDim.x;
-    while (index < totalK) {
+    for (unsigned int index = lowestK+blockIdx.x; index < totalK; index += gridDim.x) {
         // Find the wave vector (kx, ky, kz) this index corresponds to.
 
         int rx = index/(ksizey*ksizez);
@@ -29,10 +32,10 @@ extern "C" __global__ void calculateEwaldCosSinSums(mixed* __restrict__ energyBu
         real ky = ry*reciprocalBoxSize.y;
         real kz = rz*reciprocalBoxSize.z;
 
-        // Compute the sum for this wave vector.
+        // Compute a partial sum over this thread's subset of the atoms.
 
         real2 sum = make_real2(0);
-        for (int atom = 0; atom < NUM_ATOMS; atom++) {
+        for (int atom = threadIdx.x; atom < NUM_ATOMS; atom += blockDim.x) {
             real4 apos = posq[atom];
             real phase = apos.x*kx;
             real2 structureFactor = make_real2(COS(phase), SIN(phase));
@@ -42,14 +45,26 @@ extern "C" __global__ void calculateEwaldCosSinSums(mixed* __restrict__ energyBu
             structureFactor = multofReal2(structureFactor, make_real2(COS(phase), SIN(phase)));
             sum += apos.w*structureFactor;
         }
-        cosSinSum[index] = sum;
 
-        // Compute the contribution to the energy.
+        // Combine the partial sums with a tree reduction.
 
-        real k2 = kx*kx + ky*ky + kz*kz;
-        real ak = EXP(k2*EXP_COEFFICIENT) / k2;
-        energy += reciprocalCoefficient*ak*(sum.x*sum.x + sum.y*sum.y);
-        index += blockDim.x*gridDim.x;
+        sumBuffer[threadIdx.x] = sum;
+        __syncthreads();
+        for (int step = blockDim.x/2; step > 0; step /= 2) {
+            if (threadIdx.x < step)
+                sumBuffer[threadIdx.x] += sumBuffer[threadIdx.x+step];
+            __syncthreads();
+        }
+        if (threadIdx.x == 0) {
+            sum = sumBuffer[0];
+            cosSinSum[index] = sum;
+
+            // Compute the contribution to the energy.
+
+            real k2 = kx*kx + ky*ky + kz*kz;
+            real ak = EXP(k2*EXP_COEFFICIENT) / k2;
+            energy += reciprocalCoefficient*ak*(sum.x*sum.x + sum.y*sum.y);
+        }
     }
     energyBuffer[blockIdx.x*blockDim.x+threadIdx.x] += energy;
 }
@@ -1,12 +1,14 @@
 #define GROUP_SIZE 256
 #define BUFFER_SIZE 256
+#define SUPERBLOCK_SIZE 32
+#define NUM_SUPERBLOCKS ((NUM_BLOCKS+SUPERBLOCK_SIZE-1)/SUPERBLOCK_SIZE)
 
 /**
  * Find a bounding box for the atoms in each block.
  */
 extern "C" __global__ void findBlockBounds(int numAtoms, real4 periodicBoxSize, real4 invPeriodicBoxSize, real4 periodicBoxVecX, real4 periodicBoxVecY, real4 periodicBoxVecZ,
         const real4* __restrict__ posq, real4* __restrict__ blockCenter, real4* __restrict__ blockBoundingBox, int* __restrict__ rebuildNeighborList,
-        real2* __restrict__ sortedBlocks) {
+        real2* __restrict__ sortedBlocks, const real4* __restrict__ oldPositions, real* __restrict__ blockDisplacement) {
     int index = blockIdx.x*blockDim.x+threadIdx.x;
     int base = index*TILE_SIZE;
     while (base < numAtoms) {
@@ -29,6 +31,7 @@ extern "C" __global__ void findBlockBounds(int numAtoms, real4 periodicBoxSize,
         real4 blockSize = 0.5f*(maxPos-minPos);
         real4 center = 0.5f*(maxPos+minPos);
         center.w = 0;
+        real maxDisplacement2 = 0;
         for (int i = base; i < last; i++) {
             pos = posq[i];
             real4 delta = posq[i]-center;
@@ -36,8 +39,11 @@ extern "C" __global__ void findBlockBounds(int numAtoms, real4 periodicBoxSize,
             APPLY_PERIODIC_TO_DELTA(delta)
 #endif
             center.w = max(center.w, delta.x*delta.x+delta.y*delta.y+delta.z*delta.z);
+            real4 oldDelta = oldPositions[i]-posq[i];
+            maxDisplacement2 = max(maxDisplacement2, oldDelta.x*oldDelta.x+oldDelta.y*oldDelta.y+oldDelta.z*oldDelta.z);
         }
         center.w = sqrt(center.w);
+        blockDisplacement[index] = sqrt(maxDisplacement2);
         blockBoundingBox[index] = blockSize;
         blockCenter[index] = center;
         sortedBlocks[index] = make_real2(blockSize.x+blockSize.y+blockSize.z, index);
@@ -53,23 +59,84 @@ extern "C" __global__ void findBlockBounds(int numAtoms, real4 periodicBoxSize,
  */
 extern "C" __global__ void sortBoxData(const real2* __restrict__ sortedBlock, const real4* __restrict__ blockCenter,
         const real4* __restrict__ blockBoundingBox, real4* __restrict__ sortedBlockCenter,
-        real4* __restrict__ sortedBlockBoundingBox, const real4* __restrict__ posq, const real4* __restrict__ oldPositions,
-        unsigned int* __restrict__ interactionCount, int* __restrict__ rebuildNeighborList, bool forceRebuild) {
+        real4* __restrict__ sortedBlockBoundingBox) {
     for (int i = threadIdx.x+blockIdx.x*blockDim.x; i < NUM_BLOCKS; i += blockDim.x*gridDim.x) {
         int index = (int) sortedBlock[i].y;
         sortedBlockCenter[i] = blockCenter[index];
         sortedBlockBoundingBox[i] = blockBoundingBox[index];
     }
-    
-    // Also check whether any atom has moved enough so that we really need to rebuild the neighbor list.
+}
 
-    bool rebuild = forceRebuild;
-    for (int i = threadIdx.x+blockIdx.x*blockDim.x; i < NUM_ATOMS; i += blockDim.x*gridDim.x) {
-        real4 delta = oldPositions[i]-posq[i];
-        if (delta.x*delta.x + delta.y*delta.y + delta.z*delta.z > 0.25f*PADDING*PADDING)
-            rebuild = true;
+/**
+ * Compute a bounding box enclosing each group of SUPERBLOCK_SIZE consecutive atom blocks.
+ * Because the atoms are ordered along a space filling curve, consecutive blocks are close
+ * together, so these boxes let the interacting block search reject a whole group of blocks
+ * with a single test.
+ */
+extern "C" __global__ void findSuperBlockBounds(const real4* __restrict__ blockCenter, const real4* __restrict__ blockBoundingBox,
+        real4* __restrict__ superBlockCenter, real4* __restrict__ superBlockBoundingBox, const int* __restrict__ rebuildNeighborList) {
+    if (rebuildNeighborList[0] == 0)
+        return; // The neighbor list doesn't need to be rebuilt.
+    for (int index = blockIdx.x*blockDim.x+threadIdx.x; index < NUM_SUPERBLOCKS; index += blockDim.x*gridDim.x) {
+        int first = index*SUPERBLOCK_SIZE;
+        int last = min(first+SUPERBLOCK_SIZE, NUM_BLOCKS);
+        real4 center = blockCenter[first];
+        real4 size = blockBoundingBox[first];
+        real4 minPos = make_real4(center.x-size.x, center.y-size.y, center.z-size.z, 0);
+        real4 maxPos = make_real4(center.x+size.x, center.y+size.y, center.z+size.z, 0);
+        for (int i = first+1; i < last; i++) {
+            center = blockCenter[i];
+            size = blockBoundingBox[i];
+            minPos = make_real4(min(minPos.x, center.x-size.x), min(minPos.y, center.y-size.y), min(minPos.z, center.z-size.z), 0);
+            maxPos = make_real4(max(maxPos.x, center.x+size.x), max(maxPos.y, center.y+size.y), max(maxPos.z, center.z+size.z), 0);
+        }
+        superBlockCenter[index] = 0.5f*(maxPos+minPos);
+        superBlockBoundingBox[index] = 0.5f*(maxPos-minPos);
     }
-    if (rebuild) {
+}
+
+/**
+ * Decide whether the neighbor list needs to be rebuilt.  The padded cutoff lets the list remain
+ * valid until two atoms in different blocks could have moved close enough together to interact,
+ * that is, until the sum of the two largest per-block displacements since the last rebuild
+ * exceeds the padding distance.  Interactions between atoms in the same block are always
+ * computed, so they can never require a rebuild.  This kernel is executed as a single
+ * thread block.
+ */
+extern "C" __global__ void checkNeighborListRebuild(const real* __restrict__ blockDisplacement,
+        unsigned int* __restrict__ interactionCount, int* __restrict__ rebuildNeighborList, bool forceRebuild) {
+    __shared__ real largestBuffer[GROUP_SIZE];
+    __shared__ real secondBuffer[GROUP_SIZE];
+
+    // Each thread finds the two largest displacements in a subset of the blocks.
+
+    real largest = 0;
+    real second = 0;
+    for (int i = threadIdx.x; i < NUM_BLOCKS; i += blockDim.x) {
+        real displacement = blockDisplacement[i];
+        if (displacement > largest) {
+            second = largest;
+            largest = displacement;
+        }
+        else if (displacement > second)
+            second = displacement;
+    }
+
+    // Now reduce them.
+
+    largestBuffer[threadIdx.x] = largest;
+    secondBuffer[threadIdx.x] = second;
+    __syncthreads();
+    for (unsigned int step = 1; step < blockDim.x; step *= 2) {
+        if (threadIdx.x+step < blockDim.x && threadIdx.x%(2*step) == 0) {
+            real largest1 = largestBuffer[threadIdx.x];
+            real largest2 = largestBuffer[threadIdx.x+step];
+            largestBuffer[threadIdx.x] = max(largest1, largest2);
+            secondBuffer[threadIdx.x] = (largest1 > largest2 ? max(largest2, secondBuffer[threadIdx.x]) : max(largest1, secondBuffer[threadIdx.x+step]));
+        }
+        __syncthreads();
+    }
+    if (threadIdx.x == 0 && (forceRebuild || largestBuffer[0]+secondBuffer[0] > PADDING)) {
         rebuildNeighborList[0] = 1;
         interactionCount[0] = 0;
         interactionCount[1] = 0;
@@ -180,7 +247,9 @@ extern "C" __global__ void findBlocksWithInteractions(real4 periodicBoxSize, rea
         int2* __restrict__ singlePairs, const real4* __restrict__ posq, unsigned int maxTiles, unsigned int maxSinglePairs,
         unsigned int startBlockIndex, unsigned int numBlocks, real2* __restrict__ sortedBlocks, const real4* __restrict__ sortedBlockCenter,
         const real4* __restrict__ sortedBlockBoundingBox, const unsigned int* __restrict__ exclusionIndices, const unsigned int* __restrict__ exclusionRowIndices,
-        real4* __restrict__ oldPositions, const int* __restrict__ rebuildNeighborList) {
+        real4* __restrict__ oldPositions, const int* __restrict__ rebuildNeighborList,
+        const real4* __restrict__ superBlockCenter, const real4* __restrict__ superBlockBoundingBox,
+        const real4* __restrict__ blockCenter, const real4* __restrict__ blockBoundingBox) {
 
     if (rebuildNeighborList[0] == 0)
         return; // The neighbor list doesn't need to be rebuilt.
@@ -237,15 +306,37 @@ extern "C" __global__ void findBlocksWithInteractions(real4 periodicBoxSize, rea
         if (MAX_EXCLUSIONS > 32)
             __syncthreads();
         
-        // Loop over atom blocks to search for neighbors.  The threads in a warp compare block1 against 32
-        // other blocks in parallel.
+        // Loop over atom blocks to search for neighbors.  The blocks are processed in groups of
+        // SUPERBLOCK_SIZE consecutive blocks whose combined bounding boxes were computed by
+        // findSuperBlockBounds().  Because the atoms are ordered along a space filling curve,
+        // consecutive blocks are close together and a single test can reject a whole group.
+        // The threads in a warp then compare block1 against the blocks of each surviving group
+        // in parallel.  Pairs are enumerated by block index, so each pair is visited exactly once.
 
-        for (int block2Base = block1+1; block2Base < NUM_BLOCKS; block2Base += 32) {
-            int block2 = block2Base+indexInWarp;
-            bool includeBlock2 = (block2 < NUM_BLOCKS);
+        for (int superBlock = x/SUPERBLOCK_SIZE; superBlock < NUM_SUPERBLOCKS; superBlock++) {
+            real4 superSize = superBlockBoundingBox[superBlock];
+            real4 superDelta = superBlockCenter[superBlock]-blockCenterX;
+#ifdef USE_PERIODIC
+            APPLY_PERIODIC_TO_DELTA(superDelta)
+#endif
+            superDelta.x = max(0.0f, fabs(superDelta.x)-superSize.x-blockSizeX.x);
+            superDelta.y = max(0.0f, fabs(superDelta.y)-superSize.y-blockSizeX.y);
+            superDelta.z = max(0.0f, fabs(superDelta.z)-superSize.z-blockSizeX.z);
+            bool includeSuperBlock = (superDelta.x*superDelta.x+superDelta.y*superDelta.y+superDelta.z*superDelta.z < PADDED_CUTOFF_SQUARED);
+#ifdef TRICLINIC
+            // The calculation to find the nearest periodic copy is only guaranteed to work if the nearest copy is less than half a box width away.
+            // If there's any possibility we might have missed it, do a detailed check.
+
+            if (periodicBoxSize.z/2-superSize.z-blockSizeX.z < PADDED_CUTOFF || periodicBoxSize.y/2-superSize.y-blockSizeX.y < PADDED_CUTOFF)
+                includeSuperBlock = true;
+#endif
+            if (!includeSuperBlock)
+                continue;
+            int block2 = superBlock*SUPERBLOCK_SIZE+indexInWarp;
+            bool includeBlock2 = (block2 > x && block2 < NUM_BLOCKS);
             if (includeBlock2) {
-                real4 blockCenterY = sortedBlockCenter[block2];
-                real4 blockSizeY = sortedBlockBoundingBox[block2];
+                real4 blockCenterY = blockCenter[block2];
+                real4 blockSizeY = blockBoundingBox[block2];
                 real4 blockDelta = blockCenterX-blockCenterY;
 #ifdef USE_PERIODIC
                 APPLY_PERIODIC_TO_DELTA(blockDelta)
@@ -256,26 +347,23 @@ extern "C" __global__ void findBlocksWithInteractions(real4 periodicBoxSize, rea
                 blockDelta.z = max(0.0f, fabs(blockDelta.z)-blockSizeX.z-blockSizeY.z);
                 includeBlock2 &= (blockDelta.x*blockDelta.x+blockDelta.y*blockDelta.y+blockDelta.z*blockDelta.z < PADDED_CUTOFF_SQUARED);
 #ifdef TRICLINIC
-                // The calculation to find the nearest periodic copy is only guaranteed to work if the nearest copy is less than half a box width away.
-                // If there's any possibility we might have missed it, do a detailed check.
-
                 if (periodicBoxSize.z/2-blockSizeX.z-blockSizeY.z < PADDED_CUTOFF || periodicBoxSize.y/2-blockSizeX.y-blockSizeY.y < PADDED_CUTOFF)
                     includeBlock2 = true;
 #endif
                 if (includeBlock2) {
-                    unsigned short y = (unsigned short) sortedBlocks[block2].y;
+                    unsigned short y = (unsigned short) block2;
                     for (int k = 0; k < numExclusions; k++)
                         includeBlock2 &= (exclusionsForX[k] != y);
                 }
             }
-            
+
             // Loop over any blocks we identified as potentially containing neighbors.
-            
+
             int includeBlockFlags = __ballot(includeBlock2);
             while (includeBlockFlags != 0) {
                 int i = __ffs(includeBlockFlags)-1;
                 includeBlockFlags &= includeBlockFlags-1;
-                unsigned short y = (unsigned short) sortedBlocks[block2Base+i].y;
+                unsigned short y = (unsigned short) (superBlock*SUPERBLOCK_SIZE+i);
 
                 // Check each atom in block Y for interactions.
 
@@ -286,7 +374,7 @@ extern "C" __global__ void findBlocksWithInteractions(real4 periodicBoxSize, rea
                     APPLY_PERIODIC_TO_POS_WITH_CENTER(pos2, blockCenterX)
                 }
 #endif
-                real4 blockCenterY = sortedBlockCenter[block2Base+i];
+                real4 blockCenterY = blockCenter[y];
                 real3 atomDelta = posBuffer[warpStart+indexInWarp]-trimTo3(blockCenterY);
 #ifdef USE_PERIODIC
                 APPLY_PERIODIC_TO_DELTA(atomDelta)
@@ -0,0 +1,95 @@
+enum {VelScale, NoiseScale, MaxParams};
+
+/**
+ * Perform the first step of LFMiddle Langevin integration: apply the full step
+ * velocity kick from the forces.
+ */
+
+extern "C" __global__ void integrateLangevinMiddlePart1(int numAtoms, int paddedNumAtoms, mixed4* __restrict__ velm, const long long* __restrict__ force,
+        const mixed2* __restrict__ dt) {
+    mixed fscale = dt[0].y/(mixed) 0x100000000;
+    int index = blockIdx.x*blockDim.x+threadIdx.x;
+    while (index < numAtoms) {
+        mixed4 velocity = velm[index];
+        if (velocity.w != 0) {
+            velocity.x += fscale*velocity.w*force[index];
+            velocity.y += fscale*velocity.w*force[index+paddedNumAtoms];
+            velocity.z += fscale*velocity.w*force[index+paddedNumAtoms*2];
+            velm[index] = velocity;
+        }
+        index += blockDim.x*gridDim.x;
+    }
+}
+
+/**
+ * Perform the second step of LFMiddle Langevin integration: a half step position
+ * update, the friction and random force, and another half step position update.
+ * The unconstrained position change is recorded in oldDelta so the velocities can
+ * be corrected after the constraints are applied.
+ */
+
+extern "C" __global__ void integrateLangevinMiddlePart2(int numAtoms, mixed4* __restrict__ velm, mixed4* __restrict__ posDelta, mixed4* __restrict__ oldDelta,
+        const mixed* __restrict__ paramBuffer, const mixed2* __restrict__ dt, const float4* __restrict__ random, unsigned int randomIndex) {
+    mixed vscale = paramBuffer[VelScale];
+    mixed noisescale = paramBuffer[NoiseScale];
+    mixed halfdt = 0.5f*dt[0].y;
+    int index = blockIdx.x*blockDim.x+threadIdx.x;
+    randomIndex += index;
+    while (index < numAtoms) {
+        mixed4 velocity = velm[index];
+        if (velocity.w != 0) {
+            mixed4 delta = make_mixed4(halfdt*velocity.x, halfdt*velocity.y, halfdt*velocity.z, 0);
+            mixed sigma = noisescale*SQRT(velocity.w);
+            velocity.x = vscale*velocity.x + sigma*random[randomIndex].x;
+            velocity.y = vscale*velocity.y + sigma*random[randomIndex].y;
+            velocity.z = vscale*velocity.z + sigma*random[randomIndex].z;
+            velm[index] = velocity;
+            delta.x += halfdt*velocity.x;
+            delta.y += halfdt*velocity.y;
+            delta.z += halfdt*velocity.z;
+            posDelta[index] = delta;
+            oldDelta[index] = delta;
+        }
+        randomIndex += blockDim.x*gridDim.x;
+        index += blockDim.x*gridDim.x;
+    }
+}
+
+/**
+ * Perform the third step of LFMiddle Langevin integration: correct the velocities
+ * for any position adjustment made by the constraints, then record the new positions.
+ */
+
+extern "C" __global__ void integrateLangevinMiddlePart3(int numAtoms, real4* __restrict__ posq, real4* __restrict__ posqCorrection, mixed4* __restrict__ velm,
+        const mixed4* __restrict__ posDelta, const mixed4* __restrict__ oldDelta, const mixed2* __restrict__ dt) {
+    mixed invStepSize = RECIP(dt[0].y);
+    int index = blockIdx.x*blockDim.x+threadIdx.x;
+    while (index < numAtoms) {
+        mixed4 vel = velm[index];
+        if (vel.w != 0) {
+#ifdef USE_MIXED_PRECISION
+            real4 pos1 = posq[index];
+            real4 pos2 = posqCorrection[index];
+            mixed4 pos = make_mixed4(pos1.x+(mixed)pos2.x, pos1.y+(mixed)pos2.y, pos1.z+(mixed)pos2.z, pos1.w);
+#else
+            real4 pos = posq[index];
+#endif
+            mixed4 delta = posDelta[index];
+            mixed4 old = oldDelta[index];
+            pos.x += delta.x;
+            pos.y += delta.y;
+            pos.z += delta.z;
+            vel.x += invStepSize*(delta.x-old.x);
+            vel.y += invStepSize*(delta.y-old.y);
+            vel.z += invStepSize*(delta.z-old.z);
+#ifdef USE_MIXED_PRECISION
+            posq[index] = make_real4((real) pos.x, (real) pos.y, (real) pos.z, (real) pos.w);
+            posqCorrection[index] = make_real4(pos.x-(real) pos.x, pos.y-(real) pos.y, pos.z-(real) pos.z, 0);
+#else
+            posq[index] = pos;
+#endif
+            velm[index] = vel;
+        }
+        index += blockDim.x*gridDim.x;
+    }
+}
@@ -1,8 +1,19 @@
+// The grid is divided into tiles of TILE_CELLS^3 points.  The charge spreading kernel
+// accumulates the charge for one tile (plus the halo the interpolation reaches into) in
+// shared memory, so atoms are sorted by the tile they belong to.
+
+#define TILE_CELLS 8
+#define TILE_DIM (TILE_CELLS+PME_ORDER-1)
+#define TILE_SIZE (TILE_DIM*TILE_DIM*TILE_DIM)
+#define NUM_TILES_X ((GRID_SIZE_X+TILE_CELLS-1)/TILE_CELLS)
+#define NUM_TILES_Y ((GRID_SIZE_Y+TILE_CELLS-1)/TILE_CELLS)
+#define NUM_TILES_Z ((GRID_SIZE_Z+TILE_CELLS-1)/TILE_CELLS)
+
 extern "C" __global__ void findAtomGridIndex(const real4* __restrict__ posq, int2* __restrict__ pmeAtomGridIndex,
             real4 periodicBoxSize, real4 invPeriodicBoxSize, real4 periodicBoxVecX, real4 periodicBoxVecY, real4 periodicBoxVecZ,
             real3 recipBoxVecX, real3 recipBoxVecY, real3 recipBoxVecZ) {
-    // Compute the index of the grid point each atom is associated with.
-    
+    // Compute the index of the tile each atom is associated with.
+
     for (int i = blockIdx.x*blockDim.x+threadIdx.x; i < NUM_ATOMS; i += blockDim.x*gridDim.x) {
         real4 pos = posq[i];
         APPLY_PERIODIC_TO_POS(pos)
@@ -15,10 +26,27 @@ extern "C" __global__ void findAtomGridIndex(const real4* __restrict__ posq, int
         int3 gridIndex = make_int3(((int) t.x) % GRID_SIZE_X,
                                    ((int) t.y) % GRID_SIZE_Y,
                                    ((int) t.z) % GRID_SIZE_Z);
-        pmeAtomGridIndex[i] = make_int2(i, gridIndex.x*GRID_SIZE_Y*GRID_SIZE_Z+gridIndex.y*GRID_SIZE_Z+gridIndex.z);
+        int3 tileIndex = make_int3(gridIndex.x/TILE_CELLS, gridIndex.y/TILE_CELLS, gridIndex.z/TILE_CELLS);
+        pmeAtomGridIndex[i] = make_int2(i, (tileIndex.x*NUM_TILES_Y+tileIndex.y)*NUM_TILES_Z+tileIndex.z);
     }
 }
 
+/**
+ * Add a value to a point of the global grid, converting it to the grid's storage format.
+ */
+__device__ void addToGrid(real* __restrict__ originalPmeGrid, int index, real add) {
+#ifdef USE_DOUBLE_PRECISION
+    unsigned long long * ulonglong_p = (unsigned long long *) originalPmeGrid;
+    atomicAdd(&ulonglong_p[index],  static_cast<unsigned long long>((long long) (add*0x100000000)));
+#elif __CUDA_ARCH__ < 200 || defined(USE_DETERMINISTIC_FORCES)
+    unsigned long long * ulonglong_p = (unsigned long long *) originalPmeGrid;
+    int gridIndex = (index%2 == 0 ? index/2 : (index+GRID_SIZE_X*GRID_SIZE_Y*GRID_SIZE_Z)/2);
+    atomicAdd(&ulonglong_p[gridIndex],  static_cast<unsigned long long>((long long) (add*0x100000000)));
+#else
+    atomicAdd(&originalPmeGrid[index], add*EPSILON_FACTOR);
+#endif
+}
+
 extern "C" __global__ void gridSpreadCharge(const real4* __restrict__ posq, real* __restrict__ originalPmeGrid,
         real4 periodicBoxSize, real4 invPeriodicBoxSize, real4 periodicBoxVecX, real4 periodicBoxVecY, real4 periodicBoxVecZ,
         real3 recipBoxVecX, real3 recipBoxVecY, real3 recipBoxVecZ, const int2* __restrict__ pmeAtomGridIndex
@@ -28,83 +56,144 @@ extern "C" __global__ void gridSpreadCharge(const real4* __restrict__ posq, real
         ) {
     real3 data[PME_ORDER];
     const real scale = RECIP(PME_ORDER-1);
-    
-    // Process the atoms in spatially sorted order.  This improves efficiency when writing
-    // the grid values.
-    
-    for (int i = blockIdx.x*blockDim.x+threadIdx.x; i < NUM_ATOMS; i += blockDim.x*gridDim.x) {
-        int atom = pmeAtomGridIndex[i].x;
-        real4 pos = posq[atom];
-        APPLY_PERIODIC_TO_POS(pos)
-        real3 t = make_real3(pos.x*recipBoxVecX.x+pos.y*recipBoxVecY.x+pos.z*recipBoxVecZ.x,
-                             pos.y*recipBoxVecY.y+pos.z*recipBoxVecZ.y,
-                             pos.z*recipBoxVecZ.z);
-        t.x = (t.x-floor(t.x))*GRID_SIZE_X;
-        t.y = (t.y-floor(t.y))*GRID_SIZE_Y;
-        t.z = (t.z-floor(t.z))*GRID_SIZE_Z;
-        int3 gridIndex = make_int3(((int) t.x) % GRID_SIZE_X,
-                                   ((int) t.y) % GRID_SIZE_Y,
-                                   ((int) t.z) % GRID_SIZE_Z);
+#if __CUDA_ARCH__ >= 200
+#if defined(USE_DOUBLE_PRECISION) || defined(USE_DETERMINISTIC_FORCES)
+    __shared__ unsigned long long tile[TILE_SIZE];
+#else
+    __shared__ real tile[TILE_SIZE];
+#endif
+#endif
+
+    // Process the atoms in spatially sorted order.  Each block takes one chunk of the
+    // sorted list at a time, accumulates its charge into a sub-grid held in shared
+    // memory, then flushes the sub-grid to the global grid.  Most atomic operations
+    // therefore stay within the block instead of contending on global memory.
+
+    for (int base = blockIdx.x*blockDim.x; base < NUM_ATOMS; base += blockDim.x*gridDim.x) {
+#if __CUDA_ARCH__ >= 200
+        // The sub-grid covers the tile containing the first atom of the chunk, plus the
+        // halo of points the interpolation reaches into.  Since the atoms are sorted by
+        // tile, most other atoms in the chunk fall inside the same region.  Ones that do
+        // not are spread directly to the global grid.
+
+        int firstTile = pmeAtomGridIndex[base].y;
+        int originX = TILE_CELLS*(firstTile/(NUM_TILES_Y*NUM_TILES_Z));
+        int originY = TILE_CELLS*((firstTile/NUM_TILES_Z)%NUM_TILES_Y);
+        int originZ = TILE_CELLS*(firstTile%NUM_TILES_Z);
+        for (int j = threadIdx.x; j < TILE_SIZE; j += blockDim.x)
+            tile[j] = 0;
+        __syncthreads();
+#endif
+        int i = base+threadIdx.x;
+        if (i < NUM_ATOMS) {
+            int atom = pmeAtomGridIndex[i].x;
+            real4 pos = posq[atom];
+            APPLY_PERIODIC_TO_POS(pos)
+            real3 t = make_real3(pos.x*recipBoxVecX.x+pos.y*recipBoxVecY.x+pos.z*recipBoxVecZ.x,
+                                 pos.y*recipBoxVecY.y+pos.z*recipBoxVecZ.y,
+                                 pos.z*recipBoxVecZ.z);
+            t.x = (t.x-floor(t.x))*GRID_SIZE_X;
+            t.y = (t.y-floor(t.y))*GRID_SIZE_Y;
+            t.z = (t.z-floor(t.z))*GRID_SIZE_Z;
+            int3 gridIndex = make_int3(((int) t.x) % GRID_SIZE_X,
+                                       ((int) t.y) % GRID_SIZE_Y,
+                                       ((int) t.z) % GRID_SIZE_Z);
+
+            // Since we need the full set of thetas, it's faster to compute them here than load them
+            // from global memory.
+
+            real3 dr = make_real3(t.x-(int) t.x, t.y-(int) t.y, t.z-(int) t.z);
+            data[PME_ORDER-1] = make_real3(0);
+            data[1] = dr;
+            data[0] = make_real3(1)-dr;
+            for (int j = 3; j < PME_ORDER; j++) {
+                real div = RECIP(j-1);
+                data[j-1] = div*dr*data[j-2];
+                for (int k = 1; k < (j-1); k++)
+                    data[j-k-1] = div*((dr+make_real3(k))*data[j-k-2] + (make_real3(j-k)-dr)*data[j-k-1]);
+                data[0] = div*(make_real3(1)-dr)*data[0];
+            }
+            data[PME_ORDER-1] = scale*dr*data[PME_ORDER-2];
+            for (int j = 1; j < (PME_ORDER-1); j++)
+                data[PME_ORDER-j-1] = scale*((dr+make_real3(j))*data[PME_ORDER-j-2] + (make_real3(PME_ORDER-j)-dr)*data[PME_ORDER-j-1]);
+            data[0] = scale*(make_real3(1)-dr)*data[0];
+
+            // Spread the charge from this atom onto each grid point.
 
-        // Since we need the full set of thetas, it's faster to compute them here than load them
-        // from global memory.
-        
-        real3 dr = make_real3(t.x-(int) t.x, t.y-(int) t.y, t.z-(int) t.z);
-        data[PME_ORDER-1] = make_real3(0);
-        data[1] = dr;
-        data[0] = make_real3(1)-dr;
-        for (int j = 3; j < PME_ORDER; j++) {
-            real div = RECIP(j-1);
-            data[j-1] = div*dr*data[j-2];
-            for (int k = 1; k < (j-1); k++)
-                data[j-k-1] = div*((dr+make_real3(k))*data[j-k-2] + (make_real3(j-k)-dr)*data[j-k-1]);
-            data[0] = div*(make_real3(1)-dr)*data[0];
-        }
-        data[PME_ORDER-1] = scale*dr*data[PME_ORDER-2];
-        for (int j = 1; j < (PME_ORDER-1); j++)
-            data[PME_ORDER-j-1] = scale*((dr+make_real3(j))*data[PME_ORDER-j-2] + (make_real3(PME_ORDER-j)-dr)*data[PME_ORDER-j-1]);
-        data[0] = scale*(make_real3(1)-dr)*data[0];
-        
-        // Spread the charge from this atom onto each grid point.
-        
 #ifdef USE_LJPME
-        const float2 sigEps = sigmaEpsilon[atom];
-        const real charge = 8*sigEps.x*sigEps.x*sigEps.x*sigEps.y;
+            const float2 sigEps = sigmaEpsilon[atom];
+            const real charge = 8*sigEps.x*sigEps.x*sigEps.x*sigEps.y;
 #else
-        const real charge = pos.w;
+            const real charge = pos.w;
 #endif
-        for (int ix = 0; ix < PME_ORDER; ix++) {
-            int xbase = gridIndex.x+ix;
-            xbase -= (xbase >= GRID_SIZE_X ? GRID_SIZE_X : 0);
-            xbase = xbase*GRID_SIZE_Y*GRID_SIZE_Z;
-            real dx = data[ix].x;
-            
-            for (int iy = 0; iy < PME_ORDER; iy++) {
-                int ybase = gridIndex.y+iy;
-                ybase -= (ybase >= GRID_SIZE_Y ? GRID_SIZE_Y : 0);
-                ybase = xbase + ybase*GRID_SIZE_Z;
-                real dy = data[iy].y;
-                
-                for (int iz = 0; iz < PME_ORDER; iz++) {
-                    int zindex = gridIndex.z+iz;
-                    zindex -= (zindex >= GRID_SIZE_Z ? GRID_SIZE_Z : 0);
-                    int index = ybase + zindex;
+            for (int ix = 0; ix < PME_ORDER; ix++) {
+                int xindex = gridIndex.x+ix;
+                xindex -= (xindex >= GRID_SIZE_X ? GRID_SIZE_X : 0);
+#if __CUDA_ARCH__ >= 200
+                int lx = xindex-originX;
+                lx += (lx < 0 ? GRID_SIZE_X : 0);
+#endif
+                int xbase = xindex*GRID_SIZE_Y*GRID_SIZE_Z;
+                real dx = data[ix].x;
 
-                    real add = charge*dx*dy*data[iz].z;
-#ifdef USE_DOUBLE_PRECISION
-                    unsigned long long * ulonglong_p = (unsigned long long *) originalPmeGrid;
-                    atomicAdd(&ulonglong_p[index],  static_cast<unsigned long long>((long long) (add*0x100000000)));
-#elif __CUDA_ARCH__ < 200 || defined(USE_DETERMINISTIC_FORCES)
-                    unsigned long long * ulonglong_p = (unsigned long long *) originalPmeGrid;
-                    int gridIndex = index;
-                    gridIndex = (gridIndex%2 == 0 ? gridIndex/2 : (gridIndex+GRID_SIZE_X*GRID_SIZE_Y*GRID_SIZE_Z)/2);
-                    atomicAdd(&ulonglong_p[gridIndex],  static_cast<unsigned long long>((long long) (add*0x100000000)));
+                for (int iy = 0; iy < PME_ORDER; iy++) {
+                    int yindex = gridIndex.y+iy;
+                    yindex -= (yindex >= GRID_SIZE_Y ? GRID_SIZE_Y : 0);
+#if __CUDA_ARCH__ >= 200
+                    int ly = yindex-originY;
+                    ly += (ly < 0 ? GRID_SIZE_Y : 0);
+#endif
+                    int ybase = xbase + yindex*GRID_SIZE_Z;
+                    real dy = data[iy].y;
+
+                    for (int iz = 0; iz < PME_ORDER; iz++) {
+                        int zindex = gridIndex.z+iz;
+                        zindex -= (zindex >= GRID_SIZE_Z ? GRID_SIZE_Z : 0);
+                        real add = charge*dx*dy*data[iz].z;
+#if __CUDA_ARCH__ >= 200
+                        int lz = zindex-originZ;
+                        lz += (lz < 0 ? GRID_SIZE_Z : 0);
+                        if (lx < TILE_DIM && ly < TILE_DIM && lz < TILE_DIM) {
+#if defined(USE_DOUBLE_PRECISION) || defined(USE_DETERMINISTIC_FORCES)
+                            atomicAdd(&tile[(lx*TILE_DIM+ly)*TILE_DIM+lz], static_cast<unsigned long long>((long long) (add*0x100000000)));
+#else
+                            atomicAdd(&tile[(lx*TILE_DIM+ly)*TILE_DIM+lz], add);
+#endif
+                        }
+                        else
+                            addToGrid(originalPmeGrid, ybase+zindex, add);
 #else
-                    atomicAdd(&originalPmeGrid[index], add*EPSILON_FACTOR);
+                        addToGrid(originalPmeGrid, ybase+zindex, add);
 #endif
+                    }
                 }
             }
         }
+#if __CUDA_ARCH__ >= 200
+        __syncthreads();
+
+        // Flush the sub-grid to the global grid, skipping points no charge was spread to.
+
+        for (int j = threadIdx.x; j < TILE_SIZE; j += blockDim.x) {
+            if (tile[j] != 0) {
+                int x = (originX + j/(TILE_DIM*TILE_DIM)) % GRID_SIZE_X;
+                int y = (originY + (j/TILE_DIM)%TILE_DIM) % GRID_SIZE_Y;
+                int z = (originZ + j%TILE_DIM) % GRID_SIZE_Z;
+                int index = (x*GRID_SIZE_Y+y)*GRID_SIZE_Z+z;
+#ifdef USE_DOUBLE_PRECISION
+                unsigned long long * ulonglong_p = (unsigned long long *) originalPmeGrid;
+                atomicAdd(&ulonglong_p[index], tile[j]);
+#elif defined(USE_DETERMINISTIC_FORCES)
+                unsigned long long * ulonglong_p = (unsigned long long *) originalPmeGrid;
+                int packedIndex = (index%2 == 0 ? index/2 : (index+GRID_SIZE_X*GRID_SIZE_Y*GRID_SIZE_Z)/2);
+                atomicAdd(&ulonglong_p[packedIndex], tile[j]);
+#else
+                atomicAdd(&originalPmeGrid[index], tile[j]*EPSILON_FACTOR);
+#endif
+            }
+        }
+        __syncthreads();
+#endif
     }
 }
 
@@ -238,10 +327,23 @@ gridEvaluateEnergy(real2* __restrict__ halfcomplex_pmeGrid, mixed* __restrict__
 #endif
             energy += eterm*(grid.x*grid.x + grid.y*grid.y);
     }
+
+    // Sum the energies computed by the threads in this block, so only one thread
+    // needs to modify the energy buffer.
+
+    extern __shared__ mixed temp[];
+    temp[threadIdx.x] = energy;
+    __syncthreads();
+    for (int step = blockDim.x/2; step > 0; step /= 2) {
+        if (threadIdx.x < step)
+            temp[threadIdx.x] += temp[threadIdx.x+step];
+        __syncthreads();
+    }
 #if defined(USE_PME_STREAM) && !defined(USE_LJPME)
-    energyBuffer[blockIdx.x*blockDim.x+threadIdx.x] = 0.5f*energy;
+    energyBuffer[blockIdx.x*blockDim.x+threadIdx.x] = (threadIdx.x == 0 ? 0.5f*temp[0] : 0);
 #else
-    energyBuffer[blockIdx.x*blockDim.x+threadIdx.x] += 0.5f*energy;
+    if (threadIdx.x == 0)
+        energyBuffer[blockIdx.x*blockDim.x] += 0.5f*temp[0];
 #endif
 }
 
@@ -0,0 +1,27 @@
+/**
+ * Convert the positions to a fixed point representation, rounding each coordinate to the
+ * nearest multiple of the resolution.  The quantized values are written in the order the
+ * particles were defined, so the host can return them without any further reordering.
+ */
+
+extern "C" __global__ void quantizePositions(int numAtoms, const real4* __restrict__ posq, const real4* __restrict__ posqCorrection,
+        int* __restrict__ quantized, const int* __restrict__ atomIndex, const int4* __restrict__ cellOffsets,
+        real4 periodicBoxVecX, real4 periodicBoxVecY, real4 periodicBoxVecZ, double invResolution) {
+    for (int index = blockIdx.x*blockDim.x+threadIdx.x; index < numAtoms; index += blockDim.x*gridDim.x) {
+#ifdef USE_MIXED_PRECISION
+        real4 pos1 = posq[index];
+        real4 pos2 = posqCorrection[index];
+        mixed4 pos = make_mixed4(pos1.x+(mixed)pos2.x, pos1.y+(mixed)pos2.y, pos1.z+(mixed)pos2.z, pos1.w);
+#else
+        real4 pos = posq[index];
+#endif
+        int4 offset = cellOffsets[index];
+        pos.x -= offset.x*periodicBoxVecX.x+offset.y*periodicBoxVecY.x+offset.z*periodicBoxVecZ.x;
+        pos.y -= offset.y*periodicBoxVecY.y+offset.z*periodicBoxVecZ.y;
+        pos.z -= offset.z*periodicBoxVecZ.z;
+        int particle = atomIndex[index];
+        quantized[3*particle] = (int) floor(pos.x*invResolution+0.5);
+        quantized[3*particle+1] = (int) floor(pos.y*invResolution+0.5);
+        quantized[3*particle+2] = (int) floor(pos.z*invResolution+0.5);
+    }
+}
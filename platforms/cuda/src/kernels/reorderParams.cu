@@ -0,0 +1,12 @@
+/**
+ * Permute the elements of a parameter buffer to reflect a new atom order.  Each element
+ * is treated as an opaque block of ints, so this works for buffers of any type.
+ */
+extern "C" __global__ void reorderParameters(const int* __restrict__ input, int* __restrict__ output,
+        const int* __restrict__ sourceIndex, int numElements, int intsPerElement) {
+    for (int index = blockIdx.x*blockDim.x+threadIdx.x; index < numElements; index += blockDim.x*gridDim.x) {
+        int source = sourceIndex[index];
+        for (int j = 0; j < intsPerElement; j++)
+            output[index*intsPerElement+j] = input[source*intsPerElement+j];
+    }
+}
@@ -2,6 +2,15 @@ __device__ KEY_TYPE getValue(DATA_TYPE value) {
     return SORT_KEY;
 }
 
+/**
+ * Map the sorting key onto an unsigned integer whose ordering matches that of the key.
+ * This is used by the radix sort kernels.
+ */
+__device__ UINT_KEY_TYPE getUnsignedKey(DATA_TYPE value) {
+    KEY_TYPE key = getValue(value);
+    KEY_TO_UINT
+}
+
 extern "C" {
 
 /**
@@ -228,4 +237,91 @@ __global__ void sortBuckets(DATA_TYPE* __restrict__ data, const DATA_TYPE* __res
     }
 }
 
+/**
+ * Count how many elements of each tile have each value of the current radix digit.  Each
+ * thread block processes tiles of blockDim.x elements.  The counts are stored digit-major,
+ * so that a single prefix sum over the whole histogram gives the global start position of
+ * every (digit, tile) pair.
+ */
+__global__ void computeRadixHistogram(const DATA_TYPE* __restrict__ data, unsigned int* __restrict__ histogram,
+        unsigned int length, unsigned int numTiles, int bitOffset) {
+    __shared__ unsigned int counts[RADIX_SIZE];
+    for (unsigned int tile = blockIdx.x; tile < numTiles; tile += gridDim.x) {
+        for (unsigned int i = threadIdx.x; i < RADIX_SIZE; i += blockDim.x)
+            counts[i] = 0;
+        __syncthreads();
+        unsigned int index = tile*blockDim.x+threadIdx.x;
+        if (index < length) {
+            int digit = (int) ((getUnsignedKey(data[index])>>bitOffset)&(RADIX_SIZE-1));
+            atomicAdd(&counts[digit], 1);
+        }
+        __syncthreads();
+        for (unsigned int i = threadIdx.x; i < RADIX_SIZE; i += blockDim.x)
+            histogram[i*numTiles+tile] = counts[i];
+        __syncthreads();
+    }
+}
+
+/**
+ * Compute an inclusive prefix sum over the histogram to find the end position of every
+ * (digit, tile) pair.  This kernel is executed as a single work group.
+ */
+__global__ void computeRadixOffsets(unsigned int* __restrict__ histogram, unsigned int length) {
+    extern __shared__ unsigned int offsetBuffer[];
+    unsigned int globalOffset = 0;
+    for (unsigned int start = 0; start < length; start += blockDim.x) {
+        // Load the counts into local memory.
+
+        unsigned int globalIndex = start+threadIdx.x;
+        offsetBuffer[threadIdx.x] = (globalIndex < length ? histogram[globalIndex] : 0);
+        __syncthreads();
+
+        // Perform a parallel prefix sum.
+
+        for (unsigned int step = 1; step < blockDim.x; step *= 2) {
+            unsigned int add = (threadIdx.x >= step ? offsetBuffer[threadIdx.x-step] : 0);
+            __syncthreads();
+            offsetBuffer[threadIdx.x] += add;
+            __syncthreads();
+        }
+
+        // Write the results back to global memory.
+
+        if (globalIndex < length)
+            histogram[globalIndex] = offsetBuffer[threadIdx.x]+globalOffset;
+        globalOffset += offsetBuffer[blockDim.x-1];
+        __syncthreads();
+    }
+}
+
+/**
+ * Reorder the data based on the current radix digit.  Each thread block processes tiles of
+ * blockDim.x elements, stably ranking the elements of a tile that share a digit and writing
+ * them to their final position for this pass.
+ */
+__global__ void radixScatter(const DATA_TYPE* __restrict__ in, DATA_TYPE* __restrict__ out, const unsigned int* __restrict__ histogram,
+        unsigned int length, unsigned int numTiles, int bitOffset) {
+    extern __shared__ int digits[];
+    for (unsigned int tile = blockIdx.x; tile < numTiles; tile += gridDim.x) {
+        unsigned int index = tile*blockDim.x+threadIdx.x;
+        DATA_TYPE value;
+        int digit = RADIX_SIZE;
+        if (index < length) {
+            value = in[index];
+            digit = (int) ((getUnsignedKey(value)>>bitOffset)&(RADIX_SIZE-1));
+        }
+        digits[threadIdx.x] = digit;
+        __syncthreads();
+        if (index < length) {
+            int rank = 0;
+            for (unsigned int j = 0; j < threadIdx.x; j++)
+                rank += (digits[j] == digit ? 1 : 0);
+            unsigned int histogramIndex = ((unsigned int) digit)*numTiles+tile;
+            unsigned int offset = (histogramIndex == 0 ? 0 : histogram[histogramIndex-1]);
+            out[offset+rank] = value;
+        }
+        __syncthreads();
+    }
+}
+
 }
\ No newline at end of file
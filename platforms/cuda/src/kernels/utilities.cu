@@ -80,4 +80,26 @@ __global__ void setCharges(real* __restrict__ charges, real4* __restrict__ posq,
     for (int i = blockDim.x*blockIdx.x+threadIdx.x; i < numAtoms; i += blockDim.x*gridDim.x)
         posq[i].w = charges[atomOrder[i]];
 }
+
+/**
+ * Sum the energy buffer with a tree reduction.  Each thread block sums a strided subset of
+ * the buffer and records the result in a separate element of result.  Invoking this a
+ * second time with a single block then combines the partial sums into the total, which
+ * stays resident on the device.
+ */
+__global__ void reduceEnergyBuffer(const mixed* __restrict__ buffer, mixed* __restrict__ result, int bufferSize) {
+    __shared__ mixed tempBuffer[WORK_GROUP_SIZE];
+    const unsigned int thread = threadIdx.x;
+    mixed sum = 0;
+    for (unsigned int index = blockDim.x*blockIdx.x+threadIdx.x; index < bufferSize; index += blockDim.x*gridDim.x)
+        sum += buffer[index];
+    tempBuffer[thread] = sum;
+    for (int i = 1; i < WORK_GROUP_SIZE; i *= 2) {
+        __syncthreads();
+        if (thread%(i*2) == 0 && thread+i < WORK_GROUP_SIZE)
+            tempBuffer[thread] += tempBuffer[thread+i];
+    }
+    if (thread == 0)
+        result[blockIdx.x] = tempBuffer[0];
+}
 }
\ No newline at end of file
@@ -0,0 +1,46 @@
+/**
+ * Translate each molecule so its center lies inside the first periodic box, storing the
+ * result in a separate array so the simulation state is left untouched.  The positions in
+ * posq were last translated as whole molecules, so any reordering offsets they contain are
+ * uniform within a molecule and cancel out of the wrapped result.
+ */
+
+extern "C" __global__ void wrapMolecules(int numMolecules, real4 periodicBoxSize, real4 invPeriodicBoxSize,
+        real4 periodicBoxVecX, real4 periodicBoxVecY, real4 periodicBoxVecZ, const real4* __restrict__ posq,
+        real4* __restrict__ wrappedPosq, const int* __restrict__ moleculeAtoms, const int* __restrict__ moleculeStartIndex) {
+    for (int index = blockIdx.x*blockDim.x+threadIdx.x; index < numMolecules; index += blockDim.x*gridDim.x) {
+        int first = moleculeStartIndex[index];
+        int last = moleculeStartIndex[index+1];
+        int numAtoms = last-first;
+
+        // Find the center of each molecule.
+
+        real3 center = make_real3(0, 0, 0);
+        for (int atom = first; atom < last; atom++) {
+            real4 pos = posq[moleculeAtoms[atom]];
+            center.x += pos.x;
+            center.y += pos.y;
+            center.z += pos.z;
+        }
+        real invNumAtoms = RECIP(numAtoms);
+        center.x *= invNumAtoms;
+        center.y *= invNumAtoms;
+        center.z *= invNumAtoms;
+
+        // Find the displacement that moves it into the first periodic box.
+
+        real3 oldCenter = center;
+        APPLY_PERIODIC_TO_POS(center)
+        real3 delta = make_real3(oldCenter.x-center.x, oldCenter.y-center.y, oldCenter.z-center.z);
+
+        // Translate all the particles in the molecule.
+
+        for (int atom = first; atom < last; atom++) {
+            real4 pos = posq[moleculeAtoms[atom]];
+            pos.x -= delta.x;
+            pos.y -= delta.y;
+            pos.z -= delta.z;
+            wrappedPosq[moleculeAtoms[atom]] = pos;
+        }
+    }
+}
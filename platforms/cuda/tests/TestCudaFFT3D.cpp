@@ -56,7 +56,7 @@ void testTransform(bool realToComplex, int xsize, int ysize, int zsize) {
     system.addParticle(0.0);
     CudaPlatform::PlatformData platformData(NULL, system, "", "true", platform.getPropertyDefaultValue("CudaPrecision"), "false",
             platform.getPropertyDefaultValue(CudaPlatform::CudaCompiler()), platform.getPropertyDefaultValue(CudaPlatform::CudaTempDirectory()),
-            platform.getPropertyDefaultValue(CudaPlatform::CudaHostCompiler()), platform.getPropertyDefaultValue(CudaPlatform::CudaDisablePmeStream()), "false", 1);
+            platform.getPropertyDefaultValue(CudaPlatform::CudaKernelCacheDirectory()), platform.getPropertyDefaultValue(CudaPlatform::CudaHostCompiler()), platform.getPropertyDefaultValue(CudaPlatform::CudaDisablePmeStream()), "false", 1);
     CudaContext& context = *platformData.contexts[0];
     context.initialize();
     OpenMM_SFMT::SFMT sfmt;
@@ -122,6 +122,9 @@ int main(int argc, char* argv[]) {
             testTransform<double2>(true, 25, 28, 25);
             testTransform<double2>(true, 25, 25, 28);
             testTransform<double2>(true, 21, 25, 27);
+            testTransform<double2>(true, 22, 25, 25);
+            testTransform<double2>(true, 25, 33, 25);
+            testTransform<double2>(true, 25, 25, 121);
         }
         else {
             testTransform<float2>(false, 28, 25, 30);
@@ -129,6 +132,9 @@ int main(int argc, char* argv[]) {
             testTransform<float2>(true, 25, 28, 25);
             testTransform<float2>(true, 25, 25, 28);
             testTransform<float2>(true, 21, 25, 27);
+            testTransform<float2>(true, 22, 25, 25);
+            testTransform<float2>(true, 25, 33, 25);
+            testTransform<float2>(true, 25, 25, 121);
         }
     }
     catch(const exception& e) {
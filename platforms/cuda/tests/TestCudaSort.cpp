@@ -66,7 +66,7 @@ void verifySorting(vector<float> array) {
     system.addParticle(0.0);
     CudaPlatform::PlatformData platformData(NULL, system, "", "true", platform.getPropertyDefaultValue("CudaPrecision"), "false",
             platform.getPropertyDefaultValue(CudaPlatform::CudaCompiler()), platform.getPropertyDefaultValue(CudaPlatform::CudaTempDirectory()),
-            platform.getPropertyDefaultValue(CudaPlatform::CudaHostCompiler()), platform.getPropertyDefaultValue(CudaPlatform::CudaDisablePmeStream()), "false", 1);
+            platform.getPropertyDefaultValue(CudaPlatform::CudaKernelCacheDirectory()), platform.getPropertyDefaultValue(CudaPlatform::CudaHostCompiler()), platform.getPropertyDefaultValue(CudaPlatform::CudaDisablePmeStream()), "false", 1);
     CudaContext& context = *platformData.contexts[0];
     context.initialize();
     CudaArray data(context, array.size(), 4, "sortData");
@@ -108,6 +108,16 @@ void testLogValues() {
     verifySorting(array);
 }
 
+void testLongList() {
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+
+    vector<float> array(1000000);
+    for (int i = 0; i < (int) array.size(); i++)
+        array[i] = (float) (genrand_real2(sfmt)-0.5);
+    verifySorting(array);
+}
+
 void testShortList() {
     OpenMM_SFMT::SFMT sfmt;
     init_gen_rand(0, sfmt);
@@ -124,6 +134,7 @@ int main(int argc, char* argv[]) {
             platform.setPropertyDefaultValue("CudaPrecision", string(argv[1]));
         testUniformValues();
         testLogValues();
+        testLongList();
         testShortList();
     }
     catch(const exception& e) {
@@ -141,6 +141,15 @@ public:
      * @param blocking if true, this call will block until the transfer is complete.
      */
     void upload(const void* data, bool blocking = true);
+    /**
+     * Copy values from host memory to a subset of the Buffer.
+     *
+     * @param data     the data to copy
+     * @param offset   the index of the element within the Buffer at which the copy should begin
+     * @param elements the number of elements to copy
+     * @param blocking if true, this call will block until the transfer is complete.
+     */
+    void uploadSubArray(const void* data, int offset, int elements, bool blocking = true);
     /**
      * Copy the values in the Buffer to an array.
      * 
@@ -159,6 +168,7 @@ private:
     cl::Buffer* buffer;
     int size, elementSize;
     bool ownsBuffer;
+    cl_int flags;
     std::string name;
 };
 
@@ -128,14 +128,17 @@ public:
     }
     /**
      * Compute the bonded interactions.
-     * 
+     *
      * @param groups        a set of bit flags for which force groups to include
+     * @param includeForces true if forces should be computed
+     * @param includeEnergy true if the energy should be computed
      */
-    void computeInteractions(int groups);
+    void computeInteractions(int groups, bool includeForces, bool includeEnergy);
 private:
-    std::string createForceSource(int forceIndex, int numBonds, int numAtoms, int group, const std::string& computeForce);
+    std::string createForceSource(int forceIndex, int numBonds, int numAtoms, int group, const std::string& computeForce, bool includeForces);
     OpenCLContext& context;
     std::vector<cl::Kernel> kernels;
+    std::vector<cl::Kernel> energyKernels;
     std::vector<std::vector<std::vector<int> > > forceAtoms;
     std::vector<int> indexWidth;
     std::vector<std::string> forceSource;
@@ -29,6 +29,7 @@
 
 #include <map>
 #include <queue>
+#include <set>
 #include <string>
 #define __CL_ENABLE_EXCEPTIONS
 #define CL_USE_DEPRECATED_OPENCL_1_1_APIS
@@ -163,7 +164,8 @@ public:
     class ForcePostComputation;
     static const int ThreadBlockSize;
     static const int TileSize;
-    OpenCLContext(const System& system, int platformIndex, int deviceIndex, const std::string& precision, OpenCLPlatform::PlatformData& platformData);
+    OpenCLContext(const System& system, int platformIndex, int deviceIndex, const std::string& precision, const std::string& cacheDir,
+            const std::string& profilingFile, OpenCLPlatform::PlatformData& platformData);
     ~OpenCLContext();
     /**
      * This is called to initialize internal data structures after all Forces in the system
@@ -218,6 +220,13 @@ public:
      * Set the cl::ComandQueue to use for execution.
      */
     void setQueue(cl::CommandQueue& queue);
+    /**
+     * Get whether kernel launches are being profiled.  Any cl::CommandQueue passed to setQueue()
+     * must be created with CL_QUEUE_PROFILING_ENABLE when this is true.
+     */
+    bool getProfileKernels() const {
+        return profileKernels;
+    }
     /**
      * Reset the context to using the default queue for execution.
      */
@@ -264,6 +273,14 @@ public:
     OpenCLArray& getEnergyBuffer() {
         return *energyBuffer;
     }
+    /**
+     * Get the array whose first element contains the total energy computed by the most
+     * recent call to reduceEnergy().  It stays resident on the device, so kernels can
+     * use the total without copying it back to the host.
+     */
+    OpenCLArray& getEnergySum() {
+        return *energySum;
+    }
     /**
      * Get the array which contains the buffer in which derivatives of the energy with respect to parameters are computed.
      */
@@ -277,6 +294,51 @@ public:
     void* getPinnedBuffer() {
         return pinnedMemory;
     }
+    /**
+     * Get a device buffer of a particular size.  If a buffer of exactly that size and with the
+     * same flags was previously released with releaseDeviceBuffer() it is reused; otherwise a
+     * new buffer is created.  Pooling the buffers this way reduces the number of allocations
+     * performed when creating or reinitializing a Context.
+     *
+     * @param flags   the memory flags to create the buffer with
+     * @param size    the size of the buffer to get, in bytes
+     */
+    cl::Buffer* acquireDeviceBuffer(cl_int flags, size_t size);
+    /**
+     * Return a device buffer acquired with acquireDeviceBuffer() to the pool, so that a later
+     * request for a buffer of the same size can reuse it.
+     *
+     * @param buffer  the buffer to return to the pool
+     * @param flags   the memory flags the buffer was created with
+     * @param size    the size of the buffer, in bytes
+     */
+    void releaseDeviceBuffer(cl::Buffer* buffer, cl_int flags, size_t size);
+    /**
+     * Get the total number of bytes of device memory that have been allocated on behalf of this
+     * context through acquireDeviceBuffer(), including buffers currently sitting in the pool.
+     * This is the context's contribution to the device memory footprint of the process.
+     */
+    size_t getAllocatedDeviceMemory() const {
+        return allocatedDeviceMemory;
+    }
+    /**
+     * Get the number of bytes of device memory held by each named array belonging to this
+     * context.  Arrays with the same name, such as parameter buffers created by different
+     * forces, are summed together.
+     *
+     * @param usage   on exit, a map from array names to the number of bytes each one occupies
+     */
+    void getDeviceMemoryUsage(std::map<std::string, size_t>& usage) const;
+    /**
+     * Register a newly created OpenCLArray with this context so it can be included in memory
+     * usage reports.  This is called automatically by the OpenCLArray constructor.
+     */
+    void registerArray(OpenCLArray* array);
+    /**
+     * Remove an array registered with registerArray().  This is called automatically by the
+     * OpenCLArray destructor.
+     */
+    void unregisterArray(OpenCLArray* array);
     /**
      * Get the host-side vector which contains the index of each atom.
      */
@@ -366,6 +428,11 @@ public:
      * Sum the buffesr containing forces.
      */
     void reduceForces();
+    /**
+     * Sum the energy buffer on the device with a two stage tree reduction and return the
+     * total.  The total is also left in the array returned by getEnergySum().
+     */
+    double reduceEnergy();
     /**
      * Get the current simulation time.
      */
@@ -475,6 +542,12 @@ public:
     bool getSupportsDoublePrecision() const {
         return supportsDoublePrecision;
     }
+    /**
+     * Get whether the device and the host share the same physical memory, as with integrated GPUs.
+     */
+    bool getHostIsUnifiedMemory() const {
+        return hostIsUnifiedMemory;
+    }
     /**
      * Get whether double precision is being used.
      */
@@ -718,6 +791,11 @@ private:
      */
     template <class Real, class Real4, class Mixed, class Mixed4>
     void reorderAtomsImpl();
+    /**
+     * Compute the elapsed times for all kernel launches whose profiling events have not yet been
+     * processed, and append them to the trace that will be written when the context is destroyed.
+     */
+    void flushProfileEvents();
     const System& system;
     double time;
     OpenCLPlatform::PlatformData& platformData;
@@ -733,10 +811,11 @@ private:
     int numThreadBlocks;
     int numForceBuffers;
     int simdWidth;
-    bool supports64BitGlobalAtomics, supportsDoublePrecision, useDoublePrecision, useMixedPrecision, atomsWereReordered, boxIsTriclinic, forcesValid;
+    bool supports64BitGlobalAtomics, supportsDoublePrecision, hostIsUnifiedMemory, useDoublePrecision, useMixedPrecision, atomsWereReordered, boxIsTriclinic, forcesValid;
     mm_float4 periodicBoxSize, invPeriodicBoxSize, periodicBoxVecX, periodicBoxVecY, periodicBoxVecZ;
     mm_double4 periodicBoxSizeDouble, invPeriodicBoxSizeDouble, periodicBoxVecXDouble, periodicBoxVecYDouble, periodicBoxVecZDouble;
     std::string defaultOptimizationOptions;
+    std::string cacheDir;
     std::map<std::string, std::string> compilationDefines;
     cl::Context context;
     cl::Device device;
@@ -748,6 +827,7 @@ private:
     cl::Kernel clearFiveBuffersKernel;
     cl::Kernel clearSixBuffersKernel;
     cl::Kernel reduceReal4Kernel;
+    cl::Kernel reduceEnergyKernel;
     cl::Kernel reduceForcesKernel;
     cl::Kernel setChargesKernel;
     std::vector<OpenCLForceInfo*> forces;
@@ -763,11 +843,26 @@ private:
     OpenCLArray* forceBuffers;
     OpenCLArray* longForceBuffer;
     OpenCLArray* energyBuffer;
+    OpenCLArray* energyPartialSums;
+    OpenCLArray* energySum;
     OpenCLArray* energyParamDerivBuffer;
     OpenCLArray* atomIndexDevice;
     OpenCLArray* chargeBuffer;
     std::vector<std::string> energyParamDerivNames;
     std::map<std::string, double> energyParamDerivWorkspace;
+    std::map<std::pair<cl_int, size_t>, std::vector<cl::Buffer*> > pooledDeviceBuffers;
+    std::set<OpenCLArray*> registeredArrays;
+    size_t allocatedDeviceMemory;
+    struct ProfiledKernel {
+        cl::Event event;
+        std::string name;
+    };
+    bool profileKernels;
+    std::string profilingFile;
+    std::string profileTrace;
+    bool hasProfileReferenceTime;
+    cl_ulong profileReferenceTime;
+    std::vector<ProfiledKernel> pendingProfiledKernels;
     std::vector<int> atomIndex;
     std::vector<cl::Memory*> autoclearBuffers;
     std::vector<int> autoclearBufferSizes;
@@ -50,6 +50,12 @@ namespace OpenMM {
  * Note that this class performs an unnormalized transform.  That means that if you perform
  * a forward transform followed immediately by an inverse transform, the effect is to
  * multiply every value of the original data set by the total number of data points.
+ * <p>
+ * If OpenMM was built with support for the clFFT library, transforms are delegated to it
+ * whenever a plan can be created for the requested size, since the vendor tuned kernels
+ * are usually much faster than the built-in ones on recent hardware.  The built-in
+ * implementation is used as a fallback when clFFT is unavailable or cannot handle the
+ * transform.
  */
 
 class OPENMM_EXPORT_OPENCL OpenCLFFT3D {
@@ -64,6 +70,7 @@ public:
      * @param realToComplex  if true, a real-to-complex transform will be done.  Otherwise, it is complex-to-complex.
      */
     OpenCLFFT3D(OpenCLContext& context, int xsize, int ysize, int zsize, bool realToComplex=false);
+    ~OpenCLFFT3D();
     /**
      * Perform a Fourier transform.  The transform cannot be done in-place: the input and output
      * arrays must be different.  Also, the input array is used as workspace, so its contents
@@ -87,9 +94,13 @@ public:
     static int findLegalDimension(int minimum);
 private:
     cl::Kernel createKernel(int xsize, int ysize, int zsize, int& threads, int axis, bool forward, bool inputIsReal);
+    bool tryInitializeClfft(bool realToComplex);
     int xsize, ysize, zsize;
     int xthreads, ythreads, zthreads;
     bool packRealAsComplex;
+    bool useClfft;
+    std::size_t clfftForwardPlan, clfftBackwardPlan;
+    cl::Buffer clfftTmpBuffer;
     OpenCLContext& context;
     cl::Kernel xkernel, ykernel, zkernel;
     cl::Kernel invxkernel, invykernel, invzkernel;
@@ -70,6 +70,12 @@ public:
      * Get the size that was used for the last step.
      */
     double getLastStepSize();
+    /**
+     * Start an asynchronous download of the current step size.  Calling this as soon as the
+     * step size has been selected lets getLastStepSize() wait only for that early point in
+     * the queue instead of for all of the step's kernels to finish.
+     */
+    void downloadStepSizeAsync();
     /**
      * Apply constraints to the atom positions.
      *
@@ -150,6 +156,7 @@ private:
     OpenCLArray* ccmaDelta2;
     OpenCLArray* ccmaConverged;
     OpenCLArray* ccmaConvergedHostBuffer;
+    int ccmaExpectedIterations[2];
     OpenCLArray* vsite2AvgAtoms;
     OpenCLArray* vsite2AvgWeights;
     OpenCLArray* vsite3AvgAtoms;
@@ -161,7 +168,10 @@ private:
     int randomPos;
     int lastSeed, numVsites;
     bool hasInitializedPosConstraintKernels, hasInitializedVelConstraintKernels, ccmaUseDirectBuffer, hasOverlappingVsites;
+    bool stepSizeDownloadPending;
+    cl::Event stepSizeEvent;
     mm_double2 lastStepSize;
+    mm_double2 downloadedStepSize;
     struct ShakeCluster;
     struct ConstraintOrderer;
 };
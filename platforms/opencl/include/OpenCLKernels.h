@@ -36,6 +36,7 @@
 #include "openmm/kernels.h"
 #include "openmm/internal/CompiledExpressionSet.h"
 #include "openmm/internal/CustomIntegratorUtilities.h"
+#include "openmm/internal/CustomNonbondedForceImpl.h"
 #include "lepton/CompiledExpression.h"
 #include "openmm/System.h"
 
@@ -81,6 +82,13 @@ public:
      * energy directly, <i>or</i> add it to an internal buffer so that it will be included here.
      */
     double finishComputation(ContextImpl& context, bool includeForce, bool includeEnergy, int groups, bool& valid);
+    /**
+     * The kernels accumulate all of the energies in a single device buffer that is reduced by
+     * finishComputation(), so the energies by force group have to be computed one group at a time.
+     */
+    bool supportsEnergyDecomposition() const {
+        return false;
+    }
 private:
    OpenCLContext& cl;
 };
@@ -91,8 +99,10 @@ private:
  */
 class OpenCLUpdateStateDataKernel : public UpdateStateDataKernel {
 public:
-    OpenCLUpdateStateDataKernel(std::string name, const Platform& platform, OpenCLContext& cl) : UpdateStateDataKernel(name, platform), cl(cl) {
+    OpenCLUpdateStateDataKernel(std::string name, const Platform& platform, OpenCLContext& cl) : UpdateStateDataKernel(name, platform), cl(cl),
+            wrappedPositions(NULL), wrapMoleculeAtoms(NULL), wrapMoleculeStartIndex(NULL) {
     }
+    ~OpenCLUpdateStateDataKernel();
     /**
      * Initialize the kernel.
      *
@@ -117,6 +127,15 @@ public:
      * @param positions  on exit, this contains the particle positions
      */
     void getPositions(ContextImpl& context, std::vector<Vec3>& positions);
+    /**
+     * Get the positions of all particles, translating each molecule so its center lies inside
+     * the first periodic box.  The wrapping is done in a kernel before the download, so this
+     * costs the same as getPositions().
+     *
+     * @param positions  on exit, this contains the particle positions
+     * @return true, since the wrapping is always done on the device
+     */
+    bool getWrappedPositions(ContextImpl& context, std::vector<Vec3>& positions);
     /**
      * Set the positions of all particles.
      *
@@ -177,6 +196,11 @@ public:
     void loadCheckpoint(ContextImpl& context, std::istream& stream);
 private:
     OpenCLContext& cl;
+    cl::Kernel wrapKernel;
+    OpenCLArray* wrappedPositions;
+    OpenCLArray* wrapMoleculeAtoms;
+    OpenCLArray* wrapMoleculeStartIndex;
+    std::vector<int> wrapAtomOrder;
 };
 
 /**
@@ -617,10 +641,14 @@ public:
     /**
      * Copy changed parameters over to a context.
      *
-     * @param context    the context to copy parameters to
-     * @param force      the NonbondedForce to copy the parameters from
+     * @param context        the context to copy parameters to
+     * @param force          the NonbondedForce to copy the parameters from
+     * @param firstParticle  the index of the first particle whose parameters might have changed
+     * @param lastParticle   the index of the last particle whose parameters might have changed
+     * @param firstException the index of the first exception whose parameters might have changed
+     * @param lastException  the index of the last exception whose parameters might have changed
      */
-    void copyParametersToContext(ContextImpl& context, const NonbondedForce& force);
+    void copyParametersToContext(ContextImpl& context, const NonbondedForce& force, int firstParticle, int lastParticle, int firstException, int lastException);
     /**
      * Get the parameters being used for PME.
      *
@@ -757,6 +785,7 @@ private:
     std::vector<OpenCLArray*> tabulatedFunctions;
     double longRangeCoefficient;
     std::vector<double> longRangeCoefficientDerivs;
+    CustomNonbondedForceImpl::LongRangeCorrectionData longRangeCorrectionData;
     bool hasInitializedLongRangeCorrection, hasInitializedKernel;
     int numGroupThreadBlocks;
     CustomNonbondedForce* forceCopy;
@@ -908,6 +937,14 @@ public:
      * @param force      the CustomExternalForce to copy the parameters from
      */
     void copyParametersToContext(ContextImpl& context, const CustomExternalForce& force);
+    /**
+     * Copy changed parameters for a subset of particles over to a context.
+     *
+     * @param context           the context to copy parameters to
+     * @param force             the CustomExternalForce to copy the parameters from
+     * @param changedParticles  the indices within the force of the particle terms whose parameters have changed
+     */
+    void copyParametersToContext(ContextImpl& context, const CustomExternalForce& force, const std::vector<int>& changedParticles);
 private:
     class ForceInfo;
     int numParticles;
@@ -1281,6 +1318,45 @@ private:
     cl::Kernel kernel1, kernel2;
 };
 
+/**
+ * This kernel is invoked by LangevinMiddleIntegrator to take one time step.
+ */
+class OpenCLIntegrateLangevinMiddleStepKernel : public IntegrateLangevinMiddleStepKernel {
+public:
+    OpenCLIntegrateLangevinMiddleStepKernel(std::string name, const Platform& platform, OpenCLContext& cl) : IntegrateLangevinMiddleStepKernel(name, platform), cl(cl),
+            hasInitializedKernels(false), params(NULL), oldDelta(NULL) {
+    }
+    ~OpenCLIntegrateLangevinMiddleStepKernel();
+    /**
+     * Initialize the kernel, setting up the particle masses.
+     *
+     * @param system     the System this kernel will be applied to
+     * @param integrator the LangevinMiddleIntegrator this kernel will be used for
+     */
+    void initialize(const System& system, const LangevinMiddleIntegrator& integrator);
+    /**
+     * Execute the kernel.
+     *
+     * @param context    the context in which to execute this kernel
+     * @param integrator the LangevinMiddleIntegrator this kernel is being used for
+     */
+    void execute(ContextImpl& context, const LangevinMiddleIntegrator& integrator);
+    /**
+     * Compute the kinetic energy.
+     *
+     * @param context    the context in which to execute this kernel
+     * @param integrator the LangevinMiddleIntegrator this kernel is being used for
+     */
+    double computeKineticEnergy(ContextImpl& context, const LangevinMiddleIntegrator& integrator);
+private:
+    OpenCLContext& cl;
+    double prevTemp, prevFriction, prevStepSize;
+    bool hasInitializedKernels;
+    OpenCLArray* params;
+    OpenCLArray* oldDelta;
+    cl::Kernel kernel1, kernel2, kernel3;
+};
+
 /**
  * This kernel is invoked by BrownianIntegrator to take one time step.
  */
@@ -1405,7 +1481,7 @@ class OpenCLIntegrateCustomStepKernel : public IntegrateCustomStepKernel {
 public:
     enum GlobalTargetType {DT, VARIABLE, PARAMETER};
     OpenCLIntegrateCustomStepKernel(std::string name, const Platform& platform, OpenCLContext& cl) : IntegrateCustomStepKernel(name, platform), cl(cl),
-            hasInitializedKernels(false), localValuesAreCurrent(false), globalValues(NULL), sumBuffer(NULL), summedValue(NULL), uniformRandoms(NULL),
+            hasInitializedKernels(false), deviceGlobalsAreCurrent(false), localValuesAreCurrent(false), localGlobalsAreCurrent(true), globalValues(NULL), sumBuffer(NULL), summedValue(NULL), uniformRandoms(NULL),
             randomSeed(NULL), perDofEnergyParamDerivs(NULL), perDofValues(NULL), needsEnergyParamDerivs(false) {
     }
     ~OpenCLIntegrateCustomStepKernel();
@@ -1479,12 +1555,14 @@ private:
     void recordGlobalValue(double value, GlobalTarget target, CustomIntegrator& integrator);
     void recordChangedParameters(ContextImpl& context);
     bool evaluateCondition(int step);
+    void createDeviceGlobalsKernel(int step, const std::string& computation, std::map<std::string, std::string>& defines);
+    void downloadGlobalValues() const;
     OpenCLContext& cl;
     double energy;
     float energyFloat;
     int numGlobalVariables;
     bool hasInitializedKernels, deviceValuesAreCurrent, deviceGlobalsAreCurrent, modifiesParameters, keNeedsForce, hasAnyConstraints, needsEnergyParamDerivs;
-    mutable bool localValuesAreCurrent;
+    mutable bool localValuesAreCurrent, localGlobalsAreCurrent;
     OpenCLArray* globalValues;
     OpenCLArray* sumBuffer;
     OpenCLArray* summedValue;
@@ -1501,20 +1579,22 @@ private:
     std::vector<cl_float> localPerDofEnergyParamDerivsFloat;
     std::vector<cl_double> localPerDofEnergyParamDerivsDouble;
     std::vector<float> globalValuesFloat;
-    std::vector<double> globalValuesDouble;
+    mutable std::vector<double> globalValuesDouble;
     std::vector<double> initialGlobalVariables;
     std::vector<std::vector<cl::Kernel> > kernels;
     cl::Kernel randomKernel, kineticEnergyKernel, sumKineticEnergyKernel;
     std::vector<CustomIntegrator::ComputationType> stepType;
     std::vector<CustomIntegratorUtilities::Comparison> comparisons;
     std::vector<std::vector<Lepton::CompiledExpression> > globalExpressions;
-    CompiledExpressionSet expressionSet;
+    mutable CompiledExpressionSet expressionSet;
     std::vector<bool> needsGlobals;
     std::vector<bool> needsForces;
     std::vector<bool> needsEnergy;
     std::vector<bool> computeBothForceAndEnergy;
     std::vector<bool> invalidatesForces;
     std::vector<bool> merged;
+    std::vector<bool> mergedSum;
+    std::vector<bool> computeGlobalOnDevice;
     std::vector<int> forceGroupFlags;
     std::vector<int> blockEnd;
     std::vector<int> requiredGaussian;
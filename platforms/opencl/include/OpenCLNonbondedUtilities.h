@@ -291,8 +291,11 @@ private:
     OpenCLArray* rebuildNeighborList;
     OpenCLSort* blockSorter;
     cl::Event downloadCountEvent;
+    cl::Event rebuildFlagEvent;
     cl::Buffer* pinnedCountBuffer;
     int* pinnedCountMemory;
+    cl::Buffer* pinnedRebuildBuffer;
+    int* pinnedRebuildMemory;
     std::vector<std::vector<int> > atomExclusions;
     std::vector<ParameterInfo> parameters;
     std::vector<ParameterInfo> arguments;
@@ -82,8 +82,10 @@ private:
     OpenCLPlatform::PlatformData& data;
     std::vector<Kernel> kernels;
     std::vector<long long> completionTimes;
+    std::vector<long long> contextActiveTimes;
     std::vector<double> contextNonbondedFractions;
     std::vector<int> tileCounts;
+    long long stepStartTime;
     OpenCLArray* contextForces;
     cl::Buffer* pinnedPositionBuffer;
     cl::Buffer* pinnedForceBuffer;
@@ -425,10 +427,14 @@ public:
     /**
      * Copy changed parameters over to a context.
      *
-     * @param context    the context to copy parameters to
-     * @param force      the NonbondedForce to copy the parameters from
+     * @param context        the context to copy parameters to
+     * @param force          the NonbondedForce to copy the parameters from
+     * @param firstParticle  the index of the first particle whose parameters might have changed
+     * @param lastParticle   the index of the last particle whose parameters might have changed
+     * @param firstException the index of the first exception whose parameters might have changed
+     * @param lastException  the index of the last exception whose parameters might have changed
      */
-    void copyParametersToContext(ContextImpl& context, const NonbondedForce& force);
+    void copyParametersToContext(ContextImpl& context, const NonbondedForce& force, int firstParticle, int lastParticle, int firstException, int lastException);
     /**
      * Get the parameters being used for PME.
      *
@@ -523,6 +529,14 @@ public:
      * @param force      the CustomExternalForce to copy the parameters from
      */
     void copyParametersToContext(ContextImpl& context, const CustomExternalForce& force);
+    /**
+     * Copy changed parameters for a subset of particles over to a context.
+     *
+     * @param context           the context to copy parameters to
+     * @param force             the CustomExternalForce to copy the parameters from
+     * @param changedParticles  the indices within the force of the particle terms whose parameters have changed
+     */
+    void copyParametersToContext(ContextImpl& context, const CustomExternalForce& force, const std::vector<int>& changedParticles);
 private:
     class Task;
     OpenCLPlatform::PlatformData& data;
@@ -84,6 +84,9 @@ public:
     }
     /**
      * This is the name of the parameter for selecting what numerical precision to use.
+     * The allowed values are "single" (all calculations in single precision), "mixed"
+     * (forces computed in single precision, but integration done in double precision),
+     * and "double" (all calculations in double precision).
      */
     static const std::string& OpenCLPrecision() {
         static const std::string key = "Precision";
@@ -96,26 +99,63 @@ public:
         static const std::string key = "UseCpuPme";
         return key;
     }
+    /**
+     * This is the name of the parameter for specifying the path to the directory in which to cache compiled kernels.
+     * If it is empty, compiled kernels are not cached.
+     */
+    static const std::string& OpenCLKernelCacheDirectory() {
+        static const std::string key = "KernelCacheDirectory";
+        return key;
+    }
     /**
      * This is the name of the parameter for selecting whether to disable use of a separate stream for PME.
+     * By default the reciprocal space calculation is executed on its own command queue and synchronized
+     * with the main queue by events, allowing it to overlap with the direct space calculation.
      */
     static const std::string& OpenCLDisablePmeStream() {
         static const std::string key = "DisablePmeStream";
         return key;
     }
+    /**
+     * This is the name of the parameter for requesting that force computations be fully deterministic.
+     */
+    static const std::string& OpenCLDeterministicForces() {
+        static const std::string key = "DeterministicForces";
+        return key;
+    }
+    /**
+     * This is the name of the parameter for specifying a file to write kernel profiling data to.
+     * If it is not empty, every kernel launch is timed with events, and when the Context is
+     * destroyed the accumulated timings are written to the file in the chrome://tracing JSON
+     * format so they can be viewed in a browser.  Profiling adds overhead, so it should be
+     * enabled only when the data is wanted.
+     */
+    static const std::string& OpenCLProfilingFile() {
+        static const std::string key = "ProfilingFile";
+        return key;
+    }
+    /**
+     * This is the name of the parameter for querying how many bytes of device memory the
+     * Context has allocated.  It is computed at the time it is queried and cannot be set.
+     */
+    static const std::string& OpenCLDeviceMemoryUsage() {
+        static const std::string key = "DeviceMemoryUsage";
+        return key;
+    }
 };
 
 class OPENMM_EXPORT_OPENCL OpenCLPlatform::PlatformData {
 public:
     PlatformData(const System& system, const std::string& platformPropValue, const std::string& deviceIndexProperty, const std::string& precisionProperty,
-            const std::string& cpuPmeProperty, const std::string& pmeStreamProperty, int numThreads);
+            const std::string& cpuPmeProperty, const std::string& cacheProperty, const std::string& pmeStreamProperty,
+            const std::string& deterministicForcesProperty, const std::string& profilingFileProperty, int numThreads);
     ~PlatformData();
     void initializeContexts(const System& system);
     void syncContexts();
     ContextImpl* context;
     std::vector<OpenCLContext*> contexts;
     std::vector<double> contextEnergy;
-    bool hasInitializedContexts, removeCM, useCpuPme, disablePmeStream;
+    bool hasInitializedContexts, removeCM, useCpuPme, disablePmeStream, deterministicForces;
     int cmMotionFrequency;
     int stepCount, computeForceCount;
     double time;
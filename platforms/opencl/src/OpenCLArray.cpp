@@ -25,6 +25,7 @@
  * -------------------------------------------------------------------------- */
 
 #include "OpenCLArray.h"
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <vector>
@@ -32,29 +33,63 @@
 using namespace OpenMM;
 
 OpenCLArray::OpenCLArray(OpenCLContext& context, int size, int elementSize, const std::string& name, cl_int flags) :
-        context(context), size(size), elementSize(elementSize), name(name), ownsBuffer(true) {
+        context(context), size(size), elementSize(elementSize), name(name), ownsBuffer(true), flags(flags) {
+    if (context.getHostIsUnifiedMemory() && (flags & (CL_MEM_USE_HOST_PTR | CL_MEM_ALLOC_HOST_PTR | CL_MEM_COPY_HOST_PTR)) == 0) {
+        // The device shares physical memory with the host, so allocate the buffer in host
+        // memory.  Mapping it is then free, and transfers involve only a single copy.
+
+        this->flags |= CL_MEM_ALLOC_HOST_PTR;
+    }
     try {
-        buffer = new cl::Buffer(context.getContext(), flags, size*elementSize);
+        buffer = context.acquireDeviceBuffer(this->flags, size*(size_t) elementSize);
     }
     catch (cl::Error err) {
         std::stringstream str;
         str<<"Error creating array "<<name<<": "<<err.what()<<" ("<<err.err()<<")";
         throw OpenMMException(str.str());
     }
+    context.registerArray(this);
 }
 
 OpenCLArray::OpenCLArray(OpenCLContext& context, cl::Buffer* buffer, int size, int elementSize, const std::string& name) :
-        context(context), buffer(buffer), size(size), elementSize(elementSize), name(name), ownsBuffer(false) {
+        context(context), buffer(buffer), size(size), elementSize(elementSize), name(name), ownsBuffer(false), flags(0) {
 }
 
 OpenCLArray::~OpenCLArray() {
-    if (ownsBuffer)
-        delete buffer;
+    if (ownsBuffer) {
+        context.unregisterArray(this);
+        context.releaseDeviceBuffer(buffer, flags, size*(size_t) elementSize);
+    }
 }
 
 void OpenCLArray::upload(const void* data, bool blocking) {
     try {
-        context.getQueue().enqueueWriteBuffer(*buffer, blocking ? CL_TRUE : CL_FALSE, 0, size*elementSize, data);
+        if (context.getHostIsUnifiedMemory() && (flags & CL_MEM_ALLOC_HOST_PTR) != 0) {
+            void* mapped = context.getQueue().enqueueMapBuffer(*buffer, CL_TRUE, CL_MAP_WRITE, 0, size*(size_t) elementSize);
+            memcpy(mapped, data, size*(size_t) elementSize);
+            context.getQueue().enqueueUnmapMemObject(*buffer, mapped);
+        }
+        else
+            context.getQueue().enqueueWriteBuffer(*buffer, blocking ? CL_TRUE : CL_FALSE, 0, size*elementSize, data);
+    }
+    catch (cl::Error err) {
+        std::stringstream str;
+        str<<"Error uploading array "<<name<<": "<<err.what()<<" ("<<err.err()<<")";
+        throw OpenMMException(str.str());
+    }
+}
+
+void OpenCLArray::uploadSubArray(const void* data, int offset, int elements, bool blocking) {
+    if (offset < 0 || offset+elements > size)
+        throw OpenMMException("uploadSubArray: data exceeds range of array "+name);
+    try {
+        if (context.getHostIsUnifiedMemory() && (flags & CL_MEM_ALLOC_HOST_PTR) != 0) {
+            void* mapped = context.getQueue().enqueueMapBuffer(*buffer, CL_TRUE, CL_MAP_WRITE, offset*(size_t) elementSize, elements*(size_t) elementSize);
+            memcpy(mapped, data, elements*(size_t) elementSize);
+            context.getQueue().enqueueUnmapMemObject(*buffer, mapped);
+        }
+        else
+            context.getQueue().enqueueWriteBuffer(*buffer, blocking ? CL_TRUE : CL_FALSE, offset*elementSize, elements*elementSize, data);
     }
     catch (cl::Error err) {
         std::stringstream str;
@@ -65,7 +100,13 @@ void OpenCLArray::upload(const void* data, bool blocking) {
 
 void OpenCLArray::download(void* data, bool blocking) const {
     try {
-        context.getQueue().enqueueReadBuffer(*buffer, blocking ? CL_TRUE : CL_FALSE, 0, size*elementSize, data);
+        if (context.getHostIsUnifiedMemory() && (flags & CL_MEM_ALLOC_HOST_PTR) != 0) {
+            void* mapped = context.getQueue().enqueueMapBuffer(*buffer, CL_TRUE, CL_MAP_READ, 0, size*(size_t) elementSize);
+            memcpy(data, mapped, size*(size_t) elementSize);
+            context.getQueue().enqueueUnmapMemObject(*buffer, mapped);
+        }
+        else
+            context.getQueue().enqueueReadBuffer(*buffer, blocking ? CL_TRUE : CL_FALSE, 0, size*elementSize, data);
     }
     catch (cl::Error err) {
         std::stringstream str;
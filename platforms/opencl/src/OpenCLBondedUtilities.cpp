@@ -182,54 +182,62 @@ void OpenCLBondedUtilities::initialize(const System& system) {
             bufferIndices[force] = buffers;
         }
 
-    // Create the kernels.
+    // Create the kernels.  In addition to the standard ones, a second variant of each is
+    // created that computes only the energy, so the force accumulation can be skipped when
+    // the forces are not needed.
 
     for (auto& set : forceSets) {
         int setSize = set.size();
-        stringstream s;
-        s<<"#ifdef SUPPORTS_64_BIT_ATOMICS\n";
-        s<<"#pragma OPENCL EXTENSION cl_khr_int64_base_atomics : enable\n";
-        s<<"#endif\n";
-        for (int i = 0; i < (int) prefixCode.size(); i++)
-            s<<prefixCode[i];
+        stringstream args;
         string bufferType = (context.getSupports64BitGlobalAtomics() ? "long" : "real4");
-        s<<"__kernel void computeBondedForces(__global "<<bufferType<<"* restrict forceBuffers, __global mixed* restrict energyBuffer, __global const real4* restrict posq, int groups, real4 periodicBoxSize, real4 invPeriodicBoxSize, real4 periodicBoxVecX, real4 periodicBoxVecY, real4 periodicBoxVecZ";
+        args<<"__global "<<bufferType<<"* restrict forceBuffers, __global mixed* restrict energyBuffer, __global const real4* restrict posq, int groups, real4 periodicBoxSize, real4 invPeriodicBoxSize, real4 periodicBoxVecX, real4 periodicBoxVecY, real4 periodicBoxVecZ";
         for (int i = 0; i < setSize; i++) {
             int force = set[i];
             string indexType = "uint"+(indexWidth[force] == 1 ? "" : context.intToString(indexWidth[force]));
-            s<<", __global const "<<indexType<<"* restrict atomIndices"<<i;
-            s<<", __global const "<<indexType<<"* restrict bufferIndices"<<i;
+            args<<", __global const "<<indexType<<"* restrict atomIndices"<<i;
+            args<<", __global const "<<indexType<<"* restrict bufferIndices"<<i;
         }
         for (int i = 0; i < (int) arguments.size(); i++)
-            s<<", __global "<<argTypes[i]<<"* customArg"<<(i+1);
+            args<<", __global const "<<argTypes[i]<<"* restrict customArg"<<(i+1);
         if (energyParameterDerivatives.size() > 0)
-            s<<", __global mixed* restrict energyParamDerivs";
-        s<<") {\n";
-        s<<"mixed energy = 0;\n";
-        for (int i = 0; i < energyParameterDerivatives.size(); i++)
-            s<<"mixed energyParamDeriv"<<i<<" = 0;\n";
-        for (int i = 0; i < setSize; i++) {
-            int force = set[i];
-            s<<createForceSource(i, forceAtoms[force].size(), forceAtoms[force][0].size(), forceGroup[force], forceSource[force]);
-        }
-        s<<"energyBuffer[get_global_id(0)] += energy;\n";
+            args<<", __global mixed* restrict energyParamDerivs";
+        stringstream s;
+        s<<"#ifdef SUPPORTS_64_BIT_ATOMICS\n";
+        s<<"#pragma OPENCL EXTENSION cl_khr_int64_base_atomics : enable\n";
+        s<<"#endif\n";
+        for (int i = 0; i < (int) prefixCode.size(); i++)
+            s<<prefixCode[i];
         const vector<string>& allParamDerivNames = context.getEnergyParamDerivNames();
         int numDerivs = allParamDerivNames.size();
-        for (int i = 0; i < energyParameterDerivatives.size(); i++)
-            for (int index = 0; index < numDerivs; index++)
-                if (allParamDerivNames[index] == energyParameterDerivatives[i])
-                    s<<"energyParamDerivs[get_global_id(0)*"<<numDerivs<<"+"<<index<<"] += energyParamDeriv"<<i<<";\n";
-        s<<"}\n";
+        for (int variant = 0; variant < 2; variant++) {
+            bool includeForces = (variant == 0);
+            s<<"__kernel void "<<(includeForces ? "computeBondedForces" : "computeBondedEnergy")<<"("<<args.str();
+            s<<") {\n";
+            s<<"mixed energy = 0;\n";
+            for (int i = 0; i < energyParameterDerivatives.size(); i++)
+                s<<"mixed energyParamDeriv"<<i<<" = 0;\n";
+            for (int i = 0; i < setSize; i++) {
+                int force = set[i];
+                s<<createForceSource(i, forceAtoms[force].size(), forceAtoms[force][0].size(), forceGroup[force], forceSource[force], includeForces);
+            }
+            s<<"energyBuffer[get_global_id(0)] += energy;\n";
+            for (int i = 0; i < energyParameterDerivatives.size(); i++)
+                for (int index = 0; index < numDerivs; index++)
+                    if (allParamDerivNames[index] == energyParameterDerivatives[i])
+                        s<<"energyParamDerivs[get_global_id(0)*"<<numDerivs<<"+"<<index<<"] += energyParamDeriv"<<i<<";\n";
+            s<<"}\n";
+        }
         map<string, string> defines;
         defines["PADDED_NUM_ATOMS"] = context.intToString(context.getPaddedNumAtoms());
         cl::Program program = context.createProgram(s.str(), defines);
         kernels.push_back(cl::Kernel(program, "computeBondedForces"));
+        energyKernels.push_back(cl::Kernel(program, "computeBondedEnergy"));
     }
     forceAtoms.clear();
     forceSource.clear();
 }
 
-string OpenCLBondedUtilities::createForceSource(int forceIndex, int numBonds, int numAtoms, int group, const string& computeForce) {
+string OpenCLBondedUtilities::createForceSource(int forceIndex, int numBonds, int numAtoms, int group, const string& computeForce, bool includeForces) {
     maxBonds = max(maxBonds, numBonds);
     int width = 1;
     while (width < numAtoms)
@@ -256,52 +264,58 @@ string OpenCLBondedUtilities::createForceSource(int forceIndex, int numBonds, in
         s<<"    real4 pos"<<(i+1)<<" = posq[atom"<<(i+1)<<"];\n";
     }
     s<<computeForce<<"\n";
-    for (int i = 0; i < numAtoms; i++) {
-        s<<"    {\n";
-        if (context.getSupports64BitGlobalAtomics()) {
-            s<<"    atom_add(&forceBuffers[atom"<<(i+1)<<"], (long) (force"<<(i+1)<<".x*0x100000000));\n";
-            s<<"    atom_add(&forceBuffers[atom"<<(i+1)<<"+PADDED_NUM_ATOMS], (long) (force"<<(i+1)<<".y*0x100000000));\n";
-            s<<"    atom_add(&forceBuffers[atom"<<(i+1)<<"+2*PADDED_NUM_ATOMS], (long) (force"<<(i+1)<<".z*0x100000000));\n";
-        }
-        else {
-            s<<"    unsigned int offset = atom"<<(i+1)<<"+buffers"<<suffix[i]<<"*PADDED_NUM_ATOMS;\n";
-            s<<"    real4 force = forceBuffers[offset];\n";
-            s<<"    force.xyz += force"<<(i+1)<<".xyz;\n";
-            s<<"    forceBuffers[offset] = force;\n";
+    if (includeForces) {
+        for (int i = 0; i < numAtoms; i++) {
+            s<<"    {\n";
+            if (context.getSupports64BitGlobalAtomics()) {
+                s<<"    atom_add(&forceBuffers[atom"<<(i+1)<<"], (long) (force"<<(i+1)<<".x*0x100000000));\n";
+                s<<"    atom_add(&forceBuffers[atom"<<(i+1)<<"+PADDED_NUM_ATOMS], (long) (force"<<(i+1)<<".y*0x100000000));\n";
+                s<<"    atom_add(&forceBuffers[atom"<<(i+1)<<"+2*PADDED_NUM_ATOMS], (long) (force"<<(i+1)<<".z*0x100000000));\n";
+            }
+            else {
+                s<<"    unsigned int offset = atom"<<(i+1)<<"+buffers"<<suffix[i]<<"*PADDED_NUM_ATOMS;\n";
+                s<<"    real4 force = forceBuffers[offset];\n";
+                s<<"    force.xyz += force"<<(i+1)<<".xyz;\n";
+                s<<"    forceBuffers[offset] = force;\n";
+            }
+            s<<"    }\n";
         }
-        s<<"    }\n";
     }
     s<<"}\n";
     return s.str();
 }
 
-void OpenCLBondedUtilities::computeInteractions(int groups) {
+void OpenCLBondedUtilities::computeInteractions(int groups, bool includeForces, bool includeEnergy) {
     if ((groups&allGroups) == 0)
         return;
+    if (!includeForces && !includeEnergy)
+        return;
     if (!hasInitializedKernels) {
         hasInitializedKernels = true;
         for (int i = 0; i < (int) forceSets.size(); i++) {
-            int index = 0;
-            cl::Kernel& kernel = kernels[i];
-            if (context.getSupports64BitGlobalAtomics())
-                kernel.setArg<cl::Buffer>(index++, context.getLongForceBuffer().getDeviceBuffer());
-            else
-                kernel.setArg<cl::Buffer>(index++, context.getForceBuffers().getDeviceBuffer());
-            kernel.setArg<cl::Buffer>(index++, context.getEnergyBuffer().getDeviceBuffer());
-            kernel.setArg<cl::Buffer>(index++, context.getPosq().getDeviceBuffer());
-            index += 6;
-            for (int j = 0; j < (int) forceSets[i].size(); j++) {
-                kernel.setArg<cl::Buffer>(index++, atomIndices[forceSets[i][j]]->getDeviceBuffer());
-                kernel.setArg<cl::Buffer>(index++, bufferIndices[forceSets[i][j]]->getDeviceBuffer());
+            for (int variant = 0; variant < 2; variant++) {
+                int index = 0;
+                cl::Kernel& kernel = (variant == 0 ? kernels[i] : energyKernels[i]);
+                if (context.getSupports64BitGlobalAtomics())
+                    kernel.setArg<cl::Buffer>(index++, context.getLongForceBuffer().getDeviceBuffer());
+                else
+                    kernel.setArg<cl::Buffer>(index++, context.getForceBuffers().getDeviceBuffer());
+                kernel.setArg<cl::Buffer>(index++, context.getEnergyBuffer().getDeviceBuffer());
+                kernel.setArg<cl::Buffer>(index++, context.getPosq().getDeviceBuffer());
+                index += 6;
+                for (int j = 0; j < (int) forceSets[i].size(); j++) {
+                    kernel.setArg<cl::Buffer>(index++, atomIndices[forceSets[i][j]]->getDeviceBuffer());
+                    kernel.setArg<cl::Buffer>(index++, bufferIndices[forceSets[i][j]]->getDeviceBuffer());
+                }
+                for (int j = 0; j < (int) arguments.size(); j++)
+                    kernel.setArg<cl::Memory>(index++, *arguments[j]);
+                if (energyParameterDerivatives.size() > 0)
+                    kernel.setArg<cl::Memory>(index++, context.getEnergyParamDerivBuffer().getDeviceBuffer());
             }
-            for (int j = 0; j < (int) arguments.size(); j++)
-                kernel.setArg<cl::Memory>(index++, *arguments[j]);
-            if (energyParameterDerivatives.size() > 0)
-                kernel.setArg<cl::Memory>(index++, context.getEnergyParamDerivBuffer().getDeviceBuffer());
         }
     }
     for (int i = 0; i < (int) kernels.size(); i++) {
-        cl::Kernel& kernel = kernels[i];
+        cl::Kernel& kernel = (includeForces ? kernels[i] : energyKernels[i]);
         kernel.setArg<cl_int>(3, groups);
         if (context.getUseDoublePrecision()) {
             kernel.setArg<mm_double4>(4, context.getPeriodicBoxSizeDouble());
@@ -317,6 +331,6 @@ void OpenCLBondedUtilities::computeInteractions(int groups) {
             kernel.setArg<mm_float4>(7, context.getPeriodicBoxVecY());
             kernel.setArg<mm_float4>(8, context.getPeriodicBoxVecZ());
         }
-        context.executeKernel(kernels[i], maxBonds);
+        context.executeKernel(kernel, maxBonds);
     }
 }
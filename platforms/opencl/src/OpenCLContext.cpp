@@ -35,13 +35,16 @@
 #include "OpenCLIntegrationUtilities.h"
 #include "OpenCLKernelSources.h"
 #include "OpenCLNonbondedUtilities.h"
-#include "hilbert.h"
 #include "openmm/Platform.h"
 #include "openmm/System.h"
 #include "openmm/VirtualSite.h"
 #include "openmm/internal/ContextImpl.h"
+#include "SHA1.h"
 #include <algorithm>
+#include <cstdio>
 #include <fstream>
+#include <functional>
+#include <iomanip>
 #include <iostream>
 #include <set>
 #include <sstream>
@@ -67,10 +70,12 @@ static void CL_CALLBACK errorCallback(const char* errinfo, const void* private_i
     std::cerr << "OpenCL internal error: " << errinfo << std::endl;
 }
 
-OpenCLContext::OpenCLContext(const System& system, int platformIndex, int deviceIndex, const string& precision, OpenCLPlatform::PlatformData& platformData) :
+OpenCLContext::OpenCLContext(const System& system, int platformIndex, int deviceIndex, const string& precision, const string& cacheDir,
+        const string& profilingFile, OpenCLPlatform::PlatformData& platformData) :
         system(system), time(0.0), platformData(platformData), stepCount(0), computeForceCount(0), stepsSinceReorder(99999), atomsWereReordered(false), posq(NULL),
-        posqCorrection(NULL), velm(NULL), forceBuffers(NULL), longForceBuffer(NULL), energyBuffer(NULL), energyParamDerivBuffer(NULL), atomIndexDevice(NULL),
-        chargeBuffer(NULL), integration(NULL), expression(NULL), bonded(NULL), nonbonded(NULL), thread(NULL) {
+        posqCorrection(NULL), velm(NULL), forceBuffers(NULL), longForceBuffer(NULL), energyBuffer(NULL), energyPartialSums(NULL), energySum(NULL), energyParamDerivBuffer(NULL), atomIndexDevice(NULL),
+        chargeBuffer(NULL), allocatedDeviceMemory(0), profileKernels(!profilingFile.empty()), profilingFile(profilingFile), hasProfileReferenceTime(false),
+        integration(NULL), expression(NULL), bonded(NULL), nonbonded(NULL), thread(NULL) {
     if (precision == "single") {
         useDoublePrecision = false;
         useMixedPrecision = false;
@@ -85,6 +90,13 @@ OpenCLContext::OpenCLContext(const System& system, int platformIndex, int device
     }
     else
         throw OpenMMException("Illegal value for Precision: "+precision);
+    if (cacheDir.length() > 0) {
+#ifdef WIN32
+        this->cacheDir = cacheDir+"\\";
+#else
+        this->cacheDir = cacheDir+"/";
+#endif
+    }
     try {
         contextIndex = platformData.contexts.size();
         std::vector<cl::Platform> platforms;
@@ -183,6 +195,14 @@ OpenCLContext::OpenCLContext(const System& system, int platformIndex, int device
             defaultOptimizationOptions = "-cl-mad-enable -cl-no-signed-zeros";
         supports64BitGlobalAtomics = (device.getInfo<CL_DEVICE_EXTENSIONS>().find("cl_khr_int64_base_atomics") != string::npos);
         supportsDoublePrecision = (device.getInfo<CL_DEVICE_EXTENSIONS>().find("cl_khr_fp64") != string::npos);
+        try {
+            hostIsUnifiedMemory = (device.getInfo<CL_DEVICE_HOST_UNIFIED_MEMORY>() == CL_TRUE);
+        }
+        catch (cl::Error err) {
+            // The query requires OpenCL 1.1, so assume a discrete device if it fails.
+
+            hostIsUnifiedMemory = false;
+        }
         if ((useDoublePrecision || useMixedPrecision) && !supportsDoublePrecision)
             throw OpenMMException("This device does not support double precision");
         string vendor = device.getInfo<CL_DEVICE_VENDOR>();
@@ -262,7 +282,7 @@ OpenCLContext::OpenCLContext(const System& system, int platformIndex, int device
         contextDevices.push_back(device);
         cl_context_properties cprops[] = {CL_CONTEXT_PLATFORM, (cl_context_properties) platforms[bestPlatform](), 0};
         context = cl::Context(contextDevices, cprops, errorCallback);
-        defaultQueue = cl::CommandQueue(context, device);
+        defaultQueue = cl::CommandQueue(context, device, profileKernels ? CL_QUEUE_PROFILING_ENABLE : 0);
         currentQueue = defaultQueue;
         numAtoms = system.getNumParticles();
         paddedNumAtoms = TileSize*((numAtoms+TileSize-1)/TileSize);
@@ -307,6 +327,7 @@ OpenCLContext::OpenCLContext(const System& system, int platformIndex, int device
     clearFiveBuffersKernel = cl::Kernel(utilities, "clearFiveBuffers");
     clearSixBuffersKernel = cl::Kernel(utilities, "clearSixBuffers");
     reduceReal4Kernel = cl::Kernel(utilities, "reduceReal4Buffer");
+    reduceEnergyKernel = cl::Kernel(utilities, "reduceEnergyBuffer");
     if (supports64BitGlobalAtomics)
         reduceForcesKernel = cl::Kernel(utilities, "reduceForces");
     setChargesKernel = cl::Kernel(utilities, "setCharges");
@@ -412,6 +433,13 @@ OpenCLContext::OpenCLContext(const System& system, int platformIndex, int device
 }
 
 OpenCLContext::~OpenCLContext() {
+    if (profileKernels) {
+        flushProfileEvents();
+        if (profileTrace.size() > 0)
+            profileTrace.erase(profileTrace.size()-1); // Remove the trailing comma.
+        ofstream out(profilingFile.c_str());
+        out<<"{\"traceEvents\":["<<profileTrace<<"]}"<<endl;
+    }
     for (auto force : forces)
         delete force;
     for (auto listener : reorderListeners)
@@ -436,6 +464,10 @@ OpenCLContext::~OpenCLContext() {
         delete longForceBuffer;
     if (energyBuffer != NULL)
         delete energyBuffer;
+    if (energyPartialSums != NULL)
+        delete energyPartialSums;
+    if (energySum != NULL)
+        delete energySum;
     if (energyParamDerivBuffer != NULL)
         delete energyParamDerivBuffer;
     if (atomIndexDevice != NULL)
@@ -452,6 +484,38 @@ OpenCLContext::~OpenCLContext() {
         delete nonbonded;
     if (thread != NULL)
         delete thread;
+    for (auto& entry : pooledDeviceBuffers)
+        for (cl::Buffer* buffer : entry.second)
+            delete buffer;
+}
+
+cl::Buffer* OpenCLContext::acquireDeviceBuffer(cl_int flags, size_t size) {
+    map<pair<cl_int, size_t>, vector<cl::Buffer*> >::iterator pool = pooledDeviceBuffers.find(make_pair(flags, size));
+    if (pool != pooledDeviceBuffers.end() && pool->second.size() > 0) {
+        cl::Buffer* buffer = pool->second.back();
+        pool->second.pop_back();
+        return buffer;
+    }
+    allocatedDeviceMemory += size;
+    return new cl::Buffer(context, flags, size);
+}
+
+void OpenCLContext::releaseDeviceBuffer(cl::Buffer* buffer, cl_int flags, size_t size) {
+    pooledDeviceBuffers[make_pair(flags, size)].push_back(buffer);
+}
+
+void OpenCLContext::getDeviceMemoryUsage(map<string, size_t>& usage) const {
+    usage.clear();
+    for (OpenCLArray* array : registeredArrays)
+        usage[array->getName()] += array->getSize()*(size_t) array->getElementSize();
+}
+
+void OpenCLContext::registerArray(OpenCLArray* array) {
+    registeredArrays.insert(array);
+}
+
+void OpenCLContext::unregisterArray(OpenCLArray* array) {
+    registeredArrays.erase(array);
 }
 
 void OpenCLContext::initialize() {
@@ -471,6 +535,14 @@ void OpenCLContext::initialize() {
         force = OpenCLArray::create<mm_float4>(*this, &forceBuffers->getDeviceBuffer(), paddedNumAtoms, "force");
         energyBuffer = OpenCLArray::create<cl_double>(*this, energyBufferSize, "energyBuffer");
     }
+    if (useDoublePrecision || useMixedPrecision) {
+        energyPartialSums = OpenCLArray::create<cl_double>(*this, numThreadBlocks, "energyPartialSums");
+        energySum = OpenCLArray::create<cl_double>(*this, 1, "energySum");
+    }
+    else {
+        energyPartialSums = OpenCLArray::create<cl_float>(*this, numThreadBlocks, "energyPartialSums");
+        energySum = OpenCLArray::create<cl_float>(*this, 1, "energySum");
+    }
     if (supports64BitGlobalAtomics) {
         longForceBuffer = OpenCLArray::create<cl_long>(*this, 3*paddedNumAtoms, "longForceBuffer");
         reduceForcesKernel.setArg<cl::Buffer>(0, longForceBuffer->getDeviceBuffer());
@@ -600,6 +672,43 @@ cl::Program OpenCLContext::createProgram(const string source, const map<string,
     // Get length before using c_str() to avoid length() call invalidating the c_str() value.
     string src_string = src.str();
     ::size_t src_length = src_string.length();
+
+    // If a cache directory has been specified, see whether we already have a compiled binary
+    // for this program.  The cache key includes the device and driver, since a binary compiled
+    // for one device may not work on another.
+
+    string cacheFile;
+    if (cacheDir.length() > 0) {
+        string deviceKey = device.getInfo<CL_DEVICE_NAME>()+device.getInfo<CL_DRIVER_VERSION>();
+        CSHA1 sha1;
+        sha1.Update((const UINT_8*) src_string.c_str(), src_length);
+        sha1.Update((const UINT_8*) deviceKey.c_str(), deviceKey.size());
+        sha1.Final();
+        UINT_8 hash[20];
+        sha1.GetHash(hash);
+        stringstream cacheFileName;
+        cacheFileName << cacheDir;
+        cacheFileName.flags(ios::hex);
+        for (int i = 0; i < 20; i++)
+            cacheFileName << setw(2) << setfill('0') << (int) hash[i];
+        cacheFile = cacheFileName.str();
+        ifstream in(cacheFile.c_str(), ios::in|ios::binary);
+        if (in) {
+            vector<char> binary((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+            in.close();
+            if (binary.size() > 0) {
+                try {
+                    cl::Program::Binaries binaries(1, make_pair(&binary[0], binary.size()));
+                    cl::Program program(context, vector<cl::Device>(1, device), binaries);
+                    program.build(vector<cl::Device>(1, device), options.c_str());
+                    return program;
+                }
+                catch (...) {
+                    // The cached binary could not be used, so compile from source instead.
+                }
+            }
+        }
+    }
     cl::Program::Sources sources(1, make_pair(src_string.c_str(), src_length));
     cl::Program program(context, sources);
     try {
@@ -607,6 +716,27 @@ cl::Program OpenCLContext::createProgram(const string source, const map<string,
     } catch (cl::Error err) {
         throw OpenMMException("Error compiling kernel: "+program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(device));
     }
+
+    // If possible, write the binary to the cache so later contexts can skip compiling it.
+
+    if (cacheFile.length() > 0) {
+        try {
+            vector< ::size_t> sizes = program.getInfo<CL_PROGRAM_BINARY_SIZES>();
+            if (sizes.size() == 1 && sizes[0] > 0) {
+                vector<char> binary(sizes[0]);
+                char* binaryPtr = &binary[0];
+                clGetProgramInfo(program(), CL_PROGRAM_BINARIES, sizeof(char*), &binaryPtr, NULL);
+                ofstream out(cacheFile.c_str(), ios::out|ios::binary);
+                out.write(&binary[0], binary.size());
+                out.close();
+                if (out.fail())
+                    remove(cacheFile.c_str());
+            }
+        }
+        catch (...) {
+            // Ignore.  The cache is only an optimization.
+        }
+    }
     return program;
 }
 
@@ -642,7 +772,16 @@ void OpenCLContext::executeKernel(cl::Kernel& kernel, int workUnits, int blockSi
         blockSize = ThreadBlockSize;
     int size = std::min((workUnits+blockSize-1)/blockSize, numThreadBlocks)*blockSize;
     try {
-        currentQueue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(size), cl::NDRange(blockSize));
+        if (profileKernels) {
+            ProfiledKernel profile;
+            profile.name = kernel.getInfo<CL_KERNEL_FUNCTION_NAME>();
+            currentQueue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(size), cl::NDRange(blockSize), NULL, &profile.event);
+            pendingProfiledKernels.push_back(profile);
+            if (pendingProfiledKernels.size() >= 1000)
+                flushProfileEvents();
+        }
+        else
+            currentQueue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(size), cl::NDRange(blockSize));
     }
     catch (cl::Error err) {
         stringstream str;
@@ -651,6 +790,27 @@ void OpenCLContext::executeKernel(cl::Kernel& kernel, int workUnits, int blockSi
     }
 }
 
+void OpenCLContext::flushProfileEvents() {
+    for (auto& profile : pendingProfiledKernels) {
+        profile.event.wait();
+        cl_ulong start = profile.event.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+        cl_ulong end = profile.event.getProfilingInfo<CL_PROFILING_COMMAND_END>();
+        if (!hasProfileReferenceTime) {
+            // All timestamps in the trace are measured from the start of the first kernel.
+
+            profileReferenceTime = start;
+            hasProfileReferenceTime = true;
+        }
+        stringstream event;
+        event.precision(3);
+        event<<fixed;
+        event<<"{\"name\":\""<<profile.name<<"\",\"cat\":\"kernel\",\"ph\":\"X\",\"pid\":"<<contextIndex<<",\"tid\":0,";
+        event<<"\"ts\":"<<(1e-3*(start-profileReferenceTime))<<",\"dur\":"<<(1e-3*(end-start))<<"},";
+        profileTrace += event.str();
+    }
+    pendingProfiledKernels.clear();
+}
+
 void OpenCLContext::clearBuffer(OpenCLArray& array) {
     clearBuffer(array.getDeviceBuffer(), array.getSize()*array.getElementSize());
 }
@@ -742,6 +902,30 @@ void OpenCLContext::reduceForces() {
         reduceBuffer(*forceBuffers, numForceBuffers);
 }
 
+double OpenCLContext::reduceEnergy() {
+    // The first pass computes one partial sum per work group, then a second pass with a
+    // single work group combines them into the total.
+
+    reduceEnergyKernel.setArg<cl::Buffer>(0, energyBuffer->getDeviceBuffer());
+    reduceEnergyKernel.setArg<cl::Buffer>(1, energyPartialSums->getDeviceBuffer());
+    reduceEnergyKernel.setArg<cl_int>(2, energyBuffer->getSize());
+    executeKernel(reduceEnergyKernel, energyPartialSums->getSize()*ThreadBlockSize, ThreadBlockSize);
+    reduceEnergyKernel.setArg<cl::Buffer>(0, energyPartialSums->getDeviceBuffer());
+    reduceEnergyKernel.setArg<cl::Buffer>(1, energySum->getDeviceBuffer());
+    reduceEnergyKernel.setArg<cl_int>(2, energyPartialSums->getSize());
+    executeKernel(reduceEnergyKernel, ThreadBlockSize, ThreadBlockSize);
+    if (useDoublePrecision || useMixedPrecision) {
+        double energy;
+        energySum->download(&energy);
+        return energy;
+    }
+    else {
+        float energy;
+        energySum->download(&energy);
+        return energy;
+    }
+}
+
 void OpenCLContext::reduceBuffer(OpenCLArray& array, int numBuffers) {
     int bufferSize = array.getSize()/numBuffers;
     reduceReal4Kernel.setArg<cl::Buffer>(0, array.getDeviceBuffer());
@@ -902,13 +1086,35 @@ void OpenCLContext::findMoleculeGroups() {
     vector<Molecule> uniqueMolecules;
     vector<vector<int> > moleculeInstances;
     vector<vector<int> > moleculeOffsets;
+    map<size_t, vector<int> > uniqueMoleculesByHash;
     for (int molIndex = 0; molIndex < (int) molecules.size(); molIndex++) {
         Molecule& mol = molecules[molIndex];
 
-        // See if it is identical to another molecule.
+        // Compute a hash based on properties that identical molecules are guaranteed to share,
+        // so that only molecules with equal hashes ever need to be compared in detail.
+
+        size_t hash = mol.atoms.size();
+        for (int i = 0; i < (int) mol.atoms.size(); i++) {
+            hash = hash*31 + (size_t) (mol.atoms[i]-mol.atoms[0]);
+            hash = hash*31 + std::hash<double>()(system.getParticleMass(mol.atoms[i]));
+        }
+        for (int i = 0; i < (int) mol.constraints.size(); i++) {
+            int particle1, particle2;
+            double distance;
+            system.getConstraintParameters(mol.constraints[i], particle1, particle2, distance);
+            hash = hash*31 + (size_t) (particle1-mol.atoms[0]);
+            hash = hash*31 + (size_t) (particle2-mol.atoms[0]);
+            hash = hash*31 + std::hash<double>()(distance);
+        }
+        for (int i = 0; i < (int) mol.groups.size(); i++)
+            hash = hash*31 + mol.groups[i].size();
+
+        // See if it is identical to another molecule with the same hash.
 
         bool isNew = true;
-        for (int j = 0; j < (int) uniqueMolecules.size() && isNew; j++) {
+        vector<int>& candidates = uniqueMoleculesByHash[hash];
+        for (int candidateIndex = 0; candidateIndex < (int) candidates.size() && isNew; candidateIndex++) {
+            int j = candidates[candidateIndex];
             Molecule& mol2 = uniqueMolecules[j];
             bool identical = (mol.atoms.size() == mol2.atoms.size() && mol.constraints.size() == mol2.constraints.size());
 
@@ -950,6 +1156,7 @@ void OpenCLContext::findMoleculeGroups() {
             }
         }
         if (isNew) {
+            candidates.push_back((int) uniqueMolecules.size());
             uniqueMolecules.push_back(mol);
             moleculeInstances.push_back(vector<int>());
             moleculeInstances[moleculeInstances.size()-1].push_back(molIndex);
@@ -1098,6 +1305,18 @@ void OpenCLContext::reorderAtoms() {
         reorderAtomsImpl<cl_float, mm_float4, cl_float, mm_float4>();
 }
 
+// Spread out the low eight bits of a value so the coordinates along the three axes can be
+// interleaved into a Morton index.  Sorting by Morton index gives nearly the same locality
+// as a Hilbert curve at a small fraction of the cost of computing the indices.
+
+static int spreadBits(int x) {
+    x = (x | (x<<16)) & 0x030000FF;
+    x = (x | (x<<8)) & 0x0300F00F;
+    x = (x | (x<<4)) & 0x030C30C3;
+    x = (x | (x<<2)) & 0x09249249;
+    return x;
+}
+
 template <class Real, class Real4, class Mixed, class Mixed4>
 void OpenCLContext::reorderAtomsImpl() {
 
@@ -1198,9 +1417,9 @@ void OpenCLContext::reorderAtomsImpl() {
 
         // Select a bin for each molecule, then sort them by bin.
 
-        bool useHilbert = (numMolecules > 5000 || atoms.size() > 8); // For small systems, a simple zigzag curve works better than a Hilbert curve.
+        bool useMorton = (numMolecules > 5000 || atoms.size() > 8); // For small systems, a simple zigzag curve works better than a space filling curve.
         Real binWidth;
-        if (useHilbert)
+        if (useMorton)
             binWidth = (Real) (max(max(maxx-minx, maxy-miny), maxz-minz)/255.0);
         else
             binWidth = (Real) (0.2*nonbonded->getMaxCutoffDistance());
@@ -1208,18 +1427,13 @@ void OpenCLContext::reorderAtomsImpl() {
         int xbins = 1 + (int) ((maxx-minx)*invBinWidth);
         int ybins = 1 + (int) ((maxy-miny)*invBinWidth);
         vector<pair<int, int> > molBins(numMolecules);
-        bitmask_t coords[3];
         for (int i = 0; i < numMolecules; i++) {
             int x = (int) ((molPos[i].x-minx)*invBinWidth);
             int y = (int) ((molPos[i].y-miny)*invBinWidth);
             int z = (int) ((molPos[i].z-minz)*invBinWidth);
             int bin;
-            if (useHilbert) {
-                coords[0] = x;
-                coords[1] = y;
-                coords[2] = z;
-                bin = (int) hilbert_c2i(3, 8, coords);
-            }
+            if (useMorton)
+                bin = (spreadBits(z)<<2) | (spreadBits(y)<<1) | spreadBits(x);
             else {
                 int yodd = y&1;
                 int zodd = z&1;
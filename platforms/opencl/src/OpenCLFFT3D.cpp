@@ -31,12 +31,20 @@
 #include <map>
 #include <sstream>
 #include <string>
+#ifdef OPENMM_USE_CLFFT
+#include <clFFT.h>
+#endif
 
 using namespace OpenMM;
 using namespace std;
 
 OpenCLFFT3D::OpenCLFFT3D(OpenCLContext& context, int xsize, int ysize, int zsize, bool realToComplex) :
         context(context), xsize(xsize), ysize(ysize), zsize(zsize) {
+    clfftForwardPlan = 0;
+    clfftBackwardPlan = 0;
+    useClfft = tryInitializeClfft(realToComplex);
+    if (useClfft)
+        return;
     packRealAsComplex = false;
     int packedXSize = xsize;
     int packedYSize = ysize;
@@ -94,7 +102,114 @@ OpenCLFFT3D::OpenCLFFT3D(OpenCLContext& context, int xsize, int ysize, int zsize
     invykernel = createKernel(packedZSize, packedXSize, packedYSize, ythreads, 2, false, inputIsReal);
 }
 
+OpenCLFFT3D::~OpenCLFFT3D() {
+#ifdef OPENMM_USE_CLFFT
+    if (clfftForwardPlan != 0)
+        clfftDestroyPlan(&clfftForwardPlan);
+    if (clfftBackwardPlan != 0)
+        clfftDestroyPlan(&clfftBackwardPlan);
+#endif
+}
+
+#ifdef OPENMM_USE_CLFFT
+/**
+ * Create and bake a clFFT plan for one direction of the transform.  On failure the plan is
+ * set to 0 and false is returned.
+ */
+static bool createClfftPlan(OpenCLContext& context, int xsize, int ysize, int zsize, bool realToComplex, bool forward, clfftPlanHandle& plan) {
+    // The lengths are ordered with the fastest varying dimension first.
+
+    size_t lengths[] = {(size_t) zsize, (size_t) ysize, (size_t) xsize};
+    if (clfftCreateDefaultPlan(&plan, context.getContext()(), CLFFT_3D, lengths) != CLFFT_SUCCESS) {
+        plan = 0;
+        return false;
+    }
+    bool success = (clfftSetPlanPrecision(plan, context.getUseDoublePrecision() ? CLFFT_DOUBLE : CLFFT_SINGLE) == CLFFT_SUCCESS);
+    success &= (clfftSetResultLocation(plan, CLFFT_OUTOFPLACE) == CLFFT_SUCCESS);
+
+    // The built-in implementation computes unnormalized transforms, so make clFFT do the same.
+
+    success &= (clfftSetPlanScale(plan, CLFFT_BACKWARD, 1.0f) == CLFFT_SUCCESS);
+    if (realToComplex) {
+        // The real data is stored contiguously, while the transformed data contains only the
+        // xsize*ysize*(zsize/2+1) non-redundant complex values.
+
+        size_t realStrides[] = {1, (size_t) zsize, (size_t) zsize*ysize};
+        size_t complexStrides[] = {1, (size_t) (zsize/2+1), (size_t) (zsize/2+1)*ysize};
+        success &= (clfftSetLayout(plan, forward ? CLFFT_REAL : CLFFT_HERMITIAN_INTERLEAVED, forward ? CLFFT_HERMITIAN_INTERLEAVED : CLFFT_REAL) == CLFFT_SUCCESS);
+        success &= (clfftSetPlanInStride(plan, CLFFT_3D, forward ? realStrides : complexStrides) == CLFFT_SUCCESS);
+        success &= (clfftSetPlanOutStride(plan, CLFFT_3D, forward ? complexStrides : realStrides) == CLFFT_SUCCESS);
+    }
+    cl_command_queue queue = context.getQueue()();
+    if (success)
+        success = (clfftBakePlan(plan, 1, &queue, NULL, NULL) == CLFFT_SUCCESS);
+    if (!success) {
+        clfftDestroyPlan(&plan);
+        plan = 0;
+    }
+    return success;
+}
+
+bool OpenCLFFT3D::tryInitializeClfft(bool realToComplex) {
+    // Initialize the library the first time it is used.
+
+    static bool isSetup = false;
+    if (!isSetup) {
+        clfftSetupData setupData;
+        if (clfftInitSetupData(&setupData) != CLFFT_SUCCESS || clfftSetup(&setupData) != CLFFT_SUCCESS)
+            return false;
+        isSetup = true;
+    }
+    bool success = createClfftPlan(context, xsize, ysize, zsize, realToComplex, true, clfftForwardPlan) &&
+                   createClfftPlan(context, xsize, ysize, zsize, realToComplex, false, clfftBackwardPlan);
+
+    // Allocate a temporary buffer if the plans need one.
+
+    if (success) {
+        size_t forwardSize, backwardSize;
+        if (clfftGetTmpBufSize(clfftForwardPlan, &forwardSize) == CLFFT_SUCCESS && clfftGetTmpBufSize(clfftBackwardPlan, &backwardSize) == CLFFT_SUCCESS) {
+            size_t tmpSize = max(forwardSize, backwardSize);
+            if (tmpSize > 0) {
+                try {
+                    clfftTmpBuffer = cl::Buffer(context.getContext(), CL_MEM_READ_WRITE, tmpSize);
+                }
+                catch (cl::Error err) {
+                    success = false;
+                }
+            }
+        }
+        else
+            success = false;
+    }
+    if (!success) {
+        if (clfftForwardPlan != 0)
+            clfftDestroyPlan(&clfftForwardPlan);
+        if (clfftBackwardPlan != 0)
+            clfftDestroyPlan(&clfftBackwardPlan);
+        clfftForwardPlan = 0;
+        clfftBackwardPlan = 0;
+    }
+    return success;
+}
+#else
+bool OpenCLFFT3D::tryInitializeClfft(bool realToComplex) {
+    return false;
+}
+#endif
+
 void OpenCLFFT3D::execFFT(OpenCLArray& in, OpenCLArray& out, bool forward) {
+#ifdef OPENMM_USE_CLFFT
+    if (useClfft) {
+        cl_command_queue queue = context.getQueue()();
+        cl_mem input = in.getDeviceBuffer()();
+        cl_mem output = out.getDeviceBuffer()();
+        clfftStatus result = clfftEnqueueTransform(forward ? clfftForwardPlan : clfftBackwardPlan, forward ? CLFFT_FORWARD : CLFFT_BACKWARD,
+                1, &queue, 0, NULL, NULL, &input, &output, clfftTmpBuffer());
+        if (result != CLFFT_SUCCESS)
+            throw OpenMMException("Error executing FFT: "+context.intToString(result));
+        return;
+    }
+#endif
     cl::Kernel kernel1 = (forward ? zkernel : invzkernel);
     cl::Kernel kernel2 = (forward ? xkernel : invxkernel);
     cl::Kernel kernel3 = (forward ? ykernel : invykernel);
@@ -151,6 +266,8 @@ int OpenCLFFT3D::findLegalDimension(int minimum) {
             while (unfactored > 1 && unfactored%factor == 0)
                 unfactored /= factor;
         }
+        while (unfactored > 1 && unfactored%11 == 0)
+            unfactored /= 11;
         if (unfactored == 1)
             return minimum;
         minimum++;
@@ -176,7 +293,9 @@ cl::Kernel OpenCLFFT3D::createKernel(int xsize, int ysize, int zsize, int& threa
             int input = stage%2;
             int output = 1-input;
             int radix;
-            if (L%7 == 0)
+            if (L%11 == 0)
+                radix = 11;
+            else if (L%7 == 0)
                 radix = 7;
             else if (L%5 == 0)
                 radix = 5;
@@ -202,7 +321,35 @@ cl::Kernel OpenCLFFT3D::createKernel(int xsize, int ysize, int zsize, int& threa
                 source<<"int base = i+block*"<<zsize<<";\n";
             }
             source<<"int j = i/"<<m<<";\n";
-            if (radix == 7) {
+            if (radix == 11) {
+                // An 11 point transform is computed directly from the definition, pairing terms
+                // whose twiddle factors are complex conjugates of each other.
+
+                source<<"real2 c0 = data"<<input<<"[base];\n";
+                for (int i = 1; i < 11; i++)
+                    source<<"real2 c"<<i<<" = data"<<input<<"[base+"<<(i*L*m)<<"];\n";
+                for (int t = 1; t <= 5; t++) {
+                    source<<"real2 d"<<(2*t-2)<<" = c"<<t<<"+c"<<(11-t)<<";\n";
+                    source<<"real2 d"<<(2*t-1)<<" = c"<<t<<"-c"<<(11-t)<<";\n";
+                }
+                source<<"data"<<output<<"[base+10*j*"<<m<<"] = c0+d0+d2+d4+d6+d8;\n";
+                for (int k = 1; k <= 5; k++) {
+                    source<<"real2 a"<<k<<" = c0";
+                    for (int t = 1; t <= 5; t++)
+                        source<<"+"<<context.doubleToString(cos(2*M_PI*t*k/11))<<"*d"<<(2*t-2);
+                    source<<";\n";
+                    source<<"real2 b"<<k<<" = (SIGN)*(real2) (";
+                    for (int t = 1; t <= 5; t++)
+                        source<<(t > 1 ? "+" : "")<<context.doubleToString(sin(2*M_PI*t*k/11))<<"*d"<<(2*t-1)<<".y";
+                    source<<", -(";
+                    for (int t = 1; t <= 5; t++)
+                        source<<(t > 1 ? "+" : "")<<context.doubleToString(sin(2*M_PI*t*k/11))<<"*d"<<(2*t-1)<<".x";
+                    source<<"));\n";
+                    source<<"data"<<output<<"[base+(10*j+"<<k<<")*"<<m<<"] = multiplyComplex(w[j*"<<(k*zsize)<<"/"<<(11*L)<<"], a"<<k<<"+b"<<k<<");\n";
+                    source<<"data"<<output<<"[base+(10*j+"<<(11-k)<<")*"<<m<<"] = multiplyComplex(w[j*"<<((11-k)*zsize)<<"/"<<(11*L)<<"], a"<<k<<"-b"<<k<<");\n";
+                }
+            }
+            else if (radix == 7) {
                 source<<"real2 c0 = data"<<input<<"[base];\n";
                 source<<"real2 c1 = data"<<input<<"[base+"<<(L*m)<<"];\n";
                 source<<"real2 c2 = data"<<input<<"[base+"<<(2*L*m)<<"];\n";
@@ -103,7 +103,7 @@ OpenCLIntegrationUtilities::OpenCLIntegrationUtilities(OpenCLContext& context, c
         ccmaConstraintMatrixValue(NULL), ccmaDelta1(NULL), ccmaDelta2(NULL), ccmaConverged(NULL), ccmaConvergedHostBuffer(NULL),
         vsite2AvgAtoms(NULL), vsite2AvgWeights(NULL), vsite3AvgAtoms(NULL), vsite3AvgWeights(NULL),
         vsiteOutOfPlaneAtoms(NULL), vsiteOutOfPlaneWeights(NULL), vsiteLocalCoordsAtoms(NULL), vsiteLocalCoordsParams(NULL),
-        hasInitializedPosConstraintKernels(false), hasInitializedVelConstraintKernels(false), hasOverlappingVsites(false) {
+        hasInitializedPosConstraintKernels(false), hasInitializedVelConstraintKernels(false), hasOverlappingVsites(false), stepSizeDownloadPending(false) {
     // Create workspace arrays.
 
     lastStepSize = mm_double2(0.0, 0.0);
@@ -395,6 +395,7 @@ OpenCLIntegrationUtilities::OpenCLIntegrationUtilities(OpenCLContext& context, c
         ccmaConstraintMatrixColumn = OpenCLArray::create<cl_int>(context, numCCMA*maxRowElements, "ConstraintMatrixColumn");
         ccmaConverged = OpenCLArray::create<cl_int>(context, 2, "CcmaConverged");
         ccmaConvergedHostBuffer = OpenCLArray::create<cl_int>(context, 1, "CcmaConvergedHostBuffer", CL_MEM_WRITE_ONLY | CL_MEM_ALLOC_HOST_PTR);
+        ccmaExpectedIterations[0] = ccmaExpectedIterations[1] = 0;
         // Different communication mechanisms give optimal performance on AMD and on NVIDIA.
         string vendor = context.getDevice().getInfo<CL_DEVICE_VENDOR>();
         ccmaUseDirectBuffer = (vendor.size() >= 28 && vendor.substr(0, 28) == "Advanced Micro Devices, Inc.");
@@ -737,7 +738,21 @@ void OpenCLIntegrationUtilities::setNextStepSize(double size) {
 }
 
 double OpenCLIntegrationUtilities::getLastStepSize() {
-    if (context.getUseDoublePrecision() || context.getUseMixedPrecision())
+    if (stepSizeDownloadPending) {
+        // The download was started as soon as the step size was selected, so only wait for
+        // that early point in the queue.  The kernels for the rest of the step can still
+        // be executing.
+
+        stepSizeEvent.wait();
+        stepSizeDownloadPending = false;
+        if (context.getUseDoublePrecision() || context.getUseMixedPrecision())
+            lastStepSize = downloadedStepSize;
+        else {
+            mm_float2 lastStepSizeFloat = *((mm_float2*) &downloadedStepSize);
+            lastStepSize = mm_double2(lastStepSizeFloat.x, lastStepSizeFloat.y);
+        }
+    }
+    else if (context.getUseDoublePrecision() || context.getUseMixedPrecision())
         stepSize->download(&lastStepSize);
     else {
         mm_float2 lastStepSizeFloat;
@@ -747,6 +762,12 @@ double OpenCLIntegrationUtilities::getLastStepSize() {
     return lastStepSize.y;
 }
 
+void OpenCLIntegrationUtilities::downloadStepSizeAsync() {
+    int elementSize = (context.getUseDoublePrecision() || context.getUseMixedPrecision() ? sizeof(mm_double2) : sizeof(mm_float2));
+    context.getQueue().enqueueReadBuffer(stepSize->getDeviceBuffer(), CL_FALSE, 0, elementSize, &downloadedStepSize, NULL, &stepSizeEvent);
+    stepSizeDownloadPending = true;
+}
+
 void OpenCLIntegrationUtilities::applyConstraints(double tol) {
     applyConstraints(false, tol);
 }
@@ -847,22 +868,31 @@ void OpenCLIntegrationUtilities::applyConstraints(bool constrainVelocities, doub
         else
             ccmaForceKernel.setArg<cl_float>(7, (cl_float) tol);
         context.executeKernel(ccmaDirectionsKernel, ccmaAtoms->getSize());
+        // The iteration usually converges after nearly the same number of iterations on every
+        // step, and each convergence check requires synchronizing with the device.  Skip the
+        // checks during the iterations that recent steps have needed: launching a few extra
+        // iterations is cheap, since the kernels return immediately once the constraints have
+        // converged.
+
         const int checkInterval = 4;
+        int& expectedIterations = ccmaExpectedIterations[constrainVelocities ? 1 : 0];
         int* converged = (int*) context.getPinnedBuffer();
         int* ccmaConvergedHostMemory = (int*) context.getQueue().enqueueMapBuffer(ccmaConvergedHostBuffer->getDeviceBuffer(), CL_TRUE, CL_MAP_WRITE, 0, sizeof(cl_int));
         ccmaConvergedHostMemory[0] = 0;
         context.getQueue().enqueueUnmapMemObject(ccmaConvergedHostBuffer->getDeviceBuffer(), ccmaConvergedHostMemory);
-        for (int i = 0; i < 150; i++) {
+        int i;
+        for (i = 0; i < 150; i++) {
             ccmaForceKernel.setArg<cl_int>(8, i);
             context.executeKernel(ccmaForceKernel, ccmaAtoms->getSize());
             cl::Event event;
-            if ((i+1)%checkInterval == 0 && !ccmaUseDirectBuffer)
+            bool checkConvergence = ((i+1)%checkInterval == 0 && i+1 >= expectedIterations);
+            if (checkConvergence && !ccmaUseDirectBuffer)
                 context.getQueue().enqueueReadBuffer(ccmaConverged->getDeviceBuffer(), CL_FALSE, 0, 2*sizeof(cl_int), converged, NULL, &event);
             ccmaMultiplyKernel.setArg<cl_int>(5, i);
             context.executeKernel(ccmaMultiplyKernel, ccmaAtoms->getSize());
             ccmaUpdateKernel.setArg<cl_int>(8, i);
             context.executeKernel(ccmaUpdateKernel, context.getNumAtoms());
-            if ((i+1)%checkInterval == 0) {
+            if (checkConvergence) {
                 if (ccmaUseDirectBuffer) {
                     ccmaConvergedHostMemory = (int*) context.getQueue().enqueueMapBuffer(ccmaConvergedHostBuffer->getDeviceBuffer(), CL_FALSE, CL_MAP_READ, 0, sizeof(cl_int), NULL, &event);
                     context.getQueue().flush();
@@ -877,6 +907,11 @@ void OpenCLIntegrationUtilities::applyConstraints(bool constrainVelocities, doub
                     break;
             }
         }
+
+        // Let the estimate drift down slowly so it can adapt if the iteration starts
+        // converging sooner.
+
+        expectedIterations = max(0, max(i-1, expectedIterations-1));
     }
 }
 
@@ -110,6 +110,18 @@ static bool usesVariable(const Lepton::ParsedExpression& expression, const strin
     return usesVariable(expression.getRootNode(), variable);
 }
 
+static bool usesOnlyVariables(const Lepton::ExpressionTreeNode& node, const set<string>& variables) {
+    const Lepton::Operation& op = node.getOperation();
+    if (op.getId() == Lepton::Operation::VARIABLE && variables.find(op.getName()) == variables.end())
+        return false;
+    if (op.getId() == Lepton::Operation::CUSTOM)
+        return false; // deriv() can only be evaluated on the host.
+    for (auto& child : node.getChildren())
+        if (!usesOnlyVariables(child, variables))
+            return false;
+    return true;
+}
+
 static pair<ExpressionTreeNode, string> makeVariable(const string& name, const string& value) {
     return make_pair(ExpressionTreeNode(new Operation::Variable(name)), value);
 }
@@ -131,28 +143,17 @@ void OpenCLCalcForcesAndEnergyKernel::beginComputation(ContextImpl& context, boo
 }
 
 double OpenCLCalcForcesAndEnergyKernel::finishComputation(ContextImpl& context, bool includeForces, bool includeEnergy, int groups, bool& valid) {
-    cl.getBondedUtilities().computeInteractions(groups);
+    cl.getBondedUtilities().computeInteractions(groups, includeForces, includeEnergy);
     cl.getNonbondedUtilities().computeInteractions(groups, includeForces, includeEnergy);
     double sum = 0.0;
     for (auto computation : cl.getPostComputations())
         sum += computation->computeForceAndEnergy(includeForces, includeEnergy, groups);
-    cl.reduceForces();
-    cl.getIntegrationUtilities().distributeForcesFromVirtualSites();
-    if (includeEnergy) {
-        OpenCLArray& energyArray = cl.getEnergyBuffer();
-        if (cl.getUseDoublePrecision() || cl.getUseMixedPrecision()) {
-            double* energy = (double*) cl.getPinnedBuffer();
-            energyArray.download(energy);
-            for (int i = 0; i < energyArray.getSize(); i++)
-                sum += energy[i];
-        }
-        else {
-            float* energy = (float*) cl.getPinnedBuffer();
-            energyArray.download(energy);
-            for (int i = 0; i < energyArray.getSize(); i++)
-                sum += energy[i];
-        }
+    if (includeForces) {
+        cl.reduceForces();
+        cl.getIntegrationUtilities().distributeForcesFromVirtualSites();
     }
+    if (includeEnergy)
+        sum += cl.reduceEnergy();
     if (!cl.getForcesValid())
         valid = false;
     return sum;
@@ -231,47 +232,173 @@ void OpenCLUpdateStateDataKernel::getPositions(ContextImpl& context, vector<Vec3
     cl.getPlatformData().threads.waitForThreads();
 }
 
-void OpenCLUpdateStateDataKernel::setPositions(ContextImpl& context, const vector<Vec3>& positions) {
-    const vector<cl_int>& order = cl.getAtomIndex();
+OpenCLUpdateStateDataKernel::~OpenCLUpdateStateDataKernel() {
+    if (wrappedPositions != NULL)
+        delete wrappedPositions;
+    if (wrapMoleculeAtoms != NULL)
+        delete wrapMoleculeAtoms;
+    if (wrapMoleculeStartIndex != NULL)
+        delete wrapMoleculeStartIndex;
+}
+
+bool OpenCLUpdateStateDataKernel::getWrappedPositions(ContextImpl& context, vector<Vec3>& positions) {
     int numParticles = context.getSystem().getNumParticles();
+    positions.resize(numParticles);
+    if (wrappedPositions == NULL) {
+        cl::Program program = cl.createProgram(OpenCLKernelSources::wrapPositions);
+        wrapKernel = cl::Kernel(program, "wrapMolecules");
+        wrappedPositions = new OpenCLArray(cl, cl.getPaddedNumAtoms(), cl.getUseDoublePrecision() ? sizeof(mm_double4) : sizeof(mm_float4), "wrappedPositions");
+        wrapMoleculeAtoms = OpenCLArray::create<int>(cl, cl.getNumAtoms(), "wrapMoleculeAtoms");
+        wrapMoleculeStartIndex = OpenCLArray::create<int>(cl, context.getMolecules().size()+1, "wrapMoleculeStartIndex");
+        wrapKernel.setArg<cl::Buffer>(6, cl.getPosq().getDeviceBuffer());
+        wrapKernel.setArg<cl::Buffer>(7, wrappedPositions->getDeviceBuffer());
+        wrapKernel.setArg<cl::Buffer>(8, wrapMoleculeAtoms->getDeviceBuffer());
+        wrapKernel.setArg<cl::Buffer>(9, wrapMoleculeStartIndex->getDeviceBuffer());
+    }
+    if (wrapAtomOrder != cl.getAtomIndex()) {
+        // The atoms have been reordered since the molecule lists were uploaded, so rebuild
+        // them in terms of the current device ordering.
+
+        const vector<vector<int> >& molecules = context.getMolecules();
+        const vector<cl_int>& order = cl.getAtomIndex();
+        vector<int> inverseOrder(cl.getNumAtoms());
+        for (int i = 0; i < cl.getNumAtoms(); i++)
+            inverseOrder[order[i]] = i;
+        vector<int> atoms(wrapMoleculeAtoms->getSize());
+        vector<int> startIndex(wrapMoleculeStartIndex->getSize());
+        int index = 0;
+        for (int i = 0; i < (int) molecules.size(); i++) {
+            startIndex[i] = index;
+            for (int atom : molecules[i])
+                atoms[index++] = inverseOrder[atom];
+        }
+        startIndex[molecules.size()] = index;
+        wrapMoleculeAtoms->upload(atoms);
+        wrapMoleculeStartIndex->upload(startIndex);
+        wrapAtomOrder.assign(order.begin(), order.end());
+    }
+
+    // Wrap the positions on the device, writing them to a separate array so the simulation
+    // state is not modified.  The positions in posq were last translated as whole molecules,
+    // so the cell offsets recorded during reordering are uniform within each molecule and
+    // cancel out of the wrapped result.  That lets the conversion below skip them.
+
+    wrapKernel.setArg<cl_int>(0, wrapMoleculeStartIndex->getSize()-1);
+    setPeriodicBoxArgs(cl, wrapKernel, 1);
+    cl.executeKernel(wrapKernel, cl.getNumAtoms());
+    vector<mm_float4> posCorrection;
     if (cl.getUseDoublePrecision()) {
         mm_double4* posq = (mm_double4*) cl.getPinnedBuffer();
-        cl.getPosq().download(posq);
-        for (int i = 0; i < numParticles; ++i) {
-            mm_double4& pos = posq[i];
-            const Vec3& p = positions[order[i]];
-            pos.x = p[0];
-            pos.y = p[1];
-            pos.z = p[2];
+        wrappedPositions->download(posq);
+    }
+    else if (cl.getUseMixedPrecision()) {
+        mm_float4* posq = (mm_float4*) cl.getPinnedBuffer();
+        wrappedPositions->download(posq, false);
+        posCorrection.resize(numParticles);
+        cl.getPosqCorrection().download(posCorrection);
+    }
+    else {
+        mm_float4* posq = (mm_float4*) cl.getPinnedBuffer();
+        wrappedPositions->download(posq);
+    }
+
+    // Filling in the output array is done in parallel for speed.
+
+    cl.getPlatformData().threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        const vector<cl_int>& order = cl.getAtomIndex();
+        int numParticles = cl.getNumAtoms();
+        int numThreads = threads.getNumThreads();
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        if (cl.getUseDoublePrecision()) {
+            mm_double4* posq = (mm_double4*) cl.getPinnedBuffer();
+            for (int i = start; i < end; ++i) {
+                mm_double4 pos = posq[i];
+                positions[order[i]] = Vec3(pos.x, pos.y, pos.z);
+            }
+        }
+        else if (cl.getUseMixedPrecision()) {
+            mm_float4* posq = (mm_float4*) cl.getPinnedBuffer();
+            for (int i = start; i < end; ++i) {
+                mm_float4 pos1 = posq[i];
+                mm_float4 pos2 = posCorrection[i];
+                positions[order[i]] = Vec3((double)pos1.x+(double)pos2.x, (double)pos1.y+(double)pos2.y, (double)pos1.z+(double)pos2.z);
+            }
+        }
+        else {
+            mm_float4* posq = (mm_float4*) cl.getPinnedBuffer();
+            for (int i = start; i < end; ++i) {
+                mm_float4 pos = posq[i];
+                positions[order[i]] = Vec3(pos.x, pos.y, pos.z);
+            }
         }
+    });
+    cl.getPlatformData().threads.waitForThreads();
+    return true;
+}
+
+void OpenCLUpdateStateDataKernel::setPositions(ContextImpl& context, const vector<Vec3>& positions) {
+    int numParticles = context.getSystem().getNumParticles();
+    cl.getPosq().download(cl.getPinnedBuffer());
+
+    // Filling in the buffer is done in parallel for speed.
+
+    cl.getPlatformData().threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        const vector<cl_int>& order = cl.getAtomIndex();
+        int numThreads = threads.getNumThreads();
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        if (cl.getUseDoublePrecision()) {
+            mm_double4* posq = (mm_double4*) cl.getPinnedBuffer();
+            for (int i = start; i < end; ++i) {
+                mm_double4& pos = posq[i];
+                const Vec3& p = positions[order[i]];
+                pos.x = p[0];
+                pos.y = p[1];
+                pos.z = p[2];
+            }
+        }
+        else {
+            mm_float4* posq = (mm_float4*) cl.getPinnedBuffer();
+            for (int i = start; i < end; ++i) {
+                mm_float4& pos = posq[i];
+                const Vec3& p = positions[order[i]];
+                pos.x = (cl_float) p[0];
+                pos.y = (cl_float) p[1];
+                pos.z = (cl_float) p[2];
+            }
+        }
+    });
+    cl.getPlatformData().threads.waitForThreads();
+    if (cl.getUseDoublePrecision()) {
+        mm_double4* posq = (mm_double4*) cl.getPinnedBuffer();
         for (int i = numParticles; i < cl.getPaddedNumAtoms(); i++)
             posq[i] = mm_double4(0.0, 0.0, 0.0, 0.0);
         cl.getPosq().upload(posq);
     }
     else {
         mm_float4* posq = (mm_float4*) cl.getPinnedBuffer();
-        cl.getPosq().download(posq);
-        for (int i = 0; i < numParticles; ++i) {
-            mm_float4& pos = posq[i];
-            const Vec3& p = positions[order[i]];
-            pos.x = (cl_float) p[0];
-            pos.y = (cl_float) p[1];
-            pos.z = (cl_float) p[2];
-        }
         for (int i = numParticles; i < cl.getPaddedNumAtoms(); i++)
             posq[i] = mm_float4(0.0f, 0.0f, 0.0f, 0.0f);
         cl.getPosq().upload(posq);
     }
     if (cl.getUseMixedPrecision()) {
         mm_float4* posCorrection = (mm_float4*) cl.getPinnedBuffer();
-        for (int i = 0; i < numParticles; ++i) {
-            mm_float4& c = posCorrection[i];
-            const Vec3& p = positions[order[i]];
-            c.x = (cl_float) (p[0]-(cl_float)p[0]);
-            c.y = (cl_float) (p[1]-(cl_float)p[1]);
-            c.z = (cl_float) (p[2]-(cl_float)p[2]);
-            c.w = 0;
-        }
+        cl.getPlatformData().threads.execute([&] (ThreadPool& threads, int threadIndex) {
+            const vector<cl_int>& order = cl.getAtomIndex();
+            int numThreads = threads.getNumThreads();
+            int start = threadIndex*numParticles/numThreads;
+            int end = (threadIndex+1)*numParticles/numThreads;
+            for (int i = start; i < end; ++i) {
+                mm_float4& c = posCorrection[i];
+                const Vec3& p = positions[order[i]];
+                c.x = (cl_float) (p[0]-(cl_float)p[0]);
+                c.y = (cl_float) (p[1]-(cl_float)p[1]);
+                c.z = (cl_float) (p[2]-(cl_float)p[2]);
+                c.w = 0;
+            }
+        });
+        cl.getPlatformData().threads.waitForThreads();
         for (int i = numParticles; i < cl.getPaddedNumAtoms(); i++)
             posCorrection[i] = mm_float4(0.0f, 0.0f, 0.0f, 0.0f);
         cl.getPosqCorrection().upload(posCorrection);
@@ -282,56 +409,76 @@ void OpenCLUpdateStateDataKernel::setPositions(ContextImpl& context, const vecto
 }
 
 void OpenCLUpdateStateDataKernel::getVelocities(ContextImpl& context, vector<Vec3>& velocities) {
-    const vector<cl_int>& order = cl.getAtomIndex();
     int numParticles = context.getSystem().getNumParticles();
     velocities.resize(numParticles);
-    if (cl.getUseDoublePrecision() || cl.getUseMixedPrecision()) {
-        mm_double4* velm = (mm_double4*) cl.getPinnedBuffer();
-        cl.getVelm().download(velm);
-        for (int i = 0; i < numParticles; ++i) {
-            mm_double4 vel = velm[i];
-            mm_int4 offset = cl.getPosCellOffsets()[i];
-            velocities[order[i]] = Vec3(vel.x, vel.y, vel.z);
+    cl.getVelm().download(cl.getPinnedBuffer());
+
+    // Filling in the output array is done in parallel for speed.
+
+    cl.getPlatformData().threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        const vector<cl_int>& order = cl.getAtomIndex();
+        int numThreads = threads.getNumThreads();
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        if (cl.getUseDoublePrecision() || cl.getUseMixedPrecision()) {
+            mm_double4* velm = (mm_double4*) cl.getPinnedBuffer();
+            for (int i = start; i < end; ++i) {
+                mm_double4 vel = velm[i];
+                velocities[order[i]] = Vec3(vel.x, vel.y, vel.z);
+            }
         }
-    }
-    else {
-        mm_float4* velm = (mm_float4*) cl.getPinnedBuffer();
-        cl.getVelm().download(velm);
-        for (int i = 0; i < numParticles; ++i) {
-            mm_float4 vel = velm[i];
-            mm_int4 offset = cl.getPosCellOffsets()[i];
-            velocities[order[i]] = Vec3(vel.x, vel.y, vel.z);
+        else {
+            mm_float4* velm = (mm_float4*) cl.getPinnedBuffer();
+            for (int i = start; i < end; ++i) {
+                mm_float4 vel = velm[i];
+                velocities[order[i]] = Vec3(vel.x, vel.y, vel.z);
+            }
         }
-    }
+    });
+    cl.getPlatformData().threads.waitForThreads();
 }
 
 void OpenCLUpdateStateDataKernel::setVelocities(ContextImpl& context, const vector<Vec3>& velocities) {
-    const vector<cl_int>& order = cl.getAtomIndex();
     int numParticles = context.getSystem().getNumParticles();
+    cl.getVelm().download(cl.getPinnedBuffer());
+
+    // Filling in the buffer is done in parallel for speed.
+
+    cl.getPlatformData().threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        const vector<cl_int>& order = cl.getAtomIndex();
+        int numThreads = threads.getNumThreads();
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        if (cl.getUseDoublePrecision() || cl.getUseMixedPrecision()) {
+            mm_double4* velm = (mm_double4*) cl.getPinnedBuffer();
+            for (int i = start; i < end; ++i) {
+                mm_double4& vel = velm[i];
+                const Vec3& p = velocities[order[i]];
+                vel.x = p[0];
+                vel.y = p[1];
+                vel.z = p[2];
+            }
+        }
+        else {
+            mm_float4* velm = (mm_float4*) cl.getPinnedBuffer();
+            for (int i = start; i < end; ++i) {
+                mm_float4& vel = velm[i];
+                const Vec3& p = velocities[order[i]];
+                vel.x = p[0];
+                vel.y = p[1];
+                vel.z = p[2];
+            }
+        }
+    });
+    cl.getPlatformData().threads.waitForThreads();
     if (cl.getUseDoublePrecision() || cl.getUseMixedPrecision()) {
         mm_double4* velm = (mm_double4*) cl.getPinnedBuffer();
-        cl.getVelm().download(velm);
-        for (int i = 0; i < numParticles; ++i) {
-            mm_double4& vel = velm[i];
-            const Vec3& p = velocities[order[i]];
-            vel.x = p[0];
-            vel.y = p[1];
-            vel.z = p[2];
-        }
         for (int i = numParticles; i < cl.getPaddedNumAtoms(); i++)
             velm[i] = mm_double4(0.0, 0.0, 0.0, 0.0);
         cl.getVelm().upload(velm);
     }
     else {
         mm_float4* velm = (mm_float4*) cl.getPinnedBuffer();
-        cl.getVelm().download(velm);
-        for (int i = 0; i < numParticles; ++i) {
-            mm_float4& vel = velm[i];
-            const Vec3& p = velocities[order[i]];
-            vel.x = p[0];
-            vel.y = p[1];
-            vel.z = p[2];
-        }
         for (int i = numParticles; i < cl.getPaddedNumAtoms(); i++)
             velm[i] = mm_float4(0.0f, 0.0f, 0.0f, 0.0f);
         cl.getVelm().upload(velm);
@@ -339,25 +486,33 @@ void OpenCLUpdateStateDataKernel::setVelocities(ContextImpl& context, const vect
 }
 
 void OpenCLUpdateStateDataKernel::getForces(ContextImpl& context, vector<Vec3>& forces) {
-    const vector<cl_int>& order = cl.getAtomIndex();
     int numParticles = context.getSystem().getNumParticles();
     forces.resize(numParticles);
-    if (cl.getUseDoublePrecision()) {
-        mm_double4* force = (mm_double4*) cl.getPinnedBuffer();
-        cl.getForce().download(force);
-        for (int i = 0; i < numParticles; ++i) {
-            mm_double4 f = force[i];
-            forces[order[i]] = Vec3(f.x, f.y, f.z);
+    cl.getForce().download(cl.getPinnedBuffer());
+
+    // Filling in the output array is done in parallel for speed.
+
+    cl.getPlatformData().threads.execute([&] (ThreadPool& threads, int threadIndex) {
+        const vector<cl_int>& order = cl.getAtomIndex();
+        int numThreads = threads.getNumThreads();
+        int start = threadIndex*numParticles/numThreads;
+        int end = (threadIndex+1)*numParticles/numThreads;
+        if (cl.getUseDoublePrecision()) {
+            mm_double4* force = (mm_double4*) cl.getPinnedBuffer();
+            for (int i = start; i < end; ++i) {
+                mm_double4 f = force[i];
+                forces[order[i]] = Vec3(f.x, f.y, f.z);
+            }
         }
-    }
-    else {
-        mm_float4* force = (mm_float4*) cl.getPinnedBuffer();
-        cl.getForce().download(force);
-        for (int i = 0; i < numParticles; ++i) {
-            mm_float4 f = force[i];
-            forces[order[i]] = Vec3(f.x, f.y, f.z);
+        else {
+            mm_float4* force = (mm_float4*) cl.getPinnedBuffer();
+            for (int i = start; i < end; ++i) {
+                mm_float4 f = force[i];
+                forces[order[i]] = Vec3(f.x, f.y, f.z);
+            }
         }
-    }
+    });
+    cl.getPlatformData().threads.waitForThreads();
 }
 
 void OpenCLUpdateStateDataKernel::getEnergyParameterDerivatives(ContextImpl& context, map<string, double>& derivs) {
@@ -1780,7 +1935,7 @@ void OpenCLCalcNonbondedForceKernel::initialize(const System& system, const Nonb
 
                 try {
                     cpuPme = getPlatform().createKernel(CalcPmeReciprocalForceKernel::Name(), *cl.getPlatformData().context);
-                    cpuPme.getAs<CalcPmeReciprocalForceKernel>().initialize(gridSizeX, gridSizeY, gridSizeZ, numParticles, alpha, false);
+                    cpuPme.getAs<CalcPmeReciprocalForceKernel>().initialize(gridSizeX, gridSizeY, gridSizeZ, numParticles, alpha, cl.getPlatformData().deterministicForces);
                     cl::Program program = cl.createProgram(OpenCLKernelSources::pme, pmeDefines);
                     cl::Kernel addForcesKernel = cl::Kernel(program, "addForces");
                     pmeio = new PmeIO(cl, addForcesKernel);
@@ -1835,10 +1990,15 @@ void OpenCLCalcNonbondedForceKernel::initialize(const System& system, const Nonb
                 bool isNvidia = (vendor.size() >= 6 && vendor.substr(0, 6) == "NVIDIA");
                 if (isNvidia)
                     pmeDefines["USE_ALTERNATE_MEMORY_ACCESS_PATTERN"] = "1";
-                usePmeQueue = (!cl.getPlatformData().disablePmeStream && isNvidia);
+                // Run the reciprocal space calculation on its own command queue so it can overlap
+                // with the direct space kernels.  The queues are synchronized with events, so this
+                // works on any GPU, but it is pointless on CPU devices where all queues share the
+                // same cores.
+
+                usePmeQueue = (!cl.getPlatformData().disablePmeStream && !deviceIsCpu);
                 if (usePmeQueue) {
                     pmeDefines["USE_PME_STREAM"] = "1";
-                    pmeQueue = cl::CommandQueue(cl.getContext(), cl.getDevice());
+                    pmeQueue = cl::CommandQueue(cl.getContext(), cl.getDevice(), cl.getProfileKernels() ? CL_QUEUE_PROFILING_ENABLE : 0);
                     int recipForceGroup = force.getReciprocalSpaceForceGroup();
                     if (recipForceGroup < 0)
                         recipForceGroup = force.getForceGroup();
@@ -1985,6 +2145,7 @@ double OpenCLCalcNonbondedForceKernel::execute(ContextImpl& context, bool includ
             ewaldSumsKernel.setArg<cl::Buffer>(0, cl.getEnergyBuffer().getDeviceBuffer());
             ewaldSumsKernel.setArg<cl::Buffer>(1, cl.getPosq().getDeviceBuffer());
             ewaldSumsKernel.setArg<cl::Buffer>(2, cosSinSums->getDeviceBuffer());
+            ewaldSumsKernel.setArg(5, OpenCLContext::ThreadBlockSize*cosSinSums->getElementSize(), NULL);
             ewaldForcesKernel.setArg<cl::Buffer>(0, cl.getForceBuffers().getDeviceBuffer());
             ewaldForcesKernel.setArg<cl::Buffer>(1, cl.getPosq().getDeviceBuffer());
             ewaldForcesKernel.setArg<cl::Buffer>(2, cosSinSums->getDeviceBuffer());
@@ -2118,11 +2279,11 @@ double OpenCLCalcNonbondedForceKernel::execute(ContextImpl& context, bool includ
             ewaldForcesKernel.setArg<mm_float4>(3, mm_float4((float) recipBoxSize.x, (float) recipBoxSize.y, (float) recipBoxSize.z, 0));
             ewaldForcesKernel.setArg<cl_float>(4, (cl_float) recipCoefficient);
         }
-        cl.executeKernel(ewaldSumsKernel, cosSinSums->getSize());
+        cl.executeKernel(ewaldSumsKernel, cosSinSums->getSize()*OpenCLContext::ThreadBlockSize, OpenCLContext::ThreadBlockSize);
         cl.executeKernel(ewaldForcesKernel, cl.getNumAtoms());
     }
     if (pmeGrid != NULL && includeReciprocal) {
-        if (usePmeQueue && !includeEnergy)
+        if (usePmeQueue)
             cl.setQueue(pmeQueue);
         
         // Invert the periodic box vectors.
@@ -2342,13 +2503,15 @@ double OpenCLCalcNonbondedForceKernel::execute(ContextImpl& context, bool includ
     return energy;
 }
 
-void OpenCLCalcNonbondedForceKernel::copyParametersToContext(ContextImpl& context, const NonbondedForce& force) {
+void OpenCLCalcNonbondedForceKernel::copyParametersToContext(ContextImpl& context, const NonbondedForce& force, int firstParticle, int lastParticle, int firstException, int lastException) {
     // Make sure the new parameters are acceptable.
-    
+
     if (force.getNumParticles() != cl.getNumAtoms())
         throw OpenMMException("updateParametersInContext: The number of particles has changed");
+    if (firstParticle > lastParticle && firstException > lastException)
+        return;
     if (!hasCoulomb || !hasLJ) {
-        for (int i = 0; i < force.getNumParticles(); i++) {
+        for (int i = firstParticle; i <= lastParticle; i++) {
             double charge, sigma, epsilon;
             force.getParticleParameters(i, charge, sigma, epsilon);
             if (!hasCoulomb && charge != 0.0)
@@ -2371,41 +2534,55 @@ void OpenCLCalcNonbondedForceKernel::copyParametersToContext(ContextImpl& contex
     int startIndex = cl.getContextIndex()*exceptions.size()/numContexts;
     int endIndex = (cl.getContextIndex()+1)*exceptions.size()/numContexts;
     int numExceptions = endIndex-startIndex;
-    
+
     // Record the per-particle parameters.
-    
-    vector<double> chargeVector(cl.getNumAtoms());
-    vector<mm_float2> sigmaEpsilonVector(cl.getPaddedNumAtoms(), mm_float2(0,0));
-    double sumSquaredCharges = 0.0;
-    for (int i = 0; i < force.getNumParticles(); i++) {
-        double charge, sigma, epsilon;
-        force.getParticleParameters(i, charge, sigma, epsilon);
-        chargeVector[i] = charge;
-        sigmaEpsilonVector[i] = mm_float2((float) (0.5*sigma), (float) (2.0*sqrt(epsilon)));
-        sumSquaredCharges += charge*charge;
+
+    if (firstParticle <= lastParticle) {
+        vector<double> chargeVector(cl.getNumAtoms());
+        vector<mm_float2> sigmaEpsilonVector(lastParticle-firstParticle+1);
+        double sumSquaredCharges = 0.0;
+        for (int i = 0; i < force.getNumParticles(); i++) {
+            double charge, sigma, epsilon;
+            force.getParticleParameters(i, charge, sigma, epsilon);
+            chargeVector[i] = charge;
+            if (i >= firstParticle && i <= lastParticle)
+                sigmaEpsilonVector[i-firstParticle] = mm_float2((float) (0.5*sigma), (float) (2.0*sqrt(epsilon)));
+            sumSquaredCharges += charge*charge;
+        }
+        cl.setCharges(chargeVector);
+        sigmaEpsilon->uploadSubArray(&sigmaEpsilonVector[0], firstParticle, sigmaEpsilonVector.size());
+
+        // Compute other values that depend on the particle parameters.
+
+        if (nonbondedMethod == Ewald || nonbondedMethod == PME)
+            ewaldSelfEnergy = (cl.getContextIndex() == 0 ? -ONE_4PI_EPS0*alpha*sumSquaredCharges/sqrt(M_PI) : 0.0);
+        if (force.getUseDispersionCorrection() && cl.getContextIndex() == 0 && (nonbondedMethod == CutoffPeriodic || nonbondedMethod == Ewald || nonbondedMethod == PME))
+            dispersionCoefficient = NonbondedForceImpl::calcDispersionCorrection(context.getSystem(), force);
     }
-    cl.setCharges(chargeVector);
-    sigmaEpsilon->upload(sigmaEpsilonVector);
-    
+
     // Record the exceptions.
-    
-    if (numExceptions > 0) {
-        vector<vector<int> > atoms(numExceptions, vector<int>(2));
-        vector<mm_float4> exceptionParamsVector(numExceptions);
+
+    if (numExceptions > 0 && firstException <= lastException) {
+        // Find the range of exceptions this context owns whose parameters changed.
+
+        int firstIndex = numExceptions, lastIndex = -1;
         for (int i = 0; i < numExceptions; i++) {
-            double chargeProd, sigma, epsilon;
-            force.getExceptionParameters(exceptions[startIndex+i], atoms[i][0], atoms[i][1], chargeProd, sigma, epsilon);
-            exceptionParamsVector[i] = mm_float4((float) (ONE_4PI_EPS0*chargeProd), (float) sigma, (float) (4.0*epsilon), 0.0f);
+            if (exceptions[startIndex+i] >= firstException && exceptions[startIndex+i] <= lastException) {
+                firstIndex = min(firstIndex, i);
+                lastIndex = max(lastIndex, i);
+            }
+        }
+        if (firstIndex <= lastIndex) {
+            vector<mm_float4> exceptionParamsVector(lastIndex-firstIndex+1);
+            for (int i = firstIndex; i <= lastIndex; i++) {
+                int atom1, atom2;
+                double chargeProd, sigma, epsilon;
+                force.getExceptionParameters(exceptions[startIndex+i], atom1, atom2, chargeProd, sigma, epsilon);
+                exceptionParamsVector[i-firstIndex] = mm_float4((float) (ONE_4PI_EPS0*chargeProd), (float) sigma, (float) (4.0*epsilon), 0.0f);
+            }
+            exceptionParams->uploadSubArray(&exceptionParamsVector[0], firstIndex, exceptionParamsVector.size());
         }
-        exceptionParams->upload(exceptionParamsVector);
     }
-    
-    // Compute other values.
-    
-    if (nonbondedMethod == Ewald || nonbondedMethod == PME)
-        ewaldSelfEnergy = (cl.getContextIndex() == 0 ? -ONE_4PI_EPS0*alpha*sumSquaredCharges/sqrt(M_PI) : 0.0);
-    if (force.getUseDispersionCorrection() && cl.getContextIndex() == 0 && (nonbondedMethod == CutoffPeriodic || nonbondedMethod == Ewald || nonbondedMethod == PME))
-        dispersionCoefficient = NonbondedForceImpl::calcDispersionCorrection(context.getSystem(), force);
     cl.invalidateMolecules(info);
 }
 
@@ -2889,13 +3066,13 @@ double OpenCLCalcCustomNonbondedForceKernel::execute(ContextImpl& context, bool
         if (changed) {
             globals->upload(globalParamValues);
             if (forceCopy != NULL) {
-                CustomNonbondedForceImpl::calcLongRangeCorrection(*forceCopy, context.getOwner(), longRangeCoefficient, longRangeCoefficientDerivs);
+                CustomNonbondedForceImpl::calcLongRangeCorrection(*forceCopy, longRangeCorrectionData, context.getOwner(), longRangeCoefficient, longRangeCoefficientDerivs);
                 hasInitializedLongRangeCorrection = true;
             }
         }
     }
     if (!hasInitializedLongRangeCorrection) {
-        CustomNonbondedForceImpl::calcLongRangeCorrection(*forceCopy, context.getOwner(), longRangeCoefficient, longRangeCoefficientDerivs);
+        CustomNonbondedForceImpl::calcLongRangeCorrection(*forceCopy, longRangeCorrectionData, context.getOwner(), longRangeCoefficient, longRangeCoefficientDerivs);
         hasInitializedLongRangeCorrection = true;
     }
     if (interactionGroupData != NULL) {
@@ -2947,7 +3124,7 @@ void OpenCLCalcCustomNonbondedForceKernel::copyParametersToContext(ContextImpl&
     // If necessary, recompute the long range correction.
     
     if (forceCopy != NULL) {
-        CustomNonbondedForceImpl::calcLongRangeCorrection(force, context.getOwner(), longRangeCoefficient, longRangeCoefficientDerivs);
+        CustomNonbondedForceImpl::calcLongRangeCorrection(force, longRangeCorrectionData, context.getOwner(), longRangeCoefficient, longRangeCoefficientDerivs);
         hasInitializedLongRangeCorrection = true;
         *forceCopy = force;
     }
@@ -4450,9 +4627,49 @@ void OpenCLCalcCustomExternalForceKernel::copyParametersToContext(ContextImpl& c
             paramVector[i][j] = (cl_float) parameters[j];
     }
     params->setParameterValues(paramVector);
-    
+
     // Mark that the current reordering may be invalid.
-    
+
+    cl.invalidateMolecules(info);
+}
+
+void OpenCLCalcCustomExternalForceKernel::copyParametersToContext(ContextImpl& context, const CustomExternalForce& force, const vector<int>& changedParticles) {
+    int numContexts = cl.getPlatformData().contexts.size();
+    int startIndex = cl.getContextIndex()*force.getNumParticles()/numContexts;
+    int endIndex = (cl.getContextIndex()+1)*force.getNumParticles()/numContexts;
+    if (numParticles != endIndex-startIndex)
+        throw OpenMMException("updateSelectedParametersInContext: The number of particles has changed");
+
+    // Find the terms this context is responsible for, and group them into contiguous blocks
+    // so each block can be uploaded with a single transfer.
+
+    vector<int> local;
+    for (int index : changedParticles) {
+        if (index < 0 || index >= force.getNumParticles())
+            throw OpenMMException("updateSelectedParametersInContext: Illegal particle index");
+        if (index >= startIndex && index < endIndex)
+            local.push_back(index-startIndex);
+    }
+    sort(local.begin(), local.end());
+    int particle;
+    vector<double> parameters;
+    for (int start = 0; start < (int) local.size(); ) {
+        int end = start+1;
+        while (end < (int) local.size() && local[end] == local[end-1]+1)
+            end++;
+        vector<vector<cl_float> > paramVector(end-start);
+        for (int i = start; i < end; i++) {
+            force.getParticleParameters(startIndex+local[i], particle, parameters);
+            paramVector[i-start].resize(parameters.size());
+            for (int j = 0; j < (int) parameters.size(); j++)
+                paramVector[i-start][j] = (cl_float) parameters[j];
+        }
+        params->setParameterValuesSubset(local[start], paramVector);
+        start = end;
+    }
+
+    // Mark that the current reordering may be invalid.
+
     cl.invalidateMolecules(info);
 }
 
@@ -7031,6 +7248,112 @@ double OpenCLIntegrateLangevinStepKernel::computeKineticEnergy(ContextImpl& cont
     return cl.getIntegrationUtilities().computeKineticEnergy(0.5*integrator.getStepSize());
 }
 
+OpenCLIntegrateLangevinMiddleStepKernel::~OpenCLIntegrateLangevinMiddleStepKernel() {
+    if (params != NULL)
+        delete params;
+    if (oldDelta != NULL)
+        delete oldDelta;
+}
+
+void OpenCLIntegrateLangevinMiddleStepKernel::initialize(const System& system, const LangevinMiddleIntegrator& integrator) {
+    cl.getPlatformData().initializeContexts(system);
+    cl.getIntegrationUtilities().initRandomNumberGenerator(integrator.getRandomNumberSeed());
+    map<string, string> defines;
+    defines["NUM_ATOMS"] = cl.intToString(cl.getNumAtoms());
+    cl::Program program = cl.createProgram(OpenCLKernelSources::langevinMiddle, defines, "");
+    kernel1 = cl::Kernel(program, "integrateLangevinMiddlePart1");
+    kernel2 = cl::Kernel(program, "integrateLangevinMiddlePart2");
+    kernel3 = cl::Kernel(program, "integrateLangevinMiddlePart3");
+    bool useDouble = cl.getUseDoublePrecision() || cl.getUseMixedPrecision();
+    params = new OpenCLArray(cl, 2, useDouble ? sizeof(cl_double) : sizeof(cl_float), "langevinMiddleParams");
+    oldDelta = new OpenCLArray(cl, cl.getPaddedNumAtoms(), useDouble ? sizeof(mm_double4) : sizeof(mm_float4), "oldDelta");
+    prevStepSize = -1.0;
+}
+
+void OpenCLIntegrateLangevinMiddleStepKernel::execute(ContextImpl& context, const LangevinMiddleIntegrator& integrator) {
+    OpenCLIntegrationUtilities& integration = cl.getIntegrationUtilities();
+    int numAtoms = cl.getNumAtoms();
+    if (!hasInitializedKernels) {
+        hasInitializedKernels = true;
+        kernel1.setArg<cl::Buffer>(0, cl.getVelm().getDeviceBuffer());
+        kernel1.setArg<cl::Buffer>(1, cl.getForce().getDeviceBuffer());
+        kernel1.setArg<cl::Buffer>(2, integration.getStepSize().getDeviceBuffer());
+        kernel2.setArg<cl::Buffer>(0, cl.getVelm().getDeviceBuffer());
+        kernel2.setArg<cl::Buffer>(1, integration.getPosDelta().getDeviceBuffer());
+        kernel2.setArg<cl::Buffer>(2, oldDelta->getDeviceBuffer());
+        kernel2.setArg<cl::Buffer>(3, params->getDeviceBuffer());
+        kernel2.setArg<cl::Buffer>(4, integration.getStepSize().getDeviceBuffer());
+        kernel2.setArg<cl::Buffer>(5, integration.getRandom().getDeviceBuffer());
+        kernel3.setArg<cl::Buffer>(0, cl.getPosq().getDeviceBuffer());
+        setPosqCorrectionArg(cl, kernel3, 1);
+        kernel3.setArg<cl::Buffer>(2, cl.getVelm().getDeviceBuffer());
+        kernel3.setArg<cl::Buffer>(3, integration.getPosDelta().getDeviceBuffer());
+        kernel3.setArg<cl::Buffer>(4, oldDelta->getDeviceBuffer());
+        kernel3.setArg<cl::Buffer>(5, integration.getStepSize().getDeviceBuffer());
+    }
+    double temperature = integrator.getTemperature();
+    double friction = integrator.getFriction();
+    double stepSize = integrator.getStepSize();
+    cl.getIntegrationUtilities().setNextStepSize(stepSize);
+    if (temperature != prevTemp || friction != prevFriction || stepSize != prevStepSize) {
+        // Calculate the integration parameters.
+
+        double kT = BOLTZ*temperature;
+        double vscale = exp(-stepSize*friction);
+        double noisescale = sqrt(kT*(1-vscale*vscale));
+        if (cl.getUseDoublePrecision() || cl.getUseMixedPrecision()) {
+            vector<cl_double> p(params->getSize());
+            p[0] = vscale;
+            p[1] = noisescale;
+            params->upload(p);
+        }
+        else {
+            vector<cl_float> p(params->getSize());
+            p[0] = (cl_float) vscale;
+            p[1] = (cl_float) noisescale;
+            params->upload(p);
+        }
+        prevTemp = temperature;
+        prevFriction = friction;
+        prevStepSize = stepSize;
+    }
+
+    // Apply the velocity kick from the forces, then enforce the velocity constraints.
+
+    cl.executeKernel(kernel1, numAtoms);
+    integration.applyVelocityConstraints(integrator.getConstraintTolerance());
+
+    // Call the second integration kernel.
+
+    kernel2.setArg<cl_uint>(6, integration.prepareRandomNumbers(cl.getPaddedNumAtoms()));
+    cl.executeKernel(kernel2, numAtoms);
+
+    // Apply constraints.
+
+    integration.applyConstraints(integrator.getConstraintTolerance());
+
+    // Call the third integration kernel.
+
+    cl.executeKernel(kernel3, numAtoms);
+    integration.computeVirtualSites();
+
+    // Update the time and step count.
+
+    cl.setTime(cl.getTime()+stepSize);
+    cl.setStepCount(cl.getStepCount()+1);
+    cl.reorderAtoms();
+
+    // Reduce UI lag.
+
+#ifdef WIN32
+    cl.getQueue().flush();
+#endif
+}
+
+double OpenCLIntegrateLangevinMiddleStepKernel::computeKineticEnergy(ContextImpl& context, const LangevinMiddleIntegrator& integrator) {
+    return cl.getIntegrationUtilities().computeKineticEnergy(0);
+}
+
 OpenCLIntegrateBrownianStepKernel::~OpenCLIntegrateBrownianStepKernel() {
 }
 
@@ -7162,6 +7485,7 @@ double OpenCLIntegrateVariableVerletStepKernel::execute(ContextImpl& context, co
         selectSizeKernel.setArg<cl_float>(2, (cl_float) integrator.getErrorTolerance());
     }
     cl.executeKernel(selectSizeKernel, blockSize, blockSize);
+    integration.downloadStepSizeAsync();
 
     // Call the first integration kernel.
 
@@ -7268,6 +7592,7 @@ double OpenCLIntegrateVariableLangevinStepKernel::execute(ContextImpl& context,
         selectSizeKernel.setArg<cl_float>(3, (cl_float) (BOLTZ*integrator.getTemperature()));
     }
     cl.executeKernel(selectSizeKernel, blockSize, blockSize);
+    integration.downloadStepSizeAsync();
 
     // Call the first integration kernel.
 
@@ -7467,6 +7792,49 @@ string OpenCLIntegrateCustomStepKernel::createPerDofComputation(const string& va
     return cl.getExpressionUtilities().createExpressions(expressions, variableNodes, functions, functionNames, "temp"+cl.intToString(component)+"_", tempType);
 }
 
+void OpenCLIntegrateCustomStepKernel::createDeviceGlobalsKernel(int step, const string& computation, map<string, string>& defines) {
+    map<string, string> replacements;
+    replacements["COMPUTE_STEP"] = computation;
+    cl::Program program = cl.createProgram(cl.replaceStrings(OpenCLKernelSources::customIntegratorGlobals, replacements), defines);
+    cl::Kernel kernel = cl::Kernel(program, "computeGlobals");
+    kernels[step].push_back(kernel);
+    int index = 0;
+    kernel.setArg<cl::Buffer>(index++, globalValues->getDeviceBuffer());
+    kernel.setArg<cl::Buffer>(index++, cl.getIntegrationUtilities().getStepSize().getDeviceBuffer());
+    if (cl.getUseDoublePrecision() || cl.getUseMixedPrecision())
+        kernel.setArg<cl_double>(index++, 0.0);
+    else
+        kernel.setArg<cl_float>(index++, 0.0f);
+    kernel.setArg<cl::Buffer>(index++, summedValue->getDeviceBuffer());
+}
+
+void OpenCLIntegrateCustomStepKernel::downloadGlobalValues() const {
+    // If any global variables have been computed on the device, copy their values back to the
+    // host before an expression is evaluated there.
+
+    if (localGlobalsAreCurrent)
+        return;
+    if (cl.getUseDoublePrecision() || cl.getUseMixedPrecision()) {
+        vector<double> values(globalValues->getSize());
+        globalValues->download(values);
+        for (int i = 0; i < numGlobalVariables; i++) {
+            int index = globalVariableIndex[i];
+            globalValuesDouble[index] = values[index];
+            expressionSet.setVariable(index, values[index]);
+        }
+    }
+    else {
+        vector<float> values(globalValues->getSize());
+        globalValues->download(values);
+        for (int i = 0; i < numGlobalVariables; i++) {
+            int index = globalVariableIndex[i];
+            globalValuesDouble[index] = values[index];
+            expressionSet.setVariable(index, values[index]);
+        }
+    }
+    localGlobalsAreCurrent = true;
+}
+
 void OpenCLIntegrateCustomStepKernel::prepareForComputation(ContextImpl& context, CustomIntegrator& integrator, bool& forcesAreValid) {
     OpenCLIntegrationUtilities& integration = cl.getIntegrationUtilities();
     int numAtoms = cl.getNumAtoms();
@@ -7488,6 +7856,7 @@ void OpenCLIntegrateCustomStepKernel::prepareForComputation(ContextImpl& context
         stepType.resize(numSteps);
         stepTarget.resize(numSteps);
         merged.resize(numSteps, false);
+        mergedSum.resize(numSteps, false);
         modifiesParameters = false;
         map<string, string> defines;
         defines["NUM_ATOMS"] = cl.intToString(cl.getNumAtoms());
@@ -7604,7 +7973,46 @@ void OpenCLIntegrateCustomStepKernel::prepareForComputation(ContextImpl& context
                         needsGlobals[step] = true;
             }
         }
-        
+
+        // Identify global computations that can be performed on the device.  A computation whose
+        // target is a global variable and whose expression involves only values that are present
+        // in device memory is done by a tiny kernel instead of on the host, so the result never
+        // needs to be transferred back.  The host copies are refreshed lazily when something
+        // actually needs them.
+
+        computeGlobalOnDevice.resize(numSteps, false);
+        set<string> deviceVariables;
+        for (int i = 0; i < integrator.getNumGlobalVariables(); i++)
+            deviceVariables.insert(integrator.getGlobalVariableName(i));
+        for (auto& name : parameterNames)
+            deviceVariables.insert(name);
+        deviceVariables.insert("dt");
+        for (int step = 0; step < numSteps; step++) {
+            if (stepType[step] != CustomIntegrator::ComputeGlobal && stepType[step] != CustomIntegrator::ComputeSum)
+                continue;
+            if (stepTarget[step].type != VARIABLE)
+                continue;
+            if (stepType[step] == CustomIntegrator::ComputeSum)
+                computeGlobalOnDevice[step] = true;
+            else {
+                set<string> allowed = deviceVariables;
+                allowed.insert(energyName[step]);
+                computeGlobalOnDevice[step] = usesOnlyVariables(expression[step][0].getRootNode(), allowed);
+            }
+        }
+
+        // If the same variable is also set by a computation that must run on the host, keep every
+        // computation of it on the host so the two copies cannot get out of sync.
+
+        for (int step = 0; step < numSteps; step++)
+            if ((stepType[step] == CustomIntegrator::ComputeGlobal || stepType[step] == CustomIntegrator::ComputeSum) && !computeGlobalOnDevice[step] && stepTarget[step].type == VARIABLE)
+                for (int j = 0; j < numSteps; j++)
+                    if (computeGlobalOnDevice[j] && stepTarget[j].variableIndex == stepTarget[step].variableIndex)
+                        computeGlobalOnDevice[j] = false;
+        for (int step = 0; step < numSteps; step++)
+            if (computeGlobalOnDevice[step])
+                needsGlobals[step] = true;
+
         // Determine how each step will represent the position (as just a value, or a value plus a delta).
         
         hasAnyConstraints = (context.getSystem().getNumConstraints() > 0);
@@ -7630,12 +8038,14 @@ void OpenCLIntegrateCustomStepKernel::prepareForComputation(ContextImpl& context
             }
         }
         
-        // Identify steps that can be merged into a single kernel.
-        
+        // Identify steps that can be merged into a single kernel.  A sequence of per-DOF
+        // computations is evaluated with one kernel launch, keeping intermediate values in
+        // registers, and the per-DOF part of a sum can be folded into the same kernel.
+
         for (int step = 1; step < numSteps; step++) {
             if (invalidatesForces[step-1] || forceGroupFlags[step] != forceGroupFlags[step-1])
                 continue;
-            if (stepType[step-1] == CustomIntegrator::ComputePerDof && stepType[step] == CustomIntegrator::ComputePerDof)
+            if (stepType[step-1] == CustomIntegrator::ComputePerDof && (stepType[step] == CustomIntegrator::ComputePerDof || stepType[step] == CustomIntegrator::ComputeSum))
                 merged[step] = true;
         }
         for (int step = numSteps-1; step > 0; step--)
@@ -7661,6 +8071,8 @@ void OpenCLIntegrateCustomStepKernel::prepareForComputation(ContextImpl& context
                 }
                 int numGaussian = 0, numUniform = 0;
                 for (int j = step; j < numSteps && (j == step || merged[j]); j++) {
+                    if (j > step && stepType[j] == CustomIntegrator::ComputeSum)
+                        mergedSum[step] = true;
                     numGaussian += numAtoms*usesVariable(expression[j][0], "gaussian");
                     numUniform += numAtoms*usesVariable(expression[j][0], "uniform");
                     compute << "{\n";
@@ -7737,8 +8149,40 @@ void OpenCLIntegrateCustomStepKernel::prepareForComputation(ContextImpl& context
                     kernel.setArg<cl::Buffer>(index++, sumBuffer->getDeviceBuffer());
                     kernel.setArg<cl::Buffer>(index++, summedValue->getDeviceBuffer());
                     kernel.setArg<cl_int>(index++, 3*numAtoms);
+                    if (computeGlobalOnDevice[step])
+                        createDeviceGlobalsKernel(step, "globals["+cl.intToString(stepTarget[step].variableIndex)+"] = sum[0];\n", defines);
                 }
             }
+            else if (stepType[step] == CustomIntegrator::ComputeSum && merged[step]) {
+                // The per-DOF part of this sum was folded into the previous kernel, so only the
+                // kernel that sums the values is needed.
+
+                cl::Program program = cl.createProgram(OpenCLKernelSources::customIntegrator, defines);
+                cl::Kernel kernel = cl::Kernel(program, useDouble ? "computeDoubleSum" : "computeFloatSum");
+                kernels[step].push_back(kernel);
+                int index = 0;
+                kernel.setArg<cl::Buffer>(index++, sumBuffer->getDeviceBuffer());
+                kernel.setArg<cl::Buffer>(index++, summedValue->getDeviceBuffer());
+                kernel.setArg<cl_int>(index++, 3*numAtoms);
+                if (computeGlobalOnDevice[step])
+                    createDeviceGlobalsKernel(step, "globals["+cl.intToString(stepTarget[step].variableIndex)+"] = sum[0];\n", defines);
+            }
+            else if (stepType[step] == CustomIntegrator::ComputeGlobal && computeGlobalOnDevice[step]) {
+                // Compute a global value on the device so it never needs to be sent to the host.
+
+                map<string, Lepton::ParsedExpression> expressions;
+                expressions["globals["+cl.intToString(stepTarget[step].variableIndex)+"] = "] = expression[step][0];
+                map<string, string> variables;
+                variables["dt"] = "stepSize";
+                variables[energyName[step]] = "energy";
+                for (int i = 0; i < integrator.getNumGlobalVariables(); i++)
+                    variables[integrator.getGlobalVariableName(i)] = "globals["+cl.intToString(globalVariableIndex[i])+"]";
+                for (int i = 0; i < (int) parameterNames.size(); i++)
+                    variables[parameterNames[i]] = "globals["+cl.intToString(parameterVariableIndex[i])+"]";
+                vector<const TabulatedFunction*> functions;
+                vector<pair<string, string> > functionNames;
+                createDeviceGlobalsKernel(step, cl.getExpressionUtilities().createExpressions(expressions, variables, functions, functionNames, "temp_", "double"), defines);
+            }
             else if (stepType[step] == CustomIntegrator::ConstrainPositions) {
                 // Apply position constraints.
 
@@ -7949,8 +8393,10 @@ void OpenCLIntegrateCustomStepKernel::execute(ContextImpl& context, CustomIntegr
             }
         }
         if (needsGlobals[step] && !deviceGlobalsAreCurrent) {
-            // Upload the global values to the device.
-            
+            // Upload the global values to the device.  First merge in any values that were
+            // computed on the device, so the upload does not overwrite them.
+
+            downloadGlobalValues();
             if (cl.getUseDoublePrecision() || cl.getUseMixedPrecision())
                 globalValues->upload(globalValuesDouble);
             else {
@@ -7958,6 +8404,7 @@ void OpenCLIntegrateCustomStepKernel::execute(ContextImpl& context, CustomIntegr
                     globalValuesFloat[j] = (float) globalValuesDouble[j];
                 globalValues->upload(globalValuesFloat);
             }
+            deviceGlobalsAreCurrent = true;
         }
         if (stepType[step] == CustomIntegrator::ComputePerDof && !merged[step]) {
             kernels[step][0].setArg<cl_uint>(9, integration.prepareRandomNumbers(requiredGaussian[step]));
@@ -7969,28 +8416,51 @@ void OpenCLIntegrateCustomStepKernel::execute(ContextImpl& context, CustomIntegr
                 kernels[step][0].setArg<cl_float>(11, (cl_float) energy);
             if (requiredUniform[step] > 0)
                 cl.executeKernel(randomKernel, numAtoms);
+            if (mergedSum[step])
+                cl.clearBuffer(*sumBuffer);
             cl.executeKernel(kernels[step][0], numAtoms, 128);
         }
         else if (stepType[step] == CustomIntegrator::ComputeGlobal) {
-            expressionSet.setVariable(uniformVariableIndex, SimTKOpenMMUtilities::getUniformlyDistributedRandomNumber());
-            expressionSet.setVariable(gaussianVariableIndex, SimTKOpenMMUtilities::getNormallyDistributedRandomNumber());
-            expressionSet.setVariable(stepEnergyVariableIndex[step], energy);
-            recordGlobalValue(globalExpressions[step][0].evaluate(), stepTarget[step], integrator);
+            if (computeGlobalOnDevice[step]) {
+                if (cl.getUseDoublePrecision() || cl.getUseMixedPrecision())
+                    kernels[step][0].setArg<cl_double>(2, energy);
+                else
+                    kernels[step][0].setArg<cl_float>(2, (cl_float) energy);
+                cl.executeKernel(kernels[step][0], 32, 32);
+                localGlobalsAreCurrent = false;
+            }
+            else {
+                downloadGlobalValues();
+                expressionSet.setVariable(uniformVariableIndex, SimTKOpenMMUtilities::getUniformlyDistributedRandomNumber());
+                expressionSet.setVariable(gaussianVariableIndex, SimTKOpenMMUtilities::getNormallyDistributedRandomNumber());
+                expressionSet.setVariable(stepEnergyVariableIndex[step], energy);
+                recordGlobalValue(globalExpressions[step][0].evaluate(), stepTarget[step], integrator);
+            }
         }
         else if (stepType[step] == CustomIntegrator::ComputeSum) {
-            kernels[step][0].setArg<cl_uint>(9, integration.prepareRandomNumbers(requiredGaussian[step]));
-            kernels[step][0].setArg<cl::Buffer>(8, integration.getRandom().getDeviceBuffer());
-            kernels[step][0].setArg<cl::Buffer>(10, uniformRandoms->getDeviceBuffer());
-            if (cl.getUseDoublePrecision() || cl.getUseMixedPrecision())
-                kernels[step][0].setArg<cl_double>(11, energy);
-            else
-                kernels[step][0].setArg<cl_float>(11, (cl_float) energy);
-            if (requiredUniform[step] > 0)
-                cl.executeKernel(randomKernel, numAtoms);
-            cl.clearBuffer(*sumBuffer);
-            cl.executeKernel(kernels[step][0], numAtoms, 128);
-            cl.executeKernel(kernels[step][1], OpenCLContext::ThreadBlockSize, OpenCLContext::ThreadBlockSize);
-            if (cl.getUseDoublePrecision() || cl.getUseMixedPrecision()) {
+            if (!merged[step]) {
+                kernels[step][0].setArg<cl_uint>(9, integration.prepareRandomNumbers(requiredGaussian[step]));
+                kernels[step][0].setArg<cl::Buffer>(8, integration.getRandom().getDeviceBuffer());
+                kernels[step][0].setArg<cl::Buffer>(10, uniformRandoms->getDeviceBuffer());
+                if (cl.getUseDoublePrecision() || cl.getUseMixedPrecision())
+                    kernels[step][0].setArg<cl_double>(11, energy);
+                else
+                    kernels[step][0].setArg<cl_float>(11, (cl_float) energy);
+                if (requiredUniform[step] > 0)
+                    cl.executeKernel(randomKernel, numAtoms);
+                cl.clearBuffer(*sumBuffer);
+                cl.executeKernel(kernels[step][0], numAtoms, 128);
+            }
+            int sumKernel = (merged[step] ? 0 : 1);
+            cl.executeKernel(kernels[step][sumKernel], OpenCLContext::ThreadBlockSize, OpenCLContext::ThreadBlockSize);
+            if (computeGlobalOnDevice[step]) {
+                // Store the result directly into the global variable on the device instead of
+                // downloading it to the host.
+
+                cl.executeKernel(kernels[step][sumKernel+1], 32, 32);
+                localGlobalsAreCurrent = false;
+            }
+            else if (cl.getUseDoublePrecision() || cl.getUseMixedPrecision()) {
                 double value;
                 summedValue->download(&value);
                 recordGlobalValue(value, stepTarget[step], integrator);
@@ -8027,8 +8497,10 @@ void OpenCLIntegrateCustomStepKernel::execute(ContextImpl& context, CustomIntegr
             if (blockEnd[step] != -1)
                 nextStep = blockEnd[step]; // Return to the start of a while block.
         }
-        if (invalidatesForces[step])
+        if (invalidatesForces[step]) {
             forcesAreValid = false;
+            context.invalidateEnergyCache();
+        }
         step = nextStep;
     }
     recordChangedParameters(context);
@@ -8051,6 +8523,7 @@ void OpenCLIntegrateCustomStepKernel::execute(ContextImpl& context, CustomIntegr
 }
 
 bool OpenCLIntegrateCustomStepKernel::evaluateCondition(int step) {
+    downloadGlobalValues();
     expressionSet.setVariable(uniformVariableIndex, SimTKOpenMMUtilities::getUniformlyDistributedRandomNumber());
     expressionSet.setVariable(gaussianVariableIndex, SimTKOpenMMUtilities::getNormallyDistributedRandomNumber());
     expressionSet.setVariable(stepEnergyVariableIndex[step], energy);
@@ -8137,6 +8610,7 @@ void OpenCLIntegrateCustomStepKernel::getGlobalVariables(ContextImpl& context, v
         
         values = initialGlobalVariables;
     }
+    downloadGlobalValues();
     values.resize(numGlobalVariables);
     for (int i = 0; i < numGlobalVariables; i++)
         values[i] = globalValuesDouble[globalVariableIndex[i]];
@@ -8155,6 +8629,7 @@ void OpenCLIntegrateCustomStepKernel::setGlobalVariables(ContextImpl& context, c
         globalValuesDouble[globalVariableIndex[i]] = values[i];
         expressionSet.setVariable(globalVariableIndex[i], values[i]);
     }
+    localGlobalsAreCurrent = true;
     deviceGlobalsAreCurrent = false;
 }
 
@@ -31,6 +31,7 @@
 #include "OpenCLExpressionUtilities.h"
 #include "OpenCLSort.h"
 #include <algorithm>
+#include <cmath>
 #include <map>
 #include <set>
 #include <utility>
@@ -57,7 +58,8 @@ private:
 OpenCLNonbondedUtilities::OpenCLNonbondedUtilities(OpenCLContext& context) : context(context), useCutoff(false), usePeriodic(false), anyExclusions(false), usePadding(true),
         numForceBuffers(0), exclusionIndices(NULL), exclusionRowIndices(NULL), exclusionTiles(NULL), exclusions(NULL), interactingTiles(NULL), interactingAtoms(NULL),
         interactionCount(NULL), blockCenter(NULL), blockBoundingBox(NULL), sortedBlocks(NULL), sortedBlockCenter(NULL), sortedBlockBoundingBox(NULL),
-        oldPositions(NULL), rebuildNeighborList(NULL), blockSorter(NULL), pinnedCountBuffer(NULL), pinnedCountMemory(NULL), forceRebuildNeighborList(true), lastCutoff(0.0), groupFlags(0) {
+        oldPositions(NULL), rebuildNeighborList(NULL), blockSorter(NULL), pinnedCountBuffer(NULL), pinnedCountMemory(NULL), pinnedRebuildBuffer(NULL),
+        pinnedRebuildMemory(NULL), forceRebuildNeighborList(true), lastCutoff(0.0), groupFlags(0) {
     // Decide how many thread blocks and force buffers to use.
 
     deviceIsCpu = (context.getDevice().getInfo<CL_DEVICE_TYPE>() == CL_DEVICE_TYPE_CPU);
@@ -92,6 +94,9 @@ OpenCLNonbondedUtilities::OpenCLNonbondedUtilities(OpenCLContext& context) : con
     }
     pinnedCountBuffer = new cl::Buffer(context.getContext(), CL_MEM_ALLOC_HOST_PTR, sizeof(int));
     pinnedCountMemory = (int*) context.getQueue().enqueueMapBuffer(*pinnedCountBuffer, CL_TRUE, CL_MAP_READ, 0, sizeof(int));
+    pinnedRebuildBuffer = new cl::Buffer(context.getContext(), CL_MEM_ALLOC_HOST_PTR, sizeof(int));
+    pinnedRebuildMemory = (int*) context.getQueue().enqueueMapBuffer(*pinnedRebuildBuffer, CL_TRUE, CL_MAP_READ, 0, sizeof(int));
+    pinnedRebuildMemory[0] = 1;
 }
 
 OpenCLNonbondedUtilities::~OpenCLNonbondedUtilities() {
@@ -127,6 +132,8 @@ OpenCLNonbondedUtilities::~OpenCLNonbondedUtilities() {
         delete blockSorter;
     if (pinnedCountBuffer != NULL)
         delete pinnedCountBuffer;
+    if (pinnedRebuildBuffer != NULL)
+        delete pinnedRebuildBuffer;
 }
 
 void OpenCLNonbondedUtilities::addInteraction(bool usesCutoff, bool usesPeriodic, bool usesExclusions, double cutoffDistance, const vector<vector<int> >& exclusionList, const string& kernel, int forceGroup) {
@@ -196,13 +203,13 @@ void OpenCLNonbondedUtilities::requestExclusions(const vector<vector<int> >& exc
     }
 }
 
-static bool compareUshort2(mm_ushort2 a, mm_ushort2 b) {
+static bool compareInt2(mm_int2 a, mm_int2 b) {
     // This version is used on devices with SIMD width of 32 or less.  It sorts tiles to improve cache efficiency.
 
     return ((a.y < b.y) || (a.y == b.y && a.x < b.x));
 }
 
-static bool compareUshort2LargeSIMD(mm_ushort2 a, mm_ushort2 b) {
+static bool compareInt2LargeSIMD(mm_int2 a, mm_int2 b) {
     // This version is used on devices with SIMD width greater than 32.  It puts diagonal tiles before off-diagonal
     // ones to reduce thread divergence.
     
@@ -242,15 +249,15 @@ void OpenCLNonbondedUtilities::initialize(const System& system) {
             tilesWithExclusions.insert(make_pair(max(x, y), min(x, y)));
         }
     }
-    vector<mm_ushort2> exclusionTilesVec;
+    vector<mm_int2> exclusionTilesVec;
     for (set<pair<int, int> >::const_iterator iter = tilesWithExclusions.begin(); iter != tilesWithExclusions.end(); ++iter)
-        exclusionTilesVec.push_back(mm_ushort2((unsigned short) iter->first, (unsigned short) iter->second));
-    sort(exclusionTilesVec.begin(), exclusionTilesVec.end(), context.getSIMDWidth() <= 32 ? compareUshort2 : compareUshort2LargeSIMD);
-    exclusionTiles = OpenCLArray::create<mm_ushort2>(context, exclusionTilesVec.size(), "exclusionTiles");
+        exclusionTilesVec.push_back(mm_int2(iter->first, iter->second));
+    sort(exclusionTilesVec.begin(), exclusionTilesVec.end(), context.getSIMDWidth() <= 32 ? compareInt2 : compareInt2LargeSIMD);
+    exclusionTiles = OpenCLArray::create<mm_int2>(context, exclusionTilesVec.size(), "exclusionTiles");
     exclusionTiles->upload(exclusionTilesVec);
     map<pair<int, int>, int> exclusionTileMap;
     for (int i = 0; i < (int) exclusionTilesVec.size(); i++) {
-        mm_ushort2 tile = exclusionTilesVec[i];
+        mm_int2 tile = exclusionTilesVec[i];
         exclusionTileMap[make_pair(tile.x, tile.y)] = i;
     }
     vector<vector<int> > exclusionBlocksForBlock(numAtomBlocks);
@@ -303,15 +310,25 @@ void OpenCLNonbondedUtilities::initialize(const System& system) {
     // Create data structures for the neighbor list.
 
     if (useCutoff) {
-        // Select a size for the arrays that hold the neighbor list.  We have to make a fairly
-        // arbitrary guess, but if this turns out to be too small we'll increase it later.
+        // Select a size for the arrays that hold the neighbor list.  For periodic systems the
+        // density is known, so we can estimate how many atoms are within the cutoff of each
+        // block and avoid allocating worst case storage for dilute systems.  If the estimate
+        // turns out to be too small, updateNeighborListSize() will grow the arrays and rebuild
+        // the list.
 
+        int numAtoms = context.getNumAtoms();
         int maxTiles = 20*numAtomBlocks;
+        if (usePeriodic) {
+            mm_double4 box = context.getPeriodicBoxSizeDouble();
+            double paddedCutoff = (usePadding ? 1.1 : 1.0)*getMaxCutoffDistance();
+            double atomsInSphere = (4.0/3.0)*M_PI*paddedCutoff*paddedCutoff*paddedCutoff*numAtoms/(box.x*box.y*box.z);
+            int tilesPerBlock = (int) ceil(2.0*atomsInSphere/OpenCLContext::TileSize);
+            maxTiles = min(maxTiles, numAtomBlocks*tilesPerBlock);
+        }
         if (maxTiles > numTiles)
             maxTiles = numTiles;
         if (maxTiles < 1)
             maxTiles = 1;
-        int numAtoms = context.getNumAtoms();
         interactingTiles = OpenCLArray::create<cl_int>(context, maxTiles, "interactingTiles");
         interactingAtoms = OpenCLArray::create<cl_int>(context, OpenCLContext::TileSize*maxTiles, "interactingAtoms");
         interactionCount = OpenCLArray::create<cl_uint>(context, 1, "interactionCount");
@@ -379,6 +396,10 @@ void OpenCLNonbondedUtilities::prepareInteractions(int forceGroups) {
     blockSorter->sort(*sortedBlocks);
     kernels.sortBoxDataKernel.setArg<cl_int>(9, forceRebuildNeighborList);
     context.executeKernel(kernels.sortBoxDataKernel, context.getNumAtoms());
+    // The rebuild flag is final as soon as sortBoxData has run, so download it right away.
+    // By the time computeInteractions() looks at it, this early part of the queue has
+    // usually finished and the host does not need to stall.
+    context.getQueue().enqueueReadBuffer(rebuildNeighborList->getDeviceBuffer(), CL_FALSE, 0, sizeof(int), pinnedRebuildMemory, NULL, &rebuildFlagEvent);
     setPeriodicBoxArgs(context, kernels.findInteractingBlocksKernel, 0);
     context.executeKernel(kernels.findInteractingBlocksKernel, context.getNumAtoms(), interactingBlocksThreadBlockSize);
     forceRebuildNeighborList = false;
@@ -399,8 +420,15 @@ void OpenCLNonbondedUtilities::computeInteractions(int forceGroups, bool include
         context.executeKernel(kernel, numForceThreadBlocks*forceThreadBlockSize, forceThreadBlockSize);
     }
     if (useCutoff && numTiles > 0) {
-        downloadCountEvent.wait();
-        updateNeighborListSize();
+        // The interaction count can only change on steps where the neighbor list was rebuilt,
+        // so the overflow check is skipped on all the others.  The rebuild flag was recorded
+        // much earlier in the queue than the count, so waiting for it stalls the pipeline
+        // far less than waiting for the full neighbor list build.
+        rebuildFlagEvent.wait();
+        if (pinnedRebuildMemory[0] != 0) {
+            downloadCountEvent.wait();
+            updateNeighborListSize();
+        }
     }
 }
 
@@ -485,14 +513,17 @@ void OpenCLNonbondedUtilities::setAtomBlockRange(double startFraction, double en
 }
 
 void OpenCLNonbondedUtilities::createKernelsForGroups(int groups) {
+    // All force groups share a single neighbor list built at the largest cutoff any of them
+    // uses.  Forces with a shorter cutoff apply their own distance test in the interaction
+    // kernel, and sharing the list means that alternating between groups with different
+    // cutoffs does not force it to be rebuilt.
+
     KernelSet kernels;
-    double cutoff = 0.0;
+    double cutoff = getMaxCutoffDistance();
     string source;
     for (int i = 0; i < 32; i++) {
-        if ((groups&(1<<i)) != 0) {
-            cutoff = max(cutoff, groupCutoff[i]);
+        if ((groups&(1<<i)) != 0)
             source += groupKernelSource[i];
-        }
     }
     kernels.hasForces = (source.size() > 0);
     kernels.cutoffDistance = cutoff;
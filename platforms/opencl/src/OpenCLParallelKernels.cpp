@@ -117,7 +117,8 @@ private:
 };
 
 OpenCLParallelCalcForcesAndEnergyKernel::OpenCLParallelCalcForcesAndEnergyKernel(string name, const Platform& platform, OpenCLPlatform::PlatformData& data) :
-        CalcForcesAndEnergyKernel(name, platform), data(data), completionTimes(data.contexts.size()), contextNonbondedFractions(data.contexts.size()),
+        CalcForcesAndEnergyKernel(name, platform), data(data), completionTimes(data.contexts.size()), contextActiveTimes(data.contexts.size(), 0),
+        contextNonbondedFractions(data.contexts.size()),
         tileCounts(data.contexts.size()), contextForces(NULL), pinnedPositionBuffer(NULL), pinnedPositionMemory(NULL), pinnedForceBuffer(NULL), pinnedForceMemory(NULL) {
     for (int i = 0; i < (int) data.contexts.size(); i++)
         kernels.push_back(Kernel(new OpenCLCalcForcesAndEnergyKernel(name, platform, *data.contexts[i])));
@@ -135,8 +136,10 @@ OpenCLParallelCalcForcesAndEnergyKernel::~OpenCLParallelCalcForcesAndEnergyKerne
 void OpenCLParallelCalcForcesAndEnergyKernel::initialize(const System& system) {
     for (int i = 0; i < (int) kernels.size(); i++)
         getKernel(i).initialize(system);
-    for (int i = 0; i < (int) contextNonbondedFractions.size(); i++)
+    for (int i = 0; i < (int) contextNonbondedFractions.size(); i++) {
         contextNonbondedFractions[i] = 1/(double) contextNonbondedFractions.size();
+        contextActiveTimes[i] = 0;
+    }
 }
 
 void OpenCLParallelCalcForcesAndEnergyKernel::beginComputation(ContextImpl& context, bool includeForce, bool includeEnergy, int groups) {
@@ -155,6 +158,7 @@ void OpenCLParallelCalcForcesAndEnergyKernel::beginComputation(ContextImpl& cont
     // Copy coordinates over to each device and execute the kernel.
     
     cl0.getQueue().enqueueReadBuffer(cl0.getPosq().getDeviceBuffer(), CL_TRUE, 0, cl0.getPaddedNumAtoms()*elementSize, pinnedPositionMemory);
+    stepStartTime = getTime();
     for (int i = 0; i < (int) data.contexts.size(); i++) {
         data.contextEnergy[i] = 0.0;
         OpenCLContext& cl = *data.contexts[i];
@@ -183,22 +187,25 @@ double OpenCLParallelCalcForcesAndEnergyKernel::finishComputation(ContextImpl& c
                 numAtoms*(data.contexts.size()-1)*elementSize, pinnedForceMemory);
         cl.reduceBuffer(*contextForces, data.contexts.size());
         
-        // Balance work between the contexts by transferring a little nonbonded work from the context that
-        // finished last to the one that finished first.
-        
-        if (cl.getComputeForceCount() < 200) {
-            int firstIndex = 0, lastIndex = 0;
-            for (int i = 0; i < (int) completionTimes.size(); i++) {
-                if (completionTimes[i] < completionTimes[firstIndex])
-                    firstIndex = i;
-                if (completionTimes[i] > completionTimes[lastIndex])
-                    lastIndex = i;
+        // Balance work between the contexts by periodically repartitioning the atom ranges in
+        // proportion to the measured speed of each device.  The speed estimates are averaged
+        // over the whole interval since the last repartition, so mixtures of very different
+        // devices converge to their true relative speeds and keep tracking them as the
+        // simulation runs.
+
+        for (int i = 0; i < (int) completionTimes.size(); i++)
+            contextActiveTimes[i] += completionTimes[i]-stepStartTime;
+        if (cl.getComputeForceCount()%250 == 25) { // Do the first repartition soon after startup.
+            double totalSpeed = 0.0;
+            vector<double> contextSpeeds(contextActiveTimes.size());
+            for (int i = 0; i < (int) contextActiveTimes.size(); i++) {
+                contextSpeeds[i] = contextNonbondedFractions[i]/max((long long) 1, contextActiveTimes[i]);
+                totalSpeed += contextSpeeds[i];
             }
-            double fractionToTransfer = min(0.001, contextNonbondedFractions[lastIndex]);
-            contextNonbondedFractions[firstIndex] += fractionToTransfer;
-            contextNonbondedFractions[lastIndex] -= fractionToTransfer;
             double startFraction = 0.0;
             for (int i = 0; i < (int) contextNonbondedFractions.size(); i++) {
+                contextNonbondedFractions[i] = contextSpeeds[i]/totalSpeed;
+                contextActiveTimes[i] = 0;
                 double endFraction = startFraction+contextNonbondedFractions[i];
                 if (i == contextNonbondedFractions.size()-1)
                     endFraction = 1.0; // Avoid roundoff error
@@ -574,9 +581,9 @@ double OpenCLParallelCalcNonbondedForceKernel::execute(ContextImpl& context, boo
     return 0.0;
 }
 
-void OpenCLParallelCalcNonbondedForceKernel::copyParametersToContext(ContextImpl& context, const NonbondedForce& force) {
+void OpenCLParallelCalcNonbondedForceKernel::copyParametersToContext(ContextImpl& context, const NonbondedForce& force, int firstParticle, int lastParticle, int firstException, int lastException) {
     for (int i = 0; i < (int) kernels.size(); i++)
-        getKernel(i).copyParametersToContext(context, force);
+        getKernel(i).copyParametersToContext(context, force, firstParticle, lastParticle, firstException, lastException);
 }
 
 void OpenCLParallelCalcNonbondedForceKernel::getPMEParameters(double& alpha, int& nx, int& ny, int& nz) const {
@@ -669,6 +676,11 @@ void OpenCLParallelCalcCustomExternalForceKernel::copyParametersToContext(Contex
         getKernel(i).copyParametersToContext(context, force);
 }
 
+void OpenCLParallelCalcCustomExternalForceKernel::copyParametersToContext(ContextImpl& context, const CustomExternalForce& force, const vector<int>& changedParticles) {
+    for (int i = 0; i < (int) kernels.size(); i++)
+        getKernel(i).copyParametersToContext(context, force, changedParticles);
+}
+
 class OpenCLParallelCalcCustomHbondForceKernel::Task : public OpenCLContext::WorkTask {
 public:
     Task(ContextImpl& context, OpenCLCalcCustomHbondForceKernel& kernel, bool includeForce,
@@ -176,6 +176,58 @@ void OpenCLParameterSet::setParameterValues(const vector<vector<T> >& values) {
     }
 }
 
+template <class T>
+void OpenCLParameterSet::setParameterValuesSubset(int first, const vector<vector<T> >& values) {
+    if (sizeof(T) != elementSize)
+        throw OpenMMException("Called setParameterValuesSubset() with vector of wrong type");
+    int numToSet = values.size();
+    if (first < 0 || first+numToSet > numObjects)
+        throw OpenMMException("Called setParameterValuesSubset() with an illegal range");
+    try {
+        int base = 0;
+        for (int i = 0; i < (int) buffers.size(); i++) {
+            if (buffers[i].getSize() == 4*elementSize) {
+                vector<T> data(4*numToSet);
+                for (int j = 0; j < numToSet; j++) {
+                    data[4*j] = values[j][base];
+                    if (base+1 < numParameters)
+                        data[4*j+1] = values[j][base+1];
+                    if (base+2 < numParameters)
+                        data[4*j+2] = values[j][base+2];
+                    if (base+3 < numParameters)
+                        data[4*j+3] = values[j][base+3];
+                }
+                context.getQueue().enqueueWriteBuffer(reinterpret_cast<cl::Buffer&>(buffers[i].getMemory()), CL_TRUE, first*buffers[i].getSize(), numToSet*buffers[i].getSize(), &data[0]);
+                base += 4;
+            }
+            else if (buffers[i].getSize() == 2*elementSize) {
+                vector<T> data(2*numToSet);
+                for (int j = 0; j < numToSet; j++) {
+                    data[2*j] = values[j][base];
+                    if (base+1 < numParameters)
+                        data[2*j+1] = values[j][base+1];
+                }
+                context.getQueue().enqueueWriteBuffer(reinterpret_cast<cl::Buffer&>(buffers[i].getMemory()), CL_TRUE, first*buffers[i].getSize(), numToSet*buffers[i].getSize(), &data[0]);
+                base += 2;
+            }
+            else if (buffers[i].getSize() == elementSize) {
+                vector<T> data(numToSet);
+                for (int j = 0; j < numToSet; j++)
+                    data[j] = values[j][base];
+                context.getQueue().enqueueWriteBuffer(reinterpret_cast<cl::Buffer&>(buffers[i].getMemory()), CL_TRUE, first*buffers[i].getSize(), numToSet*buffers[i].getSize(), &data[0]);
+                base++;
+            }
+            else
+                throw OpenMMException("Internal error: Unknown buffer type in OpenCLParameterSet");
+        }
+    }
+    catch (cl::Error err) {
+        stringstream str;
+        str<<"Error uploading parameter set "<<name<<": "<<err.what()<<" ("<<err.err()<<")";
+        throw OpenMMException(str.str());
+    }
+}
+
 string OpenCLParameterSet::getParameterSuffix(int index, const std::string& extraSuffix) const {
     const string suffixes[] = {".x", ".y", ".z", ".w"};
     int buffer = -1;
@@ -200,6 +252,8 @@ string OpenCLParameterSet::getParameterSuffix(int index, const std::string& extr
 namespace OpenMM {
 template OPENMM_EXPORT_OPENCL void OpenCLParameterSet::getParameterValues<float>(vector<vector<float> >& values) const;
 template OPENMM_EXPORT_OPENCL void OpenCLParameterSet::setParameterValues<float>(const vector<vector<float> >& values);
+template OPENMM_EXPORT_OPENCL void OpenCLParameterSet::setParameterValuesSubset<float>(int first, const vector<vector<float> >& values);
 template OPENMM_EXPORT_OPENCL void OpenCLParameterSet::getParameterValues<double>(vector<vector<double> >& values) const;
 template OPENMM_EXPORT_OPENCL void OpenCLParameterSet::setParameterValues<double>(const vector<vector<double> >& values);
+template OPENMM_EXPORT_OPENCL void OpenCLParameterSet::setParameterValuesSubset<double>(int first, const vector<vector<double> >& values);
 }
\ No newline at end of file
@@ -61,6 +61,7 @@ OpenCLPlatform::OpenCLPlatform() {
     deprecatedPropertyReplacements["OpenCLPrecision"] = OpenCLPrecision();
     deprecatedPropertyReplacements["OpenCLUseCpuPme"] = OpenCLUseCpuPme();
     deprecatedPropertyReplacements["OpenCLDisablePmeStream"] = OpenCLDisablePmeStream();
+    deprecatedPropertyReplacements["OpenCLDeterministicForces"] = OpenCLDeterministicForces();
     OpenCLKernelFactory* factory = new OpenCLKernelFactory();
     registerKernelFactory(CalcForcesAndEnergyKernel::Name(), factory);
     registerKernelFactory(UpdateStateDataKernel::Name(), factory);
@@ -99,14 +100,23 @@ OpenCLPlatform::OpenCLPlatform() {
     platformProperties.push_back(OpenCLPlatformName());
     platformProperties.push_back(OpenCLPrecision());
     platformProperties.push_back(OpenCLUseCpuPme());
+    platformProperties.push_back(OpenCLKernelCacheDirectory());
     platformProperties.push_back(OpenCLDisablePmeStream());
+    platformProperties.push_back(OpenCLDeterministicForces());
+    platformProperties.push_back(OpenCLProfilingFile());
+    platformProperties.push_back(OpenCLDeviceMemoryUsage());
     setPropertyDefaultValue(OpenCLDeviceIndex(), "");
     setPropertyDefaultValue(OpenCLDeviceName(), "");
     setPropertyDefaultValue(OpenCLPlatformIndex(), "");
     setPropertyDefaultValue(OpenCLPlatformName(), "");
     setPropertyDefaultValue(OpenCLPrecision(), "single");
     setPropertyDefaultValue(OpenCLUseCpuPme(), "false");
+    char* cachedir = getenv("OPENMM_CACHE_DIR");
+    setPropertyDefaultValue(OpenCLKernelCacheDirectory(), (cachedir == NULL ? "" : string(cachedir)));
     setPropertyDefaultValue(OpenCLDisablePmeStream(), "false");
+    setPropertyDefaultValue(OpenCLDeterministicForces(), "false");
+    setPropertyDefaultValue(OpenCLProfilingFile(), "");
+    setPropertyDefaultValue(OpenCLDeviceMemoryUsage(), "0");
 }
 
 double OpenCLPlatform::getSpeed() const {
@@ -148,6 +158,16 @@ const string& OpenCLPlatform::getPropertyValue(const Context& context, const str
     string propertyName = property;
     if (deprecatedPropertyReplacements.find(property) != deprecatedPropertyReplacements.end())
         propertyName = deprecatedPropertyReplacements.find(property)->second;
+    if (propertyName == OpenCLDeviceMemoryUsage()) {
+        // This is computed on demand, since it changes over the life of the Context.
+
+        size_t usage = 0;
+        for (OpenCLContext* c : data->contexts)
+            usage += c->getAllocatedDeviceMemory();
+        stringstream usageString;
+        usageString << usage;
+        const_cast<PlatformData*>(data)->propertyValues[propertyName] = usageString.str();
+    }
     map<string, string>::const_iterator value = data->propertyValues.find(propertyName);
     if (value != data->propertyValues.end())
         return value->second;
@@ -166,11 +186,18 @@ void OpenCLPlatform::contextCreated(ContextImpl& context, const map<string, stri
             getPropertyDefaultValue(OpenCLPrecision()) : properties.find(OpenCLPrecision())->second);
     string cpuPmePropValue = (properties.find(OpenCLUseCpuPme()) == properties.end() ?
             getPropertyDefaultValue(OpenCLUseCpuPme()) : properties.find(OpenCLUseCpuPme())->second);
+    const string& cachePropValue = (properties.find(OpenCLKernelCacheDirectory()) == properties.end() ?
+            getPropertyDefaultValue(OpenCLKernelCacheDirectory()) : properties.find(OpenCLKernelCacheDirectory())->second);
     string pmeStreamPropValue = (properties.find(OpenCLDisablePmeStream()) == properties.end() ?
             getPropertyDefaultValue(OpenCLDisablePmeStream()) : properties.find(OpenCLDisablePmeStream())->second);
+    string deterministicForcesValue = (properties.find(OpenCLDeterministicForces()) == properties.end() ?
+            getPropertyDefaultValue(OpenCLDeterministicForces()) : properties.find(OpenCLDeterministicForces())->second);
+    const string& profilingFileValue = (properties.find(OpenCLProfilingFile()) == properties.end() ?
+            getPropertyDefaultValue(OpenCLProfilingFile()) : properties.find(OpenCLProfilingFile())->second);
     transform(precisionPropValue.begin(), precisionPropValue.end(), precisionPropValue.begin(), ::tolower);
     transform(cpuPmePropValue.begin(), cpuPmePropValue.end(), cpuPmePropValue.begin(), ::tolower);
     transform(pmeStreamPropValue.begin(), pmeStreamPropValue.end(), pmeStreamPropValue.begin(), ::tolower);
+    transform(deterministicForcesValue.begin(), deterministicForcesValue.end(), deterministicForcesValue.begin(), ::tolower);
     vector<string> pmeKernelName;
     pmeKernelName.push_back(CalcPmeReciprocalForceKernel::Name());
     if (!supportsKernels(pmeKernelName))
@@ -179,7 +206,8 @@ void OpenCLPlatform::contextCreated(ContextImpl& context, const map<string, stri
     char* threadsEnv = getenv("OPENMM_CPU_THREADS");
     if (threadsEnv != NULL)
         stringstream(threadsEnv) >> threads;
-    context.setPlatformData(new PlatformData(context.getSystem(), platformPropValue, devicePropValue, precisionPropValue, cpuPmePropValue, pmeStreamPropValue, threads));
+    context.setPlatformData(new PlatformData(context.getSystem(), platformPropValue, devicePropValue, precisionPropValue, cpuPmePropValue,
+            cachePropValue, pmeStreamPropValue, deterministicForcesValue, profilingFileValue, threads));
 }
 
 void OpenCLPlatform::contextDestroyed(ContextImpl& context) const {
@@ -188,7 +216,8 @@ void OpenCLPlatform::contextDestroyed(ContextImpl& context) const {
 }
 
 OpenCLPlatform::PlatformData::PlatformData(const System& system, const string& platformPropValue, const string& deviceIndexProperty,
-        const string& precisionProperty, const string& cpuPmeProperty, const string& pmeStreamProperty, int numThreads) :
+        const string& precisionProperty, const string& cpuPmeProperty, const string& cacheProperty, const string& pmeStreamProperty,
+        const string& deterministicForcesProperty, const string& profilingFileProperty, int numThreads) :
             removeCM(false), stepCount(0), computeForceCount(0), time(0.0), hasInitializedContexts(false), threads(numThreads)  {
     int platformIndex = -1;
     if (platformPropValue.length() > 0)
@@ -205,11 +234,11 @@ OpenCLPlatform::PlatformData::PlatformData(const System& system, const string& p
             if (devices[i].length() > 0) {
                 int deviceIndex;
                 stringstream(devices[i]) >> deviceIndex;
-                contexts.push_back(new OpenCLContext(system, platformIndex, deviceIndex, precisionProperty, *this));
+                contexts.push_back(new OpenCLContext(system, platformIndex, deviceIndex, precisionProperty, cacheProperty, profilingFileProperty, *this));
             }
         }
         if (contexts.size() == 0)
-            contexts.push_back(new OpenCLContext(system, platformIndex, -1, precisionProperty, *this));
+            contexts.push_back(new OpenCLContext(system, platformIndex, -1, precisionProperty, cacheProperty, profilingFileProperty, *this));
     }
     catch (...) {
         // If an exception was thrown, do our best to clean up memory.
@@ -231,6 +260,7 @@ OpenCLPlatform::PlatformData::PlatformData(const System& system, const string& p
 
     useCpuPme = (cpuPmeProperty == "true" && !contexts[0]->getUseDoublePrecision());
     disablePmeStream = (pmeStreamProperty == "true");
+    deterministicForces = (deterministicForcesProperty == "true");
     propertyValues[OpenCLPlatform::OpenCLDeviceIndex()] = deviceIndex.str();
     propertyValues[OpenCLPlatform::OpenCLDeviceName()] = deviceName.str();
     propertyValues[OpenCLPlatform::OpenCLPlatformIndex()] = contexts[0]->intToString(platformIndex);
@@ -239,7 +269,10 @@ OpenCLPlatform::PlatformData::PlatformData(const System& system, const string& p
     propertyValues[OpenCLPlatform::OpenCLPlatformName()] = platforms[platformIndex].getInfo<CL_PLATFORM_NAME>();
     propertyValues[OpenCLPlatform::OpenCLPrecision()] = precisionProperty;
     propertyValues[OpenCLPlatform::OpenCLUseCpuPme()] = useCpuPme ? "true" : "false";
+    propertyValues[OpenCLPlatform::OpenCLKernelCacheDirectory()] = cacheProperty;
     propertyValues[OpenCLPlatform::OpenCLDisablePmeStream()] = disablePmeStream ? "true" : "false";
+    propertyValues[OpenCLPlatform::OpenCLDeterministicForces()] = deterministicForces ? "true" : "false";
+    propertyValues[OpenCLPlatform::OpenCLProfilingFile()] = profilingFileProperty;
     contextEnergy.resize(contexts.size());
 }
 
@@ -60,17 +60,17 @@ angleB = fmod(angleB+2.0f*PI, 2.0f*PI);
 
 int2 pos = MAP_POS[MAPS[index]];
 int size = pos.y;
-real delta = 2*PI/size;
-int s = (int) (angleA/delta);
-int t = (int) (angleB/delta);
+real rdelta = size/(2*PI);
+int s = (int) (angleA*rdelta);
+int t = (int) (angleB*rdelta);
 float4 c[4];
 int coeffIndex = pos.x+4*(s+size*t);
 c[0] = COEFF[coeffIndex];
 c[1] = COEFF[coeffIndex+1];
 c[2] = COEFF[coeffIndex+2];
 c[3] = COEFF[coeffIndex+3];
-real da = angleA/delta-s;
-real db = angleB/delta-t;
+real da = angleA*rdelta-s;
+real db = angleB*rdelta-t;
 
 // Evaluate the spline to determine the energy and gradients.
 
@@ -89,8 +89,8 @@ dEdB = da*dEdB + (3.0f*c[1].w*db + 2.0f*c[1].z)*db + c[1].y;
 torsionEnergy = da*torsionEnergy + ((c[0].w*db + c[0].z)*db + c[0].y)*db + c[0].x;
 dEdA = db*dEdA + (3.0f*c[3].x*da + 2.0f*c[2].x)*da + c[1].x;
 dEdB = da*dEdB + (3.0f*c[0].w*db + 2.0f*c[0].z)*db + c[0].y;
-dEdA /= delta;
-dEdB /= delta;
+dEdA *= rdelta;
+dEdB *= rdelta;
 energy += torsionEnergy;
 
 // Apply the force to the first torsion.
@@ -0,0 +1,10 @@
+/**
+ * Update global variables whose values can be computed entirely on the device,
+ * so they never need to be transferred to the host.
+ */
+__kernel void computeGlobals(__global mixed* restrict globals, __global const mixed2* restrict dt, const mixed energy, __global const mixed* restrict sum) {
+    if (get_global_id(0) == 0) {
+        mixed stepSize = dt[0].y;
+        COMPUTE_STEP
+    }
+}
@@ -3,19 +3,21 @@ real2 multofReal2(real2 a, real2 b) {
 }
 
 /**
- * Precompute the cosine and sine sums which appear in each force term.
+ * Precompute the cosine and sine sums which appear in each force term.  Each work group
+ * handles one wave vector at a time: the work items compute partial structure factors over
+ * disjoint subsets of the atoms, then combine them with a tree reduction.  This keeps the
+ * whole device busy even when the number of wave vectors is small compared to the number
+ * of atoms.
  */
 
-__kernel void calculateEwaldCosSinSums(__global mixed* restrict energyBuffer, __global const real4* restrict posq, __global real2* restrict cosSinSum, real4 reciprocalPeriodicBoxSize, real reciprocalCoefficient) {
+__kernel void calculateEwaldCosSinSums(__global mixed* restrict energyBuffer, __global const real4* restrict posq, __global real2* restrict cosSinSum, real4 reciprocalPeriodicBoxSize, real reciprocalCoefficient, __local real2* restrict sumBuffer) {
     const unsigned int ksizex = 2*KMAX_X-1;
     const unsigned int ksizey = 2*KMAX_Y-1;
     const unsigned int ksizez = 2*KMAX_Z-1;
     const unsigned int totalK = ksizex*ksizey*ksizez;
-    unsigned int index = get_global_id(0);
+    const unsigned int lowestK = (KMAX_Y-1)*ksizez+KMAX_Z;
     mixed energy = 0;
-    while (index < (KMAX_Y-1)*ksizez+KMAX_Z)
-        index += get_global_size(0);
-    while (index < totalK) {
+    for (unsigned int index = lowestK+get_group_id(0); index < totalK; index += get_num_groups(0)) {
         // Find the wave vector (kx, ky, kz) this index corresponds to.
 
         int rx = index/(ksizey*ksizez);
@@ -27,10 +29,10 @@ __kernel void calculateEwaldCosSinSums(__global mixed* restrict energyBuffer, __
         real ky = ry*reciprocalPeriodicBoxSize.y;
         real kz = rz*reciprocalPeriodicBoxSize.z;
 
-        // Compute the sum for this wave vector.
+        // Compute a partial sum over this work item's subset of the atoms.
 
         real2 sum = 0.0f;
-        for (int atom = 0; atom < NUM_ATOMS; atom++) {
+        for (int atom = get_local_id(0); atom < NUM_ATOMS; atom += get_local_size(0)) {
             real4 apos = posq[atom];
             real phase = apos.x*kx;
             real2 structureFactor = (real2) (cos(phase), sin(phase));
@@ -40,14 +42,26 @@ __kernel void calculateEwaldCosSinSums(__global mixed* restrict energyBuffer, __
             structureFactor = multofReal2(structureFactor, (real2) (cos(phase), sin(phase)));
             sum += apos.w*structureFactor;
         }
-        cosSinSum[index] = sum;
 
-        // Compute the contribution to the energy.
+        // Combine the partial sums with a tree reduction.
 
-        real k2 = kx*kx + ky*ky + kz*kz;
-        real ak = EXP(k2*EXP_COEFFICIENT) / k2;
-        energy += reciprocalCoefficient*ak*(sum.x*sum.x + sum.y*sum.y);
-        index += get_global_size(0);
+        sumBuffer[get_local_id(0)] = sum;
+        barrier(CLK_LOCAL_MEM_FENCE);
+        for (int step = get_local_size(0)/2; step > 0; step /= 2) {
+            if (get_local_id(0) < step)
+                sumBuffer[get_local_id(0)] += sumBuffer[get_local_id(0)+step];
+            barrier(CLK_LOCAL_MEM_FENCE);
+        }
+        if (get_local_id(0) == 0) {
+            sum = sumBuffer[0];
+            cosSinSum[index] = sum;
+
+            // Compute the contribution to the energy.
+
+            real k2 = kx*kx + ky*ky + kz*kz;
+            real ak = EXP(k2*EXP_COEFFICIENT) / k2;
+            energy += reciprocalCoefficient*ak*(sum.x*sum.x + sum.y*sum.y);
+        }
     }
     energyBuffer[get_global_id(0)] += energy;
 }
@@ -0,0 +1,89 @@
+enum {VelScale, NoiseScale, MaxParams};
+
+/**
+ * Perform the first step of LFMiddle Langevin integration: apply the full step
+ * velocity kick from the forces.
+ */
+
+__kernel void integrateLangevinMiddlePart1(__global mixed4* restrict velm, __global const real4* restrict force, __global const mixed2* restrict dt) {
+    mixed fscale = dt[0].y;
+    int index = get_global_id(0);
+    while (index < NUM_ATOMS) {
+        mixed4 velocity = velm[index];
+        if (velocity.w != 0.0) {
+            velocity.x += fscale*velocity.w*force[index].x;
+            velocity.y += fscale*velocity.w*force[index].y;
+            velocity.z += fscale*velocity.w*force[index].z;
+            velm[index] = velocity;
+        }
+        index += get_global_size(0);
+    }
+}
+
+/**
+ * Perform the second step of LFMiddle Langevin integration: a half step position
+ * update, the friction and random force, and another half step position update.
+ * The unconstrained position change is recorded in oldDelta so the velocities can
+ * be corrected after the constraints are applied.
+ */
+
+__kernel void integrateLangevinMiddlePart2(__global mixed4* restrict velm, __global mixed4* restrict posDelta, __global mixed4* restrict oldDelta,
+        __global const mixed* restrict paramBuffer, __global const mixed2* restrict dt, __global const float4* restrict random, unsigned int randomIndex) {
+    mixed vscale = paramBuffer[VelScale];
+    mixed noisescale = paramBuffer[NoiseScale];
+    mixed halfdt = 0.5f*dt[0].y;
+    int index = get_global_id(0);
+    randomIndex += index;
+    while (index < NUM_ATOMS) {
+        mixed4 velocity = velm[index];
+        if (velocity.w != 0.0) {
+            mixed4 delta = halfdt*velocity;
+            mixed sigma = noisescale*sqrt(velocity.w);
+            velocity.x = vscale*velocity.x + sigma*random[randomIndex].x;
+            velocity.y = vscale*velocity.y + sigma*random[randomIndex].y;
+            velocity.z = vscale*velocity.z + sigma*random[randomIndex].z;
+            velm[index] = velocity;
+            delta.xyz += halfdt*velocity.xyz;
+            delta.w = 0;
+            posDelta[index] = delta;
+            oldDelta[index] = delta;
+        }
+        randomIndex += get_global_size(0);
+        index += get_global_size(0);
+    }
+}
+
+/**
+ * Perform the third step of LFMiddle Langevin integration: correct the velocities
+ * for any position adjustment made by the constraints, then record the new positions.
+ */
+
+__kernel void integrateLangevinMiddlePart3(__global real4* restrict posq, __global real4* restrict posqCorrection, __global mixed4* restrict velm,
+        __global const mixed4* restrict posDelta, __global const mixed4* restrict oldDelta, __global const mixed2* restrict dt) {
+    mixed invStepSize = 1/dt[0].y;
+    int index = get_global_id(0);
+    while (index < NUM_ATOMS) {
+        mixed4 vel = velm[index];
+        if (vel.w != 0.0) {
+#ifdef USE_MIXED_PRECISION
+            real4 pos1 = posq[index];
+            real4 pos2 = posqCorrection[index];
+            mixed4 pos = (mixed4) (pos1.x+(mixed)pos2.x, pos1.y+(mixed)pos2.y, pos1.z+(mixed)pos2.z, pos1.w);
+#else
+            real4 pos = posq[index];
+#endif
+            mixed4 delta = posDelta[index];
+            mixed4 old = oldDelta[index];
+            pos.xyz += delta.xyz;
+            vel.xyz += invStepSize*(delta.xyz-old.xyz);
+#ifdef USE_MIXED_PRECISION
+            posq[index] = convert_real4(pos);
+            posqCorrection[index] = (real4) (pos.x-(real) pos.x, pos.y-(real) pos.y, pos.z-(real) pos.z, 0);
+#else
+            posq[index] = pos;
+#endif
+            velm[index] = vel;
+        }
+        index += get_global_size(0);
+    }
+}
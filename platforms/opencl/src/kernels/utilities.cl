@@ -81,6 +81,29 @@ __kernel void reduceReal4Buffer(__global real4* restrict buffer, int bufferSize,
     }
 }
 
+/**
+ * Sum the energy buffer with a tree reduction.  Each work group sums a strided subset of
+ * the buffer and records the result in a separate element of result.  Invoking this a
+ * second time with a single work group then combines the partial sums into the total,
+ * which stays resident on the device.
+ */
+
+__kernel void reduceEnergyBuffer(__global const mixed* restrict buffer, __global mixed* restrict result, int bufferSize) {
+    __local mixed tempBuffer[WORK_GROUP_SIZE];
+    const unsigned int thread = get_local_id(0);
+    mixed sum = 0;
+    for (unsigned int index = get_global_id(0); index < bufferSize; index += get_global_size(0))
+        sum += buffer[index];
+    tempBuffer[thread] = sum;
+    for (int i = 1; i < WORK_GROUP_SIZE; i *= 2) {
+        barrier(CLK_LOCAL_MEM_FENCE);
+        if (thread%(i*2) == 0 && thread+i < WORK_GROUP_SIZE)
+            tempBuffer[thread] += tempBuffer[thread+i];
+    }
+    if (thread == 0)
+        result[get_group_id(0)] = tempBuffer[0];
+}
+
 #ifdef SUPPORTS_64_BIT_ATOMICS
 /**
  * Sum the various buffers containing forces.
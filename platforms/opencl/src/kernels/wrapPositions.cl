@@ -0,0 +1,37 @@
+/**
+ * Translate each molecule so its center lies inside the first periodic box, storing the
+ * result in a separate array so the simulation state is left untouched.  The positions in
+ * posq were last translated as whole molecules, so any reordering offsets they contain are
+ * uniform within a molecule and cancel out of the wrapped result.
+ */
+
+__kernel void wrapMolecules(int numMolecules, real4 periodicBoxSize, real4 invPeriodicBoxSize,
+        real4 periodicBoxVecX, real4 periodicBoxVecY, real4 periodicBoxVecZ, __global const real4* restrict posq,
+        __global real4* restrict wrappedPosq, __global const int* restrict moleculeAtoms, __global const int* restrict moleculeStartIndex) {
+    for (int index = get_global_id(0); index < numMolecules; index += get_global_size(0)) {
+        int first = moleculeStartIndex[index];
+        int last = moleculeStartIndex[index+1];
+        int numAtoms = last-first;
+
+        // Find the center of each molecule.
+
+        real3 center = (real3) 0;
+        for (int atom = first; atom < last; atom++)
+            center += posq[moleculeAtoms[atom]].xyz;
+        center /= (real) numAtoms;
+
+        // Find the displacement that moves it into the first periodic box.
+
+        real3 oldCenter = center;
+        APPLY_PERIODIC_TO_POS(center)
+        real3 delta = oldCenter-center;
+
+        // Translate all the particles in the molecule.
+
+        for (int atom = first; atom < last; atom++) {
+            real4 pos = posq[moleculeAtoms[atom]];
+            pos.xyz -= delta;
+            wrappedPosq[moleculeAtoms[atom]] = pos;
+        }
+    }
+}
@@ -54,7 +54,7 @@ template <class Real2>
 void testTransform(bool realToComplex, int xsize, int ysize, int zsize) {
     System system;
     system.addParticle(0.0);
-    OpenCLPlatform::PlatformData platformData(system, "", "", platform.getPropertyDefaultValue("OpenCLPrecision"), "false", "false", 1);
+    OpenCLPlatform::PlatformData platformData(system, "", "", platform.getPropertyDefaultValue("OpenCLPrecision"), "false", platform.getPropertyDefaultValue(OpenCLPlatform::OpenCLKernelCacheDirectory()), "false", 1);
     OpenCLContext& context = *platformData.contexts[0];
     context.initialize();
     OpenMM_SFMT::SFMT sfmt;
@@ -118,6 +118,9 @@ int main(int argc, char* argv[]) {
             testTransform<mm_double2>(true, 25, 28, 25);
             testTransform<mm_double2>(true, 25, 25, 28);
             testTransform<mm_double2>(true, 21, 25, 27);
+            testTransform<mm_double2>(true, 22, 25, 25);
+            testTransform<mm_double2>(true, 25, 33, 25);
+            testTransform<mm_double2>(true, 25, 25, 121);
         }
         else {
             testTransform<mm_float2>(false, 28, 25, 30);
@@ -125,6 +128,9 @@ int main(int argc, char* argv[]) {
             testTransform<mm_float2>(true, 25, 28, 25);
             testTransform<mm_float2>(true, 25, 25, 28);
             testTransform<mm_float2>(true, 21, 25, 27);
+            testTransform<mm_float2>(true, 22, 25, 25);
+            testTransform<mm_float2>(true, 25, 33, 25);
+            testTransform<mm_float2>(true, 25, 25, 121);
         }
     }
     catch(const exception& e) {
@@ -35,7 +35,8 @@ class ReferenceCMAPTorsionIxn : public ReferenceBondIxn {
 
 private:
 
-    std::vector<std::vector<std::vector<double> > > coeff;
+    std::vector<std::vector<double> > coeff;
+    std::vector<int> mapSizes;
     std::vector<int> torsionMaps;
     std::vector<std::vector<int> > torsionIndices;
     bool usePeriodic;
@@ -45,15 +46,16 @@ private:
 
        Calculate the interaction due to a single torsion pair
 
-       @param index            the index of the torsion
+       @param map              the map to use for the torsion
+       @param indices          the indices of the eight atoms forming the two dihedrals
        @param atomCoordinates  atom coordinates
        @param forces           force array (forces added)
        @param totalEnergy      total energy
 
          --------------------------------------------------------------------------------------- */
 
-    void calculateOneIxn(int index, std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<OpenMM::Vec3>& forces,
-                         double* totalEnergy) const;
+    void calculateOneIxn(int map, const int* indices, std::vector<OpenMM::Vec3>& atomCoordinates,
+                         std::vector<OpenMM::Vec3>& forces, double* totalEnergy) const;
 
 public:
 
@@ -91,7 +93,9 @@ public:
 
     /**---------------------------------------------------------------------------------------
 
-       This is present only because we must define it to subclass ReferenceBondIxn.  It is never called.
+       Calculate the interaction due to a single torsion pair.  This form is used by the CPU
+       platform, which parallelizes the torsions with CpuBondForce.  The map to use is passed
+       in parameters[0].
 
        --------------------------------------------------------------------------------------- */
 
@@ -40,7 +40,9 @@ namespace OpenMM {
 /**
  * This class uses multiple algorithms to apply constraints as efficiently as possible.  It identifies clusters
  * of three atoms that can be handled by SETTLE, and creates a ReferenceSETTLEAlgorithm object to handle them.
- * It then creates a ReferenceCCMAAlgorithm object to handle any remaining constraints.
+ * It next identifies clusters of a central atom connected to a few otherwise unconstrained atoms, such as
+ * X-H_n groups, and creates a ReferenceSHAKEAlgorithm object to handle them.  It then creates a
+ * ReferenceCCMAAlgorithm object to handle any remaining constraints.
  */
 class OPENMM_EXPORT ReferenceConstraints : public ReferenceConstraintAlgorithm {
 public:
@@ -68,6 +70,7 @@ public:
     void applyToVelocities(std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<OpenMM::Vec3>& velocities, std::vector<double>& inverseMasses, double tolerance);
     ReferenceConstraintAlgorithm* ccma;
     ReferenceConstraintAlgorithm* settle;
+    ReferenceConstraintAlgorithm* shake;
 };
 
 } // namespace OpenMM
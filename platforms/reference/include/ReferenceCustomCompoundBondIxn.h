@@ -50,25 +50,11 @@ class ReferenceCustomCompoundBondIxn : public ReferenceBondIxn {
       std::vector<DistanceTermInfo> distanceTerms;
       std::vector<AngleTermInfo> angleTerms;
       std::vector<DihedralTermInfo> dihedralTerms;
+      std::vector<double> energyParamDerivValues;
       int numParameters;
       bool usePeriodic;
       Vec3 boxVectors[3];
 
-
-      /**---------------------------------------------------------------------------------------
-
-         Calculate custom interaction for one bond
-
-         @param bond             the index of the bond
-         @param atomCoordinates  atom coordinates
-         @param forces           force array (forces added)
-         @param totalEnergy      total energy
-
-         --------------------------------------------------------------------------------------- */
-
-      void calculateOneIxn(int bond, std::vector<OpenMM::Vec3>& atomCoordinates,
-                           std::vector<OpenMM::Vec3>& forces, double* totalEnergy, double* energyParamDerivs);
-
       void computeDelta(int atom1, int atom2, double* delta, std::vector<OpenMM::Vec3>& atomCoordinates) const;
 
       static double computeAngle(double* vec1, double* vec2);
@@ -131,6 +117,48 @@ class ReferenceCustomCompoundBondIxn : public ReferenceBondIxn {
                             const std::map<std::string, double>& globalParameters,
                             std::vector<OpenMM::Vec3>& forces, double* totalEnergy, double* energyParamDerivs);
 
+      /**---------------------------------------------------------------------------------------
+
+         Set the values of global parameters, and clear the accumulated energy parameter
+         derivatives.  Call this before computing individual bonds with calculateBondIxn().
+
+         @param globalParameters   the values of global parameters
+
+         --------------------------------------------------------------------------------------- */
+
+      void setGlobalParameters(const std::map<std::string, double>& globalParameters);
+
+      /**---------------------------------------------------------------------------------------
+
+         Calculate custom interaction for one bond
+
+         @param atomIndices        the indices of the atoms in the bond
+         @param atomCoordinates    atom coordinates
+         @param parameters         bond parameter values
+         @param forces             force array (forces added)
+         @param totalEnergy        total energy
+         @param energyParamDerivs  derivatives of the energy with respect to global parameters
+                                   are added to this if it is not null; otherwise they are
+                                   accumulated internally and can be retrieved with
+                                   getEnergyParamDerivs()
+
+         --------------------------------------------------------------------------------------- */
+
+      void calculateBondIxn(int* atomIndices, std::vector<OpenMM::Vec3>& atomCoordinates,
+                            double* parameters, std::vector<OpenMM::Vec3>& forces,
+                            double* totalEnergy, double* energyParamDerivs);
+
+      /**---------------------------------------------------------------------------------------
+
+         Get the energy parameter derivatives accumulated since the last call to
+         setGlobalParameters().
+
+         --------------------------------------------------------------------------------------- */
+
+      const std::vector<double>& getEnergyParamDerivs() const {
+          return energyParamDerivValues;
+      }
+
 // ---------------------------------------------------------------------------------------
 
 };
@@ -26,6 +26,7 @@
 #define __ReferenceDynamics_H__
 
 #include "ReferenceConstraintAlgorithm.h"
+#include "ReferenceVirtualSites.h"
 #include "openmm/System.h"
 #include <cstddef>
 #include <vector>
@@ -54,7 +55,8 @@ class OPENMM_EXPORT ReferenceDynamics {
 
       int _ownReferenceConstraint;
       ReferenceConstraintAlgorithm* _referenceConstraint;
-      
+      const ReferenceVirtualSites* _virtualSites;
+
    public:
 
       /**---------------------------------------------------------------------------------------
@@ -170,6 +172,26 @@ class OPENMM_EXPORT ReferenceDynamics {
          --------------------------------------------------------------------------------------- */
       
       void setReferenceConstraintAlgorithm(ReferenceConstraintAlgorithm* referenceConstraint);
+
+      /**---------------------------------------------------------------------------------------
+
+         Get the ReferenceVirtualSites used for updating virtual site positions
+
+         @return virtualSites  object, or NULL if none has been set
+
+         --------------------------------------------------------------------------------------- */
+
+      const ReferenceVirtualSites* getVirtualSites() const;
+
+      /**---------------------------------------------------------------------------------------
+
+         Set the ReferenceVirtualSites used for updating virtual site positions
+
+         @param virtualSites  virtualSites object
+
+         --------------------------------------------------------------------------------------- */
+
+      void setVirtualSites(const ReferenceVirtualSites* virtualSites);
 };
 
 } // namespace OpenMM
@@ -34,10 +34,13 @@
 
 #include "ReferencePlatform.h"
 #include "openmm/kernels.h"
+#include "openmm/internal/CustomNonbondedForceImpl.h"
+#include "openmm/internal/NonbondedForceImpl.h"
 #include "SimTKOpenMMRealType.h"
 #include "ReferenceNeighborList.h"
 #include "lepton/CompiledExpression.h"
 #include "lepton/CustomFunction.h"
+#include "lepton/ExpressionProgram.h"
 
 namespace OpenMM {
 
@@ -49,6 +52,7 @@ class ReferenceCustomHbondIxn;
 class ReferenceCustomManyParticleIxn;
 class ReferenceGayBerneForce;
 class ReferenceBrownianDynamics;
+class ReferenceLangevinMiddleDynamics;
 class ReferenceStochasticDynamics;
 class ReferenceConstraintAlgorithm;
 class ReferenceMonteCarloBarostat;
@@ -591,10 +595,14 @@ public:
     /**
      * Copy changed parameters over to a context.
      *
-     * @param context    the context to copy parameters to
-     * @param force      the NonbondedForce to copy the parameters from
+     * @param context        the context to copy parameters to
+     * @param force          the NonbondedForce to copy the parameters from
+     * @param firstParticle  the index of the first particle whose parameters might have changed
+     * @param lastParticle   the index of the last particle whose parameters might have changed
+     * @param firstException the index of the first exception whose parameters might have changed
+     * @param lastException  the index of the last exception whose parameters might have changed
      */
-    void copyParametersToContext(ContextImpl& context, const NonbondedForce& force);
+    void copyParametersToContext(ContextImpl& context, const NonbondedForce& force, int firstParticle, int lastParticle, int firstException, int lastException);
     /**
      * Get the parameters being used for PME.
      * 
@@ -618,6 +626,7 @@ private:
     int **bonded14IndexArray;
     double **particleParamArray, **bonded14ParamArray;
     double nonbondedCutoff, switchingDistance, rfDielectric, ewaldAlpha, ewaldDispersionAlpha, dispersionCoefficient;
+    NonbondedForceImpl::LongRangeCorrectionData longRangeCorrectionData;
     int kmax[3], gridSize[3], dispersionGridSize[3];
     bool useSwitchingFunction;
     std::vector<std::set<int> > exclusions;
@@ -669,6 +678,7 @@ private:
     std::vector<std::string> parameterNames, globalParameterNames, energyParamDerivNames;
     std::vector<std::pair<std::set<int>, std::set<int> > > interactionGroups;
     std::vector<double> longRangeCoefficientDerivs;
+    CustomNonbondedForceImpl::LongRangeCorrectionData longRangeCorrectionData;
     NonbondedMethod nonbondedMethod;
     NeighborList* neighborList;
 };
@@ -793,6 +803,14 @@ public:
      * @param force      the CustomExternalForce to copy the parameters from
      */
     void copyParametersToContext(ContextImpl& context, const CustomExternalForce& force);
+    /**
+     * Copy changed parameters for a subset of particles over to a context.
+     *
+     * @param context           the context to copy parameters to
+     * @param force             the CustomExternalForce to copy the parameters from
+     * @param changedParticles  the indices within the force of the particle terms whose parameters have changed
+     */
+    void copyParametersToContext(ContextImpl& context, const CustomExternalForce& force, const std::vector<int>& changedParticles);
 private:
     class PeriodicDistanceFunction;
     int numParticles;
@@ -932,6 +950,44 @@ private:
     bool usePeriodic;
 };
 
+/**
+ * This kernel is invoked by CustomCVForce to calculate the forces acting on the system and the energy of the system.
+ */
+class ReferenceCalcCustomCVForceKernel : public CalcCustomCVForceKernel {
+public:
+    ReferenceCalcCustomCVForceKernel(std::string name, const Platform& platform) : CalcCustomCVForceKernel(name, platform) {
+    }
+    /**
+     * Initialize the kernel.
+     *
+     * @param system        the System this kernel will be applied to
+     * @param force         the CustomCVForce this kernel will be used for
+     * @param innerContext  the context created by the CustomCVForce for computing collective variables
+     */
+    void initialize(const System& system, const CustomCVForce& force, ContextImpl& innerContext);
+    /**
+     * Execute the kernel to calculate the forces and/or energy.
+     *
+     * @param context        the context in which to execute this kernel
+     * @param innerContext   the context created by the CustomCVForce for computing collective variables
+     * @param includeForces  true if forces should be calculated
+     * @param includeEnergy  true if the energy should be calculated
+     * @return the potential energy due to the force
+     */
+    double execute(ContextImpl& context, ContextImpl& innerContext, bool includeForces, bool includeEnergy);
+    /**
+     * Copy state information to the inner context.
+     *
+     * @param context        the context in which to execute this kernel
+     * @param innerContext   the context created by the CustomCVForce for computing collective variables
+     */
+    void copyState(ContextImpl& context, ContextImpl& innerContext);
+private:
+    Lepton::ExpressionProgram energyExpression;
+    std::vector<Lepton::ExpressionProgram> variableDerivExpressions;
+    std::vector<std::string> variableNames, globalParameterNames;
+};
+
 /**
  * This kernel is invoked by CustomManyParticleForce to calculate the forces acting on the system and the energy of the system.
  */
@@ -1080,6 +1136,43 @@ private:
     double prevTemp, prevFriction, prevStepSize;
 };
 
+/**
+ * This kernel is invoked by LangevinMiddleIntegrator to take one time step.
+ */
+class ReferenceIntegrateLangevinMiddleStepKernel : public IntegrateLangevinMiddleStepKernel {
+public:
+    ReferenceIntegrateLangevinMiddleStepKernel(std::string name, const Platform& platform, ReferencePlatform::PlatformData& data) : IntegrateLangevinMiddleStepKernel(name, platform),
+        data(data), dynamics(0) {
+    }
+    ~ReferenceIntegrateLangevinMiddleStepKernel();
+    /**
+     * Initialize the kernel, setting up the particle masses.
+     *
+     * @param system     the System this kernel will be applied to
+     * @param integrator the LangevinMiddleIntegrator this kernel will be used for
+     */
+    void initialize(const System& system, const LangevinMiddleIntegrator& integrator);
+    /**
+     * Execute the kernel.
+     *
+     * @param context    the context in which to execute this kernel
+     * @param integrator the LangevinMiddleIntegrator this kernel is being used for
+     */
+    void execute(ContextImpl& context, const LangevinMiddleIntegrator& integrator);
+    /**
+     * Compute the kinetic energy.
+     *
+     * @param context    the context in which to execute this kernel
+     * @param integrator the LangevinMiddleIntegrator this kernel is being used for
+     */
+    double computeKineticEnergy(ContextImpl& context, const LangevinMiddleIntegrator& integrator);
+private:
+    ReferencePlatform::PlatformData& data;
+    ReferenceLangevinMiddleDynamics* dynamics;
+    std::vector<double> masses;
+    double prevTemp, prevFriction, prevStepSize;
+};
+
 /**
  * This kernel is invoked by BrownianIntegrator to take one time step.
  */
@@ -1359,6 +1452,9 @@ public:
 private:
     ReferencePlatform::PlatformData& data;
     std::vector<double> masses;
+    double totalMass;
+    Vec3 cmVelocity;
+    bool hasMeasuredMomentum;
     int frequency;
 };
 
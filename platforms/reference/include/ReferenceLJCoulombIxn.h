@@ -27,18 +27,20 @@
 
 #include "ReferencePairIxn.h"
 #include "ReferenceNeighborList.h"
+#include "openmm/internal/ThreadPool.h"
 
 namespace OpenMM {
 
 class ReferenceLJCoulombIxn {
 
    private:
-       
+
       bool cutoff;
       bool useSwitch;
       bool periodic;
       bool ewald;
       bool pme, ljpme;
+      ThreadPool* threads;
       const OpenMM::NeighborList* neighborList;
       OpenMM::Vec3 periodicBoxVectors[3];
       double cutoffDistance, switchingDistance;
@@ -160,6 +162,17 @@ class ReferenceLJCoulombIxn {
 
       void setUseLJPME(double dalpha, int dmeshSize[3]);
 
+      /**---------------------------------------------------------------------------------------
+
+         Set a thread pool with which to parallelize the direct space calculation.  If this is
+         not called, everything is computed on a single thread.
+
+         @param threads    the thread pool to use
+
+         --------------------------------------------------------------------------------------- */
+
+      void setThreadPool(ThreadPool* threads);
+
       /**---------------------------------------------------------------------------------------
       
          Calculate LJ Coulomb pair ixn
@@ -206,6 +219,24 @@ private:
                             double** atomParameters, std::vector<std::set<int> >& exclusions,
                             double* fixedParameters, std::vector<OpenMM::Vec3>& forces,
                             double* energyByAtom, double* totalEnergy, bool includeDirect, bool includeReciprocal) const;
+
+      /**---------------------------------------------------------------------------------------
+
+         Calculate the short range part of the Ewald ixn for a range of neighbor list entries.
+
+         @param start            the index of the first neighbor list entry to process
+         @param end              the index of the first neighbor list entry not to process
+         @param atomCoordinates  atom coordinates
+         @param atomParameters   atom parameters (charges, c6, c12, ...)     atomParameters[atomIndex][paramterIndex]
+         @param forces           force array (forces added)
+         @param energyByAtom     atom energy
+
+         @return the direct space energy of the processed entries
+
+         --------------------------------------------------------------------------------------- */
+
+      double calculateEwaldShortRange(int start, int end, std::vector<OpenMM::Vec3>& atomCoordinates,
+                            double** atomParameters, std::vector<OpenMM::Vec3>& forces, double* energyByAtom) const;
 };
 
 } // namespace OpenMM
@@ -44,6 +44,20 @@ void OPENMM_EXPORT computeNeighborListVoxelHash(
                               bool reportSymmetricPairs = false
                             );
 
+// O(n) method for finding all pairs between two distinct sets of locations
+// that are within a cutoff of each other, using the voxel hash data structure.
+// Each reported pair contains an index into the first list followed by an
+// index into the second list.  Parameter neighborList is automatically
+// clear()ed before neighbors are added.
+void OPENMM_EXPORT computeBipartiteNeighborListVoxelHash(
+                              NeighborList& neighborList,
+                              const AtomLocationList& locations1,
+                              const AtomLocationList& locations2,
+                              const Vec3* periodicBoxVectors,
+                              bool usePeriodic,
+                              double maxDistance
+                            );
+
 } // namespace OpenMM
 
 #endif // OPENMM_REFERENCE_NEIGHBORLIST_H_
@@ -35,6 +35,8 @@
 #include "openmm/Platform.h"
 #include "openmm/System.h"
 #include "openmm/internal/windowsExport.h"
+#include <map>
+#include <string>
 
 namespace OpenMM {
 
@@ -51,16 +53,26 @@ public:
         return name;
     }
     double getSpeed() const;
+    const std::string& getPropertyValue(const Context& context, const std::string& property) const;
     bool supportsDoublePrecision() const;
     void contextCreated(ContextImpl& context, const std::map<std::string, std::string>& properties) const;
     void contextDestroyed(ContextImpl& context) const;
+    /**
+     * This is the name of the parameter for selecting the number of threads to use.  The
+     * default is 1, so that every calculation runs on a single thread and is easy to debug.
+     */
+    static const std::string& ReferenceThreads() {
+        static const std::string key = "Threads";
+        return key;
+    }
 };
 
 class OPENMM_EXPORT ReferencePlatform::PlatformData {
 public:
-    PlatformData(const System& system);
+    PlatformData(const System& system, int numThreads = 1);
     ~PlatformData();
     int numParticles, stepCount;
+    int numThreads;
     double time;
     void* positions;
     void* velocities;
@@ -68,7 +80,10 @@ public:
     void* periodicBoxSize;
     void* periodicBoxVectors;
     void* constraints;
+    void* virtualSites;
     void* energyParameterDerivatives;
+    void* threadPool;
+    std::map<std::string, std::string> propertyValues;
 };
 } // namespace OpenMM
 
@@ -0,0 +1,96 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2013 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#ifndef __ReferenceSHAKEAlgorithm_H__
+#define __ReferenceSHAKEAlgorithm_H__
+
+#include "ReferenceConstraintAlgorithm.h"
+#include <vector>
+
+namespace OpenMM {
+
+/**
+ * This implements the SHAKE algorithm for small clusters consisting of a central atom
+ * connected to up to three peripheral atoms, such as the hydrogens of a methyl group.
+ * Because each cluster is independent of every other one, the iteration is local to a
+ * handful of atoms and converges much faster than applying a global algorithm like CCMA
+ * to the same constraints.
+ */
+
+class OPENMM_EXPORT ReferenceSHAKEAlgorithm : public ReferenceConstraintAlgorithm {
+public:
+    /**
+     * Create a ReferenceSHAKEAlgorithm.
+     *
+     * @param centralAtom      the index of the central atom of each cluster
+     * @param peripheralAtom   the indices of the peripheral atoms of each cluster, or -1 for
+     *                         entries beyond the size of the cluster.  The outer index is the
+     *                         cluster, and the inner index (0-2) is the peripheral atom.
+     * @param distance         the constrained distance between the central atom and each
+     *                         peripheral atom
+     */
+    ReferenceSHAKEAlgorithm(const std::vector<int>& centralAtom, const std::vector<std::vector<int> >& peripheralAtom,
+            const std::vector<std::vector<double> >& distance);
+
+    /**
+     * Get the number of clusters.
+     */
+    int getNumClusters() const;
+
+    /**
+     * Apply the constraint algorithm.
+     *
+     * @param atomCoordinates  the original atom coordinates
+     * @param atomCoordinatesP the new atom coordinates
+     * @param inverseMasses    1/mass
+     * @param tolerance        the constraint tolerance
+     */
+    void apply(std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<OpenMM::Vec3>& atomCoordinatesP, std::vector<double>& inverseMasses, double tolerance);
+
+    /**
+     * Apply the constraint algorithm to velocities.
+     *
+     * @param atomCoordinates  the atom coordinates
+     * @param atomCoordinatesP the velocities to modify
+     * @param inverseMasses    1/mass
+     * @param tolerance        the constraint tolerance
+     */
+    void applyToVelocities(std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<OpenMM::Vec3>& velocities, std::vector<double>& inverseMasses, double tolerance);
+
+private:
+    std::vector<int> centralAtom;
+    std::vector<std::vector<int> > peripheralAtom;
+    std::vector<std::vector<double> > distance;
+};
+
+} // namespace OpenMM
+
+#endif // __ReferenceSHAKEAlgorithm_H__
@@ -38,16 +38,47 @@
 
 namespace OpenMM {
 
+/**
+ * This class computes the positions of virtual sites and distributes the forces applied
+ * to them.  The constructor sorts the sites by type, so that each call consists of a few
+ * tight loops over homogeneous arrays instead of dispatching on the type of every site.
+ */
 class OPENMM_EXPORT ReferenceVirtualSites {
 public:
+    /**
+     * Create a ReferenceVirtualSites, recording the parameters of every virtual site
+     * in the System grouped by type.
+     */
+    ReferenceVirtualSites(const OpenMM::System& system);
     /**
      * Compute the positions of all virtual sites.
      */
-    static void computePositions(const OpenMM::System& system, std::vector<OpenMM::Vec3>& atomCoordinates);
+    void computePositions(std::vector<OpenMM::Vec3>& atomCoordinates) const;
     /**
      * Distribute forces from virtual sites to the atoms they are based on.
      */
-    static void distributeForces(const OpenMM::System& system, const std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<OpenMM::Vec3>& forces);
+    void distributeForces(const std::vector<OpenMM::Vec3>& atomCoordinates, std::vector<OpenMM::Vec3>& forces) const;
+private:
+    struct TwoParticleAverage {
+        int site, p1, p2;
+        double w1, w2;
+    };
+    struct ThreeParticleAverage {
+        int site, p1, p2, p3;
+        double w1, w2, w3;
+    };
+    struct OutOfPlane {
+        int site, p1, p2, p3;
+        double w12, w13, wcross;
+    };
+    struct LocalCoordinates {
+        int site, p1, p2, p3;
+        Vec3 originWeights, xWeights, yWeights, localPosition;
+    };
+    std::vector<TwoParticleAverage> twoParticleAverageSites;
+    std::vector<ThreeParticleAverage> threeParticleAverageSites;
+    std::vector<OutOfPlane> outOfPlaneSites;
+    std::vector<LocalCoordinates> localCoordinatesSites;
 };
 
 } // namespace OpenMM
@@ -52,6 +52,7 @@
 #include "ReferenceGayBerneForce.h"
 #include "ReferenceHarmonicBondIxn.h"
 #include "ReferenceLJCoulomb14.h"
+#include "ReferenceLangevinMiddleDynamics.h"
 #include "ReferenceLJCoulombIxn.h"
 #include "ReferenceMonteCarloBarostat.h"
 #include "ReferenceProperDihedralBond.h"
@@ -73,6 +74,7 @@
 #include "openmm/internal/CustomNonbondedForceImpl.h"
 #include "openmm/internal/CMAPTorsionForceImpl.h"
 #include "openmm/internal/NonbondedForceImpl.h"
+#include "openmm/internal/ThreadPool.h"
 #include "openmm/Integrator.h"
 #include "openmm/OpenMMException.h"
 #include "SimTKOpenMMUtilities.h"
@@ -147,11 +149,25 @@ static ReferenceConstraints& extractConstraints(ContextImpl& context) {
     return *(ReferenceConstraints*) data->constraints;
 }
 
+static const ReferenceVirtualSites& extractVirtualSites(ContextImpl& context) {
+    ReferencePlatform::PlatformData* data = reinterpret_cast<ReferencePlatform::PlatformData*>(context.getPlatformData());
+    return *(ReferenceVirtualSites*) data->virtualSites;
+}
+
 static map<string, double>& extractEnergyParameterDerivatives(ContextImpl& context) {
     ReferencePlatform::PlatformData* data = reinterpret_cast<ReferencePlatform::PlatformData*>(context.getPlatformData());
     return *((map<string, double>*) data->energyParameterDerivatives);
 }
 
+static ThreadPool* extractThreadPool(ContextImpl& context) {
+    ReferencePlatform::PlatformData* data = reinterpret_cast<ReferencePlatform::PlatformData*>(context.getPlatformData());
+    if (data->numThreads < 2)
+        return NULL;
+    if (data->threadPool == NULL)
+        data->threadPool = new ThreadPool(data->numThreads);
+    return (ThreadPool*) data->threadPool;
+}
+
 /**
  * Make sure an expression doesn't use any undefined variables.
  */
@@ -222,7 +238,7 @@ double ReferenceCalcForcesAndEnergyKernel::finishComputation(ContextImpl& contex
     if (!includeForces)
         extractForces(context) = savedForces; // Restore the forces so computing the energy doesn't overwrite the forces with incorrect values.
     else
-        ReferenceVirtualSites::distributeForces(context.getSystem(), extractPositions(context), extractForces(context));
+        extractVirtualSites(context).distributeForces(extractPositions(context), extractForces(context));
     return 0.0;
 }
 
@@ -304,9 +320,10 @@ void ReferenceUpdateStateDataKernel::setPeriodicBoxVectors(ContextImpl& context,
 }
 
 void ReferenceUpdateStateDataKernel::createCheckpoint(ContextImpl& context, ostream& stream) {
-    int version = 2;
+    int version = 3;
     stream.write((char*) &version, sizeof(int));
     stream.write((char*) &data.time, sizeof(data.time));
+    stream.write((char*) &data.stepCount, sizeof(data.stepCount));
     vector<Vec3>& posData = extractPositions(context);
     stream.write((char*) &posData[0], sizeof(Vec3)*posData.size());
     vector<Vec3>& velData = extractVelocities(context);
@@ -319,9 +336,10 @@ void ReferenceUpdateStateDataKernel::createCheckpoint(ContextImpl& context, ostr
 void ReferenceUpdateStateDataKernel::loadCheckpoint(ContextImpl& context, istream& stream) {
     int version;
     stream.read((char*) &version, sizeof(int));
-    if (version != 2)
+    if (version != 3)
         throw OpenMMException("Checkpoint was created with a different version of OpenMM");
     stream.read((char*) &data.time, sizeof(data.time));
+    stream.read((char*) &data.stepCount, sizeof(data.stepCount));
     vector<Vec3>& posData = extractPositions(context);
     stream.read((char*) &posData[0], sizeof(Vec3)*posData.size());
     vector<Vec3>& velData = extractVelocities(context);
@@ -347,7 +365,7 @@ ReferenceApplyConstraintsKernel::~ReferenceApplyConstraintsKernel() {
 void ReferenceApplyConstraintsKernel::apply(ContextImpl& context, double tol) {
     vector<Vec3>& positions = extractPositions(context);
     extractConstraints(context).apply(positions, positions, inverseMasses, tol);
-    ReferenceVirtualSites::computePositions(context.getSystem(), positions);
+    extractVirtualSites(context).computePositions(positions);
 }
 
 void ReferenceApplyConstraintsKernel::applyToVelocities(ContextImpl& context, double tol) {
@@ -361,7 +379,7 @@ void ReferenceVirtualSitesKernel::initialize(const System& system) {
 
 void ReferenceVirtualSitesKernel::computePositions(ContextImpl& context) {
     vector<Vec3>& positions = extractPositions(context);
-    ReferenceVirtualSites::computePositions(context.getSystem(), positions);
+    extractVirtualSites(context).computePositions(positions);
 }
 
 ReferenceCalcHarmonicBondForceKernel::~ReferenceCalcHarmonicBondForceKernel() {
@@ -981,8 +999,10 @@ void ReferenceCalcNonbondedForceKernel::initialize(const System& system, const N
         useSwitchingFunction = false;
     }
     rfDielectric = force.getReactionFieldDielectric();
-    if (force.getUseDispersionCorrection())
-        dispersionCoefficient = NonbondedForceImpl::calcDispersionCorrection(system, force);
+    if (force.getUseDispersionCorrection()) {
+        longRangeCorrectionData = NonbondedForceImpl::prepareLongRangeCorrection(force);
+        dispersionCoefficient = NonbondedForceImpl::calcLongRangeCorrection(longRangeCorrectionData, force, system);
+    }
     else
         dispersionCoefficient = 0.0;
 }
@@ -1017,6 +1037,7 @@ double ReferenceCalcNonbondedForceKernel::execute(ContextImpl& context, bool inc
     }
     if (useSwitchingFunction)
         clj.setUseSwitchingFunction(switchingDistance);
+    clj.setThreadPool(extractThreadPool(context));
     clj.calculatePairIxn(numParticles, posData, particleParamArray, exclusions, 0, forceData, 0, includeEnergy ? &energy : NULL, includeDirect, includeReciprocal);
     if (includeDirect) {
         ReferenceBondForce refBondForce;
@@ -1030,9 +1051,11 @@ double ReferenceCalcNonbondedForceKernel::execute(ContextImpl& context, bool inc
     return energy;
 }
 
-void ReferenceCalcNonbondedForceKernel::copyParametersToContext(ContextImpl& context, const NonbondedForce& force) {
+void ReferenceCalcNonbondedForceKernel::copyParametersToContext(ContextImpl& context, const NonbondedForce& force, int firstParticle, int lastParticle, int firstException, int lastException) {
     if (force.getNumParticles() != numParticles)
         throw OpenMMException("updateParametersInContext: The number of particles has changed");
+    if (firstParticle > lastParticle && firstException > lastException)
+        return;
     vector<int> nb14s;
     for (int i = 0; i < force.getNumExceptions(); i++) {
         int particle1, particle2;
@@ -1046,7 +1069,7 @@ void ReferenceCalcNonbondedForceKernel::copyParametersToContext(ContextImpl& con
 
     // Record the values.
 
-    for (int i = 0; i < numParticles; ++i) {
+    for (int i = firstParticle; i <= lastParticle; ++i) {
         double charge, radius, depth;
         force.getParticleParameters(i, charge, radius, depth);
         particleParamArray[i][0] = 0.5*radius;
@@ -1054,6 +1077,8 @@ void ReferenceCalcNonbondedForceKernel::copyParametersToContext(ContextImpl& con
         particleParamArray[i][2] = charge;
     }
     for (int i = 0; i < num14; ++i) {
+        if (nb14s[i] < firstException || nb14s[i] > lastException)
+            continue;
         int particle1, particle2;
         double charge, radius, depth;
         force.getExceptionParameters(nb14s[i], particle1, particle2, charge, radius, depth);
@@ -1063,12 +1088,14 @@ void ReferenceCalcNonbondedForceKernel::copyParametersToContext(ContextImpl& con
         bonded14ParamArray[i][1] = 4.0*depth;
         bonded14ParamArray[i][2] = charge;
     }
-    
+
     // Recompute the coefficient for the dispersion correction.
 
     NonbondedForce::NonbondedMethod method = force.getNonbondedMethod();
-    if (force.getUseDispersionCorrection() && (method == NonbondedForce::CutoffPeriodic || method == NonbondedForce::Ewald || method == NonbondedForce::PME))
-        dispersionCoefficient = NonbondedForceImpl::calcDispersionCorrection(context.getSystem(), force);
+    if (force.getUseDispersionCorrection() && firstParticle <= lastParticle && (method == NonbondedForce::CutoffPeriodic || method == NonbondedForce::Ewald || method == NonbondedForce::PME)) {
+        NonbondedForceImpl::updateLongRangeCorrection(longRangeCorrectionData, force, firstParticle, lastParticle);
+        dispersionCoefficient = NonbondedForceImpl::calcLongRangeCorrection(longRangeCorrectionData, force, context.getSystem());
+    }
 }
 
 void ReferenceCalcNonbondedForceKernel::getPMEParameters(double& alpha, int& nx, int& ny, int& nz) const {
@@ -1225,7 +1252,7 @@ double ReferenceCalcCustomNonbondedForceKernel::execute(ContextImpl& context, bo
     // Add in the long range correction.
     
     if (!hasInitializedLongRangeCorrection || (globalParamsChanged && forceCopy != NULL)) {
-        CustomNonbondedForceImpl::calcLongRangeCorrection(*forceCopy, context.getOwner(), longRangeCoefficient, longRangeCoefficientDerivs);
+        CustomNonbondedForceImpl::calcLongRangeCorrection(*forceCopy, longRangeCorrectionData, context.getOwner(), longRangeCoefficient, longRangeCoefficientDerivs);
         hasInitializedLongRangeCorrection = true;
     }
     double volume = boxVectors[0][0]*boxVectors[1][1]*boxVectors[2][2];
@@ -1253,7 +1280,7 @@ void ReferenceCalcCustomNonbondedForceKernel::copyParametersToContext(ContextImp
     // If necessary, recompute the long range correction.
     
     if (forceCopy != NULL) {
-        CustomNonbondedForceImpl::calcLongRangeCorrection(force, context.getOwner(), longRangeCoefficient, longRangeCoefficientDerivs);
+        CustomNonbondedForceImpl::calcLongRangeCorrection(force, longRangeCorrectionData, context.getOwner(), longRangeCoefficient, longRangeCoefficientDerivs);
         hasInitializedLongRangeCorrection = true;
         *forceCopy = force;
     }
@@ -1620,6 +1647,26 @@ void ReferenceCalcCustomExternalForceKernel::copyParametersToContext(ContextImpl
     }
 }
 
+void ReferenceCalcCustomExternalForceKernel::copyParametersToContext(ContextImpl& context, const CustomExternalForce& force, const vector<int>& changedParticles) {
+    if (numParticles != force.getNumParticles())
+        throw OpenMMException("updateSelectedParametersInContext: The number of particles has changed");
+
+    // Record the values for the changed terms.
+
+    int numParameters = force.getNumPerParticleParameters();
+    for (int i : changedParticles) {
+        if (i < 0 || i >= numParticles)
+            throw OpenMMException("updateSelectedParametersInContext: Illegal particle index");
+        int particle;
+        vector<double> parameters;
+        force.getParticleParameters(i, particle, parameters);
+        if (particle != particles[i])
+            throw OpenMMException("updateSelectedParametersInContext: A particle index has changed");
+        for (int j = 0; j < numParameters; j++)
+            particleParamArray[i][j] = parameters[j];
+    }
+}
+
 ReferenceCalcCustomHbondForceKernel::~ReferenceCalcCustomHbondForceKernel() {
     disposeRealArray(donorParamArray, numDonors);
     disposeRealArray(acceptorParamArray, numAcceptors);
@@ -1934,6 +1981,71 @@ void ReferenceCalcCustomCompoundBondForceKernel::copyParametersToContext(Context
     }
 }
 
+void ReferenceCalcCustomCVForceKernel::initialize(const System& system, const CustomCVForce& force, ContextImpl& innerContext) {
+    // Create the expressions.
+
+    Lepton::ParsedExpression expression = Lepton::Parser::parse(force.getEnergyFunction()).optimize();
+    energyExpression = expression.createProgram();
+    for (int i = 0; i < force.getNumCollectiveVariables(); i++) {
+        string name = force.getCollectiveVariableName(i);
+        variableNames.push_back(name);
+        variableDerivExpressions.push_back(expression.differentiate(name).optimize().createProgram());
+    }
+    for (int i = 0; i < force.getNumGlobalParameters(); i++)
+        globalParameterNames.push_back(force.getGlobalParameterName(i));
+}
+
+double ReferenceCalcCustomCVForceKernel::execute(ContextImpl& context, ContextImpl& innerContext, bool includeForces, bool includeEnergy) {
+    int numCVs = variableNames.size();
+    map<string, double> variables;
+    for (auto& name : globalParameterNames)
+        variables[name] = context.getParameter(name);
+
+    // Compute the value of each collective variable, along with the forces it generates.
+    // Each variable is in its own force group in the inner context, so they can be
+    // evaluated separately.
+
+    vector<vector<Vec3> > cvForces(numCVs);
+    for (int i = 0; i < numCVs; i++) {
+        variables[variableNames[i]] = innerContext.calcForcesAndEnergy(includeForces, true, 1<<i);
+        if (includeForces)
+            innerContext.getForces(cvForces[i]);
+    }
+
+    // Evaluate the energy expression, and apply the chain rule to compute the forces.
+
+    double energy = energyExpression.evaluate(variables);
+    if (includeForces) {
+        vector<Vec3>& forceData = extractForces(context);
+        for (int i = 0; i < numCVs; i++) {
+            double dEdV = variableDerivExpressions[i].evaluate(variables);
+            for (int j = 0; j < forceData.size(); j++)
+                forceData[j] += cvForces[i][j]*dEdV;
+        }
+    }
+    return energy;
+}
+
+void ReferenceCalcCustomCVForceKernel::copyState(ContextImpl& context, ContextImpl& innerContext) {
+    int numParticles = context.getSystem().getNumParticles();
+    vector<Vec3> positions(numParticles);
+    context.getPositions(positions);
+    innerContext.setPositions(positions);
+    Vec3 a, b, c;
+    context.getPeriodicBoxVectors(a, b, c);
+    innerContext.setPeriodicBoxVectors(a, b, c);
+
+    // Copy the values of any parameters the two contexts have in common, such as global
+    // parameters defined by the forces that compute the collective variables.
+
+    const map<string, double>& outerParameters = context.getParameters();
+    for (auto& param : innerContext.getParameters()) {
+        map<string, double>::const_iterator outer = outerParameters.find(param.first);
+        if (outer != outerParameters.end() && outer->second != param.second)
+            innerContext.setParameter(param.first, outer->second);
+    }
+}
+
 ReferenceCalcCustomManyParticleForceKernel::~ReferenceCalcCustomManyParticleForceKernel() {
     disposeRealArray(particleParamArray, numParticles);
     if (ixn != NULL)
@@ -2039,6 +2151,7 @@ void ReferenceIntegrateVerletStepKernel::execute(ContextImpl& context, const Ver
             delete dynamics;
         dynamics = new ReferenceVerletDynamics(context.getSystem().getNumParticles(), stepSize);
         dynamics->setReferenceConstraintAlgorithm(&extractConstraints(context));
+        dynamics->setVirtualSites(&extractVirtualSites(context));
         prevStepSize = stepSize;
     }
     dynamics->update(context.getSystem(), posData, velData, forceData, masses, integrator.getConstraintTolerance());
@@ -2081,6 +2194,7 @@ void ReferenceIntegrateLangevinStepKernel::execute(ContextImpl& context, const L
                 friction, 
                 temperature);
         dynamics->setReferenceConstraintAlgorithm(&extractConstraints(context));
+        dynamics->setVirtualSites(&extractVirtualSites(context));
         prevTemp = temperature;
         prevFriction = friction;
         prevStepSize = stepSize;
@@ -2094,6 +2208,51 @@ double ReferenceIntegrateLangevinStepKernel::computeKineticEnergy(ContextImpl& c
     return computeShiftedKineticEnergy(context, masses, 0.5*integrator.getStepSize());
 }
 
+ReferenceIntegrateLangevinMiddleStepKernel::~ReferenceIntegrateLangevinMiddleStepKernel() {
+    if (dynamics)
+        delete dynamics;
+}
+
+void ReferenceIntegrateLangevinMiddleStepKernel::initialize(const System& system, const LangevinMiddleIntegrator& integrator) {
+    int numParticles = system.getNumParticles();
+    masses.resize(numParticles);
+    for (int i = 0; i < numParticles; ++i)
+        masses[i] = system.getParticleMass(i);
+    SimTKOpenMMUtilities::setRandomNumberSeed((unsigned int) integrator.getRandomNumberSeed());
+}
+
+void ReferenceIntegrateLangevinMiddleStepKernel::execute(ContextImpl& context, const LangevinMiddleIntegrator& integrator) {
+    double temperature = integrator.getTemperature();
+    double friction = integrator.getFriction();
+    double stepSize = integrator.getStepSize();
+    vector<Vec3>& posData = extractPositions(context);
+    vector<Vec3>& velData = extractVelocities(context);
+    vector<Vec3>& forceData = extractForces(context);
+    if (dynamics == 0 || temperature != prevTemp || friction != prevFriction || stepSize != prevStepSize) {
+        // Recreate the computation objects with the new parameters.
+
+        if (dynamics)
+            delete dynamics;
+        dynamics = new ReferenceLangevinMiddleDynamics(
+                context.getSystem().getNumParticles(),
+                stepSize,
+                friction,
+                temperature);
+        dynamics->setReferenceConstraintAlgorithm(&extractConstraints(context));
+        dynamics->setVirtualSites(&extractVirtualSites(context));
+        prevTemp = temperature;
+        prevFriction = friction;
+        prevStepSize = stepSize;
+    }
+    dynamics->update(context.getSystem(), posData, velData, forceData, masses, integrator.getConstraintTolerance());
+    data.time += stepSize;
+    data.stepCount++;
+}
+
+double ReferenceIntegrateLangevinMiddleStepKernel::computeKineticEnergy(ContextImpl& context, const LangevinMiddleIntegrator& integrator) {
+    return computeShiftedKineticEnergy(context, masses, 0);
+}
+
 ReferenceIntegrateBrownianStepKernel::~ReferenceIntegrateBrownianStepKernel() {
     if (dynamics)
         delete dynamics;
@@ -2125,6 +2284,7 @@ void ReferenceIntegrateBrownianStepKernel::execute(ContextImpl& context, const B
                 friction, 
                 temperature);
         dynamics->setReferenceConstraintAlgorithm(&extractConstraints(context));
+        dynamics->setVirtualSites(&extractVirtualSites(context));
         prevTemp = temperature;
         prevFriction = friction;
         prevStepSize = stepSize;
@@ -2165,6 +2325,7 @@ double ReferenceIntegrateVariableLangevinStepKernel::execute(ContextImpl& contex
             delete dynamics;
         dynamics = new ReferenceVariableStochasticDynamics(context.getSystem().getNumParticles(), friction, temperature, errorTol);
         dynamics->setReferenceConstraintAlgorithm(&extractConstraints(context));
+        dynamics->setVirtualSites(&extractVirtualSites(context));
         prevTemp = temperature;
         prevFriction = friction;
         prevErrorTol = errorTol;
@@ -2206,6 +2367,7 @@ double ReferenceIntegrateVariableVerletStepKernel::execute(ContextImpl& context,
             delete dynamics;
         dynamics = new ReferenceVariableVerletDynamics(context.getSystem().getNumParticles(), errorTol);
         dynamics->setReferenceConstraintAlgorithm(&extractConstraints(context));
+        dynamics->setVirtualSites(&extractVirtualSites(context));
         prevErrorTol = errorTol;
     }
     double maxStepSize = maxTime-data.time;
@@ -2256,6 +2418,7 @@ void ReferenceIntegrateCustomStepKernel::execute(ContextImpl& context, CustomInt
     // Execute the step.
     
     dynamics->setReferenceConstraintAlgorithm(&extractConstraints(context));
+    dynamics->setVirtualSites(&extractVirtualSites(context));
     dynamics->update(context, context.getSystem().getNumParticles(), posData, velData, forceData, masses, globals, perDofValues, forcesAreValid, integrator.getConstraintTolerance());
     
     // Record changed global variables.
@@ -2351,36 +2514,41 @@ void ReferenceApplyMonteCarloBarostatKernel::restoreCoordinates(ContextImpl& con
 void ReferenceRemoveCMMotionKernel::initialize(const System& system, const CMMotionRemover& force) {
     frequency = force.getFrequency();
     masses.resize(system.getNumParticles());
-    for (size_t i = 0; i < masses.size(); ++i)
+    totalMass = 0.0;
+    for (size_t i = 0; i < masses.size(); ++i) {
         masses[i] = system.getParticleMass(i);
+        totalMass += masses[i];
+    }
+    cmVelocity = Vec3();
+    hasMeasuredMomentum = false;
 }
 
 void ReferenceRemoveCMMotionKernel::execute(ContextImpl& context) {
     if (data.stepCount%frequency != 0)
         return;
     vector<Vec3>& velData = extractVelocities(context);
-    
-    // Calculate the center of mass momentum.
-    
-    double momentum[] = {0.0, 0.0, 0.0};
-    double mass = 0.0;
-    for (size_t i = 0; i < masses.size(); ++i) {
-        momentum[0] += masses[i]*velData[i][0];
-        momentum[1] += masses[i]*velData[i][1];
-        momentum[2] += masses[i]*velData[i][2];
-        mass += masses[i];
+    if (!hasMeasuredMomentum) {
+        // The first time this fires we have no stored correction, so calculate the center
+        // of mass momentum with a separate pass and remove it exactly.
+
+        Vec3 momentum;
+        for (size_t i = 0; i < masses.size(); ++i)
+            momentum += velData[i]*masses[i];
+        cmVelocity = momentum/totalMass;
     }
-    
-    // Adjust the particle velocities.
-    
-    momentum[0] /= mass;
-    momentum[1] /= mass;
-    momentum[2] /= mass;
+
+    // Remove the center of mass velocity measured at the previous firing, and in the same
+    // pass measure the momentum that remains so it can be removed the next time.  This
+    // keeps the center of mass motion bounded by the drift over a single interval while
+    // only traversing the velocities once.
+
+    Vec3 momentum;
     for (size_t i = 0; i < masses.size(); ++i) {
         if (masses[i] != 0.0) {
-            velData[i][0] -= momentum[0];
-            velData[i][1] -= momentum[1];
-            velData[i][2] -= momentum[2];
+            velData[i] -= cmVelocity;
+            momentum += velData[i]*masses[i];
         }
     }
+    cmVelocity = momentum/totalMass;
+    hasMeasuredMomentum = true;
 }
@@ -33,10 +33,13 @@
 #include "ReferenceConstraints.h"
 #include "ReferenceKernelFactory.h"
 #include "ReferenceKernels.h"
+#include "ReferenceVirtualSites.h"
 #include "openmm/internal/ContextImpl.h"
+#include "openmm/internal/ThreadPool.h"
 #include "SimTKOpenMMRealType.h"
 #include "openmm/Vec3.h"
 #include <map>
+#include <sstream>
 #include <vector>
 
 using namespace OpenMM;
@@ -64,10 +67,12 @@ ReferencePlatform::ReferencePlatform() {
     registerKernelFactory(CalcCustomHbondForceKernel::Name(), factory);
     registerKernelFactory(CalcCustomCentroidBondForceKernel::Name(), factory);
     registerKernelFactory(CalcCustomCompoundBondForceKernel::Name(), factory);
+    registerKernelFactory(CalcCustomCVForceKernel::Name(), factory);
     registerKernelFactory(CalcCustomManyParticleForceKernel::Name(), factory);
     registerKernelFactory(CalcGayBerneForceKernel::Name(), factory);
     registerKernelFactory(IntegrateVerletStepKernel::Name(), factory);
     registerKernelFactory(IntegrateLangevinStepKernel::Name(), factory);
+    registerKernelFactory(IntegrateLangevinMiddleStepKernel::Name(), factory);
     registerKernelFactory(IntegrateBrownianStepKernel::Name(), factory);
     registerKernelFactory(IntegrateVariableLangevinStepKernel::Name(), factory);
     registerKernelFactory(IntegrateVariableVerletStepKernel::Name(), factory);
@@ -75,18 +80,39 @@ ReferencePlatform::ReferencePlatform() {
     registerKernelFactory(ApplyAndersenThermostatKernel::Name(), factory);
     registerKernelFactory(ApplyMonteCarloBarostatKernel::Name(), factory);
     registerKernelFactory(RemoveCMMotionKernel::Name(), factory);
+    platformProperties.push_back(ReferenceThreads());
+    setPropertyDefaultValue(ReferenceThreads(), "1");
 }
 
 double ReferencePlatform::getSpeed() const {
     return 1;
 }
 
+const string& ReferencePlatform::getPropertyValue(const Context& context, const string& property) const {
+    const ContextImpl& impl = getContextImpl(context);
+    const PlatformData* data = reinterpret_cast<const PlatformData*>(impl.getPlatformData());
+    map<string, string>::const_iterator value = data->propertyValues.find(property);
+    if (value != data->propertyValues.end())
+        return value->second;
+    return Platform::getPropertyValue(context, property);
+}
+
 bool ReferencePlatform::supportsDoublePrecision() const {
     return true;
 }
 
 void ReferencePlatform::contextCreated(ContextImpl& context, const map<string, string>& properties) const {
-    context.setPlatformData(new PlatformData(context.getSystem()));
+    const string& threadsPropValue = (properties.find(ReferenceThreads()) == properties.end() ?
+            getPropertyDefaultValue(ReferenceThreads()) : properties.find(ReferenceThreads())->second);
+    int numThreads = 1;
+    stringstream(threadsPropValue) >> numThreads;
+    if (numThreads < 1)
+        numThreads = 1;
+    PlatformData* data = new PlatformData(context.getSystem(), numThreads);
+    stringstream threadsProperty;
+    threadsProperty << numThreads;
+    data->propertyValues[ReferenceThreads()] = threadsProperty.str();
+    context.setPlatformData(data);
 }
 
 void ReferencePlatform::contextDestroyed(ContextImpl& context) const {
@@ -94,14 +120,16 @@ void ReferencePlatform::contextDestroyed(ContextImpl& context) const {
     delete data;
 }
 
-ReferencePlatform::PlatformData::PlatformData(const System& system) : time(0.0), stepCount(0), numParticles(system.getNumParticles()) {
+ReferencePlatform::PlatformData::PlatformData(const System& system, int numThreads) : time(0.0), stepCount(0), numParticles(system.getNumParticles()), numThreads(numThreads) {
     positions = new vector<Vec3>(numParticles);
     velocities = new vector<Vec3>(numParticles);
     forces = new vector<Vec3>(numParticles);
     periodicBoxSize = new Vec3();
     periodicBoxVectors = new Vec3[3];
     constraints = new ReferenceConstraints(system);
+    virtualSites = new ReferenceVirtualSites(system);
     energyParameterDerivatives = new map<string, double>();
+    threadPool = NULL;
 }
 
 ReferencePlatform::PlatformData::~PlatformData() {
@@ -111,5 +139,7 @@ ReferencePlatform::PlatformData::~PlatformData() {
     delete (Vec3*) periodicBoxSize;
     delete[] (Vec3*) periodicBoxVectors;
     delete (ReferenceConstraints*) constraints;
+    delete (ReferenceVirtualSites*) virtualSites;
     delete (map<string, double>*) energyParameterDerivatives;
+    delete (ThreadPool*) threadPool;
 }
@@ -95,14 +95,21 @@ double ReferenceContinuous1DFunction::evaluate(const double* arguments) const {
     double t = arguments[0];
     if (t < min || t > max)
         return 0.0;
-    return SplineFitter::evaluateSpline(x, values, derivs, t);
+
+    // The grid points are uniformly spaced, so the interval containing the point can be found without searching.
+
+    int numValues = values.size();
+    int lower = std::min((int) ((t-min)*(numValues-1)/(max-min)), numValues-2);
+    return SplineFitter::evaluateSpline(x, values, derivs, lower, t);
 }
 
 double ReferenceContinuous1DFunction::evaluateDerivative(const double* arguments, const int* derivOrder) const {
     double t = arguments[0];
     if (t < min || t > max)
         return 0.0;
-    return SplineFitter::evaluateSplineDerivative(x, values, derivs, t);
+    int numValues = values.size();
+    int lower = std::min((int) ((t-min)*(numValues-1)/(max-min)), numValues-2);
+    return SplineFitter::evaluateSplineDerivative(x, values, derivs, lower, t);
 }
 
 CustomFunction* ReferenceContinuous1DFunction::clone() const {
@@ -139,7 +146,12 @@ double ReferenceContinuous2DFunction::evaluate(const double* arguments) const {
     double v = arguments[1];
     if (v < ymin || v > ymax)
         return 0.0;
-    return SplineFitter::evaluate2DSpline(x, y, values, c, u, v);
+
+    // The grid points are uniformly spaced, so the patch containing the point can be found without searching.
+
+    int lowerx = std::min((int) ((u-xmin)*(xsize-1)/(xmax-xmin)), xsize-2);
+    int lowery = std::min((int) ((v-ymin)*(ysize-1)/(ymax-ymin)), ysize-2);
+    return SplineFitter::evaluate2DSpline(x, y, values, c, lowerx, lowery, u, v);
 }
 
 double ReferenceContinuous2DFunction::evaluateDerivative(const double* arguments, const int* derivOrder) const {
@@ -149,8 +161,10 @@ double ReferenceContinuous2DFunction::evaluateDerivative(const double* arguments
     double v = arguments[1];
     if (v < ymin || v > ymax)
         return 0.0;
+    int lowerx = std::min((int) ((u-xmin)*(xsize-1)/(xmax-xmin)), xsize-2);
+    int lowery = std::min((int) ((v-ymin)*(ysize-1)/(ymax-ymin)), ysize-2);
     double dx, dy;
-    SplineFitter::evaluate2DSplineDerivatives(x, y, values, c, u, v, dx, dy);
+    SplineFitter::evaluate2DSplineDerivatives(x, y, values, c, lowerx, lowery, u, v, dx, dy);
     if (derivOrder[0] == 1 && derivOrder[1] == 0)
         return dx;
     if (derivOrder[0] == 0 && derivOrder[1] == 1)
@@ -199,7 +213,13 @@ double ReferenceContinuous3DFunction::evaluate(const double* arguments) const {
     double w = arguments[2];
     if (w < zmin || w > zmax)
         return 0.0;
-    return SplineFitter::evaluate3DSpline(x, y, z, values, c, u, v, w);
+
+    // The grid points are uniformly spaced, so the patch containing the point can be found without searching.
+
+    int lowerx = std::min((int) ((u-xmin)*(xsize-1)/(xmax-xmin)), xsize-2);
+    int lowery = std::min((int) ((v-ymin)*(ysize-1)/(ymax-ymin)), ysize-2);
+    int lowerz = std::min((int) ((w-zmin)*(zsize-1)/(zmax-zmin)), zsize-2);
+    return SplineFitter::evaluate3DSpline(x, y, z, values, c, lowerx, lowery, lowerz, u, v, w);
 }
 
 double ReferenceContinuous3DFunction::evaluateDerivative(const double* arguments, const int* derivOrder) const {
@@ -212,8 +232,11 @@ double ReferenceContinuous3DFunction::evaluateDerivative(const double* arguments
     double w = arguments[2];
     if (w < zmin || w > zmax)
         return 0.0;
+    int lowerx = std::min((int) ((u-xmin)*(xsize-1)/(xmax-xmin)), xsize-2);
+    int lowery = std::min((int) ((v-ymin)*(ysize-1)/(ymax-ymin)), ysize-2);
+    int lowerz = std::min((int) ((w-zmin)*(zsize-1)/(zmax-zmin)), zsize-2);
     double dx, dy, dz;
-    SplineFitter::evaluate3DSplineDerivatives(x, y, z, values, c, u, v, w, dx, dy, dz);
+    SplineFitter::evaluate3DSplineDerivatives(x, y, z, values, c, lowerx, lowery, lowerz, u, v, w, dx, dy, dz);
     if (derivOrder[0] == 1 && derivOrder[1] == 0 && derivOrder[2] == 0)
         return dx;
     if (derivOrder[0] == 0 && derivOrder[1] == 1 && derivOrder[2] == 0)
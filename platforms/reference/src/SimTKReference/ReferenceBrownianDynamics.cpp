@@ -136,6 +136,7 @@ void ReferenceBrownianDynamics::update(const OpenMM::System& system, vector<Vec3
                atomCoordinates[i][j] = xPrime[i][j];
            }
    }
-   ReferenceVirtualSites::computePositions(system, atomCoordinates);
+   if (getVirtualSites() != NULL)
+      getVirtualSites()->computePositions(atomCoordinates);
    incrementTimeStep();
 }
@@ -33,11 +33,45 @@
 #include "openmm/Vec3.h"
 #include "openmm/internal/ThreadPool.h"
 #include <map>
+#include <mutex>
+#include <set>
+#include <tuple>
 #include <utility>
 
 using namespace OpenMM;
 using namespace std;
 
+namespace {
+
+/**
+ * Inverting the constraint coupling matrix is expensive for large systems, so the result is
+ * cached in case an identical set of constraints is seen again, as happens whenever several
+ * contexts are created for the same System within one process.
+ */
+struct MatrixKey {
+    vector<pair<int, int> > atomIndices;
+    vector<double> distance;
+    vector<double> masses;
+    vector<tuple<int, int, int, double> > angles;
+    double elementCutoff;
+    bool operator<(const MatrixKey& other) const {
+        if (atomIndices != other.atomIndices)
+            return atomIndices < other.atomIndices;
+        if (distance != other.distance)
+            return distance < other.distance;
+        if (masses != other.masses)
+            return masses < other.masses;
+        if (angles != other.angles)
+            return angles < other.angles;
+        return elementCutoff < other.elementCutoff;
+    }
+};
+
+static map<MatrixKey, vector<vector<pair<int, double> > > > matrixCache;
+static mutex matrixCacheLock;
+
+}
+
 ReferenceCCMAAlgorithm::ReferenceCCMAAlgorithm(int numberOfAtoms,
                                                int numberOfConstraints,
                                                const vector<pair<int, int> >& atomIndices,
@@ -63,21 +97,55 @@ ReferenceCCMAAlgorithm::ReferenceCCMAAlgorithm(int numberOfAtoms,
     }
     if (numberOfConstraints > 0)
     {
+        // See whether the inverse matrix for an identical set of constraints has already
+        // been computed.
+
+        MatrixKey key;
+        key.atomIndices = atomIndices;
+        key.distance = distance;
+        key.masses = masses;
+        for (auto& angle : angles)
+            key.angles.push_back(make_tuple(angle.atom1, angle.atom2, angle.atom3, angle.angle));
+        key.elementCutoff = elementCutoff;
+        {
+            lock_guard<mutex> guard(matrixCacheLock);
+            map<MatrixKey, vector<vector<pair<int, double> > > >::const_iterator cached = matrixCache.find(key);
+            if (cached != matrixCache.end()) {
+                _matrix = cached->second;
+                return;
+            }
+        }
+
         // Compute the constraint coupling matrix
 
         vector<vector<int> > atomAngles(numberOfAtoms);
         for (int i = 0; i < (int) angles.size(); i++)
             atomAngles[angles[i].atom2].push_back(i);
+
+        // Index the constraints by the atoms they involve.  Only constraints that share an
+        // atom couple to each other, so this keeps the time for building the matrix close to
+        // linear in the number of constraints instead of quadratic.
+
+        vector<vector<int> > atomConstraints(numberOfAtoms);
+        map<pair<int, int>, int> atomPairConstraint;
+        for (int i = 0; i < numberOfConstraints; i++) {
+            atomConstraints[_atomIndices[i].first].push_back(i);
+            atomConstraints[_atomIndices[i].second].push_back(i);
+            atomPairConstraint[make_pair(_atomIndices[i].first, _atomIndices[i].second)] = i;
+            atomPairConstraint[make_pair(_atomIndices[i].second, _atomIndices[i].first)] = i;
+        }
         vector<vector<pair<int, double> > > matrix(numberOfConstraints);
         for (int j = 0; j < numberOfConstraints; j++) {
-            for (int k = 0; k < numberOfConstraints; k++) {
+            int atomj0 = _atomIndices[j].first;
+            int atomj1 = _atomIndices[j].second;
+            set<int> coupled(atomConstraints[atomj0].begin(), atomConstraints[atomj0].end());
+            coupled.insert(atomConstraints[atomj1].begin(), atomConstraints[atomj1].end());
+            for (int k : coupled) {
                 if (j == k) {
                     matrix[j].push_back(pair<int, double>(j, 1.0));
                     continue;
                 }
                 double scale;
-                int atomj0 = _atomIndices[j].first;
-                int atomj1 = _atomIndices[j].second;
                 int atomk0 = _atomIndices[k].first;
                 int atomk1 = _atomIndices[k].second;
                 double invMass0 = 1/masses[atomj0];
@@ -112,18 +180,14 @@ ReferenceCCMAAlgorithm::ReferenceCCMAAlgorithm(int numberOfAtoms,
 
                 // Look for a third constraint forming a triangle with these two.
 
-                bool foundConstraint = false;
-                for (int other = 0; other < numberOfConstraints; other++) {
-                    if ((_atomIndices[other].first == atoma && _atomIndices[other].second == atomc) || (_atomIndices[other].first == atomc && _atomIndices[other].second == atoma)) {
-                        double d1 = _distance[j];
-                        double d2 = _distance[k];
-                        double d3 = _distance[other];
-                        matrix[j].push_back(pair<int, double>(k, scale*(d1*d1+d2*d2-d3*d3)/(2.0*d1*d2)));
-                        foundConstraint = true;
-                        break;
-                    }
+                map<pair<int, int>, int>::const_iterator other = atomPairConstraint.find(make_pair(atoma, atomc));
+                if (other != atomPairConstraint.end()) {
+                    double d1 = _distance[j];
+                    double d2 = _distance[k];
+                    double d3 = _distance[other->second];
+                    matrix[j].push_back(pair<int, double>(k, scale*(d1*d1+d2*d2-d3*d3)/(2.0*d1*d2)));
                 }
-                if (!foundConstraint) {
+                else {
                     // We didn't find one, so look for an angle force field term.
 
                     const vector<int>& angleCandidates = atomAngles[atomb];
@@ -190,6 +254,11 @@ ReferenceCCMAAlgorithm::ReferenceCCMAAlgorithm(int numberOfAtoms,
         }
         QUERN_free_result(qRowStart, qColIndex, qValue);
         QUERN_free_result(rRowStart, rColIndex, rValue);
+
+        // Save the result for any later algorithm created with the same constraints.
+
+        lock_guard<mutex> guard(matrixCacheLock);
+        matrixCache[key] = _matrix;
     }
 }
 
@@ -36,7 +36,19 @@ using namespace OpenMM;
 
 ReferenceCMAPTorsionIxn::ReferenceCMAPTorsionIxn(const vector<vector<vector<double> > >& coeff,
         const vector<int>& torsionMaps, const vector<vector<int> >& torsionIndices) :
-        coeff(coeff), torsionMaps(torsionMaps), torsionIndices(torsionIndices), usePeriodic(false) {
+        torsionMaps(torsionMaps), torsionIndices(torsionIndices), usePeriodic(false) {
+
+    // Flatten the coefficients of each map into a single contiguous array, and record the
+    // map sizes so they need not be recomputed for every torsion.
+
+    this->coeff.resize(coeff.size());
+    mapSizes.resize(coeff.size());
+    for (int i = 0; i < (int) coeff.size(); i++) {
+        mapSizes[i] = (int) sqrt((double) coeff[i].size());
+        this->coeff[i].reserve(16*coeff[i].size());
+        for (auto& patch : coeff[i])
+            this->coeff[i].insert(this->coeff[i].end(), patch.begin(), patch.end());
+    }
 }
 
 void ReferenceCMAPTorsionIxn::setPeriodic(OpenMM::Vec3* vectors) {
@@ -61,31 +73,31 @@ void ReferenceCMAPTorsionIxn::setPeriodic(OpenMM::Vec3* vectors) {
 
 void ReferenceCMAPTorsionIxn::calculateIxn(vector<Vec3>& atomCoordinates, vector<Vec3>& forces, double* totalEnergy) const {
     for (unsigned int i = 0; i < torsionMaps.size(); i++)
-        calculateOneIxn(i, atomCoordinates, forces, totalEnergy);
+        calculateOneIxn(torsionMaps[i], &torsionIndices[i][0], atomCoordinates, forces, totalEnergy);
 }
 
 /**---------------------------------------------------------------------------------------
 
    Calculate the interaction due to a single torsion pair
 
-   @param index            the index of the torsion
+   @param map              the map to use for the torsion
+   @param indices          the indices of the eight atoms forming the two dihedrals
    @param atomCoordinates  atom coordinates
    @param forces           force array (forces added)
    @param totalEnergy      total energy
 
      --------------------------------------------------------------------------------------- */
 
-void ReferenceCMAPTorsionIxn::calculateOneIxn(int index, vector<Vec3>& atomCoordinates, vector<Vec3>& forces,
-                     double* totalEnergy) const {
-    int map = torsionMaps[index];
-    int a1 = torsionIndices[index][0];
-    int a2 = torsionIndices[index][1];
-    int a3 = torsionIndices[index][2];
-    int a4 = torsionIndices[index][3];
-    int b1 = torsionIndices[index][4];
-    int b2 = torsionIndices[index][5];
-    int b3 = torsionIndices[index][6];
-    int b4 = torsionIndices[index][7];
+void ReferenceCMAPTorsionIxn::calculateOneIxn(int map, const int* indices, vector<Vec3>& atomCoordinates,
+                     vector<Vec3>& forces, double* totalEnergy) const {
+    int a1 = indices[0];
+    int a2 = indices[1];
+    int a3 = indices[2];
+    int a4 = indices[3];
+    int b1 = indices[4];
+    int b2 = indices[5];
+    int b3 = indices[6];
+    int b4 = indices[7];
 
     // Compute deltas between the various atoms involved.
 
@@ -131,11 +143,11 @@ void ReferenceCMAPTorsionIxn::calculateOneIxn(int index, vector<Vec3>& atomCoord
 
     // Identify which patch this is in.
 
-    int size = (int) sqrt(coeff[map].size());
+    int size = mapSizes[map];
     double delta = 2*M_PI/size;
     int s = (int) (angleA/delta);
     int t = (int) (angleB/delta);
-    const vector<double>& c = coeff[map][s+size*t];
+    const double* c = &coeff[map][16*(s+size*t)];
     double da = angleA/delta-s;
     double db = angleB/delta-t;
 
@@ -202,10 +214,13 @@ void ReferenceCMAPTorsionIxn::calculateOneIxn(int index, vector<Vec3>& atomCoord
 
 /**---------------------------------------------------------------------------------------
 
-   This is present only because we must define it to subclass ReferenceBondIxn.  It is never called.
+   Calculate the interaction due to a single torsion pair.  This form is used by the CPU
+   platform, which parallelizes the torsions with CpuBondForce.  The map to use is passed
+   in parameters[0].
 
    --------------------------------------------------------------------------------------- */
 
 void ReferenceCMAPTorsionIxn::calculateBondIxn(int* atomIndices, vector<Vec3>& atomCoordinates,
         double* parameters, vector<Vec3>& forces, double* totalEnergy, double* energyParamDerivs) {
+    calculateOneIxn((int) parameters[0], atomIndices, atomCoordinates, forces, totalEnergy);
 }
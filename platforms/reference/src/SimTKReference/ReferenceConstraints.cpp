@@ -32,6 +32,7 @@
 #include "ReferenceConstraints.h"
 #include "ReferenceCCMAAlgorithm.h"
 #include "ReferenceSETTLEAlgorithm.h"
+#include "ReferenceSHAKEAlgorithm.h"
 #include "openmm/HarmonicAngleForce.h"
 #include "openmm/OpenMMException.h"
 #include <map>
@@ -41,7 +42,7 @@
 using namespace OpenMM;
 using namespace std;
 
-ReferenceConstraints::ReferenceConstraints(const System& system) : ccma(NULL), settle(NULL) {
+ReferenceConstraints::ReferenceConstraints(const System& system) : ccma(NULL), settle(NULL), shake(NULL) {
     int numParticles = system.getNumParticles();
     vector<double> masses(numParticles);
     for (int i = 0; i < numParticles; ++i)
@@ -145,11 +146,62 @@ ReferenceConstraints::ReferenceConstraints(const System& system) : ccma(NULL), s
             settle = new ReferenceSETTLEAlgorithm(atom1, atom2, atom3, distance1, distance2, masses);
     }
 
+    // Identify clusters consisting of a central atom connected to up to three peripheral
+    // atoms that are involved in no other constraints, such as X-H_n groups.  These make up
+    // the overwhelming majority of non-water constraints, and each cluster can be handled
+    // with a local SHAKE iteration instead of including it in the global CCMA calculation.
+
+    map<int, vector<int> > clusterConstraints;
+    for (int i = 0; i < (int) atom1.size(); i++) {
+        if (isSettleAtom[atom1[i]])
+            continue; // This is being taken care of with SETTLE.
+
+        // Determine which is the central atom.
+
+        bool firstIsCentral;
+        if (constraintCount[atom1[i]] > 1)
+            firstIsCentral = true;
+        else if (constraintCount[atom2[i]] > 1)
+            firstIsCentral = false;
+        else if (atom1[i] < atom2[i])
+            firstIsCentral = true;
+        else
+            firstIsCentral = false;
+        clusterConstraints[firstIsCentral ? atom1[i] : atom2[i]].push_back(i);
+    }
+    vector<bool> isShakeConstraint(atom1.size(), false);
+    vector<int> shakeCentral;
+    vector<vector<int> > shakePeripheral;
+    vector<vector<double> > shakeDistance;
+    for (auto& cluster : clusterConstraints) {
+        int centralID = cluster.first;
+        const vector<int>& constraints = cluster.second;
+        bool valid = ((int) constraints.size() <= 3 && (int) constraints.size() == constraintCount[centralID] && masses[centralID] != 0);
+        vector<int> peripheral;
+        vector<double> dist;
+        for (int i : constraints) {
+            int peripheralID = (atom1[i] == centralID ? atom2[i] : atom1[i]);
+            if (constraintCount[peripheralID] != 1 || masses[peripheralID] == 0)
+                valid = false;
+            peripheral.push_back(peripheralID);
+            dist.push_back(distance[i]);
+        }
+        if (valid) {
+            shakeCentral.push_back(centralID);
+            shakePeripheral.push_back(peripheral);
+            shakeDistance.push_back(dist);
+            for (int i : constraints)
+                isShakeConstraint[i] = true;
+        }
+    }
+    if (shakeCentral.size() > 0)
+        shake = new ReferenceSHAKEAlgorithm(shakeCentral, shakePeripheral, shakeDistance);
+
     // All other constraints are handled with CCMA.
 
     vector<int> ccmaConstraints;
     for (unsigned i = 0; i < atom1.size(); i++)
-        if (!isSettleAtom[atom1[i]])
+        if (!isSettleAtom[atom1[i]] && !isShakeConstraint[i])
             ccmaConstraints.push_back(i);
     int numCCMA = ccmaConstraints.size();
     if (numCCMA > 0) {
@@ -189,6 +241,8 @@ ReferenceConstraints::~ReferenceConstraints() {
         delete ccma;
     if (settle != NULL)
         delete settle;
+    if (shake != NULL)
+        delete shake;
 }
 
 void ReferenceConstraints::apply(vector<OpenMM::Vec3>& atomCoordinates, vector<OpenMM::Vec3>& atomCoordinatesP, vector<double>& inverseMasses, double tolerance) {
@@ -196,6 +250,8 @@ void ReferenceConstraints::apply(vector<OpenMM::Vec3>& atomCoordinates, vector<O
         ccma->apply(atomCoordinates, atomCoordinatesP, inverseMasses, tolerance);
     if (settle != NULL)
         settle->apply(atomCoordinates, atomCoordinatesP, inverseMasses, tolerance);
+    if (shake != NULL)
+        shake->apply(atomCoordinates, atomCoordinatesP, inverseMasses, tolerance);
 }
 
 void ReferenceConstraints::applyToVelocities(vector<OpenMM::Vec3>& atomCoordinates, vector<OpenMM::Vec3>& velocities, vector<double>& inverseMasses, double tolerance) {
@@ -203,4 +259,6 @@ void ReferenceConstraints::applyToVelocities(vector<OpenMM::Vec3>& atomCoordinat
         ccma->applyToVelocities(atomCoordinates, velocities, inverseMasses, tolerance);
     if (settle != NULL)
         settle->applyToVelocities(atomCoordinates, velocities, inverseMasses, tolerance);
+    if (shake != NULL)
+        shake->applyToVelocities(atomCoordinates, velocities, inverseMasses, tolerance);
 }
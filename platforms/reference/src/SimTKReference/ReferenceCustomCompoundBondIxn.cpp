@@ -86,6 +86,7 @@ ReferenceCustomCompoundBondIxn::ReferenceCustomCompoundBondIxn(int numParticlesP
     numParameters = bondParameterNames.size();
     for (int i = 0; i < numParameters; i++)
         bondParamIndex.push_back(expressionSet.getVariableIndex(bondParameterNames[i]));
+    energyParamDerivValues.resize(this->energyParamDerivExpressions.size(), 0.0);
 }
 
 /**---------------------------------------------------------------------------------------
@@ -119,33 +120,38 @@ void ReferenceCustomCompoundBondIxn::setPeriodic(OpenMM::Vec3* vectors) {
 void ReferenceCustomCompoundBondIxn::calculatePairIxn(vector<Vec3>& atomCoordinates, double** bondParameters,
                                              const map<string, double>& globalParameters, vector<Vec3>& forces,
                                              double* totalEnergy, double* energyParamDerivs) {
+    setGlobalParameters(globalParameters);
+    int numBonds = bondAtoms.size();
+    for (int bond = 0; bond < numBonds; bond++)
+        calculateBondIxn(&bondAtoms[bond][0], atomCoordinates, bondParameters[bond], forces, totalEnergy, energyParamDerivs);
+}
+
+void ReferenceCustomCompoundBondIxn::setGlobalParameters(const map<string, double>& globalParameters) {
     for (auto& param : globalParameters)
         expressionSet.setVariable(expressionSet.getVariableIndex(param.first), param.second);
-    int numBonds = bondAtoms.size();
-    for (int bond = 0; bond < numBonds; bond++) {
-        for (int i = 0; i < numParameters; i++)
-            expressionSet.setVariable(bondParamIndex[i], bondParameters[bond][i]);
-        calculateOneIxn(bond, atomCoordinates, forces, totalEnergy, energyParamDerivs);
-    }
+    energyParamDerivValues.assign(energyParamDerivExpressions.size(), 0.0);
 }
 
   /**---------------------------------------------------------------------------------------
 
      Calculate interaction for one bond
 
-     @param bond             the index of the bond
+     @param atomIndices      the indices of the atoms in the bond
      @param atomCoordinates  atom coordinates
+     @param parameters       bond parameter values
      @param forces           force array (forces added)
-     @param energyByAtom     atom energy
      @param totalEnergy      total energy
 
      --------------------------------------------------------------------------------------- */
 
-void ReferenceCustomCompoundBondIxn::calculateOneIxn(int bond, vector<Vec3>& atomCoordinates,
-                        vector<Vec3>& forces, double* totalEnergy, double* energyParamDerivs) {
+void ReferenceCustomCompoundBondIxn::calculateBondIxn(int* atomIndices, vector<Vec3>& atomCoordinates,
+                        double* parameters, vector<Vec3>& forces, double* totalEnergy, double* energyParamDerivs) {
+    for (int i = 0; i < numParameters; i++)
+        expressionSet.setVariable(bondParamIndex[i], parameters[i]);
+
     // Compute all of the variables the energy can depend on.
 
-    const vector<int>& atoms = bondAtoms[bond];
+    int* atoms = atomIndices;
     for (auto& term : particleTerms)
         expressionSet.setVariable(term.index, atomCoordinates[atoms[term.atom]][term.component]);
     for (auto& term : distanceTerms) {
@@ -243,10 +249,16 @@ void ReferenceCustomCompoundBondIxn::calculateOneIxn(int bond, vector<Vec3>& ato
     if (totalEnergy)
         *totalEnergy += energyExpression.evaluate();
     
-    // Compute derivatives of the energy.
-    
-    for (int i = 0; i < energyParamDerivExpressions.size(); i++)
-        energyParamDerivs[i] += energyParamDerivExpressions[i].evaluate();
+    // Compute derivatives of the energy.  When there is no output array to add them to,
+    // accumulate them internally so the caller can retrieve them later.
+
+    for (int i = 0; i < energyParamDerivExpressions.size(); i++) {
+        double value = energyParamDerivExpressions[i].evaluate();
+        if (energyParamDerivs != NULL)
+            energyParamDerivs[i] += value;
+        else
+            energyParamDerivValues[i] += value;
+    }
 }
 
 void ReferenceCustomCompoundBondIxn::computeDelta(int atom1, int atom2, double* delta, vector<Vec3>& atomCoordinates) const {
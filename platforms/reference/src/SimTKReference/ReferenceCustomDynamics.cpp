@@ -296,11 +296,14 @@ void ReferenceCustomDynamics::update(ContextImpl& context, int numberOfAtoms, ve
                 break;
             }
         }
-        if (invalidatesForces[step])
+        if (invalidatesForces[step]) {
             forcesAreValid = false;
+            context.invalidateEnergyCache();
+        }
         step = nextStep;
     }
-    ReferenceVirtualSites::computePositions(context.getSystem(), atomCoordinates);
+    if (getVirtualSites() != NULL)
+        getVirtualSites()->computePositions(atomCoordinates);
     incrementTimeStep();
     recordChangedParameters(context, globals);
 }
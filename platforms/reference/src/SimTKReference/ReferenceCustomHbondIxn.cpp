@@ -29,6 +29,7 @@
 #include "SimTKOpenMMUtilities.h"
 #include "ReferenceForce.h"
 #include "ReferenceCustomHbondIxn.h"
+#include "ReferenceNeighborList.h"
 
 using std::map;
 using std::pair;
@@ -127,6 +128,36 @@ void ReferenceCustomHbondIxn::calculatePairIxn(vector<Vec3>& atomCoordinates, do
    int numDonors = donorAtoms.size();
    int numAcceptors = acceptorAtoms.size();
 
+   if (cutoff) {
+      // Use a voxel based neighbor list to find the donor-acceptor pairs within the cutoff,
+      // so the cost scales linearly with the number of donors instead of quadratically.
+
+      vector<Vec3> donorPositions(numDonors);
+      vector<Vec3> acceptorPositions(numAcceptors);
+      for (int i = 0; i < numDonors; i++)
+          donorPositions[i] = atomCoordinates[donorAtoms[i][0]];
+      for (int i = 0; i < numAcceptors; i++)
+          acceptorPositions[i] = atomCoordinates[acceptorAtoms[i][0]];
+      NeighborList pairs;
+      computeBipartiteNeighborListVoxelHash(pairs, donorPositions, acceptorPositions, periodicBoxVectors, periodic, cutoffDistance);
+      int lastDonor = -1;
+      for (auto& pair : pairs) {
+         int donor = pair.first;
+         int acceptor = pair.second;
+         if (exclusions[donor].find(acceptor) != exclusions[donor].end())
+             continue;
+         if (donor != lastDonor) {
+             for (int j = 0; j < (int) donorParamNames.size(); j++)
+                 variables[donorParamNames[j]] = donorParameters[donor][j];
+             lastDonor = donor;
+         }
+         for (int j = 0; j < (int) acceptorParamNames.size(); j++)
+             variables[acceptorParamNames[j]] = acceptorParameters[acceptor][j];
+         calculateOneIxn(donor, acceptor, atomCoordinates, variables, forces, totalEnergy);
+      }
+      return;
+   }
+
    for (int donor = 0; donor < numDonors; donor++) {
       // Initialize per-donor parameters.
 
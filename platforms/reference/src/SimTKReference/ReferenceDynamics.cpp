@@ -50,6 +50,7 @@ ReferenceDynamics::ReferenceDynamics(int numberOfAtoms,  double deltaT, double t
    _timeStep = 0;
    _ownReferenceConstraint = false;
    _referenceConstraint    = NULL;
+   _virtualSites           = NULL;
 }
 
 /**---------------------------------------------------------------------------------------
@@ -165,6 +166,30 @@ void ReferenceDynamics::setReferenceConstraintAlgorithm(ReferenceConstraintAlgor
    _ownReferenceConstraint = 0;
 }
 
+/**---------------------------------------------------------------------------------------
+
+   Get the ReferenceVirtualSites used for updating virtual site positions
+
+   @return virtualSites  object, or NULL if none has been set
+
+   --------------------------------------------------------------------------------------- */
+
+const ReferenceVirtualSites* ReferenceDynamics::getVirtualSites() const {
+   return _virtualSites;
+}
+
+/**---------------------------------------------------------------------------------------
+
+   Set the ReferenceVirtualSites used for updating virtual site positions
+
+   @param virtualSites  virtualSites object
+
+   --------------------------------------------------------------------------------------- */
+
+void ReferenceDynamics::setVirtualSites(const ReferenceVirtualSites* virtualSites) {
+   _virtualSites = virtualSites;
+}
+
 /**---------------------------------------------------------------------------------------
 
    Update -- driver routine for performing dynamics update of coordinates
@@ -48,7 +48,7 @@ using namespace OpenMM;
 
    --------------------------------------------------------------------------------------- */
 
-ReferenceLJCoulombIxn::ReferenceLJCoulombIxn() : cutoff(false), useSwitch(false), periodic(false), ewald(false), pme(false), ljpme(false) {
+ReferenceLJCoulombIxn::ReferenceLJCoulombIxn() : cutoff(false), useSwitch(false), periodic(false), ewald(false), pme(false), ljpme(false), threads(NULL) {
 }
 
 /**---------------------------------------------------------------------------------------
@@ -92,6 +92,19 @@ void ReferenceLJCoulombIxn::setUseSwitchingFunction(double distance) {
     switchingDistance = distance;
 }
 
+/**---------------------------------------------------------------------------------------
+
+   Set a thread pool with which to parallelize the direct space calculation.  If this is
+   not called, everything is computed on a single thread.
+
+   @param threads    the thread pool to use
+
+   --------------------------------------------------------------------------------------- */
+
+void ReferenceLJCoulombIxn::setThreadPool(ThreadPool* threads) {
+    this->threads = threads;
+}
+
 /**---------------------------------------------------------------------------------------
 
      Set the force to use periodic boundary conditions.  This requires that a cutoff has
@@ -204,7 +217,6 @@ void ReferenceLJCoulombIxn::calculateEwaldIxn(int numberOfAtoms, vector<Vec3>& a
     double recipEnergy              = 0.0;
     double recipDispersionEnergy    = 0.0;
     double totalRecipEnergy         = 0.0;
-    double vdwEnergy                = 0.0;
 
     // A couple of sanity checks for
     if(ljpme && useSwitch)
@@ -391,14 +403,123 @@ void ReferenceLJCoulombIxn::calculateEwaldIxn(int numberOfAtoms, vector<Vec3>& a
 
     if (!includeDirect)
         return;
-    double totalVdwEnergy            = 0.0f;
-    double totalRealSpaceEwaldEnergy = 0.0f;
+    if (threads != NULL && energyByAtom == NULL) {
+        // Split the neighbor list between threads, each accumulating forces into its own buffer.
+
+        int numThreads = threads->getNumThreads();
+        int numPairs = neighborList->size();
+        vector<vector<Vec3> > threadForces(numThreads);
+        vector<double> threadEnergy(numThreads);
+        threads->execute([&] (ThreadPool& pool, int threadIndex) {
+            threadForces[threadIndex].resize(numberOfAtoms, Vec3());
+            int start = (threadIndex*numPairs)/numThreads;
+            int end = ((threadIndex+1)*numPairs)/numThreads;
+            threadEnergy[threadIndex] = calculateEwaldShortRange(start, end, atomCoordinates, atomParameters, threadForces[threadIndex], NULL);
+        });
+        threads->waitForThreads();
+        double directEwaldEnergy = 0.0;
+        for (int i = 0; i < numThreads; i++) {
+            directEwaldEnergy += threadEnergy[i];
+            for (int j = 0; j < numberOfAtoms; j++)
+                forces[j] += threadForces[i][j];
+        }
+        if (totalEnergy)
+            *totalEnergy += directEwaldEnergy;
+    }
+    else {
+        double directEwaldEnergy = calculateEwaldShortRange(0, neighborList->size(), atomCoordinates, atomParameters, forces, energyByAtom);
+        if (totalEnergy)
+            *totalEnergy += directEwaldEnergy;
+    }
+
+    // Now subtract off the exclusions, since they were implicitly included in the reciprocal space sum.
+
+    double totalExclusionEnergy = 0.0f;
+    const double TWO_OVER_SQRT_PI = 2/sqrt(PI_M);
+    for (int i = 0; i < numberOfAtoms; i++)
+        for (int exclusion : exclusions[i]) {
+            if (exclusion > i) {
+                int ii = i;
+                int jj = exclusion;
+
+                double deltaR[2][ReferenceForce::LastDeltaRIndex];
+                ReferenceForce::getDeltaR(atomCoordinates[jj], atomCoordinates[ii], deltaR[0]);
+                double r         = deltaR[0][ReferenceForce::RIndex];
+                double inverseR  = 1.0/(deltaR[0][ReferenceForce::RIndex]);
+                double alphaR    = alphaEwald * r;
+                if (erf(alphaR) > 1e-6) {
+                    double dEdR = ONE_4PI_EPS0 * atomParameters[ii][QIndex] * atomParameters[jj][QIndex] * inverseR * inverseR * inverseR;
+                    dEdR = dEdR * (erf(alphaR) - 2 * alphaR * exp (- alphaR * alphaR) / SQRT_PI);
+
+                    // accumulate forces
+
+                    for (int kk = 0; kk < 3; kk++) {
+                        double force = dEdR*deltaR[0][kk];
+                        forces[ii][kk] -= force;
+                        forces[jj][kk] += force;
+                    }
+
+                    // accumulate energies
+
+                    realSpaceEwaldEnergy = ONE_4PI_EPS0*atomParameters[ii][QIndex]*atomParameters[jj][QIndex]*inverseR*erf(alphaR);
+                }
+                else {
+                    realSpaceEwaldEnergy = alphaEwald*TWO_OVER_SQRT_PI*ONE_4PI_EPS0*atomParameters[ii][QIndex]*atomParameters[jj][QIndex];
+                }
+
+                if(ljpme){
+                    // Dispersion terms.  Here we just back out the reciprocal space terms, and don't add any extra real space terms.
+                    double dalphaR   = alphaDispersionEwald * r;
+                    double inverseR2 = inverseR*inverseR;
+                    double dar2 = dalphaR*dalphaR;
+                    double dar4 = dar2*dar2;
+                    double dar6 = dar4*dar2;
+                    double c6i = 8.0*pow(atomParameters[ii][SigIndex], 3.0) * atomParameters[ii][EpsIndex];
+                    double c6j = 8.0*pow(atomParameters[jj][SigIndex], 3.0) * atomParameters[jj][EpsIndex];
+                    realSpaceEwaldEnergy -= c6i*c6j*inverseR2*inverseR2*inverseR2*(1.0 - EXP(-dar2) * (1.0 + dar2 + 0.5*dar4));
+                    double dEdR = -6.0*c6i*c6j*inverseR2*inverseR2*inverseR2*inverseR2*(1.0 - EXP(-dar2) * (1.0 + dar2 + 0.5*dar4 + dar6/6.0));
+                    for (int kk = 0; kk < 3; kk++) {
+                        double force = dEdR*deltaR[0][kk];
+                        forces[ii][kk] -= force;
+                        forces[jj][kk] += force;
+                    }
+                }
+
+                totalExclusionEnergy += realSpaceEwaldEnergy;
+                if (energyByAtom) {
+                    energyByAtom[ii] -= realSpaceEwaldEnergy;
+                    energyByAtom[jj] -= realSpaceEwaldEnergy;
+                }
+            }
+        }
+
+    if (totalEnergy)
+        *totalEnergy -= totalExclusionEnergy;
+}
+
+/**---------------------------------------------------------------------------------------
 
+   Calculate the short range part of the Ewald ixn for a range of neighbor list entries
 
-    for (auto& pair : *neighborList) {
-        int ii = pair.first;
-        int jj = pair.second;
+   @param start            the index of the first neighbor list entry to process
+   @param end              the index of the first neighbor list entry not to process
+   @param atomCoordinates  atom coordinates
+   @param atomParameters   atom parameters                             atomParameters[atomIndex][paramterIndex]
+   @param forces           force array (forces added)
+   @param energyByAtom     atom energy
+
+   @return the direct space energy of the processed entries
 
+   --------------------------------------------------------------------------------------- */
+
+double ReferenceLJCoulombIxn::calculateEwaldShortRange(int start, int end, vector<Vec3>& atomCoordinates,
+                                                       double** atomParameters, vector<Vec3>& forces, double* energyByAtom) const {
+    double SQRT_PI                   = sqrt(PI_M);
+    double totalVdwEnergy            = 0.0;
+    double totalRealSpaceEwaldEnergy = 0.0;
+    for (int index = start; index < end; index++) {
+        int ii = (*neighborList)[index].first;
+        int jj = (*neighborList)[index].second;
         double deltaR[2][ReferenceForce::LastDeltaRIndex];
         ReferenceForce::getDeltaRPeriodic(atomCoordinates[jj], atomCoordinates[ii], periodicBoxVectors, deltaR[0]);
         double r         = deltaR[0][ReferenceForce::RIndex];
@@ -421,7 +542,7 @@ void ReferenceLJCoulombIxn::calculateEwaldIxn(int numberOfAtoms, vector<Vec3>& a
         double sig6 = sig2*sig2*sig2;
         double eps = atomParameters[ii][EpsIndex]*atomParameters[jj][EpsIndex];
         dEdR += switchValue*eps*(12.0*sig6 - 6.0)*sig6*inverseR*inverseR;
-        vdwEnergy = eps*(sig6-1.0)*sig6;
+        double vdwEnergy = eps*(sig6-1.0)*sig6;
 
         if (ljpme) {
             double dalphaR   = alphaDispersionEwald * r;
@@ -468,7 +589,7 @@ void ReferenceLJCoulombIxn::calculateEwaldIxn(int numberOfAtoms, vector<Vec3>& a
 
         // accumulate energies
 
-        realSpaceEwaldEnergy        = ONE_4PI_EPS0*atomParameters[ii][QIndex]*atomParameters[jj][QIndex]*inverseR*erfc(alphaR);
+        double realSpaceEwaldEnergy = ONE_4PI_EPS0*atomParameters[ii][QIndex]*atomParameters[jj][QIndex]*inverseR*erfc(alphaR);
 
         totalVdwEnergy             += vdwEnergy;
         totalRealSpaceEwaldEnergy  += realSpaceEwaldEnergy;
@@ -477,78 +598,12 @@ void ReferenceLJCoulombIxn::calculateEwaldIxn(int numberOfAtoms, vector<Vec3>& a
             energyByAtom[ii] += realSpaceEwaldEnergy + vdwEnergy;
             energyByAtom[jj] += realSpaceEwaldEnergy + vdwEnergy;
         }
-
     }
-
-    if (totalEnergy)
-        *totalEnergy += totalRealSpaceEwaldEnergy + totalVdwEnergy;
-
-    // Now subtract off the exclusions, since they were implicitly included in the reciprocal space sum.
-
-    double totalExclusionEnergy = 0.0f;
-    const double TWO_OVER_SQRT_PI = 2/sqrt(PI_M);
-    for (int i = 0; i < numberOfAtoms; i++)
-        for (int exclusion : exclusions[i]) {
-            if (exclusion > i) {
-                int ii = i;
-                int jj = exclusion;
-
-                double deltaR[2][ReferenceForce::LastDeltaRIndex];
-                ReferenceForce::getDeltaR(atomCoordinates[jj], atomCoordinates[ii], deltaR[0]);
-                double r         = deltaR[0][ReferenceForce::RIndex];
-                double inverseR  = 1.0/(deltaR[0][ReferenceForce::RIndex]);
-                double alphaR    = alphaEwald * r;
-                if (erf(alphaR) > 1e-6) {
-                    double dEdR = ONE_4PI_EPS0 * atomParameters[ii][QIndex] * atomParameters[jj][QIndex] * inverseR * inverseR * inverseR;
-                    dEdR = dEdR * (erf(alphaR) - 2 * alphaR * exp (- alphaR * alphaR) / SQRT_PI);
-
-                    // accumulate forces
-
-                    for (int kk = 0; kk < 3; kk++) {
-                        double force = dEdR*deltaR[0][kk];
-                        forces[ii][kk] -= force;
-                        forces[jj][kk] += force;
-                    }
-
-                    // accumulate energies
-
-                    realSpaceEwaldEnergy = ONE_4PI_EPS0*atomParameters[ii][QIndex]*atomParameters[jj][QIndex]*inverseR*erf(alphaR);
-                }
-                else {
-                    realSpaceEwaldEnergy = alphaEwald*TWO_OVER_SQRT_PI*ONE_4PI_EPS0*atomParameters[ii][QIndex]*atomParameters[jj][QIndex];
-                }
-
-                if(ljpme){
-                    // Dispersion terms.  Here we just back out the reciprocal space terms, and don't add any extra real space terms.
-                    double dalphaR   = alphaDispersionEwald * r;
-                    double inverseR2 = inverseR*inverseR;
-                    double dar2 = dalphaR*dalphaR;
-                    double dar4 = dar2*dar2;
-                    double dar6 = dar4*dar2;
-                    double c6i = 8.0*pow(atomParameters[ii][SigIndex], 3.0) * atomParameters[ii][EpsIndex];
-                    double c6j = 8.0*pow(atomParameters[jj][SigIndex], 3.0) * atomParameters[jj][EpsIndex];
-                    realSpaceEwaldEnergy -= c6i*c6j*inverseR2*inverseR2*inverseR2*(1.0 - EXP(-dar2) * (1.0 + dar2 + 0.5*dar4));
-                    double dEdR = -6.0*c6i*c6j*inverseR2*inverseR2*inverseR2*inverseR2*(1.0 - EXP(-dar2) * (1.0 + dar2 + 0.5*dar4 + dar6/6.0));
-                    for (int kk = 0; kk < 3; kk++) {
-                        double force = dEdR*deltaR[0][kk];
-                        forces[ii][kk] -= force;
-                        forces[jj][kk] += force;
-                    }
-                }
-
-                totalExclusionEnergy += realSpaceEwaldEnergy;
-                if (energyByAtom) {
-                    energyByAtom[ii] -= realSpaceEwaldEnergy;
-                    energyByAtom[jj] -= realSpaceEwaldEnergy;
-                }
-            }
-        }
-
-    if (totalEnergy)
-        *totalEnergy -= totalExclusionEnergy;
+    return totalRealSpaceEwaldEnergy + totalVdwEnergy;
 }
 
 
+
 /**---------------------------------------------------------------------------------------
 
    Calculate LJ Coulomb pair ixn
@@ -579,7 +634,40 @@ void ReferenceLJCoulombIxn::calculatePairIxn(int numberOfAtoms, vector<Vec3>& at
     }
     if (!includeDirect)
         return;
-    if (cutoff) {
+    if (threads != NULL && energyByAtom == NULL) {
+        // Divide the work between threads, each accumulating forces and energy into its own buffer.
+
+        int numThreads = threads->getNumThreads();
+        vector<vector<Vec3> > threadForces(numThreads);
+        vector<double> threadEnergy(numThreads, 0.0);
+        threads->execute([&] (ThreadPool& pool, int threadIndex) {
+            threadForces[threadIndex].resize(numberOfAtoms, Vec3());
+            double* localEnergy = (totalEnergy == NULL ? NULL : &threadEnergy[threadIndex]);
+            if (cutoff) {
+                int numPairs = neighborList->size();
+                int start = (threadIndex*numPairs)/numThreads;
+                int end = ((threadIndex+1)*numPairs)/numThreads;
+                for (int index = start; index < end; index++) {
+                    const AtomPair& pair = (*neighborList)[index];
+                    calculateOneIxn(pair.first, pair.second, atomCoordinates, atomParameters, threadForces[threadIndex], NULL, localEnergy);
+                }
+            }
+            else {
+                for (int ii = threadIndex; ii < numberOfAtoms; ii += numThreads)
+                    for (int jj = ii+1; jj < numberOfAtoms; jj++)
+                        if (exclusions[jj].find(ii) == exclusions[jj].end())
+                            calculateOneIxn(ii, jj, atomCoordinates, atomParameters, threadForces[threadIndex], NULL, localEnergy);
+            }
+        });
+        threads->waitForThreads();
+        for (int i = 0; i < numThreads; i++) {
+            if (totalEnergy)
+                *totalEnergy += threadEnergy[i];
+            for (int j = 0; j < numberOfAtoms; j++)
+                forces[j] += threadForces[i][j];
+        }
+    }
+    else if (cutoff) {
         for (auto& pair : *neighborList)
             calculateOneIxn(pair.first, pair.second, atomCoordinates, atomParameters, forces, energyByAtom, totalEnergy);
     }
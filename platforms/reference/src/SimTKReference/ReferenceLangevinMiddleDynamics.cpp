@@ -0,0 +1,202 @@
+
+/* Portions copyright (c) 2017 Stanford University and Simbios.
+ * Contributors: Pande Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cstring>
+#include <sstream>
+
+#include "SimTKOpenMMUtilities.h"
+#include "ReferenceLangevinMiddleDynamics.h"
+#include "ReferenceVirtualSites.h"
+#include "openmm/OpenMMException.h"
+
+using std::vector;
+using namespace OpenMM;
+
+/**---------------------------------------------------------------------------------------
+
+   ReferenceLangevinMiddleDynamics constructor
+
+   @param numberOfAtoms  number of atoms
+   @param deltaT         delta t for dynamics
+   @param friction       friction coefficient
+   @param temperature    temperature
+
+   --------------------------------------------------------------------------------------- */
+
+ReferenceLangevinMiddleDynamics::ReferenceLangevinMiddleDynamics(int numberOfAtoms,
+                                                                 double deltaT, double friction,
+                                                                 double temperature) :
+           ReferenceDynamics(numberOfAtoms, deltaT, temperature), friction(friction) {
+   xPrime.resize(numberOfAtoms);
+   oldx.resize(numberOfAtoms);
+   inverseMasses.resize(numberOfAtoms);
+}
+
+/**---------------------------------------------------------------------------------------
+
+   ReferenceLangevinMiddleDynamics destructor
+
+   --------------------------------------------------------------------------------------- */
+
+ReferenceLangevinMiddleDynamics::~ReferenceLangevinMiddleDynamics() {
+}
+
+/**---------------------------------------------------------------------------------------
+
+   Get friction coefficient
+
+   --------------------------------------------------------------------------------------- */
+
+double ReferenceLangevinMiddleDynamics::getFriction() const {
+   return friction;
+}
+
+/**---------------------------------------------------------------------------------------
+
+   First update; apply the full step velocity kick from the forces
+
+   @param numberOfAtoms       number of atoms
+   @param velocities          velocities
+   @param forces              forces
+   @param inverseMasses       inverse atom masses
+
+   --------------------------------------------------------------------------------------- */
+
+void ReferenceLangevinMiddleDynamics::updatePart1(int numberOfAtoms, vector<Vec3>& velocities,
+                                                  vector<Vec3>& forces, vector<double>& inverseMasses) {
+   double dt = getDeltaT();
+   for (int ii = 0; ii < numberOfAtoms; ii++)
+       if (inverseMasses[ii] != 0.0)
+           velocities[ii] += forces[ii]*(dt*inverseMasses[ii]);
+}
+
+/**---------------------------------------------------------------------------------------
+
+   Second update; half step position update, friction and random force, then another
+   half step position update
+
+   @param numberOfAtoms       number of atoms
+   @param atomCoordinates     atom coordinates
+   @param velocities          velocities
+   @param inverseMasses       inverse atom masses
+   @param xPrime              xPrime
+
+   --------------------------------------------------------------------------------------- */
+
+void ReferenceLangevinMiddleDynamics::updatePart2(int numberOfAtoms, vector<Vec3>& atomCoordinates,
+                                                  vector<Vec3>& velocities,
+                                                  vector<double>& inverseMasses, vector<Vec3>& xPrime) {
+   const double halfdt = 0.5*getDeltaT();
+   const double kT = BOLTZ*getTemperature();
+   const double vscale = exp(-getDeltaT()*getFriction());
+   const double noisescale = sqrt(1-vscale*vscale);
+
+   for (int ii = 0; ii < numberOfAtoms; ii++) {
+       if (inverseMasses[ii] != 0.0) {
+           xPrime[ii] = atomCoordinates[ii] + velocities[ii]*halfdt;
+           double sigma = noisescale*sqrt(kT*inverseMasses[ii]);
+           for (int jj = 0; jj < 3; jj++)
+               velocities[ii][jj] = vscale*velocities[ii][jj] + sigma*SimTKOpenMMUtilities::getNormallyDistributedRandomNumber();
+           xPrime[ii] += velocities[ii]*halfdt;
+           oldx[ii] = xPrime[ii];
+       }
+   }
+}
+
+/**---------------------------------------------------------------------------------------
+
+   Third update; correct the velocities for any position adjustment made by the
+   constraints and record the new positions
+
+   @param numberOfAtoms       number of atoms
+   @param atomCoordinates     atom coordinates
+   @param velocities          velocities
+   @param inverseMasses       inverse atom masses
+   @param xPrime              xPrime
+
+   --------------------------------------------------------------------------------------- */
+
+void ReferenceLangevinMiddleDynamics::updatePart3(int numberOfAtoms, vector<Vec3>& atomCoordinates,
+                                                  vector<Vec3>& velocities, vector<double>& inverseMasses,
+                                                  vector<Vec3>& xPrime) {
+   double invStepSize = 1.0/getDeltaT();
+   for (int i = 0; i < numberOfAtoms; ++i)
+       if (inverseMasses[i] != 0) {
+            velocities[i] += (xPrime[i]-oldx[i])*invStepSize;
+            atomCoordinates[i] = xPrime[i];
+       }
+}
+
+/**---------------------------------------------------------------------------------------
+
+   Update -- driver routine for performing LFMiddle Langevin dynamics update of
+   coordinates and velocities
+
+   @param system              the System to be integrated
+   @param atomCoordinates     atom coordinates
+   @param velocities          velocities
+   @param forces              forces
+   @param masses              atom masses
+
+   --------------------------------------------------------------------------------------- */
+
+void ReferenceLangevinMiddleDynamics::update(const OpenMM::System& system, vector<Vec3>& atomCoordinates,
+                                             vector<Vec3>& velocities, vector<Vec3>& forces, vector<double>& masses, double tolerance) {
+   // first-time-through initialization
+
+   int numberOfAtoms = system.getNumParticles();
+   if (getTimeStep() == 0) {
+      // invert masses
+
+      for (int ii = 0; ii < numberOfAtoms; ii++) {
+         if (masses[ii] == 0.0)
+             inverseMasses[ii] = 0.0;
+         else
+             inverseMasses[ii] = 1.0/masses[ii];
+      }
+   }
+
+   // 1st update
+
+   updatePart1(numberOfAtoms, velocities, forces, inverseMasses);
+
+   ReferenceConstraintAlgorithm* referenceConstraintAlgorithm = getReferenceConstraintAlgorithm();
+   if (referenceConstraintAlgorithm)
+      referenceConstraintAlgorithm->applyToVelocities(atomCoordinates, velocities, inverseMasses, tolerance);
+
+   // 2nd update
+
+   updatePart2(numberOfAtoms, atomCoordinates, velocities, inverseMasses, xPrime);
+
+   if (referenceConstraintAlgorithm)
+      referenceConstraintAlgorithm->apply(atomCoordinates, xPrime, inverseMasses, tolerance);
+
+   // copy xPrime -> atomCoordinates
+
+   updatePart3(numberOfAtoms, atomCoordinates, velocities, inverseMasses, xPrime);
+
+   if (getVirtualSites() != NULL)
+      getVirtualSites()->computePositions(atomCoordinates);
+   incrementTimeStep();
+}
@@ -121,13 +121,16 @@ public:
     }
 
     void getNeighbors(
-            NeighborList& neighbors, 
-            const VoxelItem& referencePoint, 
-            const vector<set<int> >& exclusions,
+            NeighborList& neighbors,
+            const VoxelItem& referencePoint,
+            const vector<set<int> >* exclusions,
             bool reportSymmetricPairs,
-            double maxDistance, 
-            double minDistance) const 
+            double maxDistance,
+            double minDistance) const
     {
+        // If exclusions is NULL, the reference point does not belong to the set of atoms in
+        // the hash, so self hits and exclusions do not apply.
+
 
         // Loop over neighboring voxels
         // TODO use more clever selection of neighboring voxels
@@ -190,14 +193,14 @@ public:
                         const Vec3& locationJ = *item.first;
                         
                         // Ignore self hits
-                        if (atomI == atomJ) continue;
-                        
+                        if (exclusions != NULL && atomI == atomJ) continue;
+
                         double dSquared = compPairDistanceSquared(locationI, locationJ, periodicBoxVectors, usePeriodic);
                         if (dSquared > maxDistanceSquared) continue;
                         if (dSquared < minDistanceSquared) continue;
-                        
+
                         // Ignore exclusions.
-                        if (exclusions[atomI].find(atomJ) != exclusions[atomI].end()) continue;
+                        if (exclusions != NULL && (*exclusions)[atomI].find(atomJ) != (*exclusions)[atomI].end()) continue;
                         
                         neighbors.push_back(AtomPair(atomI, atomJ));
                         if (reportSymmetricPairs)
@@ -246,16 +249,47 @@ void OPENMM_EXPORT computeNeighborListVoxelHash(
         // 1) Find other atoms that are close to this one
         const Vec3& location = atomLocations[atomJ];
         voxelHash.getNeighbors(
-            neighborList, 
+            neighborList,
             VoxelItem(&location, atomJ),
-            exclusions,
-            reportSymmetricPairs, 
-            maxDistance, 
+            &exclusions,
+            reportSymmetricPairs,
+            maxDistance,
             minDistance);
-            
+
         // 2) Add this atom to the voxelHash
         voxelHash.insert(atomJ, location);
     }
 }
 
+// O(n) method for finding all pairs between two distinct sets of locations that are within
+// a cutoff of each other, using the voxel hash data structure.  Each reported pair contains
+// an index into the first list followed by an index into the second list.
+void OPENMM_EXPORT computeBipartiteNeighborListVoxelHash(
+                              NeighborList& neighborList,
+                              const AtomLocationList& locations1,
+                              const AtomLocationList& locations2,
+                              const Vec3* periodicBoxVectors,
+                              bool usePeriodic,
+                              double maxDistance
+                            )
+{
+    neighborList.clear();
+
+    double edgeSizeX, edgeSizeY, edgeSizeZ;
+    if (!usePeriodic)
+        edgeSizeX = edgeSizeY = edgeSizeZ = maxDistance; // TODO - adjust this as needed
+    else {
+        edgeSizeX = 0.5*periodicBoxVectors[0][0]/floor(periodicBoxVectors[0][0]/maxDistance);
+        edgeSizeY = 0.5*periodicBoxVectors[1][1]/floor(periodicBoxVectors[1][1]/maxDistance);
+        edgeSizeZ = 0.5*periodicBoxVectors[2][2]/floor(periodicBoxVectors[2][2]/maxDistance);
+    }
+    VoxelHash voxelHash(edgeSizeX, edgeSizeY, edgeSizeZ, periodicBoxVectors, usePeriodic);
+    for (AtomIndex atomJ = 0; atomJ < (AtomIndex) locations2.size(); ++atomJ)
+        voxelHash.insert(atomJ, locations2[atomJ]);
+    for (AtomIndex atomI = 0; atomI < (AtomIndex) locations1.size(); ++atomI) {
+        const Vec3& location = locations1[atomI];
+        voxelHash.getNeighbors(neighborList, VoxelItem(&location, atomI), NULL, false, maxDistance, 0.0);
+    }
+}
+
 } // namespace OpenMM
@@ -0,0 +1,141 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2013 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "ReferenceSHAKEAlgorithm.h"
+#include <cmath>
+
+using namespace OpenMM;
+using namespace std;
+
+ReferenceSHAKEAlgorithm::ReferenceSHAKEAlgorithm(const vector<int>& centralAtom, const vector<vector<int> >& peripheralAtom,
+        const vector<vector<double> >& distance) :
+        centralAtom(centralAtom), peripheralAtom(peripheralAtom), distance(distance) {
+}
+
+int ReferenceSHAKEAlgorithm::getNumClusters() const {
+    return centralAtom.size();
+}
+
+void ReferenceSHAKEAlgorithm::apply(vector<OpenMM::Vec3>& atomCoordinates, vector<OpenMM::Vec3>& atomCoordinatesP, vector<double>& inverseMasses, double tolerance) {
+    for (int index = 0; index < (int) centralAtom.size(); ++index) {
+        int central = centralAtom[index];
+        const vector<int>& peripheral = peripheralAtom[index];
+        int numPeripheral = peripheral.size();
+        double invMassCentral = inverseMasses[central];
+        Vec3 pos = atomCoordinates[central];
+        Vec3 xpi = atomCoordinatesP[central]-pos;
+        Vec3 posj[3], xpj[3], rij[3];
+        double rijsq[3], ld[3], d2[3];
+        for (int i = 0; i < numPeripheral; i++) {
+            posj[i] = atomCoordinates[peripheral[i]];
+            xpj[i] = atomCoordinatesP[peripheral[i]]-posj[i];
+            rij[i] = pos-posj[i];
+            rijsq[i] = rij[i].dot(rij[i]);
+            d2[i] = distance[index][i]*distance[index][i];
+            ld[i] = d2[i]-rijsq[i];
+        }
+
+        // Iterate until convergence.
+
+        bool converged = false;
+        int iteration = 0;
+        while (iteration < 15 && !converged) {
+            converged = true;
+            for (int i = 0; i < numPeripheral; i++) {
+                Vec3 rpij = xpi-xpj[i];
+                double rpsqij = rpij.dot(rpij);
+                double rrpr = rij[i].dot(rpij);
+                double diff = fabs(ld[i]-2.0*rrpr-rpsqij) / (d2[i]*tolerance);
+                if (diff >= 1.0) {
+                    double invMassPeripheral = inverseMasses[peripheral[i]];
+                    double avgMass = 0.5/(invMassCentral+invMassPeripheral);
+                    double acor = (ld[i]-2.0*rrpr-rpsqij)*avgMass / (rrpr+rijsq[i]);
+                    Vec3 dr = rij[i]*acor;
+                    xpi += dr*invMassCentral;
+                    xpj[i] -= dr*invMassPeripheral;
+                    converged = false;
+                }
+            }
+            iteration++;
+        }
+
+        // Record the new positions.
+
+        atomCoordinatesP[central] = xpi+pos;
+        for (int i = 0; i < numPeripheral; i++)
+            atomCoordinatesP[peripheral[i]] = xpj[i]+posj[i];
+    }
+}
+
+void ReferenceSHAKEAlgorithm::applyToVelocities(vector<OpenMM::Vec3>& atomCoordinates, vector<OpenMM::Vec3>& velocities, vector<double>& inverseMasses, double tolerance) {
+    for (int index = 0; index < (int) centralAtom.size(); ++index) {
+        int central = centralAtom[index];
+        const vector<int>& peripheral = peripheralAtom[index];
+        int numPeripheral = peripheral.size();
+        double invMassCentral = inverseMasses[central];
+        Vec3 pos = atomCoordinates[central];
+        Vec3 vi = velocities[central];
+        Vec3 vj[3], rij[3];
+        double rijsq[3];
+        for (int i = 0; i < numPeripheral; i++) {
+            vj[i] = velocities[peripheral[i]];
+            rij[i] = pos-atomCoordinates[peripheral[i]];
+            rijsq[i] = rij[i].dot(rij[i]);
+        }
+
+        // Iterate until convergence.
+
+        bool converged = false;
+        int iteration = 0;
+        while (iteration < 15 && !converged) {
+            converged = true;
+            for (int i = 0; i < numPeripheral; i++) {
+                Vec3 rvij = vi-vj[i];
+                double rrpr = rij[i].dot(rvij);
+                double invMassPeripheral = inverseMasses[peripheral[i]];
+                double avgMass = 0.5/(invMassCentral+invMassPeripheral);
+                double delta = -2.0*avgMass*rrpr/rijsq[i];
+                Vec3 dr = rij[i]*delta;
+                vi += dr*invMassCentral;
+                vj[i] -= dr*invMassPeripheral;
+                if (fabs(delta) > tolerance)
+                    converged = false;
+            }
+            iteration++;
+        }
+
+        // Record the new velocities.
+
+        velocities[central] = vi;
+        for (int i = 0; i < numPeripheral; i++)
+            velocities[peripheral[i]] = vj[i];
+    }
+}
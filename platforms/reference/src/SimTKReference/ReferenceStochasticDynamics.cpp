@@ -189,6 +189,7 @@ void ReferenceStochasticDynamics::update(const OpenMM::System& system, vector<Ve
 
    updatePart3(numberOfAtoms, atomCoordinates, velocities, inverseMasses, xPrime);
 
-   ReferenceVirtualSites::computePositions(system, atomCoordinates);
+   if (getVirtualSites() != NULL)
+      getVirtualSites()->computePositions(atomCoordinates);
    incrementTimeStep();
 }
@@ -233,6 +233,7 @@ void ReferenceVariableStochasticDynamics::update(const OpenMM::System& system, v
        }
    }
 
-   ReferenceVirtualSites::computePositions(system, atomCoordinates);
+   if (getVirtualSites() != NULL)
+      getVirtualSites()->computePositions(atomCoordinates);
    incrementTimeStep();
 }
@@ -149,7 +149,8 @@ void ReferenceVariableVerletDynamics::update(const OpenMM::System& system, vecto
                atomCoordinates[i][j] = xPrime[i][j];
            }
    }
-   ReferenceVirtualSites::computePositions(system, atomCoordinates);
+   if (getVirtualSites() != NULL)
+      getVirtualSites()->computePositions(atomCoordinates);
    incrementTimeStep();
 }
 
@@ -114,6 +114,7 @@ void ReferenceVerletDynamics::update(const OpenMM::System& system, vector<Vec3>&
            }
    }
 
-   ReferenceVirtualSites::computePositions(system, atomCoordinates);
+   if (getVirtualSites() != NULL)
+      getVirtualSites()->computePositions(atomCoordinates);
    incrementTimeStep();
 }
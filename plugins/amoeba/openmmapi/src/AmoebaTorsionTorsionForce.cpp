@@ -131,7 +131,7 @@ AmoebaTorsionTorsionForce::TorsionTorsionGridInfo::TorsionTorsionGridInfo(const
         for (int i = 0; i < ysize; i++)
             y[i] = _grid[0][i][1];
         vector<double> d1(xsize*ysize), d2(xsize*ysize), d12(xsize*ysize);
-        vector<double> t(xsize), deriv(xsize);
+        vector<double> t(xsize), deriv(xsize), knotDeriv(xsize);
         for (int i = 0; i < ysize; i++) {
             for (int j = 0; j < xsize; j++)
                 t[j] = _grid[j][i][2];
@@ -139,8 +139,9 @@ AmoebaTorsionTorsionForce::TorsionTorsionGridInfo::TorsionTorsionGridInfo(const
                 SplineFitter::createPeriodicSpline(x, t, deriv);
             else
                 SplineFitter::createNaturalSpline(x, t, deriv);
+            SplineFitter::evaluateSplineDerivativesAtKnots(x, t, deriv, knotDeriv);
             for (int j = 0; j < xsize; j++)
-                d1[j+xsize*i] = SplineFitter::evaluateSplineDerivative(x, t, deriv, x[j]);
+                d1[j+xsize*i] = knotDeriv[j];
         }
 
         // Compute derivatives with respect to the second angle.
@@ -154,8 +155,9 @@ AmoebaTorsionTorsionForce::TorsionTorsionGridInfo::TorsionTorsionGridInfo(const
                 SplineFitter::createPeriodicSpline(y, t, deriv);
             else
                 SplineFitter::createNaturalSpline(y, t, deriv);
+            SplineFitter::evaluateSplineDerivativesAtKnots(y, t, deriv, knotDeriv);
             for (int j = 0; j < ysize; j++)
-                d2[i+xsize*j] = SplineFitter::evaluateSplineDerivative(y, t, deriv, y[j]);
+                d2[i+xsize*j] = knotDeriv[j];
         }
 
         // Compute cross derivatives.
@@ -169,8 +171,9 @@ AmoebaTorsionTorsionForce::TorsionTorsionGridInfo::TorsionTorsionGridInfo(const
                 SplineFitter::createPeriodicSpline(x, t, deriv);
             else
                 SplineFitter::createNaturalSpline(x, t, deriv);
+            SplineFitter::evaluateSplineDerivativesAtKnots(x, t, deriv, knotDeriv);
             for (int j = 0; j < xsize; j++)
-                d12[j+xsize*i] = SplineFitter::evaluateSplineDerivative(x, t, deriv, x[j]);
+                d12[j+xsize*i] = knotDeriv[j];
         }
         
         // Add the derivatives to the grid.
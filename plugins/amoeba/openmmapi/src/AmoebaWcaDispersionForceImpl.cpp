@@ -138,4 +138,5 @@ std::vector<std::string> AmoebaWcaDispersionForceImpl::getKernelNames() {
 
 void AmoebaWcaDispersionForceImpl::updateParametersInContext(ContextImpl& context) {
     kernel.getAs<CalcAmoebaWcaDispersionForceKernel>().copyParametersToContext(context, owner);
+    context.systemChanged();
 }
@@ -821,7 +821,7 @@ CudaCalcAmoebaMultipoleForceKernel::CudaCalcAmoebaMultipoleForceKernel(std::stri
         extrapolatedDipoleGk(NULL), extrapolatedDipoleGkPolar(NULL), inducedDipoleFieldGradient(NULL), inducedDipoleFieldGradientPolar(NULL),
         inducedDipoleFieldGradientGk(NULL), inducedDipoleFieldGradientGkPolar(NULL), extrapolatedDipoleFieldGradient(NULL), extrapolatedDipoleFieldGradientPolar(NULL),
         extrapolatedDipoleFieldGradientGk(NULL), extrapolatedDipoleFieldGradientGkPolar(NULL), covalentFlags(NULL), polarizationGroupFlags(NULL),
-        pmeGrid(NULL), pmeBsplineModuliX(NULL), pmeBsplineModuliY(NULL), pmeBsplineModuliZ(NULL), pmeIgrid(NULL), pmePhi(NULL),
+        pmeGrid(NULL), ownsPmeGrid(true), pmeBsplineModuliX(NULL), pmeBsplineModuliY(NULL), pmeBsplineModuliZ(NULL), pmeIgrid(NULL), pmePhi(NULL),
         pmePhid(NULL), pmePhip(NULL), pmePhidp(NULL), pmeCphi(NULL), lastPositions(NULL), sort(NULL), gkKernel(NULL) {
 }
 
@@ -907,7 +907,7 @@ CudaCalcAmoebaMultipoleForceKernel::~CudaCalcAmoebaMultipoleForceKernel() {
         delete covalentFlags;
     if (polarizationGroupFlags != NULL)
         delete polarizationGroupFlags;
-    if (pmeGrid != NULL)
+    if (pmeGrid != NULL && ownsPmeGrid)
         delete pmeGrid;
     if (pmeBsplineModuliX != NULL)
         delete pmeBsplineModuliX;
@@ -1274,8 +1274,17 @@ void CudaCalcAmoebaMultipoleForceKernel::initialize(const System& system, const
         // Create required data structures.
 
         int elementSize = (cu.getUseDoublePrecision() ? sizeof(double) : sizeof(float));
-        pmeGrid = new CudaArray(cu, gridSizeX*gridSizeY*gridSizeZ, 2*elementSize, "pmeGrid");
-        cu.addAutoclearBuffer(*pmeGrid);
+        // The grid only holds data within a single evaluation, so if another force (such as a
+        // standard NonbondedForce evaluating PME on the default stream) has registered a large
+        // enough grid with the context, share its allocation instead of creating another one.
+
+        pmeGrid = cu.findPmeGrid((long long) gridSizeX*gridSizeY*gridSizeZ*2*elementSize, 0);
+        ownsPmeGrid = (pmeGrid == NULL);
+        if (ownsPmeGrid) {
+            pmeGrid = new CudaArray(cu, gridSizeX*gridSizeY*gridSizeZ, 2*elementSize, "pmeGrid");
+            cu.addAutoclearBuffer(*pmeGrid);
+            cu.registerPmeGrid(pmeGrid);
+        }
         pmeBsplineModuliX = new CudaArray(cu, gridSizeX, elementSize, "pmeBsplineModuliX");
         pmeBsplineModuliY = new CudaArray(cu, gridSizeY, elementSize, "pmeBsplineModuliY");
         pmeBsplineModuliZ = new CudaArray(cu, gridSizeZ, elementSize, "pmeBsplineModuliZ");
@@ -1574,13 +1583,18 @@ double CudaCalcAmoebaMultipoleForceKernel::execute(ContextImpl& context, bool in
         void* pmeTransformMultipolesArgs[] = {&labFrameDipoles->getDevicePointer(), &labFrameQuadrupoles->getDevicePointer(),
             &fracDipoles->getDevicePointer(), &fracQuadrupoles->getDevicePointer(), recipBoxVectorPointer[0], recipBoxVectorPointer[1], recipBoxVectorPointer[2]};
         cu.executeKernel(pmeTransformMultipolesKernel, pmeTransformMultipolesArgs, cu.getNumAtoms());
+        if (cu.isPmeGridShared(pmeGrid)) {
+            // Another force may have used the grid since it was autocleared.
+
+            cu.clearBuffer(*pmeGrid);
+        }
         void* pmeSpreadFixedMultipolesArgs[] = {&cu.getPosq().getDevicePointer(), &fracDipoles->getDevicePointer(), &fracQuadrupoles->getDevicePointer(),
             &pmeGrid->getDevicePointer(), cu.getPeriodicBoxVecXPointer(), cu.getPeriodicBoxVecYPointer(), cu.getPeriodicBoxVecZPointer(),
             recipBoxVectorPointer[0], recipBoxVectorPointer[1], recipBoxVectorPointer[2]};
         cu.executeKernel(pmeSpreadFixedMultipolesKernel, pmeSpreadFixedMultipolesArgs, cu.getNumAtoms());
         void* finishSpreadArgs[] = {&pmeGrid->getDevicePointer()};
         if (cu.getUseDoublePrecision())
-            cu.executeKernel(pmeFinishSpreadChargeKernel, finishSpreadArgs, pmeGrid->getSize());
+            cu.executeKernel(pmeFinishSpreadChargeKernel, finishSpreadArgs, gridSizeX*gridSizeY*gridSizeZ);
         if (cu.getUseDoublePrecision())
             cufftExecZ2Z(fft, (double2*) pmeGrid->getDevicePointer(), (double2*) pmeGrid->getDevicePointer(), CUFFT_FORWARD);
         else
@@ -1626,7 +1640,7 @@ double CudaCalcAmoebaMultipoleForceKernel::execute(ContextImpl& context, bool in
             recipBoxVectorPointer[0], recipBoxVectorPointer[1], recipBoxVectorPointer[2]};
         cu.executeKernel(pmeSpreadInducedDipolesKernel, pmeSpreadInducedDipolesArgs, cu.getNumAtoms());
         if (cu.getUseDoublePrecision())
-            cu.executeKernel(pmeFinishSpreadChargeKernel, finishSpreadArgs, pmeGrid->getSize());
+            cu.executeKernel(pmeFinishSpreadChargeKernel, finishSpreadArgs, gridSizeX*gridSizeY*gridSizeZ);
         if (cu.getUseDoublePrecision())
             cufftExecZ2Z(fft, (double2*) pmeGrid->getDevicePointer(), (double2*) pmeGrid->getDevicePointer(), CUFFT_FORWARD);
         else
@@ -1772,7 +1786,7 @@ void CudaCalcAmoebaMultipoleForceKernel::computeInducedField(void** recipBoxVect
         cu.executeKernel(pmeSpreadInducedDipolesKernel, pmeSpreadInducedDipolesArgs, cu.getNumAtoms());
         if (cu.getUseDoublePrecision()) {
             void* finishSpreadArgs[] = {&pmeGrid->getDevicePointer()};
-            cu.executeKernel(pmeFinishSpreadChargeKernel, finishSpreadArgs, pmeGrid->getSize());
+            cu.executeKernel(pmeFinishSpreadChargeKernel, finishSpreadArgs, gridSizeX*gridSizeY*gridSizeZ);
         }
         if (cu.getUseDoublePrecision())
             cufftExecZ2Z(fft, (double2*) pmeGrid->getDevicePointer(), (double2*) pmeGrid->getDevicePointer(), CUFFT_FORWARD);
@@ -2539,7 +2553,7 @@ private:
 };
 
 CudaCalcAmoebaVdwForceKernel::CudaCalcAmoebaVdwForceKernel(std::string name, const Platform& platform, CudaContext& cu, const System& system) :
-        CalcAmoebaVdwForceKernel(name, platform), cu(cu), system(system), hasInitializedNonbonded(false), sigmaEpsilon(NULL),
+        CalcAmoebaVdwForceKernel(name, platform), cu(cu), system(system), hasInitializedNonbonded(false), hasReductions(false), sigmaEpsilon(NULL),
         bondReductionAtoms(NULL), bondReductionFactors(NULL), tempPosq(NULL), tempForces(NULL), nonbonded(NULL) {
 }
 
@@ -2564,11 +2578,9 @@ void CudaCalcAmoebaVdwForceKernel::initialize(const System& system, const Amoeba
     sigmaEpsilon = CudaArray::create<float2>(cu, cu.getPaddedNumAtoms(), "sigmaEpsilon");
     bondReductionAtoms = CudaArray::create<int>(cu, cu.getPaddedNumAtoms(), "bondReductionAtoms");
     bondReductionFactors = CudaArray::create<float>(cu, cu.getPaddedNumAtoms(), "sigmaEpsilon");
-    tempPosq = new CudaArray(cu, cu.getPaddedNumAtoms(), cu.getUseDoublePrecision() ? sizeof(double4) : sizeof(float4), "tempPosq");
-    tempForces = CudaArray::create<long long>(cu, 3*cu.getPaddedNumAtoms(), "tempForces");
-    
+
     // Record atom parameters.
-    
+
     vector<float2> sigmaEpsilonVec(cu.getPaddedNumAtoms(), make_float2(0, 1));
     vector<int> bondReductionAtomsVec(cu.getPaddedNumAtoms(), 0);
     vector<float> bondReductionFactorsVec(cu.getPaddedNumAtoms(), 0);
@@ -2580,9 +2592,15 @@ void CudaCalcAmoebaVdwForceKernel::initialize(const System& system, const Amoeba
         sigmaEpsilonVec[i] = make_float2((float) sigma, (float) epsilon);
         bondReductionAtomsVec[i] = ivIndex;
         bondReductionFactorsVec[i] = (float) reductionFactor;
+        if (ivIndex != i && reductionFactor != 1.0)
+            hasReductions = true;
         force.getParticleExclusions(i, exclusions[i]);
         exclusions[i].push_back(i);
     }
+    if (hasReductions) {
+        tempPosq = new CudaArray(cu, cu.getPaddedNumAtoms(), cu.getUseDoublePrecision() ? sizeof(double4) : sizeof(float4), "tempPosq");
+        tempForces = CudaArray::create<long long>(cu, 3*cu.getPaddedNumAtoms(), "tempForces");
+    }
     sigmaEpsilon->upload(sigmaEpsilonVec);
     bondReductionAtoms->upload(bondReductionAtomsVec);
     bondReductionFactors->upload(bondReductionFactorsVec);
@@ -2593,8 +2611,10 @@ void CudaCalcAmoebaVdwForceKernel::initialize(const System& system, const Amoeba
  
     // This force is applied based on modified atom positions, where hydrogens have been moved slightly
     // closer to their parent atoms.  We therefore create a separate CudaNonbondedUtilities just for
-    // this force, so it will have its own neighbor list and interaction kernel.
-    
+    // this force, so it will have its own neighbor list and interaction kernel.  The main neighbor
+    // list cannot be reused: it is built from the unmodified positions, and it omits block pairs
+    // covered by the main force's exclusions, which do not match this force's exclusions.
+
     nonbonded = new CudaNonbondedUtilities(cu);
     nonbonded->addParameter(CudaNonbondedUtilities::ParameterInfo("sigmaEpsilon", "float", 2, sizeof(float2), sigmaEpsilon->getDevicePointer()));
     
@@ -2647,17 +2667,21 @@ double CudaCalcAmoebaVdwForceKernel::execute(ContextImpl& context, bool includeF
         hasInitializedNonbonded = true;
         nonbonded->initialize(system);
     }
-    cu.getPosq().copyTo(*tempPosq);
-    cu.getForce().copyTo(*tempForces);
-    void* prepareArgs[] = {&cu.getForce().getDevicePointer(), &cu.getPosq().getDevicePointer(), &tempPosq->getDevicePointer(),
-        &bondReductionAtoms->getDevicePointer(), &bondReductionFactors->getDevicePointer()};
-    cu.executeKernel(prepareKernel, prepareArgs, cu.getPaddedNumAtoms());
+    if (hasReductions) {
+        cu.getPosq().copyTo(*tempPosq);
+        cu.getForce().copyTo(*tempForces);
+        void* prepareArgs[] = {&cu.getForce().getDevicePointer(), &cu.getPosq().getDevicePointer(), &tempPosq->getDevicePointer(),
+            &bondReductionAtoms->getDevicePointer(), &bondReductionFactors->getDevicePointer()};
+        cu.executeKernel(prepareKernel, prepareArgs, cu.getPaddedNumAtoms());
+    }
     nonbonded->prepareInteractions(1);
     nonbonded->computeInteractions(1, includeForces, includeEnergy);
-    void* spreadArgs[] = {&cu.getForce().getDevicePointer(), &tempForces->getDevicePointer(), &bondReductionAtoms->getDevicePointer(), &bondReductionFactors->getDevicePointer()};
-    cu.executeKernel(spreadKernel, spreadArgs, cu.getPaddedNumAtoms());
-    tempPosq->copyTo(cu.getPosq());
-    tempForces->copyTo(cu.getForce());
+    if (hasReductions) {
+        void* spreadArgs[] = {&cu.getForce().getDevicePointer(), &tempForces->getDevicePointer(), &bondReductionAtoms->getDevicePointer(), &bondReductionFactors->getDevicePointer()};
+        cu.executeKernel(spreadKernel, spreadArgs, cu.getPaddedNumAtoms());
+        tempPosq->copyTo(cu.getPosq());
+        tempForces->copyTo(cu.getForce());
+    }
     double4 box = cu.getPeriodicBoxSize();
     return dispersionCoefficient/(box.x*box.y*box.z);
 }
@@ -2681,6 +2705,12 @@ void CudaCalcAmoebaVdwForceKernel::copyParametersToContext(ContextImpl& context,
         sigmaEpsilonVec[i] = make_float2((float) sigma, (float) epsilon);
         bondReductionAtomsVec[i] = ivIndex;
         bondReductionFactorsVec[i] = (float) reductionFactor;
+        if (ivIndex != i && reductionFactor != 1.0)
+            hasReductions = true;
+    }
+    if (hasReductions && tempPosq == NULL) {
+        tempPosq = new CudaArray(cu, cu.getPaddedNumAtoms(), cu.getUseDoublePrecision() ? sizeof(double4) : sizeof(float4), "tempPosq");
+        tempForces = CudaArray::create<long long>(cu, 3*cu.getPaddedNumAtoms(), "tempForces");
     }
     sigmaEpsilon->upload(sigmaEpsilonVec);
     bondReductionAtoms->upload(bondReductionAtomsVec);
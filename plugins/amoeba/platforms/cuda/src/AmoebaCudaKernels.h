@@ -455,6 +455,7 @@ private:
     CudaArray* covalentFlags;
     CudaArray* polarizationGroupFlags;
     CudaArray* pmeGrid;
+    bool ownsPmeGrid;
     CudaArray* pmeBsplineModuliX;
     CudaArray* pmeBsplineModuliY;
     CudaArray* pmeBsplineModuliZ;
@@ -591,6 +592,7 @@ private:
     CudaContext& cu;
     const System& system;
     bool hasInitializedNonbonded;
+    bool hasReductions;
     double dispersionCoefficient;
     CudaArray* sigmaEpsilon;
     CudaArray* bondReductionAtoms;
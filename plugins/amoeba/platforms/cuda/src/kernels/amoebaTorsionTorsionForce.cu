@@ -118,36 +118,36 @@ posIndex1 += (int) gridParams.x;
 int posIndex2 = index2 + (index1+1)*(int) gridParams.w;
 posIndex2 += (int) gridParams.x;
 
-// load grid points surrounding angle
+// load grid points surrounding angle, reading each point as a single vector load
 
 real4 y;
 real4 y1;
 real4 y2;
 real4 y12;
 
-int localIndex = posIndex1;
-y.x = GRID_VALUES[localIndex].x;
-y1.x = GRID_VALUES[localIndex].y;
-y2.x = GRID_VALUES[localIndex].z;
-y12.x = GRID_VALUES[localIndex].w;
-
-localIndex = posIndex2;
-y.y = GRID_VALUES[localIndex].x;
-y1.y = GRID_VALUES[localIndex].y;
-y2.y = GRID_VALUES[localIndex].z;
-y12.y = GRID_VALUES[localIndex].w;
-
-localIndex = posIndex2 + 1;
-y.z = GRID_VALUES[localIndex].x;
-y1.z = GRID_VALUES[localIndex].y;
-y2.z = GRID_VALUES[localIndex].z;
-y12.z = GRID_VALUES[localIndex].w;
-
-localIndex = posIndex1 + 1;
-y.w = GRID_VALUES[localIndex].x;
-y1.w = GRID_VALUES[localIndex].y;
-y2.w = GRID_VALUES[localIndex].z;
-y12.w = GRID_VALUES[localIndex].w;
+float4 gridPoint = GRID_VALUES[posIndex1];
+y.x = gridPoint.x;
+y1.x = gridPoint.y;
+y2.x = gridPoint.z;
+y12.x = gridPoint.w;
+
+gridPoint = GRID_VALUES[posIndex2];
+y.y = gridPoint.x;
+y1.y = gridPoint.y;
+y2.y = gridPoint.z;
+y12.y = gridPoint.w;
+
+gridPoint = GRID_VALUES[posIndex2 + 1];
+y.z = gridPoint.x;
+y1.z = gridPoint.y;
+y2.z = gridPoint.z;
+y12.z = gridPoint.w;
+
+gridPoint = GRID_VALUES[posIndex1 + 1];
+y.w = gridPoint.x;
+y1.w = gridPoint.y;
+y2.w = gridPoint.z;
+y12.w = gridPoint.w;
 
 // perform interpolation
 
@@ -3,17 +3,10 @@
 
 typedef struct {
     real3 pos, force;
+    real rmixo, rmixh, emixo, emixh;
     float radius, epsilon, padding;
 } AtomData;
 
-inline __device__ void loadAtomData(AtomData& data, int atom, const real4* __restrict__ posq, const float2* __restrict__ radiusEpsilon) {
-    real4 atomPosq = posq[atom];
-    data.pos = make_real3(atomPosq.x, atomPosq.y, atomPosq.z);
-    float2 temp = radiusEpsilon[atom];
-    data.radius = temp.x;
-    data.epsilon = temp.y;
-}
-
 __device__ void initParticleParameters(float radius, float epsilon, real& rmixo, real& rmixh, real& emixo, real& emixh) {
     real sqrtEps = SQRT(epsilon);
     real denominator = SQRT(EPSO) + sqrtEps;
@@ -21,15 +14,33 @@ __device__ void initParticleParameters(float radius, float epsilon, real& rmixo,
     denominator = SQRT(EPSH) + sqrtEps;
     emixh = 4*EPSH*epsilon / (denominator*denominator);
     real radius2 = radius*radius;
-    real rmino2 = RMINO*RMINO; 
+    real rmino2 = RMINO*RMINO;
     rmixo = 2*(rmino2*RMINO + radius2*radius) / (rmino2 + radius2);
     real rminh2 = RMINH*RMINH;
     rmixh = 2*(rminh2*RMINH + radius2*radius) / (rminh2+radius2);
 }
 
-__device__ void computeOneInteraction(AtomData& atom1, AtomData& atom2, real rmixo, real rmixh, real emixo, real emixh, real3& force, real& energy) {
+inline __device__ void loadAtomData(AtomData& data, int atom, const real4* __restrict__ posq, const float2* __restrict__ radiusEpsilon) {
+    real4 atomPosq = posq[atom];
+    data.pos = make_real3(atomPosq.x, atomPosq.y, atomPosq.z);
+    float2 temp = radiusEpsilon[atom];
+    data.radius = temp.x;
+    data.epsilon = temp.y;
+
+    // The mixed parameters depend only on this atom, so compute them once at load
+    // time instead of once per interaction.
+
+    initParticleParameters(data.radius, data.epsilon, data.rmixo, data.rmixh, data.emixo, data.emixh);
+}
+
+__device__ void computeOneInteraction(AtomData& atom1, AtomData& atom2, real3& force, real& energy) {
+    real rmixo = atom1.rmixo;
+    real rmixh = atom1.rmixh;
+    real emixo = atom1.emixo;
+    real emixh = atom1.emixh;
+
     // get deltaR and r between 2 atoms
-    
+
     force = atom2.pos - atom1.pos;
     real r2 = dot(force, force);
     if (r2 <= 0) {
@@ -219,8 +230,6 @@ extern "C" __global__ void computeWCAForce(unsigned long long* __restrict__ forc
             unsigned int atom1 = x*TILE_SIZE + tgx;
             loadAtomData(data, atom1, posq, radiusEpsilon);
             loadAtomData(localData[threadIdx.x], y*TILE_SIZE+tgx, posq, radiusEpsilon);
-            real emixo, emixh, rmixo, rmixh;
-            initParticleParameters(data.radius, data.epsilon, rmixo, rmixh, emixo, emixh);
             data.force = make_real3(0);
             localData[threadIdx.x].force = make_real3(0);
 
@@ -232,13 +241,11 @@ extern "C" __global__ void computeWCAForce(unsigned long long* __restrict__ forc
                 if (atom1 != atom2 && atom1 < NUM_ATOMS && atom2 < NUM_ATOMS) {
                     real3 tempForce;
                     real tempEnergy;
-                    computeOneInteraction(data, localData[tbx+tj], rmixo, rmixh, emixo, emixh, tempForce, tempEnergy);
+                    computeOneInteraction(data, localData[tbx+tj], tempForce, tempEnergy);
                     data.force += tempForce;
                     localData[tbx+tj].force -= tempForce;
                     energy += (x == y ? 0.5f*tempEnergy : tempEnergy);
-                    real emjxo, emjxh, rmjxo, rmjxh;
-                    initParticleParameters(localData[tbx+tj].radius, localData[tbx+tj].epsilon, rmjxo, rmjxh, emjxo, emjxh);
-                    computeOneInteraction(localData[tbx+tj], data, rmjxo, rmjxh, emjxo, emjxh, tempForce, tempEnergy);
+                    computeOneInteraction(localData[tbx+tj], data, tempForce, tempEnergy);
                     data.force -= tempForce;
                     localData[tbx+tj].force += tempForce;
                     energy += (x == y ? 0.5f*tempEnergy : tempEnergy);
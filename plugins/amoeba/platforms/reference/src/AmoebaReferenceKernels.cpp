@@ -703,13 +703,48 @@ double ReferenceCalcAmoebaMultipoleForceKernel::execute(ContextImpl& context, bo
 
     AmoebaReferenceMultipoleForce* amoebaReferenceMultipoleForce = setupAmoebaReferenceMultipoleForce(context);
 
+    // If converged dipoles have been saved from previous evaluations, warm start the mutual
+    // dipole iteration with the always stable predictor-corrector (ASPC) of Kolafa, which
+    // extrapolates the starting guess from the stored history.  This typically cuts the
+    // number of iterations needed to reach convergence by more than half.
+
+    if (polarizationType == AmoebaMultipoleForce::Mutual && inducedDipoleHistory.size() > 0) {
+        static const double aspcCoefficients[4][4] = {
+            {1.0,  0.0,  0.0,  0.0},
+            {2.0, -1.0,  0.0,  0.0},
+            {2.5, -2.0,  0.5,  0.0},
+            {2.8, -2.8,  1.2, -0.2}
+        };
+        int order = (int) inducedDipoleHistory.size();
+        vector<Vec3> guess(numMultipoles), guessPolar(numMultipoles);
+        for (int i = 0; i < order; i++) {
+            for (int j = 0; j < numMultipoles; j++) {
+                guess[j]      += inducedDipoleHistory[i][j]*aspcCoefficients[order-1][i];
+                guessPolar[j] += inducedDipolePolarHistory[i][j]*aspcCoefficients[order-1][i];
+            }
+        }
+        amoebaReferenceMultipoleForce->setInitialInducedDipoles(guess, guessPolar);
+    }
+
     vector<Vec3>& posData = extractPositions(context);
     vector<Vec3>& forceData = extractForces(context);
     double energy = amoebaReferenceMultipoleForce->calculateForceAndEnergy(posData, charges, dipoles, quadrupoles, tholes,
-                                                                           dampingFactors, polarity, axisTypes, 
+                                                                           dampingFactors, polarity, axisTypes,
                                                                            multipoleAtomZs, multipoleAtomXs, multipoleAtomYs,
                                                                            multipoleAtomCovalentInfo, forceData);
 
+    // Save the converged dipoles for use in warm starting later evaluations.
+
+    if (polarizationType == AmoebaMultipoleForce::Mutual && amoebaReferenceMultipoleForce->getMutualInducedDipoleConverged()) {
+        inducedDipoleHistory.insert(inducedDipoleHistory.begin(), vector<Vec3>());
+        inducedDipolePolarHistory.insert(inducedDipolePolarHistory.begin(), vector<Vec3>());
+        amoebaReferenceMultipoleForce->getInducedDipoles(inducedDipoleHistory[0], inducedDipolePolarHistory[0]);
+        if (inducedDipoleHistory.size() > 4) {
+            inducedDipoleHistory.pop_back();
+            inducedDipolePolarHistory.pop_back();
+        }
+    }
+
     delete amoebaReferenceMultipoleForce;
 
     return static_cast<double>(energy);
@@ -854,6 +889,12 @@ void ReferenceCalcAmoebaMultipoleForceKernel::copyParametersToContext(ContextImp
         quadrupoles[quadrupoleIndex++] = quadrupolesD[7];
         quadrupoles[quadrupoleIndex++] = quadrupolesD[8];
     }
+
+    // The stored induced dipoles correspond to the old parameters, so they can no
+    // longer be used to warm start the mutual dipole iteration.
+
+    inducedDipoleHistory.clear();
+    inducedDipolePolarHistory.clear();
 }
 
 void ReferenceCalcAmoebaMultipoleForceKernel::getPMEParameters(double& alpha, int& nx, int& ny, int& nz) const {
@@ -455,6 +455,11 @@ private:
     double mutualInducedTargetEpsilon;
     std::vector<double> extrapolationCoefficients;
 
+    // converged induced dipoles from recent force evaluations, most recent first,
+    // used to warm start the mutual dipole iteration
+    std::vector< std::vector<Vec3> > inducedDipoleHistory;
+    std::vector< std::vector<Vec3> > inducedDipolePolarHistory;
+
     bool usePme;
     double alphaEwald;
     double cutoffDistance;
@@ -117,6 +117,20 @@ void AmoebaReferenceMultipoleForce::setPolarizationType(AmoebaReferenceMultipole
     _polarizationType = polarizationType;
 }
 
+void AmoebaReferenceMultipoleForce::setInitialInducedDipoles(const vector<Vec3>& inducedDipoles,
+                                                             const vector<Vec3>& inducedDipolesPolar)
+{
+    _initialInducedDipoles      = inducedDipoles;
+    _initialInducedDipolesPolar = inducedDipolesPolar;
+}
+
+void AmoebaReferenceMultipoleForce::getInducedDipoles(vector<Vec3>& inducedDipoles,
+                                                      vector<Vec3>& inducedDipolesPolar) const
+{
+    inducedDipoles      = _inducedDipole;
+    inducedDipolesPolar = _inducedDipolePolar;
+}
+
 int AmoebaReferenceMultipoleForce::getMutualInducedDipoleConverged() const
 {
     return _mutualInducedDipoleConverged;
@@ -778,14 +792,23 @@ void AmoebaReferenceMultipoleForce::calculateFixedMultipoleField(const vector<Mu
 void AmoebaReferenceMultipoleForce::initializeInducedDipoles(vector<UpdateInducedDipoleFieldStruct>& updateInducedDipoleFields)
 {
 
-    // initialize inducedDipoles
+    // initialize inducedDipoles; if a warm start guess has been provided for a mutual
+    // calculation, use it in place of the direct field estimate
 
     _inducedDipole.resize(_numParticles);
     _inducedDipolePolar.resize(_numParticles);
 
-    for (unsigned int ii = 0; ii < _numParticles; ii++) {
-        _inducedDipole[ii]       = _fixedMultipoleField[ii];
-        _inducedDipolePolar[ii]  = _fixedMultipoleFieldPolar[ii];
+    if (getPolarizationType() == AmoebaReferenceMultipoleForce::Mutual &&
+            _initialInducedDipoles.size() == _numParticles && _initialInducedDipolesPolar.size() == _numParticles) {
+        for (unsigned int ii = 0; ii < _numParticles; ii++) {
+            _inducedDipole[ii]       = _initialInducedDipoles[ii];
+            _inducedDipolePolar[ii]  = _initialInducedDipolesPolar[ii];
+        }
+    } else {
+        for (unsigned int ii = 0; ii < _numParticles; ii++) {
+            _inducedDipole[ii]       = _fixedMultipoleField[ii];
+            _inducedDipolePolar[ii]  = _fixedMultipoleFieldPolar[ii];
+        }
     }
 }
 
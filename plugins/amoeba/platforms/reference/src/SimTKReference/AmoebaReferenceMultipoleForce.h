@@ -403,6 +403,29 @@ public:
      */
     void setPolarizationType(PolarizationType polarizationType);
 
+    /**
+     * Set an initial guess to use for the induced dipoles in place of the direct field
+     * estimate.  This is used to warm start the mutual dipole iteration from dipoles
+     * extrapolated from previous time steps.  It is ignored unless the polarization
+     * type is Mutual.
+     *
+     * @param inducedDipoles       initial guess for the induced dipoles
+     * @param inducedDipolesPolar  initial guess for the polar induced dipoles
+     *
+     */
+    void setInitialInducedDipoles(const std::vector<OpenMM::Vec3>& inducedDipoles,
+                                  const std::vector<OpenMM::Vec3>& inducedDipolesPolar);
+
+    /**
+     * Get the converged induced dipoles from the most recent calculation.
+     *
+     * @param inducedDipoles       on output, the converged induced dipoles
+     * @param inducedDipolesPolar  on output, the converged polar induced dipoles
+     *
+     */
+    void getInducedDipoles(std::vector<OpenMM::Vec3>& inducedDipoles,
+                           std::vector<OpenMM::Vec3>& inducedDipolesPolar) const;
+
     /**
      * Get flag indicating if mutual induced dipoles are converged.
      *
@@ -737,6 +760,8 @@ protected:
     std::vector<Vec3> _fixedMultipoleFieldPolar;
     std::vector<Vec3> _inducedDipole;
     std::vector<Vec3> _inducedDipolePolar;
+    std::vector<Vec3> _initialInducedDipoles;
+    std::vector<Vec3> _initialInducedDipolesPolar;
     std::vector<std::vector<Vec3> > _ptDipoleP;
     std::vector<std::vector<Vec3> > _ptDipoleD;
     std::vector<std::vector<double> > _ptDipoleFieldGradientP;
@@ -61,6 +61,7 @@ void testSerialization() {
     AmoebaMultipoleForce force1;
     force1.setForceGroup(3);
     force1.setNonbondedMethod(AmoebaMultipoleForce::NoCutoff);
+    force1.setPolarizationType(AmoebaMultipoleForce::Extrapolated);
     force1.setCutoffDistance(0.9);
     force1.setAEwald(0.544);
     //force1.setPmeBSplineOrder(4);
@@ -115,6 +116,7 @@ void testSerialization() {
     ASSERT_EQUAL(force1.getForceGroup(), force2.getForceGroup());
     ASSERT_EQUAL(force1.getCutoffDistance(),                force2.getCutoffDistance());
     ASSERT_EQUAL(force1.getNonbondedMethod(),               force2.getNonbondedMethod());
+    ASSERT_EQUAL(force1.getPolarizationType(),              force2.getPolarizationType());
     ASSERT_EQUAL(force1.getAEwald(),                        force2.getAEwald());
     ASSERT_EQUAL(force1.getMutualInducedMaxIterations(),    force2.getMutualInducedMaxIterations());
     ASSERT_EQUAL(force1.getMutualInducedTargetEpsilon(),    force2.getMutualInducedTargetEpsilon());
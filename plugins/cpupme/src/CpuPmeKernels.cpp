@@ -48,8 +48,8 @@ using namespace std;
 
 static const int PME_ORDER = 5;
 
-bool CpuCalcDispersionPmeReciprocalForceKernel::hasInitializedThreads = false;
-int CpuCalcDispersionPmeReciprocalForceKernel::numThreads = 0;
+bool CpuCalcPmeReciprocalForceKernel::hasInitializedThreads = false;
+int CpuCalcPmeReciprocalForceKernel::numThreads = 0;
 
 static void spreadCharge(float* posq, float* grid, int gridx, int gridy, int gridz, int numParticles, Vec3* periodicBoxVectors, Vec3* recipBoxVectors,
         gmx_atomic_t& atomicCounter, const float epsilonFactor, int threadIndex, int numThreads, bool deterministic) {
@@ -303,7 +303,16 @@ static double reciprocalDispersionEnergy(int start, int end, fftwf_complex* grid
 
 
 static void reciprocalConvolution(int start, int end, fftwf_complex* grid, vector<float>& recipEterm) {
-    for (int index = start; index < end; index++) {
+    float* gridData = (float*) grid;
+    int index = start;
+    for (; index+2 <= end; index += 2) {
+        // Each vector covers two complex grid values, so duplicate each scale factor
+        // across the real and imaginary components.
+
+        fvec4 eterm(recipEterm[index], recipEterm[index], recipEterm[index+1], recipEterm[index+1]);
+        (fvec4(&gridData[2*index])*eterm).store(&gridData[2*index]);
+    }
+    for (; index < end; index++) {
         float eterm = recipEterm[index];
         grid[index][0] *= eterm;
         grid[index][1] *= eterm;
@@ -682,8 +691,8 @@ int CpuCalcPmeReciprocalForceKernel::findFFTDimension(int minimum, bool isZ) {
  * instead of electrostatics.
  */
 
-bool CpuCalcPmeReciprocalForceKernel::hasInitializedThreads = false;
-int CpuCalcPmeReciprocalForceKernel::numThreads = 0;
+bool CpuCalcDispersionPmeReciprocalForceKernel::hasInitializedThreads = false;
+int CpuCalcDispersionPmeReciprocalForceKernel::numThreads = 0;
 
 
 class CpuCalcDispersionPmeReciprocalForceKernel::ComputeTask : public ThreadPool::Task {
@@ -875,7 +884,8 @@ void CpuCalcDispersionPmeReciprocalForceKernel::runWorkerThread(ThreadPool& thre
     int gridStart = 4*((index*gridSize)/numThreads);
     int gridEnd = 4*(((index+1)*gridSize)/numThreads);
     int complexSize = gridx*gridy*(gridz/2+1);
-    int complexStart = std::max(1, ((index*complexSize)/numThreads));
+    // For dispersion we include the {0,0,0} term, so the first thread's range starts at 0.
+    int complexStart = (index*complexSize)/numThreads;
     int complexEnd = (((index+1)*complexSize)/numThreads);
     const float epsilonFactor = 1.0f;
     spreadCharge(posq, tempGrid[index], gridx, gridy, gridz, numParticles, periodicBoxVectors, recipBoxVectors, atomicCounter, epsilonFactor, index, numThreads, deterministic);
@@ -896,8 +906,6 @@ void CpuCalcDispersionPmeReciprocalForceKernel::runWorkerThread(ThreadPool& thre
         threadEnergy[index] = reciprocalDispersionEnergy(gridxStart, gridxEnd, complexGrid, recipEterm, gridx, gridy, gridz, alpha, bsplineModuli, periodicBoxVectors, recipBoxVectors);
         threads.syncThreads();
     }
-    // For dispersion, we include the {0,0,0} term, so the start point needs to be redefined
-    complexStart = (index*complexSize)/numThreads;
     reciprocalConvolution(complexStart, complexEnd, complexGrid, recipEterm);
     threads.syncThreads();
     interpolateForces(posq, &force[0], realGrid, gridx, gridy, gridz, numParticles, periodicBoxVectors, recipBoxVectors, atomicCounter, epsilonFactor);
@@ -107,4 +107,5 @@ void DrudeLangevinIntegrator::step(int steps) {
         context->calcForcesAndEnergy(true, false);
         kernel.getAs<IntegrateDrudeLangevinStepKernel>().execute(*context, *this);
     }
+    context->invalidateEnergyCache();
 }
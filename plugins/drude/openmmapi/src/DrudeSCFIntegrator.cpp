@@ -93,4 +93,5 @@ void DrudeSCFIntegrator::step(int steps) {
         context->calcForcesAndEnergy(true, false);
         kernel.getAs<IntegrateDrudeSCFStepKernel>().execute(*context, *this);
     }
+    context->invalidateEnergyCache();
 }
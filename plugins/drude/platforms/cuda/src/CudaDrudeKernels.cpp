@@ -280,6 +280,12 @@ void CudaIntegrateDrudeLangevinStepKernel::initialize(const System& system, cons
     kernel1 = cu.getKernel(module, "integrateDrudeLangevinPart1");
     kernel2 = cu.getKernel(module, "integrateDrudeLangevinPart2");
     hardwallKernel = cu.getKernel(module, "applyHardWallConstraints");
+    fusedKernel = cu.getKernel(module, "integrateDrudeLangevinOneStep");
+
+    // When the system contains no constraints, the velocity update, position update, and
+    // hard wall constraint can all be performed in a single kernel launch.
+
+    useFusedKernel = (system.getNumConstraints() == 0);
     prevStepSize = -1.0;
 }
 
@@ -343,31 +349,42 @@ void CudaIntegrateDrudeLangevinStepKernel::execute(ContextImpl& context, const D
         hardwallscaleDrudePtr = &hardwallscaleDrudeFloat;
     }
 
-    // Call the first integration kernel.
-
     int randomIndex = integration.prepareRandomNumbers(normalParticles->getSize()+2*pairParticles->getSize());
-    void* args1[] = {&cu.getVelm().getDevicePointer(), &cu.getForce().getDevicePointer(), &integration.getPosDelta().getDevicePointer(),
-            &normalParticles->getDevicePointer(), &pairParticles->getDevicePointer(), &integration.getStepSize().getDevicePointer(),
-            vscalePtr, fscalePtr, noisescalePtr, vscaleDrudePtr, fscaleDrudePtr, noisescaleDrudePtr, &integration.getRandom().getDevicePointer(), &randomIndex};
-    cu.executeKernel(kernel1, args1, numAtoms);
+    CUdeviceptr posCorrection = (cu.getUseMixedPrecision() ? cu.getPosqCorrection().getDevicePointer() : 0);
+    if (useFusedKernel) {
+        // There are no constraints, so the whole step can be performed in a single kernel launch.
+
+        void* args[] = {&cu.getPosq().getDevicePointer(), &posCorrection, &cu.getVelm().getDevicePointer(), &cu.getForce().getDevicePointer(),
+                &normalParticles->getDevicePointer(), &pairParticles->getDevicePointer(), &integration.getStepSize().getDevicePointer(),
+                vscalePtr, fscalePtr, noisescalePtr, vscaleDrudePtr, fscaleDrudePtr, noisescaleDrudePtr,
+                maxDrudeDistancePtr, hardwallscaleDrudePtr, &integration.getRandom().getDevicePointer(), &randomIndex};
+        cu.executeKernel(fusedKernel, args, numAtoms);
+    }
+    else {
+        // Call the first integration kernel.
 
-    // Apply constraints.
+        void* args1[] = {&cu.getVelm().getDevicePointer(), &cu.getForce().getDevicePointer(), &integration.getPosDelta().getDevicePointer(),
+                &normalParticles->getDevicePointer(), &pairParticles->getDevicePointer(), &integration.getStepSize().getDevicePointer(),
+                vscalePtr, fscalePtr, noisescalePtr, vscaleDrudePtr, fscaleDrudePtr, noisescaleDrudePtr, &integration.getRandom().getDevicePointer(), &randomIndex};
+        cu.executeKernel(kernel1, args1, numAtoms);
 
-    integration.applyConstraints(integrator.getConstraintTolerance());
+        // Apply constraints.
 
-    // Call the second integration kernel.
+        integration.applyConstraints(integrator.getConstraintTolerance());
 
-    CUdeviceptr posCorrection = (cu.getUseMixedPrecision() ? cu.getPosqCorrection().getDevicePointer() : 0);
-    void* args2[] = {&cu.getPosq().getDevicePointer(), &posCorrection, &integration.getPosDelta().getDevicePointer(),
-            &cu.getVelm().getDevicePointer(), &integration.getStepSize().getDevicePointer()};
-    cu.executeKernel(kernel2, args2, numAtoms);
-    
-    // Apply hard wall constraints.
-    
-    if (maxDrudeDistance > 0) {
-        void* hardwallArgs[] = {&cu.getPosq().getDevicePointer(), &posCorrection, &cu.getVelm().getDevicePointer(),
-                &pairParticles->getDevicePointer(), &integration.getStepSize().getDevicePointer(), maxDrudeDistancePtr, hardwallscaleDrudePtr};
-        cu.executeKernel(hardwallKernel, hardwallArgs, pairParticles->getSize());
+        // Call the second integration kernel.
+
+        void* args2[] = {&cu.getPosq().getDevicePointer(), &posCorrection, &integration.getPosDelta().getDevicePointer(),
+                &cu.getVelm().getDevicePointer(), &integration.getStepSize().getDevicePointer()};
+        cu.executeKernel(kernel2, args2, numAtoms);
+
+        // Apply hard wall constraints.
+
+        if (maxDrudeDistance > 0) {
+            void* hardwallArgs[] = {&cu.getPosq().getDevicePointer(), &posCorrection, &cu.getVelm().getDevicePointer(),
+                    &pairParticles->getDevicePointer(), &integration.getStepSize().getDevicePointer(), maxDrudeDistancePtr, hardwallscaleDrudePtr};
+            cu.executeKernel(hardwallKernel, hardwallArgs, pairParticles->getSize());
+        }
     }
     integration.computeVirtualSites();
 
@@ -511,6 +528,7 @@ static lbfgsfloatval_t evaluate(void *instance, const lbfgsfloatval_t *x, lbfgsf
 
     // Compute the forces and energy for this configuration.
 
+    context.invalidateEnergyCache();
     double energy = context.calcForcesAndEnergy(true, true);
     long long* force = (long long*) cu.getPinnedBuffer();
     cu.getForce().download(force);
@@ -111,9 +111,10 @@ public:
 private:
     CudaContext& cu;
     double prevStepSize;
+    bool useFusedKernel;
     CudaArray* normalParticles;
     CudaArray* pairParticles;
-    CUfunction kernel1, kernel2, hardwallKernel;
+    CUfunction kernel1, kernel2, hardwallKernel, fusedKernel;
 };
 
 /**
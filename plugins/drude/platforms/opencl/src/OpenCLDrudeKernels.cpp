@@ -531,6 +531,7 @@ static lbfgsfloatval_t evaluate(void *instance, const lbfgsfloatval_t *x, lbfgsf
 
     // Compute the forces and energy for this configuration.
 
+    context.invalidateEnergyCache();
     double energy = context.calcForcesAndEnergy(true, true);
     cl.getForce().download(cl.getPinnedBuffer());
     if (cl.getUseDoublePrecision()) {
@@ -61,6 +61,11 @@ static ReferenceConstraints& extractConstraints(ContextImpl& context) {
     return *(ReferenceConstraints*) data->constraints;
 }
 
+static const ReferenceVirtualSites& extractVirtualSites(ContextImpl& context) {
+    ReferencePlatform::PlatformData* data = reinterpret_cast<ReferencePlatform::PlatformData*>(context.getPlatformData());
+    return *(ReferenceVirtualSites*) data->virtualSites;
+}
+
 static double computeShiftedKineticEnergy(ContextImpl& context, vector<double>& inverseMasses, double timeShift) {
     const System& system = context.getSystem();
     int numParticles = system.getNumParticles();
@@ -392,7 +397,7 @@ void ReferenceIntegrateDrudeLangevinStepKernel::execute(ContextImpl& context, co
             }
         }
     }
-    ReferenceVirtualSites::computePositions(context.getSystem(), pos);
+    extractVirtualSites(context).computePositions(pos);
     data.time += integrator.getStepSize();
     data.stepCount++;
 }
@@ -469,7 +474,7 @@ void ReferenceIntegrateDrudeSCFStepKernel::execute(ContextImpl& context, const D
     
     // Update the positions of virtual sites and Drude particles.
     
-    ReferenceVirtualSites::computePositions(context.getSystem(), pos);
+    extractVirtualSites(context).computePositions(pos);
     minimize(context, integrator.getMinimizationErrorTolerance());
     data.time += integrator.getStepSize();
     data.stepCount++;
@@ -497,6 +502,7 @@ static lbfgsfloatval_t evaluate(void *instance, const lbfgsfloatval_t *x, lbfgsf
     vector<Vec3>& force = extractForces(context);
     for (int i = 0; i < numDrudeParticles; i++)
         pos[drudeParticles[i]] = Vec3(x[3*i], x[3*i+1], x[3*i+2]);
+    context.invalidateEnergyCache();
     double energy = context.calcForcesAndEnergy(true, true);
     for (int i = 0; i < numDrudeParticles; i++) {
         Vec3 f = force[drudeParticles[i]];
@@ -64,6 +64,11 @@ namespace OpenMM {
  * might simulate a 32 copy ring polymer and evaluate bonded forces on every copy, but contract
  * it down to only 6 copies for computing nonbonded interactions, and down to only a single
  * copy (the centroid) for computing the reciprocal space part of PME.
+ *
+ * The beads are evaluated one at a time, but each evaluation uses the full parallelism of the
+ * Platform the Context was created with.  In particular, when the CUDA platform is configured
+ * to use several GPUs by listing them in the DeviceIndex property, the force calculation for
+ * every bead is split across all of them.
  */
 
 class OPENMM_EXPORT_RPMD RPMDIntegrator : public Integrator {
@@ -86,8 +91,8 @@ public:
      * @param stepSize       the step size with which to integrator the system (in picoseconds)
      * @param contractions   the ring polymer contractions to use for evaluating different force groups.  Each key in the
      *                       map is the index of a force group, and the corresponding value is the number of copies to evaluate
-     *                       that force group on.  If no entry is provided for a force group (the default), it is evaluated
-     *                       independently on every copy.
+     *                       that force group on.  This may not be greater than numCopies.  If no entry is provided for a
+     *                       force group (the default), it is evaluated independently on every copy.
      */
     RPMDIntegrator(int numCopies, double temperature, double frictionCoeff, double stepSize, const std::map<int, int>& contractions);
     /**
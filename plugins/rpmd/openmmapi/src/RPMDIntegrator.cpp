@@ -107,12 +107,17 @@ State RPMDIntegrator::getState(int copy, int types, bool enforcePeriodicBox, int
         isFirstStep = false;
     }
     kernel.getAs<IntegrateRPMDStepKernel>().copyToContext(copy, *context);
+    // copyToContext() replaces the positions at a level below ContextImpl, so any cached
+    // forces or energies now refer to a different copy.
+
+    context->invalidateEnergyCache();
     State state = context->getOwner().getState(types, enforcePeriodicBox && copy == 0, groups);
     if (enforcePeriodicBox && copy > 0 && (types&State::Positions) != 0) {
         // Apply periodic boundary conditions based on copy 0.  Otherwise, molecules might end
         // up in different places for different copies.
 
         kernel.getAs<IntegrateRPMDStepKernel>().copyToContext(0, *context);
+        context->invalidateEnergyCache();
         State state2 = context->getOwner().getState(State::Positions, false, groups);
         vector<Vec3> positions = state.getPositions();
         const vector<Vec3>& refPos = state2.getPositions();
@@ -145,12 +150,18 @@ State RPMDIntegrator::getState(int copy, int types, bool enforcePeriodicBox, int
         State::StateBuilder builder(state.getTime());
         builder.setPositions(positions);
         builder.setPeriodicBoxVectors(periodicBoxSize[0], periodicBoxSize[1], periodicBoxSize[2]);
-        if (types&State::Velocities)
-            builder.setVelocities(state.getVelocities());
-        if (types&State::Forces)
-            builder.setForces(state.getForces());
-        if (types&State::Parameters)
-            builder.setParameters(state.getParameters());
+        if (types&State::Velocities) {
+            vector<Vec3> velocities = state.getVelocities();
+            builder.setVelocities(velocities);
+        }
+        if (types&State::Forces) {
+            vector<Vec3> forces = state.getForces();
+            builder.setForces(forces);
+        }
+        if (types&State::Parameters) {
+            map<string, double> parameters = state.getParameters();
+            builder.setParameters(parameters);
+        }
         if (types&State::Energy)
             builder.setEnergy(state.getKineticEnergy(), state.getPotentialEnergy());
         state = builder.getState();
@@ -197,6 +208,7 @@ void RPMDIntegrator::step(int steps) {
         kernel.getAs<IntegrateRPMDStepKernel>().execute(*context, *this, forcesAreValid);
         forcesAreValid = true;
     }
+    context->invalidateEnergyCache();
 }
 
 double RPMDIntegrator::getTotalEnergy() {
@@ -0,0 +1,17 @@
+#ifndef OPENMM_MTS_INTEGRATOR_PROXY_H_
+#define OPENMM_MTS_INTEGRATOR_PROXY_H_
+
+#include "openmm/serialization/XmlSerializer.h"
+
+namespace OpenMM {
+
+class MTSIntegratorProxy : public SerializationProxy {
+public:
+    MTSIntegratorProxy();
+    void serialize(const void* object, SerializationNode& node) const;
+    void* deserialize(const SerializationNode& node) const;
+};
+
+}
+
+#endif /*OPENMM_MTS_INTEGRATOR_PROXY_H_*/
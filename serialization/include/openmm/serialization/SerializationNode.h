@@ -196,6 +196,42 @@ public:
      * @param value  the value to set for the property
      */
     SerializationNode& setDoubleProperty(const std::string& name, double value);
+    /**
+     * Get the property with a particular name, specified as a binary encoded array of doubles.
+     * If there is no property with the specified name, an exception is thrown.
+     *
+     * @param name    the name of the property to get
+     * @param values  on exit, this contains the values stored in the property
+     */
+    void getDoubleArrayProperty(const std::string& name, std::vector<double>& values) const;
+    /**
+     * Set the value of a property, specified as an array of doubles.  Instead of being formatted
+     * as text, the values are stored in a compact base64 encoding of their binary representation.
+     * This is much faster to write and parse than formatted text, but the resulting file is not
+     * human readable.
+     *
+     * @param name    the name of the property to set
+     * @param values  the values to set for the property
+     */
+    SerializationNode& setDoubleArrayProperty(const std::string& name, const std::vector<double>& values);
+    /**
+     * Get the property with a particular name, specified as a binary encoded array of ints.
+     * If there is no property with the specified name, an exception is thrown.
+     *
+     * @param name    the name of the property to get
+     * @param values  on exit, this contains the values stored in the property
+     */
+    void getIntArrayProperty(const std::string& name, std::vector<int>& values) const;
+    /**
+     * Set the value of a property, specified as an array of ints.  Instead of being formatted
+     * as text, the values are stored in a compact base64 encoding of their binary representation.
+     * This is much faster to write and parse than formatted text, but the resulting file is not
+     * human readable.
+     *
+     * @param name    the name of the property to set
+     * @param values  the values to set for the property
+     */
+    SerializationNode& setIntArrayProperty(const std::string& name, const std::vector<int>& values);
     /**
      * Create a new child node
      *
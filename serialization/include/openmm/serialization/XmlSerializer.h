@@ -86,11 +86,24 @@ public:
         proxy.serialize(&object, node);
         return reinterpret_cast<T*>(proxy.deserialize(node));
     }
+    /**
+     * Get whether large numeric arrays are stored in a compact binary encoding.
+     */
+    static bool getUseBinaryArrays();
+    /**
+     * Set whether large numeric arrays should be stored in a compact binary encoding instead of
+     * formatted text.  This makes the files much smaller and much faster to write and parse, but
+     * the arrays are no longer human readable, and the files cannot be loaded by versions of
+     * OpenMM that predate this option.  It is disabled by default.  Files can always be loaded
+     * regardless of what encoding they were written with.
+     */
+    static void setUseBinaryArrays(bool use);
 private:
     class StreamReader;
     static void serialize(const SerializationNode& node, std::ostream& stream);
     static void* deserializeStream(std::istream& stream);
     static void encodeNode(const SerializationNode& node, std::ostream& stream, int depth);
+    static bool useBinaryArrays;
 };
 
 } // namespace OpenMM
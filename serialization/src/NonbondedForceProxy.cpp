@@ -31,6 +31,7 @@
 
 #include "openmm/serialization/NonbondedForceProxy.h"
 #include "openmm/serialization/SerializationNode.h"
+#include "openmm/serialization/XmlSerializer.h"
 #include "openmm/Force.h"
 #include "openmm/NonbondedForce.h"
 #include <sstream>
@@ -42,7 +43,8 @@ NonbondedForceProxy::NonbondedForceProxy() : SerializationProxy("NonbondedForce"
 }
 
 void NonbondedForceProxy::serialize(const void* object, SerializationNode& node) const {
-    node.setIntProperty("version", 2);
+    bool binary = XmlSerializer::getUseBinaryArrays();
+    node.setIntProperty("version", binary ? 3 : 2);
     const NonbondedForce& force = *reinterpret_cast<const NonbondedForce*>(object);
     node.setIntProperty("forceGroup", force.getForceGroup());
     node.setIntProperty("method", (int) force.getNonbondedMethod());
@@ -66,6 +68,26 @@ void NonbondedForceProxy::serialize(const void* object, SerializationNode& node)
     node.setIntProperty("ljnz", nz);
     node.setIntProperty("recipForceGroup", force.getReciprocalSpaceForceGroup());
     SerializationNode& particles = node.createChildNode("Particles");
+    if (binary) {
+        // Instead of creating a child node for every particle and exception, store the
+        // parameters in binary encoded arrays.  For a large System this makes the node
+        // tree vastly smaller.
+
+        vector<double> charge(force.getNumParticles()), sigma(force.getNumParticles()), epsilon(force.getNumParticles());
+        for (int i = 0; i < force.getNumParticles(); i++)
+            force.getParticleParameters(i, charge[i], sigma[i], epsilon[i]);
+        particles.setDoubleArrayProperty("q", charge).setDoubleArrayProperty("sig", sigma).setDoubleArrayProperty("eps", epsilon);
+        vector<int> particle1(force.getNumExceptions()), particle2(force.getNumExceptions());
+        vector<double> chargeProd(force.getNumExceptions());
+        sigma.resize(force.getNumExceptions());
+        epsilon.resize(force.getNumExceptions());
+        for (int i = 0; i < force.getNumExceptions(); i++)
+            force.getExceptionParameters(i, particle1[i], particle2[i], chargeProd[i], sigma[i], epsilon[i]);
+        SerializationNode& exceptions = node.createChildNode("Exceptions");
+        exceptions.setIntArrayProperty("p1", particle1).setIntArrayProperty("p2", particle2);
+        exceptions.setDoubleArrayProperty("q", chargeProd).setDoubleArrayProperty("sig", sigma).setDoubleArrayProperty("eps", epsilon);
+        return;
+    }
     for (int i = 0; i < force.getNumParticles(); i++) {
         double charge, sigma, epsilon;
         force.getParticleParameters(i, charge, sigma, epsilon);
@@ -82,7 +104,7 @@ void NonbondedForceProxy::serialize(const void* object, SerializationNode& node)
 
 void* NonbondedForceProxy::deserialize(const SerializationNode& node) const {
     int version = node.getIntProperty("version");
-    if (version < 1 || version > 2)
+    if (version < 1 || version > 3)
         throw OpenMMException("Unsupported version number");
     NonbondedForce* force = new NonbondedForce();
     try {
@@ -108,11 +130,36 @@ void* NonbondedForceProxy::deserialize(const SerializationNode& node) const {
         }
         force->setReciprocalSpaceForceGroup(node.getIntProperty("recipForceGroup", -1));
         const SerializationNode& particles = node.getChildNode("Particles");
-        for (auto& particle : particles.getChildren())
-            force->addParticle(particle.getDoubleProperty("q"), particle.getDoubleProperty("sig"), particle.getDoubleProperty("eps"));
         const SerializationNode& exceptions = node.getChildNode("Exceptions");
-        for (auto& exception : exceptions.getChildren())
-            force->addException(exception.getIntProperty("p1"), exception.getIntProperty("p2"), exception.getDoubleProperty("q"), exception.getDoubleProperty("sig"), exception.getDoubleProperty("eps"));
+        if (particles.hasProperty("q")) {
+            // The parameters are stored in binary encoded arrays.
+
+            vector<double> charge, sigma, epsilon;
+            particles.getDoubleArrayProperty("q", charge);
+            particles.getDoubleArrayProperty("sig", sigma);
+            particles.getDoubleArrayProperty("eps", epsilon);
+            if (sigma.size() != charge.size() || epsilon.size() != charge.size())
+                throw OpenMMException("Mismatched particle parameter array sizes");
+            for (int i = 0; i < (int) charge.size(); i++)
+                force->addParticle(charge[i], sigma[i], epsilon[i]);
+            vector<int> particle1, particle2;
+            vector<double> chargeProd;
+            exceptions.getIntArrayProperty("p1", particle1);
+            exceptions.getIntArrayProperty("p2", particle2);
+            exceptions.getDoubleArrayProperty("q", chargeProd);
+            exceptions.getDoubleArrayProperty("sig", sigma);
+            exceptions.getDoubleArrayProperty("eps", epsilon);
+            if (particle2.size() != particle1.size() || chargeProd.size() != particle1.size() || sigma.size() != particle1.size() || epsilon.size() != particle1.size())
+                throw OpenMMException("Mismatched exception parameter array sizes");
+            for (int i = 0; i < (int) particle1.size(); i++)
+                force->addException(particle1[i], particle2[i], chargeProd[i], sigma[i], epsilon[i]);
+        }
+        else {
+            for (auto& particle : particles.getChildren())
+                force->addParticle(particle.getDoubleProperty("q"), particle.getDoubleProperty("sig"), particle.getDoubleProperty("eps"));
+            for (auto& exception : exceptions.getChildren())
+                force->addException(exception.getIntProperty("p1"), exception.getIntProperty("p2"), exception.getDoubleProperty("q"), exception.getDoubleProperty("sig"), exception.getDoubleProperty("eps"));
+        }
     }
     catch (...) {
         delete force;
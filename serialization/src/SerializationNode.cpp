@@ -31,6 +31,7 @@
 
 #include "openmm/serialization/SerializationNode.h"
 #include "openmm/OpenMMException.h"
+#include <cstring>
 #include <sstream>
 
 using namespace OpenMM;
@@ -39,6 +40,47 @@ using namespace std;
 extern "C" char* g_fmt(char*, double);
 extern "C" double strtod2(const char* s00, char** se);
 
+static const char base64Chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static string encodeBase64(const vector<unsigned char>& data) {
+    string encoded;
+    encoded.reserve(4*((data.size()+2)/3));
+    for (int i = 0; i < (int) data.size(); i += 3) {
+        int numBytes = min(3, (int) data.size()-i);
+        unsigned int bits = data[i]<<16;
+        if (numBytes > 1)
+            bits |= data[i+1]<<8;
+        if (numBytes > 2)
+            bits |= data[i+2];
+        encoded += base64Chars[(bits>>18)&63];
+        encoded += base64Chars[(bits>>12)&63];
+        encoded += (numBytes > 1 ? base64Chars[(bits>>6)&63] : '=');
+        encoded += (numBytes > 2 ? base64Chars[bits&63] : '=');
+    }
+    return encoded;
+}
+
+static void decodeBase64(const string& encoded, vector<unsigned char>& data) {
+    data.clear();
+    data.reserve(3*(encoded.size()/4));
+    unsigned int bits = 0;
+    int numBits = 0;
+    for (int i = 0; i < (int) encoded.size(); i++) {
+        char c = encoded[i];
+        if (c == '=')
+            break;
+        const char* pos = strchr(base64Chars, c);
+        if (pos == NULL)
+            throw OpenMMException("Illegal character in base64 encoded data");
+        bits = (bits<<6) | (pos-base64Chars);
+        numBits += 6;
+        if (numBits >= 8) {
+            numBits -= 8;
+            data.push_back((unsigned char) ((bits>>numBits)&255));
+        }
+    }
+}
+
 const string& SerializationNode::getName() const {
     return name;
 }
@@ -168,6 +210,71 @@ SerializationNode& SerializationNode::setDoubleProperty(const string& name, doub
     return *this;
 }
 
+void SerializationNode::getDoubleArrayProperty(const string& name, vector<double>& values) const {
+    map<string, string>::const_iterator iter = properties.find(name);
+    if (iter == properties.end())
+        throw OpenMMException("Unknown property '"+name+"' in node '"+getName()+"'");
+    vector<unsigned char> bytes;
+    decodeBase64(iter->second, bytes);
+    if (bytes.size()%sizeof(double) != 0)
+        throw OpenMMException("Illegal binary data in property '"+name+"' in node '"+getName()+"'");
+    int numValues = bytes.size()/sizeof(double);
+    values.resize(numValues);
+    for (int i = 0; i < numValues; i++) {
+        // The bytes of each value are stored in little-endian order, so that files are
+        // portable between machines of different endianness.
+
+        unsigned long long bits = 0;
+        for (int j = (int) sizeof(double)-1; j >= 0; j--)
+            bits = (bits<<8) | bytes[sizeof(double)*i+j];
+        memcpy(&values[i], &bits, sizeof(double));
+    }
+}
+
+SerializationNode& SerializationNode::setDoubleArrayProperty(const string& name, const vector<double>& values) {
+    vector<unsigned char> bytes(sizeof(double)*values.size());
+    for (int i = 0; i < (int) values.size(); i++) {
+        unsigned long long bits;
+        memcpy(&bits, &values[i], sizeof(double));
+        for (int j = 0; j < (int) sizeof(double); j++)
+            bytes[sizeof(double)*i+j] = (unsigned char) ((bits>>(8*j))&255);
+    }
+    properties[name] = encodeBase64(bytes);
+    return *this;
+}
+
+void SerializationNode::getIntArrayProperty(const string& name, vector<int>& values) const {
+    map<string, string>::const_iterator iter = properties.find(name);
+    if (iter == properties.end())
+        throw OpenMMException("Unknown property '"+name+"' in node '"+getName()+"'");
+    vector<unsigned char> bytes;
+    decodeBase64(iter->second, bytes);
+    if (bytes.size()%4 != 0)
+        throw OpenMMException("Illegal binary data in property '"+name+"' in node '"+getName()+"'");
+    int numValues = bytes.size()/4;
+    values.resize(numValues);
+    for (int i = 0; i < numValues; i++) {
+        // The bytes of each value are stored in little-endian order, so that files are
+        // portable between machines of different endianness.
+
+        unsigned int bits = 0;
+        for (int j = 3; j >= 0; j--)
+            bits = (bits<<8) | bytes[4*i+j];
+        values[i] = (int) bits;
+    }
+}
+
+SerializationNode& SerializationNode::setIntArrayProperty(const string& name, const vector<int>& values) {
+    vector<unsigned char> bytes(4*values.size());
+    for (int i = 0; i < (int) values.size(); i++) {
+        unsigned int bits = (unsigned int) values[i];
+        for (int j = 0; j < 4; j++)
+            bytes[4*i+j] = (unsigned char) ((bits>>(8*j))&255);
+    }
+    properties[name] = encodeBase64(bytes);
+    return *this;
+}
+
 SerializationNode& SerializationNode::createChildNode(const std::string& name) {
     children.push_back(SerializationNode());
     children.back().setName(name);
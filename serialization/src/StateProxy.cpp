@@ -30,6 +30,7 @@
  * -------------------------------------------------------------------------- */
 
 #include "openmm/serialization/StateProxy.h"
+#include "openmm/serialization/XmlSerializer.h"
 #include "openmm/Platform.h"
 #include "openmm/State.h"
 #include "openmm/Vec3.h"
@@ -42,8 +43,40 @@ StateProxy::StateProxy() : SerializationProxy("State") {
 
 }
 
+static void storeVec3Array(SerializationNode& node, const vector<Vec3>& values, const string& elementName) {
+    if (XmlSerializer::getUseBinaryArrays()) {
+        vector<double> data(3*values.size());
+        for (int i = 0; i < (int) values.size(); i++) {
+            data[3*i] = values[i][0];
+            data[3*i+1] = values[i][1];
+            data[3*i+2] = values[i][2];
+        }
+        node.setDoubleArrayProperty("data", data);
+    }
+    else {
+        for (int i = 0; i < (int) values.size(); i++)
+            node.createChildNode(elementName).setDoubleProperty("x", values[i][0]).setDoubleProperty("y", values[i][1]).setDoubleProperty("z", values[i][2]);
+    }
+}
+
+static void loadVec3Array(const SerializationNode& node, vector<Vec3>& values) {
+    if (node.hasProperty("data")) {
+        vector<double> data;
+        node.getDoubleArrayProperty("data", data);
+        if (data.size()%3 != 0)
+            throw OpenMMException("Illegal binary array length in node '"+node.getName()+"'");
+        values.resize(data.size()/3);
+        for (int i = 0; i < (int) values.size(); i++)
+            values[i] = Vec3(data[3*i], data[3*i+1], data[3*i+2]);
+    }
+    else {
+        for (auto& particle : node.getChildren())
+            values.push_back(Vec3(particle.getDoubleProperty("x"), particle.getDoubleProperty("y"), particle.getDoubleProperty("z")));
+    }
+}
+
 void StateProxy::serialize(const void* object, SerializationNode& node) const {
-    node.setIntProperty("version", 1);
+    node.setIntProperty("version", XmlSerializer::getUseBinaryArrays() ? 2 : 1);
     node.setStringProperty("openmmVersion", Platform::getOpenMMVersion());
     const State& s = *reinterpret_cast<const State*>(object);
     node.setDoubleProperty("time", s.getTime());
@@ -67,32 +100,21 @@ void StateProxy::serialize(const void* object, SerializationNode& node) const {
     }
     if ((s.getDataTypes()&State::Positions) != 0) {
         s.getPositions();
-        SerializationNode& positionsNode = node.createChildNode("Positions");
-        vector<Vec3> statePositions = s.getPositions();
-        for (int i=0; i<statePositions.size();i++) {
-           positionsNode.createChildNode("Position").setDoubleProperty("x", statePositions[i][0]).setDoubleProperty("y", statePositions[i][1]).setDoubleProperty("z", statePositions[i][2]);
-        }
+        storeVec3Array(node.createChildNode("Positions"), s.getPositions(), "Position");
     }
     if ((s.getDataTypes()&State::Velocities) != 0) {
         s.getVelocities();
-        SerializationNode& velocitiesNode = node.createChildNode("Velocities");
-        vector<Vec3> stateVelocities = s.getVelocities();
-        for (int i=0; i<stateVelocities.size();i++) {
-           velocitiesNode.createChildNode("Velocity").setDoubleProperty("x", stateVelocities[i][0]).setDoubleProperty("y", stateVelocities[i][1]).setDoubleProperty("z", stateVelocities[i][2]);
-        }
+        storeVec3Array(node.createChildNode("Velocities"), s.getVelocities(), "Velocity");
     }
     if ((s.getDataTypes()&State::Forces) != 0) {
         s.getForces();
-        SerializationNode& forcesNode = node.createChildNode("Forces");
-        vector<Vec3> stateForces = s.getForces();
-        for (int i=0; i<stateForces.size();i++) {
-            forcesNode.createChildNode("Force").setDoubleProperty("x", stateForces[i][0]).setDoubleProperty("y", stateForces[i][1]).setDoubleProperty("z", stateForces[i][2]);
-        }
+        storeVec3Array(node.createChildNode("Forces"), s.getForces(), "Force");
     }
 }
 
 void* StateProxy::deserialize(const SerializationNode& node) const {
-    if (node.getIntProperty("version") != 1)
+    int version = node.getIntProperty("version");
+    if (version < 1 || version > 2)
         throw OpenMMException("Unsupported version number");
     double outTime = node.getDoubleProperty("time");
     const SerializationNode& boxVectorsNode = node.getChildNode("PeriodicBoxVectors");
@@ -119,24 +141,21 @@ void* StateProxy::deserialize(const SerializationNode& node) const {
         }
         else if (child.getName() == "Positions") {
             vector<Vec3> outPositions;
-            for (auto& particle : child.getChildren())
-                outPositions.push_back(Vec3(particle.getDoubleProperty("x"),particle.getDoubleProperty("y"),particle.getDoubleProperty("z")));
-            builder.setPositions(outPositions);
+            loadVec3Array(child, outPositions);
             arraySizes.push_back(outPositions.size());
+            builder.setPositions(outPositions);
         }
         else if (child.getName() == "Velocities") {
             vector<Vec3> outVelocities;
-            for (auto& particle : child.getChildren())
-                outVelocities.push_back(Vec3(particle.getDoubleProperty("x"),particle.getDoubleProperty("y"),particle.getDoubleProperty("z")));
-            builder.setVelocities(outVelocities);
+            loadVec3Array(child, outVelocities);
             arraySizes.push_back(outVelocities.size());
+            builder.setVelocities(outVelocities);
         }
         else if (child.getName() == "Forces") {
             vector<Vec3> outForces;
-            for (auto& particle : child.getChildren())
-                outForces.push_back(Vec3(particle.getDoubleProperty("x"),particle.getDoubleProperty("y"),particle.getDoubleProperty("z")));
-            builder.setForces(outForces);
+            loadVec3Array(child, outForces);
             arraySizes.push_back(outForces.size());
+            builder.setForces(outForces);
         }
     }
     for (int i = 1; i < arraySizes.size(); i++) {
@@ -31,10 +31,13 @@
 
 #include "openmm/serialization/SystemProxy.h"
 #include "openmm/serialization/SerializationNode.h"
+#include "openmm/serialization/XmlSerializer.h"
 #include "openmm/Force.h"
 #include "openmm/Platform.h"
 #include "openmm/System.h"
 #include "openmm/VirtualSite.h"
+#include "openmm/internal/ThreadPool.h"
+#include <exception>
 #include <sstream>
 
 using namespace OpenMM;
@@ -44,7 +47,8 @@ SystemProxy::SystemProxy() : SerializationProxy("System") {
 }
 
 void SystemProxy::serialize(const void* object, SerializationNode& node) const {
-    node.setIntProperty("version", 1);
+    bool binary = XmlSerializer::getUseBinaryArrays();
+    node.setIntProperty("version", binary ? 2 : 1);
     node.setStringProperty("openmmVersion", Platform::getOpenMMVersion());
     const System& system = *reinterpret_cast<const System*>(object);
     Vec3 a, b, c;
@@ -54,8 +58,23 @@ void SystemProxy::serialize(const void* object, SerializationNode& node) const {
     box.createChildNode("B").setDoubleProperty("x", b[0]).setDoubleProperty("y", b[1]).setDoubleProperty("z", b[2]);
     box.createChildNode("C").setDoubleProperty("x", c[0]).setDoubleProperty("y", c[1]).setDoubleProperty("z", c[2]);
     SerializationNode& particles = node.createChildNode("Particles");
+    if (binary) {
+        // Store the masses as a single binary array, and only create child nodes for
+        // particles that have a virtual site.
+
+        vector<double> masses(system.getNumParticles());
+        for (int i = 0; i < system.getNumParticles(); i++)
+            masses[i] = system.getParticleMass(i);
+        particles.setDoubleArrayProperty("masses", masses);
+    }
     for (int i = 0; i < system.getNumParticles(); i++) {
-        SerializationNode& particle = particles.createChildNode("Particle").setDoubleProperty("mass", system.getParticleMass(i));
+        if (binary && !system.isVirtualSite(i))
+            continue;
+        SerializationNode& particle = particles.createChildNode("Particle");
+        if (binary)
+            particle.setIntProperty("index", i);
+        else
+            particle.setDoubleProperty("mass", system.getParticleMass(i));
         if (system.isVirtualSite(i)) {
             if (typeid(system.getVirtualSite(i)) == typeid(TwoParticleAverageSite)) {
                 const TwoParticleAverageSite& site = dynamic_cast<const TwoParticleAverageSite&>(system.getVirtualSite(i));
@@ -95,8 +114,26 @@ void SystemProxy::serialize(const void* object, SerializationNode& node) const {
         forces.createChildNode("Force", &system.getForce(i));
 }
 
+static VirtualSite* decodeVirtualSite(const SerializationNode& vsite) {
+    if (vsite.getName() == "TwoParticleAverageSite")
+        return new TwoParticleAverageSite(vsite.getIntProperty("p1"), vsite.getIntProperty("p2"), vsite.getDoubleProperty("w1"), vsite.getDoubleProperty("w2"));
+    if (vsite.getName() == "ThreeParticleAverageSite")
+        return new ThreeParticleAverageSite(vsite.getIntProperty("p1"), vsite.getIntProperty("p2"), vsite.getIntProperty("p3"), vsite.getDoubleProperty("w1"), vsite.getDoubleProperty("w2"), vsite.getDoubleProperty("w3"));
+    if (vsite.getName() == "OutOfPlaneSite")
+        return new OutOfPlaneSite(vsite.getIntProperty("p1"), vsite.getIntProperty("p2"), vsite.getIntProperty("p3"), vsite.getDoubleProperty("w12"), vsite.getDoubleProperty("w13"), vsite.getDoubleProperty("wc"));
+    if (vsite.getName() == "LocalCoordinatesSite") {
+        Vec3 wo(vsite.getDoubleProperty("wo1"), vsite.getDoubleProperty("wo2"), vsite.getDoubleProperty("wo3"));
+        Vec3 wx(vsite.getDoubleProperty("wx1"), vsite.getDoubleProperty("wx2"), vsite.getDoubleProperty("wx3"));
+        Vec3 wy(vsite.getDoubleProperty("wy1"), vsite.getDoubleProperty("wy2"), vsite.getDoubleProperty("wy3"));
+        Vec3 p(vsite.getDoubleProperty("pos1"), vsite.getDoubleProperty("pos2"), vsite.getDoubleProperty("pos3"));
+        return new LocalCoordinatesSite(vsite.getIntProperty("p1"), vsite.getIntProperty("p2"), vsite.getIntProperty("p3"), wo, wx, wy, p);
+    }
+    return NULL;
+}
+
 void* SystemProxy::deserialize(const SerializationNode& node) const {
-    if (node.getIntProperty("version") != 1)
+    int version = node.getIntProperty("version");
+    if (version < 1 || version > 2)
         throw OpenMMException("Unsupported version number");
     System* system = new System();
     try {
@@ -109,22 +146,25 @@ void* SystemProxy::deserialize(const SerializationNode& node) const {
         Vec3 c(boxc.getDoubleProperty("x"), boxc.getDoubleProperty("y"), boxc.getDoubleProperty("z"));
         system->setDefaultPeriodicBoxVectors(a, b, c);
         const SerializationNode& particles = node.getChildNode("Particles");
-        for (int i = 0; i < (int) particles.getChildren().size(); i++) {
-            system->addParticle(particles.getChildren()[i].getDoubleProperty("mass"));
-            if (particles.getChildren()[i].getChildren().size() > 0) {
-                const SerializationNode& vsite = particles.getChildren()[i].getChildren()[0];
-                if (vsite.getName() == "TwoParticleAverageSite")
-                    system->setVirtualSite(i, new TwoParticleAverageSite(vsite.getIntProperty("p1"), vsite.getIntProperty("p2"), vsite.getDoubleProperty("w1"), vsite.getDoubleProperty("w2")));
-                else if (vsite.getName() == "ThreeParticleAverageSite")
-                    system->setVirtualSite(i, new ThreeParticleAverageSite(vsite.getIntProperty("p1"), vsite.getIntProperty("p2"), vsite.getIntProperty("p3"), vsite.getDoubleProperty("w1"), vsite.getDoubleProperty("w2"), vsite.getDoubleProperty("w3")));
-                else if (vsite.getName() == "OutOfPlaneSite")
-                    system->setVirtualSite(i, new OutOfPlaneSite(vsite.getIntProperty("p1"), vsite.getIntProperty("p2"), vsite.getIntProperty("p3"), vsite.getDoubleProperty("w12"), vsite.getDoubleProperty("w13"), vsite.getDoubleProperty("wc")));
-                else if (vsite.getName() == "LocalCoordinatesSite") {
-                    Vec3 wo(vsite.getDoubleProperty("wo1"), vsite.getDoubleProperty("wo2"), vsite.getDoubleProperty("wo3"));
-                    Vec3 wx(vsite.getDoubleProperty("wx1"), vsite.getDoubleProperty("wx2"), vsite.getDoubleProperty("wx3"));
-                    Vec3 wy(vsite.getDoubleProperty("wy1"), vsite.getDoubleProperty("wy2"), vsite.getDoubleProperty("wy3"));
-                    Vec3 p(vsite.getDoubleProperty("pos1"), vsite.getDoubleProperty("pos2"), vsite.getDoubleProperty("pos3"));
-                    system->setVirtualSite(i, new LocalCoordinatesSite(vsite.getIntProperty("p1"), vsite.getIntProperty("p2"), vsite.getIntProperty("p3"), wo, wx, wy, p));
+        if (particles.hasProperty("masses")) {
+            vector<double> masses;
+            particles.getDoubleArrayProperty("masses", masses);
+            for (int i = 0; i < (int) masses.size(); i++)
+                system->addParticle(masses[i]);
+            for (auto& particle : particles.getChildren())
+                if (particle.getChildren().size() > 0) {
+                    VirtualSite* vsite = decodeVirtualSite(particle.getChildren()[0]);
+                    if (vsite != NULL)
+                        system->setVirtualSite(particle.getIntProperty("index"), vsite);
+                }
+        }
+        else {
+            for (int i = 0; i < (int) particles.getChildren().size(); i++) {
+                system->addParticle(particles.getChildren()[i].getDoubleProperty("mass"));
+                if (particles.getChildren()[i].getChildren().size() > 0) {
+                    VirtualSite* vsite = decodeVirtualSite(particles.getChildren()[i].getChildren()[0]);
+                    if (vsite != NULL)
+                        system->setVirtualSite(i, vsite);
                 }
             }
         }
@@ -132,8 +172,37 @@ void* SystemProxy::deserialize(const SerializationNode& node) const {
         for (auto& constraint : constraints.getChildren())
             system->addConstraint(constraint.getIntProperty("p1"), constraint.getIntProperty("p2"), constraint.getDoubleProperty("d"));
         const SerializationNode& forces = node.getChildNode("Forces");
-        for (auto& force : forces.getChildren())
-            system->addForce(force.decodeObject<Force>());
+        const vector<SerializationNode>& forceNodes = forces.getChildren();
+        int numForces = forceNodes.size();
+        if (numForces == 1)
+            system->addForce(forceNodes[0].decodeObject<Force>());
+        else if (numForces > 1) {
+            // The subtree for each force is independent of the others, so decode them in parallel.
+
+            ThreadPool threads;
+            vector<Force*> decodedForces(numForces, (Force*) NULL);
+            vector<exception_ptr> threadException(threads.getNumThreads());
+            threads.execute([&] (ThreadPool& pool, int index) {
+                for (int i = index; i < numForces; i += pool.getNumThreads()) {
+                    try {
+                        decodedForces[i] = forceNodes[i].decodeObject<Force>();
+                    }
+                    catch (...) {
+                        threadException[index] = current_exception();
+                        return;
+                    }
+                }
+            });
+            threads.waitForThreads();
+            for (auto& e : threadException)
+                if (e) {
+                    for (Force* force : decodedForces)
+                        delete force;
+                    rethrow_exception(e);
+                }
+            for (Force* force : decodedForces)
+                system->addForce(force);
+        }
     }
     catch (...) {
         delete system;
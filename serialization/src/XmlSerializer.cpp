@@ -106,6 +106,16 @@ static void encodeString(const string& str, string* outString) {
     }
 }
 
+bool XmlSerializer::useBinaryArrays = false;
+
+bool XmlSerializer::getUseBinaryArrays() {
+    return useBinaryArrays;
+}
+
+void XmlSerializer::setUseBinaryArrays(bool use) {
+    useBinaryArrays = use;
+}
+
 void XmlSerializer::serialize(const SerializationNode& node, std::ostream& stream) {
     stream << "<?xml version=\"1.0\" ?>\n";
     encodeNode(node, stream, 0);
@@ -75,9 +75,37 @@ void testProperties() {
     ASSERT_EQUAL(false, node.hasProperty("prop2"));
 }
 
+void testArrayProperties() {
+    SerializationNode node;
+    vector<double> doubleValues;
+    doubleValues.push_back(1.5);
+    doubleValues.push_back(-2.25);
+    doubleValues.push_back(1e-100);
+    node.setDoubleArrayProperty("doubles", doubleValues);
+    vector<double> doubleValues2;
+    node.getDoubleArrayProperty("doubles", doubleValues2);
+    ASSERT_EQUAL(doubleValues.size(), doubleValues2.size());
+    for (int i = 0; i < (int) doubleValues.size(); i++)
+        ASSERT_EQUAL(doubleValues[i], doubleValues2[i]);
+    vector<int> intValues;
+    intValues.push_back(3);
+    intValues.push_back(-100);
+    intValues.push_back(2000000000);
+    node.setIntArrayProperty("ints", intValues);
+    vector<int> intValues2;
+    node.getIntArrayProperty("ints", intValues2);
+    ASSERT_EQUAL(intValues.size(), intValues2.size());
+    for (int i = 0; i < (int) intValues.size(); i++)
+        ASSERT_EQUAL(intValues[i], intValues2[i]);
+    node.setDoubleArrayProperty("empty", vector<double>());
+    node.getDoubleArrayProperty("empty", doubleValues2);
+    ASSERT_EQUAL(0, doubleValues2.size());
+}
+
 int main() {
     try {
         testProperties();
+        testArrayProperties();
     }
     catch(const exception& e) {
         cout << "exception: " << e.what() << endl;
@@ -0,0 +1,94 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "openmm/internal/AssertionUtilities.h"
+#include "openmm/CustomBondForce.h"
+#include "openmm/CustomCVForce.h"
+#include "openmm/serialization/XmlSerializer.h"
+#include <iostream>
+#include <sstream>
+
+using namespace OpenMM;
+using namespace std;
+
+void testSerialization() {
+    // Create a Force.
+
+    CustomCVForce force("x+2*y");
+    force.setForceGroup(3);
+    force.addGlobalParameter("a", 1.3);
+    force.addGlobalParameter("b", 2.221);
+    CustomBondForce* v1 = new CustomBondForce("r+a");
+    v1->addGlobalParameter("a", 2.0);
+    v1->addBond(0, 1);
+    force.addCollectiveVariable("x", v1);
+    CustomBondForce* v2 = new CustomBondForce("r^2");
+    v2->addBond(0, 2);
+    force.addCollectiveVariable("y", v2);
+
+    // Serialize and then deserialize it.
+
+    stringstream buffer;
+    XmlSerializer::serialize<CustomCVForce>(&force, "Force", buffer);
+    CustomCVForce* copy = XmlSerializer::deserialize<CustomCVForce>(buffer);
+
+    // Compare the two forces to see if they are identical.
+
+    CustomCVForce& force2 = *copy;
+    ASSERT_EQUAL(force.getForceGroup(), force2.getForceGroup());
+    ASSERT_EQUAL(force.getEnergyFunction(), force2.getEnergyFunction());
+    ASSERT_EQUAL(force.getNumGlobalParameters(), force2.getNumGlobalParameters());
+    for (int i = 0; i < force.getNumGlobalParameters(); i++) {
+        ASSERT_EQUAL(force.getGlobalParameterName(i), force2.getGlobalParameterName(i));
+        ASSERT_EQUAL(force.getGlobalParameterDefaultValue(i), force2.getGlobalParameterDefaultValue(i));
+    }
+    ASSERT_EQUAL(force.getNumCollectiveVariables(), force2.getNumCollectiveVariables());
+    for (int i = 0; i < force.getNumCollectiveVariables(); i++) {
+        ASSERT_EQUAL(force.getCollectiveVariableName(i), force2.getCollectiveVariableName(i));
+        const CustomBondForce& variable1 = dynamic_cast<const CustomBondForce&>(force.getCollectiveVariable(i));
+        const CustomBondForce& variable2 = dynamic_cast<const CustomBondForce&>(force2.getCollectiveVariable(i));
+        ASSERT_EQUAL(variable1.getEnergyFunction(), variable2.getEnergyFunction());
+        ASSERT_EQUAL(variable1.getNumBonds(), variable2.getNumBonds());
+        ASSERT_EQUAL(variable1.getNumGlobalParameters(), variable2.getNumGlobalParameters());
+    }
+}
+
+int main() {
+    try {
+        testSerialization();
+    }
+    catch(const exception& e) {
+        cout << "exception: " << e.what() << endl;
+        return 1;
+    }
+    cout << "Done" << endl;
+    return 0;
+}
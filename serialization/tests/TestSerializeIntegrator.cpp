@@ -35,6 +35,8 @@
 #include "openmm/CompoundIntegrator.h"
 #include "openmm/CustomIntegrator.h"
 #include "openmm/LangevinIntegrator.h"
+#include "openmm/LangevinMiddleIntegrator.h"
+#include "openmm/MTSIntegrator.h"
 #include "openmm/VariableLangevinIntegrator.h"
 #include "openmm/VariableVerletIntegrator.h"
 #include "openmm/VerletIntegrator.h"
@@ -115,6 +117,39 @@ void testSerializeVariableLangevinIntegrator() {
     delete intg2;
 }
 
+void testSerializeLangevinMiddleIntegrator() {
+    LangevinMiddleIntegrator *intg = new LangevinMiddleIntegrator(372.4, 1.234, 0.0036);
+    stringstream ss;
+    XmlSerializer::serialize<Integrator>(intg, "LangevinMiddleIntegrator", ss);
+    LangevinMiddleIntegrator *intg2 = dynamic_cast<LangevinMiddleIntegrator*>(XmlSerializer::deserialize<Integrator>(ss));
+    ASSERT_EQUAL(intg->getConstraintTolerance(), intg2->getConstraintTolerance());
+    ASSERT_EQUAL(intg->getStepSize(), intg2->getStepSize());
+    ASSERT_EQUAL(intg->getFriction(), intg2->getFriction());
+    ASSERT_EQUAL(intg->getTemperature(), intg2->getTemperature());
+    ASSERT_EQUAL(intg->getRandomNumberSeed(), intg2->getRandomNumberSeed());
+    delete intg;
+    delete intg2;
+}
+
+void testSerializeMTSIntegrator() {
+    vector<pair<int, int> > groups;
+    groups.push_back(make_pair(0, 4));
+    groups.push_back(make_pair(1, 1));
+    MTSIntegrator *intg = new MTSIntegrator(0.00412, groups);
+    stringstream ss;
+    XmlSerializer::serialize<Integrator>(intg, "MTSIntegrator", ss);
+    MTSIntegrator *intg2 = dynamic_cast<MTSIntegrator*>(XmlSerializer::deserialize<Integrator>(ss));
+    ASSERT_EQUAL(intg->getConstraintTolerance(), intg2->getConstraintTolerance());
+    ASSERT_EQUAL(intg->getStepSize(), intg2->getStepSize());
+    ASSERT_EQUAL(intg->getGroups().size(), intg2->getGroups().size());
+    for (int i = 0; i < (int) intg->getGroups().size(); i++) {
+        ASSERT_EQUAL(intg->getGroups()[i].first, intg2->getGroups()[i].first);
+        ASSERT_EQUAL(intg->getGroups()[i].second, intg2->getGroups()[i].second);
+    }
+    delete intg;
+    delete intg2;
+}
+
 void testSerializeCustomIntegrator() {
     CustomIntegrator *intg = new CustomIntegrator(0.002234);
     intg->addPerDofVariable("temp",0);
@@ -222,6 +257,8 @@ int main() {
         testSerializeBrownianIntegrator();
         testSerializeCustomIntegrator();
         testSerializeVerletIntegrator();
+        testSerializeLangevinMiddleIntegrator();
+        testSerializeMTSIntegrator();
         testSerializeVariableLangevinIntegrator();
         testSerializeVariableVerletIntegrator();
         testSerializeLangevinIntegrator();
@@ -121,6 +121,11 @@ void testSerialization() {
 int main() {
     try {
         testSerialization();
+
+        // Repeat the test with binary encoding of large arrays.
+
+        XmlSerializer::setUseBinaryArrays(true);
+        testSerialization();
     }
     catch(const exception& e) {
         cout << "exception: " << e.what() << endl;
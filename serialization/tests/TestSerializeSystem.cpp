@@ -30,6 +30,7 @@
  * -------------------------------------------------------------------------- */
 
 #include "openmm/internal/AssertionUtilities.h"
+#include "openmm/CustomBondForce.h"
 #include "openmm/HarmonicBondForce.h"
 #include "openmm/System.h"
 #include "openmm/VirtualSite.h"
@@ -103,6 +104,7 @@ void testSerialization() {
     system.setVirtualSite(6, new ThreeParticleAverageSite(2, 4, 3, 0.5, 0.2, 0.3));
     system.setVirtualSite(7, new OutOfPlaneSite(0, 3, 1, 0.1, 0.2, 0.5));
     system.addForce(new HarmonicBondForce());
+    system.addForce(new CustomBondForce("scale*r"));
 
     // Serialize and then deserialize it, then make sure the systems are identical.
 
@@ -117,11 +119,24 @@ void testSerialization() {
     copy = XmlSerializer::clone(system);
     compareSystems(system, *copy);
     delete copy;
+
+    // Now use the copy constructor and assignment operator, which copy the contents directly.
+
+    System copy2(system);
+    compareSystems(system, copy2);
+    System copy3;
+    copy3 = system;
+    compareSystems(system, copy3);
 }
 
 int main() {
     try {
         testSerialization();
+
+        // Repeat the test with binary encoding of large arrays.
+
+        XmlSerializer::setUseBinaryArrays(true);
+        testSerialization();
     }
     catch(const exception& e) {
         cout << "exception: " << e.what() << endl;
@@ -116,12 +116,84 @@ void testSetState() {
     }
 }
 
+void testAsynchronousCheckpoint() {
+    const int numParticles = 10;
+    const double boxSize = 3.0;
+    System system;
+    NonbondedForce* nonbonded = new NonbondedForce();
+    system.addForce(nonbonded);
+    nonbonded->setNonbondedMethod(NonbondedForce::CutoffPeriodic);
+    vector<Vec3> positions(numParticles);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    for (int i = 0; i < numParticles; i++) {
+        system.addParticle(1.0);
+        nonbonded->addParticle(i%2 == 0 ? 0.1 : -0.1, 0.2, 0.1);
+        positions[i] = Vec3(boxSize*genrand_real2(sfmt), boxSize*genrand_real2(sfmt), boxSize*genrand_real2(sfmt));
+    }
+    VerletIntegrator integrator(0.001);
+    Context context(system, integrator, platform);
+    context.setPositions(positions);
+    context.setPeriodicBoxVectors(Vec3(boxSize, 0, 0), Vec3(0, boxSize, 0), Vec3(0, 0, boxSize));
+
+    // Create a checkpoint without waiting for the write, then keep simulating while it completes.
+
+    integrator.step(100);
+    State s1 = context.getState(State::Positions | State::Velocities | State::Parameters);
+    stringstream checkpoint;
+    context.createCheckpoint(checkpoint, false);
+    integrator.step(10);
+
+    // Loading the checkpoint waits for the write to finish, then restores the recorded state.
+
+    context.loadCheckpoint(checkpoint);
+    State s2 = context.getState(State::Positions | State::Velocities | State::Parameters);
+    compareStates(s1, s2);
+}
+
+void testReinitializePreservingState() {
+    const int numParticles = 10;
+    const double boxSize = 3.0;
+    System system;
+    NonbondedForce* nonbonded = new NonbondedForce();
+    system.addForce(nonbonded);
+    nonbonded->setNonbondedMethod(NonbondedForce::CutoffPeriodic);
+    vector<Vec3> positions(numParticles);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    for (int i = 0; i < numParticles; i++) {
+        system.addParticle(1.0);
+        nonbonded->addParticle(i%2 == 0 ? 0.1 : -0.1, 0.2, 0.1);
+        positions[i] = Vec3(boxSize*genrand_real2(sfmt), boxSize*genrand_real2(sfmt), boxSize*genrand_real2(sfmt));
+    }
+    VerletIntegrator integrator(0.001);
+    Context context(system, integrator, platform);
+    context.setPositions(positions);
+    context.setPeriodicBoxVectors(Vec3(boxSize, 0, 0), Vec3(0, boxSize, 0), Vec3(0, 0, boxSize));
+
+    // Run for a little while, then modify a force and reinitialize the context, asking
+    // for the state to be preserved.
+
+    integrator.step(100);
+    State s1 = context.getState(State::Positions | State::Velocities | State::Parameters);
+    nonbonded->setParticleParameters(0, 0.2, 0.2, 0.1);
+    context.reinitialize(true);
+    State s2 = context.getState(State::Positions | State::Velocities | State::Parameters);
+    compareStates(s1, s2);
+
+    // Make sure the simulation can continue from the restored state.
+
+    integrator.step(10);
+}
+
 void runPlatformTests();
 
 int main(int argc, char* argv[]) {
     try {
         initializeTests(argc, argv);
         testSetState();
+        testAsynchronousCheckpoint();
+        testReinitializePreservingState();
         runPlatformTests();
     }
     catch(const exception& e) {
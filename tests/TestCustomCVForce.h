@@ -0,0 +1,166 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "openmm/internal/AssertionUtilities.h"
+#include "openmm/Context.h"
+#include "openmm/CustomBondForce.h"
+#include "openmm/CustomCVForce.h"
+#include "openmm/System.h"
+#include "openmm/VerletIntegrator.h"
+#include <iostream>
+#include <vector>
+
+using namespace OpenMM;
+using namespace std;
+
+const double TOL = 1e-5;
+
+void testCVs() {
+    // Create a system with two collective variables, each defined by a CustomBondForce.
+
+    System system;
+    system.addParticle(1.0);
+    system.addParticle(1.0);
+    system.addParticle(1.0);
+    CustomCVForce* cv = new CustomCVForce("a*v1+b*v2^2");
+    cv->addGlobalParameter("a", 1.5);
+    cv->addGlobalParameter("b", 2.0);
+    CustomBondForce* v1 = new CustomBondForce("2*r");
+    v1->addBond(0, 1);
+    cv->addCollectiveVariable("v1", v1);
+    CustomBondForce* v2 = new CustomBondForce("r");
+    v2->addBond(0, 2);
+    cv->addCollectiveVariable("v2", v2);
+    system.addForce(cv);
+    VerletIntegrator integrator(0.01);
+    Context context(system, integrator, platform);
+    vector<Vec3> positions(3);
+    positions[0] = Vec3(0, 0, 0);
+    positions[1] = Vec3(1, 0, 0);
+    positions[2] = Vec3(0, 0, 2);
+    context.setPositions(positions);
+
+    // Check the values of the collective variables.
+
+    vector<double> values;
+    cv->getCollectiveVariableValues(context, values);
+    ASSERT_EQUAL_TOL(2.0, values[0], TOL);
+    ASSERT_EQUAL_TOL(2.0, values[1], TOL);
+
+    // Check the energy and forces.
+
+    State state = context.getState(State::Energy | State::Forces);
+    ASSERT_EQUAL_TOL(1.5*2.0+2.0*2.0*2.0, state.getPotentialEnergy(), TOL);
+    ASSERT_EQUAL_VEC(Vec3(3.0, 0, 8.0), state.getForces()[0], TOL);
+    ASSERT_EQUAL_VEC(Vec3(-3.0, 0, 0), state.getForces()[1], TOL);
+    ASSERT_EQUAL_VEC(Vec3(0, 0, -8.0), state.getForces()[2], TOL);
+
+    // Change a global parameter and see if the results change.
+
+    context.setParameter("a", 3.0);
+    state = context.getState(State::Energy | State::Forces);
+    ASSERT_EQUAL_TOL(3.0*2.0+2.0*2.0*2.0, state.getPotentialEnergy(), TOL);
+    ASSERT_EQUAL_VEC(Vec3(-6.0, 0, 0), state.getForces()[1], TOL);
+}
+
+void testInnerParameter() {
+    // Create a collective variable that depends on its own global parameter.
+
+    System system;
+    system.addParticle(1.0);
+    system.addParticle(1.0);
+    CustomCVForce* cv = new CustomCVForce("v1");
+    CustomBondForce* v1 = new CustomBondForce("scale*r");
+    v1->addGlobalParameter("scale", 1.0);
+    v1->addBond(0, 1);
+    cv->addCollectiveVariable("v1", v1);
+    system.addForce(cv);
+    VerletIntegrator integrator(0.01);
+    Context context(system, integrator, platform);
+    vector<Vec3> positions(2);
+    positions[0] = Vec3(0, 0, 0);
+    positions[1] = Vec3(2, 0, 0);
+    context.setPositions(positions);
+    ASSERT_EQUAL_TOL(2.0, context.getState(State::Energy).getPotentialEnergy(), TOL);
+
+    // The parameter is defined by the collective variable, but it should still be
+    // settable through the main Context.
+
+    context.setParameter("scale", 1.5);
+    ASSERT_EQUAL_TOL(3.0, context.getState(State::Energy).getPotentialEnergy(), TOL);
+    ASSERT_EQUAL(1.5, cv->getInnerContext(context).getParameter("scale"));
+}
+
+void testEnergyConservation() {
+    // Simulate a harmonic restraint on a distance, implemented as a CustomCVForce, and
+    // make sure the energy is conserved.
+
+    System system;
+    system.addParticle(1.0);
+    system.addParticle(1.0);
+    CustomCVForce* cv = new CustomCVForce("100*(d-1)^2");
+    CustomBondForce* d = new CustomBondForce("r");
+    d->addBond(0, 1);
+    cv->addCollectiveVariable("d", d);
+    system.addForce(cv);
+    VerletIntegrator integrator(0.001);
+    Context context(system, integrator, platform);
+    vector<Vec3> positions(2);
+    positions[0] = Vec3(0, 0, 0);
+    positions[1] = Vec3(1.2, 0, 0);
+    context.setPositions(positions);
+    State initial = context.getState(State::Energy);
+    double energy0 = initial.getPotentialEnergy()+initial.getKineticEnergy();
+    for (int i = 0; i < 10; i++) {
+        integrator.step(100);
+        State state = context.getState(State::Energy);
+        double energy = state.getPotentialEnergy()+state.getKineticEnergy();
+        ASSERT_EQUAL_TOL(energy0, energy, 1e-3);
+    }
+}
+
+void runPlatformTests();
+
+int main(int argc, char* argv[]) {
+    try {
+        initializeTests(argc, argv);
+        testCVs();
+        testInnerParameter();
+        testEnergyConservation();
+        runPlatformTests();
+    }
+    catch(const exception& e) {
+        cout << "exception: " << e.what() << endl;
+        return 1;
+    }
+    cout << "Done" << endl;
+    return 0;
+}
@@ -94,6 +94,57 @@ void testForce() {
     }
 }
 
+void testUpdateSelectedParameters() {
+    // Create a system with a harmonic restraint on every particle, then move the anchor
+    // points of a few of them and verify that updating just those particles gives the same
+    // result as updating everything.
+
+    const int numParticles = 20;
+    System system;
+    CustomExternalForce* force = new CustomExternalForce("(x-x0)^2+(y-y0)^2+(z-z0)^2");
+    force->addPerParticleParameter("x0");
+    force->addPerParticleParameter("y0");
+    force->addPerParticleParameter("z0");
+    vector<Vec3> positions(numParticles);
+    for (int i = 0; i < numParticles; i++) {
+        system.addParticle(1.0);
+        positions[i] = Vec3(i, 0.1*i, -0.3*i);
+        vector<double> params(3);
+        params[0] = i+0.5;
+        params[1] = 0.2*i;
+        params[2] = -0.3*i+1.0;
+        force->addParticle(i, params);
+    }
+    system.addForce(force);
+    VerletIntegrator integrator(0.01);
+    Context context(system, integrator, platform);
+    context.setPositions(positions);
+    vector<int> changed;
+    changed.push_back(3);
+    changed.push_back(4);
+    changed.push_back(5);
+    changed.push_back(17);
+    for (int i : changed) {
+        vector<double> params(3);
+        params[0] = 2.0*i;
+        params[1] = -0.5*i;
+        params[2] = 0.1*i;
+        force->setParticleParameters(i, i, params);
+    }
+    force->updateSelectedParametersInContext(context, changed);
+    State state1 = context.getState(State::Forces | State::Energy);
+
+    // Now rebuild the context from scratch and compare.
+
+    VerletIntegrator integrator2(0.01);
+    Context context2(system, integrator2, platform);
+    context2.setPositions(positions);
+    State state2 = context2.getState(State::Forces | State::Energy);
+    ASSERT_EQUAL_TOL(state2.getPotentialEnergy(), state1.getPotentialEnergy(), TOL);
+    for (int i = 0; i < numParticles; i++)
+        ASSERT_EQUAL_VEC(state2.getForces()[i], state1.getForces()[i], TOL);
+}
+
 void testManyParameters() {
     System system;
     system.addParticle(1.0);
@@ -222,6 +273,7 @@ int main(int argc, char* argv[]) {
     try {
         initializeTests(argc, argv);
         testForce();
+        testUpdateSelectedParameters();
         testManyParameters();
         testPeriodic();
         testZeroPeriodicDistance();
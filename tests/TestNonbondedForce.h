@@ -685,6 +685,46 @@ void testSwitchingFunction(NonbondedForce::NonbondedMethod method) {
     }
 }
 
+void testEnergiesByForceGroup() {
+    // Check that the per group energies in a single State match the energies found by
+    // evaluating each group on its own.
+
+    const int numParticles = 10;
+    System system;
+    NonbondedForce* nonbonded = new NonbondedForce();
+    HarmonicBondForce* bonds = new HarmonicBondForce();
+    for (int i = 0; i < numParticles; i++) {
+        system.addParticle(1.0);
+        nonbonded->addParticle(i%2 == 0 ? 0.2 : -0.2, 0.3, 0.5);
+    }
+    for (int i = 0; i < numParticles-1; i++) {
+        bonds->addBond(i, i+1, 0.15, 100.0);
+        nonbonded->addException(i, i+1, 0.0, 0.3, 0.0);
+    }
+    nonbonded->setForceGroup(1);
+    bonds->setForceGroup(3);
+    system.addForce(nonbonded);
+    system.addForce(bonds);
+    VerletIntegrator integrator(0.001);
+    Context context(system, integrator, platform);
+    vector<Vec3> positions(numParticles);
+    for (int i = 0; i < numParticles; i++)
+        positions[i] = Vec3(0.14*i, 0.02*(i%3), 0.0);
+    context.setPositions(positions);
+    State state = context.getState(State::Energy | State::GroupEnergies);
+    const map<int, double>& groupEnergies = state.getEnergiesByForceGroup();
+    ASSERT_EQUAL(2, (int) groupEnergies.size());
+    ASSERT_EQUAL_TOL(context.getState(State::Energy, false, 1<<1).getPotentialEnergy(), groupEnergies.at(1), TOL);
+    ASSERT_EQUAL_TOL(context.getState(State::Energy, false, 1<<3).getPotentialEnergy(), groupEnergies.at(3), TOL);
+    ASSERT_EQUAL_TOL(state.getPotentialEnergy(), groupEnergies.at(1)+groupEnergies.at(3), TOL);
+
+    // Requesting only some of the groups should limit what the State contains.
+
+    State state2 = context.getState(State::GroupEnergies, false, 1<<3);
+    ASSERT_EQUAL(1, (int) state2.getEnergiesByForceGroup().size());
+    ASSERT_EQUAL_TOL(groupEnergies.at(3), state2.getEnergiesByForceGroup().at(3), TOL);
+}
+
 void runPlatformTests();
 
 int main(int argc, char* argv[]) {
@@ -702,6 +742,7 @@ int main(int argc, char* argv[]) {
         testChangingParameters();
         testSwitchingFunction(NonbondedForce::CutoffNonPeriodic);
         testSwitchingFunction(NonbondedForce::PME);
+        testEnergiesByForceGroup();
         runPlatformTests();
     }
     catch(const exception& e) {
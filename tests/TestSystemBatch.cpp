@@ -0,0 +1,182 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "openmm/internal/AssertionUtilities.h"
+#include "openmm/Context.h"
+#include "openmm/HarmonicAngleForce.h"
+#include "openmm/HarmonicBondForce.h"
+#include "openmm/NonbondedForce.h"
+#include "openmm/OpenMMException.h"
+#include "openmm/Platform.h"
+#include "openmm/System.h"
+#include "openmm/SystemBatch.h"
+#include "openmm/VerletIntegrator.h"
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+using namespace OpenMM;
+using namespace std;
+
+/**
+ * Build a small molecule: a chain of particles connected by bonds and angles, with
+ * nonbonded interactions between the ends.  Each variant has a different size and
+ * different parameters.
+ */
+void buildMolecule(int variant, System& system, vector<Vec3>& positions) {
+    int numParticles = 4+variant;
+    NonbondedForce* nonbonded = new NonbondedForce();
+    nonbonded->setNonbondedMethod(NonbondedForce::CutoffNonPeriodic);
+    nonbonded->setCutoffDistance(1.0);
+    system.addForce(nonbonded);
+    HarmonicBondForce* bonds = new HarmonicBondForce();
+    system.addForce(bonds);
+    HarmonicAngleForce* angles = new HarmonicAngleForce();
+    system.addForce(angles);
+    for (int i = 0; i < numParticles; i++) {
+        system.addParticle(12.0);
+        nonbonded->addParticle(0.1*(i%2 == 0 ? 1 : -1), 0.3, 0.5+0.1*variant);
+        if (i > 0) {
+            bonds->addBond(i-1, i, 0.15, 100000.0+10000.0*variant);
+            nonbonded->addException(i-1, i, 0.0, 1.0, 0.0);
+        }
+        if (i > 1) {
+            angles->addAngle(i-2, i-1, i, 2.0, 500.0);
+            nonbonded->addException(i-2, i, 0.0, 1.0, 0.0);
+        }
+        positions.push_back(Vec3(0.14*i, 0.05*sin(1.3*i+variant), 0.05*cos(2.1*i+variant)));
+    }
+    system.addConstraint(0, 1, 0.15);
+}
+
+void testForcesAndEnergy() {
+    // Compare the forces and energy of each molecule simulated on its own against the
+    // same molecules simulated together in a batch.  Since the molecules should not
+    // interact, the results should match.
+
+    const int numSystems = 5;
+    SystemBatch batch(3.0);
+    vector<System> systems(numSystems);
+    vector<vector<Vec3> > positions(numSystems);
+    double expectedEnergy = 0.0;
+    vector<vector<Vec3> > expectedForces(numSystems);
+    for (int i = 0; i < numSystems; i++) {
+        buildMolecule(i, systems[i], positions[i]);
+        VerletIntegrator integrator(0.001);
+        Context context(systems[i], integrator, Platform::getPlatformByName("Reference"));
+        context.setPositions(positions[i]);
+        State state = context.getState(State::Forces | State::Energy);
+        expectedEnergy += state.getPotentialEnergy();
+        expectedForces[i] = state.getForces();
+        ASSERT_EQUAL(i, batch.addSystem(systems[i]));
+    }
+    ASSERT_EQUAL(numSystems, batch.getNumSystems());
+    VerletIntegrator integrator(0.001);
+    Context context(batch.getCombinedSystem(), integrator, Platform::getPlatformByName("Reference"));
+    batch.setPositions(context, positions);
+    State state = context.getState(State::Positions | State::Forces | State::Energy);
+    ASSERT_EQUAL_TOL(expectedEnergy, state.getPotentialEnergy(), 1e-5);
+    for (int i = 0; i < numSystems; i++) {
+        vector<Vec3> systemPositions, systemForces;
+        batch.getPositions(state, i, systemPositions);
+        batch.getForces(state, i, systemForces);
+        ASSERT_EQUAL(batch.getNumParticles(i), (int) systemForces.size());
+        for (int j = 0; j < (int) systemForces.size(); j++) {
+            ASSERT_EQUAL_VEC(positions[i][j], systemPositions[j], 1e-6);
+            ASSERT_EQUAL_VEC(expectedForces[i][j], systemForces[j], 1e-5);
+        }
+    }
+}
+
+void testDynamics() {
+    // Simulate the batch for a while and verify every molecule follows the same
+    // trajectory it would follow on its own.
+
+    const int numSystems = 4;
+    const int numSteps = 50;
+    SystemBatch batch(3.0);
+    vector<System> systems(numSystems);
+    vector<vector<Vec3> > positions(numSystems);
+    vector<vector<Vec3> > expectedPositions(numSystems);
+    for (int i = 0; i < numSystems; i++) {
+        buildMolecule(i, systems[i], positions[i]);
+        VerletIntegrator integrator(0.001);
+        Context context(systems[i], integrator, Platform::getPlatformByName("Reference"));
+        context.setPositions(positions[i]);
+        integrator.step(numSteps);
+        expectedPositions[i] = context.getState(State::Positions).getPositions();
+        batch.addSystem(systems[i]);
+    }
+    VerletIntegrator integrator(0.001);
+    Context context(batch.getCombinedSystem(), integrator, Platform::getPlatformByName("Reference"));
+    batch.setPositions(context, positions);
+    integrator.step(numSteps);
+    State state = context.getState(State::Positions);
+    for (int i = 0; i < numSystems; i++) {
+        vector<Vec3> systemPositions;
+        batch.getPositions(state, i, systemPositions);
+        for (int j = 0; j < (int) systemPositions.size(); j++)
+            ASSERT_EQUAL_VEC(expectedPositions[i][j], systemPositions[j], 1e-5);
+    }
+}
+
+void testInvalidSystems() {
+    // Systems whose Forces cannot be isolated from their neighbors should be rejected.
+
+    SystemBatch batch(3.0);
+    System system;
+    system.addParticle(1.0);
+    NonbondedForce* nonbonded = new NonbondedForce();
+    nonbonded->addParticle(0.0, 0.3, 1.0);
+    system.addForce(nonbonded);
+    bool threwException = false;
+    try {
+        batch.addSystem(system);
+    }
+    catch (const OpenMMException& ex) {
+        threwException = true;
+    }
+    ASSERT(threwException);
+}
+
+int main() {
+    try {
+        testForcesAndEnergy();
+        testDynamics();
+        testInvalidSystems();
+    }
+    catch(const exception& e) {
+        cout << "exception: " << e.what() << endl;
+        return 1;
+    }
+    cout << "Done" << endl;
+    return 0;
+}
@@ -0,0 +1,194 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2026 Stanford University and the Authors.           *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+#include "openmm/internal/AssertionUtilities.h"
+#include "openmm/BinaryTrajectoryWriter.h"
+#include "openmm/Context.h"
+#include "openmm/DCDTrajectoryWriter.h"
+#include "openmm/HarmonicBondForce.h"
+#include "openmm/Platform.h"
+#include "openmm/VerletIntegrator.h"
+#include "sfmt/SFMT.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+using namespace OpenMM;
+using namespace std;
+
+const int numParticles = 10;
+const int numFrames = 5;
+const int stepsPerFrame = 10;
+
+/**
+ * Run a short simulation, writing frames with the given writer, and return the positions
+ * that each frame should contain.
+ */
+vector<vector<Vec3> > writeTrajectory(TrajectoryWriter& writer) {
+    System system;
+    HarmonicBondForce* bonds = new HarmonicBondForce();
+    system.addForce(bonds);
+    OpenMM_SFMT::SFMT sfmt;
+    init_gen_rand(0, sfmt);
+    vector<Vec3> positions(numParticles);
+    for (int i = 0; i < numParticles; i++) {
+        system.addParticle(1.0);
+        if (i > 0)
+            bonds->addBond(i-1, i, 0.1, 1000.0);
+        positions[i] = Vec3(0.1*i, genrand_real2(sfmt), genrand_real2(sfmt));
+    }
+    VerletIntegrator integrator(0.001);
+    Context context(system, integrator, Platform::getPlatformByName("Reference"));
+    context.setPositions(positions);
+    vector<vector<Vec3> > frames;
+    for (int i = 0; i < numFrames; i++) {
+        writer.writeFrame(context);
+        frames.push_back(context.getState(State::Positions).getPositions());
+        integrator.step(stepsPerFrame);
+    }
+    writer.flush();
+    return frames;
+}
+
+int readInt(istream& stream) {
+    int value;
+    stream.read(reinterpret_cast<char*>(&value), sizeof(int));
+    return value;
+}
+
+double readDouble(istream& stream) {
+    double value;
+    stream.read(reinterpret_cast<char*>(&value), sizeof(double));
+    return value;
+}
+
+float readFloat(istream& stream) {
+    float value;
+    stream.read(reinterpret_cast<char*>(&value), sizeof(float));
+    return value;
+}
+
+void testDCD() {
+    string filename = "testTrajectory.dcd";
+    vector<vector<Vec3> > frames;
+    {
+        DCDTrajectoryWriter writer(filename, 0.001*stepsPerFrame, 0, stepsPerFrame);
+        frames = writeTrajectory(writer);
+    }
+
+    // Check the header.
+
+    ifstream in(filename.c_str(), ios::in|ios::binary);
+    ASSERT_EQUAL(84, readInt(in));
+    char cord[4];
+    in.read(cord, 4);
+    ASSERT(string(cord, 4) == "CORD");
+    ASSERT_EQUAL(numFrames, readInt(in));       // number of frames
+    ASSERT_EQUAL(0, readInt(in));               // first step
+    ASSERT_EQUAL(stepsPerFrame, readInt(in));   // steps between frames
+    ASSERT_EQUAL(numFrames*stepsPerFrame, readInt(in));
+    in.seekg(92);
+    ASSERT_EQUAL(84, readInt(in));              // start of the title record
+    in.seekg(184);                              // skip the rest of the title record
+    ASSERT_EQUAL(4, readInt(in));
+    ASSERT_EQUAL(numParticles, readInt(in));
+    ASSERT_EQUAL(4, readInt(in));
+
+    // Check every frame.
+
+    for (int frame = 0; frame < numFrames; frame++) {
+        ASSERT_EQUAL(48, readInt(in));
+        for (int i = 0; i < 6; i++)
+            readDouble(in);                     // unit cell
+        ASSERT_EQUAL(48, readInt(in));
+        vector<Vec3> coords(numParticles);
+        for (int axis = 0; axis < 3; axis++) {
+            ASSERT_EQUAL(4*numParticles, readInt(in));
+            for (int i = 0; i < numParticles; i++)
+                coords[i][axis] = 0.1*readFloat(in);
+            ASSERT_EQUAL(4*numParticles, readInt(in));
+        }
+        for (int i = 0; i < numParticles; i++)
+            ASSERT_EQUAL_VEC(frames[frame][i], coords[i], 1e-5);
+    }
+    ASSERT(in.good());
+    in.close();
+    remove(filename.c_str());
+}
+
+void testBinary() {
+    string filename = "testTrajectory.bin";
+    vector<vector<Vec3> > frames;
+    {
+        BinaryTrajectoryWriter writer(filename);
+        frames = writeTrajectory(writer);
+    }
+
+    // Check the header.
+
+    ifstream in(filename.c_str(), ios::in|ios::binary);
+    char magic[26];
+    in.read(magic, 26);
+    ASSERT(string(magic) == "OpenMM Binary Trajectory\n");
+    ASSERT_EQUAL(1, readInt(in));
+    ASSERT_EQUAL(numParticles, readInt(in));
+
+    // Check every frame.
+
+    for (int frame = 0; frame < numFrames; frame++) {
+        ASSERT_EQUAL_TOL(0.001*stepsPerFrame*frame, readDouble(in), 1e-6);
+        for (int i = 0; i < 9; i++)
+            readDouble(in);                     // box vectors
+        for (int i = 0; i < numParticles; i++) {
+            Vec3 pos;
+            for (int j = 0; j < 3; j++)
+                pos[j] = readFloat(in);
+            ASSERT_EQUAL_VEC(frames[frame][i], pos, 1e-5);
+        }
+    }
+    ASSERT(in.good());
+    in.close();
+    remove(filename.c_str());
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        testDCD();
+        testBinary();
+    }
+    catch(const exception& e) {
+        cout << "exception: " << e.what() << endl;
+        return 1;
+    }
+    cout << "Done" << endl;
+    return 0;
+}
@@ -0,0 +1,242 @@
+/* -------------------------------------------------------------------------- *
+ *                                   OpenMM                                   *
+ * -------------------------------------------------------------------------- *
+ * This is part of the OpenMM molecular simulation toolkit originating from   *
+ * Simbios, the NIH National Center for Physics-Based Simulation of           *
+ * Biological Structures at Stanford, funded under the NIH Roadmap for        *
+ * Medical Research, grant U54 GM072970. See https://simtk.org.               *
+ *                                                                            *
+ * Portions copyright (c) 2013-2018 Stanford University and the Authors.      *
+ * Authors: Peter Eastman                                                     *
+ * Contributors:                                                              *
+ *                                                                            *
+ * Permission is hereby granted, free of charge, to any person obtaining a    *
+ * copy of this software and associated documentation files (the "Software"), *
+ * to deal in the Software without restriction, including without limitation  *
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,   *
+ * and/or sell copies of the Software, and to permit persons to whom the      *
+ * Software is furnished to do so, subject to the following conditions:       *
+ *                                                                            *
+ * The above copyright notice and this permission notice shall be included in *
+ * all copies or substantial portions of the Software.                        *
+ *                                                                            *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   *
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    *
+ * THE AUTHORS, CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,    *
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      *
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE  *
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.                                     *
+ * -------------------------------------------------------------------------- */
+
+/**
+ * This tests vectorized operations.
+ */
+
+#include "openmm/internal/AssertionUtilities.h"
+#include "openmm/internal/vectorize16.h"
+#include <iostream>
+
+
+#ifndef __AVX512F__
+bool isVec16Supported() {
+    return false;
+}
+#else
+/**
+ * Query the extended control register to find which register states the OS saves on context switches.
+ */
+static unsigned long long getEnabledXSaveFeatures() {
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ __volatile__ (".byte 0x0f, 0x01, 0xd0" : "=a" (eax), "=d" (edx) : "c" (0));
+    return eax | ((unsigned long long) edx << 32);
+#endif
+}
+
+/**
+ * Check whether 16 component vectors are supported with the current CPU.
+ */
+bool isVec16Supported() {
+    // Make sure the CPU supports AVX-512F and the OS preserves the ZMM and opmask registers.
+
+    int cpuInfo[4];
+    cpuid(cpuInfo, 0);
+    if (cpuInfo[0] >= 7) {
+        cpuid(cpuInfo, 1);
+        bool osUsesXSave = ((cpuInfo[2] & ((int) 1 << 27)) != 0);
+        if (!osUsesXSave || (getEnabledXSaveFeatures() & 0xE6) != 0xE6)
+            return false;
+        cpuidex(cpuInfo, 7, 0);
+        return ((cpuInfo[1] & ((int) 1 << 16)) != 0);
+    }
+    return false;
+}
+#endif
+
+using namespace OpenMM;
+using namespace std;
+
+#define ASSERT_VEC4_EQUAL(found, expected0, expected1, expected2, expected3) {if (std::abs((found)[0]-(expected0))>1e-6 || std::abs((found)[1]-(expected1))>1e-6 || std::abs((found)[2]-(expected2))>1e-6 || std::abs((found)[3]-(expected3))>1e-6) {std::stringstream details; details << " Expected ("<<(expected0)<<","<<(expected1)<<","<<(expected2)<<","<<(expected3)<<"), found ("<<(found)[0]<<","<<(found)[1]<<","<<(found)[2]<<","<<(found)[3]<<")"; throwException(__FILE__, __LINE__, details.str());}};
+#define ASSERT_VEC16_EQUAL(found, ...) {float expected[16] = {__VA_ARGS__}; float values[16]; (found).store(values); for (int index = 0; index < 16; index++) if (std::abs(values[index]-expected[index]) > 1e-6) {std::stringstream details; details << " Expected "<<expected[index]<<", found "<<values[index]<<" at element "<<index; throwException(__FILE__, __LINE__, details.str());}};
+#define ASSERT_VEC16_EQUAL_INT(found, ...) {int expected[16] = {__VA_ARGS__}; int values[16]; (found).store(values); for (int index = 0; index < 16; index++) if (values[index] != expected[index]) {std::stringstream details; details << " Expected "<<expected[index]<<", found "<<values[index]<<" at element "<<index; throwException(__FILE__, __LINE__, details.str());}};
+
+
+void testLoadStore() {
+    fvec16 f1(2.0f);
+    ivec16 i1(3);
+    ASSERT_VEC16_EQUAL(f1, 2.0, 2.0, 2.0, 2.0, 2.0, 2.0, 2.0, 2.0, 2.0, 2.0, 2.0, 2.0, 2.0, 2.0, 2.0, 2.0);
+    ASSERT_VEC16_EQUAL_INT(i1, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3);
+    fvec16 f2(2.5f, 3.0f, 3.5f, 4.0f, 4.5f, 5.0f, 5.5f, 6.0f, 6.5f, 7.0f, 7.5f, 8.0f, 8.5f, 9.0f, 9.5f, 10.0f);
+    int ivalues[16] = {2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17};
+    ivec16 i2(ivalues);
+    ASSERT_VEC16_EQUAL(f2, 2.5, 3.0, 3.5, 4.0, 4.5, 5.0, 5.5, 6.0, 6.5, 7.0, 7.5, 8.0, 8.5, 9.0, 9.5, 10.0);
+    ASSERT_VEC16_EQUAL_INT(i2, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17);
+    float farray[16];
+    int iarray[16];
+    f2.store(farray);
+    i2.store(iarray);
+    fvec16 f3(farray);
+    ivec16 i3(iarray);
+    ASSERT_VEC16_EQUAL(f3, 2.5, 3.0, 3.5, 4.0, 4.5, 5.0, 5.5, 6.0, 6.5, 7.0, 7.5, 8.0, 8.5, 9.0, 9.5, 10.0);
+    ASSERT_VEC16_EQUAL_INT(i3, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17);
+
+    // The lower and upper halves should match the full vector.
+
+    float lower[8], upper[8];
+    f3.lowerVec().store(lower);
+    f3.upperVec().store(upper);
+    for (int i = 0; i < 8; i++) {
+        ASSERT_EQUAL(farray[i], lower[i]);
+        ASSERT_EQUAL(farray[i+8], upper[i]);
+    }
+    fvec16 f4(f3.lowerVec(), f3.upperVec());
+    ASSERT_VEC16_EQUAL(f4, 2.5, 3.0, 3.5, 4.0, 4.5, 5.0, 5.5, 6.0, 6.5, 7.0, 7.5, 8.0, 8.5, 9.0, 9.5, 10.0);
+}
+
+void testArithmetic() {
+    fvec16 f1(0.5f, 1.0f, 1.5f, 2.0f, 2.5f, 3.0f, 3.5f, 4.0f, 4.5f, 5.0f, 5.5f, 6.0f, 6.5f, 7.0f, 7.5f, 8.0f);
+    fvec16 f2(1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f, 16.0f);
+    ASSERT_VEC16_EQUAL(f1+f2, 1.5, 3.0, 4.5, 6.0, 7.5, 9.0, 10.5, 12.0, 13.5, 15.0, 16.5, 18.0, 19.5, 21.0, 22.5, 24.0);
+    ASSERT_VEC16_EQUAL(f1-f2, -0.5, -1.0, -1.5, -2.0, -2.5, -3.0, -3.5, -4.0, -4.5, -5.0, -5.5, -6.0, -6.5, -7.0, -7.5, -8.0);
+    ASSERT_VEC16_EQUAL(f1*f2, 0.5, 2.0, 4.5, 8.0, 12.5, 18.0, 24.5, 32.0, 40.5, 50.0, 60.5, 72.0, 84.5, 98.0, 112.5, 128.0);
+    ASSERT_VEC16_EQUAL(f1/f2, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5);
+    ASSERT_VEC16_EQUAL(-f1, -0.5, -1.0, -1.5, -2.0, -2.5, -3.0, -3.5, -4.0, -4.5, -5.0, -5.5, -6.0, -6.5, -7.0, -7.5, -8.0);
+
+    fvec16 f3 = f1;
+    f3 += f2;
+    ASSERT_VEC16_EQUAL(f3, 1.5, 3.0, 4.5, 6.0, 7.5, 9.0, 10.5, 12.0, 13.5, 15.0, 16.5, 18.0, 19.5, 21.0, 22.5, 24.0);
+    f3 = f1;
+    f3 -= f2;
+    ASSERT_VEC16_EQUAL(f3, -0.5, -1.0, -1.5, -2.0, -2.5, -3.0, -3.5, -4.0, -4.5, -5.0, -5.5, -6.0, -6.5, -7.0, -7.5, -8.0);
+    f3 = f1;
+    f3 *= f2;
+    ASSERT_VEC16_EQUAL(f3, 0.5, 2.0, 4.5, 8.0, 12.5, 18.0, 24.5, 32.0, 40.5, 50.0, 60.5, 72.0, 84.5, 98.0, 112.5, 128.0);
+    f3 = f1;
+    f3 /= f2;
+    ASSERT_VEC16_EQUAL(f3, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5, 0.5);
+
+    // Operators combining a scalar with a vector.
+
+    ASSERT_VEC16_EQUAL(1.0f+f1, 1.5, 2.0, 2.5, 3.0, 3.5, 4.0, 4.5, 5.0, 5.5, 6.0, 6.5, 7.0, 7.5, 8.0, 8.5, 9.0);
+    ASSERT_VEC16_EQUAL(1.0f-f1, 0.5, 0.0, -0.5, -1.0, -1.5, -2.0, -2.5, -3.0, -3.5, -4.0, -4.5, -5.0, -5.5, -6.0, -6.5, -7.0);
+    ASSERT_VEC16_EQUAL(2.0f*f1, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0, 10.0, 11.0, 12.0, 13.0, 14.0, 15.0, 16.0);
+    ASSERT_VEC16_EQUAL(2.0f/f2, 2.0, 1.0, 2.0/3.0, 0.5, 0.4, 1.0/3.0, 2.0/7.0, 0.25, 2.0/9.0, 0.2, 2.0/11.0, 1.0/6.0, 2.0/13.0, 1.0/7.0, 2.0/15.0, 0.125);
+}
+
+void testLogic() {
+    // fvec16 has no bitwise operators, since AVX-512 represents masks as opmask
+    // registers instead of vectors.  Only the integer vector supports them.
+
+    int allBits = -1;
+    int maskValues[16] = {0, allBits, allBits, 0, 0, allBits, allBits, 0, 0, allBits, allBits, 0, 0, allBits, allBits, 0};
+    ivec16 mask(maskValues);
+    int ivalues[16] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+    ivec16 i1(ivalues);
+    ASSERT_VEC16_EQUAL_INT(i1&mask, 0, 2, 3, 0, 0, 6, 7, 0, 0, 10, 11, 0, 0, 14, 15, 0);
+    ASSERT_VEC16_EQUAL_INT(i1|mask, 1, allBits, allBits, 4, 5, allBits, allBits, 8, 9, allBits, allBits, 12, 13, allBits, allBits, 16);
+    ASSERT_VEC16_EQUAL_INT(i1+i1, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30, 32);
+}
+
+void testComparisons() {
+    fvec16 v1(0.0f);
+    fvec16 v2(1.5f);
+    fvec16 f1(1.0f, 1.5f, 3.0f, 2.2f, 10.0f, 10.5f, 13.0f, 12.2f, 1.0f, 1.5f, 3.0f, 2.2f, 10.0f, 10.5f, 13.0f, 12.2f);
+    fvec16 f2(1.1f, 1.5f, 3.0f, 2.1f, 10.1f, 10.5f, 13.0f, 12.1f, 1.1f, 1.5f, 3.0f, 2.1f, 10.1f, 10.5f, 13.0f, 12.1f);
+    ASSERT_VEC16_EQUAL(blend(v1, v2, f1==f2), 0.0, 1.5, 1.5, 0.0, 0.0, 1.5, 1.5, 0.0, 0.0, 1.5, 1.5, 0.0, 0.0, 1.5, 1.5, 0.0);
+    ASSERT_VEC16_EQUAL(blend(v1, v2, f1!=f2), 1.5, 0.0, 0.0, 1.5, 1.5, 0.0, 0.0, 1.5, 1.5, 0.0, 0.0, 1.5, 1.5, 0.0, 0.0, 1.5);
+    ASSERT_VEC16_EQUAL(blend(v1, v2, f1<f2), 1.5, 0.0, 0.0, 0.0, 1.5, 0.0, 0.0, 0.0, 1.5, 0.0, 0.0, 0.0, 1.5, 0.0, 0.0, 0.0);
+    ASSERT_VEC16_EQUAL(blend(v1, v2, f1>f2), 0.0, 0.0, 0.0, 1.5, 0.0, 0.0, 0.0, 1.5, 0.0, 0.0, 0.0, 1.5, 0.0, 0.0, 0.0, 1.5);
+    ASSERT_VEC16_EQUAL(blend(v1, v2, f1<=f2), 1.5, 1.5, 1.5, 0.0, 1.5, 1.5, 1.5, 0.0, 1.5, 1.5, 1.5, 0.0, 1.5, 1.5, 1.5, 0.0);
+    ASSERT_VEC16_EQUAL(blend(v1, v2, f1>=f2), 0.0, 1.5, 1.5, 1.5, 0.0, 1.5, 1.5, 1.5, 0.0, 1.5, 1.5, 1.5, 0.0, 1.5, 1.5, 1.5);
+}
+
+void testMathFunctions() {
+    fvec16 f1(0.4f, 1.9f, -1.2f, -3.8f, 0.4f, 1.9f, -1.2f, -3.8f, 0.4f, 1.9f, -1.2f, -3.8f, 0.4f, 1.9f, -1.2f, -3.8f);
+    fvec16 f2(1.1f, 1.2f, 1.3f, -5.0f, 1.1f, 1.2f, 1.3f, -5.0f, 1.1f, 1.2f, 1.3f, -5.0f, 1.1f, 1.2f, 1.3f, -5.0f);
+    ASSERT_VEC16_EQUAL(floor(f1), 0.0, 1.0, -2.0, -4.0, 0.0, 1.0, -2.0, -4.0, 0.0, 1.0, -2.0, -4.0, 0.0, 1.0, -2.0, -4.0);
+    ASSERT_VEC16_EQUAL(ceil(f1), 1.0, 2.0, -1.0, -3.0, 1.0, 2.0, -1.0, -3.0, 1.0, 2.0, -1.0, -3.0, 1.0, 2.0, -1.0, -3.0);
+    ASSERT_VEC16_EQUAL(round(f1), 0.0, 2.0, -1.0, -4.0, 0.0, 2.0, -1.0, -4.0, 0.0, 2.0, -1.0, -4.0, 0.0, 2.0, -1.0, -4.0);
+    ASSERT_VEC16_EQUAL(abs(f1), 0.4, 1.9, 1.2, 3.8, 0.4, 1.9, 1.2, 3.8, 0.4, 1.9, 1.2, 3.8, 0.4, 1.9, 1.2, 3.8);
+    ASSERT_VEC16_EQUAL(min(f1, f2), 0.4, 1.2, -1.2, -5.0, 0.4, 1.2, -1.2, -5.0, 0.4, 1.2, -1.2, -5.0, 0.4, 1.2, -1.2, -5.0);
+    ASSERT_VEC16_EQUAL(max(f1, f2), 1.1, 1.9, 1.3, -3.8, 1.1, 1.9, 1.3, -3.8, 1.1, 1.9, 1.3, -3.8, 1.1, 1.9, 1.3, -3.8);
+    fvec16 f3(1.5f, 3.1f, 4.0f, 15.0f, 1.5f, 3.1f, 4.0f, 15.0f, 1.5f, 3.1f, 4.0f, 15.0f, 1.5f, 3.1f, 4.0f, 15.0f);
+    ASSERT_VEC16_EQUAL(sqrt(f3), sqrt(1.5), sqrt(3.1), sqrt(4.0), sqrt(15.0), sqrt(1.5), sqrt(3.1), sqrt(4.0), sqrt(15.0), sqrt(1.5), sqrt(3.1), sqrt(4.0), sqrt(15.0), sqrt(1.5), sqrt(3.1), sqrt(4.0), sqrt(15.0));
+    ASSERT_VEC16_EQUAL(rsqrt(f3), 1.0/sqrt(1.5), 1.0/sqrt(3.1), 1.0/sqrt(4.0), 1.0/sqrt(15.0), 1.0/sqrt(1.5), 1.0/sqrt(3.1), 1.0/sqrt(4.0), 1.0/sqrt(15.0), 1.0/sqrt(1.5), 1.0/sqrt(3.1), 1.0/sqrt(4.0), 1.0/sqrt(15.0), 1.0/sqrt(1.5), 1.0/sqrt(3.1), 1.0/sqrt(4.0), 1.0/sqrt(15.0));
+    float values1[16], values2[16];
+    f1.store(values1);
+    f2.store(values2);
+    float expectedDot = 0.0f;
+    float expectedSum = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        expectedDot += values1[i]*values2[i];
+        expectedSum += values1[i];
+    }
+    ASSERT_EQUAL_TOL(expectedDot, dot16(f1, f2), 1e-6);
+    ASSERT_EQUAL_TOL(expectedSum, reduceAdd(f1), 1e-6);
+    ASSERT(any(f1 > 0.5f));
+    ASSERT(!any(f1 > 2.0f));
+    ASSERT(!any(f1 == f2));
+    ASSERT_VEC16_EQUAL(blend(f1, f2, (__mmask16) 0x5555), 1.1, 1.9, 1.3, -3.8, 1.1, 1.9, 1.3, -3.8, 1.1, 1.9, 1.3, -3.8, 1.1, 1.9, 1.3, -3.8);
+}
+
+void testTranspose() {
+    fvec4 in[16];
+    for (int i = 0; i < 16; i++)
+        in[i] = fvec4(10.0f*i, 10.0f*i+1, 10.0f*i+2, 10.0f*i+3);
+    fvec16 o1, o2, o3, o4;
+
+    transpose(in, o1, o2, o3, o4);
+    ASSERT_VEC16_EQUAL(o1, 0.0, 10.0, 20.0, 30.0, 40.0, 50.0, 60.0, 70.0, 80.0, 90.0, 100.0, 110.0, 120.0, 130.0, 140.0, 150.0);
+    ASSERT_VEC16_EQUAL(o2, 1.0, 11.0, 21.0, 31.0, 41.0, 51.0, 61.0, 71.0, 81.0, 91.0, 101.0, 111.0, 121.0, 131.0, 141.0, 151.0);
+    ASSERT_VEC16_EQUAL(o3, 2.0, 12.0, 22.0, 32.0, 42.0, 52.0, 62.0, 72.0, 82.0, 92.0, 102.0, 112.0, 122.0, 132.0, 142.0, 152.0);
+    ASSERT_VEC16_EQUAL(o4, 3.0, 13.0, 23.0, 33.0, 43.0, 53.0, 63.0, 73.0, 83.0, 93.0, 103.0, 113.0, 123.0, 133.0, 143.0, 153.0);
+
+    fvec4 out[16];
+    transpose(o1, o2, o3, o4, out);
+    for (int i = 0; i < 16; i++)
+        ASSERT_VEC4_EQUAL(out[i], 10.0*i, 10.0*i+1, 10.0*i+2, 10.0*i+3);
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        if (!isVec16Supported()) {
+            cout << "CPU is not supported.  Exiting." << endl;
+            return 0;
+        }
+        testLoadStore();
+        testArithmetic();
+        testLogic();
+        testComparisons();
+        testMathFunctions();
+        testTranspose();
+    }
+    catch(const exception& e) {
+        cout << "exception: " << e.what() << endl;
+        return 1;
+    }
+    cout << "Done" << endl;
+    return 0;
+}
@@ -68,7 +68,7 @@ class WrapperGenerator:
     
     def __init__(self, inputDirname, output):
         self.skipClasses = ['OpenMM::Vec3', 'OpenMM::XmlSerializer', 'OpenMM::Kernel', 'OpenMM::KernelImpl', 'OpenMM::KernelFactory', 'OpenMM::ContextImpl', 'OpenMM::SerializationNode', 'OpenMM::SerializationProxy']
-        self.skipMethods = ['OpenMM::Context::getState', 'OpenMM::Platform::loadPluginsFromDirectory', 'OpenMM::Platform::getPluginLoadFailures', 'OpenMM::Context::createCheckpoint', 'OpenMM::Context::loadCheckpoint', 'OpenMM::Context::getMolecules']
+        self.skipMethods = ['OpenMM::Context::getState', 'OpenMM::Platform::loadPluginsFromDirectory', 'OpenMM::Platform::getPluginLoadFailures', 'OpenMM::Context::createCheckpoint', 'OpenMM::Context::loadCheckpoint', 'OpenMM::Context::getMolecules', 'OpenMM::State::getEnergiesByForceGroup']
         self.hideClasses = ['Kernel', 'KernelImpl', 'KernelFactory', 'ContextImpl', 'SerializationNode', 'SerializationProxy']
         self.nodeByID={}
 
@@ -405,7 +405,15 @@ extern OPENMM_EXPORT char* OpenMM_XmlSerializer_serializeState(const OpenMM_Stat
 extern OPENMM_EXPORT char* OpenMM_XmlSerializer_serializeIntegrator(const OpenMM_Integrator* integrator);
 extern OPENMM_EXPORT OpenMM_System* OpenMM_XmlSerializer_deserializeSystem(const char* xml);
 extern OPENMM_EXPORT OpenMM_State* OpenMM_XmlSerializer_deserializeState(const char* xml);
-extern OPENMM_EXPORT OpenMM_Integrator* OpenMM_XmlSerializer_deserializeIntegrator(const char* xml);""", file=self.out)
+extern OPENMM_EXPORT OpenMM_Integrator* OpenMM_XmlSerializer_deserializeIntegrator(const char* xml);
+
+/* These methods exchange particle data through a caller owned buffer of doubles containing x, y, z
+   for each particle in turn, avoiding the intermediate OpenMM_Vec3Array.  The buffers passed to the
+   State methods must be large enough to hold three doubles for every particle. */
+extern OPENMM_EXPORT void OpenMM_Context_setPositionsFromArray(OpenMM_Context* target, const double* positions, int numParticles);
+extern OPENMM_EXPORT void OpenMM_State_getPositionsIntoArray(const OpenMM_State* target, double* positions);
+extern OPENMM_EXPORT void OpenMM_State_getVelocitiesIntoArray(const OpenMM_State* target, double* velocities);
+extern OPENMM_EXPORT void OpenMM_State_getForcesIntoArray(const OpenMM_State* target, double* forces);""", file=self.out)
 
         self.writeClasses()
 
@@ -850,6 +858,29 @@ OPENMM_EXPORT OpenMM_Integrator* OpenMM_XmlSerializer_deserializeIntegrator(cons
     string input(xml);
     stringstream stream(input);
     return reinterpret_cast<OpenMM_Integrator*>(OpenMM::XmlSerializer::deserialize<OpenMM::Integrator>(stream));
+}
+
+/* These methods exchange particle data through a caller owned buffer of doubles containing x, y, z
+   for each particle in turn, avoiding the intermediate OpenMM_Vec3Array. */
+OPENMM_EXPORT void OpenMM_Context_setPositionsFromArray(OpenMM_Context* target, const double* positions, int numParticles) {
+    const Vec3* data = reinterpret_cast<const Vec3*>(positions);
+    vector<Vec3> vec(data, data+numParticles);
+    reinterpret_cast<Context*>(target)->setPositions(vec);
+}
+OPENMM_EXPORT void OpenMM_State_getPositionsIntoArray(const OpenMM_State* target, double* positions) {
+    const vector<Vec3>& data = reinterpret_cast<const State*>(target)->getPositions();
+    if (data.size() > 0)
+        memcpy(positions, &data[0], data.size()*sizeof(Vec3));
+}
+OPENMM_EXPORT void OpenMM_State_getVelocitiesIntoArray(const OpenMM_State* target, double* velocities) {
+    const vector<Vec3>& data = reinterpret_cast<const State*>(target)->getVelocities();
+    if (data.size() > 0)
+        memcpy(velocities, &data[0], data.size()*sizeof(Vec3));
+}
+OPENMM_EXPORT void OpenMM_State_getForcesIntoArray(const OpenMM_State* target, double* forces) {
+    const vector<Vec3>& data = reinterpret_cast<const State*>(target)->getForces();
+    if (data.size() > 0)
+        memcpy(forces, &data[0], data.size()*sizeof(Vec3));
 }""", file=self.out)
         self.writeClasses()
         print("}\n", file=self.out)
@@ -1368,6 +1399,29 @@ MODULE OpenMM
             use OpenMM_Types; implicit none
             character(*) xml
             type(OpenMM_Integrator) result
+        end subroutine
+        ! These methods exchange particle data through a caller owned array of doubles containing
+        ! x, y, z for each particle in turn, avoiding the intermediate OpenMM_Vec3Array.
+        subroutine OpenMM_Context_setPositionsFromArray(target, positions, numParticles)
+            use OpenMM_Types; implicit none
+            type (OpenMM_Context) target
+            real*8 positions(*)
+            integer*4 numParticles
+        end subroutine
+        subroutine OpenMM_State_getPositionsIntoArray(target, positions)
+            use OpenMM_Types; implicit none
+            type (OpenMM_State) target
+            real*8 positions(*)
+        end subroutine
+        subroutine OpenMM_State_getVelocitiesIntoArray(target, velocities)
+            use OpenMM_Types; implicit none
+            type (OpenMM_State) target
+            real*8 velocities(*)
+        end subroutine
+        subroutine OpenMM_State_getForcesIntoArray(target, forces)
+            use OpenMM_Types; implicit none
+            type (OpenMM_State) target
+            real*8 forces(*)
         end subroutine""", file=self.out)
         
         self.writeClasses()
@@ -2057,6 +2111,30 @@ OPENMM_EXPORT void openmm_xmlserializer_deserializeintegrator_(const char* xml,
 }
 OPENMM_EXPORT void OPENMM_XMLSERIALIZER_DESERIALIZEINTEGRATOR(const char* xml, OpenMM_Integrator*& result, int length) {
     result = OpenMM_XmlSerializer_deserializeIntegrator(makeString(xml, length).c_str());
+}
+OPENMM_EXPORT void openmm_context_setpositionsfromarray_(OpenMM_Context*& target, const double* positions, int const& numParticles) {
+    OpenMM_Context_setPositionsFromArray(target, positions, numParticles);
+}
+OPENMM_EXPORT void OPENMM_CONTEXT_SETPOSITIONSFROMARRAY(OpenMM_Context*& target, const double* positions, int const& numParticles) {
+    OpenMM_Context_setPositionsFromArray(target, positions, numParticles);
+}
+OPENMM_EXPORT void openmm_state_getpositionsintoarray_(const OpenMM_State*& target, double* positions) {
+    OpenMM_State_getPositionsIntoArray(target, positions);
+}
+OPENMM_EXPORT void OPENMM_STATE_GETPOSITIONSINTOARRAY(const OpenMM_State*& target, double* positions) {
+    OpenMM_State_getPositionsIntoArray(target, positions);
+}
+OPENMM_EXPORT void openmm_state_getvelocitiesintoarray_(const OpenMM_State*& target, double* velocities) {
+    OpenMM_State_getVelocitiesIntoArray(target, velocities);
+}
+OPENMM_EXPORT void OPENMM_STATE_GETVELOCITIESINTOARRAY(const OpenMM_State*& target, double* velocities) {
+    OpenMM_State_getVelocitiesIntoArray(target, velocities);
+}
+OPENMM_EXPORT void openmm_state_getforcesintoarray_(const OpenMM_State*& target, double* forces) {
+    OpenMM_State_getForcesIntoArray(target, forces);
+}
+OPENMM_EXPORT void OPENMM_STATE_GETFORCESINTOARRAY(const OpenMM_State*& target, double* forces) {
+    OpenMM_State_getForcesIntoArray(target, forces);
 }""", file=self.out)
 
         self.writeClasses()
@@ -19,6 +19,7 @@ namespace std {
   %template(mapstringstring) map<string,string>;
   %template(mapstringdouble) map<string,double>;
   %template(mapii) map<int,int>;
+  %template(mapid) map<int,double>;
   %template(seti) set<int>;
 };
 
@@ -434,6 +434,7 @@ UNITS = {
 ("State", "getPeriodicBoxVectors") : ('unit.nanometers', ()),
 ("State", "getParameters") : (None, ()),
 ("State", "getEnergyParameterDerivatives") : (None, ()),
+("State", "getEnergiesByForceGroup") : (None, ()),
 ("System", "getConstraintParameters") : (None, (None, None, 'unit.nanometer')),
 ("System", "getForce") : (None, ()),
 ("System", "getVirtualSite") : (None, ()),
@@ -3,12 +3,17 @@
     #include <numpy/arrayobject.h>
 %}
 
+%init %{
+    import_array();
+%}
+
 %extend OpenMM::Context {
 
   %pythoncode %{
     def getState(self, getPositions=False, getVelocities=False,
                  getForces=False, getEnergy=False, getParameters=False,
-                 getParameterDerivatives=False, enforcePeriodicBox=False, groups=-1):
+                 getParameterDerivatives=False, getEnergiesByForceGroup=False,
+                 enforcePeriodicBox=False, groups=-1):
         """Get a State object recording the current state information stored in this context.
 
         Parameters
@@ -25,6 +30,11 @@
             whether to store context parameters in the State
         getParameterDerivatives : bool=False
             whether to store parameter derivatives in the State
+        getEnergiesByForceGroup : bool=False
+            whether to store the potential energy of each force group in the
+            State.  The energies are reported in kJ/mol.  On most platforms
+            they are all computed in a single evaluation, so this is far
+            cheaper than creating one State per force group.
         enforcePeriodicBox : bool=False
             if false, the position of each particle will be whatever position
             is stored in the Context, regardless of periodic boundary conditions.
@@ -61,6 +71,8 @@
             types += State.Parameters
         if getParameterDerivatives:
             types += State.ParameterDerivatives
+        if getEnergiesByForceGroup:
+            types += State.GroupEnergies
         state = _openmm.Context_getState(self, types, enforcePeriodicBox, groups_mask)
         return state
 
@@ -419,13 +431,12 @@ Parameters:
            Raises an exception if positions where not requested in
            the context.getState() call.
            Returns a list of Vec3s, unless asNumpy is True, in
-           which  case a Numpy array of arrays will be returned.
+           which case a read-only Numpy array backed by the State's
+           internal storage will be returned.
            """
         if asNumpy:
             if '_positionsNumpy' not in dir(self):
-                self._positionsNumpy = numpy.empty([self._getNumParticles(), 3], numpy.float64)
-                self._getVectorAsNumpy(State.Positions, self._positionsNumpy)
-                self._positionsNumpy = self._positionsNumpy*unit.nanometers
+                self._positionsNumpy = self._getVectorAsNumpy(State.Positions, self)*unit.nanometers
             return self._positionsNumpy
         if '_positions' not in dir(self):
             self._positions = self._getVectorAsVec3(State.Positions)*unit.nanometers
@@ -435,14 +446,13 @@ Parameters:
         """Get the velocity of each particle with units.
            Raises an exception if velocities where not requested in
            the context.getState() call.
-           Returns a list of Vec3s if asNumpy is False, or a Numpy
-           array if asNumpy is True.
+           Returns a list of Vec3s if asNumpy is False, or a read-only
+           Numpy array backed by the State's internal storage if asNumpy
+           is True.
            """
         if asNumpy:
             if '_velocitiesNumpy' not in dir(self):
-                self._velocitiesNumpy = numpy.empty([self._getNumParticles(), 3], numpy.float64)
-                self._getVectorAsNumpy(State.Velocities, self._velocitiesNumpy)
-                self._velocitiesNumpy = self._velocitiesNumpy*unit.nanometers/unit.picosecond
+                self._velocitiesNumpy = self._getVectorAsNumpy(State.Velocities, self)*unit.nanometers/unit.picosecond
             return self._velocitiesNumpy
         if '_velocities' not in dir(self):
             self._velocities = self._getVectorAsVec3(State.Velocities)*unit.nanometers/unit.picosecond
@@ -452,30 +462,19 @@ Parameters:
         """Get the force acting on each particle with units.
            Raises an exception if forces where not requested in
            the context.getState() call.
-           Returns a list of Vec3s if asNumpy is False, or a Numpy
-           array if asNumpy is True.
+           Returns a list of Vec3s if asNumpy is False, or a read-only
+           Numpy array backed by the State's internal storage if asNumpy
+           is True.
            """
         if asNumpy:
             if '_forcesNumpy' not in dir(self):
-                self._forcesNumpy = numpy.empty([self._getNumParticles(), 3], numpy.float64)
-                self._getVectorAsNumpy(State.Forces, self._forcesNumpy)
-                self._forcesNumpy = self._forcesNumpy*unit.kilojoules_per_mole/unit.nanometer
+                self._forcesNumpy = self._getVectorAsNumpy(State.Forces, self)*unit.kilojoules_per_mole/unit.nanometer
             return self._forcesNumpy
         if '_forces' not in dir(self):
             self._forces = self._getVectorAsVec3(State.Forces)*unit.kilojoules_per_mole/unit.nanometer
         return self._forces
   %}
   
-  int _getNumParticles() {
-      if ((self->getDataTypes() & State::Positions) != 0)
-          return self->getPositions().size();
-      if ((self->getDataTypes() & State::Velocities) != 0)
-          return self->getVelocities().size();
-      if ((self->getDataTypes() & State::Forces) != 0)
-          return self->getForces().size();
-      return 0;
-  }
-  
   PyObject* _getVectorAsVec3(State::DataType type) {
       if (type == State::Positions)
           return copyVVec3ToList(self->getPositions());
@@ -487,7 +486,7 @@ Parameters:
       return NULL;
   }
   
-  void _getVectorAsNumpy(State::DataType type, PyObject* output) {
+  PyObject* _getVectorAsNumpy(State::DataType type, PyObject* owner) {
       const std::vector<Vec3>* array;
       if (type == State::Positions)
           array = &self->getPositions();
@@ -497,10 +496,23 @@ Parameters:
           array = &self->getForces();
       else {
         PyErr_SetString(PyExc_ValueError, "Illegal type specified in _getVectorAsNumpy");
-        return;
+        return NULL;
+      }
+      npy_intp dims[2] = {(npy_intp) array->size(), 3};
+      if (array->size() == 0)
+          return PyArray_SimpleNew(2, dims, NPY_DOUBLE);
+      PyObject* result = PyArray_SimpleNewFromData(2, dims, NPY_DOUBLE, (void*) &(*array)[0]);
+      if (result == NULL)
+          return NULL;
+      // The array aliases the State's internal storage, so keep the State alive as long as the
+      // array exists and do not let callers modify the State through it.
+      PyArray_CLEARFLAGS((PyArrayObject*) result, NPY_ARRAY_WRITEABLE);
+      Py_INCREF(owner);
+      if (PyArray_SetBaseObject((PyArrayObject*) result, owner) != 0) {
+          Py_DECREF(result);
+          return NULL;
       }
-      void* data = PyArray_DATA((PyArrayObject*) output);
-      memcpy(data, &array[0][0], 3*sizeof(double)*array->size());
+      return result;
   }
 
   %newobject __copy__;